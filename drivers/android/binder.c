@@ -564,32 +564,77 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
 	}
 }
 
+/* max number of waiting threads inspected when picking one for proc work */
+#define BINDER_SELECT_SCAN_MAX	8
+
+/*
+ * Rank a waiting thread for handling a transaction from the current task:
+ * one that last ran on this CPU is woken up (and, for sync transactions,
+ * handed the CPU) with the least latency, then one in the same cache
+ * domain; among those, prefer a thread that is already at the priority the
+ * transaction asks for, so binder_transaction_priority() has nothing to do.
+ */
+static int binder_thread_select_score(struct binder_thread *thread,
+				      const struct binder_priority *prio)
+{
+	int cpu = task_cpu(thread->task);
+	int this_cpu = raw_smp_processor_id();
+	int score = 0;
+
+	if (cpu == this_cpu)
+		score += 4;
+	else if (cpus_share_cache(cpu, this_cpu))
+		score += 2;
+
+	if (prio && thread->task->policy == prio->sched_policy &&
+	    thread->task->normal_prio == prio->prio)
+		score += 1;
+
+	return score;
+}
+
 /**
  * binder_select_thread_ilocked() - selects a thread for doing proc work.
  * @proc:	process to select a thread from
+ * @prio:	priority the work wants to run at (may be NULL)
  *
  * Note that calling this function moves the thread off the waiting_threads
  * list, so it can only be woken up by the caller of this function, or a
  * signal. Therefore, callers *should* always wake up the thread this function
  * returns.
  *
+ * waiting_threads is kept most-recently-idle first; only the first
+ * %BINDER_SELECT_SCAN_MAX of them are ranked by binder_thread_select_score()
+ * so the time spent under the inner lock stays bounded.
+ *
  * Return:	If there's a thread currently waiting for process work,
  *		returns that thread. Otherwise returns NULL.
  */
 static struct binder_thread *
-binder_select_thread_ilocked(struct binder_proc *proc)
+binder_select_thread_ilocked(struct binder_proc *proc,
+			     const struct binder_priority *prio)
 {
-	struct binder_thread *thread;
+	struct binder_thread *thread, *best = NULL;
+	int score, best_score = -1;
+	int scanned = 0;
 
 	assert_spin_locked(&proc->inner_lock);
-	thread = list_first_entry_or_null(&proc->waiting_threads,
-					  struct binder_thread,
-					  waiting_thread_node);
+	list_for_each_entry(thread, &proc->waiting_threads,
+			    waiting_thread_node) {
+		score = binder_thread_select_score(thread, prio);
+		if (score > best_score) {
+			best = thread;
+			best_score = score;
+		}
+		/* same CPU and already at the right priority: can't do better */
+		if (best_score == 5 || ++scanned >= BINDER_SELECT_SCAN_MAX)
+			break;
+	}
 
-	if (thread)
-		list_del_init(&thread->waiting_thread_node);
+	if (best)
+		list_del_init(&best->waiting_thread_node);
 
-	return thread;
+	return best;
 }
 
 /**
@@ -641,7 +686,7 @@ static void binder_wakeup_thread_ilocked(struct binder_proc *proc,
 
 static void binder_wakeup_proc_ilocked(struct binder_proc *proc)
 {
-	struct binder_thread *thread = binder_select_thread_ilocked(proc);
+	struct binder_thread *thread = binder_select_thread_ilocked(proc, NULL);
 
 	binder_wakeup_thread_ilocked(proc, thread, /* sync = */false);
 }
@@ -1668,10 +1713,26 @@ static void binder_free_txn_fixups(struct binder_transaction *t)
 	}
 }
 
+static void binder_txn_latency_free(struct binder_transaction *t)
+{
+	int from_proc, from_thread, to_proc, to_thread;
+
+	spin_lock(&t->lock);
+	from_proc = t->from ? t->from->proc->pid : 0;
+	from_thread = t->from ? t->from->pid : 0;
+	to_proc = t->to_proc ? t->to_proc->pid : 0;
+	to_thread = t->to_thread ? t->to_thread->pid : 0;
+	spin_unlock(&t->lock);
+
+	trace_binder_txn_latency_free(t, from_proc, from_thread,
+				      to_proc, to_thread);
+}
+
 static void binder_free_transaction(struct binder_transaction *t)
 {
 	struct binder_proc *target_proc = t->to_proc;
 
+	binder_txn_latency_free(t);
 	if (target_proc) {
 		binder_inner_proc_lock(target_proc);
 		target_proc->outstanding_txns--;
@@ -2564,13 +2625,18 @@ binder_find_outdated_transaction_ilocked(struct binder_transaction *t,
  * If the @thread parameter is not NULL, the transaction is always queued
  * to the waitlist of that specific thread.
  *
+ * If @defer_wakeup is set, the transaction is queued without selecting or
+ * waking up a thread; the caller is responsible for waking up @proc once
+ * it is done queueing (see binder_transaction_batch()).
+ *
  * Return:	0 if the transaction was successfully queued
  *		BR_DEAD_REPLY if the target process or thread is dead
  *		BR_FROZEN_REPLY if the target process or thread is frozen
  */
 static int binder_proc_transaction(struct binder_transaction *t,
 				    struct binder_proc *proc,
-				    struct binder_thread *thread)
+				    struct binder_thread *thread,
+				    bool defer_wakeup)
 {
 	struct binder_node *node = t->buffer->target_node;
 	struct binder_priority node_prio;
@@ -2608,8 +2674,8 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	trace_android_vh_binder_proc_transaction_entry(proc, t,
 		&thread, node->debug_id, pending_async, !oneway, &skip);
 
-	if (!thread && !pending_async && !skip)
-		thread = binder_select_thread_ilocked(proc);
+	if (!thread && !pending_async && !skip && !defer_wakeup)
+		thread = binder_select_thread_ilocked(proc, &t->priority);
 
 	trace_android_vh_binder_proc_transaction(current, proc->tsk,
 		thread ? thread->task : 0, node->debug_id, t->code, pending_async);
@@ -2638,7 +2704,7 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	trace_android_vh_binder_proc_transaction_end(current, proc->tsk,
 		thread ? thread->task : NULL, t->code, pending_async, !oneway);
 
-	if (!pending_async)
+	if (!pending_async && !defer_wakeup)
 		binder_wakeup_thread_ilocked(proc, thread, !oneway /* sync */);
 
 	proc->outstanding_txns++;
@@ -2706,10 +2772,20 @@ static struct binder_node *binder_get_node_refs_for_txn(
 	return target_node;
 }
 
+/**
+ * struct binder_txn_batch - state of an in-progress BC_TRANSACTION_BATCH
+ * @target_proc:	process the batch is queued to, with a tmpref held
+ *			once the first transaction has been queued
+ */
+struct binder_txn_batch {
+	struct binder_proc *target_proc;
+};
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
 			       struct binder_transaction_data *tr, int reply,
-			       binder_size_t extra_buffers_size)
+			       binder_size_t extra_buffers_size,
+			       struct binder_txn_batch *batch)
 {
 	int ret;
 	struct binder_transaction *t;
@@ -2976,6 +3052,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
+	trace_binder_txn_latency_alloc(t);
 	if (!(t->flags & TF_ONE_WAY) &&
 	    binder_supported_policy(current->policy)) {
 		/* Inherit supported policies for synchronous transactions */
@@ -3323,6 +3400,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->work.type = BINDER_WORK_TRANSACTION;
 
 	if (reply) {
+		trace_binder_txn_latency_reply(t, in_reply_to);
 		binder_enqueue_thread_work(thread, tcomplete);
 		binder_inner_proc_lock(target_proc);
 		if (target_thread->is_dead) {
@@ -3355,7 +3433,7 @@ static void binder_transaction(struct binder_proc *proc,
 		thread->transaction_stack = t;
 		binder_inner_proc_unlock(proc);
 		return_error = binder_proc_transaction(t,
-				target_proc, target_thread);
+				target_proc, target_thread, false);
 		if (return_error) {
 			binder_inner_proc_lock(proc);
 			binder_pop_transaction_ilocked(thread, t);
@@ -3366,9 +3444,16 @@ static void binder_transaction(struct binder_proc *proc,
 		BUG_ON(target_node == NULL);
 		BUG_ON(t->buffer->async_transaction != 1);
 		binder_enqueue_thread_work(thread, tcomplete);
-		return_error = binder_proc_transaction(t, target_proc, NULL);
+		return_error = binder_proc_transaction(t, target_proc, NULL,
+						       batch != NULL);
 		if (return_error)
 			goto err_dead_proc_or_thread;
+		if (batch && !batch->target_proc) {
+			binder_inner_proc_lock(target_proc);
+			target_proc->tmp_ref++;
+			binder_inner_proc_unlock(target_proc);
+			batch->target_proc = target_proc;
+		}
 	}
 	if (target_thread)
 		binder_thread_dec_tmpref(target_thread);
@@ -3461,6 +3546,68 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 }
 
+/* upper bound of transactions a single BC_TRANSACTION_BATCH may carry */
+#define BINDER_TXN_BATCH_MAX	64
+
+/**
+ * binder_transaction_batch() - queue a burst of oneway transactions
+ * @proc:	sending process
+ * @thread:	sending thread
+ * @b:		user array of transactions, all oneway and to the same handle
+ *
+ * Each entry goes through binder_transaction() as a BC_TRANSACTION would,
+ * and still produces its own BR_TRANSACTION_COMPLETE, but the target is
+ * only woken up once, after the whole burst has been queued; all entries
+ * but the first one end up on the node's async_todo list anyway.
+ * Processing stops at the first transaction that fails, which is reported
+ * through @thread->return_error as usual.
+ *
+ * Return:	0 on success, or -EFAULT/-EINVAL for a malformed batch
+ */
+static int binder_transaction_batch(struct binder_proc *proc,
+				    struct binder_thread *thread,
+				    struct binder_transaction_batch *b)
+{
+	struct binder_transaction_data __user *utr =
+		(void __user *)(uintptr_t)b->txns;
+	struct binder_txn_batch batch = { NULL };
+	struct binder_transaction_data tr;
+	binder_size_t i;
+	u32 handle = 0;
+	int ret = 0;
+
+	if (!b->count || b->count > BINDER_TXN_BATCH_MAX) {
+		binder_user_error("%d:%d BC_TRANSACTION_BATCH with bad count %llu\n",
+				  proc->pid, thread->pid, (u64)b->count);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < b->count && thread->return_error.cmd == BR_OK; i++) {
+		if (copy_from_user(&tr, &utr[i], sizeof(tr))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (!(tr.flags & TF_ONE_WAY) ||
+		    (i && tr.target.handle != handle)) {
+			binder_user_error("%d:%d BC_TRANSACTION_BATCH entry %llu is not a oneway call to handle %u\n",
+					  proc->pid, thread->pid, (u64)i,
+					  handle);
+			ret = -EINVAL;
+			break;
+		}
+		handle = tr.target.handle;
+		binder_transaction(proc, thread, &tr, 0, 0, &batch);
+	}
+
+	if (batch.target_proc) {
+		binder_inner_proc_lock(batch.target_proc);
+		binder_wakeup_proc_ilocked(batch.target_proc);
+		binder_inner_proc_unlock(batch.target_proc);
+		binder_proc_dec_tmpref(batch.target_proc);
+	}
+	return ret;
+}
+
 /**
  * binder_free_buf() - free the specified buffer
  * @proc:	binder proc that owns buffer
@@ -3709,7 +3856,8 @@ static int binder_thread_write(struct binder_proc *proc,
 				return -EFAULT;
 			ptr += sizeof(tr);
 			binder_transaction(proc, thread, &tr.transaction_data,
-					   cmd == BC_REPLY_SG, tr.buffers_size);
+					   cmd == BC_REPLY_SG, tr.buffers_size,
+					   NULL);
 			break;
 		}
 		case BC_TRANSACTION:
@@ -3720,7 +3868,18 @@ static int binder_thread_write(struct binder_proc *proc,
 				return -EFAULT;
 			ptr += sizeof(tr);
 			binder_transaction(proc, thread, &tr,
-					   cmd == BC_REPLY, 0);
+					   cmd == BC_REPLY, 0, NULL);
+			break;
+		}
+		case BC_TRANSACTION_BATCH: {
+			struct binder_transaction_batch batch;
+
+			if (copy_from_user(&batch, ptr, sizeof(batch)))
+				return -EFAULT;
+			ptr += sizeof(batch);
+			ret = binder_transaction_batch(proc, thread, &batch);
+			if (ret)
+				return ret;
 			break;
 		}
 
@@ -5687,6 +5846,7 @@ static void print_binder_transaction_ilocked(struct seq_file *m,
 		   t->to_thread ? t->to_thread->pid : 0,
 		   t->code, t->flags, t->priority.sched_policy,
 		   t->priority.prio, t->need_reply);
+	trace_binder_txn_latency_info(m, t);
 	spin_unlock(&t->lock);
 
 	if (proc != to_proc) {
@@ -5946,6 +6106,7 @@ static const char * const binder_command_strings[] = {
 	"BC_DEAD_BINDER_DONE",
 	"BC_TRANSACTION_SG",
 	"BC_REPLY_SG",
+	"BC_TRANSACTION_BATCH",
 };
 
 static const char * const binder_objstat_strings[] = {
@@ -6351,5 +6512,9 @@ device_initcall(binder_init);
 #define CREATE_TRACE_POINTS
 #include "binder_trace.h"
 EXPORT_TRACEPOINT_SYMBOL_GPL(binder_transaction_received);
+EXPORT_TRACEPOINT_SYMBOL_GPL(binder_txn_latency_free);
+EXPORT_TRACEPOINT_SYMBOL_GPL(binder_txn_latency_alloc);
+EXPORT_TRACEPOINT_SYMBOL_GPL(binder_txn_latency_reply);
+EXPORT_TRACEPOINT_SYMBOL_GPL(binder_txn_latency_info);
 
 MODULE_LICENSE("GPL v2");
@@ -42,6 +42,22 @@ static uint32_t binder_alloc_debug_mask = BINDER_DEBUG_USER_ERROR;
 module_param_named(debug_mask, binder_alloc_debug_mask,
 		   uint, 0644);
 
+/*
+ * Pages below this offset (in pages) of each proc's buffer space are not
+ * handed to the shrinker once populated, so the buffers small transactions
+ * keep reusing at the bottom of the space never have to be faulted in again.
+ */
+static uint32_t binder_alloc_keep_resident_pages;
+
+module_param_named(keep_resident_pages, binder_alloc_keep_resident_pages,
+		   uint, 0444);
+
+/* number of pages allocated and mapped into userspace at once */
+#define BINDER_ALLOC_INSERT_BATCH	16
+
+/* entries looked at in a size class before moving on to a larger one */
+#define BINDER_ALLOC_FREE_CLASS_SCAN	8
+
 #define binder_alloc_debug(mask, x...) \
 	do { \
 		if (binder_alloc_debug_mask & mask) \
@@ -66,6 +82,17 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return binder_buffer_next(buffer)->user_data - buffer->user_data;
 }
 
+static int binder_alloc_free_class(size_t size)
+{
+	unsigned int order = order_base_2(size);
+
+	if (order >= BINDER_ALLOC_FREE_CLASS_SHIFT + BINDER_ALLOC_FREE_CLASSES)
+		return -1;
+	if (order <= BINDER_ALLOC_FREE_CLASS_SHIFT)
+		return 0;
+	return order - BINDER_ALLOC_FREE_CLASS_SHIFT;
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -74,6 +101,7 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	struct binder_buffer *buffer;
 	size_t buffer_size;
 	size_t new_buffer_size;
+	int class;
 
 	BUG_ON(!new_buffer->free);
 
@@ -83,6 +111,13 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 		     "%d: add free buffer, size %zd, at %pK\n",
 		      alloc->pid, new_buffer_size, new_buffer);
 
+	class = binder_alloc_free_class(new_buffer_size);
+	if (class >= 0) {
+		list_add(&new_buffer->free_entry, &alloc->free_classes[class]);
+		__set_bit(class, &alloc->free_class_mask);
+		return;
+	}
+
 	while (*p) {
 		parent = *p;
 		buffer = rb_entry(parent, struct binder_buffer, rb_node);
@@ -99,6 +134,113 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	rb_insert_color(&new_buffer->rb_node, &alloc->free_buffers);
 }
 
+/*
+ * Must be called before the buffer's neighbours change, since its size
+ * decides which free index it is on.
+ */
+static void binder_erase_free_buffer(struct binder_alloc *alloc,
+				     struct binder_buffer *buffer)
+{
+	int class;
+
+	BUG_ON(!buffer->free);
+
+	class = binder_alloc_free_class(binder_alloc_buffer_size(alloc, buffer));
+	if (class < 0) {
+		rb_erase(&buffer->rb_node, &alloc->free_buffers);
+		return;
+	}
+	list_del(&buffer->free_entry);
+	if (list_empty(&alloc->free_classes[class]))
+		__clear_bit(class, &alloc->free_class_mask);
+}
+
+static struct binder_buffer *binder_scan_free_class(struct binder_alloc *alloc,
+						    int class, size_t size,
+						    unsigned int limit,
+						    size_t *buffer_size)
+{
+	struct binder_buffer *buffer;
+
+	list_for_each_entry(buffer, &alloc->free_classes[class], free_entry) {
+		BUG_ON(!buffer->free);
+		*buffer_size = binder_alloc_buffer_size(alloc, buffer);
+		if (*buffer_size >= size)
+			return buffer;
+		if (!--limit)
+			break;
+	}
+	return NULL;
+}
+
+/*
+ * Look for a free buffer of at least @size bytes: a bounded first fit in
+ * the size class of @size, then the head of the next non-empty class
+ * (whose buffers are all big enough), then best fit in the rb tree of
+ * large buffers. Only if all that fails is the whole class searched.
+ */
+static struct binder_buffer *binder_find_free_buffer(struct binder_alloc *alloc,
+						     size_t size,
+						     size_t *buffer_size)
+{
+	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct binder_buffer *buffer;
+	struct rb_node *best_fit = NULL;
+	int class = binder_alloc_free_class(size);
+
+	if (class >= 0) {
+		buffer = binder_scan_free_class(alloc, class, size,
+						BINDER_ALLOC_FREE_CLASS_SCAN,
+						buffer_size);
+		if (buffer)
+			return buffer;
+
+		if (class + 1 < BINDER_ALLOC_FREE_CLASSES) {
+			int next = find_next_bit(&alloc->free_class_mask,
+						 BINDER_ALLOC_FREE_CLASSES,
+						 class + 1);
+
+			if (next < BINDER_ALLOC_FREE_CLASSES) {
+				buffer = list_first_entry(
+						&alloc->free_classes[next],
+						struct binder_buffer,
+						free_entry);
+				*buffer_size = binder_alloc_buffer_size(alloc,
+									buffer);
+				return buffer;
+			}
+		}
+		/* every buffer in the rb tree is large enough */
+		n = rb_first(&alloc->free_buffers);
+		if (n) {
+			buffer = rb_entry(n, struct binder_buffer, rb_node);
+			*buffer_size = binder_alloc_buffer_size(alloc, buffer);
+			return buffer;
+		}
+		return binder_scan_free_class(alloc, class, size, UINT_MAX,
+					      buffer_size);
+	}
+
+	while (n) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(!buffer->free);
+		*buffer_size = binder_alloc_buffer_size(alloc, buffer);
+
+		if (size < *buffer_size) {
+			best_fit = n;
+			n = n->rb_left;
+		} else if (size > *buffer_size)
+			n = n->rb_right;
+		else
+			return buffer;
+	}
+	if (best_fit == NULL)
+		return NULL;
+	buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
+	*buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	return buffer;
+}
+
 static void binder_insert_allocated_buffer_locked(
 		struct binder_alloc *alloc, struct binder_buffer *new_buffer)
 {
@@ -179,11 +321,77 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+static bool binder_alloc_page_resident(size_t index)
+{
+	return index < binder_alloc_keep_resident_pages;
+}
+
+/* hand the populated pages in [@start, @end) back to the shrinker */
+static void binder_lru_add_page_range(struct binder_alloc *alloc,
+				      void __user *start, void __user *end)
+{
+	void __user *page_addr;
+	struct binder_lru_page *page;
+
+	for (page_addr = end; page_addr > start; ) {
+		bool ret;
+		size_t index;
+
+		page_addr -= PAGE_SIZE;
+		index = (page_addr - alloc->buffer) / PAGE_SIZE;
+		page = &alloc->pages[index];
+
+		if (binder_alloc_page_resident(index))
+			continue;
+
+		trace_binder_free_lru_start(alloc, index);
+
+		ret = list_lru_add(&binder_alloc_lru, &page->lru);
+		WARN_ON(!ret);
+
+		trace_binder_free_lru_end(alloc, index);
+	}
+}
+
+/*
+ * Map the *@nr freshly allocated pages starting at *@addr into userspace
+ * in one go. On failure, *@addr and *@nr are left describing the pages
+ * that did not get mapped.
+ */
+static int binder_insert_page_batch(struct binder_alloc *alloc,
+				    struct vm_area_struct *vma,
+				    void __user **addr, struct page **pages,
+				    unsigned long *nr)
+{
+	unsigned long user_page_addr = (uintptr_t)*addr;
+	unsigned long count = *nr;
+	size_t index = (*addr - alloc->buffer) / PAGE_SIZE;
+	unsigned long i;
+	int ret;
+
+	ret = vm_insert_pages(vma, user_page_addr, pages, nr);
+	if (ret) {
+		pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
+		       alloc->pid,
+		       user_page_addr + (count - *nr) * PAGE_SIZE);
+		*addr += (count - *nr) * PAGE_SIZE;
+		return ret;
+	}
+
+	for (i = 0; i < count; i++)
+		trace_binder_alloc_page_end(alloc, index + i);
+	if (index + count > alloc->pages_high)
+		alloc->pages_high = index + count;
+	return 0;
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void __user *start, void __user *end)
 {
+	struct page *batch[BINDER_ALLOC_INSERT_BATCH];
+	void __user *batch_addr = NULL;
+	unsigned long nr_batch = 0;
 	void __user *page_addr;
-	unsigned long user_page_addr;
 	struct binder_lru_page *page;
 	struct vm_area_struct *vma = NULL;
 	struct mm_struct *mm = NULL;
@@ -198,8 +406,10 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 	trace_binder_update_page_range(alloc, allocate, start, end);
 
-	if (allocate == 0)
-		goto free_range;
+	if (allocate == 0) {
+		binder_lru_add_page_range(alloc, start, end);
+		return 0;
+	}
 
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
@@ -224,8 +434,13 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		goto err_no_vma;
 	}
 
+	/*
+	 * Missing pages are allocated first and then mapped in runs of
+	 * contiguous addresses, so their page table entries are filled in
+	 * under a single page table lock instead of one fault-like insertion
+	 * per page.
+	 */
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
-		int ret;
 		bool on_lru;
 		size_t index;
 
@@ -233,17 +448,21 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		page = &alloc->pages[index];
 
 		if (page->page_ptr) {
+			if (nr_batch && binder_insert_page_batch(alloc, vma,
+					&batch_addr, batch, &nr_batch))
+				goto err_page_unmapped;
+
 			trace_binder_alloc_lru_start(alloc, index);
 
 			on_lru = list_lru_del(&binder_alloc_lru, &page->lru);
-			WARN_ON(!on_lru);
+			WARN_ON(!on_lru && !binder_alloc_page_resident(index));
 
 			trace_binder_alloc_lru_end(alloc, index);
 			continue;
 		}
 
 		if (WARN_ON(!vma))
-			goto err_page_ptr_cleared;
+			goto err_page_unmapped;
 
 		trace_binder_alloc_page_start(alloc, index);
 		page->page_ptr = alloc_page(GFP_KERNEL |
@@ -252,56 +471,43 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		if (!page->page_ptr) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				alloc->pid, page_addr);
-			goto err_alloc_page_failed;
+			goto err_page_unmapped;
 		}
 		page->alloc = alloc;
 		INIT_LIST_HEAD(&page->lru);
 
-		user_page_addr = (uintptr_t)page_addr;
-		ret = vm_insert_page(vma, user_page_addr, page[0].page_ptr);
-		if (ret) {
-			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
-			       alloc->pid, user_page_addr);
-			goto err_vm_insert_page_failed;
-		}
-
-		if (index + 1 > alloc->pages_high)
-			alloc->pages_high = index + 1;
-
-		trace_binder_alloc_page_end(alloc, index);
+		if (!nr_batch)
+			batch_addr = page_addr;
+		batch[nr_batch++] = page->page_ptr;
+		if (nr_batch == BINDER_ALLOC_INSERT_BATCH &&
+		    binder_insert_page_batch(alloc, vma, &batch_addr, batch,
+					     &nr_batch))
+			goto err_page_unmapped;
 	}
+	if (nr_batch &&
+	    binder_insert_page_batch(alloc, vma, &batch_addr, batch, &nr_batch))
+		goto err_page_unmapped;
+
 	if (mm) {
 		mmap_read_unlock(mm);
 		mmput(mm);
 	}
 	return 0;
 
-free_range:
-	for (page_addr = end - PAGE_SIZE; 1; page_addr -= PAGE_SIZE) {
-		bool ret;
-		size_t index;
-
-		index = (page_addr - alloc->buffer) / PAGE_SIZE;
-		page = &alloc->pages[index];
-
-		trace_binder_free_lru_start(alloc, index);
-
-		ret = list_lru_add(&binder_alloc_lru, &page->lru);
-		WARN_ON(!ret);
-
-		trace_binder_free_lru_end(alloc, index);
-		if (page_addr == start)
-			break;
-		continue;
-
-err_vm_insert_page_failed:
-		__free_page(page->page_ptr);
-		page->page_ptr = NULL;
-err_alloc_page_failed:
-err_page_ptr_cleared:
-		if (page_addr == start)
-			break;
+err_page_unmapped:
+	/* pages allocated for the pending batch never made it to userspace */
+	if (nr_batch) {
+		for (page_addr = batch_addr;
+		     page_addr < batch_addr + nr_batch * PAGE_SIZE;
+		     page_addr += PAGE_SIZE) {
+			page = &alloc->pages[(page_addr - alloc->buffer) /
+					     PAGE_SIZE];
+			__free_page(page->page_ptr);
+			page->page_ptr = NULL;
+		}
+		page_addr = batch_addr;
 	}
+	binder_lru_add_page_range(alloc, start, page_addr);
 err_no_vma:
 	if (mm) {
 		mmap_read_unlock(mm);
@@ -390,10 +596,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				int is_async,
 				int pid)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
-	struct rb_node *best_fit = NULL;
 	void __user *has_page_addr;
 	void __user *end_page_addr;
 	size_t size, data_offsets_size;
@@ -434,28 +638,16 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
-	while (n) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		BUG_ON(!buffer->free);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-
-		if (size < buffer_size) {
-			best_fit = n;
-			n = n->rb_left;
-		} else if (size > buffer_size)
-			n = n->rb_right;
-		else {
-			best_fit = n;
-			break;
-		}
-	}
-	if (best_fit == NULL) {
+	buffer = binder_find_free_buffer(alloc, size, &buffer_size);
+	if (buffer == NULL) {
+		struct rb_node *n;
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
 		size_t total_alloc_size = 0;
 		size_t free_buffers = 0;
 		size_t largest_free_size = 0;
 		size_t total_free_size = 0;
+		int class;
 
 		for (n = rb_first(&alloc->allocated_buffers); n != NULL;
 		     n = rb_next(n)) {
@@ -475,6 +667,17 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			if (buffer_size > largest_free_size)
 				largest_free_size = buffer_size;
 		}
+		for (class = 0; class < BINDER_ALLOC_FREE_CLASSES; class++) {
+			list_for_each_entry(buffer, &alloc->free_classes[class],
+					    free_entry) {
+				buffer_size = binder_alloc_buffer_size(alloc,
+								       buffer);
+				free_buffers++;
+				total_free_size += buffer_size;
+				if (buffer_size > largest_free_size)
+					largest_free_size = buffer_size;
+			}
+		}
 		binder_alloc_debug(BINDER_DEBUG_USER_ERROR,
 				   "%d: binder_alloc_buf size %zd failed, no address space\n",
 				   alloc->pid, size);
@@ -485,10 +688,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				   free_buffers, largest_free_size);
 		return ERR_PTR(-ENOSPC);
 	}
-	if (n == NULL) {
-		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-	}
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
@@ -496,7 +695,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	has_page_addr = (void __user *)
 		(((uintptr_t)buffer->user_data + buffer_size) & PAGE_MASK);
-	WARN_ON(n && buffer_size != size);
 	end_page_addr =
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data + size);
 	if (end_page_addr > has_page_addr)
@@ -506,6 +704,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	if (ret)
 		return ERR_PTR(ret);
 
+	binder_erase_free_buffer(alloc, buffer);
 	if (buffer_size != size) {
 		struct binder_buffer *new_buffer;
 
@@ -521,7 +720,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		binder_insert_free_buffer(alloc, new_buffer);
 	}
 
-	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
@@ -553,6 +751,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	return buffer;
 
 err_alloc_buf_struct_failed:
+	binder_insert_free_buffer(alloc, buffer);
 	binder_update_page_range(alloc, 0, (void __user *)
 				 PAGE_ALIGN((uintptr_t)buffer->user_data),
 				 end_page_addr);
@@ -691,7 +890,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *next = binder_buffer_next(buffer);
 
 		if (next->free) {
-			rb_erase(&next->rb_node, &alloc->free_buffers);
+			binder_erase_free_buffer(alloc, next);
 			binder_delete_free_buffer(alloc, next);
 		}
 	}
@@ -699,8 +898,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *prev = binder_buffer_prev(buffer);
 
 		if (prev->free) {
+			binder_erase_free_buffer(alloc, prev);
 			binder_delete_free_buffer(alloc, buffer);
-			rb_erase(&prev->rb_node, &alloc->free_buffers);
 			buffer = prev;
 		}
 	}
@@ -1080,9 +1279,13 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int class;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (class = 0; class < BINDER_ALLOC_FREE_CLASSES; class++)
+		INIT_LIST_HEAD(&alloc->free_classes[class]);
 }
 
 int binder_alloc_shrinker_init(void)
@@ -22,6 +22,8 @@ struct binder_transaction;
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @free_entry:         entry in one of alloc->free_classes (small free
+ *                      buffers only, shares storage with @rb_node)
  * @free:               %true if buffer is free
  * @clear_on_free:      %true if buffer must be zeroed after use
  * @allow_user_free:    %true if user is allowed to free buffer
@@ -41,8 +43,11 @@ struct binder_transaction;
  */
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head free_entry; /* small free entry by size */
+	};
 	unsigned free:1;
 	unsigned clear_on_free:1;
 	unsigned allow_user_free:1;
@@ -60,6 +65,15 @@ struct binder_buffer {
 	int    pid;
 };
 
+/*
+ * Free buffers of up to (1 << (BINDER_ALLOC_FREE_CLASS_SHIFT +
+ * BINDER_ALLOC_FREE_CLASSES - 1)) bytes are kept on per-size-class lists
+ * rather than in the free_buffers rb tree: class 0 holds buffers of up to
+ * 64 bytes, class n buffers of (32 << n, 64 << n] bytes.
+ */
+#define BINDER_ALLOC_FREE_CLASS_SHIFT	6
+#define BINDER_ALLOC_FREE_CLASSES	7
+
 /**
  * struct binder_lru_page - page object used for binder shrinker
  * @page_ptr: pointer to physical page in mmap'd space
@@ -82,7 +96,10 @@ struct binder_lru_page {
  * @buffer:             base of per-proc address space mapped via mmap
  * @buffers:            list of all buffers for this proc
  * @free_buffers:       rb tree of buffers available for allocation
- *                      sorted by size
+ *                      sorted by size (larger than the biggest size class)
+ * @free_classes:       lists of small free buffers, segregated by
+ *                      power-of-two size class, most recently freed first
+ * @free_class_mask:    bitmap of non-empty @free_classes
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
@@ -105,6 +122,8 @@ struct binder_alloc {
 	void __user *buffer;
 	struct list_head buffers;
 	struct rb_root free_buffers;
+	struct list_head free_classes[BINDER_ALLOC_FREE_CLASSES];
+	unsigned long free_class_mask;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 	struct binder_lru_page *pages;
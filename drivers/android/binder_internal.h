@@ -10,6 +10,8 @@
 #include <linux/mutex.h>
 #include <linux/refcount.h>
 #include <linux/stddef.h>
+#include <linux/time64.h>
+#include <linux/ktime.h>
 #include <linux/types.h>
 #include <linux/uidgid.h>
 #include <uapi/linux/android/binderfs.h>
@@ -134,7 +136,7 @@ enum binder_stat_types {
 
 struct binder_stats {
 	atomic_t br[_IOC_NR(BR_ONEWAY_SPAM_SUSPECT) + 1];
-	atomic_t bc[_IOC_NR(BC_REPLY_SG) + 1];
+	atomic_t bc[_IOC_NR(BC_TRANSACTION_BATCH) + 1];
 	atomic_t obj_created[BINDER_STAT_COUNT];
 	atomic_t obj_deleted[BINDER_STAT_COUNT];
 };
@@ -574,6 +576,14 @@ struct binder_transaction {
 	 * during thread teardown
 	 */
 	spinlock_t lock;
+#if IS_ENABLED(CONFIG_BINDER_TRANSACTION_LATENCY_TRACKING)
+	struct timespec64 timestamp;
+	struct __kernel_old_timeval tv;
+	/* owned by binder_latency_tracer, see there */
+	ktime_t received;
+	int hist_pid;
+	unsigned int hist_code;
+#endif
 	ANDROID_VENDOR_DATA(1);
 	ANDROID_OEM_DATA_ARRAY(1, 2);
 };
@@ -4,6 +4,11 @@
  */
 
 #include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/jhash.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
 #include <uapi/linux/android/binder.h>
 #include "binder_internal.h"
 #include "binder_trace.h"
@@ -18,6 +23,101 @@ static uint32_t binder_txn_latency_threshold = 2;
 module_param_named(threshold, binder_txn_latency_threshold,
 			uint, 0644);
 
+/*
+ * Always-on latency histograms, one per (target process, code) pair.
+ *
+ * Each transaction's life is split into three phases:
+ *   queue:  from binder_transaction() until a target thread picks it up
+ *   handle: from then until the target sends its reply
+ *   reply:  from the reply being sent until the caller picks it up
+ * Oneway transactions only ever record the queue phase.
+ *
+ * Bucket n counts latencies in [2^(n-1), 2^n) usecs (bucket 0 is < 1us,
+ * the last bucket takes everything above). Histograms are kept per CPU,
+ * only ever updated from that CPU, and merged when read through
+ * <debugfs>/binder_latency/histograms.
+ */
+enum {
+	BINDER_LAT_QUEUE,
+	BINDER_LAT_HANDLE,
+	BINDER_LAT_REPLY,
+	BINDER_LAT_NR_PHASES,
+};
+
+static const char * const binder_lat_phase_names[] = {
+	"queue", "handle", "reply",
+};
+
+#define BINDER_LAT_BUCKETS	24
+#define BINDER_LAT_HASH_BITS	8
+#define BINDER_LAT_HASH_SIZE	(1U << BINDER_LAT_HASH_BITS)
+#define BINDER_LAT_PROBE_MAX	8
+/* merged table on read, sized for a good share of distinct keys */
+#define BINDER_LAT_MERGE_BITS	12
+
+struct binder_lat_hist {
+	int pid;		/* 0 if the slot is unused */
+	unsigned int code;
+	u32 count[BINDER_LAT_NR_PHASES][BINDER_LAT_BUCKETS];
+};
+
+struct binder_lat_table {
+	unsigned long dropped;	/* samples that found no free slot */
+	struct binder_lat_hist hist[];
+};
+
+static DEFINE_PER_CPU(struct binder_lat_table *, binder_lat_tables);
+static struct dentry *binder_lat_debugfs_dir;
+
+static struct binder_lat_hist *binder_lat_lookup(struct binder_lat_table *tbl,
+						 unsigned int bits,
+						 int pid, unsigned int code)
+{
+	unsigned int mask = (1U << bits) - 1;
+	unsigned int idx = jhash_2words(pid, code, 0) & mask;
+	unsigned int i;
+
+	for (i = 0; i < BINDER_LAT_PROBE_MAX; i++, idx = (idx + 1) & mask) {
+		struct binder_lat_hist *h = &tbl->hist[idx];
+		int slot_pid = smp_load_acquire(&h->pid);
+
+		if (slot_pid == pid && h->code == code)
+			return h;
+		if (slot_pid)
+			continue;
+		h->code = code;
+		/* publish the key only once it is complete */
+		smp_store_release(&h->pid, pid);
+		return h;
+	}
+	return NULL;
+}
+
+static void binder_lat_record(int pid, unsigned int code,
+			      unsigned int phase, ktime_t delta)
+{
+	struct binder_lat_table *tbl;
+	struct binder_lat_hist *h;
+	s64 us = ktime_to_us(delta);
+	unsigned int bucket;
+
+	if (!pid)
+		return;
+
+	bucket = us > 0 ? fls64(us) : 0;
+	if (bucket >= BINDER_LAT_BUCKETS)
+		bucket = BINDER_LAT_BUCKETS - 1;
+
+	/* tracepoint probes run with preemption disabled */
+	tbl = __this_cpu_read(binder_lat_tables);
+	h = binder_lat_lookup(tbl, BINDER_LAT_HASH_BITS, pid, code);
+	if (!h) {
+		tbl->dropped++;
+		return;
+	}
+	h->count[phase][bucket]++;
+}
+
 /*
  * probe_binder_txn_latency_free - Output info of a delay transaction
  * @t:          pointer to the over-time transaction
@@ -67,6 +167,43 @@ static void probe_binder_txn_latency_alloc(void *ignore,
 	t->tv.tv_sec = now.tv_sec;
 	t->tv.tv_sec -= (sys_tz.tz_minuteswest * 60);
 	t->tv.tv_usec = now.tv_nsec/1000;
+
+	t->received = 0;
+	t->hist_pid = t->to_proc ? t->to_proc->pid : 0;
+	t->hist_code = t->code;
+}
+
+/*
+ * Replies are accounted to the transaction they answer; @t was stamped by
+ * probe_binder_txn_latency_alloc() just before.
+ */
+static void probe_binder_txn_latency_reply(void *ignore,
+					struct binder_transaction *t,
+					struct binder_transaction *in_reply_to)
+{
+	t->hist_pid = in_reply_to->hist_pid;
+	t->hist_code = in_reply_to->hist_code;
+	if (in_reply_to->received)
+		binder_lat_record(t->hist_pid, t->hist_code, BINDER_LAT_HANDLE,
+				  ktime_sub(timespec64_to_ktime(t->timestamp),
+					    in_reply_to->received));
+}
+
+static void probe_binder_transaction_received(void *ignore,
+					struct binder_transaction *t)
+{
+	ktime_t now = ktime_get();
+	unsigned int phase;
+
+	/* only replies are delivered without a target node */
+	if (t->buffer->target_node) {
+		t->received = now;
+		phase = BINDER_LAT_QUEUE;
+	} else {
+		phase = BINDER_LAT_REPLY;
+	}
+	binder_lat_record(t->hist_pid, t->hist_code, phase,
+			  ktime_sub(now, timespec64_to_ktime(t->timestamp)));
 }
 
 static void probe_binder_txn_latency_info(void *ignore, struct seq_file *m,
@@ -84,26 +221,134 @@ static void probe_binder_txn_latency_info(void *ignore, struct seq_file *m,
 		   (unsigned long)(t->tv.tv_usec / USEC_PER_MSEC));
 }
 
+static int binder_lat_histograms_show(struct seq_file *m, void *unused)
+{
+	struct binder_lat_table *merged;
+	unsigned long dropped = 0;
+	unsigned int i, p, b;
+	int cpu;
+
+	merged = vzalloc(struct_size(merged, hist,
+				     1U << BINDER_LAT_MERGE_BITS));
+	if (!merged)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct binder_lat_table *tbl = per_cpu(binder_lat_tables, cpu);
+
+		dropped += READ_ONCE(tbl->dropped);
+		for (i = 0; i < BINDER_LAT_HASH_SIZE; i++) {
+			struct binder_lat_hist *h = &tbl->hist[i];
+			struct binder_lat_hist *sum;
+			int pid = smp_load_acquire(&h->pid);
+
+			if (!pid)
+				continue;
+			sum = binder_lat_lookup(merged, BINDER_LAT_MERGE_BITS,
+						pid, h->code);
+			if (!sum) {
+				dropped++;
+				continue;
+			}
+			for (p = 0; p < BINDER_LAT_NR_PHASES; p++)
+				for (b = 0; b < BINDER_LAT_BUCKETS; b++)
+					sum->count[p][b] +=
+						READ_ONCE(h->count[p][b]);
+		}
+	}
+
+	seq_puts(m, "# pid code phase: counts per log2(usec) bucket\n");
+	for (i = 0; i < 1U << BINDER_LAT_MERGE_BITS; i++) {
+		struct binder_lat_hist *sum = &merged->hist[i];
+
+		if (!sum->pid)
+			continue;
+		for (p = 0; p < BINDER_LAT_NR_PHASES; p++) {
+			seq_printf(m, "%d %x %s:", sum->pid, sum->code,
+				   binder_lat_phase_names[p]);
+			for (b = 0; b < BINDER_LAT_BUCKETS; b++)
+				seq_printf(m, " %u", sum->count[p][b]);
+			seq_putc(m, '\n');
+		}
+	}
+	seq_printf(m, "dropped %lu\n", dropped);
+
+	vfree(merged);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(binder_lat_histograms);
+
+static void binder_lat_free_tables(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vfree(per_cpu(binder_lat_tables, cpu));
+		per_cpu(binder_lat_tables, cpu) = NULL;
+	}
+}
+
+static int binder_lat_alloc_tables(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct binder_lat_table *tbl;
+
+		tbl = vzalloc_node(struct_size(tbl, hist, BINDER_LAT_HASH_SIZE),
+				   cpu_to_node(cpu));
+		if (!tbl) {
+			binder_lat_free_tables();
+			return -ENOMEM;
+		}
+		per_cpu(binder_lat_tables, cpu) = tbl;
+	}
+	return 0;
+}
+
 static int __init init_binder_latency_tracer(void)
 {
+	int ret;
+
+	ret = binder_lat_alloc_tables();
+	if (ret)
+		return ret;
+
 	register_trace_binder_txn_latency_free(
 			probe_binder_txn_latency_free, NULL);
 	register_trace_binder_txn_latency_alloc(
 			probe_binder_txn_latency_alloc, NULL);
+	register_trace_binder_txn_latency_reply(
+			probe_binder_txn_latency_reply, NULL);
 	register_trace_binder_txn_latency_info(
 			probe_binder_txn_latency_info, NULL);
+	register_trace_binder_transaction_received(
+			probe_binder_transaction_received, NULL);
+
+	binder_lat_debugfs_dir = debugfs_create_dir("binder_latency", NULL);
+	debugfs_create_file("histograms", 0444, binder_lat_debugfs_dir, NULL,
+			    &binder_lat_histograms_fops);
 
 	return 0;
 }
 
 static void exit_binder_latency_tracer(void)
 {
+	debugfs_remove_recursive(binder_lat_debugfs_dir);
+
 	unregister_trace_binder_txn_latency_free(
 			probe_binder_txn_latency_free, NULL);
 	unregister_trace_binder_txn_latency_alloc(
 			probe_binder_txn_latency_alloc, NULL);
+	unregister_trace_binder_txn_latency_reply(
+			probe_binder_txn_latency_reply, NULL);
 	unregister_trace_binder_txn_latency_info(
 			probe_binder_txn_latency_info, NULL);
+	unregister_trace_binder_transaction_received(
+			probe_binder_transaction_received, NULL);
+	tracepoint_synchronize_unregister();
+
+	binder_lat_free_tables();
 }
 
 module_init(init_binder_latency_tracer);
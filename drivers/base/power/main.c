@@ -26,6 +26,7 @@
 #include <linux/pm_wakeirq.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
@@ -281,6 +282,8 @@ static void dpm_wait_for_suppliers(struct device *dev, bool async)
 static bool dpm_wait_for_superior(struct device *dev, bool async)
 {
 	struct device *parent;
+	u64 start = local_clock();
+	bool ret;
 
 	/*
 	 * If the device is resumed asynchronously and the parent's callback
@@ -309,7 +312,9 @@ static bool dpm_wait_for_superior(struct device *dev, bool async)
 	 * If the parent's callback has deleted the device, attempting to resume
 	 * it would be invalid, so avoid doing that then.
 	 */
-	return device_pm_initialized(dev);
+	ret = device_pm_initialized(dev);
+	dev->power.wait_ns += local_clock() - start;
+	return ret;
 }
 
 static void dpm_wait_for_consumers(struct device *dev, bool async)
@@ -337,8 +342,11 @@ static void dpm_wait_for_consumers(struct device *dev, bool async)
 
 static void dpm_wait_for_subordinate(struct device *dev, bool async)
 {
+	u64 start = local_clock();
+
 	dpm_wait_for_children(dev, async);
 	dpm_wait_for_consumers(dev, async);
+	dev->power.wait_ns += local_clock() - start;
 }
 
 /**
@@ -478,6 +486,7 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, const char *info)
 {
 	ktime_t calltime;
+	u64 start, delta;
 	int error;
 
 	if (!cb)
@@ -487,10 +496,18 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
+	start = local_clock();
 	error = cb(dev);
+	delta = local_clock() - start;
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
+	if (state.event & (PM_EVENT_RESUME | PM_EVENT_THAW |
+			   PM_EVENT_RESTORE | PM_EVENT_RECOVER))
+		dev->power.resume_ns += delta;
+	else
+		dev->power.suspend_ns += delta;
+
 	initcall_debug_report(dev, calltime, cb, error);
 
 	return error;
@@ -1088,6 +1105,43 @@ static void device_complete(struct device *dev, pm_message_t state)
 	pm_runtime_put(dev);
 }
 
+static int dpm_has_child_fn(struct device *dev, void *data)
+{
+	return 1;
+}
+
+/**
+ * dpm_promote_async - Switch a slow, independent device to async suspend/resume.
+ * @dev: Device whose transition has just completed.
+ *
+ * Only leaf devices without device link consumers are promoted: the PM core
+ * already orders an async device after its parent and suppliers, and nothing
+ * else is known to wait for it.  Dependencies that are not described to the
+ * driver core cannot be seen here, which is why this is opt-in through
+ * /sys/power/pm_async_promote_us.
+ */
+static void dpm_promote_async(struct device *dev)
+{
+	unsigned int thresh = READ_ONCE(pm_async_promote_us);
+	u64 ns = dev->power.suspend_ns + dev->power.resume_ns;
+
+	if (!thresh || dev->power.async_suspend || dev->power.syscore)
+		return;
+
+	if (ns < (u64)thresh * NSEC_PER_USEC)
+		return;
+
+	if (!list_empty(&dev->links.consumers) ||
+	    device_for_each_child(dev, NULL, dpm_has_child_fn))
+		return;
+
+	device_enable_async_suspend(dev);
+	dev->power.async_promoted = true;
+	dev_info(dev, "promoted to async suspend/resume (%llu usecs, waited %llu usecs)\n",
+		 div_u64(ns, NSEC_PER_USEC),
+		 div_u64(dev->power.wait_ns, NSEC_PER_USEC));
+}
+
 /**
  * dpm_complete - Complete a PM transition for all non-sysdev devices.
  * @state: PM transition of the system being carried out.
@@ -1115,6 +1169,7 @@ void dpm_complete(pm_message_t state)
 		trace_device_pm_callback_start(dev, "", state.event);
 		device_complete(dev, state);
 		trace_device_pm_callback_end(dev, 0);
+		dpm_promote_async(dev);
 
 		mutex_lock(&dpm_list_mtx);
 		put_device(dev);
@@ -1813,6 +1868,10 @@ static int device_prepare(struct device *dev, pm_message_t state)
 	 */
 	pm_runtime_get_noresume(dev);
 
+	dev->power.suspend_ns = 0;
+	dev->power.resume_ns = 0;
+	dev->power.wait_ns = 0;
+
 	if (dev->power.syscore)
 		return 0;
 
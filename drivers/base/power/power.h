@@ -98,6 +98,7 @@ static inline int dpm_sysfs_change_owner(struct device *dev, kuid_t kuid,
 
 /* kernel/power/main.c */
 extern int pm_async_enabled;
+extern unsigned int pm_async_promote_us;
 
 /* drivers/base/power/main.c */
 extern struct list_head dpm_list;	/* The active device list */
@@ -607,6 +607,31 @@ static ssize_t async_store(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR_RW(async);
 
+/* Callback and dependency wait times of the last system transition */
+static ssize_t suspend_time_us_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%llu\n",
+			  div_u64(dev->power.suspend_ns, NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(suspend_time_us);
+
+static ssize_t resume_time_us_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%llu\n",
+			  div_u64(dev->power.resume_ns, NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(resume_time_us);
+
+static ssize_t wait_time_us_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%llu\n",
+			  div_u64(dev->power.wait_ns, NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(wait_time_us);
+
 #endif /* CONFIG_PM_SLEEP */
 #endif /* CONFIG_PM_ADVANCED_DEBUG */
 
@@ -614,6 +639,9 @@ static struct attribute *power_attrs[] = {
 #ifdef CONFIG_PM_ADVANCED_DEBUG
 #ifdef CONFIG_PM_SLEEP
 	&dev_attr_async.attr,
+	&dev_attr_suspend_time_us.attr,
+	&dev_attr_resume_time_us.attr,
+	&dev_attr_wait_time_us.attr,
 #endif
 	&dev_attr_runtime_status.attr,
 	&dev_attr_runtime_usage.attr,
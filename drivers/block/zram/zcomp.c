@@ -11,6 +11,9 @@
 #include <linux/sched.h>
 #include <linux/cpu.h>
 #include <linux/crypto.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <crypto/acompress.h>
 
 #include "zcomp.h"
 
@@ -31,8 +34,137 @@ static const char * const backends[] = {
 #endif
 };
 
+#ifdef CONFIG_ZRAM_ACOMP
+/*
+ * Pages handed to the engine at once, across all CPUs of a device. Each CPU
+ * has at most one page in flight, as zram compresses under the per-CPU
+ * stream; beyond this the engine queue is considered full.
+ */
+#define ZCOMP_ACOMP_MAX_INFLIGHT	8
+/*
+ * Compression runs with preemption disabled, so the engine is polled. Give
+ * up and use software once this passes, e.g. if the driver completes from a
+ * context that can't run on this CPU right now.
+ */
+#define ZCOMP_ACOMP_TIMEOUT_NS		(200 * NSEC_PER_USEC)
+
+static void zcomp_acomp_done(struct crypto_async_request *req, int err)
+{
+	struct zcomp_strm *zstrm = req->data;
+
+	zstrm->aerr = err;
+	atomic_dec(&zstrm->comp->acomp_inflight);
+	smp_store_release(&zstrm->abusy, false);
+}
+
+static void zcomp_acomp_free(struct zcomp_strm *zstrm)
+{
+	if (!zstrm->atfm)
+		return;
+
+	/* the engine may still be writing ->abuffer after a timeout */
+	while (smp_load_acquire(&zstrm->abusy))
+		msleep(1);
+
+	acomp_request_free(zstrm->areq);
+	crypto_free_acomp(zstrm->atfm);
+	free_pages((unsigned long)zstrm->abuffer, 1);
+	zstrm->areq = NULL;
+	zstrm->atfm = NULL;
+	zstrm->abuffer = NULL;
+}
+
+/* failing here just leaves the stream software only */
+static void zcomp_acomp_init(struct zcomp_strm *zstrm, struct zcomp *comp)
+{
+	struct crypto_acomp *atfm;
+
+	/* ask for an async driver; sync ones are the scomp wrapper of ->tfm */
+	atfm = crypto_alloc_acomp(comp->name, CRYPTO_ALG_ASYNC,
+				  CRYPTO_ALG_ASYNC);
+	if (IS_ERR(atfm))
+		return;
+
+	zstrm->atfm = atfm;
+	zstrm->comp = comp;
+	zstrm->abusy = false;
+	zstrm->areq = acomp_request_alloc(atfm);
+	zstrm->abuffer = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
+	if (!zstrm->areq || !zstrm->abuffer) {
+		if (zstrm->areq)
+			acomp_request_free(zstrm->areq);
+		crypto_free_acomp(atfm);
+		free_pages((unsigned long)zstrm->abuffer, 1);
+		zstrm->areq = NULL;
+		zstrm->atfm = NULL;
+		zstrm->abuffer = NULL;
+	}
+}
+
+/* returns -EAGAIN if the page has to be compressed in software instead */
+static int zcomp_acomp_compress(struct zcomp_strm *zstrm,
+		const void *src, unsigned int *dst_len)
+{
+	struct zcomp *comp = zstrm->comp;
+	struct acomp_req *req = zstrm->areq;
+	u64 deadline;
+	int ret;
+
+	if (!zstrm->atfm || smp_load_acquire(&zstrm->abusy))
+		return -EAGAIN;
+
+	if (atomic_inc_return(&comp->acomp_inflight) >
+	    ZCOMP_ACOMP_MAX_INFLIGHT) {
+		atomic_dec(&comp->acomp_inflight);
+		return -EAGAIN;
+	}
+
+	sg_init_one(&zstrm->src_sg, src, PAGE_SIZE);
+	sg_init_one(&zstrm->dst_sg, zstrm->abuffer, PAGE_SIZE * 2);
+	acomp_request_set_params(req, &zstrm->src_sg, &zstrm->dst_sg,
+				 PAGE_SIZE, PAGE_SIZE * 2);
+	/* no MAY_BACKLOG: a full engine queue fails fast with -EBUSY */
+	acomp_request_set_callback(req, 0, zcomp_acomp_done, zstrm);
+
+	zstrm->abusy = true;
+	ret = crypto_acomp_compress(req);
+	if (ret == -EINPROGRESS) {
+		deadline = ktime_get_ns() + ZCOMP_ACOMP_TIMEOUT_NS;
+		while (smp_load_acquire(&zstrm->abusy)) {
+			if (ktime_get_ns() > deadline)
+				return -EAGAIN;
+			cpu_relax();
+		}
+		ret = zstrm->aerr;
+	} else {
+		zstrm->abusy = false;
+		atomic_dec(&comp->acomp_inflight);
+	}
+
+	if (ret)
+		return -EAGAIN;
+
+	swap(zstrm->buffer, zstrm->abuffer);
+	*dst_len = req->dlen;
+	atomic64_inc(&comp->acomp_pages);
+	return 0;
+}
+
+ssize_t zcomp_acomp_stat_show(struct zcomp *comp, char *buf, size_t size)
+{
+	return scnprintf(buf, size, "%8llu %8llu\n",
+			 (u64)atomic64_read(&comp->acomp_pages),
+			 (u64)atomic64_read(&comp->acomp_fallback));
+}
+#else
+static inline void zcomp_acomp_free(struct zcomp_strm *zstrm) {}
+static inline void zcomp_acomp_init(struct zcomp_strm *zstrm,
+				    struct zcomp *comp) {}
+#endif
+
 static void zcomp_strm_free(struct zcomp_strm *zstrm)
 {
+	zcomp_acomp_free(zstrm);
 	if (!IS_ERR_OR_NULL(zstrm->tfm))
 		crypto_free_comp(zstrm->tfm);
 	free_pages((unsigned long)zstrm->buffer, 1);
@@ -56,6 +188,7 @@ static int zcomp_strm_init(struct zcomp_strm *zstrm, struct zcomp *comp)
 		zcomp_strm_free(zstrm);
 		return -ENOMEM;
 	}
+	zcomp_acomp_init(zstrm, comp);
 	return 0;
 }
 
@@ -137,6 +270,15 @@ int zcomp_compress(struct zcomp_strm *zstrm,
 	 */
 	*dst_len = PAGE_SIZE * 2;
 
+#ifdef CONFIG_ZRAM_ACOMP
+	if (zstrm->atfm) {
+		if (!zcomp_acomp_compress(zstrm, src, dst_len))
+			return 0;
+		atomic64_inc(&zstrm->comp->acomp_fallback);
+		*dst_len = PAGE_SIZE * 2;
+	}
+#endif
+
 	return crypto_comp_compress(zstrm->tfm,
 			src, PAGE_SIZE,
 			zstrm->buffer, dst_len);
@@ -6,6 +6,7 @@
 #ifndef _ZCOMP_H_
 #define _ZCOMP_H_
 #include <linux/local_lock.h>
+#include <linux/scatterlist.h>
 
 struct zcomp_strm {
 	/* The members ->buffer and ->tfm are protected by ->lock. */
@@ -13,6 +14,19 @@ struct zcomp_strm {
 	/* compression/decompression buffer */
 	void *buffer;
 	struct crypto_comp *tfm;
+#ifdef CONFIG_ZRAM_ACOMP
+	/* offload engine, only set if the algorithm has an async driver */
+	struct crypto_acomp *atfm;
+	struct acomp_req *areq;
+	struct scatterlist src_sg;
+	struct scatterlist dst_sg;
+	/* engine output, swapped with ->buffer on success */
+	void *abuffer;
+	/* a request is owned by the engine until its callback runs */
+	bool abusy;
+	int aerr;
+	struct zcomp *comp;
+#endif
 };
 
 /* dynamic per-device compression frontend */
@@ -20,6 +34,11 @@ struct zcomp {
 	struct zcomp_strm __percpu *stream;
 	const char *name;
 	struct hlist_node node;
+#ifdef CONFIG_ZRAM_ACOMP
+	atomic_t acomp_inflight;
+	atomic64_t acomp_pages;
+	atomic64_t acomp_fallback;
+#endif
 };
 
 int zcomp_cpu_up_prepare(unsigned int cpu, struct hlist_node *node);
@@ -40,4 +59,14 @@ int zcomp_decompress(struct zcomp_strm *zstrm,
 		const void *src, unsigned int src_len, void *dst);
 
 bool zcomp_set_max_streams(struct zcomp *comp, int num_strm);
+
+#ifdef CONFIG_ZRAM_ACOMP
+ssize_t zcomp_acomp_stat_show(struct zcomp *comp, char *buf, size_t size);
+#else
+static inline ssize_t zcomp_acomp_stat_show(struct zcomp *comp, char *buf,
+					    size_t size)
+{
+	return 0;
+}
+#endif
 #endif /* _ZCOMP_H_ */
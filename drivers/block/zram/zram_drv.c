@@ -34,6 +34,7 @@
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
 #include <linux/part_stat.h>
+#include <linux/seq_file.h>
 
 #include "zram_drv.h"
 
@@ -80,6 +81,11 @@ static inline bool init_done(struct zram *zram)
 	return zram->disksize;
 }
 
+static inline atomic_t *zram_ra_seq(struct zram *zram, u32 index)
+{
+	return &zram->ra_seq[index & (ZRAM_RA_SEQ_BUCKETS - 1)];
+}
+
 static inline struct zram *dev_to_zram(struct device *dev)
 {
 	return (struct zram *)dev_to_disk(dev)->private_data;
@@ -127,15 +133,36 @@ static unsigned long zram_get_element(struct zram *zram, u32 index)
 
 static size_t zram_get_obj_size(struct zram *zram, u32 index)
 {
-	return zram->table[index].flags & (BIT(ZRAM_FLAG_SHIFT) - 1);
+	return zram->table[index].flags & ZRAM_OBJ_SIZE_MASK;
 }
 
 static void zram_set_obj_size(struct zram *zram,
 					u32 index, size_t size)
 {
-	unsigned long flags = zram->table[index].flags >> ZRAM_FLAG_SHIFT;
+	unsigned long flags = zram->table[index].flags & ~ZRAM_OBJ_SIZE_MASK;
+
+	zram->table[index].flags = flags | size;
+}
+
+static unsigned int zram_get_access(struct zram *zram, u32 index)
+{
+	return (zram->table[index].flags >> ZRAM_ACCESS_SHIFT) &
+			ZRAM_ACCESS_MAX;
+}
+
+static void zram_set_access(struct zram *zram, u32 index,
+					unsigned int count)
+{
+	zram->table[index].flags &= ~(ZRAM_ACCESS_MAX << ZRAM_ACCESS_SHIFT);
+	zram->table[index].flags |= (unsigned long)count << ZRAM_ACCESS_SHIFT;
+}
+
+static void zram_inc_access(struct zram *zram, u32 index)
+{
+	unsigned int count = zram_get_access(zram, index);
 
-	zram->table[index].flags = (flags << ZRAM_FLAG_SHIFT) | size;
+	if (count < ZRAM_ACCESS_MAX)
+		zram_set_access(zram, index, count + 1);
 }
 
 static inline bool zram_allocated(struct zram *zram, u32 index)
@@ -314,8 +341,12 @@ static ssize_t idle_store(struct device *dev,
 		 */
 		zram_slot_lock(zram, index);
 		if (zram_allocated(zram, index) &&
-				!zram_test_flag(zram, index, ZRAM_UNDER_WB))
+				!zram_test_flag(zram, index, ZRAM_UNDER_WB)) {
 			zram_set_flag(zram, index, ZRAM_IDLE);
+			/* Each idle marking pass ages the access counter */
+			zram_set_access(zram, index,
+					zram_get_access(zram, index) >> 1);
+		}
 		zram_slot_unlock(zram, index);
 	}
 
@@ -324,6 +355,97 @@ static ssize_t idle_store(struct device *dev,
 	return len;
 }
 
+#if defined(CONFIG_ZRAM_WRITEBACK) || defined(CONFIG_ZRAM_MULTI_COMP) || \
+	defined(CONFIG_ZRAM_MEMORY_TRACKING)
+/* Slots the access histogram and the cold selection consider at all */
+static bool zram_cold_candidate(struct zram *zram, u32 index)
+{
+	return zram_allocated(zram, index) &&
+		!zram_test_flag(zram, index, ZRAM_WB) &&
+		!zram_test_flag(zram, index, ZRAM_SAME) &&
+		!zram_test_flag(zram, index, ZRAM_UNDER_WB);
+}
+
+static void zram_access_hist(struct zram *zram, unsigned long *hist)
+{
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+
+	memset(hist, 0, sizeof(*hist) * (ZRAM_ACCESS_MAX + 1));
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (zram_cold_candidate(zram, index))
+			hist[zram_get_access(zram, index)]++;
+		zram_slot_unlock(zram, index);
+	}
+}
+#endif
+
+#if defined(CONFIG_ZRAM_WRITEBACK) || defined(CONFIG_ZRAM_MULTI_COMP)
+#define COLD_SIZE_SIG "cold_size="
+
+/*
+ * Selection of the coldest slots: every slot whose access count is below
+ * @count, plus up to @nr_equal slots whose count equals it. Built from the
+ * access histogram so that writeback and recompress can be limited to the
+ * coldest N bytes instead of everything idle.
+ */
+struct zram_cold_sel {
+	unsigned int count;
+	unsigned long nr_equal;
+};
+
+static void zram_cold_sel_init(struct zram *zram, unsigned long target,
+				struct zram_cold_sel *sel)
+{
+	unsigned long hist[ZRAM_ACCESS_MAX + 1];
+	unsigned long sum = 0;
+	unsigned int count;
+
+	zram_access_hist(zram, hist);
+	for (count = 0; count < ZRAM_ACCESS_MAX; count++) {
+		if (sum + hist[count] >= target)
+			break;
+		sum += hist[count];
+	}
+
+	sel->count = count;
+	sel->nr_equal = target - sum;
+}
+
+/* Caller should hold the slot lock */
+static bool zram_cold_match(struct zram *zram, u32 index,
+				struct zram_cold_sel *sel)
+{
+	unsigned int count = zram_get_access(zram, index);
+
+	if (count < sel->count)
+		return true;
+	if (count == sel->count && sel->nr_equal) {
+		sel->nr_equal--;
+		return true;
+	}
+	return false;
+}
+
+static int zram_parse_cold_size(const char *buf, unsigned long *nr_pages)
+{
+	char *tmp;
+	u64 size;
+
+	if (strncmp(buf, COLD_SIZE_SIG, sizeof(COLD_SIZE_SIG) - 1))
+		return -EINVAL;
+
+	buf += sizeof(COLD_SIZE_SIG) - 1;
+	size = memparse(buf, &tmp);
+	if (buf == tmp || !size)
+		return -EINVAL;
+
+	*nr_pages = DIV_ROUND_UP_ULL(size, PAGE_SIZE);
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_ZRAM_WRITEBACK
 static ssize_t writeback_limit_enable_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
@@ -555,19 +677,34 @@ static ssize_t backing_dev_store(struct device *dev,
 	return err;
 }
 
-static unsigned long alloc_block_bdev(struct zram *zram)
+/*
+ * Reserve up to *nr contiguous blocks on the backing device. On return
+ * *nr holds the number of blocks actually reserved, which is smaller when
+ * the free run is shorter. Returns the first block or 0 if the device is
+ * full.
+ */
+static unsigned long alloc_block_bdev(struct zram *zram, unsigned int *nr)
 {
 	unsigned long blk_idx = 1;
+	unsigned long end, i;
 retry:
 	/* skip 0 bit to confuse zram.handle = 0 */
 	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
 	if (blk_idx == zram->nr_pages)
 		return 0;
 
-	if (test_and_set_bit(blk_idx, zram->bitmap))
+	end = find_next_bit(zram->bitmap,
+			min_t(unsigned long, blk_idx + *nr, zram->nr_pages),
+			blk_idx);
+	for (i = blk_idx; i < end; i++) {
+		if (test_and_set_bit(i, zram->bitmap))
+			break;
+	}
+	if (i == blk_idx)
 		goto retry;
 
-	atomic64_inc(&zram->stats.bd_count);
+	*nr = i - blk_idx;
+	atomic64_add(*nr, &zram->stats.bd_count);
 	return blk_idx;
 }
 
@@ -625,25 +762,258 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define PAGE_WRITEBACK 0
 #define HUGE_WRITEBACK 1
 #define IDLE_WRITEBACK 2
+#define COLD_WRITEBACK 3
+
+/* Pages written by one writeback bio */
+#define ZRAM_WB_BATCH	32
+
+/*
+ * writeback_store keeps two of these: while the bio of one batch is in
+ * flight, the next batch is being filled by decompressing slots into its
+ * pages.
+ */
+struct zram_wb_batch {
+	struct page *pages[ZRAM_WB_BATCH];
+	unsigned long index[ZRAM_WB_BATCH];
+	/* first block of the range reserved by alloc_block_bdev */
+	unsigned long blk_idx;
+	unsigned int nr_blks;
+	/* pages filled, always <= nr_blks */
+	unsigned int nr;
+	struct bio *bio;
+	struct completion done;
+	int err;
+};
+
+static void zram_wb_free_batches(struct zram_wb_batch *wb, int nr)
+{
+	int i, j;
+
+	for (i = 0; i < nr; i++) {
+		for (j = 0; j < ZRAM_WB_BATCH; j++) {
+			if (wb[i].pages[j])
+				__free_page(wb[i].pages[j]);
+		}
+	}
+	kfree(wb);
+}
+
+static struct zram_wb_batch *zram_wb_alloc_batches(int nr)
+{
+	struct zram_wb_batch *wb;
+	int i, j;
+
+	wb = kcalloc(nr, sizeof(*wb), GFP_KERNEL);
+	if (!wb)
+		return NULL;
+
+	for (i = 0; i < nr; i++) {
+		for (j = 0; j < ZRAM_WB_BATCH; j++) {
+			wb[i].pages[j] = alloc_page(GFP_KERNEL);
+			if (!wb[i].pages[j]) {
+				zram_wb_free_batches(wb, nr);
+				return NULL;
+			}
+		}
+	}
+	return wb;
+}
+
+/*
+ * Caller should hold the slot lock. @sel is only used, and consumed, by
+ * COLD_WRITEBACK.
+ */
+static bool zram_wb_eligible(struct zram *zram, unsigned long index, int mode,
+			struct zram_cold_sel *sel)
+{
+	if (!zram_allocated(zram, index))
+		return false;
+
+	if (zram_test_flag(zram, index, ZRAM_WB) ||
+			zram_test_flag(zram, index, ZRAM_SAME) ||
+			zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		return false;
+
+	if (mode == IDLE_WRITEBACK &&
+		  !zram_test_flag(zram, index, ZRAM_IDLE))
+		return false;
+	if (mode == HUGE_WRITEBACK &&
+		  !zram_test_flag(zram, index, ZRAM_HUGE))
+		return false;
+	if (mode == COLD_WRITEBACK && !zram_cold_match(zram, index, sel))
+		return false;
+
+	return true;
+}
+
+/*
+ * Pick eligible slots starting at *index and decompress them into the
+ * batch pages until the reserved block range is full or @end is reached.
+ */
+static void zram_wb_fill(struct zram *zram, struct zram_wb_batch *wb,
+			unsigned long *index, unsigned long end, int mode,
+			struct zram_cold_sel *sel)
+{
+	wb->nr = 0;
+	while (wb->nr < wb->nr_blks && *index < end) {
+		unsigned long idx = (*index)++;
+		struct bio_vec bvec;
+
+		bvec.bv_page = wb->pages[wb->nr];
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+
+		zram_slot_lock(zram, idx);
+		if (!zram_wb_eligible(zram, idx, mode, sel)) {
+			zram_slot_unlock(zram, idx);
+			continue;
+		}
+		/*
+		 * Clearing ZRAM_UNDER_WB is duty of caller.
+		 * IOW, zram_free_page never clear it.
+		 */
+		zram_set_flag(zram, idx, ZRAM_UNDER_WB);
+		/* Need for hugepage writeback racing */
+		zram_set_flag(zram, idx, ZRAM_IDLE);
+		zram_slot_unlock(zram, idx);
+		if (zram_bvec_read(zram, &bvec, idx, 0, NULL)) {
+			zram_slot_lock(zram, idx);
+			zram_clear_flag(zram, idx, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, idx, ZRAM_IDLE);
+			zram_slot_unlock(zram, idx);
+			continue;
+		}
+
+		wb->index[wb->nr++] = idx;
+	}
+	atomic64_set(&zram->stats.bd_wb_remaining, end - *index);
+}
+
+static void zram_wb_end_io(struct bio *bio)
+{
+	struct zram_wb_batch *wb = bio->bi_private;
+
+	wb->err = blk_status_to_errno(bio->bi_status);
+	complete(&wb->done);
+}
+
+static void zram_wb_submit(struct zram *zram, struct zram_wb_batch *wb)
+{
+	struct bio *bio;
+	unsigned int i;
+
+	bio = bio_alloc(GFP_KERNEL, wb->nr);
+	bio_set_dev(bio, zram->bdev);
+	bio->bi_iter.bi_sector = wb->blk_idx * (PAGE_SIZE >> 9);
+	bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
+	bio->bi_private = wb;
+	bio->bi_end_io = zram_wb_end_io;
+	for (i = 0; i < wb->nr; i++)
+		bio_add_page(bio, wb->pages[i], PAGE_SIZE, 0);
+
+	wb->err = 0;
+	wb->bio = bio;
+	init_completion(&wb->done);
+	atomic64_inc(&zram->stats.bd_wb_bios);
+	submit_bio(bio);
+}
 
+/*
+ * Wait for the batch bio and move the slots that are still idle to the
+ * backing device. Returns the number of pages written back.
+ */
+static unsigned int zram_wb_complete(struct zram *zram,
+				struct zram_wb_batch *wb)
+{
+	unsigned int i, written = 0;
+
+	wait_for_completion(&wb->done);
+	bio_put(wb->bio);
+	wb->bio = NULL;
+
+	if (!wb->err)
+		atomic64_add(wb->nr, &zram->stats.bd_writes);
+
+	for (i = 0; i < wb->nr; i++) {
+		unsigned long index = wb->index[i];
+		unsigned long blk_idx = wb->blk_idx + i;
+
+		/*
+		 * We released zram_slot_lock so need to check if the slot was
+		 * changed. If there is freeing for the slot, we can catch it
+		 * easily by zram_allocated.
+		 * A subtle case is the slot is freed/reallocated/marked as
+		 * ZRAM_IDLE again. To close the race, idle_store doesn't
+		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 */
+		zram_slot_lock(zram, index);
+		if (wb->err || !zram_allocated(zram, index) ||
+			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			free_block_bdev(zram, blk_idx);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, blk_idx);
+		atomic64_inc(&zram->stats.pages_stored);
+		spin_lock(&zram->wb_limit_lock);
+		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+		spin_unlock(&zram->wb_limit_lock);
+		zram_slot_unlock(zram, index);
+		written++;
+	}
+
+	return written;
+}
+
+/*
+ * Number of pages the next batch may take, honouring writeback_limit
+ * minus what is still in flight.
+ */
+static unsigned int zram_wb_budget(struct zram *zram, unsigned int inflight)
+{
+	unsigned int budget = ZRAM_WB_BATCH;
+	u64 avail;
+
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable) {
+		avail = zram->bd_wb_limit >> (PAGE_SHIFT - 12);
+		avail = avail > inflight ? avail - inflight : 0;
+		budget = min_t(u64, budget, avail);
+	}
+	spin_unlock(&zram->wb_limit_lock);
+
+	return budget;
+}
 
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
-	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	unsigned long index = 0, end;
+	struct zram_wb_batch *batches, *wb, *inflight = NULL;
+	struct zram_cold_sel sel = { 0 };
+	unsigned long nr_cold = 0;
+	unsigned long written = 0;
+	unsigned int i, cur = 0;
+	ktime_t start;
 	ssize_t ret = len;
-	int mode, err;
-	unsigned long blk_idx = 0;
+	int mode;
 
 	if (sysfs_streq(buf, "idle"))
 		mode = IDLE_WRITEBACK;
 	else if (sysfs_streq(buf, "huge"))
 		mode = HUGE_WRITEBACK;
+	else if (!zram_parse_cold_size(buf, &nr_cold))
+		mode = COLD_WRITEBACK;
 	else {
 		if (strncmp(buf, PAGE_WB_SIG, sizeof(PAGE_WB_SIG) - 1))
 			return -EINVAL;
@@ -655,6 +1025,7 @@ static ssize_t writeback_store(struct device *dev,
 		nr_pages = 1;
 		mode = PAGE_WRITEBACK;
 	}
+	end = index + nr_pages;
 
 	down_read(&zram->init_lock);
 	if (!init_done(zram)) {
@@ -667,126 +1038,68 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	batches = zram_wb_alloc_batches(2);
+	if (!batches) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
-	for (; nr_pages != 0; index++, nr_pages--) {
-		struct bio_vec bvec;
+	if (mode == COLD_WRITEBACK)
+		zram_cold_sel_init(zram, nr_cold, &sel);
 
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
+	start = ktime_get();
+	while (index < end) {
+		wb = &batches[cur];
 
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
-			spin_unlock(&zram->wb_limit_lock);
+		wb->nr_blks = zram_wb_budget(zram,
+				inflight ? inflight->nr : 0);
+		if (!wb->nr_blks) {
 			ret = -EIO;
 			break;
 		}
-		spin_unlock(&zram->wb_limit_lock);
-
-		if (!blk_idx) {
-			blk_idx = alloc_block_bdev(zram);
-			if (!blk_idx) {
-				ret = -ENOSPC;
-				break;
-			}
-		}
-
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index))
-			goto next;
-
-		if (zram_test_flag(zram, index, ZRAM_WB) ||
-				zram_test_flag(zram, index, ZRAM_SAME) ||
-				zram_test_flag(zram, index, ZRAM_UNDER_WB))
-			goto next;
 
-		if (mode == IDLE_WRITEBACK &&
-			  !zram_test_flag(zram, index, ZRAM_IDLE))
-			goto next;
-		if (mode == HUGE_WRITEBACK &&
-			  !zram_test_flag(zram, index, ZRAM_HUGE))
-			goto next;
-		/*
-		 * Clearing ZRAM_UNDER_WB is duty of caller.
-		 * IOW, zram_free_page never clear it.
-		 */
-		zram_set_flag(zram, index, ZRAM_UNDER_WB);
-		/* Need for hugepage writeback racing */
-		zram_set_flag(zram, index, ZRAM_IDLE);
-		zram_slot_unlock(zram, index);
-		if (zram_bvec_read(zram, &bvec, index, 0, NULL)) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			continue;
+		wb->blk_idx = alloc_block_bdev(zram, &wb->nr_blks);
+		if (!wb->blk_idx) {
+			ret = -ENOSPC;
+			break;
 		}
 
-		bio_init(&bio, &bio_vec, 1);
-		bio_set_dev(&bio, zram->bdev);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		bio.bi_opf = REQ_OP_WRITE | REQ_SYNC;
+		/* Overlaps with the I/O of the previous batch */
+		zram_wb_fill(zram, wb, &index, end, mode, &sel);
+		for (i = wb->nr; i < wb->nr_blks; i++)
+			free_block_bdev(zram, wb->blk_idx + i);
+		if (wb->nr)
+			zram_wb_submit(zram, wb);
 
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
+		if (inflight) {
+			written += zram_wb_complete(zram, inflight);
 			/*
 			 * Return last IO error unless every IO were
 			 * not suceeded.
 			 */
-			ret = err;
-			continue;
+			if (inflight->err)
+				ret = inflight->err;
 		}
 
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
+		inflight = wb->nr ? wb : NULL;
+		cur ^= 1;
+	}
 
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
-next:
-		zram_slot_unlock(zram, index);
+	if (inflight) {
+		written += zram_wb_complete(zram, inflight);
+		if (inflight->err)
+			ret = inflight->err;
 	}
 
-	if (blk_idx)
-		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+	if (written) {
+		u64 elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		atomic64_set(&zram->stats.bd_wb_kbps,
+			div64_u64(((u64)written << PAGE_SHIFT) * NSEC_PER_SEC,
+				  max_t(u64, elapsed, 1) * 1024));
+	}
+	atomic64_set(&zram->stats.bd_wb_remaining, 0);
+	zram_wb_free_batches(batches, 2);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -880,6 +1193,7 @@ static void zram_debugfs_destroy(void)
 static void zram_accessed(struct zram *zram, u32 index)
 {
 	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_inc_access(zram, index);
 	zram->table[index].ac_time = ktime_get_boottime();
 }
 
@@ -945,16 +1259,39 @@ static const struct file_operations proc_zram_block_state_op = {
 	.llseek = default_llseek,
 };
 
-static void zram_debugfs_register(struct zram *zram)
+static int zram_access_hist_show(struct seq_file *m, void *v)
 {
-	if (!zram_debugfs_root)
-		return;
+	struct zram *zram = m->private;
+	unsigned long hist[ZRAM_ACCESS_MAX + 1];
+	unsigned int count;
 
-	zram->debugfs_dir = debugfs_create_dir(zram->disk->disk_name,
-						zram_debugfs_root);
-	debugfs_create_file("block_state", 0400, zram->debugfs_dir,
-				zram, &proc_zram_block_state_op);
-}
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+	zram_access_hist(zram, hist);
+	up_read(&zram->init_lock);
+
+	for (count = 0; count <= ZRAM_ACCESS_MAX; count++)
+		seq_printf(m, "%2u %12lu\n", count, hist[count]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(zram_access_hist);
+
+static void zram_debugfs_register(struct zram *zram)
+{
+	if (!zram_debugfs_root)
+		return;
+
+	zram->debugfs_dir = debugfs_create_dir(zram->disk->disk_name,
+						zram_debugfs_root);
+	debugfs_create_file("block_state", 0400, zram->debugfs_dir,
+				zram, &proc_zram_block_state_op);
+	debugfs_create_file("access_hist", 0400, zram->debugfs_dir,
+				zram, &zram_access_hist_fops);
+}
 
 static void zram_debugfs_unregister(struct zram *zram)
 {
@@ -966,6 +1303,7 @@ static void zram_debugfs_destroy(void) {};
 static void zram_accessed(struct zram *zram, u32 index)
 {
 	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_inc_access(zram, index);
 };
 static void zram_debugfs_register(struct zram *zram) {};
 static void zram_debugfs_unregister(struct zram *zram) {};
@@ -992,6 +1330,40 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t read_around_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	down_read(&zram->init_lock);
+	val = zram->ra_pages;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", val);
+}
+
+static ssize_t read_around_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || val > ZRAM_RA_MAX)
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change read_around for initialized device\n");
+		return -EBUSY;
+	}
+
+	zram->ra_pages = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1033,6 +1405,49 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recompressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recompressor)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recompressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1058,11 +1473,13 @@ static ssize_t io_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8llu %8llu %8llu\n",
 			(u64)atomic64_read(&zram->stats.failed_reads),
 			(u64)atomic64_read(&zram->stats.failed_writes),
 			(u64)atomic64_read(&zram->stats.invalid_io),
-			(u64)atomic64_read(&zram->stats.notify_free));
+			(u64)atomic64_read(&zram->stats.notify_free),
+			(u64)atomic64_read(&zram->stats.ra_hits),
+			(u64)atomic64_read(&zram->stats.ra_misses));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1113,10 +1530,13 @@ static ssize_t bd_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-		"%8llu %8llu %8llu\n",
+		"%8llu %8llu %8llu %8llu %8llu %8llu\n",
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_count)),
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_reads)),
-			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)));
+			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)),
+			(u64)atomic64_read(&zram->stats.bd_wb_bios),
+			(u64)atomic64_read(&zram->stats.bd_wb_remaining),
+			(u64)atomic64_read(&zram->stats.bd_wb_kbps));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1136,6 +1556,9 @@ static ssize_t debug_stat_show(struct device *dev,
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
 			(u64)atomic64_read(&zram->stats.miss_free));
+	if (init_done(zram))
+		ret += zcomp_acomp_stat_show(zram->comp, buf + ret,
+					     PAGE_SIZE - ret);
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1148,6 +1571,52 @@ static DEVICE_ATTR_RO(bd_stat);
 #endif
 static DEVICE_ATTR_RO(debug_stat);
 
+static void zram_ra_free(struct zram *zram)
+{
+	int cpu, i;
+
+	if (!zram->ra_cache)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_ra_cache *rac = per_cpu_ptr(zram->ra_cache, cpu);
+
+		for (i = 0; i < ZRAM_RA_MAX; i++) {
+			if (rac->ent[i].page)
+				__free_page(rac->ent[i].page);
+		}
+	}
+	free_percpu(zram->ra_cache);
+	zram->ra_cache = NULL;
+}
+
+static bool zram_ra_alloc(struct zram *zram)
+{
+	int cpu, i;
+
+	if (!zram->ra_pages)
+		return true;
+
+	zram->ra_cache = alloc_percpu(struct zram_ra_cache);
+	if (!zram->ra_cache)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_ra_cache *rac = per_cpu_ptr(zram->ra_cache, cpu);
+
+		local_lock_init(&rac->lock);
+		rac->last_index = U32_MAX - 1;
+		for (i = 0; i < zram->ra_pages; i++) {
+			rac->ent[i].page = alloc_page(GFP_KERNEL);
+			if (!rac->ent[i].page) {
+				zram_ra_free(zram);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 static void zram_meta_free(struct zram *zram, u64 disksize)
 {
 	size_t num_pages = disksize >> PAGE_SHIFT;
@@ -1157,6 +1626,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 	for (index = 0; index < num_pages; index++)
 		zram_free_page(zram, index);
 
+	zram_ra_free(zram);
 	zs_destroy_pool(zram->mem_pool);
 	vfree(zram->table);
 }
@@ -1176,6 +1646,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (!zram_ra_alloc(zram)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1193,6 +1669,10 @@ static void zram_free_page(struct zram *zram, size_t index)
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	zram->table[index].ac_time = 0;
 #endif
+	zram_set_access(zram, index, 0);
+	/* Any copy of this slot held by read-around is stale from now on */
+	if (zram->ra_pages)
+		atomic_inc(zram_ra_seq(zram, index));
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
@@ -1201,6 +1681,9 @@ static void zram_free_page(struct zram *zram, size_t index)
 		atomic64_dec(&zram->stats.huge_pages);
 	}
 
+	zram_clear_flag(zram, index, ZRAM_RECOMP);
+	zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
 		zram_clear_flag(zram, index, ZRAM_WB);
 		free_block_bdev(zram, zram_get_element(zram, index));
@@ -1233,29 +1716,33 @@ static void zram_free_page(struct zram *zram, size_t index)
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
-static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
-				struct bio *bio, bool partial_io)
+/*
+ * Slots re-encoded by recompress_store carry ZRAM_RECOMP and have to be
+ * decoded by the secondary algorithm.
+ */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
+/*
+ * Decode an in-memory (not written back) slot into @page.
+ * Caller should hold the slot lock.
+ */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				u32 index)
 {
 	struct zcomp_strm *zstrm;
+	struct zcomp *comp;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
 	int ret;
 
-	zram_slot_lock(zram, index);
-	if (zram_test_flag(zram, index, ZRAM_WB)) {
-		struct bio_vec bvec;
-
-		zram_slot_unlock(zram, index);
-
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
-		return read_from_bdev(zram, &bvec,
-				zram_get_element(zram, index),
-				bio, partial_io);
-	}
-
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -1265,14 +1752,14 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		mem = kmap_atomic(page);
 		zram_fill_page(mem, PAGE_SIZE, value);
 		kunmap_atomic(mem);
-		zram_slot_unlock(zram, index);
 		return 0;
 	}
 
 	size = zram_get_obj_size(zram, index);
+	comp = zram_slot_comp(zram, index);
 
 	if (size != PAGE_SIZE)
-		zstrm = zcomp_stream_get(zram->comp);
+		zstrm = zcomp_stream_get(comp);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1284,9 +1771,107 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
+	return ret;
+}
+
+/*
+ * Serve a read from the read-around cache of this CPU. The entry is
+ * consumed either way; it is used only if no zram_free_page() hit its
+ * bucket since it was filled.
+ */
+static bool zram_ra_lookup(struct zram *zram, u32 index, struct page *page)
+{
+	struct zram_ra_cache *rac;
+	struct zram_ra_entry *ent;
+	bool hit = false;
+
+	local_lock(&zram->ra_cache->lock);
+	rac = this_cpu_ptr(zram->ra_cache);
+	ent = &rac->ent[index % zram->ra_pages];
+	if (ent->valid && ent->index == index) {
+		ent->valid = false;
+		zram_slot_lock(zram, index);
+		if (ent->seq == atomic_read(zram_ra_seq(zram, index))) {
+			copy_highpage(page, ent->page);
+			hit = true;
+		}
+		zram_slot_unlock(zram, index);
+	}
+	local_unlock(&zram->ra_cache->lock);
+
+	atomic64_inc(hit ? &zram->stats.ra_hits : &zram->stats.ra_misses);
+	return hit;
+}
+
+/*
+ * Called after a read of @index completed. If it continues a sequential
+ * run on this CPU, decompress the following slots into the cache so that
+ * the swap-in of a contiguous region does not pay for each page on demand.
+ * Slots on the backing device end the window since they need real I/O.
+ */
+static void zram_ra_fill(struct zram *zram, u32 index)
+{
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	struct zram_ra_cache *rac;
+	unsigned int i;
+
+	local_lock(&zram->ra_cache->lock);
+	rac = this_cpu_ptr(zram->ra_cache);
+	if (index != rac->last_index + 1) {
+		rac->last_index = index;
+		goto out;
+	}
+	rac->last_index = index;
+
+	for (i = 1; i <= zram->ra_pages; i++) {
+		u32 idx = index + i;
+		struct zram_ra_entry *ent = &rac->ent[idx % zram->ra_pages];
+
+		if (idx >= nr_pages)
+			break;
+		if (ent->valid && ent->index == idx)
+			continue;
+
+		ent->valid = false;
+		zram_slot_lock(zram, idx);
+		if (!zram_allocated(zram, idx) ||
+				zram_test_flag(zram, idx, ZRAM_WB) ||
+				zram_read_from_zspool(zram, ent->page, idx)) {
+			zram_slot_unlock(zram, idx);
+			break;
+		}
+		ent->index = idx;
+		ent->seq = atomic_read(zram_ra_seq(zram, idx));
+		ent->valid = true;
+		zram_slot_unlock(zram, idx);
+	}
+out:
+	local_unlock(&zram->ra_cache->lock);
+}
+
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io)
+{
+	int ret;
+
+	zram_slot_lock(zram, index);
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		struct bio_vec bvec;
+
+		zram_slot_unlock(zram, index);
+
+		bvec.bv_page = page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+		return read_from_bdev(zram, &bvec,
+				zram_get_element(zram, index),
+				bio, partial_io);
+	}
+
+	ret = zram_read_from_zspool(zram, page, index);
 	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -1329,8 +1914,22 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
-static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
-				u32 index, struct bio *bio)
+/*
+ * Result of compressing one page. zram_compress_page() fills it in without
+ * touching the table and zram_store_page() publishes it under the slot lock,
+ * which lets multi-page writes compress a whole batch before taking any
+ * slot lock.
+ */
+struct zram_wr_slot {
+	u32 index;
+	unsigned long handle;
+	unsigned long element;
+	unsigned int comp_len;
+	enum zram_pageflags flags;
+};
+
+static int zram_compress_page(struct zram *zram, struct page *page,
+				struct zram_wr_slot *slot)
 {
 	int ret = 0;
 	unsigned long alloced_pages;
@@ -1338,17 +1937,21 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	unsigned int comp_len = 0;
 	void *src, *dst, *mem;
 	struct zcomp_strm *zstrm;
-	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
-	enum zram_pageflags flags = 0;
+
+	slot->handle = 0;
+	slot->element = 0;
+	slot->comp_len = 0;
+	slot->flags = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
 		kunmap_atomic(mem);
 		/* Free memory associated with this sector now. */
-		flags = ZRAM_SAME;
+		slot->flags = ZRAM_SAME;
+		slot->element = element;
 		atomic64_inc(&zram->stats.same_pages);
-		goto out;
+		return 0;
 	}
 	kunmap_atomic(mem);
 
@@ -1419,31 +2022,57 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
-out:
+
+	slot->handle = handle;
+	slot->comp_len = comp_len;
+	return 0;
+}
+
+/*
+ * Caller should hold the slot lock of slot->index. pages_stored is left
+ * to the caller so that batched writers can account it once per batch.
+ */
+static void zram_store_page(struct zram *zram, struct zram_wr_slot *slot)
+{
+	u32 index = slot->index;
+
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
 	 */
-	zram_slot_lock(zram, index);
 	zram_free_page(zram, index);
 
-	if (comp_len == PAGE_SIZE) {
+	if (slot->comp_len == PAGE_SIZE) {
 		zram_set_flag(zram, index, ZRAM_HUGE);
 		atomic64_inc(&zram->stats.huge_pages);
 	}
 
-	if (flags) {
-		zram_set_flag(zram, index, flags);
-		zram_set_element(zram, index, element);
+	if (slot->flags) {
+		zram_set_flag(zram, index, slot->flags);
+		zram_set_element(zram, index, slot->element);
 	}  else {
-		zram_set_handle(zram, index, handle);
-		zram_set_obj_size(zram, index, comp_len);
+		zram_set_handle(zram, index, slot->handle);
+		zram_set_obj_size(zram, index, slot->comp_len);
 	}
+}
+
+static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
+				u32 index, struct bio *bio)
+{
+	struct zram_wr_slot slot = { .index = index };
+	int ret;
+
+	ret = zram_compress_page(zram, bvec->bv_page, &slot);
+	if (ret)
+		return ret;
+
+	zram_slot_lock(zram, index);
+	zram_store_page(zram, &slot);
 	zram_slot_unlock(zram, index);
 
 	/* Update stats */
 	atomic64_inc(&zram->stats.pages_stored);
-	return ret;
+	return 0;
 }
 
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
@@ -1487,6 +2116,166 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+#define RECOMPRESS_IDLE		0
+#define RECOMPRESS_HUGE		1
+#define RECOMPRESS_HUGE_IDLE	2
+#define RECOMPRESS_COLD		3
+
+/*
+ * Re-encode one slot with the secondary algorithm. The new object is kept
+ * only if it is smaller than the current one; otherwise the slot is tagged
+ * ZRAM_INCOMPRESSIBLE so that later passes skip it. Caller should hold the
+ * slot lock, hence all allocations here must not sleep.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	struct zcomp_strm *zstrm;
+	unsigned long handle_new;
+	unsigned int comp_len_old;
+	unsigned int comp_len_new;
+	void *src, *dst;
+	int ret;
+
+	comp_len_old = zram_get_obj_size(zram, index);
+
+	ret = zram_read_from_zspool(zram, page, index);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len_new);
+	kunmap_atomic(src);
+
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	if (comp_len_new >= huge_class_size ||
+			comp_len_new >= comp_len_old) {
+		zcomp_stream_put(zram->recomp);
+		zram_set_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+		return 0;
+	}
+
+	handle_new = zs_malloc(zram->mem_pool, comp_len_new,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!handle_new) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle_new, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len_new);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, handle_new);
+
+	/* The old object goes away, together with its ZRAM_HUGE/IDLE state */
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, handle_new);
+	zram_set_obj_size(zram, index, comp_len_new);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+
+	atomic64_add(comp_len_new, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	return 0;
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	struct zram_cold_sel sel = { 0 };
+	unsigned long index, nr_cold = 0;
+	struct page *page;
+	ssize_t ret = len;
+	int mode, err = 0;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = RECOMPRESS_IDLE;
+	else if (sysfs_streq(buf, "huge"))
+		mode = RECOMPRESS_HUGE;
+	else if (sysfs_streq(buf, "huge_idle"))
+		mode = RECOMPRESS_HUGE_IDLE;
+	else if (!zram_parse_cold_size(buf, &nr_cold))
+		mode = RECOMPRESS_COLD;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram->recomp) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	if (mode == RECOMPRESS_COLD)
+		zram_cold_sel_init(zram, nr_cold, &sel);
+
+	for (index = 0; index < nr_pages; index++) {
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP) ||
+				zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+			goto next;
+
+		if (mode == RECOMPRESS_COLD) {
+			if (!zram_cold_match(zram, index, &sel))
+				goto next;
+		} else {
+			if (mode != RECOMPRESS_HUGE &&
+				  !zram_test_flag(zram, index, ZRAM_IDLE))
+				goto next;
+			if (mode != RECOMPRESS_IDLE &&
+				  !zram_test_flag(zram, index, ZRAM_HUGE))
+				goto next;
+		}
+
+		err = zram_recompress(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+		if (err) {
+			ret = err;
+			/*
+			 * The pool is under pressure and the remaining
+			 * slots would fail the same way.
+			 */
+			if (err == -ENOMEM)
+				break;
+			err = 0;
+		}
+		cond_resched();
+	}
+
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1536,8 +2325,15 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	int ret;
 
 	if (!op_is_write(op)) {
+		bool ra = zram->ra_pages && !is_partial_io(bvec);
+
 		atomic64_inc(&zram->stats.num_reads);
-		ret = zram_bvec_read(zram, bvec, index, offset, bio);
+		if (ra && zram_ra_lookup(zram, index, bvec->bv_page))
+			ret = 0;
+		else
+			ret = zram_bvec_read(zram, bvec, index, offset, bio);
+		if (ra && !ret)
+			zram_ra_fill(zram, index);
 		flush_dcache_page(bvec->bv_page);
 	} else {
 		atomic64_inc(&zram->stats.num_writes);
@@ -1558,6 +2354,85 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+/*
+ * Number of pages compressed before their table entries are published.
+ * Bounded so that the on-stack slot array stays small.
+ */
+#define ZRAM_WRITE_BATCH	16
+
+/*
+ * Multi-page writes (swap clustering from kswapd, 64KiB+ swap bios) made
+ * of full pages can go through zram_bio_write_batch(). Anything with a
+ * partial page falls back to the per-bvec path, which knows how to do
+ * read-modify-write.
+ */
+static bool zram_bio_batchable(struct bio *bio, int offset)
+{
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+
+	if (bio_op(bio) != REQ_OP_WRITE || offset)
+		return false;
+
+	if (bio->bi_iter.bi_size < 2 * PAGE_SIZE)
+		return false;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		if (bvec.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	return true;
+}
+
+static void zram_commit_batch(struct zram *zram, struct zram_wr_slot *slots,
+				int nr)
+{
+	int i;
+
+	/*
+	 * Store and mark accessed under one lock round trip per slot,
+	 * rather than the two zram_bvec_rw() needs for a single page.
+	 */
+	for (i = 0; i < nr; i++) {
+		zram_slot_lock(zram, slots[i].index);
+		zram_store_page(zram, &slots[i]);
+		zram_accessed(zram, slots[i].index);
+		zram_slot_unlock(zram, slots[i].index);
+	}
+
+	atomic64_add(nr, &zram->stats.pages_stored);
+}
+
+static void zram_bio_write_batch(struct zram *zram, struct bio *bio,
+				u32 index)
+{
+	struct zram_wr_slot slots[ZRAM_WRITE_BATCH];
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	int nr = 0;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		atomic64_inc(&zram->stats.num_writes);
+
+		slots[nr].index = index++;
+		if (unlikely(zram_compress_page(zram, bvec.bv_page,
+						&slots[nr]))) {
+			atomic64_inc(&zram->stats.failed_writes);
+			bio->bi_status = BLK_STS_IOERR;
+			continue;
+		}
+
+		if (++nr == ZRAM_WRITE_BATCH) {
+			zram_commit_batch(zram, slots, nr);
+			nr = 0;
+		}
+	}
+
+	if (nr)
+		zram_commit_batch(zram, slots, nr);
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset;
@@ -1581,6 +2456,11 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 	}
 
 	start_time = bio_start_io_acct(bio);
+	if (zram_bio_batchable(bio, offset)) {
+		zram_bio_write_batch(zram, bio, index);
+		goto out;
+	}
+
 	bio_for_each_segment(bvec, bio, iter) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
@@ -1600,6 +2480,7 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 			update_position(&index, &offset, &bv);
 		} while (unwritten);
 	}
+out:
 	bio_end_io_acct(bio, start_time);
 	bio_endio(bio);
 }
@@ -1722,6 +2603,12 @@ static void zram_reset_device(struct zram *zram)
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp) {
+		zcomp_destroy(zram->recomp);
+		zram->recomp = NULL;
+	}
+#endif
 	reset_bdev(zram);
 }
 
@@ -1758,6 +2645,20 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recompressor[0]) {
+		zram->recomp = zcomp_create(zram->recompressor);
+		if (IS_ERR(zram->recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recompressor);
+			err = PTR_ERR(zram->recomp);
+			zram->recomp = NULL;
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+	}
+#endif
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1857,6 +2758,7 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(read_around);
 static DEVICE_ATTR_RW(comp_algorithm);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
@@ -1864,6 +2766,10 @@ static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
 #endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -1874,12 +2780,17 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_read_around.attr,
 	&dev_attr_comp_algorithm.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
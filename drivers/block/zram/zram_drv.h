@@ -41,6 +41,17 @@
  */
 #define ZRAM_FLAG_SHIFT 24
 
+/*
+ * The top ZRAM_ACCESS_BITS of the object size field hold a saturating
+ * per-slot access counter. It is bumped on every access and halved by
+ * each idle marking pass, so it approximates how hot a slot has been
+ * recently. The object size (at most PAGE_SIZE) fits comfortably below.
+ */
+#define ZRAM_ACCESS_BITS	4
+#define ZRAM_ACCESS_SHIFT	(ZRAM_FLAG_SHIFT - ZRAM_ACCESS_BITS)
+#define ZRAM_ACCESS_MAX		((1UL << ZRAM_ACCESS_BITS) - 1)
+#define ZRAM_OBJ_SIZE_MASK	(BIT(ZRAM_ACCESS_SHIFT) - 1)
+
 /* Flags for zram pages (table[page_no].flags) */
 enum zram_pageflags {
 	/* zram slot is locked */
@@ -50,10 +61,17 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page is encoded by the secondary algorithm */
+	ZRAM_INCOMPRESSIBLE,	/* recompression did not save any space */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
+/* Upper bound of /sys/block/zramX/read_around */
+#define ZRAM_RA_MAX		8
+/* Buckets of the read-around invalidation sequence, a power of two */
+#define ZRAM_RA_SEQ_BUCKETS	64
+
 /*-- Data structures */
 
 /* Allocated for each disk page */
@@ -68,6 +86,25 @@ struct zram_table_entry {
 #endif
 };
 
+/*
+ * A slot decompressed ahead of time by read-around. It is valid only
+ * while the invalidation sequence of its bucket still equals @seq.
+ */
+struct zram_ra_entry {
+	u32 index;
+	u32 seq;
+	bool valid;
+	struct page *page;
+};
+
+/* Per-CPU read-around cache, direct-mapped by slot index */
+struct zram_ra_cache {
+	/* The members below are protected by ->lock */
+	local_lock_t lock;
+	u32 last_index;
+	struct zram_ra_entry ent[ZRAM_RA_MAX];
+};
+
 struct zram_stats {
 	atomic64_t compr_data_size;	/* compressed size of pages stored */
 	atomic64_t num_reads;	/* failed + successful */
@@ -82,10 +119,15 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t ra_hits;		/* no. of reads served by read-around */
+	atomic64_t ra_misses;		/* no. of reads not in read-around */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
+	atomic64_t bd_wb_bios;		/* no. of writeback bios submitted */
+	atomic64_t bd_wb_remaining;	/* slots left to scan by writeback */
+	atomic64_t bd_wb_kbps;		/* KiB/s of the last writeback */
 #endif
 };
 
@@ -100,6 +142,13 @@ struct zram {
 	 * the number of pages zram can consume for storing compressed data
 	 */
 	unsigned long limit_pages;
+	/*
+	 * Number of slots decompressed ahead of a sequential read,
+	 * 0 disables read-around.
+	 */
+	unsigned int ra_pages;
+	struct zram_ra_cache __percpu *ra_cache;
+	atomic_t ra_seq[ZRAM_RA_SEQ_BUCKETS];
 
 	struct zram_stats stats;
 	/*
@@ -108,6 +157,14 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	/*
+	 * Optional secondary algorithm used by recompress_store for idle
+	 * or huge slots. Empty string if none was configured.
+	 */
+	struct zcomp *recomp;
+	char recompressor[CRYPTO_MAX_ALG_NAME];
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
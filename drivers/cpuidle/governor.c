@@ -10,9 +10,11 @@
 
 #include <linux/cpu.h>
 #include <linux/cpuidle.h>
+#include <linux/interrupt.h>
 #include <linux/mutex.h>
 #include <linux/module.h>
 #include <linux/pm_qos.h>
+#include <linux/sched/clock.h>
 
 #include "cpuidle.h"
 
@@ -120,3 +122,32 @@ s64 cpuidle_governor_latency_req(unsigned int cpu)
 	return (s64)device_req * NSEC_PER_USEC;
 }
 EXPORT_SYMBOL_GPL(cpuidle_governor_latency_req);
+
+#ifdef CONFIG_CPU_IDLE_GOV_IRQ_TIMINGS
+/**
+ * cpuidle_governor_irq_next_ns - Time till the next predicted device IRQ
+ *
+ * Return the time in ns until the earliest interrupt predicted by the IRQ
+ * timings of the local CPU, or U64_MAX if none is predictable. An overdue
+ * prediction is treated as unpredictable, as the source most likely went
+ * quiet. Consumes the timings recorded since the previous call, so it is
+ * meant to be called once per idle state selection, with interrupts off.
+ */
+u64 cpuidle_governor_irq_next_ns(void)
+{
+	u64 now = local_clock();
+	u64 next = irq_timings_next_event(now);
+
+	if (next == U64_MAX || next <= now)
+		return U64_MAX;
+
+	return next - now;
+}
+
+static int __init cpuidle_irq_timings_init(void)
+{
+	irq_timings_enable();
+	return 0;
+}
+core_initcall(cpuidle_irq_timings_init);
+#endif
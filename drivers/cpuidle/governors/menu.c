@@ -319,7 +319,12 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		 */
 		if (predicted_ns < TICK_NSEC)
 			predicted_ns = delta_next;
-	} else {
+	}
+
+	/* A predictable device interrupt ends the idle period too. */
+	predicted_ns = min(predicted_ns, cpuidle_governor_irq_next_ns());
+
+	if (!tick_nohz_tick_stopped()) {
 		/*
 		 * Use the performance multiplier and the user-configurable
 		 * latency_req to determine the maximum exit latency.
@@ -257,6 +257,12 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
 
+	/*
+	 * Only the timer based sleep length is used for the metrics updates,
+	 * but a predictable device interrupt ends the idle period too.
+	 */
+	duration_ns = min(duration_ns, cpuidle_governor_irq_next_ns());
+
 	hits = 0;
 	misses = 0;
 	early_hits = 0;
@@ -11,15 +11,42 @@
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/arm-smccc.h>
+#include <linux/cpufreq.h>
+#include <linux/of.h>
 #include <linux/soc/mediatek/mtk_dvfsrc.h>
 #include <linux/soc/mediatek/mtk_sip_svc.h>
 
+#include "governor.h"
+
 /* Query available frequencies. */
 #define DVFSRC_DDR_DVFS_GET_FREQ_COUNT	0x7
 #define DVFSRC_DDR_DVFS_GET_FREQ_INFO	0x5
 
 #define MAX_FREQ_COUNT 12
 
+#define DVFSRC_GOV_PASSIVE	"mtk_dvfsrc_passive"
+#define DVFSRC_MAX_INPUTS	8
+#define DVFSRC_LOAD_SCALE	1024
+#define DVFSRC_DEFAULT_WEIGHT	50
+#define DVFSRC_DEFAULT_POLL_MS	20
+
+enum dvfsrc_input_type {
+	DVFSRC_INPUT_CPU,
+	DVFSRC_INPUT_DEVFREQ,
+};
+
+/*
+ * One load source the passive governor follows: either a cpufreq policy,
+ * identified by its first cpu, or a parent devfreq device (GPU, MM) taken
+ * from the "devfreq" phandle list.
+ */
+struct dvfsrc_input {
+	enum dvfsrc_input_type type;
+	unsigned int cpu;
+	struct devfreq *parent;
+	u32 weight;
+};
+
 struct dvfsrc_devfreq {
 	struct devfreq_dev_profile profile;
 	struct devfreq *devfreq;
@@ -27,6 +54,10 @@ struct dvfsrc_devfreq {
 	int freq_count;
 	unsigned long freq_table[MAX_FREQ_COUNT];
 	unsigned long rate;
+	int num_inputs;
+	struct dvfsrc_input inputs[DVFSRC_MAX_INPUTS];
+	unsigned int last_load;
+	bool passive;
 };
 
 static void dvfsrc_set_freq_level(struct dvfsrc_devfreq *dvfsrc,
@@ -113,6 +144,173 @@ static int dvfsrc_devfreq_get_dev_status(struct device *dev, struct devfreq_dev_
 	return 0;
 }
 
+static unsigned int dvfsrc_input_load(struct dvfsrc_input *in)
+{
+	unsigned long cur, max;
+
+	if (in->type == DVFSRC_INPUT_CPU) {
+		cur = cpufreq_quick_get(in->cpu);
+		max = cpufreq_quick_get_max(in->cpu);
+	} else {
+		cur = in->parent->previous_freq;
+		max = in->parent->scaling_max_freq;
+	}
+
+	if (!max || !cur)
+		return 0;
+
+	return min_t(unsigned long, cur, max) * DVFSRC_LOAD_SCALE / max;
+}
+
+/*
+ * Weighted sum of the operating points of every input, relative to their
+ * maximum. Frequencies are sampled rather than taken from notifiers since
+ * fast-switching cpufreq governors skip the transition notifier chain.
+ */
+static unsigned int dvfsrc_aggregate_load(struct dvfsrc_devfreq *dvfsrc)
+{
+	unsigned int load = 0;
+	int i;
+
+	for (i = 0; i < dvfsrc->num_inputs; i++)
+		load += dvfsrc_input_load(&dvfsrc->inputs[i]) *
+			dvfsrc->inputs[i].weight / 100;
+
+	return min_t(unsigned int, load, DVFSRC_LOAD_SCALE);
+}
+
+/*
+ * One-step linear extrapolation: while the aggregate is rising, vote for
+ * where it will be at the next sample so DRAM is already up when the burst
+ * lands. On the way down, halve the distance per sample to avoid bouncing
+ * between levels on noisy inputs.
+ */
+static unsigned int dvfsrc_predict_load(struct dvfsrc_devfreq *dvfsrc,
+					unsigned int load)
+{
+	unsigned int last = dvfsrc->last_load;
+	unsigned int pred;
+
+	dvfsrc->last_load = load;
+
+	if (load >= last)
+		pred = load + (load - last);
+	else
+		pred = load + (last - load) / 2;
+
+	return min_t(unsigned int, pred, DVFSRC_LOAD_SCALE);
+}
+
+static int dvfsrc_gov_get_target_freq(struct devfreq *devfreq,
+				      unsigned long *freq)
+{
+	struct dvfsrc_devfreq *dvfsrc = dev_get_drvdata(devfreq->dev.parent);
+	unsigned long max_freq = dvfsrc->freq_table[dvfsrc->freq_count - 1];
+	unsigned int load;
+
+	load = dvfsrc_predict_load(dvfsrc, dvfsrc_aggregate_load(dvfsrc));
+	*freq = max_freq / DVFSRC_LOAD_SCALE * load;
+
+	return 0;
+}
+
+static int dvfsrc_gov_event_handler(struct devfreq *devfreq,
+				    unsigned int event, void *data)
+{
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		devfreq_monitor_start(devfreq);
+		break;
+	case DEVFREQ_GOV_STOP:
+		devfreq_monitor_stop(devfreq);
+		break;
+	case DEVFREQ_GOV_UPDATE_INTERVAL:
+		devfreq_update_interval(devfreq, (unsigned int *)data);
+		break;
+	case DEVFREQ_GOV_SUSPEND:
+		devfreq_monitor_suspend(devfreq);
+		break;
+	case DEVFREQ_GOV_RESUME:
+		devfreq_monitor_resume(devfreq);
+		break;
+	}
+
+	return 0;
+}
+
+static struct devfreq_governor dvfsrc_passive_governor = {
+	.name = DVFSRC_GOV_PASSIVE,
+	.get_target_freq = dvfsrc_gov_get_target_freq,
+	.event_handler = dvfsrc_gov_event_handler,
+	/* looks up drvdata, must never be picked for another device */
+	.immutable = 1,
+};
+
+static int dvfsrc_add_input(struct device *dev, struct dvfsrc_input *in)
+{
+	struct dvfsrc_devfreq *dvfsrc = dev_get_drvdata(dev);
+	int idx = dvfsrc->num_inputs;
+
+	if (idx >= DVFSRC_MAX_INPUTS) {
+		dev_warn(dev, "too many load inputs, ignoring the rest\n");
+		return -ENOSPC;
+	}
+
+	in->weight = DVFSRC_DEFAULT_WEIGHT;
+	of_property_read_u32_index(dev->of_node, "mediatek,input-weights",
+				   idx, &in->weight);
+	dvfsrc->inputs[idx] = *in;
+	dvfsrc->num_inputs++;
+
+	return 0;
+}
+
+/*
+ * Inputs are numbered cpufreq policies first, in cpu order, then the
+ * "devfreq" phandles; "mediatek,input-weights" gives one percentage per
+ * input in that order. Multimedia bandwidth votes are not an input: they
+ * already reach the DVFSRC through the interconnect path and are max'ed
+ * against this floor in hardware.
+ */
+static int dvfsrc_init_inputs(struct device *dev)
+{
+	struct dvfsrc_input in;
+	struct cpufreq_policy *policy;
+	struct devfreq *parent;
+	unsigned int cpu;
+	bool first;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		first = policy->cpu == cpu;
+		cpufreq_cpu_put(policy);
+		if (!first)
+			continue;
+
+		in = (struct dvfsrc_input){ .type = DVFSRC_INPUT_CPU,
+					    .cpu = cpu };
+		if (dvfsrc_add_input(dev, &in))
+			break;
+	}
+
+	for (i = 0; ; i++) {
+		parent = devfreq_get_devfreq_by_phandle(dev, "devfreq", i);
+		if (PTR_ERR(parent) == -EPROBE_DEFER)
+			return -EPROBE_DEFER;
+		if (IS_ERR(parent))
+			break;
+		in = (struct dvfsrc_input){ .type = DVFSRC_INPUT_DEVFREQ,
+					    .parent = parent };
+		if (dvfsrc_add_input(dev, &in))
+			break;
+	}
+
+	return 0;
+}
+
 static int dvfsrc_init_freq_info(struct device *dev)
 {
 	struct dvfsrc_devfreq *dvfsrc = dev_get_drvdata(dev);
@@ -168,6 +366,26 @@ static int dvfsrc_devfreq_probe(struct platform_device *pdev)
 		goto err_free_opp;
 	}
 	dvfsrc->ctrl_dev = dev->parent;
+
+	dvfsrc->passive = of_property_read_bool(dev->of_node,
+						"mediatek,passive-load");
+	if (dvfsrc->passive) {
+		ret = dvfsrc_init_inputs(dev);
+		if (ret)
+			goto err_free_opp;
+
+		ret = devfreq_add_governor(&dvfsrc_passive_governor);
+		if (ret) {
+			dev_err(dev, "failed to add passive governor: %d\n", ret);
+			goto err_free_opp;
+		}
+
+		gov = DVFSRC_GOV_PASSIVE;
+		dvfsrc->profile.polling_ms = DVFSRC_DEFAULT_POLL_MS;
+		of_property_read_u32(dev->of_node, "mediatek,polling-ms",
+				     &dvfsrc->profile.polling_ms);
+		dvfsrc->profile.timer = DEVFREQ_TIMER_DELAYED;
+	}
 	dvfsrc->profile.target = dvfsrc_devfreq_target;
 	dvfsrc->profile.get_cur_freq = dvfsrc_devfreq_get_cur_freq;
 	dvfsrc->profile.get_dev_status = dvfsrc_devfreq_get_dev_status;
@@ -178,10 +396,14 @@ static int dvfsrc_devfreq_probe(struct platform_device *pdev)
 	if (IS_ERR(dvfsrc->devfreq)) {
 		ret = PTR_ERR(dvfsrc->devfreq);
 		dev_err(dev, "failed to add devfreq device: %d\n", ret);
-		goto err_free_opp;
+		goto err_remove_gov;
 	}
 	return 0;
 
+err_remove_gov:
+	if (dvfsrc->passive)
+		devfreq_remove_governor(&dvfsrc_passive_governor);
+
 err_free_opp:
 	dev_pm_opp_remove_all_dynamic(dev);
 
@@ -193,6 +415,8 @@ static int dvfsrc_devfreq_remove(struct platform_device *pdev)
 	struct dvfsrc_devfreq *dvfsrc = platform_get_drvdata(pdev);
 
 	devfreq_remove_device(dvfsrc->devfreq);
+	if (dvfsrc->passive)
+		devfreq_remove_governor(&dvfsrc_passive_governor);
 	dev_pm_opp_remove_all_dynamic(&pdev->dev);
 
 	return 0;
@@ -1387,6 +1387,46 @@ int dma_buf_get_uuid(struct dma_buf *dmabuf, uuid_t *uuid)
 }
 EXPORT_SYMBOL_GPL(dma_buf_get_uuid);
 
+/*
+ * Free pages cached by the dma-buf heap page pools and by GPU drivers'
+ * page pools count against one budget, so that several pool
+ * implementations don't each hold on to their own share of memory.
+ * A budget of 0 leaves the pools to their own limits.
+ */
+static atomic_long_t dma_buf_pool_pages = ATOMIC_LONG_INIT(0);
+static unsigned long dma_buf_pool_budget;
+module_param_named(pool_budget_pages, dma_buf_pool_budget, ulong, 0644);
+MODULE_PARM_DESC(pool_budget_pages,
+		 "Most free pages all buffer page pools together may cache (0 = no limit)");
+
+/**
+ * dma_buf_pool_account - account pages entering or leaving a page pool
+ * @nr_pages:	number of PAGE_SIZE pages, negative when leaving the pool
+ */
+void dma_buf_pool_account(long nr_pages)
+{
+	atomic_long_add(nr_pages, &dma_buf_pool_pages);
+}
+EXPORT_SYMBOL_GPL(dma_buf_pool_account);
+
+/**
+ * dma_buf_pool_excess - pages all page pools together hold over the budget
+ *
+ * Pools check this before caching a freed page and free pages directly,
+ * or trim themselves by the returned amount, while it is non-zero.
+ */
+unsigned long dma_buf_pool_excess(void)
+{
+	unsigned long budget = READ_ONCE(dma_buf_pool_budget);
+	long pages = atomic_long_read(&dma_buf_pool_pages);
+
+	if (!budget || pages <= (long)budget)
+		return 0;
+
+	return pages - budget;
+}
+EXPORT_SYMBOL_GPL(dma_buf_pool_excess);
+
 #ifdef CONFIG_DEBUG_FS
 static int dma_buf_debug_show(struct seq_file *s, void *unused)
 {
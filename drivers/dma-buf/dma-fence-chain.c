@@ -28,6 +28,28 @@ static struct dma_fence *dma_fence_chain_get_prev(struct dma_fence_chain *chain)
 	return prev;
 }
 
+/**
+ * dma_fence_chain_mark_signaled - remember how far the timeline has signaled
+ * @chain: chain node to update
+ * @seqno: point known to be signaled together with everything before it
+ *
+ * The cached point only moves forward. Losing a race against a concurrent
+ * update merely leaves a lower, still correct, value behind.
+ */
+static void dma_fence_chain_mark_signaled(struct dma_fence_chain *chain,
+					  uint64_t seqno)
+{
+	s64 old = atomic64_read(&chain->signaled_seqno);
+
+	while ((u64)old < seqno) {
+		s64 cur = atomic64_cmpxchg(&chain->signaled_seqno, old, seqno);
+
+		if (cur == old)
+			break;
+		old = cur;
+	}
+}
+
 /**
  * dma_fence_chain_walk - chain walking function
  * @fence: current chain node
@@ -98,11 +120,25 @@ int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 	if (!chain || chain->base.seqno < seqno)
 		return -EINVAL;
 
+	/*
+	 * Waits on points which already passed are the common case for
+	 * timeline syncobjs, answer them without walking the chain.
+	 */
+	if (seqno <= (u64)atomic64_read(&chain->signaled_seqno)) {
+		dma_fence_put(*pfence);
+		*pfence = NULL;
+		return 0;
+	}
+
 	dma_fence_chain_for_each(*pfence, &chain->base) {
 		if ((*pfence)->context != chain->base.context ||
 		    to_dma_fence_chain(*pfence)->prev_seqno < seqno)
 			break;
 	}
+
+	/* the walk collected everything up to seqno, all of it signaled */
+	if (!*pfence)
+		dma_fence_chain_mark_signaled(chain, seqno);
 	dma_fence_put(&chain->base);
 
 	return 0;
@@ -163,6 +199,11 @@ static bool dma_fence_chain_enable_signaling(struct dma_fence *fence)
 
 static bool dma_fence_chain_signaled(struct dma_fence *fence)
 {
+	struct dma_fence_chain *head = to_dma_fence_chain(fence);
+
+	if (head->base.seqno <= (u64)atomic64_read(&head->signaled_seqno))
+		return true;
+
 	dma_fence_chain_for_each(fence, fence) {
 		struct dma_fence_chain *chain = to_dma_fence_chain(fence);
 		struct dma_fence *f = chain ? chain->fence : fence;
@@ -173,6 +214,7 @@ static bool dma_fence_chain_signaled(struct dma_fence *fence)
 		}
 	}
 
+	dma_fence_chain_mark_signaled(head, head->base.seqno);
 	return true;
 }
 
@@ -239,6 +281,7 @@ void dma_fence_chain_init(struct dma_fence_chain *chain,
 	rcu_assign_pointer(chain->prev, prev);
 	chain->fence = fence;
 	chain->prev_seqno = 0;
+	atomic64_set(&chain->signaled_seqno, 0);
 	init_irq_work(&chain->work, dma_fence_chain_irq_work);
 
 	/* Try to reuse the context of the previous chain node. */
@@ -9,7 +9,9 @@
  */
 
 #include <linux/freezer.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/sched/signal.h>
@@ -22,6 +24,18 @@ wait_queue_head_t freelist_waitqueue;
 struct task_struct *freelist_task;
 static DEFINE_SPINLOCK(free_list_lock);
 
+/*
+ * The worker takes items off the list a batch at a time and gives the CPU
+ * up for a tick once it has been freeing for budget_us in one go, so that
+ * tearing down a large set of buffers doesn't monopolize a core. A budget
+ * of 0 means no limit.
+ */
+#define DEFERRED_FREE_BATCH_PAGES	512
+
+static unsigned int budget_us = 2000;
+module_param(budget_us, uint, 0644);
+MODULE_PARM_DESC(budget_us, "Time the free worker may run before yielding, in usecs (0 = no limit)");
+
 void deferred_free(struct deferred_freelist_item *item,
 		   void (*free)(struct deferred_freelist_item*,
 				enum df_reason),
@@ -34,7 +48,7 @@ void deferred_free(struct deferred_freelist_item *item,
 	item->free = free;
 
 	spin_lock_irqsave(&free_list_lock, flags);
-	list_add(&item->list, &free_list);
+	list_add_tail(&item->list, &free_list);
 	list_nr_pages += nr_pages;
 	spin_unlock_irqrestore(&free_list_lock, flags);
 	wake_up(&freelist_waitqueue);
@@ -62,6 +76,31 @@ static size_t free_one_item(enum df_reason reason)
 	return nr_pages;
 }
 
+/* free the oldest items, up to @max_pages worth but at least one */
+static size_t free_batch(enum df_reason reason, size_t max_pages)
+{
+	struct deferred_freelist_item *item, *tmp;
+	unsigned long flags;
+	size_t nr_pages = 0;
+	LIST_HEAD(batch);
+
+	spin_lock_irqsave(&free_list_lock, flags);
+	list_for_each_entry_safe(item, tmp, &free_list, list) {
+		if (nr_pages && nr_pages + item->nr_pages > max_pages)
+			break;
+		list_move_tail(&item->list, &batch);
+		nr_pages += item->nr_pages;
+	}
+	list_nr_pages -= nr_pages;
+	spin_unlock_irqrestore(&free_list_lock, flags);
+
+	list_for_each_entry_safe(item, tmp, &batch, list) {
+		list_del(&item->list);
+		item->free(item, reason);
+	}
+	return nr_pages;
+}
+
 unsigned long get_freelist_nr_pages(void)
 {
 	unsigned long nr_pages;
@@ -110,10 +149,21 @@ static struct shrinker freelist_shrinker = {
 static int deferred_free_thread(void *data)
 {
 	while (true) {
+		u64 start, budget;
+
 		wait_event_freezable(freelist_waitqueue,
 				     get_freelist_nr_pages() > 0);
 
-		free_one_item(DF_NORMAL);
+		start = ktime_get_ns();
+		while (free_batch(DF_NORMAL, DEFERRED_FREE_BATCH_PAGES)) {
+			budget = (u64)READ_ONCE(budget_us) * NSEC_PER_USEC;
+			if (!budget || ktime_get_ns() - start < budget) {
+				cond_resched();
+				continue;
+			}
+			freezable_schedule_timeout_interruptible(1);
+			start = ktime_get_ns();
+		}
 	}
 
 	return 0;
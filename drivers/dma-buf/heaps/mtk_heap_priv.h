@@ -51,6 +51,8 @@ struct dma_heap_attachment {
 	bool mapped;
 
 	bool uncached;
+	/* @table is the buffer's per-domain iova cache entry, not ours */
+	bool cached_table;
 };
 
 struct mtk_heap_dev_info {
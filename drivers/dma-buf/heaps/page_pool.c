@@ -8,22 +8,61 @@
  * Copyright (C) 2011 Google, Inc.
  */
 
+#include <linux/dma-buf.h>
 #include <linux/freezer.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/kthread.h>
 #include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/sched/signal.h>
+#include <linux/sysfs.h>
+#include <linux/wait.h>
 #include "page_pool.h"
 
 static LIST_HEAD(pool_list);
 static DEFINE_MUTEX(pool_list_lock);
 
+/*
+ * Pools with background refill enabled are topped up by a low priority
+ * thread to a target derived from how many pages were recently taken from
+ * them, so bursts of high-order allocations find pre-zeroed pages instead
+ * of stalling in compaction. The list has its own lock because the thread
+ * allocates, and may enter direct reclaim, with it held.
+ */
+static LIST_HEAD(refill_list);
+static DEFINE_MUTEX(refill_lock);
+static DECLARE_WAIT_QUEUE_HEAD(refill_waitqueue);
+static struct task_struct *refill_task;
+static struct kset *refill_kset;
+static bool refill_kicked;
+static unsigned long last_shrink_jiffies;
+
+#define DMABUF_POOL_REFILL_PERIOD	HZ
+/* after the shrinker took pages back, leave the pools alone for a while */
+#define DMABUF_POOL_REFILL_BACKOFF	(5 * HZ)
+
 static inline
 struct page *dmabuf_page_pool_alloc_pages(struct dmabuf_page_pool *pool)
 {
+	struct page *page;
+	u64 start, us;
+
 	if (fatal_signal_pending(current))
 		return NULL;
-	return alloc_pages(pool->gfp_mask, pool->order);
+
+	start = ktime_get_ns();
+	page = alloc_pages(pool->gfp_mask, pool->order);
+	us = (ktime_get_ns() - start) / NSEC_PER_USEC;
+
+	atomic_long_inc(&pool->alloc_lat[min_t(unsigned int, fls64(us),
+					       DMABUF_POOL_LAT_BUCKETS - 1)]);
+	if (!page)
+		atomic_long_inc(&pool->alloc_fails);
+	return page;
 }
 
 static inline void dmabuf_page_pool_free_pages(struct dmabuf_page_pool *pool,
@@ -32,7 +71,8 @@ static inline void dmabuf_page_pool_free_pages(struct dmabuf_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static void dmabuf_page_pool_add(struct dmabuf_page_pool *pool, struct page *page)
+static void __dmabuf_page_pool_add(struct dmabuf_page_pool *pool,
+				   struct page *page)
 {
 	int index;
 
@@ -41,31 +81,80 @@ static void dmabuf_page_pool_add(struct dmabuf_page_pool *pool, struct page *pag
 	else
 		index = POOL_LOWPAGE;
 
-	mutex_lock(&pool->mutex);
 	list_add_tail(&page->lru, &pool->items[index]);
 	pool->count[index]++;
 	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
 			    1 << pool->order);
+	dma_buf_pool_account(1 << pool->order);
+}
+
+static void dmabuf_page_pool_add(struct dmabuf_page_pool *pool, struct page *page)
+{
+	mutex_lock(&pool->mutex);
+	__dmabuf_page_pool_add(pool, page);
 	mutex_unlock(&pool->mutex);
 }
 
-static struct page *dmabuf_page_pool_remove(struct dmabuf_page_pool *pool, int index)
+static void dmabuf_page_pool_add_batch(struct dmabuf_page_pool *pool,
+				       struct page **pages, unsigned int nr)
 {
-	struct page *page;
+	unsigned int i;
 
 	mutex_lock(&pool->mutex);
+	for (i = 0; i < nr; i++)
+		__dmabuf_page_pool_add(pool, pages[i]);
+	mutex_unlock(&pool->mutex);
+}
+
+static struct page *__dmabuf_page_pool_remove(struct dmabuf_page_pool *pool,
+					      int index)
+{
+	struct page *page;
+
 	page = list_first_entry_or_null(&pool->items[index], struct page, lru);
 	if (page) {
 		pool->count[index]--;
 		list_del(&page->lru);
 		mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
 				    -(1 << pool->order));
+		dma_buf_pool_account(-(1 << pool->order));
 	}
+	return page;
+}
+
+static struct page *dmabuf_page_pool_remove(struct dmabuf_page_pool *pool, int index)
+{
+	struct page *page;
+
+	mutex_lock(&pool->mutex);
+	page = __dmabuf_page_pool_remove(pool, index);
 	mutex_unlock(&pool->mutex);
 
 	return page;
 }
 
+static unsigned int dmabuf_page_pool_fetch_batch(struct dmabuf_page_pool *pool,
+						 struct page **pages,
+						 unsigned int nr)
+{
+	unsigned int n = 0;
+
+	mutex_lock(&pool->mutex);
+	while (n < nr) {
+		struct page *page;
+
+		page = __dmabuf_page_pool_remove(pool, POOL_HIGHPAGE);
+		if (!page)
+			page = __dmabuf_page_pool_remove(pool, POOL_LOWPAGE);
+		if (!page)
+			break;
+		pages[n++] = page;
+	}
+	mutex_unlock(&pool->mutex);
+
+	return n;
+}
+
 static struct page *dmabuf_page_pool_fetch(struct dmabuf_page_pool *pool)
 {
 	struct page *page = NULL;
@@ -77,6 +166,167 @@ static struct page *dmabuf_page_pool_fetch(struct dmabuf_page_pool *pool)
 	return page;
 }
 
+/*
+ * Pools of small pages get a per-CPU magazine in front of the shared
+ * lists, so that threads allocating and freeing on different CPUs don't
+ * all serialize on pool->mutex. Magazines trade pages with the shared
+ * lists in batches, and the shrinker drains them back again.
+ */
+#define DMABUF_POOL_MAG_MAX	32
+#define DMABUF_POOL_MAG_BYTES	SZ_256K
+
+struct dmabuf_page_pool_mag {
+	spinlock_t lock;
+	unsigned int count;
+	struct page *pages[DMABUF_POOL_MAG_MAX];
+};
+
+static unsigned int dmabuf_page_pool_mag_take(struct dmabuf_page_pool *pool,
+					      struct dmabuf_page_pool_mag *mag,
+					      struct page **pages,
+					      unsigned int nr)
+{
+	unsigned int n = 0;
+
+	spin_lock(&mag->lock);
+	while (n < nr && mag->count) {
+		struct page *page = mag->pages[--mag->count];
+
+		mod_node_page_state(page_pgdat(page),
+				    NR_KERNEL_MISC_RECLAIMABLE,
+				    -(1 << pool->order));
+		dma_buf_pool_account(-(1 << pool->order));
+		pages[n++] = page;
+	}
+	spin_unlock(&mag->lock);
+
+	return n;
+}
+
+static unsigned int dmabuf_page_pool_mag_take_local(struct dmabuf_page_pool *pool,
+						    struct page **pages,
+						    unsigned int nr)
+{
+	unsigned int n;
+
+	n = dmabuf_page_pool_mag_take(pool, get_cpu_ptr(pool->mags), pages, nr);
+	put_cpu_ptr(pool->mags);
+	return n;
+}
+
+/* returns how many of the @nr pages, from the start of @pages, didn't fit */
+static unsigned int dmabuf_page_pool_mag_put_local(struct dmabuf_page_pool *pool,
+						   struct page **pages,
+						   unsigned int nr)
+{
+	struct dmabuf_page_pool_mag *mag = get_cpu_ptr(pool->mags);
+
+	spin_lock(&mag->lock);
+	while (nr && mag->count < pool->mag_size) {
+		struct page *page = pages[--nr];
+
+		mod_node_page_state(page_pgdat(page),
+				    NR_KERNEL_MISC_RECLAIMABLE,
+				    1 << pool->order);
+		dma_buf_pool_account(1 << pool->order);
+		mag->pages[mag->count++] = page;
+	}
+	spin_unlock(&mag->lock);
+	put_cpu_ptr(pool->mags);
+
+	return nr;
+}
+
+static struct page *dmabuf_page_pool_mag_alloc(struct dmabuf_page_pool *pool)
+{
+	struct page *batch[DMABUF_POOL_MAG_MAX / 2 + 1];
+	unsigned int n, left;
+
+	if (dmabuf_page_pool_mag_take_local(pool, batch, 1))
+		return batch[0];
+
+	/* refill half the magazine with a single trip to the shared lists */
+	n = dmabuf_page_pool_fetch_batch(pool, batch, pool->mag_size / 2 + 1);
+	if (!n)
+		return NULL;
+
+	left = dmabuf_page_pool_mag_put_local(pool, batch + 1, n - 1);
+	if (left)
+		dmabuf_page_pool_add_batch(pool, batch + 1, left);
+	return batch[0];
+}
+
+static void dmabuf_page_pool_mag_free(struct dmabuf_page_pool *pool,
+				      struct page *page)
+{
+	struct page *batch[DMABUF_POOL_MAG_MAX / 2 + 1];
+	unsigned int n;
+
+	if (!dmabuf_page_pool_mag_put_local(pool, &page, 1))
+		return;
+
+	/* full: hand half of it back together with this page */
+	n = dmabuf_page_pool_mag_take_local(pool, batch, pool->mag_size / 2);
+	batch[n++] = page;
+	dmabuf_page_pool_add_batch(pool, batch, n);
+}
+
+static void dmabuf_page_pool_drain_mags(struct dmabuf_page_pool *pool)
+{
+	struct page *batch[DMABUF_POOL_MAG_MAX];
+	unsigned int n;
+	int cpu;
+
+	if (!pool->mags)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		n = dmabuf_page_pool_mag_take(pool,
+					      per_cpu_ptr(pool->mags, cpu),
+					      batch, DMABUF_POOL_MAG_MAX);
+		if (n)
+			dmabuf_page_pool_add_batch(pool, batch, n);
+	}
+}
+
+static int dmabuf_page_pool_mag_total(struct dmabuf_page_pool *pool)
+{
+	int count = 0;
+	int cpu;
+
+	if (!pool->mags)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->mags, cpu)->count);
+	return count;
+}
+
+static int dmabuf_page_pool_count(struct dmabuf_page_pool *pool)
+{
+	return READ_ONCE(pool->count[POOL_LOWPAGE]) +
+	       READ_ONCE(pool->count[POOL_HIGHPAGE]);
+}
+
+static unsigned int dmabuf_page_pool_refill_target(struct dmabuf_page_pool *pool)
+{
+	return clamp(READ_ONCE(pool->alloc_rate), READ_ONCE(pool->refill_low),
+		     READ_ONCE(pool->refill_high));
+}
+
+static void dmabuf_page_pool_kick_refill(struct dmabuf_page_pool *pool)
+{
+	if (!READ_ONCE(pool->refill_high))
+		return;
+
+	atomic_inc(&pool->nr_allocs);
+	if (dmabuf_page_pool_count(pool) * 2 <
+	    dmabuf_page_pool_refill_target(pool) && !READ_ONCE(refill_kicked)) {
+		WRITE_ONCE(refill_kicked, true);
+		wake_up(&refill_waitqueue);
+	}
+}
+
 struct page *dmabuf_page_pool_alloc(struct dmabuf_page_pool *pool)
 {
 	struct page *page = NULL;
@@ -84,11 +334,19 @@ struct page *dmabuf_page_pool_alloc(struct dmabuf_page_pool *pool)
 	if (WARN_ON(!pool))
 		return NULL;
 
-	page = dmabuf_page_pool_fetch(pool);
+	if (pool->mags)
+		page = dmabuf_page_pool_mag_alloc(pool);
+	else
+		page = dmabuf_page_pool_fetch(pool);
+	dmabuf_page_pool_kick_refill(pool);
 
-	if (!page)
-		page = dmabuf_page_pool_alloc_pages(pool);
-	return page;
+	if (page) {
+		atomic_long_inc(&pool->hits);
+		return page;
+	}
+
+	atomic_long_inc(&pool->misses);
+	return dmabuf_page_pool_alloc_pages(pool);
 }
 EXPORT_SYMBOL_GPL(dmabuf_page_pool_alloc);
 
@@ -97,13 +355,66 @@ void dmabuf_page_pool_free(struct dmabuf_page_pool *pool, struct page *page)
 	if (WARN_ON(pool->order != compound_order(page)))
 		return;
 
-	dmabuf_page_pool_add(pool, page);
+	/* all page pools together are over budget, don't cache any more */
+	if (dma_buf_pool_excess()) {
+		dmabuf_page_pool_free_pages(pool, page);
+		return;
+	}
+
+	if (pool->mags)
+		dmabuf_page_pool_mag_free(pool, page);
+	else
+		dmabuf_page_pool_add(pool, page);
 }
 EXPORT_SYMBOL_GPL(dmabuf_page_pool_free);
 
+/**
+ * dmabuf_page_pool_free_batch - return several pages to a pool at once
+ * @pool:	pool the pages belong to
+ * @pages:	pages of the pool's order
+ * @nr:		number of entries in @pages
+ *
+ * Takes the pool lock once for the lot instead of once per page.
+ */
+void dmabuf_page_pool_free_batch(struct dmabuf_page_pool *pool,
+				 struct page **pages, unsigned int nr)
+{
+	if (dma_buf_pool_excess()) {
+		while (nr)
+			dmabuf_page_pool_free_pages(pool, pages[--nr]);
+		return;
+	}
+
+	if (pool->mags)
+		nr = dmabuf_page_pool_mag_put_local(pool, pages, nr);
+	if (nr)
+		dmabuf_page_pool_add_batch(pool, pages, nr);
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_free_batch);
+
+/**
+ * dmabuf_page_pool_full - check whether a pool has pages to spare
+ * @pool:	pool to check
+ *
+ * A pool with background refill that already holds twice its refill
+ * target is more likely to give a freed page back to the shrinker than to
+ * hand it out again, so callers may just as well free such pages directly
+ * and save zeroing them first. Pools without refill are never full.
+ */
+bool dmabuf_page_pool_full(struct dmabuf_page_pool *pool)
+{
+	if (!READ_ONCE(pool->refill_high))
+		return false;
+
+	return dmabuf_page_pool_count(pool) + dmabuf_page_pool_mag_total(pool) >=
+	       2 * max(dmabuf_page_pool_refill_target(pool), 1U);
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_full);
+
 static int dmabuf_page_pool_total(struct dmabuf_page_pool *pool, bool high)
 {
-	int count = pool->count[POOL_LOWPAGE];
+	/* magazines are drained as a whole, whatever the pages' zone */
+	int count = pool->count[POOL_LOWPAGE] + dmabuf_page_pool_mag_total(pool);
 
 	if (high)
 		count += pool->count[POOL_HIGHPAGE];
@@ -113,7 +424,7 @@ static int dmabuf_page_pool_total(struct dmabuf_page_pool *pool, bool high)
 
 struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
-	struct dmabuf_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	struct dmabuf_page_pool *pool = kzalloc(sizeof(*pool), GFP_KERNEL);
 	int i;
 
 	if (!pool)
@@ -126,6 +437,27 @@ struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask, unsigned int or
 	pool->gfp_mask = gfp_mask | __GFP_COMP;
 	pool->order = order;
 	mutex_init(&pool->mutex);
+	pool->refill_low = 0;
+	pool->refill_high = 0;
+	pool->alloc_rate = 0;
+	atomic_set(&pool->nr_allocs, 0);
+	INIT_LIST_HEAD(&pool->refill_list);
+	pool->refill_kobj = NULL;
+
+	pool->mag_size = min_t(unsigned int, DMABUF_POOL_MAG_MAX,
+			       DMABUF_POOL_MAG_BYTES >> (PAGE_SHIFT + order));
+	pool->mags = NULL;
+	if (pool->mag_size >= 2)
+		pool->mags = alloc_percpu(struct dmabuf_page_pool_mag);
+	if (pool->mags) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(pool->mags, cpu)->lock);
+	} else {
+		/* fine, just go without */
+		pool->mag_size = 0;
+	}
 
 	mutex_lock(&pool_list_lock);
 	list_add(&pool->list, &pool_list);
@@ -145,16 +477,251 @@ void dmabuf_page_pool_destroy(struct dmabuf_page_pool *pool)
 	list_del(&pool->list);
 	mutex_unlock(&pool_list_lock);
 
+	mutex_lock(&refill_lock);
+	list_del(&pool->refill_list);
+	mutex_unlock(&refill_lock);
+	if (pool->refill_kobj) {
+		kobject_del(pool->refill_kobj);
+		kobject_put(pool->refill_kobj);
+	}
+
 	/* Free any remaining pages in the pool */
+	dmabuf_page_pool_drain_mags(pool);
 	for (i = 0; i < POOL_TYPE_SIZE; i++) {
 		while ((page = dmabuf_page_pool_remove(pool, i)))
 			dmabuf_page_pool_free_pages(pool, page);
 	}
 
+	free_percpu(pool->mags);
 	kfree(pool);
 }
 EXPORT_SYMBOL_GPL(dmabuf_page_pool_destroy);
 
+static void dmabuf_page_pool_update_rate(struct dmabuf_page_pool *pool)
+{
+	unsigned int allocs = atomic_xchg(&pool->nr_allocs, 0);
+	unsigned int rate = pool->alloc_rate;
+
+	/* follow bursts at once, forget them slowly */
+	rate -= DIV_ROUND_UP(rate, 8);
+	WRITE_ONCE(pool->alloc_rate, max(rate, allocs));
+}
+
+static void dmabuf_page_pool_refill(struct dmabuf_page_pool *pool)
+{
+	/* unlike the allocation path, this one can afford to compact */
+	gfp_t gfp_mask = pool->gfp_mask | __GFP_RECLAIM | __GFP_NORETRY |
+			 __GFP_NOWARN;
+
+	while (dmabuf_page_pool_count(pool) <
+	       dmabuf_page_pool_refill_target(pool)) {
+		struct page *page;
+
+		if (kthread_should_stop() || freezing(current))
+			break;
+
+		if (dma_buf_pool_excess())
+			break;
+
+		page = alloc_pages(gfp_mask, pool->order);
+		if (!page)
+			break;
+		dmabuf_page_pool_add(pool, page);
+	}
+}
+
+static int dmabuf_page_pool_refill_thread(void *data)
+{
+	unsigned long next_period = jiffies + DMABUF_POOL_REFILL_PERIOD;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		struct dmabuf_page_pool *pool;
+		bool new_period, backoff;
+
+		wait_event_freezable_timeout(refill_waitqueue,
+					     READ_ONCE(refill_kicked) ||
+					     kthread_should_stop(),
+					     DMABUF_POOL_REFILL_PERIOD);
+		WRITE_ONCE(refill_kicked, false);
+
+		new_period = time_after_eq(jiffies, next_period);
+		if (new_period)
+			next_period = jiffies + DMABUF_POOL_REFILL_PERIOD;
+		backoff = time_before(jiffies, READ_ONCE(last_shrink_jiffies) +
+				      DMABUF_POOL_REFILL_BACKOFF);
+
+		mutex_lock(&refill_lock);
+		list_for_each_entry(pool, &refill_list, refill_list) {
+			if (new_period)
+				dmabuf_page_pool_update_rate(pool);
+			if (!backoff)
+				dmabuf_page_pool_refill(pool);
+		}
+		mutex_unlock(&refill_lock);
+	}
+
+	return 0;
+}
+
+struct dmabuf_page_pool_kobj {
+	struct kobject kobj;
+	struct dmabuf_page_pool *pool;
+};
+
+static struct dmabuf_page_pool *to_pool(struct kobject *kobj)
+{
+	return container_of(kobj, struct dmabuf_page_pool_kobj, kobj)->pool;
+}
+
+static ssize_t dmabuf_page_pool_store_wm(struct kobject *kobj,
+					 const char *buf, size_t len,
+					 bool high)
+{
+	struct dmabuf_page_pool *pool = to_pool(kobj);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&refill_lock);
+	if (high ? val < pool->refill_low : val > pool->refill_high) {
+		mutex_unlock(&refill_lock);
+		return -EINVAL;
+	}
+	if (high)
+		WRITE_ONCE(pool->refill_high, val);
+	else
+		WRITE_ONCE(pool->refill_low, val);
+	mutex_unlock(&refill_lock);
+
+	WRITE_ONCE(refill_kicked, true);
+	wake_up(&refill_waitqueue);
+	return len;
+}
+
+static ssize_t low_watermark_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(to_pool(kobj)->refill_low));
+}
+
+static ssize_t low_watermark_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t len)
+{
+	return dmabuf_page_pool_store_wm(kobj, buf, len, false);
+}
+
+static ssize_t high_watermark_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(to_pool(kobj)->refill_high));
+}
+
+static ssize_t high_watermark_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t len)
+{
+	return dmabuf_page_pool_store_wm(kobj, buf, len, true);
+}
+
+static ssize_t target_show(struct kobject *kobj,
+			   struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n",
+			  dmabuf_page_pool_refill_target(to_pool(kobj)));
+}
+
+static ssize_t count_show(struct kobject *kobj,
+			  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", dmabuf_page_pool_count(to_pool(kobj)));
+}
+
+static ssize_t order_show(struct kobject *kobj,
+			  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", to_pool(kobj)->order);
+}
+
+static struct kobj_attribute low_watermark_attr = __ATTR_RW(low_watermark);
+static struct kobj_attribute high_watermark_attr = __ATTR_RW(high_watermark);
+static struct kobj_attribute target_attr = __ATTR_RO(target);
+static struct kobj_attribute count_attr = __ATTR_RO(count);
+static struct kobj_attribute order_attr = __ATTR_RO(order);
+
+static struct attribute *dmabuf_page_pool_attrs[] = {
+	&low_watermark_attr.attr,
+	&high_watermark_attr.attr,
+	&target_attr.attr,
+	&count_attr.attr,
+	&order_attr.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(dmabuf_page_pool);
+
+static void dmabuf_page_pool_kobj_release(struct kobject *kobj)
+{
+	kfree(container_of(kobj, struct dmabuf_page_pool_kobj, kobj));
+}
+
+static struct kobj_type dmabuf_page_pool_ktype = {
+	.sysfs_ops = &kobj_sysfs_ops,
+	.release = dmabuf_page_pool_kobj_release,
+	.default_groups = dmabuf_page_pool_groups,
+};
+
+/**
+ * dmabuf_page_pool_init_refill - keep a pool topped up in the background
+ * @pool:	pool to refill
+ * @name:	name of the pool's directory under /sys/kernel/dmabuf_page_pools
+ * @low:	pages (of the pool's order) to always keep in the pool
+ * @high:	most pages to keep in the pool when allocations are frequent
+ *
+ * The refill target moves between @low and @high with the number of pages
+ * recently taken from the pool per second. Both watermarks can be changed
+ * through sysfs later on.
+ */
+int dmabuf_page_pool_init_refill(struct dmabuf_page_pool *pool,
+				 const char *name, unsigned int low,
+				 unsigned int high)
+{
+	struct dmabuf_page_pool_kobj *pk;
+	int ret;
+
+	if (low > high || !refill_task)
+		return -EINVAL;
+
+	if (refill_kset) {
+		pk = kzalloc(sizeof(*pk), GFP_KERNEL);
+		if (!pk)
+			return -ENOMEM;
+		pk->pool = pool;
+		pk->kobj.kset = refill_kset;
+		ret = kobject_init_and_add(&pk->kobj, &dmabuf_page_pool_ktype,
+					   NULL, "%s", name);
+		if (ret) {
+			kobject_put(&pk->kobj);
+			return ret;
+		}
+		pool->refill_kobj = &pk->kobj;
+	}
+
+	mutex_lock(&refill_lock);
+	pool->refill_low = low;
+	pool->refill_high = high;
+	list_add_tail(&pool->refill_list, &refill_list);
+	mutex_unlock(&refill_lock);
+
+	WRITE_ONCE(refill_kicked, true);
+	wake_up(&refill_waitqueue);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dmabuf_page_pool_init_refill);
+
 static int dmabuf_page_pool_do_shrink(struct dmabuf_page_pool *pool, gfp_t gfp_mask,
 				      int nr_to_scan)
 {
@@ -169,6 +736,7 @@ static int dmabuf_page_pool_do_shrink(struct dmabuf_page_pool *pool, gfp_t gfp_m
 	if (nr_to_scan == 0)
 		return dmabuf_page_pool_total(pool, high);
 
+	dmabuf_page_pool_drain_mags(pool);
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -184,6 +752,8 @@ static int dmabuf_page_pool_do_shrink(struct dmabuf_page_pool *pool, gfp_t gfp_m
 		freed += (1 << pool->order);
 	}
 
+	if (freed)
+		WRITE_ONCE(last_shrink_jiffies, jiffies);
 	return freed;
 }
 
@@ -241,6 +811,22 @@ struct shrinker pool_shrinker = {
 
 static int dmabuf_page_pool_init_shrinker(void)
 {
+	last_shrink_jiffies = jiffies - DMABUF_POOL_REFILL_BACKOFF;
+
+	refill_kset = kset_create_and_add("dmabuf_page_pools", NULL,
+					  kernel_kobj);
+	if (!refill_kset)
+		pr_err("%s: failed to create sysfs directory\n", __func__);
+
+	refill_task = kthread_run(dmabuf_page_pool_refill_thread, NULL,
+				  "%s", "dmabuf-page-pool-refill");
+	if (IS_ERR(refill_task)) {
+		pr_err("%s: failed to start refill thread\n", __func__);
+		refill_task = NULL;
+	} else {
+		sched_set_normal(refill_task, 19);
+	}
+
 	return register_shrinker(&pool_shrinker);
 }
 module_init(dmabuf_page_pool_init_shrinker);
@@ -10,7 +10,9 @@
 #ifndef _DMABUF_PAGE_POOL_H
 #define _DMABUF_PAGE_POOL_H
 
+#include <linux/atomic.h>
 #include <linux/device.h>
+#include <linux/kobject.h>
 #include <linux/kref.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
@@ -25,6 +27,11 @@ enum {
 	POOL_TYPE_SIZE,
 };
 
+struct dmabuf_page_pool_mag;
+
+/* buddy allocation latency buckets: <1us, then powers of two up to ~16ms */
+#define DMABUF_POOL_LAT_BUCKETS	16
+
 /**
  * struct dmabuf_page_pool - pagepool struct
  * @count[]:		array of number of pages of that type in the pool
@@ -34,6 +41,19 @@ enum {
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		list node for list of pools
+ * @refill_low:		pages the refill thread always keeps in the pool
+ * @refill_high:	most pages the refill thread keeps in the pool, 0 if
+ *			background refill is disabled for this pool
+ * @alloc_rate:		decaying peak of pages taken per refill period
+ * @nr_allocs:		pages taken since the last refill period
+ * @refill_list:	list node for list of pools with background refill
+ * @refill_kobj:	sysfs directory for the refill watermarks
+ * @mags:		per-CPU page magazines in front of @items, or NULL
+ * @mag_size:		capacity of each of @mags
+ * @hits:		allocations served from the pool
+ * @misses:		allocations that had to go to the buddy allocator
+ * @alloc_fails:	buddy allocations that failed
+ * @alloc_lat:		histogram of buddy allocation latency, log2 usecs
  *
  * Allows you to keep a pool of pre allocated pages to use
  */
@@ -44,6 +64,18 @@ struct dmabuf_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct list_head list;
+	unsigned int refill_low;
+	unsigned int refill_high;
+	unsigned int alloc_rate;
+	atomic_t nr_allocs;
+	struct list_head refill_list;
+	struct kobject *refill_kobj;
+	struct dmabuf_page_pool_mag __percpu *mags;
+	unsigned int mag_size;
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t alloc_fails;
+	atomic_long_t alloc_lat[DMABUF_POOL_LAT_BUCKETS];
 };
 
 struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask,
@@ -51,5 +83,11 @@ struct dmabuf_page_pool *dmabuf_page_pool_create(gfp_t gfp_mask,
 void dmabuf_page_pool_destroy(struct dmabuf_page_pool *pool);
 struct page *dmabuf_page_pool_alloc(struct dmabuf_page_pool *pool);
 void dmabuf_page_pool_free(struct dmabuf_page_pool *pool, struct page *page);
+void dmabuf_page_pool_free_batch(struct dmabuf_page_pool *pool,
+				 struct page **pages, unsigned int nr);
+bool dmabuf_page_pool_full(struct dmabuf_page_pool *pool);
+int dmabuf_page_pool_init_refill(struct dmabuf_page_pool *pool,
+				 const char *name, unsigned int low,
+				 unsigned int high);
 
 #endif /* _DMABUF_PAGE_POOL_H */
@@ -12,14 +12,17 @@
 
 #define pr_fmt(fmt) "dma_heap: system "fmt
 
+#include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-heap.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 
@@ -80,6 +83,37 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, MID_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 struct dmabuf_page_pool *pools[NUM_ORDERS];
+/*
+ * Upper bounds, in pages of each order, on what the pools are kept topped
+ * up to in the background (16MB of 1MB pages, 4MB of 64K pages). The
+ * actual target follows recent allocation rates; order 0 pages are cheap
+ * enough to allocate on demand.
+ */
+static const unsigned int refill_high[] = {16, 64, 0};
+
+/*
+ * Per-heap allocation statistics, shown in debugfs together with those of
+ * the shared pools. A fallback is a page handed out at a lower order than
+ * the remaining size allowed, which is what fragmentation looks like from
+ * here.
+ */
+struct system_heap_stats {
+	atomic_long_t allocs;
+	atomic_long_t alloc_fails;
+	atomic_long_t fallbacks[NUM_ORDERS];
+	atomic_long_t alloc_lat[DMABUF_POOL_LAT_BUCKETS];
+};
+
+enum {
+	SYSTEM_HEAP_STATS,
+	MTK_MM_HEAP_STATS,
+	SYSTEM_UNCACHED_HEAP_STATS,
+	MTK_MM_UNCACHED_HEAP_STATS,
+
+	HEAP_STATS_NR,
+};
+
+static struct system_heap_stats heap_stats[HEAP_STATS_NR];
 
 /* function declare */
 static int system_buf_priv_dump(const struct dma_buf *dmabuf,
@@ -111,33 +145,9 @@ static struct sg_table *dup_sg_table(struct sg_table *table)
 	return new_table;
 }
 
-/* source copy to dest, no memory alloc */
-static int copy_sg_table(struct sg_table *source, struct sg_table *dest)
-{
-	int i;
-	struct scatterlist *sgl, *dest_sgl;
-
-	if (source->orig_nents != dest->orig_nents) {
-		pr_info("nents not match %d-%d\n",
-			source->orig_nents, dest->orig_nents);
-
-		return -EINVAL;
-	}
-
-	/* copy mapped nents */
-	dest->nents = source->nents;
-
-	dest_sgl = dest->sgl;
-	for_each_sg(source->sgl, sgl, source->orig_nents, i) {
-		memcpy(dest_sgl, sgl, sizeof(*sgl));
-		dest_sgl = sg_next(dest_sgl);
-	}
-
-	return 0;
-};
-
 /*
- * must check domain info before call fill_buffer_info
+ * must check domain info before call fill_buffer_info, on success the
+ * buffer takes over @table as the iova cache entry of that domain
  * @Return 0: pass
  */
 static int fill_buffer_info(struct system_heap_buffer *buffer,
@@ -146,9 +156,6 @@ static int fill_buffer_info(struct system_heap_buffer *buffer,
 			    enum dma_data_direction dir,
 			    int tab_id, int dom_id)
 {
-	struct sg_table *new_table = NULL;
-	int ret = 0;
-
 	/*
 	 * devices without iommus attribute,
 	 * use common flow, skip set buf_info
@@ -161,22 +168,7 @@ static int fill_buffer_info(struct system_heap_buffer *buffer,
 		return -EINVAL;
 	}
 
-	new_table = kzalloc(sizeof(*new_table), GFP_KERNEL);
-	if (!new_table)
-		return -ENOMEM;
-
-	ret = sg_alloc_table(new_table, table->orig_nents, GFP_KERNEL);
-	if (ret) {
-		pr_info("%s err: sg_alloc_table failed\n", __func__);
-		kfree(new_table);
-		return -ENOMEM;
-	}
-
-	ret = copy_sg_table(table, new_table);
-	if (ret)
-		return ret;
-
-	buffer->mapped_table[tab_id][dom_id] = new_table;
+	buffer->mapped_table[tab_id][dom_id] = table;
 	buffer->mapped[tab_id][dom_id] = true;
 	buffer->dev_info[tab_id][dom_id].dev = a->dev;
 	buffer->dev_info[tab_id][dom_id].direction = dir;
@@ -197,10 +189,19 @@ static int system_heap_attach(struct dma_buf *dmabuf,
 	if (!a)
 		return -ENOMEM;
 
-	table = dup_sg_table(&buffer->sg_table);
-	if (IS_ERR(table)) {
-		kfree(a);
-		return -ENOMEM;
+	/*
+	 * mtk_mm heap devices behind an iommu map through the per-domain
+	 * iova cache, so their table is only set up at map time.
+	 */
+	if (is_mtk_mm_heap_dmabuf(dmabuf) &&
+	    dev_iommu_fwspec_get(attachment->dev)) {
+		table = NULL;
+	} else {
+		table = dup_sg_table(&buffer->sg_table);
+		if (IS_ERR(table)) {
+			kfree(a);
+			return -ENOMEM;
+		}
 	}
 
 	a->table = table;
@@ -227,8 +228,11 @@ static void system_heap_detach(struct dma_buf *dmabuf,
 	list_del(&a->list);
 	mutex_unlock(&buffer->lock);
 
-	sg_free_table(a->table);
-	kfree(a->table);
+	/* cached tables are unmapped and freed with the buffer */
+	if (a->table && !a->cached_table) {
+		sg_free_table(a->table);
+		kfree(a->table);
+	}
 	kfree(a);
 }
 
@@ -254,14 +258,15 @@ static struct sg_table *mtk_mm_heap_map_dma_buf(struct dma_buf_attachment *attac
 		tab_id = MTK_M4U_TO_TAB(fwspec->ids[0]);
 	}
 
-	/* device with iommus attribute AND mapped before */
+	/*
+	 * device with iommus attribute AND mapped before: share the saved
+	 * table, its iova is valid for every device of the domain
+	 */
 	if (fwspec && buffer->mapped[tab_id][dom_id]) {
-		/* mapped before, return saved table */
-		ret = copy_sg_table(buffer->mapped_table[tab_id][dom_id], table);
-
+		table = buffer->mapped_table[tab_id][dom_id];
+		a->table = table;
+		a->cached_table = true;
 		mutex_unlock(&buffer->map_lock);
-		if (ret)
-			return ERR_PTR(-EINVAL);
 
 		a->mapped = true;
 
@@ -271,24 +276,43 @@ static struct sg_table *mtk_mm_heap_map_dma_buf(struct dma_buf_attachment *attac
 		return table;
 	}
 
+	/* first map of this domain, see system_heap_attach */
+	if (!table) {
+		table = dup_sg_table(&buffer->sg_table);
+		if (IS_ERR(table)) {
+			mutex_unlock(&buffer->map_lock);
+			return table;
+		}
+	}
+
 	/* first map OR device without iommus attribute */
 	if (dma_map_sgtable(attachment->dev, table, direction, attr)) {
 		pr_info("%s map fail tab:%d, dom:%d, dev:%s\n",
 			__func__, tab_id, dom_id, dev_name(attachment->dev));
-		mutex_unlock(&buffer->map_lock);
-		return ERR_PTR(-ENOMEM);
+		goto err_free_table;
 	}
 
 	ret = fill_buffer_info(buffer, table,
 			       attachment, direction, tab_id, dom_id);
 	if (ret) {
-		mutex_unlock(&buffer->map_lock);
-		return ERR_PTR(ret);
+		dma_unmap_sgtable(attachment->dev, table, direction, attr);
+		goto err_free_table;
 	}
+	a->table = table;
+	a->cached_table = tab_id < MTK_M4U_TAB_NR_MAX &&
+			  dom_id < MTK_M4U_DOM_NR_MAX;
 	mutex_unlock(&buffer->map_lock);
 	a->mapped = true;
 
 	return table;
+
+err_free_table:
+	if (!a->table) {
+		sg_free_table(table);
+		kfree(table);
+	}
+	mutex_unlock(&buffer->map_lock);
+	return ERR_PTR(-ENOMEM);
 }
 
 static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attachment,
@@ -502,51 +526,58 @@ static void system_heap_vunmap(struct dma_buf *dmabuf, void *vaddr)
 	mutex_unlock(&buffer->lock);
 }
 
-static int system_heap_zero_buffer(struct system_heap_buffer *buffer)
+static void system_heap_zero_page(struct page *page)
 {
-	struct sg_table *sgt = &buffer->sg_table;
-	struct sg_page_iter piter;
-	struct page *p;
-	void *vaddr;
-	int ret = 0;
+	unsigned int i;
 
-	for_each_sgtable_page(sgt, &piter, 0) {
-		p = sg_page_iter_page(&piter);
-		vaddr = kmap_atomic(p);
-		memset(vaddr, 0, PAGE_SIZE);
-		kunmap_atomic(vaddr);
-	}
-
-	return ret;
+	for (i = 0; i < compound_nr(page); i++)
+		clear_highpage(page + i);
 }
 
+#define SYSTEM_HEAP_FREE_BATCH	16
+
 static void system_heap_buf_free(struct deferred_freelist_item *item,
 				 enum df_reason reason)
 {
+	struct page *batch[NUM_ORDERS][SYSTEM_HEAP_FREE_BATCH];
+	unsigned int nr[NUM_ORDERS] = { 0 };
 	struct system_heap_buffer *buffer;
 	struct sg_table *table;
 	struct scatterlist *sg;
 	int i, j;
 
 	buffer = container_of(item, struct system_heap_buffer, deferred_free);
-	/* Zero the buffer pages before adding back to the pool */
-	if (reason == DF_NORMAL)
-		if (system_heap_zero_buffer(buffer))
-			reason = DF_UNDER_PRESSURE; // On failure, just free
 
+	/*
+	 * Only pages that really go back to a pool need zeroing: those freed
+	 * under pressure, or that a well stocked pool has no use for, go to
+	 * the buddy allocator and are zeroed again by __GFP_ZERO before reuse.
+	 */
 	table = &buffer->sg_table;
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *page = sg_page(sg);
 
-		if (reason == DF_UNDER_PRESSURE) {
+		for (j = 0; j < NUM_ORDERS; j++) {
+			if (compound_order(page) == orders[j])
+				break;
+		}
+
+		if (reason == DF_UNDER_PRESSURE || j == NUM_ORDERS ||
+		    dmabuf_page_pool_full(pools[j])) {
 			__free_pages(page, compound_order(page));
-		} else {
-			for (j = 0; j < NUM_ORDERS; j++) {
-				if (compound_order(page) == orders[j])
-					break;
-			}
-			dmabuf_page_pool_free(pools[j], page);
+			continue;
 		}
+
+		system_heap_zero_page(page);
+		batch[j][nr[j]++] = page;
+		if (nr[j] == SYSTEM_HEAP_FREE_BATCH) {
+			dmabuf_page_pool_free_batch(pools[j], batch[j], nr[j]);
+			nr[j] = 0;
+		}
+	}
+	for (j = 0; j < NUM_ORDERS; j++) {
+		if (nr[j])
+			dmabuf_page_pool_free_batch(pools[j], batch[j], nr[j]);
 	}
 	sg_free_table(table);
 	kfree(buffer);
@@ -655,6 +686,40 @@ static const struct dma_buf_ops system_heap_buf_ops = {
 	.get_flags = system_heap_dma_buf_get_flags,
 };
 
+static struct system_heap_stats *system_heap_get_stats(struct dma_heap *heap)
+{
+	if (heap == mtk_mm_heap)
+		return &heap_stats[MTK_MM_HEAP_STATS];
+	if (heap == sys_uncached_heap)
+		return &heap_stats[SYSTEM_UNCACHED_HEAP_STATS];
+	if (heap == mtk_mm_uncached_heap)
+		return &heap_stats[MTK_MM_UNCACHED_HEAP_STATS];
+	return &heap_stats[SYSTEM_HEAP_STATS];
+}
+
+static void system_heap_account_latency(atomic_long_t *hist, u64 start)
+{
+	u64 us = (ktime_get_ns() - start) / NSEC_PER_USEC;
+
+	atomic_long_inc(&hist[min_t(unsigned int, fls64(us),
+				    DMABUF_POOL_LAT_BUCKETS - 1)]);
+}
+
+/* count @page as a fallback if @size would have taken a larger order */
+static void system_heap_account_page(struct system_heap_stats *stats,
+				     unsigned long size, struct page *page)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		if (size < (PAGE_SIZE << orders[i]))
+			continue;
+		if (compound_order(page) < orders[i])
+			atomic_long_inc(&stats->fallbacks[i]);
+		return;
+	}
+}
+
 static struct page *alloc_largest_available(unsigned long size,
 					    unsigned int max_order)
 {
@@ -692,10 +757,13 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 	struct page *page, *tmp_page;
 	int i, ret = -ENOMEM;
 	struct task_struct *task = current->group_leader;
+	struct system_heap_stats *stats = system_heap_get_stats(heap);
+	u64 start = ktime_get_ns();
 
+	atomic_long_inc(&stats->allocs);
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (!buffer)
-		return ERR_PTR(-ENOMEM);
+		goto err_account;
 
 	INIT_LIST_HEAD(&buffer->attachments);
 	mutex_init(&buffer->lock);
@@ -716,6 +784,7 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 		page = alloc_largest_available(size_remaining, max_order);
 		if (!page)
 			goto free_buffer;
+		system_heap_account_page(stats, size_remaining, page);
 
 		list_add_tail(&page->lru, &pages);
 		size_remaining -= page_size(page);
@@ -767,6 +836,7 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 	}
 
 	atomic64_add(dmabuf->size, &dma_heap_normal_total);
+	system_heap_account_latency(stats->alloc_lat, start);
 
 	return dmabuf;
 
@@ -781,6 +851,8 @@ static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
 	list_for_each_entry_safe(page, tmp_page, &pages, lru)
 		__free_pages(page, compound_order(page));
 	kfree(buffer);
+err_account:
+	atomic_long_inc(&stats->alloc_fails);
 	return ERR_PTR(ret);
 }
 
@@ -957,8 +1029,61 @@ static int set_heap_dev_dma(struct device *heap_dev)
 	return 0;
 }
 
-static int system_heap_create(void)
+static void system_heap_show_latency(struct seq_file *s, const char *what,
+				     atomic_long_t *hist)
+{
+	int i;
+
+	/* bucket i holds latencies below 2^i us, the last one all the rest */
+	seq_printf(s, "\t%s latency(us):", what);
+	for (i = 0; i < DMABUF_POOL_LAT_BUCKETS - 1; i++)
+		seq_printf(s, " <%lu:%ld", 1UL << i,
+			   atomic_long_read(&hist[i]));
+	seq_printf(s, " >=%lu:%ld\n", 1UL << (i - 1),
+		   atomic_long_read(&hist[i]));
+}
+
+static int system_heap_stats_show(struct seq_file *s, void *unused)
 {
+	static const char * const names[HEAP_STATS_NR] = {
+		[SYSTEM_HEAP_STATS] = "system",
+		[MTK_MM_HEAP_STATS] = "mtk_mm",
+		[SYSTEM_UNCACHED_HEAP_STATS] = "system-uncached",
+		[MTK_MM_UNCACHED_HEAP_STATS] = "mtk_mm-uncached",
+	};
+	int i, j;
+
+	for (i = 0; i < HEAP_STATS_NR; i++) {
+		struct system_heap_stats *stats = &heap_stats[i];
+
+		seq_printf(s, "heap %s: allocs:%ld fails:%ld\n", names[i],
+			   atomic_long_read(&stats->allocs),
+			   atomic_long_read(&stats->alloc_fails));
+		seq_puts(s, "\tfallbacks:");
+		for (j = 0; j < NUM_ORDERS; j++)
+			seq_printf(s, " order%u:%ld", orders[j],
+				   atomic_long_read(&stats->fallbacks[j]));
+		seq_puts(s, "\n");
+		system_heap_show_latency(s, "alloc", stats->alloc_lat);
+	}
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		struct dmabuf_page_pool *pool = pools[i];
+
+		seq_printf(s, "pool order%u: count:%d hits:%ld misses:%ld fails:%ld\n",
+			   pool->order,
+			   READ_ONCE(pool->count[POOL_LOWPAGE]) +
+			   READ_ONCE(pool->count[POOL_HIGHPAGE]),
+			   atomic_long_read(&pool->hits),
+			   atomic_long_read(&pool->misses),
+			   atomic_long_read(&pool->alloc_fails));
+		system_heap_show_latency(s, "buddy", pool->alloc_lat);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(system_heap_stats);
+
 	struct dma_heap_export_info exp_info;
 	int i, err = 0;
 
@@ -975,6 +1100,21 @@ static int system_heap_create(void)
 		}
 	}
 
+	for (i = 0; i < NUM_ORDERS; i++) {
+		char name[16];
+
+		if (!refill_high[i])
+			continue;
+		snprintf(name, sizeof(name), "system-order-%u", orders[i]);
+		if (dmabuf_page_pool_init_refill(pools[i], name, 0,
+						 refill_high[i]))
+			pr_warn("%s: no background refill for order %u\n",
+				__func__, orders[i]);
+	}
+
+	debugfs_create_file("dma_heap_system_stats", 0444, NULL, NULL,
+			    &system_heap_stats_fops);
+
 	/* system & mtk_mm heap use same heap show */
 	exp_info.priv = (void *)&system_heap_priv;
 
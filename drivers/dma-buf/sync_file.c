@@ -5,12 +5,14 @@
  * Copyright (C) 2012 Google, Inc.
  */
 
+#include <linux/debugfs.h>
 #include <linux/export.h>
 #include <linux/file.h>
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/anon_inodes.h>
@@ -19,6 +21,11 @@
 
 static const struct file_operations sync_file_fops;
 
+/* merge outcomes, see sync_file_merge() */
+static atomic_long_t sync_file_merge_single;
+static atomic_long_t sync_file_merge_shared;
+static atomic_long_t sync_file_merge_array;
+
 static struct sync_file *sync_file_alloc(void)
 {
 	struct sync_file *sync_file;
@@ -189,45 +196,28 @@ static struct dma_fence **get_fences(struct sync_file *sync_file,
 static void add_fence(struct dma_fence **fences,
 		      int *i, struct dma_fence *fence)
 {
-	fences[*i] = fence;
+	if (dma_fence_is_signaled(fence))
+		return;
 
-	if (!dma_fence_is_signaled(fence)) {
-		dma_fence_get(fence);
-		(*i)++;
-	}
+	if (fences)
+		fences[*i] = dma_fence_get(fence);
+	(*i)++;
 }
 
-/**
- * sync_file_merge() - merge two sync_files
- * @name:	name of new fence
- * @a:		sync_file a
- * @b:		sync_file b
- *
- * Creates a new sync_file which contains copies of all the fences in both
- * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
- * new merged sync_file or NULL in case of error.
+/*
+ * Merge the context ordered fence lists @a_fences and @b_fences, keeping the
+ * later fence per context and dropping signaled ones. With @fences NULL only
+ * count; otherwise store a referenced copy of each fence. @from_a/@from_b
+ * count the kept fences either input already holds itself.
  */
-static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
-					 struct sync_file *b)
+static int sync_file_merge_fences(struct dma_fence **a_fences, int a_num,
+				  struct dma_fence **b_fences, int b_num,
+				  struct dma_fence **fences,
+				  int *from_a, int *from_b)
 {
-	struct sync_file *sync_file;
-	struct dma_fence **fences = NULL, **nfences, **a_fences, **b_fences;
-	int i = 0, i_a, i_b, num_fences, a_num_fences, b_num_fences;
-
-	sync_file = sync_file_alloc();
-	if (!sync_file)
-		return NULL;
-
-	a_fences = get_fences(a, &a_num_fences);
-	b_fences = get_fences(b, &b_num_fences);
-	if (a_num_fences > INT_MAX - b_num_fences)
-		goto err;
+	int i = 0, i_a, i_b, prev;
 
-	num_fences = a_num_fences + b_num_fences;
-
-	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
-	if (!fences)
-		goto err;
+	*from_a = *from_b = 0;
 
 	/*
 	 * Assume sync_file a and b are both ordered and have no
@@ -236,51 +226,130 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 	 * If a sync_file can only be created with sync_file_merge
 	 * and sync_file_create, this is a reasonable assumption.
 	 */
-	for (i_a = i_b = 0; i_a < a_num_fences && i_b < b_num_fences; ) {
+	for (i_a = i_b = 0; i_a < a_num && i_b < b_num; ) {
 		struct dma_fence *pt_a = a_fences[i_a];
 		struct dma_fence *pt_b = b_fences[i_b];
 
+		prev = i;
 		if (pt_a->context < pt_b->context) {
 			add_fence(fences, &i, pt_a);
+			*from_a += i - prev;
 
 			i_a++;
 		} else if (pt_a->context > pt_b->context) {
 			add_fence(fences, &i, pt_b);
+			*from_b += i - prev;
 
 			i_b++;
 		} else {
 			if (__dma_fence_is_later(pt_a->seqno, pt_b->seqno,
-						 pt_a->ops))
+						 pt_a->ops)) {
 				add_fence(fences, &i, pt_a);
-			else
+				*from_a += i - prev;
+			} else {
 				add_fence(fences, &i, pt_b);
+				*from_b += i - prev;
+				/* same point, a holds it as well */
+				if (pt_a->seqno == pt_b->seqno)
+					*from_a += i - prev;
+			}
 
 			i_a++;
 			i_b++;
 		}
 	}
 
-	for (; i_a < a_num_fences; i_a++)
+	for (; i_a < a_num; i_a++) {
+		prev = i;
 		add_fence(fences, &i, a_fences[i_a]);
+		*from_a += i - prev;
+	}
 
-	for (; i_b < b_num_fences; i_b++)
+	for (; i_b < b_num; i_b++) {
+		prev = i;
 		add_fence(fences, &i, b_fences[i_b]);
+		*from_b += i - prev;
+	}
 
-	if (i == 0)
-		fences[i++] = dma_fence_get(a_fences[0]);
+	return i;
+}
 
-	if (num_fences > i) {
-		nfences = krealloc(fences, i * sizeof(*fences),
-				  GFP_KERNEL);
-		if (!nfences)
-			goto err;
+/**
+ * sync_file_merge() - merge two sync_files
+ * @name:	name of new fence
+ * @a:		sync_file a
+ * @b:		sync_file b
+ *
+ * Creates a new sync_file which contains copies of all the fences in both
+ * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
+ * new merged sync_file or NULL in case of error.
+ *
+ * When the result boils down to a single fence, or to exactly the fences
+ * one of the inputs already holds, that fence or array is shared instead
+ * of building a new dma_fence_array.
+ */
+static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
+					 struct sync_file *b)
+{
+	struct sync_file *sync_file;
+	struct dma_fence **fences = NULL, **a_fences, **b_fences;
+	int i = 0, num_fences, a_num_fences, b_num_fences, from_a, from_b;
 
-		fences = nfences;
+	sync_file = sync_file_alloc();
+	if (!sync_file)
+		return NULL;
+
+	a_fences = get_fences(a, &a_num_fences);
+	b_fences = get_fences(b, &b_num_fences);
+	if (a_num_fences > INT_MAX - b_num_fences)
+		goto err;
+
+	num_fences = sync_file_merge_fences(a_fences, a_num_fences,
+					    b_fences, b_num_fences,
+					    NULL, &from_a, &from_b);
+
+	if (num_fences <= 1) {
+		struct dma_fence *fence;
+
+		/* fences only ever signal, so the recount fits in one slot */
+		if (!sync_file_merge_fences(a_fences, a_num_fences,
+					    b_fences, b_num_fences,
+					    &fence, &from_a, &from_b))
+			fence = dma_fence_get(a_fences[0]);
+
+		sync_file->fence = fence;
+		atomic_long_inc(&sync_file_merge_single);
+		goto out;
 	}
 
+	if (from_a == num_fences && num_fences == a_num_fences) {
+		sync_file->fence = dma_fence_get(a->fence);
+		atomic_long_inc(&sync_file_merge_shared);
+		goto out;
+	}
+
+	if (from_b == num_fences && num_fences == b_num_fences) {
+		sync_file->fence = dma_fence_get(b->fence);
+		atomic_long_inc(&sync_file_merge_shared);
+		goto out;
+	}
+
+	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		goto err;
+
+	/* fences may have signaled since counting, never the other way round */
+	i = sync_file_merge_fences(a_fences, a_num_fences,
+				   b_fences, b_num_fences,
+				   fences, &from_a, &from_b);
+	if (i == 0)
+		fences[i++] = dma_fence_get(a_fences[0]);
+
 	if (sync_file_set_fence(sync_file, fences, i) < 0)
 		goto err;
+	atomic_long_inc(&sync_file_merge_array);
 
+out:
 	strlcpy(sync_file->user_name, name, sizeof(sync_file->user_name));
 	return sync_file;
 
@@ -483,3 +552,22 @@ static const struct file_operations sync_file_fops = {
 	.unlocked_ioctl = sync_file_ioctl,
 	.compat_ioctl = compat_ptr_ioctl,
 };
+
+#ifdef CONFIG_DEBUG_FS
+static int sync_file_merge_stats_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "single: %ld\n", atomic_long_read(&sync_file_merge_single));
+	seq_printf(s, "shared: %ld\n", atomic_long_read(&sync_file_merge_shared));
+	seq_printf(s, "array: %ld\n", atomic_long_read(&sync_file_merge_array));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sync_file_merge_stats);
+
+static int __init sync_file_debugfs_init(void)
+{
+	debugfs_create_file("sync_file_merge_stats", 0444, NULL, NULL,
+			    &sync_file_merge_stats_fops);
+	return 0;
+}
+late_initcall(sync_file_debugfs_init);
+#endif
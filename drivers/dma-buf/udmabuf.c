@@ -3,6 +3,7 @@
 #include <linux/device.h>
 #include <linux/dma-buf.h>
 #include <linux/highmem.h>
+#include <linux/hugetlb.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/memfd.h>
@@ -15,9 +16,16 @@
 static const u32    list_limit = 1024;  /* udmabuf_create_list->count limit */
 static const size_t size_limit_mb = 64; /* total dmabuf size, in megabytes  */
 
+/*
+ * @pages stays pinned for the lifetime of the buffer, and @pages_sgt is
+ * built from it once, with physically contiguous runs (huge pages in
+ * particular) already merged, so that mapping only has to copy a handful
+ * of entries.
+ */
 struct udmabuf {
 	pgoff_t pagecount;
 	struct page **pages;
+	struct sg_table pages_sgt;
 	struct sg_table *sg;
 	struct miscdevice *device;
 };
@@ -52,17 +60,24 @@ static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 				     enum dma_data_direction direction)
 {
 	struct udmabuf *ubuf = buf->priv;
+	struct scatterlist *src, *dst;
 	struct sg_table *sg;
+	unsigned int i;
 	int ret;
 
 	sg = kzalloc(sizeof(*sg), GFP_KERNEL);
 	if (!sg)
 		return ERR_PTR(-ENOMEM);
-	ret = sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
-					0, ubuf->pagecount << PAGE_SHIFT,
-					GFP_KERNEL);
-	if (ret < 0)
-		goto err;
+	ret = sg_alloc_table(sg, ubuf->pages_sgt.orig_nents, GFP_KERNEL);
+	if (ret < 0) {
+		kfree(sg);
+		return ERR_PTR(ret);
+	}
+	dst = sg->sgl;
+	for_each_sgtable_sg(&ubuf->pages_sgt, src, i) {
+		sg_set_page(dst, sg_page(src), src->length, src->offset);
+		dst = sg_next(dst);
+	}
 	ret = dma_map_sgtable(dev, sg, direction, 0);
 	if (ret < 0)
 		goto err;
@@ -104,6 +119,7 @@ static void release_udmabuf(struct dma_buf *buf)
 	if (ubuf->sg)
 		put_sg_table(dev, ubuf->sg, DMA_BIDIRECTIONAL);
 
+	sg_free_table(&ubuf->pages_sgt);
 	for (pg = 0; pg < ubuf->pagecount; pg++)
 		put_page(ubuf->pages[pg]);
 	kfree(ubuf->pages);
@@ -160,10 +176,13 @@ static long udmabuf_create(struct miscdevice *device,
 {
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
 	struct file *memfd = NULL;
+	struct address_space *mapping;
 	struct udmabuf *ubuf;
 	struct dma_buf *buf;
 	pgoff_t pgoff, pgcnt, pgidx, pgbuf = 0, pglimit;
-	struct page *page;
+	pgoff_t subpgoff = 0, maxsubpgs = 0;
+	struct hstate *hpstate;
+	struct page *page, *hpage = NULL;
 	int seals, ret = -EINVAL;
 	u32 i, flags;
 
@@ -198,7 +217,8 @@ static long udmabuf_create(struct miscdevice *device,
 		memfd = fget(list[i].memfd);
 		if (!memfd)
 			goto err;
-		if (!shmem_mapping(file_inode(memfd)->i_mapping))
+		mapping = file_inode(memfd)->i_mapping;
+		if (!shmem_mapping(mapping) && !is_file_hugepages(memfd))
 			goto err;
 		seals = memfd_fcntl(memfd, F_GET_SEALS, 0);
 		if (seals == -EINVAL)
@@ -209,19 +229,57 @@ static long udmabuf_create(struct miscdevice *device,
 			goto err;
 		pgoff = list[i].offset >> PAGE_SHIFT;
 		pgcnt = list[i].size   >> PAGE_SHIFT;
+		if (is_file_hugepages(memfd)) {
+			/* hugetlbfs indexes its page cache in huge pages */
+			hpstate = hstate_file(memfd);
+			pgoff = list[i].offset >> huge_page_shift(hpstate);
+			subpgoff = (list[i].offset & ~huge_page_mask(hpstate)) >>
+				   PAGE_SHIFT;
+			maxsubpgs = huge_page_size(hpstate) >> PAGE_SHIFT;
+		}
 		for (pgidx = 0; pgidx < pgcnt; pgidx++) {
-			page = shmem_read_mapping_page(
-				file_inode(memfd)->i_mapping, pgoff + pgidx);
-			if (IS_ERR(page)) {
-				ret = PTR_ERR(page);
-				goto err;
+			if (is_file_hugepages(memfd)) {
+				if (!hpage) {
+					hpage = find_get_page_flags(mapping, pgoff,
+								    FGP_ACCESSED);
+					if (!hpage) {
+						ret = -EINVAL;
+						goto err;
+					}
+				}
+				page = hpage + subpgoff;
+				get_page(page);
+				if (++subpgoff == maxsubpgs) {
+					put_page(hpage);
+					hpage = NULL;
+					subpgoff = 0;
+					pgoff++;
+				}
+			} else {
+				page = shmem_read_mapping_page(mapping,
+							       pgoff + pgidx);
+				if (IS_ERR(page)) {
+					ret = PTR_ERR(page);
+					goto err;
+				}
 			}
 			ubuf->pages[pgbuf++] = page;
 		}
+		if (hpage) {
+			put_page(hpage);
+			hpage = NULL;
+		}
 		fput(memfd);
 		memfd = NULL;
 	}
 
+	ret = sg_alloc_table_from_pages(&ubuf->pages_sgt, ubuf->pages,
+					ubuf->pagecount, 0,
+					ubuf->pagecount << PAGE_SHIFT,
+					GFP_KERNEL);
+	if (ret < 0)
+		goto err;
+
 	exp_info.ops  = &udmabuf_ops;
 	exp_info.size = ubuf->pagecount << PAGE_SHIFT;
 	exp_info.priv = ubuf;
@@ -231,7 +289,7 @@ static long udmabuf_create(struct miscdevice *device,
 	buf = dma_buf_export(&exp_info);
 	if (IS_ERR(buf)) {
 		ret = PTR_ERR(buf);
-		goto err;
+		goto err_free_sgt;
 	}
 
 	flags = 0;
@@ -239,7 +297,11 @@ static long udmabuf_create(struct miscdevice *device,
 		flags |= O_CLOEXEC;
 	return dma_buf_fd(buf, flags);
 
+err_free_sgt:
+	sg_free_table(&ubuf->pages_sgt);
 err:
+	if (hpage)
+		put_page(hpage);
 	while (pgbuf > 0)
 		put_page(ubuf->pages[--pgbuf]);
 	if (memfd)
@@ -498,6 +498,116 @@ static u64 rb_to_hole_size_or_zero(struct rb_node *rb)
 	return rb ? rb_to_hole_size(rb) : 0;
 }
 
+/*
+ * Check whether @hole can take an allocation of @size/@alignment inside
+ * [@range_start, @range_end) and return the placement in @start. HIGH
+ * places the node as far up the hole as possible, every other mode as
+ * far down.
+ */
+static bool hole_fits(struct drm_mm *mm, struct drm_mm_node *hole,
+		      u64 size, u64 alignment, u64 remainder_mask,
+		      unsigned long color, u64 range_start, u64 range_end,
+		      enum drm_mm_insert_mode mode, u64 *start)
+{
+	u64 hole_start = __drm_mm_hole_node_start(hole);
+	u64 col_start = hole_start;
+	u64 col_end = hole_start + hole->hole_size;
+	u64 adj_start, adj_end;
+
+	if (mm->color_adjust)
+		mm->color_adjust(hole, color, &col_start, &col_end);
+
+	adj_start = max(col_start, range_start);
+	adj_end = min(col_end, range_end);
+
+	if (adj_end <= adj_start || adj_end - adj_start < size)
+		return false;
+
+	if (mode == DRM_MM_INSERT_HIGH)
+		adj_start = adj_end - size;
+
+	if (alignment) {
+		u64 rem;
+
+		if (likely(remainder_mask))
+			rem = adj_start & remainder_mask;
+		else
+			div64_u64_rem(adj_start, alignment, &rem);
+		if (rem) {
+			adj_start -= rem;
+			if (mode != DRM_MM_INSERT_HIGH)
+				adj_start += alignment;
+
+			if (adj_start < max(col_start, range_start) ||
+			    min(col_end, range_end) - adj_start < size)
+				return false;
+
+			if (adj_end <= adj_start ||
+			    adj_end - adj_start < size)
+				return false;
+		}
+	}
+
+	*start = adj_start;
+	return true;
+}
+
+/*
+ * The size tree hands out holes smallest first regardless of where they
+ * are, so a best-fit search restricted to a small part of the address
+ * space ends up rejecting most of the holes it visits. Use the address
+ * tree for those instead once the range covers less than half of @mm.
+ */
+static bool range_is_narrow(const struct drm_mm *mm, u64 start, u64 end)
+{
+	u64 mm_end = mm->head_node.start;
+	u64 mm_start = mm_end + mm->head_node.size;
+
+	start = max(start, mm_start);
+	end = min(end, mm_end);
+	if (end <= start)
+		return true;
+
+	return end - start < (mm_end - mm_start) / 2;
+}
+
+/*
+ * Best fit within [@range_start, @range_end): walk the holes of the range
+ * in address order, pruning subtrees without a hole of at least @size via
+ * subtree_max_hole, and keep the smallest hole the aligned node fits in.
+ * Equally sized holes resolve to the lowest one.
+ */
+static struct drm_mm_node *
+best_hole_in_range(struct drm_mm *mm, u64 size, u64 alignment,
+		   u64 remainder_mask, unsigned long color,
+		   u64 range_start, u64 range_end, u64 *start)
+{
+	struct drm_mm_node *hole, *best = NULL;
+	u64 adj_start;
+
+	for (hole = find_hole_addr(mm, range_start, size);
+	     hole;
+	     hole = next_hole_low_addr(hole, size)) {
+		if (__drm_mm_hole_node_start(hole) >= range_end)
+			break;
+
+		if (best && hole->hole_size >= best->hole_size)
+			continue;
+
+		if (!hole_fits(mm, hole, size, alignment, remainder_mask,
+			       color, range_start, range_end,
+			       DRM_MM_INSERT_BEST, &adj_start))
+			continue;
+
+		best = hole;
+		*start = adj_start;
+		if (hole->hole_size == size)
+			break;
+	}
+
+	return best;
+}
+
 /**
  * drm_mm_insert_node_in_range - ranged search for space and insert @node
  * @mm: drm_mm to allocate from
@@ -522,6 +632,7 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 				enum drm_mm_insert_mode mode)
 {
 	struct drm_mm_node *hole;
+	u64 adj_start, hole_start, hole_end;
 	u64 remainder_mask;
 	bool once;
 
@@ -540,77 +651,58 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 	mode &= ~DRM_MM_INSERT_ONCE;
 
 	remainder_mask = is_power_of_2(alignment) ? alignment - 1 : 0;
+
+	if (mode == DRM_MM_INSERT_BEST && !once &&
+	    range_is_narrow(mm, range_start, range_end)) {
+		hole = best_hole_in_range(mm, size, alignment, remainder_mask,
+					  color, range_start, range_end,
+					  &adj_start);
+		if (hole)
+			goto insert;
+		return -ENOSPC;
+	}
+
 	for (hole = first_hole(mm, range_start, range_end, size, mode);
 	     hole;
 	     hole = once ? NULL : next_hole(mm, hole, size, mode)) {
 		u64 hole_start = __drm_mm_hole_node_start(hole);
-		u64 hole_end = hole_start + hole->hole_size;
-		u64 adj_start, adj_end;
-		u64 col_start, col_end;
 
 		if (mode == DRM_MM_INSERT_LOW && hole_start >= range_end)
 			break;
 
-		if (mode == DRM_MM_INSERT_HIGH && hole_end <= range_start)
+		if (mode == DRM_MM_INSERT_HIGH &&
+		    hole_start + hole->hole_size <= range_start)
 			break;
 
-		col_start = hole_start;
-		col_end = hole_end;
-		if (mm->color_adjust)
-			mm->color_adjust(hole, color, &col_start, &col_end);
-
-		adj_start = max(col_start, range_start);
-		adj_end = min(col_end, range_end);
-
-		if (adj_end <= adj_start || adj_end - adj_start < size)
-			continue;
+		if (hole_fits(mm, hole, size, alignment, remainder_mask, color,
+			      range_start, range_end, mode, &adj_start))
+			goto insert;
+	}
 
-		if (mode == DRM_MM_INSERT_HIGH)
-			adj_start = adj_end - size;
-
-		if (alignment) {
-			u64 rem;
-
-			if (likely(remainder_mask))
-				rem = adj_start & remainder_mask;
-			else
-				div64_u64_rem(adj_start, alignment, &rem);
-			if (rem) {
-				adj_start -= rem;
-				if (mode != DRM_MM_INSERT_HIGH)
-					adj_start += alignment;
-
-				if (adj_start < max(col_start, range_start) ||
-				    min(col_end, range_end) - adj_start < size)
-					continue;
-
-				if (adj_end <= adj_start ||
-				    adj_end - adj_start < size)
-					continue;
-			}
-		}
+	return -ENOSPC;
 
-		node->mm = mm;
-		node->size = size;
-		node->start = adj_start;
-		node->color = color;
-		node->hole_size = 0;
+insert:
+	hole_start = __drm_mm_hole_node_start(hole);
+	hole_end = hole_start + hole->hole_size;
 
-		__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
-		list_add(&node->node_list, &hole->node_list);
-		drm_mm_interval_tree_add_node(hole, node);
+	node->mm = mm;
+	node->size = size;
+	node->start = adj_start;
+	node->color = color;
+	node->hole_size = 0;
 
-		rm_hole(hole);
-		if (adj_start > hole_start)
-			add_hole(hole);
-		if (adj_start + size < hole_end)
-			add_hole(node);
+	__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
+	list_add(&node->node_list, &hole->node_list);
+	drm_mm_interval_tree_add_node(hole, node);
 
-		save_stack(node);
-		return 0;
-	}
+	rm_hole(hole);
+	if (adj_start > hole_start)
+		add_hole(hole);
+	if (adj_start + size < hole_end)
+		add_hole(node);
 
-	return -ENOSPC;
+	save_stack(node);
+	return 0;
 }
 EXPORT_SYMBOL(drm_mm_insert_node_in_range);
 
@@ -258,6 +258,8 @@ int mi_disp_feature_detach_display(void *display, int disp_id, int intf_type)
 
 	if (is_support_disp_id(disp_id) && is_support_disp_intf_type(intf_type)) {
 		dd_ptr = &df->d_display[disp_id];
+		if (intf_type == MI_INTF_DSI && display)
+			cancel_work_sync(&((struct mtk_dsi *)display)->mi_cfg.bl_update_work);
 #ifdef CONFIG_MI_DISP_BOOST
 		ret = mi_disp_boost_deinit();
 		if (ret) {
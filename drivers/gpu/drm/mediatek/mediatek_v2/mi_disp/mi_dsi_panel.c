@@ -1223,32 +1223,50 @@ int mi_dsi_panel_get_doze_brightness(struct mtk_dsi *dsi,
 	return 0;
 }
 
+static void mi_dsi_panel_bl_update_work(struct work_struct *work)
+{
+	struct mi_dsi_panel_cfg *mi_cfg = container_of(work,
+			struct mi_dsi_panel_cfg, bl_update_work);
+	struct mtk_dsi *dsi = container_of(mi_cfg, struct mtk_dsi, mi_cfg);
+	struct mtk_ddp_comp *comp = &dsi->ddp_comp;
+	struct mtk_panel_ext *panel_ext = mtk_dsi_get_panel_ext(comp);
+	int brightness;
+
+	mutex_lock(&dsi->dsi_lock);
+	/* only the newest level matters, older ones were superseded */
+	brightness = atomic_xchg(&mi_cfg->pending_bl_level, -1);
+	if (brightness < 0)
+		goto out;
+
+	if (!(panel_ext && panel_ext->funcs && panel_ext->funcs->setbacklight_control)) {
+		pr_info("set_backlight_control func not defined\n");
+		goto out;
+	}
+
+	if (!panel_ext->funcs->setbacklight_control(dsi->panel, brightness))
+		mi_cfg->last_bl_level = brightness;
+out:
+	mutex_unlock(&dsi->dsi_lock);
+}
+
+/*
+ * Backlight animations issue levels much faster than the panel can take
+ * DCS commands without stealing link time from frame transfer. Record the
+ * level and let one worker send whatever is newest when it runs.
+ */
 int mi_dsi_panel_set_brightness(struct mtk_dsi *dsi,
 			int brightness)
 {
-	int ret = 0;
-	struct mtk_ddp_comp *comp =  NULL;
-	struct mtk_panel_ext *panel_ext = NULL;
-
-	if (!dsi) {
+	if (!dsi || brightness < 0) {
 		DISP_ERROR("invalid params\n");
 		return -EINVAL;
 	}
 
-	pr_info("%s +, brightness = %d\n", __func__, brightness);
-	comp = &dsi->ddp_comp;
-	panel_ext = mtk_dsi_get_panel_ext(comp);
-	mutex_lock(&dsi->dsi_lock);
-	if (!(panel_ext && panel_ext->funcs && panel_ext->funcs->setbacklight_control)) {
-		pr_info("%s set_backlight_control func not defined");
-		ret = 0;
-	} else {
-		if (!panel_ext->funcs->setbacklight_control(dsi->panel, brightness))
-			dsi->mi_cfg.last_bl_level = brightness;
-	}
+	pr_debug("%s +, brightness = %d\n", __func__, brightness);
+	atomic_set(&dsi->mi_cfg.pending_bl_level, brightness);
+	queue_work(system_highpri_wq, &dsi->mi_cfg.bl_update_work);
 
-	mutex_unlock(&dsi->dsi_lock);
-	return ret;
+	return 0;
 }
 
 int mi_dsi_panel_get_brightness(struct mtk_dsi *dsi,
@@ -1261,7 +1279,9 @@ int mi_dsi_panel_get_brightness(struct mtk_dsi *dsi,
 
 	pr_info("%s +\n", __func__);
 	mutex_lock(&dsi->dsi_lock);
-	*brightness = dsi->mi_cfg.last_bl_level;
+	*brightness = atomic_read(&dsi->mi_cfg.pending_bl_level);
+	if ((int)*brightness < 0)
+		*brightness = dsi->mi_cfg.last_bl_level;
 	mutex_unlock(&dsi->dsi_lock);
 	return 0;
 }
@@ -1304,6 +1324,9 @@ int mi_dsi_panel_set_disp_param(struct mtk_dsi *dsi, struct disp_feature_ctl *ct
 	if (dsi->encoder.crtc && dsi->encoder.crtc->dev && dsi->encoder.crtc->dev->dev_private)
 		private = dsi->encoder.crtc->dev->dev_private;
 
+	/* features like HBM must land after the backlight level already asked for */
+	flush_work(&mi_cfg->bl_update_work);
+
 	mutex_lock(&dsi->dsi_lock);
 	switch (ctl->feature_id) {
 	case DISP_FEATURE_DIMMING:
@@ -1608,6 +1631,8 @@ void mi_disp_cfg_init(struct mtk_dsi *dsi)
 		return;
 	}
 	mutex_init(&dsi->dsi_lock);
+	atomic_set(&dsi->mi_cfg.pending_bl_level, -1);
+	INIT_WORK(&dsi->mi_cfg.bl_update_work, mi_dsi_panel_bl_update_work);
 	comp = &dsi->ddp_comp;
 	panel_ext = mtk_dsi_get_panel_ext(comp);
 
@@ -149,6 +149,10 @@ struct mi_dsi_panel_cfg {
 #endif
 	enum crc_mode crc_state;
 	enum gir_mode gir_state;
+
+	/* latest backlight level requested but not sent yet, -1 if none */
+	atomic_t pending_bl_level;
+	struct work_struct bl_update_work;
 };
 
 struct mtk_dsi {
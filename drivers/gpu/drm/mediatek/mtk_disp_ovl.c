@@ -4,6 +4,7 @@
  */
 
 #include <drm/drm_fourcc.h>
+#include <drm/drm_rect.h>
 
 #include <linux/clk.h>
 #include <linux/component.h>
@@ -67,11 +68,13 @@ struct mtk_disp_ovl_data {
  * struct mtk_disp_ovl - DISP_OVL driver structure
  * @ddp_comp - structure containing type enum and hardware resources
  * @crtc - associated crtc to report vblank events to
+ * @roi - partial update region layers are clipped to, empty for full frame
  */
 struct mtk_disp_ovl {
 	struct mtk_ddp_comp		ddp_comp;
 	struct drm_crtc			*crtc;
 	const struct mtk_disp_ovl_data	*data;
+	struct drm_rect			roi;
 };
 
 static inline struct mtk_disp_ovl *comp_to_ovl(struct mtk_ddp_comp *comp)
@@ -127,6 +130,9 @@ static void mtk_ovl_config(struct mtk_ddp_comp *comp, unsigned int w,
 			   unsigned int h, unsigned int vrefresh,
 			   unsigned int bpc, struct cmdq_pkt *cmdq_pkt)
 {
+	struct mtk_disp_ovl *ovl = comp_to_ovl(comp);
+
+	memset(&ovl->roi, 0, sizeof(ovl->roi));
 	if (w != 0 && h != 0)
 		mtk_ddp_write_relaxed(cmdq_pkt, h << 16 | w, comp,
 				      DISP_REG_OVL_ROI_SIZE);
@@ -136,6 +142,18 @@ static void mtk_ovl_config(struct mtk_ddp_comp *comp, unsigned int w,
 	mtk_ddp_write(cmdq_pkt, 0x0, comp, DISP_REG_OVL_RST);
 }
 
+static void mtk_ovl_partial_update(struct mtk_ddp_comp *comp,
+				   const struct drm_rect *roi,
+				   struct cmdq_pkt *cmdq_pkt)
+{
+	struct mtk_disp_ovl *ovl = comp_to_ovl(comp);
+
+	ovl->roi = *roi;
+	mtk_ddp_write_relaxed(cmdq_pkt,
+			      drm_rect_height(roi) << 16 | drm_rect_width(roi),
+			      comp, DISP_REG_OVL_ROI_SIZE);
+}
+
 static unsigned int mtk_ovl_layer_nr(struct mtk_ddp_comp *comp)
 {
 	struct mtk_disp_ovl *ovl = comp_to_ovl(comp);
@@ -265,6 +283,28 @@ static void mtk_ovl_layer_config(struct mtk_ddp_comp *comp, unsigned int idx,
 		return;
 	}
 
+	/*
+	 * Clip the layer to the partial update region. The crtc only asks
+	 * for one when no layer is reflected, so the source address can
+	 * simply be advanced to the first visible pixel.
+	 */
+	if (drm_rect_visible(&ovl->roi)) {
+		struct drm_rect dst;
+
+		drm_rect_init(&dst, pending->x, pending->y,
+			      pending->width, pending->height);
+		if (!drm_rect_intersect(&dst, &ovl->roi)) {
+			mtk_ovl_layer_off(comp, idx, cmdq_pkt);
+			return;
+		}
+		addr += (dst.y1 - pending->y) * pending->pitch;
+		addr += (dst.x1 - pending->x) *
+			drm_format_info(fmt)->cpp[0];
+		offset = (dst.y1 - ovl->roi.y1) << 16 |
+			 (dst.x1 - ovl->roi.x1);
+		src_size = drm_rect_height(&dst) << 16 | drm_rect_width(&dst);
+	}
+
 	con = ovl_fmt_convert(ovl, fmt);
 	if (state->base.fb && state->base.fb->format->has_alpha)
 		con |= OVL_CON_AEN | OVL_CON_ALPHA;
@@ -323,6 +363,7 @@ static const struct mtk_ddp_comp_funcs mtk_disp_ovl_funcs = {
 	.layer_config = mtk_ovl_layer_config,
 	.bgclr_in_on = mtk_ovl_bgclr_in_on,
 	.bgclr_in_off = mtk_ovl_bgclr_in_off,
+	.partial_update = mtk_ovl_partial_update,
 };
 
 static int mtk_disp_ovl_bind(struct device *dev, struct device *master,
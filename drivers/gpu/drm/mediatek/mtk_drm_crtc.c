@@ -14,6 +14,7 @@
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_plane_helper.h>
 #include <drm/drm_probe_helper.h>
+#include <drm/drm_rect.h>
 #include <drm/drm_vblank.h>
 
 #include "mtk_drm_drv.h"
@@ -23,6 +24,22 @@
 #include "mtk_drm_gem.h"
 #include "mtk_drm_plane.h"
 
+/* hardware configurations allowed in flight on the GCE before flush blocks */
+#define MTK_CRTC_CMDQ_DEPTH		2
+#define MTK_CRTC_CMDQ_TIMEOUT_MS	2000
+
+struct mtk_drm_crtc;
+
+/**
+ * struct mtk_crtc_cmdq_slot - one queued hardware configuration
+ * @pkt: command packet flushed to the GCE, NULL while the slot is free
+ * @mtk_crtc: owning crtc, handed back to the completion callback
+ */
+struct mtk_crtc_cmdq_slot {
+	struct cmdq_pkt			*pkt;
+	struct mtk_drm_crtc		*mtk_crtc;
+};
+
 /**
  * struct mtk_drm_crtc - MediaTek specific crtc structure.
  * @base: crtc object.
@@ -33,6 +50,12 @@
  * @mutex: handle to one of the ten disp_mutex streams
  * @ddp_comp_nr: number of components in ddp_comp
  * @ddp_comp: array of pointers the mtk_ddp_comp structures used by this crtc
+ * @bpc: output bits per component chosen at enable time
+ * @roi: region the pipeline is currently sized to, the full mode by default
+ * @pending_roi: whether @roi has to be programmed on the next config
+ * @cmdq_slot: ring of configurations queued to the GCE, oldest retires first
+ * @cmdq_busy: bitmask of @cmdq_slot entries still owned by the GCE
+ * @cmdq_wq: woken whenever a queued configuration retires
  */
 struct mtk_drm_crtc {
 	struct drm_crtc			base;
@@ -49,12 +72,18 @@ struct mtk_drm_crtc {
 #if IS_REACHABLE(CONFIG_MTK_CMDQ)
 	struct cmdq_client		*cmdq_client;
 	u32				cmdq_event;
+	struct mtk_crtc_cmdq_slot	cmdq_slot[MTK_CRTC_CMDQ_DEPTH];
+	unsigned long			cmdq_busy;
+	wait_queue_head_t		cmdq_wq;
 #endif
 
 	struct device			*mmsys_dev;
 	struct mtk_disp_mutex		*mutex;
 	unsigned int			ddp_comp_nr;
 	struct mtk_ddp_comp		**ddp_comp;
+	unsigned int			bpc;
+	struct drm_rect			roi;
+	bool				pending_roi;
 
 	/* lock for display hardware access */
 	struct mutex			hw_lock;
@@ -238,7 +267,53 @@ struct mtk_ddp_comp *mtk_drm_ddp_comp_for_plane(struct drm_crtc *crtc,
 #if IS_REACHABLE(CONFIG_MTK_CMDQ)
 static void ddp_cmdq_cb(struct cmdq_cb_data data)
 {
-	cmdq_pkt_destroy(data.data);
+	struct mtk_crtc_cmdq_slot *slot = data.data;
+	struct mtk_drm_crtc *mtk_crtc = slot->mtk_crtc;
+
+	cmdq_pkt_destroy(slot->pkt);
+	slot->pkt = NULL;
+	clear_bit(slot - mtk_crtc->cmdq_slot, &mtk_crtc->cmdq_busy);
+	smp_mb__after_atomic();
+	wake_up(&mtk_crtc->cmdq_wq);
+}
+
+static int mtk_crtc_cmdq_get_slot(struct mtk_drm_crtc *mtk_crtc)
+{
+	int i;
+
+	for (i = 0; i < MTK_CRTC_CMDQ_DEPTH; i++)
+		if (!test_and_set_bit(i, &mtk_crtc->cmdq_busy))
+			return i;
+
+	return -EBUSY;
+}
+
+/*
+ * Block only when MTK_CRTC_CMDQ_DEPTH configurations are already queued,
+ * so a commit landing just before vblank does not wait for the previous
+ * one to be consumed by the GCE.
+ */
+static int mtk_crtc_cmdq_wait_slot(struct mtk_drm_crtc *mtk_crtc)
+{
+	int idx = -EBUSY;
+
+	if (!wait_event_timeout(mtk_crtc->cmdq_wq,
+				(idx = mtk_crtc_cmdq_get_slot(mtk_crtc)) >= 0,
+				msecs_to_jiffies(MTK_CRTC_CMDQ_TIMEOUT_MS)))
+		DRM_ERROR("crtc%d: no free cmdq slot, busy:%#lx
+",
+			  drm_crtc_index(&mtk_crtc->base), mtk_crtc->cmdq_busy);
+
+	return idx;
+}
+
+static void mtk_crtc_cmdq_drain(struct mtk_drm_crtc *mtk_crtc)
+{
+	if (!wait_event_timeout(mtk_crtc->cmdq_wq, !READ_ONCE(mtk_crtc->cmdq_busy),
+				msecs_to_jiffies(MTK_CRTC_CMDQ_TIMEOUT_MS)))
+		DRM_ERROR("crtc%d: cmdq drain timeout, busy:%#lx
+",
+			  drm_crtc_index(&mtk_crtc->base), mtk_crtc->cmdq_busy);
 }
 #endif
 
@@ -302,6 +377,10 @@ static int mtk_crtc_ddp_hw_init(struct mtk_drm_crtc *mtk_crtc)
 	mtk_disp_mutex_add_comp(mtk_crtc->mutex, mtk_crtc->ddp_comp[i]->id);
 	mtk_disp_mutex_enable(mtk_crtc->mutex);
 
+	mtk_crtc->bpc = bpc;
+	drm_rect_init(&mtk_crtc->roi, 0, 0, width, height);
+	mtk_crtc->pending_roi = false;
+
 	for (i = 0; i < mtk_crtc->ddp_comp_nr; i++) {
 		struct mtk_ddp_comp *comp = mtk_crtc->ddp_comp[i];
 
@@ -395,6 +474,23 @@ static void mtk_crtc_ddp_config(struct drm_crtc *crtc,
 		state->pending_config = false;
 	}
 
+	if (mtk_crtc->pending_roi) {
+		struct drm_display_mode *mode = &crtc->state->adjusted_mode;
+		unsigned int w = drm_rect_width(&mtk_crtc->roi);
+		unsigned int h = drm_rect_height(&mtk_crtc->roi);
+
+		for (i = 0; i < mtk_crtc->ddp_comp_nr; i++) {
+			comp = mtk_crtc->ddp_comp[i];
+			if (!mtk_ddp_comp_partial_update(comp, &mtk_crtc->roi,
+							 cmdq_handle))
+				mtk_ddp_comp_config(comp, w, h,
+						    drm_mode_vrefresh(mode),
+						    mtk_crtc->bpc,
+						    cmdq_handle);
+		}
+		mtk_crtc->pending_roi = false;
+	}
+
 	if (mtk_crtc->pending_planes) {
 		for (i = 0; i < mtk_crtc->layer_nr; i++) {
 			struct drm_plane *plane = &mtk_crtc->planes[i];
@@ -440,10 +536,107 @@ static void mtk_crtc_ddp_config(struct drm_crtc *crtc,
 	}
 }
 
+static bool mtk_drm_crtc_partial_capable(struct mtk_drm_crtc *mtk_crtc)
+{
+	unsigned int i;
+
+	if (!mtk_ddp_comp_partial_capable(mtk_crtc->ddp_comp[0]) ||
+	    !mtk_ddp_comp_partial_capable(
+			mtk_crtc->ddp_comp[mtk_crtc->ddp_comp_nr - 1]))
+		return false;
+
+	for (i = 1; i < mtk_crtc->ddp_comp_nr - 1; i++) {
+		struct mtk_ddp_comp *comp = mtk_crtc->ddp_comp[i];
+
+		if (comp->funcs && comp->funcs->partial_capable &&
+		    !comp->funcs->partial_capable(comp))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Union of the damage of every plane touched by this commit. Anything
+ * the OVL cannot clip cheaply, a plane turned off or moved, or a plane
+ * without damage clips leaves @roi at the full frame.
+ */
+static void mtk_drm_crtc_calc_roi(struct mtk_drm_crtc *mtk_crtc,
+				  const struct drm_rect *full,
+				  struct drm_rect *roi)
+{
+	struct drm_rect damage = { INT_MAX, INT_MAX, 0, 0 };
+	unsigned int i;
+
+	for (i = 0; i < mtk_crtc->layer_nr; i++) {
+		struct drm_plane *plane = &mtk_crtc->planes[i];
+		struct mtk_plane_pending_state *pending;
+
+		pending = &to_mtk_plane_state(plane->state)->pending;
+		if (pending->enable &&
+		    pending->rotation & (DRM_MODE_REFLECT_X | DRM_MODE_REFLECT_Y))
+			return;
+
+		if (!pending->config)
+			continue;
+
+		if (!pending->enable || !drm_rect_visible(&pending->damage))
+			return;
+
+		damage.x1 = min(damage.x1, pending->damage.x1);
+		damage.y1 = min(damage.y1, pending->damage.y1);
+		damage.x2 = max(damage.x2, pending->damage.x2);
+		damage.y2 = max(damage.y2, pending->damage.y2);
+	}
+
+	/* keep packed YUV layers on a macro pixel boundary */
+	damage.x1 = round_down(damage.x1, 2);
+	damage.x2 = round_up(damage.x2, 2);
+	if (drm_rect_intersect(&damage, full))
+		*roi = damage;
+}
+
+static void mtk_drm_crtc_update_roi(struct mtk_drm_crtc *mtk_crtc)
+{
+	struct drm_crtc *crtc = &mtk_crtc->base;
+	struct mtk_crtc_state *state = to_mtk_crtc_state(crtc->state);
+	struct drm_rect full, roi;
+	unsigned int i;
+
+	drm_rect_init(&full, 0, 0, crtc->state->adjusted_mode.hdisplay,
+		      crtc->state->adjusted_mode.vdisplay);
+	roi = full;
+
+	if (mtk_crtc->pending_planes && !mtk_crtc->pending_async_planes &&
+	    !state->pending_config && !crtc->state->color_mgmt_changed &&
+	    mtk_drm_crtc_partial_capable(mtk_crtc))
+		mtk_drm_crtc_calc_roi(mtk_crtc, &full, &roi);
+
+	if (drm_rect_equals(&roi, &mtk_crtc->roi))
+		return;
+
+	mtk_crtc->roi = roi;
+	mtk_crtc->pending_roi = true;
+
+	/* layer offsets are relative to the roi, reprogram all of them */
+	for (i = 0; i < mtk_crtc->layer_nr; i++) {
+		struct drm_plane *plane = &mtk_crtc->planes[i];
+		struct mtk_plane_state *plane_state;
+
+		plane_state = to_mtk_plane_state(plane->state);
+		if (plane_state->pending.enable) {
+			plane_state->pending.config = true;
+			mtk_crtc->pending_planes = true;
+		}
+	}
+}
+
 static void mtk_drm_crtc_hw_config(struct mtk_drm_crtc *mtk_crtc)
 {
 #if IS_REACHABLE(CONFIG_MTK_CMDQ)
+	struct mtk_crtc_cmdq_slot *slot;
 	struct cmdq_pkt *cmdq_handle;
+	int idx;
 #endif
 	struct drm_crtc *crtc = &mtk_crtc->base;
 	struct mtk_drm_private *priv = crtc->dev->dev_private;
@@ -471,6 +664,8 @@ static void mtk_drm_crtc_hw_config(struct mtk_drm_crtc *mtk_crtc)
 	if (pending_async_planes)
 		mtk_crtc->pending_async_planes = true;
 
+	mtk_drm_crtc_update_roi(mtk_crtc);
+
 	if (priv->data->shadow_register) {
 		mtk_disp_mutex_acquire(mtk_crtc->mutex);
 		mtk_crtc_ddp_config(crtc, NULL);
@@ -478,13 +673,26 @@ static void mtk_drm_crtc_hw_config(struct mtk_drm_crtc *mtk_crtc)
 	}
 #if IS_REACHABLE(CONFIG_MTK_CMDQ)
 	if (mtk_crtc->cmdq_client) {
-		mbox_flush(mtk_crtc->cmdq_client->chan, 2000);
+		idx = mtk_crtc_cmdq_wait_slot(mtk_crtc);
+		if (idx < 0) {
+			/* the GCE is stuck, fall back to a full flush */
+			mbox_flush(mtk_crtc->cmdq_client->chan,
+				   MTK_CRTC_CMDQ_TIMEOUT_MS);
+			idx = mtk_crtc_cmdq_get_slot(mtk_crtc);
+		}
 		cmdq_handle = cmdq_pkt_create(mtk_crtc->cmdq_client, PAGE_SIZE);
 		cmdq_pkt_clear_event(cmdq_handle, mtk_crtc->cmdq_event);
 		cmdq_pkt_wfe(cmdq_handle, mtk_crtc->cmdq_event, false);
 		mtk_crtc_ddp_config(crtc, cmdq_handle);
 		cmdq_pkt_finalize(cmdq_handle);
-		cmdq_pkt_flush_async(cmdq_handle, ddp_cmdq_cb, cmdq_handle);
+		if (idx < 0) {
+			cmdq_pkt_flush(cmdq_handle);
+			cmdq_pkt_destroy(cmdq_handle);
+		} else {
+			slot = &mtk_crtc->cmdq_slot[idx];
+			slot->pkt = cmdq_handle;
+			cmdq_pkt_flush_async(cmdq_handle, ddp_cmdq_cb, slot);
+		}
 	}
 #endif
 	mutex_unlock(&mtk_crtc->hw_lock);
@@ -566,6 +774,10 @@ static void mtk_drm_crtc_atomic_disable(struct drm_crtc *crtc,
 	mtk_drm_crtc_hw_config(mtk_crtc);
 	/* Wait for planes to be disabled */
 	drm_crtc_wait_one_vblank(crtc);
+#if IS_REACHABLE(CONFIG_MTK_CMDQ)
+	if (mtk_crtc->cmdq_client)
+		mtk_crtc_cmdq_drain(mtk_crtc);
+#endif
 
 	drm_crtc_vblank_off(crtc);
 	mtk_crtc_ddp_hw_fini(mtk_crtc);
@@ -822,6 +1034,9 @@ int mtk_drm_crtc_create(struct drm_device *drm_dev,
 	mutex_init(&mtk_crtc->hw_lock);
 
 #if IS_REACHABLE(CONFIG_MTK_CMDQ)
+	init_waitqueue_head(&mtk_crtc->cmdq_wq);
+	for (i = 0; i < MTK_CRTC_CMDQ_DEPTH; i++)
+		mtk_crtc->cmdq_slot[i].mtk_crtc = mtk_crtc;
 	mtk_crtc->cmdq_client =
 			cmdq_mbox_create(mtk_crtc->mmsys_dev,
 					 drm_crtc_index(&mtk_crtc->base),
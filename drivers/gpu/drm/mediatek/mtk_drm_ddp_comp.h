@@ -13,6 +13,7 @@ struct device;
 struct device_node;
 struct drm_crtc;
 struct drm_device;
+struct drm_rect;
 struct mtk_plane_state;
 struct drm_crtc_state;
 
@@ -60,6 +61,10 @@ struct mtk_ddp_comp_funcs {
 	void (*bgclr_in_off)(struct mtk_ddp_comp *comp);
 	void (*ctm_set)(struct mtk_ddp_comp *comp,
 			struct drm_crtc_state *state);
+	bool (*partial_capable)(struct mtk_ddp_comp *comp);
+	void (*partial_update)(struct mtk_ddp_comp *comp,
+			       const struct drm_rect *roi,
+			       struct cmdq_pkt *cmdq_pkt);
 };
 
 struct mtk_ddp_comp {
@@ -142,6 +147,26 @@ static inline void mtk_ddp_comp_layer_config(struct mtk_ddp_comp *comp,
 		comp->funcs->layer_config(comp, idx, state, cmdq_pkt);
 }
 
+static inline bool mtk_ddp_comp_partial_capable(struct mtk_ddp_comp *comp)
+{
+	if (!comp->funcs || !comp->funcs->partial_update)
+		return false;
+	if (comp->funcs->partial_capable)
+		return comp->funcs->partial_capable(comp);
+	return true;
+}
+
+static inline bool mtk_ddp_comp_partial_update(struct mtk_ddp_comp *comp,
+					       const struct drm_rect *roi,
+					       struct cmdq_pkt *cmdq_pkt)
+{
+	if (comp->funcs && comp->funcs->partial_update) {
+		comp->funcs->partial_update(comp, roi, cmdq_pkt);
+		return true;
+	}
+	return false;
+}
+
 static inline void mtk_ddp_gamma_set(struct mtk_ddp_comp *comp,
 				     struct drm_crtc_state *state)
 {
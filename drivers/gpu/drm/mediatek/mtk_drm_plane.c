@@ -8,6 +8,7 @@
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_atomic_uapi.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_plane_helper.h>
 #include <drm/drm_gem_framebuffer_helper.h>
 
@@ -158,6 +159,8 @@ static int mtk_plane_atomic_check(struct drm_plane *plane,
 	if (IS_ERR(crtc_state))
 		return PTR_ERR(crtc_state);
 
+	drm_atomic_helper_check_plane_damage(state->state, state);
+
 	return drm_atomic_helper_check_plane_state(state, crtc_state,
 						   DRM_PLANE_HELPER_NO_SCALING,
 						   DRM_PLANE_HELPER_NO_SCALING,
@@ -174,6 +177,33 @@ static void mtk_plane_atomic_disable(struct drm_plane *plane,
 	state->pending.dirty = true;
 }
 
+static void mtk_plane_update_damage(struct drm_plane_state *old_state,
+				    struct mtk_plane_state *state)
+{
+	struct mtk_plane_pending_state *old = &to_mtk_plane_state(old_state)->pending;
+	struct mtk_plane_pending_state *pending = &state->pending;
+	struct drm_plane_state *new_state = &state->base;
+	struct drm_rect *damage = &pending->damage;
+
+	memset(damage, 0, sizeof(*damage));
+
+	/* the area the layer used to cover has to be redrawn as well */
+	if (!old->enable || old->x != pending->x || old->y != pending->y ||
+	    old->width != pending->width || old->height != pending->height)
+		return;
+
+	if (!drm_atomic_helper_damage_merged(old_state, new_state, damage))
+		goto full;
+
+	/* framebuffer to crtc coordinates */
+	drm_rect_translate(damage, new_state->dst.x1 - (new_state->src.x1 >> 16),
+			   new_state->dst.y1 - (new_state->src.y1 >> 16));
+	if (drm_rect_intersect(damage, &new_state->dst))
+		return;
+full:
+	memset(damage, 0, sizeof(*damage));
+}
+
 static void mtk_plane_atomic_update(struct drm_plane *plane,
 				    struct drm_plane_state *old_state)
 {
@@ -211,6 +241,7 @@ static void mtk_plane_atomic_update(struct drm_plane *plane,
 	state->pending.width = drm_rect_width(&plane->state->dst);
 	state->pending.height = drm_rect_height(&plane->state->dst);
 	state->pending.rotation = plane->state->rotation;
+	mtk_plane_update_damage(old_state, state);
 	wmb(); /* Make sure the above parameters are set before update */
 	state->pending.dirty = true;
 }
@@ -246,6 +277,7 @@ int mtk_plane_init(struct drm_device *dev, struct drm_plane *plane,
 			DRM_INFO("Create rotation property failed\n");
 	}
 
+	drm_plane_enable_fb_damage_clips(plane);
 	drm_plane_helper_add(plane, &mtk_plane_helper_funcs);
 
 	return 0;
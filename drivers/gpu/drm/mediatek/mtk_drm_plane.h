@@ -8,6 +8,7 @@
 #define _MTK_DRM_PLANE_H_
 
 #include <drm/drm_crtc.h>
+#include <drm/drm_rect.h>
 #include <linux/types.h>
 
 struct mtk_plane_pending_state {
@@ -21,6 +22,8 @@ struct mtk_plane_pending_state {
 	unsigned int			width;
 	unsigned int			height;
 	unsigned int			rotation;
+	/* damaged area in crtc coordinates, empty for a full update */
+	struct drm_rect			damage;
 	bool				dirty;
 	bool				async_dirty;
 	bool				async_config;
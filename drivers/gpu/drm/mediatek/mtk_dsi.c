@@ -23,6 +23,7 @@
 #include <drm/drm_panel.h>
 #include <drm/drm_print.h>
 #include <drm/drm_probe_helper.h>
+#include <drm/drm_rect.h>
 #include <drm/drm_simple_kms_helper.h>
 
 #include "mtk_drm_ddp_comp.h"
@@ -199,6 +200,7 @@ struct mtk_dsi {
 	enum mipi_dsi_pixel_format format;
 	unsigned int lanes;
 	struct videomode vm;
+	struct drm_rect roi;
 	struct mtk_phy_timing phy_timing;
 	int refcount;
 	bool enabled;
@@ -648,6 +650,7 @@ static int mtk_dsi_poweron(struct mtk_dsi *dsi)
 	usleep_range(30, 100);
 	mtk_dsi_reset_dphy(dsi);
 	mtk_dsi_ps_control_vact(dsi);
+	memset(&dsi->roi, 0, sizeof(dsi->roi));
 	mtk_dsi_set_vm_cmd(dsi);
 	mtk_dsi_config_vdo_timing(dsi);
 	mtk_dsi_set_interrupt_enable(dsi);
@@ -781,9 +784,65 @@ static void mtk_dsi_ddp_stop(struct mtk_ddp_comp *comp)
 	mtk_dsi_poweroff(dsi);
 }
 
+static ssize_t mtk_dsi_host_transfer(struct mipi_dsi_host *host,
+				     const struct mipi_dsi_msg *msg);
+
+static void mtk_dsi_set_window(struct mtk_dsi *dsi, u8 cmd, int start, int end)
+{
+	u8 buf[5] = { cmd, start >> 8, start & 0xff, end >> 8, end & 0xff };
+	struct mipi_dsi_msg msg = {
+		.type = MIPI_DSI_DCS_LONG_WRITE,
+		.tx_buf = buf,
+		.tx_len = sizeof(buf),
+	};
+
+	if (mtk_dsi_host_transfer(&dsi->host, &msg) < 0)
+		DRM_ERROR("failed to set dsi window 0x%02x\n", cmd);
+}
+
+static bool mtk_dsi_ddp_partial_capable(struct mtk_ddp_comp *comp)
+{
+	struct mtk_dsi *dsi = container_of(comp, struct mtk_dsi, ddp_comp);
+
+	/* video mode panels are refreshed in full by the host every frame */
+	return dsi->enabled && !(dsi->mode_flags & MIPI_DSI_MODE_VIDEO);
+}
+
+/*
+ * The DSI registers are not reachable through the GCE, so the window is
+ * programmed by the CPU. In command mode the engine only latches it on
+ * the next frame trigger, which comes after the display packet is queued.
+ */
+static void mtk_dsi_ddp_partial_update(struct mtk_ddp_comp *comp,
+				       const struct drm_rect *roi,
+				       struct cmdq_pkt *cmdq_pkt)
+{
+	struct mtk_dsi *dsi = container_of(comp, struct mtk_dsi, ddp_comp);
+	u32 ps_wc;
+
+	if (!mtk_dsi_ddp_partial_capable(comp) ||
+	    drm_rect_equals(roi, &dsi->roi))
+		return;
+
+	dsi->roi = *roi;
+	ps_wc = drm_rect_width(roi) *
+		(dsi->format == MIPI_DSI_FMT_RGB565 ? 2 : 3);
+
+	writel(drm_rect_height(roi), dsi->regs + DSI_VACT_NL);
+	mtk_dsi_mask(dsi, DSI_PSCTRL, DSI_PS_WC, ps_wc);
+	writel(ps_wc, dsi->regs + DSI_HSTX_CKL_WC);
+
+	mtk_dsi_set_window(dsi, MIPI_DCS_SET_COLUMN_ADDRESS,
+			   roi->x1, roi->x2 - 1);
+	mtk_dsi_set_window(dsi, MIPI_DCS_SET_PAGE_ADDRESS,
+			   roi->y1, roi->y2 - 1);
+}
+
 static const struct mtk_ddp_comp_funcs mtk_dsi_funcs = {
 	.start = mtk_dsi_ddp_start,
 	.stop = mtk_dsi_ddp_stop,
+	.partial_capable = mtk_dsi_ddp_partial_capable,
+	.partial_update = mtk_dsi_ddp_partial_update,
 };
 
 static int mtk_dsi_host_attach(struct mipi_dsi_host *host,
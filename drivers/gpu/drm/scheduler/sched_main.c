@@ -45,6 +45,8 @@
  */
 
 #include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
 #include <linux/completion.h>
@@ -62,6 +64,12 @@
 
 static void drm_sched_process_job(struct dma_fence *f, struct dma_fence_cb *cb);
 
+static int drm_sched_policy = DRM_SCHED_POLICY_RR;
+
+MODULE_PARM_DESC(sched_policy,
+		 "Entity selection policy (0 = round robin (default), 1 = earliest deadline first)");
+module_param_named(sched_policy, drm_sched_policy, int, 0444);
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -162,6 +170,43 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	return NULL;
 }
 
+/**
+ * drm_sched_rq_select_entity_deadline - Select the ready entity due first
+ *
+ * @rq: scheduler run queue to check.
+ * @deadline: in: best deadline found so far, out: deadline of the result.
+ *
+ * Look for a ready entity whose next job carries a deadline hint earlier
+ * than @deadline. Returns NULL if there is none.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_deadline(struct drm_sched_rq *rq, ktime_t *deadline)
+{
+	struct drm_sched_entity *entity, *best = NULL;
+	struct spsc_node *node;
+	ktime_t job_deadline;
+
+	spin_lock(&rq->lock);
+	list_for_each_entry(entity, &rq->entities, list) {
+		if (!drm_sched_entity_is_ready(entity))
+			continue;
+
+		/* the scheduler thread is the only consumer of job_queue */
+		node = spsc_queue_peek(&entity->job_queue);
+		if (!node)
+			continue;
+
+		job_deadline = to_drm_sched_job(node)->deadline;
+		if (job_deadline && ktime_before(job_deadline, *deadline)) {
+			*deadline = job_deadline;
+			best = entity;
+		}
+	}
+	spin_unlock(&rq->lock);
+
+	return best;
+}
+
 /**
  * drm_sched_dependency_optimized
  *
@@ -564,6 +609,7 @@ int drm_sched_job_init(struct drm_sched_job *job,
 	if (!job->s_fence)
 		return -ENOMEM;
 	job->id = atomic64_inc_return(&sched->job_id_count);
+	job->deadline = 0;
 
 	INIT_LIST_HEAD(&job->node);
 
@@ -571,6 +617,24 @@ int drm_sched_job_init(struct drm_sched_job *job,
 }
 EXPORT_SYMBOL(drm_sched_job_init);
 
+/**
+ * drm_sched_job_set_deadline - give a job a deadline hint
+ *
+ * @job: scheduler job, between drm_sched_job_init() and
+ *	 drm_sched_entity_push_job()
+ * @deadline: time by which the job's result is needed, e.g. the next vblank
+ *	      for a compositor job
+ *
+ * Only used when the scheduler runs with the deadline policy. The hint of
+ * the job at the head of an entity decides when that entity is picked; an
+ * earlier hint never reorders jobs within the entity.
+ */
+void drm_sched_job_set_deadline(struct drm_sched_job *job, ktime_t deadline)
+{
+	job->deadline = deadline;
+}
+EXPORT_SYMBOL(drm_sched_job_set_deadline);
+
 /**
  * drm_sched_job_cleanup - clean up scheduler job resources
  *
@@ -624,6 +688,28 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 	if (!drm_sched_ready(sched))
 		return NULL;
 
+	if (drm_sched_policy == DRM_SCHED_POLICY_DEADLINE) {
+		struct drm_sched_entity *best = NULL;
+		ktime_t deadline = KTIME_MAX;
+
+		/* kernel jobs still go first, everything else by deadline */
+		entity = drm_sched_rq_select_entity(&sched->sched_rq[DRM_SCHED_PRIORITY_KERNEL]);
+		if (entity)
+			return entity;
+
+		for (i = DRM_SCHED_PRIORITY_KERNEL - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
+			entity = drm_sched_rq_select_entity_deadline(&sched->sched_rq[i],
+								     &deadline);
+			if (entity)
+				best = entity;
+		}
+
+		if (best) {
+			reinit_completion(&best->entity_idle);
+			return best;
+		}
+	}
+
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
 		entity = drm_sched_rq_select_entity(&sched->sched_rq[i]);
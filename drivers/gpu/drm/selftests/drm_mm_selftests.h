@@ -15,6 +15,8 @@ selftest(replace, igt_replace)
 selftest(insert_range, igt_insert_range)
 selftest(align, igt_align)
 selftest(frag, igt_frag)
+selftest(frag_bench, igt_frag_bench)
+selftest(best_range, igt_best_range)
 selftest(align32, igt_align32)
 selftest(align64, igt_align64)
 selftest(evict, igt_evict)
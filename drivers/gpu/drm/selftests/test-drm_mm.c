@@ -11,6 +11,7 @@
 #include <linux/random.h>
 #include <linux/vmalloc.h>
 #include <linux/ktime.h>
+#include <linux/sort.h>
 
 #include <drm/drm_mm.h>
 
@@ -1150,6 +1151,215 @@ static int igt_frag(void *ignored)
 	return ret;
 }
 
+static int igt_best_range(void *ignored)
+{
+	/* Holes (in pages) left behind in a 2048 page mm */
+	static const struct {
+		u64 start, size;
+	} holes[] = {
+		{ 16, 16 },
+		{ 64, 4 },
+		{ 129, 3 },
+		{ 200, 2 },
+		{ 1000, 2 },
+	};
+	/* Expected placements of 2 page, 4 page aligned nodes in [0, 512) */
+	static const u64 expect[] = { 200, 64, 16, 20 };
+	struct drm_mm_node fill[ARRAY_SIZE(holes) + 1] = {};
+	struct drm_mm_node nodes[ARRAY_SIZE(expect)] = {};
+	struct drm_mm_node *node, *next;
+	struct drm_mm mm;
+	u64 last = 0;
+	unsigned int n;
+	int ret = -EINVAL;
+
+	/* A best-fit search confined to a quarter of the mm has to return
+	 * the smallest hole in the range the aligned node fits, ignoring
+	 * smaller holes outside of the range and holes too misaligned.
+	 */
+	drm_mm_init(&mm, 0, 2048 * PAGE_SIZE);
+	for (n = 0; n <= ARRAY_SIZE(holes); n++) {
+		u64 end = n < ARRAY_SIZE(holes) ? holes[n].start : 2048;
+
+		fill[n].start = last * PAGE_SIZE;
+		fill[n].size = (end - last) * PAGE_SIZE;
+		if (drm_mm_reserve_node(&mm, &fill[n])) {
+			pr_err("reserve of filler %u failed\n", n);
+			goto out;
+		}
+
+		if (n < ARRAY_SIZE(holes))
+			last = holes[n].start + holes[n].size;
+	}
+
+	for (n = 0; n < ARRAY_SIZE(expect); n++) {
+		int err;
+
+		err = drm_mm_insert_node_in_range(&mm, &nodes[n],
+						  2 * PAGE_SIZE, 4 * PAGE_SIZE,
+						  0, 0, 512 * PAGE_SIZE,
+						  DRM_MM_INSERT_BEST);
+		if (err) {
+			pr_err("best-fit insert %u into range failed, err=%d\n",
+			       n, err);
+			goto out;
+		}
+
+		if (nodes[n].start != expect[n] * PAGE_SIZE) {
+			pr_err("best-fit insert %u placed at page %llu, expected %llu\n",
+			       n, nodes[n].start / PAGE_SIZE, expect[n]);
+			goto out;
+		}
+	}
+
+	ret = 0;
+out:
+	if (ret)
+		show_mm(&mm);
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+	return ret;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int frag_bench_mode(struct drm_mm *mm, struct drm_mm_node *nodes,
+			   unsigned int count, u64 *lat,
+			   const char *name, enum drm_mm_insert_mode mode,
+			   u64 range_start, u64 range_end,
+			   struct rnd_state *prng)
+{
+	unsigned int n;
+	int ret = 0;
+
+	for (n = 0; n < count; n++) {
+		u64 size = (1 + prandom_u32_state(prng) % 4) * PAGE_SIZE;
+		u64 alignment = PAGE_SIZE << (prandom_u32_state(prng) % 4);
+		ktime_t start;
+		int err;
+
+		start = ktime_get();
+		err = drm_mm_insert_node_in_range(mm, &nodes[n],
+						  size, alignment, 0,
+						  range_start, range_end,
+						  mode);
+		lat[n] = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (err) {
+			pr_err("%s fragmented insert %u (size=%llu, alignment=%llu) failed with err=%d\n",
+			       name, n, size, alignment, err);
+			ret = err;
+			count = n;
+			break;
+		}
+
+		if (!assert_node(&nodes[n], mm, size, alignment, 0) ||
+		    nodes[n].start < range_start ||
+		    nodes[n].start + size > range_end) {
+			pr_err("%s fragmented insert %u misplaced\n", name, n);
+			drm_mm_remove_node(&nodes[n]);
+			ret = -EINVAL;
+			count = n;
+			break;
+		}
+	}
+
+	if (!ret) {
+		sort(lat, count, sizeof(*lat), cmp_u64, NULL);
+		pr_info("%s fragmented insert of %u nodes: p50 %llu, p90 %llu, p99 %llu, max %llu nsecs\n",
+			name, count,
+			lat[count / 2], lat[count * 9 / 10],
+			lat[count * 99 / 100], lat[count - 1]);
+	}
+
+	for (n = 0; n < count; n++)
+		drm_mm_remove_node(&nodes[n]);
+
+	return ret;
+}
+
+static int igt_frag_bench(void *ignored)
+{
+	const unsigned int count = 8192, samples = 2048;
+	DRM_RND_STATE(prng, random_seed);
+	struct drm_mm_node *nodes, *node, *next;
+	unsigned int *order, n;
+	struct drm_mm mm;
+	u64 frag_end;
+	u64 *lat;
+	int ret = -ENOMEM;
+
+	nodes = vzalloc(array_size(count + samples, sizeof(*nodes)));
+	if (!nodes)
+		goto err;
+
+	lat = vmalloc(array_size(samples, sizeof(*lat)));
+	if (!lat)
+		goto err_nodes;
+
+	order = drm_random_order(count, &prng);
+	if (!order)
+		goto err_lat;
+
+	/* Fill the bottom half of the mm with randomly sized nodes and free
+	 * a random half of them again. The top half stays empty, so each
+	 * mode below finds space but first has to wade through the holes.
+	 */
+	ret = -EINVAL;
+	drm_mm_init(&mm, 0, 2 * count * 4 * PAGE_SIZE);
+	for (n = 0; n < count; n++) {
+		u64 size = (1 + prandom_u32_state(&prng) % 4) * PAGE_SIZE;
+
+		if (drm_mm_insert_node_generic(&mm, &nodes[n], size, 0, 0,
+					       DRM_MM_INSERT_LOW)) {
+			pr_err("fragmentation insert %u failed\n", n);
+			goto out;
+		}
+	}
+	frag_end = nodes[count - 1].start + nodes[count - 1].size;
+
+	for (n = 0; n < count / 2; n++)
+		drm_mm_remove_node(&nodes[order[n]]);
+
+	ret = frag_bench_mode(&mm, nodes + count, samples, lat,
+			      "best", DRM_MM_INSERT_BEST, 0, U64_MAX, &prng);
+	if (ret)
+		goto out;
+
+	ret = frag_bench_mode(&mm, nodes + count, samples, lat,
+			      "best-range", DRM_MM_INSERT_BEST,
+			      frag_end / 2, frag_end + frag_end / 2, &prng);
+	if (ret)
+		goto out;
+
+	ret = frag_bench_mode(&mm, nodes + count, samples, lat,
+			      "bottom-up", DRM_MM_INSERT_LOW, 0, U64_MAX, &prng);
+	if (ret)
+		goto out;
+
+	ret = frag_bench_mode(&mm, nodes + count, samples, lat,
+			      "top-down", DRM_MM_INSERT_HIGH, 0, U64_MAX, &prng);
+
+out:
+	if (ret)
+		show_mm(&mm);
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+	kfree(order);
+err_lat:
+	vfree(lat);
+err_nodes:
+	vfree(nodes);
+err:
+	return ret;
+}
+
 static int igt_align(void *ignored)
 {
 	const struct insert_mode *mode;
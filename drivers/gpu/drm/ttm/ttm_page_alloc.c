@@ -42,6 +42,8 @@
 #include <linux/seq_file.h> /* for seq_printf */
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-buf.h>
+#include <linux/sizes.h>
 
 #include <linux/atomic.h>
 
@@ -54,6 +56,17 @@
 #define FREE_ALL_PAGES			(~0U)
 /* times are in msecs */
 #define PAGE_FREE_INTERVAL		1000
+/*
+ * 64K chunks are what IOMMUs map with a single contiguous-hint entry, so
+ * they are worth a cheap try before falling back to single pages. Unlike
+ * huge pages they are split right after allocation and freed page by
+ * page.
+ */
+#define TTM_64K_ORDER			(ilog2(SZ_64K) - PAGE_SHIFT)
+#define TTM_64K_NR			(1 << TTM_64K_ORDER)
+#define TTM_64K_GFP			((GFP_HIGHUSER | __GFP_NOWARN | \
+					  __GFP_NORETRY | __GFP_NOMEMALLOC) & \
+					 ~__GFP_DIRECT_RECLAIM)
 
 /**
  * struct ttm_page_pool - Pool to reuse recently allocated uc/wc pages.
@@ -65,6 +78,9 @@
  * @list: Pool of free uc/wc pages for fast reuse.
  * @gfp_flags: Flags to pass for alloc_page.
  * @npages: Number of pages in pool.
+ * @nhits: Number of pages handed out from the pool.
+ * @nmisses: Number of pages that had to be allocated for lack of pool pages.
+ * @split: Pool entries are runs of 1 << @order separately freeable pages.
  */
 struct ttm_page_pool {
 	spinlock_t		lock;
@@ -75,7 +91,10 @@ struct ttm_page_pool {
 	char			*name;
 	unsigned long		nfrees;
 	unsigned long		nrefills;
+	unsigned long		nhits;
+	unsigned long		nmisses;
 	unsigned int		order;
+	bool			split;
 };
 
 /**
@@ -88,9 +107,10 @@ struct ttm_pool_opts {
 	unsigned	alloc_size;
 	unsigned	max_size;
 	unsigned	small;
+	unsigned	high_order;
 };
 
-#define NUM_POOLS 6
+#define NUM_POOLS 8
 
 /**
  * struct ttm_pool_manager - Holds memory pools for fst allocation
@@ -119,6 +139,8 @@ struct ttm_pool_manager {
 			struct ttm_page_pool	uc_pool_dma32;
 			struct ttm_page_pool	wc_pool_huge;
 			struct ttm_page_pool	uc_pool_huge;
+			struct ttm_page_pool	wc_pool_64k;
+			struct ttm_page_pool	uc_pool_64k;
 		} ;
 	};
 };
@@ -135,11 +157,16 @@ static struct attribute ttm_page_pool_alloc_size = {
 	.name = "pool_allocation_size",
 	.mode = S_IRUGO | S_IWUSR
 };
+static struct attribute ttm_page_pool_high_order = {
+	.name = "pool_high_order",
+	.mode = S_IRUGO | S_IWUSR
+};
 
 static struct attribute *ttm_pool_attrs[] = {
 	&ttm_page_pool_max,
 	&ttm_page_pool_small,
 	&ttm_page_pool_alloc_size,
+	&ttm_page_pool_high_order,
 	NULL
 };
 
@@ -161,6 +188,11 @@ static ssize_t ttm_pool_store(struct kobject *kobj,
 	if (chars == 0)
 		return size;
 
+	if (attr == &ttm_page_pool_high_order) {
+		m->options.high_order = !!val;
+		return size;
+	}
+
 	/* Convert kb to number of pages */
 	val = val / (PAGE_SIZE >> 10);
 
@@ -191,6 +223,10 @@ static ssize_t ttm_pool_show(struct kobject *kobj,
 		container_of(kobj, struct ttm_pool_manager, kobj);
 	unsigned val = 0;
 
+	if (attr == &ttm_page_pool_high_order)
+		return snprintf(buffer, PAGE_SIZE, "%u\n",
+				m->options.high_order);
+
 	if (attr == &ttm_page_pool_max)
 		val = m->options.max_size;
 	else if (attr == &ttm_page_pool_small)
@@ -217,8 +253,9 @@ static struct kobj_type ttm_pool_kobj_type = {
 static struct ttm_pool_manager *_manager;
 
 /**
- * Select the right pool or requested caching state and ttm flags. */
-static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
+ * Select the right pool or requested caching state, order and ttm flags.
+ * Only order 0, TTM_64K_ORDER (if above 0) and HPAGE_PMD_ORDER have pools. */
+static struct ttm_page_pool *ttm_get_pool(int flags, unsigned int order,
 					  enum ttm_caching_state cstate)
 {
 	int pool_index;
@@ -232,12 +269,12 @@ static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
 		pool_index = 0x1;
 
 	if (flags & TTM_PAGE_FLAG_DMA32) {
-		if (huge)
+		if (order)
 			return NULL;
 		pool_index |= 0x2;
 
-	} else if (huge) {
-		pool_index |= 0x4;
+	} else if (order) {
+		pool_index |= order == TTM_64K_ORDER ? 0x6 : 0x4;
 	}
 
 	return &_manager->pools[pool_index];
@@ -245,9 +282,9 @@ static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
 
 /* set memory back to wb and free the pages. */
 static void ttm_pages_put(struct page *pages[], unsigned npages,
-		unsigned int order)
+		unsigned int order, bool split)
 {
-	unsigned int i, pages_nr = (1 << order);
+	unsigned int i, j, pages_nr = (1 << order);
 
 	if (order == 0) {
 		if (ttm_set_pages_array_wb(pages, npages))
@@ -259,7 +296,12 @@ static void ttm_pages_put(struct page *pages[], unsigned npages,
 			if (ttm_set_pages_wb(pages[i], pages_nr))
 				pr_err("Failed to set %d pages to wb!\n", pages_nr);
 		}
-		__free_pages(pages[i], order);
+		if (split) {
+			for (j = 0; j < pages_nr; ++j)
+				__free_page(pages[i] + j);
+		} else {
+			__free_pages(pages[i], order);
+		}
 	}
 }
 
@@ -268,6 +310,7 @@ static void ttm_pool_update_free_locked(struct ttm_page_pool *pool,
 {
 	pool->npages -= freed_pages;
 	pool->nfrees += freed_pages;
+	dma_buf_pool_account(-((long)freed_pages << pool->order));
 }
 
 /**
@@ -324,7 +367,8 @@ static int ttm_page_pool_free(struct ttm_page_pool *pool, unsigned nr_free,
 			 */
 			spin_unlock_irqrestore(&pool->lock, irq_flags);
 
-			ttm_pages_put(pages_to_free, freed_pages, pool->order);
+			ttm_pages_put(pages_to_free, freed_pages, pool->order,
+				      pool->split);
 			if (likely(nr_free != FREE_ALL_PAGES))
 				nr_free -= freed_pages;
 
@@ -359,7 +403,8 @@ static int ttm_page_pool_free(struct ttm_page_pool *pool, unsigned nr_free,
 	spin_unlock_irqrestore(&pool->lock, irq_flags);
 
 	if (freed_pages)
-		ttm_pages_put(pages_to_free, freed_pages, pool->order);
+		ttm_pages_put(pages_to_free, freed_pages, pool->order,
+			      pool->split);
 out:
 	if (pages_to_free != static_buf)
 		kfree(pages_to_free);
@@ -486,7 +531,7 @@ static void ttm_handle_caching_state_failure(struct list_head *pages,
  */
 static int ttm_alloc_new_pages(struct list_head *pages, gfp_t gfp_flags,
 			       int ttm_flags, enum ttm_caching_state cstate,
-			       unsigned count, unsigned order)
+			       unsigned count, unsigned order, bool split)
 {
 	struct page **caching_array;
 	struct page *p;
@@ -524,6 +569,8 @@ static int ttm_alloc_new_pages(struct list_head *pages, gfp_t gfp_flags,
 			goto out;
 		}
 
+		if (split)
+			split_page(p, order);
 		list_add(&p->lru, pages);
 
 #ifdef CONFIG_HIGHMEM
@@ -588,7 +635,7 @@ static void ttm_page_pool_fill_locked(struct ttm_page_pool *pool, int ttm_flags,
 	/* If allocation request is small and there are not enough
 	 * pages in a pool we fill the pool up first. */
 	if (count < _manager->options.small
-		&& count > pool->npages) {
+		&& count > pool->npages && !dma_buf_pool_excess()) {
 		struct list_head new_pages;
 		unsigned alloc_size = _manager->options.alloc_size;
 
@@ -600,13 +647,14 @@ static void ttm_page_pool_fill_locked(struct ttm_page_pool *pool, int ttm_flags,
 
 		INIT_LIST_HEAD(&new_pages);
 		r = ttm_alloc_new_pages(&new_pages, pool->gfp_flags, ttm_flags,
-					cstate, alloc_size, 0);
+					cstate, alloc_size, 0, false);
 		spin_lock_irqsave(&pool->lock, *irq_flags);
 
 		if (!r) {
 			list_splice(&new_pages, &pool->list);
 			++pool->nrefills;
 			pool->npages += alloc_size;
+			dma_buf_pool_account(alloc_size);
 		} else {
 			pr_debug("Failed to fill pool (%p)\n", pool);
 			/* If we have any pages left put them to the pool. */
@@ -615,6 +663,7 @@ static void ttm_page_pool_fill_locked(struct ttm_page_pool *pool, int ttm_flags,
 			}
 			list_splice(&new_pages, &pool->list);
 			pool->npages += cpages;
+			dma_buf_pool_account(cpages);
 		}
 
 	}
@@ -646,6 +695,9 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 		/* take all pages from the pool */
 		list_splice_init(&pool->list, pages);
 		count -= pool->npages;
+		pool->nhits += pool->npages;
+		pool->nmisses += count;
+		dma_buf_pool_account(-((long)pool->npages << pool->order));
 		pool->npages = 0;
 		goto out;
 	}
@@ -667,6 +719,8 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 	/* Cut 'count' number of pages from the pool */
 	list_cut_position(pages, &pool->list, p);
 	pool->npages -= count;
+	pool->nhits += count;
+	dma_buf_pool_account(-((long)count << pool->order));
 	count = 0;
 out:
 	spin_unlock_irqrestore(&pool->lock, irq_flags);
@@ -676,10 +730,8 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 		struct page *page;
 
 		list_for_each_entry(page, pages, lru) {
-			if (PageHighMem(page))
-				clear_highpage(page);
-			else
-				clear_page(page_address(page));
+			for (i = 0; i < (1 << order); ++i)
+				clear_highpage(page + i);
 		}
 	}
 
@@ -698,21 +750,74 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 		 * multiple requests in parallel.
 		 **/
 		r = ttm_alloc_new_pages(pages, gfp_flags, ttm_flags, cstate,
-					count, order);
+					count, order, pool->split);
 	}
 
 	return r;
 }
 
+/*
+ * Move runs of TTM_64K_NR contiguous, naturally aligned pages from @pages
+ * to @pool. Whether they came from a 64K allocation or just happen to be
+ * contiguous doesn't matter since the pool frees them page by page.
+ */
+static void ttm_put_pages_64k(struct ttm_page_pool *pool, struct page **pages,
+			      unsigned i, unsigned npages)
+{
+	unsigned long irq_flags;
+	unsigned max_size, n2free;
+
+	spin_lock_irqsave(&pool->lock, irq_flags);
+	while ((npages - i) >= TTM_64K_NR) {
+		struct page *p = pages[i];
+		unsigned j;
+
+		if (!p || !IS_ALIGNED(page_to_pfn(p), TTM_64K_NR)) {
+			++i;
+			continue;
+		}
+
+		for (j = 0; j < TTM_64K_NR; ++j, ++p)
+			if (p != pages[i + j] || page_count(p) != 1)
+				break;
+
+		if (j != TTM_64K_NR) {
+			++i;
+			continue;
+		}
+
+		list_add_tail(&pages[i]->lru, &pool->list);
+
+		for (j = 0; j < TTM_64K_NR; ++j)
+			pages[i++] = NULL;
+		pool->npages++;
+		dma_buf_pool_account(TTM_64K_NR);
+	}
+
+	/* Check that we don't go over the pool limit */
+	max_size = _manager->options.max_size >> TTM_64K_ORDER;
+	n2free = pool->npages > max_size ? pool->npages - max_size : 0;
+	n2free = max_t(unsigned, n2free,
+		       min_t(unsigned long, pool->npages,
+			     DIV_ROUND_UP(dma_buf_pool_excess(),
+					  TTM_64K_NR)));
+	spin_unlock_irqrestore(&pool->lock, irq_flags);
+	if (n2free)
+		ttm_page_pool_free(pool, n2free, false);
+}
+
 /* Put all pages in pages list to correct pool to wait for reuse */
 static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			  enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
+	struct ttm_page_pool *pool = ttm_get_pool(flags, 0, cstate);
+	struct ttm_page_pool *pool_64k = TTM_64K_ORDER > 0 ?
+		ttm_get_pool(flags, TTM_64K_ORDER, cstate) : NULL;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
+	struct ttm_page_pool *huge = ttm_get_pool(flags, HPAGE_PMD_ORDER,
+						  cstate);
 #endif
-	unsigned long irq_flags;
+	unsigned long irq_flags, excess;
 	unsigned i;
 
 	if (pool == NULL) {
@@ -732,8 +837,10 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 			if (!(flags & TTM_PAGE_FLAG_DMA32) &&
 			    (npages - i) >= HPAGE_PMD_NR) {
+				/* tails of a huge page have no references */
 				for (j = 1; j < HPAGE_PMD_NR; ++j)
-					if (++p != pages[i + j])
+					if (++p != pages[i + j] ||
+					    page_ref_count(p))
 					    break;
 
 				if (j == HPAGE_PMD_NR)
@@ -768,7 +875,7 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 				break;
 
 			for (j = 1; j < HPAGE_PMD_NR; ++j)
-				if (++p != pages[i + j])
+				if (++p != pages[i + j] || page_ref_count(p))
 				    break;
 
 			if (j != HPAGE_PMD_NR)
@@ -779,6 +886,7 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			for (j = 0; j < HPAGE_PMD_NR; ++j)
 				pages[i++] = NULL;
 			huge->npages++;
+			dma_buf_pool_account(HPAGE_PMD_NR);
 		}
 
 		/* Check that we don't go over the pool limit */
@@ -788,12 +896,19 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			n2free = huge->npages - max_size;
 		else
 			n2free = 0;
+		n2free = max_t(unsigned, n2free,
+			       min_t(unsigned long, huge->npages,
+				     DIV_ROUND_UP(dma_buf_pool_excess(),
+						  HPAGE_PMD_NR)));
 		spin_unlock_irqrestore(&huge->lock, irq_flags);
 		if (n2free)
 			ttm_page_pool_free(huge, n2free, false);
 	}
 #endif
 
+	if (pool_64k)
+		ttm_put_pages_64k(pool_64k, pages, i, npages);
+
 	spin_lock_irqsave(&pool->lock, irq_flags);
 	while (i < npages) {
 		if (pages[i]) {
@@ -802,13 +917,18 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			list_add_tail(&pages[i]->lru, &pool->list);
 			pages[i] = NULL;
 			pool->npages++;
+			dma_buf_pool_account(1);
 		}
 		++i;
 	}
-	/* Check that we don't go over the pool limit */
+	/* Check that we don't go over the pool limit, nor the global budget */
 	npages = 0;
-	if (pool->npages > _manager->options.max_size) {
+	if (pool->npages > _manager->options.max_size)
 		npages = pool->npages - _manager->options.max_size;
+	excess = dma_buf_pool_excess();
+	if (excess > npages)
+		npages = min_t(unsigned long, excess, pool->npages);
+	if (npages) {
 		/* free at least NUM_PAGES_TO_ALLOC number of pages
 		 * to reduce calls to set_memory_wb */
 		if (npages < NUM_PAGES_TO_ALLOC)
@@ -826,10 +946,14 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 			 enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
+	struct ttm_page_pool *pool = ttm_get_pool(flags, 0, cstate);
+	struct ttm_page_pool *pool_64k = TTM_64K_ORDER > 0 ?
+		ttm_get_pool(flags, TTM_64K_ORDER, cstate) : NULL;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
+	struct ttm_page_pool *huge = ttm_get_pool(flags, HPAGE_PMD_ORDER,
+						  cstate);
 #endif
+	bool high_order = _manager->options.high_order;
 	struct list_head plist;
 	struct page *p = NULL;
 	unsigned count, first;
@@ -838,10 +962,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 	/* No pool for cached pages */
 	if (pool == NULL) {
 		gfp_t gfp_flags = GFP_USER;
-		unsigned i;
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
-		unsigned j;
-#endif
+		unsigned i, j;
 
 		/* set zero flag for page allocation if required */
 		if (flags & TTM_PAGE_FLAG_ZERO_ALLOC)
@@ -857,7 +978,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 
 		i = 0;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-		if (!(gfp_flags & GFP_DMA32)) {
+		if (!(gfp_flags & GFP_DMA32) && high_order) {
 			while (npages >= HPAGE_PMD_NR) {
 				gfp_t huge_flags = gfp_flags;
 
@@ -877,6 +998,24 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 		}
 #endif
 
+		while (TTM_64K_ORDER > 0 && high_order &&
+		       npages >= TTM_64K_NR) {
+			gfp_t flags_64k = (gfp_flags | __GFP_NOWARN |
+					   __GFP_NORETRY | __GFP_NOMEMALLOC) &
+					  ~(__GFP_DIRECT_RECLAIM |
+					    __GFP_RETRY_MAYFAIL);
+
+			p = alloc_pages(flags_64k, TTM_64K_ORDER);
+			if (!p)
+				break;
+
+			split_page(p, TTM_64K_ORDER);
+			for (j = 0; j < TTM_64K_NR; ++j)
+				pages[i++] = p++;
+
+			npages -= TTM_64K_NR;
+		}
+
 		first = i;
 		while (npages) {
 			p = alloc_page(gfp_flags);
@@ -898,7 +1037,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 	count = 0;
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	if (huge && npages >= HPAGE_PMD_NR) {
+	if (huge && high_order && npages >= HPAGE_PMD_NR) {
 		INIT_LIST_HEAD(&plist);
 		ttm_page_pool_get_pages(huge, &plist, flags, cstate,
 					npages / HPAGE_PMD_NR,
@@ -913,6 +1052,20 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 	}
 #endif
 
+	if (pool_64k && high_order && npages - count >= TTM_64K_NR) {
+		INIT_LIST_HEAD(&plist);
+		ttm_page_pool_get_pages(pool_64k, &plist, flags, cstate,
+					(npages - count) / TTM_64K_NR,
+					TTM_64K_ORDER);
+
+		list_for_each_entry(p, &plist, lru) {
+			unsigned j;
+
+			for (j = 0; j < TTM_64K_NR; ++j)
+				pages[count++] = &p[j];
+		}
+	}
+
 	INIT_LIST_HEAD(&plist);
 	r = ttm_page_pool_get_pages(pool, &plist, flags, cstate,
 				    npages - count, 0);
@@ -990,9 +1143,19 @@ int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
 				  ~(__GFP_MOVABLE | __GFP_COMP)
 				  , "uc huge", order);
 
+	order = max(TTM_64K_ORDER, 0);
+	ttm_page_pool_init_locked(&_manager->wc_pool_64k, TTM_64K_GFP,
+				  "wc 64k", order);
+	_manager->wc_pool_64k.split = true;
+
+	ttm_page_pool_init_locked(&_manager->uc_pool_64k, TTM_64K_GFP,
+				  "uc 64k", order);
+	_manager->uc_pool_64k.split = true;
+
 	_manager->options.max_size = max_pages;
 	_manager->options.small = SMALL_ALLOCATION;
 	_manager->options.alloc_size = NUM_PAGES_TO_ALLOC;
+	_manager->options.high_order = 1;
 
 	ret = kobject_init_and_add(&_manager->kobj, &ttm_pool_kobj_type,
 				   &glob->kobj, "pool");
@@ -1170,19 +1333,21 @@ int ttm_page_alloc_debugfs(struct seq_file *m, void *data)
 {
 	struct ttm_page_pool *p;
 	unsigned i;
-	char *h[] = {"pool", "refills", "pages freed", "size"};
+	char *h[] = {"pool", "refills", "pages freed", "size",
+		     "hits", "misses"};
 	if (!_manager) {
 		seq_printf(m, "No pool allocator running.\n");
 		return 0;
 	}
-	seq_printf(m, "%7s %12s %13s %8s\n",
-			h[0], h[1], h[2], h[3]);
+	seq_printf(m, "%7s %12s %13s %8s %12s %12s\n",
+			h[0], h[1], h[2], h[3], h[4], h[5]);
 	for (i = 0; i < NUM_POOLS; ++i) {
 		p = &_manager->pools[i];
 
-		seq_printf(m, "%7s %12ld %13ld %8d\n",
+		seq_printf(m, "%7s %12ld %13ld %8d %12ld %12ld\n",
 				p->name, p->nrefills,
-				p->nfrees, p->npages);
+				p->nfrees, p->npages,
+				p->nhits, p->nmisses);
 	}
 	return 0;
 }
@@ -13,6 +13,7 @@
 #include <linux/slab.h>
 #include <linux/stringhash.h>
 #include <linux/mutex.h>
+#include <linux/notifier.h>
 #include <linux/clk.h>
 #include <linux/coresight.h>
 #include <linux/of_platform.h>
@@ -83,6 +84,38 @@ struct coresight_device *coresight_get_percpu_sink(int cpu)
 }
 EXPORT_SYMBOL_GPL(coresight_get_percpu_sink);
 
+/*
+ * Sinks that can keep a snapshot of a running session (i.e. ETR in sysFS
+ * mode) register here, so that hang and jank detectors can stop the
+ * trace right after the event without knowing about the topology.
+ */
+static ATOMIC_NOTIFIER_HEAD(coresight_freeze_list);
+
+int coresight_register_freeze_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&coresight_freeze_list, nb);
+}
+EXPORT_SYMBOL_GPL(coresight_register_freeze_notifier);
+
+int coresight_unregister_freeze_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&coresight_freeze_list, nb);
+}
+EXPORT_SYMBOL_GPL(coresight_unregister_freeze_notifier);
+
+/**
+ * coresight_freeze_trace - stop collecting into the registered sinks
+ * @reason: short tag for the log, e.g. "hang"
+ *
+ * Safe to call from atomic context. Sinks keep their buffer until it is
+ * read from user space, which also restarts the capture.
+ */
+void coresight_freeze_trace(const char *reason)
+{
+	atomic_notifier_call_chain(&coresight_freeze_list, 0, (void *)reason);
+}
+EXPORT_SYMBOL_GPL(coresight_freeze_trace);
+
 static int coresight_id_match(struct device *dev, void *data)
 {
 	int trace_id, i_trace_id;
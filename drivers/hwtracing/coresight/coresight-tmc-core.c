@@ -347,9 +347,42 @@ static ssize_t buffer_size_store(struct device *dev,
 
 static DEVICE_ATTR_RW(buffer_size);
 
+static ssize_t freeze_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+
+	return sprintf(buf, "%d\n", drvdata->frozen);
+}
+
+static ssize_t freeze_store(struct device *dev,
+			    struct device_attribute *attr,
+			    const char *buf, size_t size)
+{
+	int ret;
+	bool val;
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+
+	/* Only permitted for TMC-ETRs */
+	if (drvdata->config_type != TMC_CONFIG_TYPE_ETR)
+		return -EPERM;
+
+	ret = kstrtobool(buf, &val);
+	if (ret)
+		return ret;
+	if (val) {
+		ret = tmc_etr_freeze(drvdata);
+		if (ret && ret != -EALREADY)
+			return ret;
+	}
+	return size;
+}
+static DEVICE_ATTR_RW(freeze);
+
 static struct attribute *coresight_tmc_attrs[] = {
 	&dev_attr_trigger_cntr.attr,
 	&dev_attr_buffer_size.attr,
+	&dev_attr_freeze.attr,
 	NULL,
 };
 
@@ -533,10 +566,16 @@ static int tmc_probe(struct amba_device *adev, const struct amba_id *id)
 	drvdata->miscdev.minor = MISC_DYNAMIC_MINOR;
 	drvdata->miscdev.fops = &tmc_fops;
 	ret = misc_register(&drvdata->miscdev);
-	if (ret)
+	if (ret) {
 		coresight_unregister(drvdata->csdev);
-	else
-		pm_runtime_put(&adev->dev);
+		goto out;
+	}
+
+	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR) {
+		drvdata->freeze_nb.notifier_call = tmc_etr_freeze_notify;
+		coresight_register_freeze_notifier(&drvdata->freeze_nb);
+	}
+	pm_runtime_put(&adev->dev);
 out:
 	return ret;
 }
@@ -572,6 +611,8 @@ static void tmc_remove(struct amba_device *adev)
 	 * etb fops in this case, device is there until last file
 	 * handler to this device is closed.
 	 */
+	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
+		coresight_unregister_freeze_notifier(&drvdata->freeze_nb);
 	misc_deregister(&drvdata->miscdev);
 	coresight_unregister(drvdata->csdev);
 }
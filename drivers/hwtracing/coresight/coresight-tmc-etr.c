@@ -1149,7 +1149,10 @@ static void __tmc_etr_disable_hw(struct tmc_drvdata *drvdata)
 
 void tmc_etr_disable_hw(struct tmc_drvdata *drvdata)
 {
-	__tmc_etr_disable_hw(drvdata);
+	/* A frozen ETR has already been stopped and synced */
+	if (!drvdata->frozen)
+		__tmc_etr_disable_hw(drvdata);
+	drvdata->frozen = false;
 	/* Disable CATU device if this ETR is connected to one */
 	tmc_etr_disable_catu(drvdata);
 	coresight_disclaim_device(drvdata->csdev);
@@ -1702,6 +1705,50 @@ static int tmc_disable_etr_sink(struct coresight_device *csdev)
 	return 0;
 }
 
+/*
+ * Stop a sysFS session in place, e.g. on a hang or a dropped frame.
+ * The ETR keeps running as a circular buffer until then, so the buffer
+ * ends up holding the trace leading to the event. Reading the misc
+ * device exports it and re-arms the ETR.
+ */
+int tmc_etr_freeze(struct tmc_drvdata *drvdata)
+{
+	int ret = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	if (drvdata->mode != CS_MODE_SYSFS || drvdata->reading) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (drvdata->frozen) {
+		ret = -EALREADY;
+		goto out;
+	}
+
+	__tmc_etr_disable_hw(drvdata);
+	drvdata->frozen = true;
+out:
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	return ret;
+}
+
+int tmc_etr_freeze_notify(struct notifier_block *nb,
+			  unsigned long action, void *data)
+{
+	struct tmc_drvdata *drvdata = container_of(nb, struct tmc_drvdata,
+						   freeze_nb);
+	const char *reason = data;
+
+	if (!tmc_etr_freeze(drvdata))
+		dev_info(&drvdata->csdev->dev, "trace frozen: %s\n",
+			 reason ? reason : "unknown");
+
+	return NOTIFY_OK;
+}
+
 static const struct coresight_ops_sink tmc_etr_sink_ops = {
 	.enable		= tmc_enable_etr_sink,
 	.disable	= tmc_disable_etr_sink,
@@ -1740,7 +1787,7 @@ int tmc_read_prepare_etr(struct tmc_drvdata *drvdata)
 	}
 
 	/* Disable the TMC if we are trying to read from a running session. */
-	if (drvdata->mode == CS_MODE_SYSFS)
+	if (drvdata->mode == CS_MODE_SYSFS && !drvdata->frozen)
 		__tmc_etr_disable_hw(drvdata);
 
 	drvdata->reading = true;
@@ -1769,6 +1816,7 @@ int tmc_read_unprepare_etr(struct tmc_drvdata *drvdata)
 		 * be NULL.
 		 */
 		__tmc_etr_enable_hw(drvdata);
+		drvdata->frozen = false;
 	} else {
 		/*
 		 * The ETR is not tracing and the buffer was just read.
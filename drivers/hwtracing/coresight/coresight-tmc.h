@@ -170,6 +170,9 @@ struct etr_buf {
  * @spinlock:	only one at a time pls.
  * @pid:	Process ID of the process being monitored by the session
  *		that is using this component.
+ * @frozen:	a running sysFS session of the ETR was stopped by a freeze
+ *		request; the buffer is kept until it is read.
+ * @freeze_nb:	hooks the ETR up to coresight_freeze_trace().
  * @buf:	Snapshot of the trace data for ETF/ETB.
  * @etr_buf:	details of buffer used in TMC-ETR
  * @len:	size of the available trace for ETF/ETB.
@@ -192,6 +195,8 @@ struct tmc_drvdata {
 	spinlock_t		spinlock;
 	pid_t			pid;
 	bool			reading;
+	bool			frozen;
+	struct notifier_block	freeze_nb;
 	union {
 		char		*buf;		/* TMC ETB */
 		struct etr_buf	*etr_buf;	/* TMC ETR */
@@ -269,6 +274,9 @@ ssize_t tmc_etb_get_sysfs_trace(struct tmc_drvdata *drvdata,
 int tmc_read_prepare_etr(struct tmc_drvdata *drvdata);
 int tmc_read_unprepare_etr(struct tmc_drvdata *drvdata);
 void tmc_etr_disable_hw(struct tmc_drvdata *drvdata);
+int tmc_etr_freeze(struct tmc_drvdata *drvdata);
+int tmc_etr_freeze_notify(struct notifier_block *nb,
+			  unsigned long action, void *data);
 extern const struct coresight_ops tmc_etr_cs_ops;
 ssize_t tmc_etr_get_sysfs_trace(struct tmc_drvdata *drvdata,
 				loff_t pos, size_t len, char **bufpp);
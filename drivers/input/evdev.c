@@ -23,6 +23,7 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/cdev.h>
+#include <linux/input-ring.h>
 #include "input-compat.h"
 
 struct evdev {
@@ -50,7 +51,8 @@ struct evdev_client {
 	bool revoked;
 	unsigned long *evmasks[EV_CNT];
 	unsigned int bufsize;
-	struct input_event buffer[];
+	struct input_ring_header *ring; /* shared ring, once mmapped */
+	struct input_event *buffer;
 };
 
 static size_t evdev_get_mask_cnt(unsigned int type)
@@ -97,6 +99,46 @@ static bool __evdev_is_filtered(struct evdev_client *client,
 	return mask && !test_bit(code, mask);
 }
 
+/*
+ * Shared ring support, see include/uapi/linux/input-ring.h.
+ * Both helpers require the buffer lock to be held.
+ */
+static void __evdev_ring_sync_tail(struct evdev_client *client)
+{
+	unsigned int mask = client->bufsize - 1;
+	unsigned int tail;
+
+	if (!client->ring)
+		return;
+
+	/* only accept a reader tail that stays within queued packets */
+	tail = READ_ONCE(client->ring->tail) & mask;
+	if (((tail - client->tail) & mask) <=
+	    ((client->packet_head - client->tail) & mask))
+		client->tail = tail;
+}
+
+static void __evdev_ring_publish(struct evdev_client *client, bool tail)
+{
+	if (!client->ring)
+		return;
+
+	if (tail)
+		WRITE_ONCE(client->ring->tail, client->tail);
+
+	/* events must be visible before the head that covers them */
+	smp_store_release(&client->ring->head, client->packet_head);
+}
+
+static bool evdev_client_has_packet(struct evdev_client *client)
+{
+	if (client->ring)
+		return (READ_ONCE(client->ring->tail) & (client->bufsize - 1)) !=
+			READ_ONCE(client->packet_head);
+
+	return client->packet_head != client->tail;
+}
+
 /* flush queued events of type @type, caller must hold client->buffer_lock */
 static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 {
@@ -107,6 +149,7 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 
 	BUG_ON(type == EV_SYN);
 
+	__evdev_ring_sync_tail(client);
 	head = client->tail;
 	client->packet_head = client->tail;
 
@@ -138,6 +181,7 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 	}
 
 	client->head = head;
+	__evdev_ring_publish(client, true);
 }
 
 static void __evdev_queue_syn_dropped(struct evdev_client *client)
@@ -159,6 +203,7 @@ static void __evdev_queue_syn_dropped(struct evdev_client *client)
 		/* drop queue but keep our SYN_DROPPED event */
 		client->tail = (client->head - 1) & (client->bufsize - 1);
 		client->packet_head = client->tail;
+		__evdev_ring_publish(client, true);
 	}
 }
 
@@ -200,9 +245,11 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 		 */
 		spin_lock_irqsave(&client->buffer_lock, flags);
 
+		__evdev_ring_sync_tail(client);
 		if (client->head != client->tail) {
 			client->packet_head = client->head = client->tail;
 			__evdev_queue_syn_dropped(client);
+			__evdev_ring_publish(client, true);
 		}
 
 		spin_unlock_irqrestore(&client->buffer_lock, flags);
@@ -233,6 +280,7 @@ static void __pass_event(struct evdev_client *client,
 		};
 
 		client->packet_head = client->tail;
+		__evdev_ring_publish(client, true);
 	}
 
 	if (event->type == EV_SYN && event->code == SYN_REPORT) {
@@ -260,6 +308,8 @@ static void evdev_pass_values(struct evdev_client *client,
 	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
 
+	__evdev_ring_sync_tail(client);
+
 	for (v = vals; v != vals + count; v++) {
 		if (__evdev_is_filtered(client, v->type, v->code))
 			continue;
@@ -278,8 +328,20 @@ static void evdev_pass_values(struct evdev_client *client,
 		__pass_event(client, &event);
 	}
 
+	__evdev_ring_publish(client, false);
+
 	spin_unlock(&client->buffer_lock);
 
+	/*
+	 * A ring reader drains complete packets without syscalls and only
+	 * wants a wakeup once it announced it is going to sleep. Pairs with
+	 * the reader setting waiting before it re-reads head.
+	 */
+	if (wakeup && client->ring) {
+		smp_mb();
+		wakeup = READ_ONCE(client->ring->waiting);
+	}
+
 	if (wakeup)
 		wake_up_interruptible_poll(&client->wait,
 			EPOLLIN | EPOLLOUT | EPOLLRDNORM | EPOLLWRNORM);
@@ -451,7 +513,11 @@ static int evdev_release(struct inode *inode, struct file *file)
 	for (i = 0; i < EV_CNT; ++i)
 		bitmap_free(client->evmasks[i]);
 
-	kvfree(client);
+	if (client->ring)
+		vfree(client->ring);
+	else
+		kvfree(client->buffer);
+	kfree(client);
 
 	evdev_close_device(evdev);
 
@@ -474,10 +540,17 @@ static int evdev_open(struct inode *inode, struct file *file)
 	struct evdev_client *client;
 	int error;
 
-	client = kvzalloc(struct_size(client, buffer, bufsize), GFP_KERNEL);
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
 	if (!client)
 		return -ENOMEM;
 
+	client->buffer = kvcalloc(bufsize, sizeof(*client->buffer),
+				  GFP_KERNEL);
+	if (!client->buffer) {
+		kfree(client);
+		return -ENOMEM;
+	}
+
 	init_waitqueue_head(&client->wait);
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
@@ -495,7 +568,8 @@ static int evdev_open(struct inode *inode, struct file *file)
 
  err_free_client:
 	evdev_detach_client(evdev, client);
-	kvfree(client);
+	kvfree(client->buffer);
+	kfree(client);
 	return error;
 }
 
@@ -544,10 +618,13 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 
 	spin_lock_irq(&client->buffer_lock);
 
+	__evdev_ring_sync_tail(client);
 	have_event = client->packet_head != client->tail;
 	if (have_event) {
 		*event = client->buffer[client->tail++];
 		client->tail &= client->bufsize - 1;
+		if (client->ring)
+			WRITE_ONCE(client->ring->tail, client->tail);
 	}
 
 	spin_unlock_irq(&client->buffer_lock);
@@ -571,7 +648,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
 
-		if (client->packet_head == client->tail &&
+		if (!evdev_client_has_packet(client) &&
 		    (file->f_flags & O_NONBLOCK))
 			return -EAGAIN;
 
@@ -595,8 +672,13 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 			break;
 
 		if (!(file->f_flags & O_NONBLOCK)) {
+			/* a blocked read() always wants the ring wakeup */
+			if (client->ring) {
+				WRITE_ONCE(client->ring->waiting, 1);
+				smp_mb();
+			}
 			error = wait_event_interruptible(client->wait,
-					client->packet_head != client->tail ||
+					evdev_client_has_packet(client) ||
 					!evdev->exist || client->revoked);
 			if (error)
 				return error;
@@ -620,12 +702,70 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 	else
 		mask = EPOLLHUP | EPOLLERR;
 
-	if (client->packet_head != client->tail)
+	if (evdev_client_has_packet(client))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
 	return mask;
 }
 
+/*
+ * Map the client's shared event ring, switching the client over to it
+ * on first use. Events queued before that are replaced by SYN_DROPPED.
+ */
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	struct input_ring_header *ring;
+	struct input_event *old = NULL;
+	bool had_events;
+	size_t size;
+
+	/* the ring only holds native struct input_event */
+	if (input_event_size() != sizeof(struct input_event))
+		return -EINVAL;
+
+	size = PAGE_SIZE +
+	       PAGE_ALIGN(client->bufsize * sizeof(struct input_event));
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != size)
+		return -EINVAL;
+
+	if (!evdev->exist || client->revoked)
+		return -ENODEV;
+
+	ring = vmalloc_user(size);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->version = INPUT_RING_VERSION;
+	ring->bufsize = client->bufsize;
+	ring->event_size = sizeof(struct input_event);
+	ring->data_offset = PAGE_SIZE;
+
+	spin_lock_irq(&client->buffer_lock);
+
+	if (!client->ring) {
+		old = client->buffer;
+		had_events = client->head != client->tail;
+
+		client->ring = ring;
+		client->buffer = (void *)ring + PAGE_SIZE;
+		client->packet_head = client->head = client->tail = 0;
+		if (had_events)
+			__evdev_queue_syn_dropped(client);
+		__evdev_ring_publish(client, true);
+		ring = NULL;
+	}
+
+	spin_unlock_irq(&client->buffer_lock);
+
+	/* lost the race against another mmap() of this client */
+	vfree(ring);
+	kvfree(old);
+
+	return remap_vmalloc_range(vma, client->ring, 0);
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -1294,6 +1434,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
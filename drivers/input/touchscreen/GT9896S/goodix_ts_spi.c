@@ -1151,6 +1151,7 @@ static int gt9896s_touch_handler_ys(struct gt9896s_ts_device *dev,
 	static u8 buffer[IRQ_HEAD_LEN_YS +
 			 BYTES_PER_COORD * GOODIX_MAX_TOUCH + 2];
 	int touch_num = 0, r = -EINVAL;
+	int pre_coor_num = (pre_buf_len - IRQ_HEAD_LEN_YS - 2) / BYTES_PER_COORD;
 	u8 point_type = 0;
 	u16 chksum = 0;
 
@@ -1169,10 +1170,11 @@ static int gt9896s_touch_handler_ys(struct gt9896s_ts_device *dev,
 		goto exit_clean_sta;
 	}
 
-	/* read all coor data */
-	if (unlikely(touch_num > 1)) {
+	/* read the coor data the head read did not cover */
+	if (unlikely(touch_num > pre_coor_num)) {
 		r = gt9896s_spi_read(dev, dev->reg.coor + pre_buf_len,
-				&buffer[pre_buf_len], (touch_num - 1) * BYTES_PER_COORD);
+				&buffer[pre_buf_len],
+				(touch_num - pre_coor_num) * BYTES_PER_COORD);
 		if (unlikely(r < 0))
 			goto exit_clean_sta;
 	}
@@ -1228,13 +1230,20 @@ static int gt9896s_event_handler(struct gt9896s_ts_device *dev,
 		struct gt9896s_ts_event *ts_event)
 {
 	int pre_read_len = 0;
-	u8 pre_buf[32];
+	u8 pre_buf[IRQ_HEAD_LEN_YS + BYTES_PER_COORD * GOODIX_MAX_TOUCH + 2];
 	u8 event_sta;
 	int r;
+	/*
+	 * coords fetched together with the irq head, follows the finger
+	 * count of the previous frame so a steady multi finger gesture
+	 * costs a single spi transfer per report
+	 */
+	static u8 pre_coor_num = 1;
 
 	/* get coor pre_read_len */
 	if (dev->ic_type == IC_TYPE_YELLOWSTONE_SPI)
-		pre_read_len = IRQ_HEAD_LEN_YS + BYTES_PER_COORD + 2;
+		pre_read_len = IRQ_HEAD_LEN_YS +
+			       BYTES_PER_COORD * pre_coor_num + 2;
 
 	/* read coor head */
 	r = gt9896s_spi_read(dev, dev->reg.coor, pre_buf, pre_read_len);
@@ -1255,8 +1264,11 @@ static int gt9896s_event_handler(struct gt9896s_ts_device *dev,
 	event_sta = pre_buf[0];
 	if (likely((event_sta & GOODIX_TOUCH_EVENT) == GOODIX_TOUCH_EVENT)) {
 		/* handle touch event */
-		if (dev->ic_type == IC_TYPE_YELLOWSTONE_SPI)
+		if (dev->ic_type == IC_TYPE_YELLOWSTONE_SPI) {
 			gt9896s_touch_handler_ys(dev, ts_event, pre_buf, pre_read_len);
+			pre_coor_num = clamp_t(u8, pre_buf[2] & 0x0F, 1,
+					       GOODIX_MAX_TOUCH);
+		}
 	} else if (unlikely((event_sta & GOODIX_REQUEST_EVENT) ==
 			     GOODIX_REQUEST_EVENT)) {
 		/* handle request event */
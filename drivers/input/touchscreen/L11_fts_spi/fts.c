@@ -4963,6 +4963,9 @@ static irqreturn_t fts_event_handler(int irq, void *ts_info)
 	unsigned char events_remaining = 0;
 	unsigned char *evt_data;
 	static char pre_id[3];
+	/* events read by the first transfer, follows the previous frame */
+	static unsigned char fifo_prefetch = 1;
+	unsigned char prefetched;
 	event_dispatch_handler_t event_handler;
 
 	if (info->tp_pm_suspend) {
@@ -4989,12 +4992,18 @@ static irqreturn_t fts_event_handler(int irq, void *ts_info)
 
 	info->touch_new_event_id = 0;
 
+	/*
+	 * Multi finger frames usually repeat, so read as many events as
+	 * the previous frame had in one transfer; unused slots come back
+	 * as EVT_ID_NOEVENT and end the dispatch loop below.
+	 */
+	prefetched = fifo_prefetch;
 #ifdef I2C_INTERFACE
-	error = fts_writeReadU8UX(regAdd, 0, 0, data, FIFO_EVENT_SIZE,
-				  DUMMY_FIFO);
+	error = fts_writeReadU8UX(regAdd, 0, 0, data,
+				  FIFO_EVENT_SIZE * prefetched, DUMMY_FIFO);
 #else
-	error = fts_writeReadU8UX_fast(regAdd, data, FIFO_EVENT_SIZE,
-				       DUMMY_FIFO);
+	error = fts_writeReadU8UX_fast(regAdd, data,
+				       FIFO_EVENT_SIZE * prefetched, DUMMY_FIFO);
 #endif
 	events_remaining = data[EVENTS_REMAINING_POS] & EVENTS_REMAINING_MASK;
 	if (events_remaining >= FIFO_DEPTH - 1)
@@ -5003,23 +5012,33 @@ static irqreturn_t fts_event_handler(int irq, void *ts_info)
 			   FIFO_DEPTH - 1 : events_remaining;
 
 	/*Drain the rest of the FIFO, up to 31 events*/
-	if (error == OK && events_remaining > 0) {
+	if (error == OK && events_remaining + 1 > prefetched) {
 #ifdef I2C_INTERFACE
-		error = fts_writeReadU8UX(regAdd, 0, 0, &data[FIFO_EVENT_SIZE],
-					  FIFO_EVENT_SIZE * events_remaining,
+		error = fts_writeReadU8UX(regAdd, 0, 0,
+					  &data[FIFO_EVENT_SIZE * prefetched],
+					  FIFO_EVENT_SIZE *
+					  (events_remaining + 1 - prefetched),
 					  DUMMY_FIFO);
 #else
-		error = fts_writeReadU8UX_fast(regAdd, &data[FIFO_EVENT_SIZE],
-					       FIFO_EVENT_SIZE * events_remaining,
+		error = fts_writeReadU8UX_fast(regAdd,
+					       &data[FIFO_EVENT_SIZE * prefetched],
+					       FIFO_EVENT_SIZE *
+					       (events_remaining + 1 - prefetched),
 					       DUMMY_FIFO);
 #endif
+		prefetched = events_remaining + 1;
 	}
+	fifo_prefetch = clamp_t(unsigned char, events_remaining + 1, 1,
+				TOUCH_ID_MAX);
+#ifdef FTS_XIAOMI_TOUCHFEATURE
+	xiaomi_touch_latency_mark(TOUCH_STAGE_READ);
+#endif
 	if (error != OK) {
 		logError(1,
 			 "Error (%d) while reading from FIFO in event_handler",
 			 error);
 	} else {
-		for (count = 0; count < events_remaining + 1; count++) {
+		for (count = 0; count < prefetched; count++) {
 			evt_data = &data[count * FIFO_EVENT_SIZE];
 			if (pre_id[0] == EVT_ID_USER_REPORT	&&
 			    pre_id[1] == 0x02 &&
@@ -5044,6 +5063,9 @@ static irqreturn_t fts_event_handler(int irq, void *ts_info)
 	}
 	fts_touch_forced_up_check(info);
 	input_sync(info->input_dev);
+#ifdef FTS_XIAOMI_TOUCHFEATURE
+	xiaomi_touch_latency_mark(TOUCH_STAGE_REPORT);
+#endif
 #ifdef TOUCH_THP_SUPPORT
 end:
 #endif
@@ -5357,8 +5379,17 @@ static int fts_interrupt_install(struct fts_ts_info *info)
 	/* disable interrupts in any case */
 	error = fts_disableInterrupt();
 	logError(1, "%s Interrupt Mode\n", tag);
+#ifdef FTS_XIAOMI_TOUCHFEATURE
+	ret = request_threaded_irq(info->client->irq, xiaomi_touch_irq_timestamp,
+				   fts_event_handler,
+				   info->board->irq_flags | IRQF_ONESHOT,
+				   FTS_TS_DRV_NAME, info);
+	if (!ret)
+		xiaomi_touch_irq_setup(info->client->irq);
+#else
 	ret = request_threaded_irq(info->client->irq, NULL, fts_event_handler, info->board->irq_flags,
 				   FTS_TS_DRV_NAME, info);
+#endif
 	if (ret) {
 		logError(1, "%s Request irq failed %d\n", tag, ret);
 		kfree(info->event_dispatch_table);
@@ -5378,6 +5409,7 @@ static void fts_interrupt_uninstall(struct fts_ts_info *info)
 {
 	fts_disableInterrupt();
 	kfree(info->event_dispatch_table);
+	irq_set_affinity_hint(info->client->irq, NULL);
 	free_irq(info->client->irq, info);
 }
 
@@ -1468,6 +1468,9 @@ static irqreturn_t nvt_ts_work_func(int irq, void *data)
 		NVT_ERR("CTP_SPI_READ failed.(%d)\n", ret);
 		goto XFER_ERROR;
 	}
+#if IS_ENABLED(CONFIG_TOUCHSCREEN_XIAOMI_TOUCHFEATURE)
+	xiaomi_touch_latency_mark(TOUCH_STAGE_READ);
+#endif
 	/*
 	//--- dump SPI buf ---
 	for (i = 0; i < 10; i++) {
@@ -1619,6 +1622,9 @@ static irqreturn_t nvt_ts_work_func(int irq, void *data)
 #endif /* MT_PROTOCOL_B */
 
 	input_sync(ts->input_dev);
+#if IS_ENABLED(CONFIG_TOUCHSCREEN_XIAOMI_TOUCHFEATURE)
+	xiaomi_touch_latency_mark(TOUCH_STAGE_REPORT);
+#endif
 
 XFER_ERROR:
 	mutex_unlock(&ts->lock);
@@ -2569,8 +2575,16 @@ static int32_t nvt_ts_probe(struct spi_device *client)
 	if (ts->client->irq) {
 		NVT_LOG("int_trigger_type=%d\n", ts->int_trigger_type);
 		ts->irq_enabled = true;
+#if IS_ENABLED(CONFIG_TOUCHSCREEN_XIAOMI_TOUCHFEATURE)
+		ret = request_threaded_irq(ts->client->irq, xiaomi_touch_irq_timestamp,
+				nvt_ts_work_func, ts->int_trigger_type | IRQF_ONESHOT,
+				NVT_SPI_NAME, ts);
+		if (ret == 0)
+			xiaomi_touch_irq_setup(ts->client->irq);
+#else
 		ret = request_threaded_irq(ts->client->irq, NULL, nvt_ts_work_func,
 				ts->int_trigger_type | IRQF_ONESHOT, NVT_SPI_NAME, ts);
+#endif
 		if (ret != 0) {
 			NVT_ERR("request irq failed. ret=%d\n", ret);
 			goto err_int_request_failed;
@@ -2801,6 +2815,7 @@ sysfs_remove_group(&client->dev.kobj,ts->attrs);
 #if WAKEUP_GESTURE
 	device_init_wakeup(&ts->input_dev->dev, 0);
 #endif
+	irq_set_affinity_hint(ts->client->irq, NULL);
 	free_irq(ts->client->irq, ts);
 err_int_request_failed:
 	input_unregister_device(ts->input_dev);
@@ -2888,6 +2903,7 @@ sysfs_remove_group(&client->dev.kobj,ts->attrs);
 #endif
 
 	nvt_irq_enable(false);
+	irq_set_affinity_hint(ts->client->irq, NULL);
 	free_irq(ts->client->irq, ts);
 
 	mutex_destroy(&ts->xbuf_lock);
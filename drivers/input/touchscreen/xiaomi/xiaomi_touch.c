@@ -1256,6 +1256,84 @@ void last_touch_events_collect(int slot, int state)
 }
 EXPORT_SYMBOL_GPL(last_touch_events_collect);
 
+/*
+ * Primary handler for touch irqs: stamp the report before the irq
+ * thread is woken, so latency covers the thread wakeup as well.
+ */
+irqreturn_t xiaomi_touch_irq_timestamp(int irq, void *dev_id)
+{
+	if (touch_pdata)
+		touch_pdata->latency.irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+EXPORT_SYMBOL_GPL(xiaomi_touch_irq_timestamp);
+
+void xiaomi_touch_latency_mark(int stage)
+{
+	struct touch_latency *lat;
+	u64 delta;
+
+	if (!touch_pdata || stage >= TOUCH_STAGE_NUM)
+		return;
+
+	lat = &touch_pdata->latency;
+	if (!lat->irq_time)
+		return;
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), lat->irq_time));
+	lat->sum_ns[stage] += delta;
+	if (delta > lat->max_ns[stage])
+		lat->max_ns[stage] = delta;
+
+	if (stage == TOUCH_STAGE_REPORT) {
+		lat->count++;
+		lat->irq_time = 0;
+	}
+}
+EXPORT_SYMBOL_GPL(xiaomi_touch_latency_mark);
+
+/*
+ * Keep the touch irq, and with it the irq thread that reads and
+ * reports the frame, on the cpu given by "touch,irq-cpu".
+ */
+int xiaomi_touch_irq_setup(int irq)
+{
+	int cpu;
+
+	if (!touch_pdata || touch_pdata->irq_cpu < 0)
+		return 0;
+
+	cpu = touch_pdata->irq_cpu;
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	pr_info("%s irq:%d cpu:%d\n", __func__, irq, cpu);
+
+	return irq_set_affinity_hint(irq, cpumask_of(cpu));
+}
+EXPORT_SYMBOL_GPL(xiaomi_touch_irq_setup);
+
+static int touch_latency_show(struct seq_file *m, void *v)
+{
+	struct touch_latency *lat;
+	u64 count;
+
+	if (!touch_pdata)
+		return 0;
+
+	lat = &touch_pdata->latency;
+	count = lat->count ? lat->count : 1;
+	seq_printf(m, "reports: %llu\n", lat->count);
+	seq_printf(m, "irq->read   avg %llu us max %llu us\n",
+		   div64_u64(lat->sum_ns[TOUCH_STAGE_READ], count) / NSEC_PER_USEC,
+		   lat->max_ns[TOUCH_STAGE_READ] / NSEC_PER_USEC);
+	seq_printf(m, "irq->report avg %llu us max %llu us\n",
+		   div64_u64(lat->sum_ns[TOUCH_STAGE_REPORT], count) / NSEC_PER_USEC,
+		   lat->max_ns[TOUCH_STAGE_REPORT] / NSEC_PER_USEC);
+	return 0;
+}
+
 static const struct of_device_id xiaomi_touch_of_match[] = {
 	{ .compatible = "xiaomi-touch", },
 	{ },
@@ -1264,6 +1342,7 @@ static const struct of_device_id xiaomi_touch_of_match[] = {
 static int xiaomi_touch_parse_dt(struct device *dev, struct xiaomi_touch_pdata *data)
 {
 	int ret;
+	u32 irq_cpu;
 	struct device_node *np;
 
 	np = dev->of_node;
@@ -1276,6 +1355,11 @@ static int xiaomi_touch_parse_dt(struct device *dev, struct xiaomi_touch_pdata *
 
 	pr_info("%s touch,name:%s\n", __func__, data->name);
 
+	if (of_property_read_u32(np, "touch,irq-cpu", &irq_cpu))
+		data->irq_cpu = -1;
+	else
+		data->irq_cpu = irq_cpu;
+
 	return 0;
 }
 
@@ -1369,6 +1453,7 @@ static int xiaomi_touch_probe(struct platform_device *pdev)
 		goto sys_group_err;
 	}
 	pdata->last_touch_events_proc = proc_create_seq("last_touch_events", 0644, NULL, &last_touch_events_seq_ops);
+	pdata->touch_latency_proc = proc_create_single("touch_latency", 0444, NULL, touch_latency_show);
 
 	pr_info("%s over\n", __func__);
 
@@ -1438,6 +1523,10 @@ static int xiaomi_touch_remove(struct platform_device *pdev)
 		remove_proc_entry("last_touch_events", NULL);
 		touch_pdata->last_touch_events_proc = NULL;
 	}
+	if (touch_pdata->touch_latency_proc != NULL) {
+		remove_proc_entry("touch_latency", NULL);
+		touch_pdata->touch_latency_proc = NULL;
+	}
 
 	if (touch_pdata->touch_data[0]) {
 		kfree(touch_pdata->touch_data[0]);
@@ -27,6 +27,8 @@
 #include <linux/seq_file.h>
 #include <linux/time.h>
 #include <linux/time64.h>
+#include <linux/interrupt.h>
+#include <linux/ktime.h>
 
 /*CUR,DEFAULT,MIN,MAX*/
 #define VALUE_TYPE_SIZE			6
@@ -157,6 +159,20 @@ struct last_touch_event {
 	struct touch_event touch_event_buf[LAST_TOUCH_EVENTS_MAX];
 };
 
+/* report latency, measured from the hard irq of each report */
+enum touch_latency_stage {
+	TOUCH_STAGE_READ,	/* bus read of the report done */
+	TOUCH_STAGE_REPORT,	/* input_sync() done */
+	TOUCH_STAGE_NUM,
+};
+
+struct touch_latency {
+	ktime_t irq_time;
+	u64 count;
+	u64 sum_ns[TOUCH_STAGE_NUM];
+	u64 max_ns[TOUCH_STAGE_NUM];
+};
+
 struct xiaomi_touch_pdata {
 	struct xiaomi_touch *device;
 	struct xiaomi_touch_interface *touch_data[2];
@@ -176,6 +192,9 @@ struct xiaomi_touch_pdata {
 	int fod_press_status_value;
 	struct proc_dir_entry *last_touch_events_proc;
 	struct last_touch_event *last_touch_events;
+	int irq_cpu;
+	struct touch_latency latency;
+	struct proc_dir_entry *touch_latency_proc;
 };
 
 struct xiaomi_touch *xiaomi_touch_dev_get(int minor);
@@ -205,4 +224,10 @@ extern int notify_gesture_single_tap(void);
 extern int update_fod_press_status(int value);
 
 extern void thp_send_cmd_to_hal(int cmd, int value);
+
+extern irqreturn_t xiaomi_touch_irq_timestamp(int irq, void *dev_id);
+
+extern void xiaomi_touch_latency_mark(int stage);
+
+extern int xiaomi_touch_irq_setup(int irq);
 #endif
@@ -295,6 +295,16 @@ enum stop_on_failure {
 	BCH_CACHED_DEV_STOP_MODE_MAX,
 };
 
+#ifdef CONFIG_BCACHE_MOBILE
+#define BCH_SEQUENTIAL_CUTOFF		(1 << 20)
+#define BCH_SEQUENTIAL_WINDOW_MS	1000
+#define BCH_BTREE_CACHE_MAX_MB		16
+#else
+#define BCH_SEQUENTIAL_CUTOFF		(4 << 20)
+#define BCH_SEQUENTIAL_WINDOW_MS	5000
+#define BCH_BTREE_CACHE_MAX_MB		0
+#endif
+
 struct cached_dev {
 	struct list_head	list;
 	struct bcache_device	disk;
@@ -574,6 +584,8 @@ struct cache_set {
 
 	/* Number of elements in btree_cache + btree_cache_freeable lists */
 	unsigned int		btree_cache_used;
+	/* Past this, reuse clean cached nodes before allocating; 0 = off */
+	unsigned int		btree_cache_max_mb;
 
 	/*
 	 * If we need to allocate memory for a new btree node and that
@@ -914,6 +914,14 @@ static struct btree *mca_alloc(struct cache_set *c, struct btree_op *op,
 		if (!mca_reap(b, btree_order(k), false))
 			goto out;
 
+	/* Over budget: recycle the least recently used clean node */
+	if (c->btree_cache_max_mb &&
+	    c->btree_cache_used * c->btree_pages >=
+	    c->btree_cache_max_mb << (20 - PAGE_SHIFT))
+		list_for_each_entry_reverse(b, &c->btree_cache, list)
+			if (!mca_reap(b, btree_order(k), false))
+				goto out;
+
 	/* We never free struct btree itself, just the memory that holds the on
 	 * disk node. Check the freed list before allocating a new one:
 	 */
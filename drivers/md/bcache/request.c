@@ -427,7 +427,8 @@ static bool check_should_bypass(struct cached_dev *dc, struct bio *bio)
 		i->sequential	+= bio->bi_iter.bi_size;
 
 	i->last			 = bio_end_sector(bio);
-	i->jiffies		 = jiffies + msecs_to_jiffies(5000);
+	i->jiffies		 = jiffies +
+				   msecs_to_jiffies(BCH_SEQUENTIAL_WINDOW_MS);
 	task->sequential_io	 = i->sequential;
 
 	hlist_del(&i->hash);
@@ -477,6 +478,7 @@ struct search {
 
 	struct hd_struct	*part;
 	unsigned long		start_time;
+	u64			start_ns;
 
 	struct btree_op		op;
 	struct data_insert_op	iop;
@@ -733,6 +735,7 @@ static inline struct search *search_alloc(struct bio *bio,
 	s->read_dirty_data	= 0;
 	/* Count on the bcache device */
 	s->start_time		= part_start_io_acct(d->disk, &s->part, bio);
+	s->start_ns		= local_clock();
 	s->iop.c		= d->c;
 	s->iop.bio		= NULL;
 	s->iop.inode		= d->id;
@@ -864,6 +867,9 @@ static void cached_dev_read_done_bh(struct closure *cl)
 
 	bch_mark_cache_accounting(s->iop.c, s->d,
 				  !s->cache_missed, s->iop.bypass);
+	bch_mark_cache_read_latency(s->iop.c, s->d, !s->cache_missed,
+				    div_u64(local_clock() - s->start_ns,
+					    NSEC_PER_USEC));
 	trace_bcache_read(s->orig_bio, !s->cache_missed, s->iop.bypass);
 
 	if (s->iop.status)
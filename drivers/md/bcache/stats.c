@@ -49,6 +49,8 @@ read_attribute(cache_hit_ratio);
 read_attribute(cache_readaheads);
 read_attribute(cache_miss_collisions);
 read_attribute(bypassed);
+read_attribute(cache_hit_latency_us);
+read_attribute(cache_miss_latency_us);
 
 SHOW(bch_stats)
 {
@@ -67,6 +69,14 @@ SHOW(bch_stats)
 	var_print(cache_readaheads);
 	var_print(cache_miss_collisions);
 	sysfs_hprint(bypassed,	var(sectors_bypassed) << 9);
+
+	/* average read latency, as seen by the bcache device */
+	sysfs_print(cache_hit_latency_us,
+		    DIV_SAFE(var(cache_hit_latency_us),
+			     var(cache_hits) + var(cache_bypass_hits)));
+	sysfs_print(cache_miss_latency_us,
+		    DIV_SAFE(var(cache_miss_latency_us),
+			     var(cache_misses) + var(cache_bypass_misses)));
 #undef var
 	return 0;
 }
@@ -89,6 +99,8 @@ static struct attribute *bch_stats_files[] = {
 	&sysfs_cache_readaheads,
 	&sysfs_cache_miss_collisions,
 	&sysfs_bypassed,
+	&sysfs_cache_hit_latency_us,
+	&sysfs_cache_miss_latency_us,
 	NULL
 };
 static KTYPE(bch_stats);
@@ -116,6 +128,8 @@ void bch_cache_accounting_clear(struct cache_accounting *acc)
 	acc->total.cache_readaheads = 0;
 	acc->total.cache_miss_collisions = 0;
 	acc->total.sectors_bypassed = 0;
+	acc->total.cache_hit_latency_us = 0;
+	acc->total.cache_miss_latency_us = 0;
 }
 
 void bch_cache_accounting_destroy(struct cache_accounting *acc)
@@ -148,6 +162,8 @@ static void scale_stats(struct cache_stats *stats, unsigned long rescale_at)
 		scale_stat(&stats->cache_readaheads);
 		scale_stat(&stats->cache_miss_collisions);
 		scale_stat(&stats->sectors_bypassed);
+		scale_stat(&stats->cache_hit_latency_us);
+		scale_stat(&stats->cache_miss_latency_us);
 	}
 }
 
@@ -172,6 +188,19 @@ static void scale_accounting(struct timer_list *t)
 	move_stat(cache_miss_collisions);
 	move_stat(sectors_bypassed);
 
+	/* latency sums easily exceed 2^16 per interval, so no atomic_t here */
+#define move_stat_long(name) do {					\
+	unsigned long t = atomic_long_xchg(&acc->collector.name, 0);	\
+	t <<= 16;							\
+	acc->five_minute.name += t;					\
+	acc->hour.name += t;						\
+	acc->day.name += t;						\
+	acc->total.name += t;						\
+} while (0)
+
+	move_stat_long(cache_hit_latency_us);
+	move_stat_long(cache_miss_latency_us);
+
 	scale_stats(&acc->total, 0);
 	scale_stats(&acc->day, DAY_RESCALE);
 	scale_stats(&acc->hour, HOUR_RESCALE);
@@ -225,6 +254,20 @@ void bch_mark_cache_miss_collision(struct cache_set *c, struct bcache_device *d)
 	atomic_inc(&c->accounting.collector.cache_miss_collisions);
 }
 
+void bch_mark_cache_read_latency(struct cache_set *c, struct bcache_device *d,
+				 bool hit, unsigned long us)
+{
+	struct cached_dev *dc = container_of(d, struct cached_dev, disk);
+
+	if (hit) {
+		atomic_long_add(us, &dc->accounting.collector.cache_hit_latency_us);
+		atomic_long_add(us, &c->accounting.collector.cache_hit_latency_us);
+	} else {
+		atomic_long_add(us, &dc->accounting.collector.cache_miss_latency_us);
+		atomic_long_add(us, &c->accounting.collector.cache_miss_latency_us);
+	}
+}
+
 void bch_mark_sectors_bypassed(struct cache_set *c, struct cached_dev *dc,
 			       int sectors)
 {
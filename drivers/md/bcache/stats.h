@@ -10,6 +10,8 @@ struct cache_stat_collector {
 	atomic_t cache_readaheads;
 	atomic_t cache_miss_collisions;
 	atomic_t sectors_bypassed;
+	atomic_long_t cache_hit_latency_us;
+	atomic_long_t cache_miss_latency_us;
 };
 
 struct cache_stats {
@@ -22,6 +24,8 @@ struct cache_stats {
 	unsigned long cache_readaheads;
 	unsigned long cache_miss_collisions;
 	unsigned long sectors_bypassed;
+	unsigned long cache_hit_latency_us;
+	unsigned long cache_miss_latency_us;
 
 	unsigned int		rescale;
 };
@@ -58,6 +62,8 @@ void bch_mark_cache_accounting(struct cache_set *c, struct bcache_device *d,
 void bch_mark_cache_readahead(struct cache_set *c, struct bcache_device *d);
 void bch_mark_cache_miss_collision(struct cache_set *c,
 				   struct bcache_device *d);
+void bch_mark_cache_read_latency(struct cache_set *c, struct bcache_device *d,
+				 bool hit, unsigned long us);
 void bch_mark_sectors_bypassed(struct cache_set *c,
 			       struct cached_dev *dc,
 			       int sectors);
@@ -1437,7 +1437,7 @@ static int cached_dev_init(struct cached_dev *dc, unsigned int block_size)
 	spin_lock_init(&dc->io_lock);
 	bch_cache_accounting_init(&dc->accounting, &dc->disk.cl);
 
-	dc->sequential_cutoff		= 4 << 20;
+	dc->sequential_cutoff		= BCH_SEQUENTIAL_CUTOFF;
 
 	for (io = dc->io; io < dc->io + RECENT_IO; io++) {
 		list_add(&io->lru, &dc->io_lru);
@@ -1981,6 +1981,7 @@ struct cache_set *bch_cache_set_alloc(struct cache_sb *sb)
 
 	c->congested_read_threshold_us	= 2000;
 	c->congested_write_threshold_us	= 20000;
+	c->btree_cache_max_mb		= BCH_BTREE_CACHE_MAX_MB;
 	c->error_limit	= DEFAULT_IO_ERROR_LIMIT;
 	c->idle_max_writeback_rate_enabled = 1;
 	WARN_ON(test_and_clear_bit(CACHE_SET_IO_DISABLE, &c->flags));
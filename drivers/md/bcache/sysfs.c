@@ -70,6 +70,7 @@ read_attribute(tree_depth);
 read_attribute(root_usage_percent);
 read_attribute(priority_stats);
 read_attribute(btree_cache_size);
+rw_attribute(btree_cache_max_mb);
 read_attribute(btree_cache_max_chain);
 read_attribute(cache_available_percent);
 read_attribute(written);
@@ -719,6 +720,7 @@ SHOW(__bch_cache_set)
 	sysfs_print(root_usage_percent,		bch_root_usage(c));
 
 	sysfs_hprint(btree_cache_size,		bch_cache_size(c));
+	sysfs_print(btree_cache_max_mb,		c->btree_cache_max_mb);
 	sysfs_print(btree_cache_max_chain,	bch_cache_max_chain(c));
 	sysfs_print(cache_available_percent,	100 - c->gc_stats.in_use);
 
@@ -848,6 +850,9 @@ STORE(__bch_cache_set)
 		c->shrink.scan_objects(&c->shrink, &sc);
 	}
 
+	sysfs_strtoul_clamp(btree_cache_max_mb,
+			    c->btree_cache_max_mb,
+			    0, UINT_MAX >> (20 - PAGE_SHIFT));
 	sysfs_strtoul_clamp(congested_read_threshold_us,
 			    c->congested_read_threshold_us,
 			    0, UINT_MAX);
@@ -948,6 +953,7 @@ static struct attribute *bch_cache_set_files[] = {
 	&sysfs_tree_depth,
 	&sysfs_root_usage_percent,
 	&sysfs_btree_cache_size,
+	&sysfs_btree_cache_max_mb,
 	&sysfs_cache_available_percent,
 
 	&sysfs_average_key_size,
@@ -15,6 +15,7 @@
 #include "adsp_logger.h"
 #include "adsp_excep.h"
 #include "adsp_core.h"
+#include "adsp_timesync.h"
 
 /* ----------------------------- sys fs ------------------------------------ */
 static inline ssize_t dev_dump_show(struct device *dev,
@@ -400,6 +401,7 @@ const struct file_operations adspsys_file_ops = {
 	.owner = THIS_MODULE,
 	.open = adsp_driver_open,
 	.unlocked_ioctl = adsp_driver_ioctl,
+	.mmap = adsp_timesync_mmap,
 #if IS_ENABLED(CONFIG_COMPAT)
 	.compat_ioctl   = adsp_driver_compat_ioctl,
 #endif
@@ -6,6 +6,8 @@
 // Author: Celine Liu <Celine.liu@mediatek.com>
 
 #include <linux/clocksource.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
 #include <linux/sched/clock.h>
 #include <linux/suspend.h>
 #include <linux/timex.h>
@@ -23,7 +25,10 @@ struct timesync_info_s {
 	u32 ts_h;
 	u32 ts_l;
 	u32 freeze;
+	/* odd while the adsp copy is being rewritten */
 	u32 version;
+	u32 mult;
+	u32 shift;
 };
 
 struct timesync_control_s {
@@ -32,6 +37,7 @@ struct timesync_control_s {
 	struct hrtimer timer;
 	u32 period_ms;
 	struct timesync_info_s infos;
+	struct adsp_timesync_page *page;
 };
 
 static struct timesync_control_s timesync_ctrl;
@@ -41,27 +47,116 @@ static u64 adsp_ts_tick_read(const struct cyclecounter *cc)
 	return arch_timer_read_counter();
 }
 
+static void adsp_timesync_copy(struct timesync_info_s *infos)
+{
+	adsp_copy_to_sharedmem(get_adsp_core_by_id(ADSP_A_ID),
+			       ADSP_SHAREDMEM_TIMESYNC,
+			       infos, sizeof(*infos));
+}
+
+/* same protocol for the local page: seq is odd while it is rewritten */
+static void adsp_timesync_publish(u64 tick, u64 ts, u32 fz)
+{
+	struct adsp_timesync_page *page = timesync_ctrl.page;
+
+	if (!page)
+		return;
+
+	WRITE_ONCE(page->seq, page->seq + 1);
+	smp_wmb();
+	page->tick = tick;
+	page->ts = ts;
+	page->mask = timesync_ctrl.cc.mask;
+	page->mult = timesync_ctrl.cc.mult;
+	page->shift = timesync_ctrl.cc.shift;
+	page->freeze = fz;
+	smp_wmb();
+	WRITE_ONCE(page->seq, page->seq + 1);
+}
+
 static void adsp_timesync_update(u32 fz)
 {
 	u64 tick, ts;
 	struct timesync_info_s *infos = &timesync_ctrl.infos;
-	int ret = 0;
 
 	ts =  timecounter_read(&timesync_ctrl.tc);
 	tick = timesync_ctrl.tc.cycle_last;
 
+	adsp_timesync_publish(tick, ts, fz);
+
+	/*
+	 * Mark the adsp copy as being updated before rewriting it, so the
+	 * adsp can convert ticks itself without ever seeing a torn mapping.
+	 */
+	infos->version++;
+	if (is_adsp_system_running()) {
+		adsp_timesync_copy(infos);
+		wmb();
+	}
+
 	infos->tick_h = (tick >> 32) & 0xFFFFFFFF;
 	infos->tick_l = tick & 0xFFFFFFFF;
 	infos->ts_h = (ts >> 32) & 0xFFFFFFFF;
 	infos->ts_l = ts & 0xFFFFFFFF;
 	infos->freeze = fz;
-	infos->version++;
+	infos->mult = timesync_ctrl.cc.mult;
+	infos->shift = timesync_ctrl.cc.shift;
 
 	if (is_adsp_system_running()) {
-		ret = adsp_copy_to_sharedmem(get_adsp_core_by_id(ADSP_A_ID),
-					ADSP_SHAREDMEM_TIMESYNC,
-					infos, sizeof(*infos));
+		adsp_timesync_copy(infos);
+		wmb();
 	}
+	infos->version++;
+	if (is_adsp_system_running())
+		adsp_timesync_copy(infos);
+}
+
+/*
+ * Convert an arch timer tick, from either side, to AP sched_clock time
+ * without asking the adsp driver for anything.
+ */
+u64 adsp_timesync_tick_to_ns(u64 tick)
+{
+	struct adsp_timesync_page *page = timesync_ctrl.page;
+	u64 base, ts, mask, delta;
+	u32 seq, mult, shift;
+
+	if (!page)
+		return 0;
+
+	do {
+		seq = READ_ONCE(page->seq);
+		smp_rmb();
+		base = page->tick;
+		ts = page->ts;
+		mask = page->mask;
+		mult = page->mult;
+		shift = page->shift;
+		smp_rmb();
+	} while ((seq & 1) || seq != READ_ONCE(page->seq));
+
+	/* ticks taken shortly before the last resync, as timecounter does */
+	delta = (tick - base) & mask;
+	if (delta > mask / 2)
+		return ts - ((((base - tick) & mask) * mult) >> shift);
+
+	return ts + ((delta * mult) >> shift);
+}
+EXPORT_SYMBOL(adsp_timesync_tick_to_ns);
+
+int adsp_timesync_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct adsp_timesync_page *page = timesync_ctrl.page;
+
+	if (!page)
+		return -ENODEV;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(page));
 }
 
 static enum hrtimer_restart adsp_timesync_refresh(struct hrtimer *hrt)
@@ -98,6 +193,12 @@ int adsp_timesync_init(void)
 	timesync_ctrl.timer.function = adsp_timesync_refresh;
 	timesync_ctrl.period_ms = TIMESYNC_WRAP_TIME_MS;
 
+	/* clock mapping page for in-kernel and userspace readers */
+	timesync_ctrl.page = (void *)get_zeroed_page(GFP_KERNEL);
+	if (timesync_ctrl.page)
+		adsp_timesync_publish(timesync_ctrl.tc.cycle_last,
+				      timesync_ctrl.tc.nsec, APTIME_UNFREEZE);
+
 	pr_info("%s(), done", __func__);
 
 	return 0;
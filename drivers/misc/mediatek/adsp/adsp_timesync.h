@@ -7,6 +7,8 @@
 #ifndef _ADSP_TIMESYNC_H_
 #define _ADSP_TIMESYNC_H_
 
+#include <linux/types.h>
+
 /* sched_clock wrap time is 4398 seconds for arm arch timer
  * applying a period less than it for tinysys timesync
  */
@@ -17,9 +19,31 @@ enum {
 	APTIME_FREEZE    = 1,
 };
 
+/*
+ * Clock mapping page, mmap()ed read only from /dev/adsp at offset 0.
+ * An arch timer tick converts to AP sched_clock ns as
+ *   ts + ((((tick - tick_at_ts) & mask) * mult) >> shift)
+ * Readers retry while seq is odd or changed under them. The mapping is
+ * only rewritten on the resync timer and across suspend.
+ */
+struct adsp_timesync_page {
+	__u32 seq;
+	__u32 mult;
+	__u32 shift;
+	__u32 freeze;
+	__u64 tick;
+	__u64 ts;
+	__u64 mask;
+};
+
+struct file;
+struct vm_area_struct;
+
 void adsp_timesync_suspend(u32 fz);
 void adsp_timesync_resume(void);
 int adsp_timesync_init(void);
+u64 adsp_timesync_tick_to_ns(u64 tick);
+int adsp_timesync_mmap(struct file *filp, struct vm_area_struct *vma);
 
 #endif // _ADSP_TIMESYNC_H_
 
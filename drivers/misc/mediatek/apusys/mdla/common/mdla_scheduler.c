@@ -5,6 +5,8 @@
 #include <common/mdla_device.h>
 #include <common/mdla_scheduler.h>
 
+#include <utilities/mdla_debug.h>
+
 static int dev_handle_capability[MAX_CORE_NUM];
 static int cmd_priority_max;
 
@@ -42,3 +44,22 @@ int mdla_sched_get_cmd_prio_lv(void)
 	return cmd_priority_max;
 }
 
+/*
+ * Batch size of a low priority command, i.e. how many commands may run
+ * before a higher priority one gets the engine. Batches still end on
+ * layer boundaries. The requested size is bounded by the batch_number
+ * debug node, 0 there leaves the request as is.
+ */
+u32 mdla_sched_get_batch_size(u32 req_size)
+{
+	u32 max_size = mdla_dbg_read_u32(FS_BATCH_NUM);
+
+	if (!max_size)
+		return req_size;
+
+	if (!req_size || req_size > max_size)
+		return max_size;
+
+	return req_size;
+}
+
@@ -24,6 +24,7 @@ void mdla_sched_set_dev_handle_cap(u32 core_id, int cmd_num);
 int mdla_sched_get_dev_handle_cap(u32 core_id);
 void mdla_sched_set_cmd_prio_lv(int max_lv);
 int mdla_sched_get_cmd_prio_lv(void);
+u32 mdla_sched_get_batch_size(u32 req_size);
 
 #endif /* __MDLA_SCHEDULER_H__ */
 
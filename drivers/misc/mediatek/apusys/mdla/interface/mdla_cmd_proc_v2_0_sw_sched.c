@@ -70,7 +70,8 @@ static void mdla_cmd_prepare_v2_0_sw_sched(struct mdla_run_cmd *cd,
 		ce->multicore_total = apusys_hd->multicore_total;
 		ce->cmd_batch_size = cd->count + 1;
 	} else {
-		ce->cmd_batch_size = apusys_hd->cluster_size;
+		ce->cmd_batch_size =
+			mdla_sched_get_batch_size(apusys_hd->cluster_size);
 	}
 
 	init_completion(&ce->swcmd_done_wait);
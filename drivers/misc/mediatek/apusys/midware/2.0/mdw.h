@@ -30,6 +30,7 @@
 #define MDW_DEV_TAB_DEV_MAX (16)
 #define MDW_CMD_MAX (32)
 #define MDW_SUBCMD_MAX (64)
+#define MDW_CMD_BATCH_MAX (16)
 #define MDW_PRIORITY_MAX (32)
 #define MDW_DEFAULT_TIMEOUT_MS (30*1000)
 #define MDW_BOOST_MAX (100)
@@ -104,6 +105,7 @@ struct mdw_mem {
 	struct list_head u_item; //to mpriv
 	struct list_head d_node; //to mdev
 	struct list_head p_chunk; //to mem pool
+	struct mdw_mem_pool_slab *slab; //to mem pool size class
 	struct mutex mtx;
 	void (*release)(struct mdw_mem *m);
 };
@@ -111,6 +113,21 @@ struct mdw_mem {
 /* default chunk size of memory pool */
 #define MDW_MEM_POOL_CHUNK_SIZE (4*1024*1024)
 
+/* small allocations are carved out of pages in power of two size classes */
+#define MDW_MEM_POOL_CLASS_SHIFT (8)
+#define MDW_MEM_POOL_NR_CLASS (PAGE_SHIFT - MDW_MEM_POOL_CLASS_SHIFT)
+#define MDW_MEM_POOL_MAG_SIZE (16)
+
+struct mdw_mem_pool_slab;
+
+struct mdw_mem_pool_class {
+	/* slabs of this class, the ones with free slots first */
+	struct list_head slabs;
+	/* freed mems kept with their slot for the next alloc of the class */
+	struct mdw_mem *mag[MDW_MEM_POOL_MAG_SIZE];
+	uint32_t mag_cnt;
+};
+
 struct mdw_mem_pool {
 	struct mdw_fpriv *mpriv;
 	/* pool attribute */
@@ -125,6 +142,8 @@ struct mdw_mem_pool {
 	struct list_head m_chunks;
 	/* list of allocated memories from gp */
 	struct list_head m_list;
+	/* size class sub-allocators */
+	struct mdw_mem_pool_class classes[MDW_MEM_POOL_NR_CLASS];
 	/* ref count for cmd/mem */
 	struct kref m_ref;
 	void (*get)(struct mdw_mem_pool *pool);
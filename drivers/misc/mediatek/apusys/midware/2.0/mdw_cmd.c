@@ -591,17 +591,16 @@ static void mdw_cmd_trigger_func(struct work_struct *wk)
 }
 
 static struct mdw_cmd *mdw_cmd_create(struct mdw_fpriv *mpriv,
-	union mdw_cmd_args *args)
+	struct mdw_cmd_exec *exec)
 {
-	struct mdw_cmd_in *in = (struct mdw_cmd_in *)args;
 	struct mdw_cmd *c = NULL;
 
 	mdw_trace_begin("%s", __func__);
 
 	mutex_lock(&mpriv->mtx);
 	/* check num subcmds maximum */
-	if (in->exec.num_subcmds > MDW_SUBCMD_MAX) {
-		mdw_drv_err("too much subcmds(%u)\n", in->exec.num_subcmds);
+	if (exec->num_subcmds > MDW_SUBCMD_MAX) {
+		mdw_drv_err("too much subcmds(%u)\n", exec->num_subcmds);
 		goto out;
 	}
 
@@ -616,17 +615,17 @@ static struct mdw_cmd *mdw_cmd_create(struct mdw_fpriv *mpriv,
 	c->pid = current->pid;
 	c->tgid = current->tgid;
 	c->kid = (uint64_t)c;
-	c->uid = in->exec.uid;
-	c->usr_id = in->exec.usr_id;
-	c->priority = in->exec.priority;
-	c->hardlimit = in->exec.hardlimit;
-	c->softlimit = in->exec.softlimit;
-	c->power_save = in->exec.power_save;
-	c->power_plcy = in->exec.power_plcy;
-	c->power_dtime = in->exec.power_dtime;
-	c->app_type = in->exec.app_type;
-	c->num_subcmds = in->exec.num_subcmds;
-	c->exec_infos = mdw_mem_get(mpriv, in->exec.exec_infos);
+	c->uid = exec->uid;
+	c->usr_id = exec->usr_id;
+	c->priority = exec->priority;
+	c->hardlimit = exec->hardlimit;
+	c->softlimit = exec->softlimit;
+	c->power_save = exec->power_save;
+	c->power_plcy = exec->power_plcy;
+	c->power_dtime = exec->power_dtime;
+	c->app_type = exec->app_type;
+	c->num_subcmds = exec->num_subcmds;
+	c->exec_infos = mdw_mem_get(mpriv, exec->exec_infos);
 	if (!c->exec_infos) {
 		mdw_drv_err("get exec info fail\n");
 		goto free_cmd;
@@ -642,7 +641,7 @@ static struct mdw_cmd *mdw_cmd_create(struct mdw_fpriv *mpriv,
 	c->subcmds = kzalloc(c->num_subcmds * sizeof(*c->subcmds), GFP_KERNEL);
 	if (!c->subcmds)
 		goto put_execinfos;
-	if (copy_from_user(c->subcmds, (void __user *)in->exec.subcmd_infos,
+	if (copy_from_user(c->subcmds, (void __user *)exec->subcmd_infos,
 		c->num_subcmds * sizeof(*c->subcmds))) {
 		mdw_drv_err("copy subcmds fail\n");
 		goto free_subcmds;
@@ -662,7 +661,7 @@ static struct mdw_cmd *mdw_cmd_create(struct mdw_fpriv *mpriv,
 		c->num_subcmds * sizeof(uint8_t), GFP_KERNEL);
 	if (!c->adj_matrix)
 		goto free_ksubcmds;
-	if (copy_from_user(c->adj_matrix, (void __user *)in->exec.adj_matrix,
+	if (copy_from_user(c->adj_matrix, (void __user *)exec->adj_matrix,
 		(c->num_subcmds * c->num_subcmds * sizeof(uint8_t)))) {
 		mdw_drv_err("copy adj matrix fail\n");
 		goto free_adj;
@@ -724,7 +723,7 @@ static int mdw_cmd_ioctl_run(struct mdw_fpriv *mpriv, union mdw_cmd_args *args)
 	/* get wait fd */
 	wait_fd = in->exec.fence;
 
-	c = mdw_cmd_create(mpriv, args);
+	c = mdw_cmd_create(mpriv, &in->exec);
 	if (!c) {
 		mdw_drv_err("create cmd fail\n");
 		ret = -EINVAL;
@@ -776,6 +775,111 @@ static int mdw_cmd_ioctl_run(struct mdw_fpriv *mpriv, union mdw_cmd_args *args)
 	return ret;
 }
 
+static int mdw_cmd_ioctl_run_batch(struct mdw_fpriv *mpriv,
+	union mdw_cmd_args *args)
+{
+	struct mdw_cmd_in *in = (struct mdw_cmd_in *)args;
+	struct mdw_cmd_exec *execs = NULL;
+	struct mdw_cmd **cmds = NULL;
+	struct sync_file **sync_files = NULL;
+	struct dma_fence *wait_fence = NULL;
+	int32_t *fds = NULL;
+	uint32_t num = in->batch.num_cmds, i = 0, n = 0;
+	int ret = 0;
+
+	if (!num || num > MDW_CMD_BATCH_MAX) {
+		mdw_drv_err("batch cmds(%u) invalid\n", num);
+		return -EINVAL;
+	}
+
+	execs = kcalloc(num, sizeof(*execs), GFP_KERNEL);
+	cmds = kcalloc(num, sizeof(*cmds), GFP_KERNEL);
+	sync_files = kcalloc(num, sizeof(*sync_files), GFP_KERNEL);
+	fds = kcalloc(num, sizeof(*fds), GFP_KERNEL);
+	if (!execs || !cmds || !sync_files || !fds) {
+		ret = -ENOMEM;
+		goto free_arrays;
+	}
+
+	if (copy_from_user(execs, (void __user *)in->batch.cmds,
+		num * sizeof(*execs))) {
+		mdw_drv_err("copy batch cmds fail\n");
+		ret = -EFAULT;
+		goto free_arrays;
+	}
+
+	/* create every cmd first, nothing runs unless the whole batch is valid */
+	for (n = 0; n < num; n++) {
+		cmds[n] = mdw_cmd_create(mpriv, &execs[n]);
+		if (!cmds[n]) {
+			mdw_drv_err("create batch cmd(%u) fail\n", n);
+			ret = -EINVAL;
+			goto delete_cmds;
+		}
+
+		fds[n] = get_unused_fd_flags(O_CLOEXEC);
+		if (fds[n] < 0) {
+			mdw_drv_err("get unused fd fail\n");
+			mdw_cmd_delete(cmds[n]);
+			ret = -EINVAL;
+			goto delete_cmds;
+		}
+
+		sync_files[n] = sync_file_create(&cmds[n]->fence->base_fence);
+		if (!sync_files[n]) {
+			mdw_drv_err("create sync file fail\n");
+			put_unused_fd(fds[n]);
+			mdw_cmd_delete(cmds[n]);
+			ret = -ENOMEM;
+			goto delete_cmds;
+		}
+	}
+
+	if (copy_to_user((void __user *)in->batch.fences, fds,
+		num * sizeof(*fds))) {
+		mdw_drv_err("copy batch fences fail\n");
+		ret = -EFAULT;
+		goto delete_cmds;
+	}
+
+	wait_fence = sync_file_get_fence(in->batch.fence);
+	memset(args, 0, sizeof(*args));
+
+	/*
+	 * The cmds are independent of each other, so the device schedulers
+	 * are free to overlap the subcmds of cmd n+1 with those of cmd n.
+	 */
+	for (i = 0; i < num; i++) {
+		fd_install(fds[i], sync_files[i]->file);
+
+		if (wait_fence) {
+			cmds[i]->wait_fence = dma_fence_get(wait_fence);
+			schedule_work(&cmds[i]->t_wk);
+		} else if (mdw_cmd_run(mpriv, cmds[i])) {
+			/* fence already carries the error */
+			mdw_cmd_delete(cmds[i]);
+		}
+	}
+	mdw_flw_debug("s(0x%llx) batch(%u) triggered\n", (uint64_t)mpriv, num);
+
+	if (wait_fence)
+		dma_fence_put(wait_fence);
+	goto free_arrays;
+
+delete_cmds:
+	for (i = 0; i < n; i++) {
+		fput(sync_files[i]->file);
+		put_unused_fd(fds[i]);
+		mdw_cmd_delete(cmds[i]);
+	}
+free_arrays:
+	kfree(fds);
+	kfree(sync_files);
+	kfree(cmds);
+	kfree(execs);
+	return ret;
+}
+
 int mdw_cmd_ioctl(struct mdw_fpriv *mpriv, void *data)
 {
 	union mdw_cmd_args *args = (union mdw_cmd_args *)data;
@@ -788,6 +892,10 @@ int mdw_cmd_ioctl(struct mdw_fpriv *mpriv, void *data)
 		ret = mdw_cmd_ioctl_run(mpriv, args);
 		break;
 
+	case MDW_CMD_IOCTL_RUN_BATCH:
+		ret = mdw_cmd_ioctl_run_batch(mpriv, args);
+		break;
+
 	default:
 		ret = -EINVAL;
 		break;
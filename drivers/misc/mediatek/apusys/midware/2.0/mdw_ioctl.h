@@ -158,6 +158,7 @@ union mdw_mem_args {
 
 enum mdw_cmd_ioctl_op {
 	MDW_CMD_IOCTL_RUN,
+	MDW_CMD_IOCTL_RUN_BATCH,
 };
 
 enum {
@@ -215,26 +216,35 @@ struct mdw_subcmd_info {
 	uint64_t cmdbufs;
 };
 
+struct mdw_cmd_exec {
+	uint64_t usr_id;
+	uint64_t uid;
+	uint32_t priority;
+	uint32_t hardlimit;
+	uint32_t softlimit;
+	uint32_t power_save;
+	uint32_t power_plcy;
+	uint32_t power_dtime;
+	uint32_t app_type;
+	uint32_t flags;
+	uint32_t num_subcmds;
+	uint64_t subcmd_infos;
+	uint64_t adj_matrix;
+	uint64_t fence;
+	uint64_t exec_infos;
+};
+
 struct mdw_cmd_in {
 	uint32_t op; //enum mdw_cmd_ioctl_op
 	union {
+		struct mdw_cmd_exec exec;
+		/* cmds: struct mdw_cmd_exec[], fences: int32_t[] filled on return */
 		struct {
-			uint64_t usr_id;
-			uint64_t uid;
-			uint32_t priority;
-			uint32_t hardlimit;
-			uint32_t softlimit;
-			uint32_t power_save;
-			uint32_t power_plcy;
-			uint32_t power_dtime;
-			uint32_t app_type;
-			uint32_t flags;
-			uint32_t num_subcmds;
-			uint64_t subcmd_infos;
-			uint64_t adj_matrix;
+			uint64_t cmds;
+			uint64_t fences;
 			uint64_t fence;
-			uint64_t exec_infos;
-		} exec;
+			uint32_t num_cmds;
+		} batch;
 	};
 };
 
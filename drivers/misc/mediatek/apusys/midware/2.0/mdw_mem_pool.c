@@ -3,6 +3,7 @@
  * Copyright (c) 2021 MediaTek Inc.
  */
 
+#include <linux/bitmap.h>
 #include <linux/genalloc.h>
 #include <linux/log2.h>
 #include <linux/kernel.h>
@@ -22,6 +23,19 @@
 	m->device_va, m->dva_size, m->align, m->flags, m->need_handle, \
 	m->priv, current->pid)
 
+/* one page of a size class, split into equally sized slots */
+struct mdw_mem_pool_slab {
+	struct list_head node;
+	void *vaddr;
+	dma_addr_t dma;
+	uint32_t cls;
+	uint32_t nr_free;
+	DECLARE_BITMAP(used, PAGE_SIZE >> MDW_MEM_POOL_CLASS_SHIFT);
+};
+
+#define mdw_mem_pool_cls_size(cls) (1U << ((cls) + MDW_MEM_POOL_CLASS_SHIFT))
+#define mdw_mem_pool_cls_slots(cls) (PAGE_SIZE / mdw_mem_pool_cls_size(cls))
+
 /* allocate a memory chunk, and add it to pool */
 static int mdw_mem_pool_chunk_add(struct mdw_mem_pool *pool, uint32_t size)
 {
@@ -105,7 +119,7 @@ static void mdw_mem_pool_chunk_del(struct mdw_mem *m)
 int mdw_mem_pool_create(struct mdw_fpriv *mpriv, struct mdw_mem_pool *pool,
 	enum mdw_mem_type type, uint32_t size, uint32_t align, uint64_t flags)
 {
-	int ret = 0;
+	int ret = 0, i = 0;
 
 	if (IS_ERR_OR_NULL(mpriv) || IS_ERR_OR_NULL(pool))
 		return -EINVAL;
@@ -129,6 +143,10 @@ int mdw_mem_pool_create(struct mdw_fpriv *mpriv, struct mdw_mem_pool *pool,
 	kref_init(&pool->m_ref);
 	INIT_LIST_HEAD(&pool->m_chunks);
 	INIT_LIST_HEAD(&pool->m_list);
+	for (i = 0; i < MDW_MEM_POOL_NR_CLASS; i++) {
+		INIT_LIST_HEAD(&pool->classes[i].slabs);
+		pool->classes[i].mag_cnt = 0;
+	}
 	pool->gp = gen_pool_create(PAGE_SHIFT, -1 /* nid */);
 
 	if (IS_ERR(pool->gp)) {
@@ -163,6 +181,9 @@ static void mdw_mem_pool_release(struct kref *ref)
 	struct mdw_mem_pool *pool;
 	struct mdw_fpriv *mpriv;
 	struct mdw_mem *m = NULL, *tmp = NULL;
+	struct mdw_mem_pool_slab *slab = NULL, *stmp = NULL;
+	struct mdw_mem_pool_class *c = NULL;
+	int i = 0;
 
 	pool = container_of(ref, struct mdw_mem_pool, m_ref);
 	if (IS_ERR_OR_NULL(pool->mpriv))
@@ -179,10 +200,24 @@ static void mdw_mem_pool_release(struct kref *ref)
 		list_del(&m->d_node);
 		mdw_mem_debug("free mem: pool: 0x%llx, mem: 0x%llx",
 			(uint64_t)pool, (uint64_t)m);
-		gen_pool_free(pool->gp, (unsigned long)m->vaddr, m->size);
+		if (!m->slab)
+			gen_pool_free(pool->gp, (unsigned long)m->vaddr, m->size);
 		kfree(m);
 	}
 
+	/* release size classes, slabs go back to gen pool as a whole */
+	for (i = 0; i < MDW_MEM_POOL_NR_CLASS; i++) {
+		c = &pool->classes[i];
+		while (c->mag_cnt)
+			kfree(c->mag[--c->mag_cnt]);
+		list_for_each_entry_safe(slab, stmp, &c->slabs, node) {
+			list_del(&slab->node);
+			gen_pool_free(pool->gp, (unsigned long)slab->vaddr,
+				PAGE_SIZE);
+			kfree(slab);
+		}
+	}
+
 	/* destroy gen pool */
 	gen_pool_destroy(pool->gp);
 
@@ -231,15 +266,148 @@ static struct mdw_mem *mdw_mem_pool_ent_create(struct mdw_mem_pool *pool)
 	return m;
 }
 
+/* alloc from gen pool, grow the pool by one chunk if needed, m_mtx held */
+static void *mdw_mem_pool_gp_alloc(struct mdw_mem_pool *pool, uint32_t size,
+	uint32_t align, dma_addr_t *dma)
+{
+	void *vaddr = NULL;
+	unsigned long chunk_size;
+
+	vaddr = gen_pool_dma_alloc_align(pool->gp, size, dma, align);
+	if (vaddr)
+		return vaddr;
+
+	/* try to add a new chunk to pool, and retry again */
+	chunk_size = max(PAGE_SIZE, __roundup_pow_of_two(size));
+	if (mdw_mem_pool_chunk_add(pool, chunk_size))
+		return NULL;
+
+	return gen_pool_dma_alloc_align(pool->gp, size, dma, align);
+}
+
+/* size class of an allocation, or -1 if it is served by gen pool directly */
+static int mdw_mem_pool_get_cls(uint32_t size, uint32_t align)
+{
+	uint32_t cls_size = max_t(uint32_t, size, align);
+
+	if (cls_size > PAGE_SIZE / 2)
+		return -1;
+
+	cls_size = max_t(uint32_t, cls_size, 1U << MDW_MEM_POOL_CLASS_SHIFT);
+
+	return order_base_2(cls_size) - MDW_MEM_POOL_CLASS_SHIFT;
+}
+
+/* take a slot of size class @cls for @m, m_mtx held */
+static int mdw_mem_pool_slab_get(struct mdw_mem_pool *pool, uint32_t cls,
+	struct mdw_mem *m)
+{
+	struct mdw_mem_pool_class *c = &pool->classes[cls];
+	struct mdw_mem_pool_slab *slab = NULL;
+	uint32_t idx = 0, slot_size = mdw_mem_pool_cls_size(cls);
+
+	slab = list_first_entry_or_null(&c->slabs,
+		struct mdw_mem_pool_slab, node);
+	if (!slab || !slab->nr_free) {
+		slab = kzalloc(sizeof(*slab), GFP_KERNEL);
+		if (!slab)
+			return -ENOMEM;
+
+		slab->vaddr = mdw_mem_pool_gp_alloc(pool, PAGE_SIZE, PAGE_SIZE,
+			&slab->dma);
+		if (!slab->vaddr) {
+			kfree(slab);
+			return -ENOMEM;
+		}
+		slab->cls = cls;
+		slab->nr_free = mdw_mem_pool_cls_slots(cls);
+		list_add(&slab->node, &c->slabs);
+	}
+
+	idx = find_first_zero_bit(slab->used, mdw_mem_pool_cls_slots(cls));
+	set_bit(idx, slab->used);
+	/* keep slabs with free slots at head */
+	if (!--slab->nr_free)
+		list_move_tail(&slab->node, &c->slabs);
+
+	m->slab = slab;
+	m->vaddr = slab->vaddr + idx * slot_size;
+	m->device_va = slab->dma + idx * slot_size;
+
+	return 0;
+}
+
+/* give the slot of @m back to its slab, m_mtx held */
+static void mdw_mem_pool_slab_put(struct mdw_mem_pool *pool,
+	struct mdw_mem *m)
+{
+	struct mdw_mem_pool_slab *slab = m->slab;
+	struct mdw_mem_pool_class *c = &pool->classes[slab->cls];
+	uint32_t idx = (m->vaddr - slab->vaddr) / mdw_mem_pool_cls_size(slab->cls);
+
+	clear_bit(idx, slab->used);
+	m->slab = NULL;
+
+	if (++slab->nr_free == mdw_mem_pool_cls_slots(slab->cls)) {
+		list_del(&slab->node);
+		gen_pool_free(pool->gp, (unsigned long)slab->vaddr, PAGE_SIZE);
+		kfree(slab);
+		return;
+	}
+
+	list_move(&slab->node, &c->slabs);
+}
+
+/* alloc a small memory from a size class, magazine first */
+static struct mdw_mem *mdw_mem_pool_cls_alloc(struct mdw_mem_pool *pool,
+	uint32_t cls, uint32_t size, uint32_t align)
+{
+	struct mdw_mem_pool_class *c = &pool->classes[cls];
+	struct mdw_mem *m = NULL;
+
+	mutex_lock(&pool->m_mtx);
+	if (c->mag_cnt) {
+		m = c->mag[--c->mag_cnt];
+	} else {
+		m = mdw_mem_pool_ent_create(pool);
+		if (!m)
+			goto out;
+
+		if (mdw_mem_pool_slab_get(pool, cls, m)) {
+			kfree(m);
+			m = NULL;
+			goto out;
+		}
+	}
+	list_add_tail(&m->d_node, &pool->m_list);
+	kref_get(&pool->m_ref);
+out:
+	mutex_unlock(&pool->m_mtx);
+
+	if (!m)
+		return NULL;
+
+	m->size = size;
+	m->align = align;
+	m->flags = pool->flags;
+	m->type = pool->type;
+	m->belong_apu = true;
+	m->need_handle = false;
+	m->dbuf = NULL;
+	m->release = mdw_mem_pool_ent_release;
+	m->mdev = NULL;
+	m->dva_size = size;
+
+	return m;
+}
+
 /* alloc memory from pool, and alloc/add its mdw_mem struct to pool->list */
 struct mdw_mem *mdw_mem_pool_alloc(struct mdw_mem_pool *pool, uint32_t size,
 	uint32_t align)
 {
 	struct mdw_mem *m = NULL;
 	dma_addr_t dma;
-	bool retried = false;
-	unsigned long chunk_size;
-	int ret = 0;
+	int cls = 0;
 
 	if (!pool || !size)
 		return NULL;
@@ -247,6 +415,19 @@ struct mdw_mem *mdw_mem_pool_alloc(struct mdw_mem_pool *pool, uint32_t size,
 	mdw_trace_begin("%s|size(%u) align(%u)",
 		__func__, size, align);
 
+	cls = mdw_mem_pool_get_cls(size, align);
+	if (cls >= 0) {
+		m = mdw_mem_pool_cls_alloc(pool, cls, size, align);
+		if (!m) {
+			mdw_drv_err("alloc (%p,%d,%d,%d) fail\n",
+				pool, pool->type, size, align);
+			goto out;
+		}
+		memset(m->vaddr, 0, size);
+		mdw_mem_pool_show(m);
+		goto out;
+	}
+
 	/* create mem struct */
 	m = mdw_mem_pool_ent_create(pool);
 	if (!m)
@@ -265,19 +446,10 @@ struct mdw_mem *mdw_mem_pool_alloc(struct mdw_mem_pool *pool, uint32_t size,
 
 	/* alloc mem */
 	mutex_lock(&pool->m_mtx);
-retry:
-	m->vaddr = gen_pool_dma_alloc_align(pool->gp, size, &dma, align);
+	m->vaddr = mdw_mem_pool_gp_alloc(pool, size, align, &dma);
 	if (m->vaddr) {
 		list_add_tail(&m->d_node, &pool->m_list);
 		kref_get(&pool->m_ref);
-	} else {
-		/* try to add a new chunk to pool, and retry again */
-		chunk_size = max(PAGE_SIZE, __roundup_pow_of_two(size));
-		ret = mdw_mem_pool_chunk_add(pool, chunk_size);
-		if (!ret && !retried) {
-			retried = true;
-			goto retry;
-		}
 	}
 	mutex_unlock(&pool->m_mtx);
 
@@ -318,7 +490,9 @@ struct mdw_mem *mdw_mem_pool_alloc(struct mdw_mem_pool *pool, uint32_t size,
 void mdw_mem_pool_free(struct mdw_mem *m)
 {
 	struct mdw_mem_pool *pool;
+	struct mdw_mem_pool_class *c = NULL;
 	uint32_t size = 0, align = 0;
+	bool cached = false;
 
 	if (!m)
 		return;
@@ -341,11 +515,23 @@ void mdw_mem_pool_free(struct mdw_mem *m)
 
 	mutex_lock(&pool->m_mtx);
 	list_del(&m->d_node);
-	gen_pool_free(m->pool->gp, (unsigned long)m->vaddr, m->size);
+	if (m->slab) {
+		c = &pool->classes[m->slab->cls];
+		if (c->mag_cnt < MDW_MEM_POOL_MAG_SIZE) {
+			c->mag[c->mag_cnt++] = m;
+			cached = true;
+		} else {
+			mdw_mem_pool_slab_put(pool, m);
+		}
+	} else {
+		gen_pool_free(m->pool->gp, (unsigned long)m->vaddr, m->size);
+	}
+	/* a cached m is freed by the pool release from here on */
 	kref_put(&pool->m_ref, mdw_mem_pool_release);
 	mutex_unlock(&pool->m_mtx);
 
-	m->release(m);
+	if (!cached)
+		m->release(m);
 
 	mdw_trace_end("%s|size(%u) align(%u)",
 		__func__, size, align);
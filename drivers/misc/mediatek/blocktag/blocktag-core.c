@@ -108,6 +108,12 @@ phys_addr_t dram_end_addr;
 #define MS_TO_NS(ms) (ms * 1000000ULL)
 u32 pwd_width_ms = 250;
 
+/* top-app latency SLO: p95 of send-to-completion time per window */
+#define SLO_MIN_SAMPLES		16
+#define SLO_MAX_LEVEL		3
+u32 slo_target_us = 8000;
+u32 slo_window_ms = 200;
+
 static struct mtk_blocktag *mtk_btag_find(const char *name)
 {
 	struct mtk_blocktag *btag, *n;
@@ -134,11 +140,28 @@ static struct mtk_blocktag *mtk_btag_find_locked(const char *name)
 unsigned long long mtk_btag_system_dram_size;
 struct page_pid_logger *mtk_btag_pagelogger;
 
+/* pid logger: bio sampler, used instead of the page logger if rate != 0 */
+static unsigned int pidlog_sample_rate;
+module_param(pidlog_sample_rate, uint, 0444);
+MODULE_PARM_DESC(pidlog_sample_rate,
+	"Sample 1 out of N bios for pid logging instead of tagging pages");
+static struct mtk_btag_pidlog_sample_ring __percpu *mtk_btag_pidlog_samples;
+
 static size_t mtk_btag_seq_pidlog_usedmem(char **buff, unsigned long *size,
 	struct seq_file *seq)
 {
 	size_t size_l = 0;
 
+	if (mtk_btag_pidlog_samples) {
+		size_l = sizeof(struct mtk_btag_pidlog_sample_ring) *
+			num_possible_cpus();
+		SPREAD_PRINTF(buff, size, seq,
+		"pid sampler buffer: %u cpus * %zu = %zu bytes, rate 1/%u\n",
+			num_possible_cpus(),
+			sizeof(struct mtk_btag_pidlog_sample_ring),
+			size_l, pidlog_sample_rate);
+	}
+
 	if (!IS_ERR_OR_NULL(mtk_btag_pagelogger)) {
 		size_l = (sizeof(struct page_pid_logger)
 			* (mtk_btag_system_dram_size >> PAGE_SHIFT));
@@ -235,16 +258,20 @@ static void mtk_btag_pidlog_add(struct request_queue *q, struct bio *bio,
  * pidlog: hook function for __blk_bios_map_sg()
  * rw: 0=read, 1=write
  */
-void mtk_btag_pidlog_commit_bio(struct request_queue *q, struct bio *bio,
+bool mtk_btag_pidlog_commit_bio(struct request_queue *q, struct bio *bio,
 	struct bio_vec *bvec, bool is_sd)
 {
 	struct page_pid_logger *ppl;
 	unsigned long idx;
+	bool top;
 
 	idx = mtk_btag_pidlog_index(bvec->bv_page);
 	ppl = mtk_btag_pidlog_entry(idx);
+	top = ppl->pid < 0;
 	mtk_btag_pidlog_add(q, bio, ppl->pid, bvec->bv_len, is_sd);
 	ppl->pid = 0;
+
+	return top;
 }
 EXPORT_SYMBOL_GPL(mtk_btag_pidlog_commit_bio);
 
@@ -319,23 +346,30 @@ static void mtk_btag_earaio_uevt_worker(struct work_struct *work)
 	struct mtk_btag_mictx_struct *mictx;
 	unsigned long flags;
 	char event_string[EVT_STR_SIZE];
-	char *envp[2];
+	char level_string[EVT_STR_SIZE];
+	char *envp[3];
 	bool boost, restart, quit;
+	__u16 level;
 	int ret;
 
 	mictx = container_of(work, struct mtk_btag_mictx_struct,
 			   uevt_work);
 
 	envp[0] = event_string;
-	envp[1] = NULL;
+	envp[1] = level_string;
+	envp[2] = NULL;
 
 start:
 	boost = quit = restart = false;
+	level = 0;
 	spin_lock_irqsave(&mictx->lock, flags);
-	if (mictx->uevt_state != mictx->uevt_req)
+	if (mictx->uevt_state != mictx->uevt_req ||
+	    mictx->uevt_level_state != mictx->uevt_level_req) {
 		boost = mictx->uevt_req;
-	else
+		level = mictx->uevt_level_req;
+	} else {
 		quit = true;
+	}
 	spin_unlock_irqrestore(&mictx->lock, flags);
 
 	if (quit)
@@ -346,6 +380,12 @@ static void mtk_btag_earaio_uevt_worker(struct work_struct *work)
 	if (!ret)
 		return;
 
+	/* how far to boost, 1 (mild) to SLO_MAX_LEVEL */
+	ret = snprintf(level_string,
+		EVT_STR_SIZE, "level=%u", boost ? level : 0);
+	if (!ret)
+		return;
+
 	ret = kobject_uevent_env(
 			&earaio_obj.this_device->kobj,
 			KOBJ_CHANGE, envp);
@@ -354,14 +394,16 @@ static void mtk_btag_earaio_uevt_worker(struct work_struct *work)
 			event_string, ret);
 	} else {
 		mictx->uevt_state = boost;
+		mictx->uevt_level_state = level;
 		if (mtk_btag_mictx_data_dump) {
-			pr_info("[BLOCK_TAG] uevt: %s sent",
-				event_string);
+			pr_info("[BLOCK_TAG] uevt: %s %s sent",
+				event_string, level_string);
 		}
 	}
 
 	spin_lock_irqsave(&mictx->lock, flags);
-	if (mictx->uevt_state != mictx->uevt_req)
+	if (mictx->uevt_state != mictx->uevt_req ||
+	    mictx->uevt_level_state != mictx->uevt_level_req)
 		restart = true;
 	spin_unlock_irqrestore(&mictx->lock, flags);
 
@@ -370,9 +412,10 @@ static void mtk_btag_earaio_uevt_worker(struct work_struct *work)
 }
 
 static bool mtk_btag_earaio_send_uevt(struct mtk_btag_mictx_struct *mictx,
-				      bool boost)
+				      bool boost, __u16 level)
 {
 	mictx->uevt_req = boost;
+	mictx->uevt_level_req = level;
 	queue_work(mictx->uevt_workq, &mictx->uevt_work);
 
 	return true;
@@ -405,9 +448,10 @@ void mtk_btag_earaio_boost(bool boost)
 		/* Establish threshold to avoid lousy uevents */
 		if ((mictx->pwd_top_r_pages >= EARAIO_UEVT_THRESHOLD_PAGES) ||
 			(mictx->pwd_top_w_pages >= EARAIO_UEVT_THRESHOLD_PAGES))
-			changed = mtk_btag_earaio_send_uevt(mictx, true);
+			changed = mtk_btag_earaio_send_uevt(mictx, true, 1);
 	} else {
-		changed = mtk_btag_earaio_send_uevt(mictx, false);
+		changed = mtk_btag_earaio_send_uevt(mictx, false, 0);
+		mictx->slo.level = 0;
 	}
 
 	if (changed)
@@ -422,6 +466,34 @@ void mtk_btag_earaio_boost(bool boost)
 	spin_unlock_irqrestore(&mictx->lock, flags);
 }
 
+/*
+ * Boost on behalf of the latency SLO. Unlike mtk_btag_earaio_boost(), a
+ * missed SLO boosts regardless of how much top-app I/O is pending, its
+ * level follows how far p95 overshoots the target, and the boost is dropped
+ * as soon as a window meets the SLO again.
+ */
+static void mtk_btag_earaio_slo_boost(__u16 level)
+{
+	struct mtk_btag_mictx_struct *mictx;
+	unsigned long flags;
+
+	mictx = mtk_btag_mictx_get();
+	if (!mictx || !mictx->enabled || !mictx->earaio_enabled ||
+	    !mictx->earaio_allowed || unlikely(!earaio_obj.minor))
+		return;
+
+	spin_lock_irqsave(&mictx->lock, flags);
+	if (level != mictx->slo.level) {
+		/* don't drop a boost the SLO did not ask for */
+		if (level || mictx->slo.level) {
+			mtk_btag_earaio_send_uevt(mictx, !!level, level);
+			mictx->boosted = !!level;
+		}
+		mictx->slo.level = level;
+	}
+	spin_unlock_irqrestore(&mictx->lock, flags);
+}
+
 static int mtk_btag_earaio_init(void)
 {
 	int ret = 0;
@@ -477,6 +549,7 @@ static inline bool mtk_btag_earaio_init(void)
 }
 
 #define mtk_btag_earaio_init_mictx(...)
+#define mtk_btag_earaio_slo_boost(...)
 #endif
 
 static void _mtk_btag_pidlog_set_pid(struct page *p, int mode, bool write)
@@ -562,6 +635,118 @@ void mtk_btag_pidlog_set_pid_pages(struct page **page, int page_cnt,
 }
 EXPORT_SYMBOL_GPL(mtk_btag_pidlog_set_pid_pages);
 
+/*
+ * Sampling mode: record the submitter of every Nth bio on this CPU. Writeback
+ * is attributed to the flusher, as the dirtier is not known without the page
+ * logger; on the other hand nothing is paid on the page-cache write path.
+ */
+static void btag_trace_block_bio_queue(void *data, struct request_queue *q,
+				       struct bio *bio)
+{
+	struct mtk_btag_pidlog_sample_ring *ring;
+	struct mtk_btag_pidlog_sample *e;
+	unsigned long flags;
+
+	if (!mtk_btag_pidlog_samples)
+		return;
+
+	if (bio_op(bio) != REQ_OP_READ && bio_op(bio) != REQ_OP_WRITE)
+		return;
+
+	ring = raw_cpu_ptr(mtk_btag_pidlog_samples);
+	if (++ring->count < pidlog_sample_rate)
+		return;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	ring->count = 0;
+	e = &ring->ent[ring->head];
+	e->pid = current->pid;
+	e->len = bio->bi_iter.bi_size;
+	e->write = op_is_write(bio_op(bio));
+	get_task_comm(e->comm, current);
+	ring->head = (ring->head + 1) % BLOCKTAG_PIDLOG_SAMPLES;
+	if (ring->nr < BLOCKTAG_PIDLOG_SAMPLES)
+		ring->nr++;
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+
+struct mtk_btag_pidlog_sample_sum {
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	__u64 r_bytes;
+	__u64 w_bytes;
+};
+
+#define BLOCKTAG_PIDLOG_SAMPLE_TASKS 64
+
+/* estimated per-task bytes over the samples currently held in the rings */
+static int mtk_btag_pidlog_sample_show(struct seq_file *s, void *data)
+{
+	struct mtk_btag_pidlog_sample_sum *sum;
+	struct mtk_btag_pidlog_sample_ring *ring;
+	struct mtk_btag_pidlog_sample *e;
+	unsigned long flags;
+	int cpu, i, j, nr_sum = 0, dropped = 0;
+
+	if (!mtk_btag_pidlog_samples) {
+		seq_puts(s, "pid sampler disabled, see pidlog_sample_rate\n");
+		return 0;
+	}
+
+	sum = kcalloc(BLOCKTAG_PIDLOG_SAMPLE_TASKS, sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(mtk_btag_pidlog_samples, cpu);
+		spin_lock_irqsave(&ring->lock, flags);
+		for (i = 0; i < ring->nr; i++) {
+			e = &ring->ent[i];
+			for (j = 0; j < nr_sum; j++)
+				if (sum[j].pid == e->pid)
+					break;
+			if (j == nr_sum) {
+				if (nr_sum == BLOCKTAG_PIDLOG_SAMPLE_TASKS) {
+					dropped++;
+					continue;
+				}
+				sum[j].pid = e->pid;
+				memcpy(sum[j].comm, e->comm, TASK_COMM_LEN);
+				nr_sum++;
+			}
+			if (e->write)
+				sum[j].w_bytes += e->len;
+			else
+				sum[j].r_bytes += e->len;
+		}
+		spin_unlock_irqrestore(&ring->lock, flags);
+	}
+
+	seq_printf(s, "rate: 1/%u, tasks: %d, dropped samples: %d\n",
+		   pidlog_sample_rate, nr_sum, dropped);
+	seq_puts(s, "pid comm read_bytes write_bytes\n");
+	for (j = 0; j < nr_sum; j++)
+		seq_printf(s, "%d %s %llu %llu\n", sum[j].pid, sum[j].comm,
+			   sum[j].r_bytes * pidlog_sample_rate,
+			   sum[j].w_bytes * pidlog_sample_rate);
+
+	kfree(sum);
+	return 0;
+}
+
+static int mtk_btag_pidlog_sample_open(struct inode *inode,
+				       struct file *file)
+{
+	return single_open(file, mtk_btag_pidlog_sample_show, NULL);
+}
+
+static const struct proc_ops mtk_btag_pidlog_sample_fops = {
+	.proc_open		= mtk_btag_pidlog_sample_open,
+	.proc_read		= seq_read,
+	.proc_lseek		= seq_lseek,
+	.proc_release		= single_release,
+};
+
 /* evaluate vmstat trace from global_node_page_state() */
 void mtk_btag_vmstat_eval(struct mtk_btag_vmstat *vm)
 {
@@ -1235,6 +1420,15 @@ static int mtk_btag_mictx_sub_show(struct seq_file *s, void *data)
 	seq_printf(s, "  Mictx Self-Test: %d\n", mtk_btag_mictx_self_test);
 	seq_printf(s, "  Mictx Event Dump: %d\n", mtk_btag_mictx_data_dump);
 	seq_printf(s, "  EARA-IO Active: %d\n", earaio_active);
+	if (btag_bootdev) {
+		struct mtk_btag_slo *slo = &btag_bootdev->mictx.slo;
+
+		seq_printf(s, "  SLO Target p95: %u us / %u ms\n",
+			   slo_target_us, slo_window_ms);
+		seq_printf(s, "  SLO Last p95: %u us\n", slo->p95_us);
+		seq_printf(s, "  SLO Violations: %u\n", slo->violations);
+		seq_printf(s, "  SLO Boost Level: %u\n", slo->level);
+	}
 	seq_puts(s, "Commands: echo n > blockio_mictx, n presents\n");
 	seq_puts(s, "  Enable Mini Context : 1\n");
 	seq_puts(s, "  Disable Mini Context: 2\n");
@@ -1276,6 +1470,19 @@ static void mtk_btag_init_pidlogger(void)
 {
 	unsigned long count = mtk_btag_system_dram_size >> PAGE_SHIFT;
 	unsigned long size = count * sizeof(struct page_pid_logger);
+	int cpu;
+
+	if (pidlog_sample_rate) {
+		mtk_btag_pidlog_samples =
+			alloc_percpu(struct mtk_btag_pidlog_sample_ring);
+		if (mtk_btag_pidlog_samples) {
+			for_each_possible_cpu(cpu)
+				spin_lock_init(&per_cpu_ptr(
+					mtk_btag_pidlog_samples, cpu)->lock);
+			return;
+		}
+		pr_info("[BLOCK_TAG] blockio: fail to allocate pid sampler\n");
+	}
 
 	if (mtk_btag_pagelogger)
 		goto init;
@@ -1398,6 +1605,11 @@ static int mtk_btag_init_procfs(void)
 	else
 		pr_info("[BLOCK_TAG} %s: failed to initialize procfs", __func__);
 
+	proc_entry = proc_create("pidlog_sample", S_IFREG | 0444,
+				 btag_proc_root, &mtk_btag_pidlog_sample_fops);
+	if (proc_entry)
+		proc_set_user(proc_entry, uid, gid);
+
 	return 0;
 }
 
@@ -1454,6 +1666,74 @@ void mtk_btag_mictx_eval_req(
 }
 EXPORT_SYMBOL_GPL(mtk_btag_mictx_eval_req);
 
+/* caller holds slo's mictx->lock; returns the boost level the window asks */
+static __u16 mtk_btag_slo_eval(struct mtk_btag_slo *slo)
+{
+	__u32 rank, cum = 0, lo, hi;
+	int i;
+
+	if (slo->count < SLO_MIN_SAMPLES)
+		return 0;
+
+	/* interpolate p95 linearly inside its log2 bucket */
+	rank = slo->count - slo->count / 20;
+	for (i = 0; i < BTAG_SLO_BUCKETS - 1; i++) {
+		if (cum + slo->hist[i] >= rank)
+			break;
+		cum += slo->hist[i];
+	}
+	lo = i ? 1U << i : 0;
+	hi = 1U << (i + 1);
+	slo->p95_us = lo + (hi - lo) * (rank - cum) /
+		max_t(__u32, slo->hist[i], 1);
+
+	if (slo->p95_us <= slo_target_us)
+		return 0;
+
+	slo->violations++;
+	return min_t(__u32, slo->p95_us / max_t(u32, slo_target_us, 1),
+		     SLO_MAX_LEVEL);
+}
+
+/*
+ * lat: send-to-completion time of one request (ns). Only top-app requests
+ * are tracked, as that is the cgroup blocktag classifies requests by.
+ */
+void mtk_btag_mictx_eval_lat(struct mtk_blocktag *btag, bool top,
+	__u64 lat)
+{
+	struct mtk_btag_mictx_struct *mictx = &btag->mictx;
+	struct mtk_btag_slo *slo = &mictx->slo;
+	unsigned long flags;
+	bool closed = false;
+	__u16 level = 0;
+	__u64 now;
+	__u32 us;
+
+	if (!mictx->enabled || !mictx->earaio_enabled || !top)
+		return;
+
+	us = min_t(__u64, div_u64(lat, NSEC_PER_USEC), U32_MAX);
+	now = sched_clock();
+
+	spin_lock_irqsave(&mictx->lock, flags);
+	slo->hist[us ? min_t(int, ilog2(us), BTAG_SLO_BUCKETS - 1) : 0]++;
+	slo->count++;
+
+	if (now - slo->window_begin >= MS_TO_NS(slo_window_ms)) {
+		level = mtk_btag_slo_eval(slo);
+		memset(slo->hist, 0, sizeof(slo->hist));
+		slo->count = 0;
+		slo->window_begin = now;
+		closed = true;
+	}
+	spin_unlock_irqrestore(&mictx->lock, flags);
+
+	if (closed)
+		mtk_btag_earaio_slo_boost(level);
+}
+EXPORT_SYMBOL_GPL(mtk_btag_mictx_eval_lat);
+
 void mtk_btag_mictx_update(
 	struct mtk_blocktag *btag,
 	__u32 q_depth)
@@ -1732,23 +2012,28 @@ static void btag_trace_block_rq_insert(void *data,
 	}
 }
 
-void mtk_btag_commit_req(struct request *rq, bool is_sd)
+/* returns true if any page of @rq was requested by a top-app task */
+bool mtk_btag_commit_req(struct request *rq, bool is_sd)
 {
 	struct request_queue *q = rq->q;
 	struct bio *bio = rq->bio;
 	struct bio_vec bvec;
 	struct req_iterator rq_iter;
+	bool top = false;
 
 	if (unlikely(!mtk_btag_pagelogger) || !bio)
-		return;
+		return false;
 
 	if (bio_op(bio) != REQ_OP_READ && bio_op(bio) != REQ_OP_WRITE)
-		return;
+		return false;
 
 	rq_for_each_segment(bvec, rq, rq_iter) {
 		if (bvec.bv_page)
-			mtk_btag_pidlog_commit_bio(q, bio, &bvec, is_sd);
+			top |= mtk_btag_pidlog_commit_bio(q, bio, &bvec,
+							  is_sd);
 	}
+
+	return top;
 }
 
 static void btag_trace_writeback_dirty_page(void *data,
@@ -1792,6 +2077,10 @@ static struct tracepoints_table interests[] = {
 		.name = "writeback_dirty_page",
 		.func = btag_trace_writeback_dirty_page
 	},
+	{
+		.name = "block_bio_queue",
+		.func = btag_trace_block_bio_queue
+	},
 #if IS_ENABLED(CONFIG_MTK_BLOCK_IO_PM_DEBUG)
 	{
 		.name = "blk_pre_runtime_suspend_start",
@@ -150,8 +150,7 @@ void mmc_mtk_biolog_send_command(unsigned int task_id,
 	} else
 		return;
 
-	if (req)
-		mtk_btag_commit_req(req, is_sd);
+	tsk->top = req ? mtk_btag_commit_req(req, is_sd) : false;
 
 	if (is_sd && mrq->cmd->data) {
 		tsk->len = mrq->cmd->data->blksz * mrq->cmd->data->blocks;
@@ -251,6 +250,7 @@ void mmc_mtk_biolog_transfer_req_compl(struct mmc_host *mmc,
 		mtk_btag_mictx_eval_tp(mmc_mtk_btag, rw, busy_time,
 				       size);
 	}
+	mtk_btag_mictx_eval_lat(mmc_mtk_btag, tsk->top, busy_time);
 
 	if (!req_mask)
 		ctx->q_depth = 0;
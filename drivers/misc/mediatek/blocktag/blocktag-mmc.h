@@ -46,6 +46,7 @@ struct mmc_mtk_bio_context_task {
 	__u32 dir;
 	__u32 len;
 	__u32 lba;
+	bool top;	/* requested by a top-app task */
 	uint64_t t[tsk_max];
 };
 
@@ -154,8 +154,8 @@ void ufs_mtk_biolog_send_command(unsigned int task_id,
 	if (!tsk)
 		return;
 
-	if (cmd->request)
-		mtk_btag_commit_req(cmd->request, false);
+	tsk->top = cmd->request ?
+		mtk_btag_commit_req(cmd->request, false) : false;
 
 	tsk->lba = scsi_cmnd_lba(cmd);
 	tsk->len = scsi_cmnd_len(cmd);
@@ -266,6 +266,7 @@ void ufs_mtk_biolog_transfer_req_compl(unsigned int task_id,
 		mtk_btag_mictx_eval_tp(ufs_mtk_btag, rw, busy_time,
 				       size);
 	}
+	mtk_btag_mictx_eval_lat(ufs_mtk_btag, tsk->top, busy_time);
 
 	if (!req_mask)
 		ctx->q_depth = 0;
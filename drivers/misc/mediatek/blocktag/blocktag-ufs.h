@@ -26,6 +26,7 @@ struct ufs_mtk_bio_context_task {
 	__u16 cmd;
 	__u16 len;
 	__u32 lba;
+	bool top;	/* requested by a top-app task */
 	uint64_t t[tsk_max];
 };
 
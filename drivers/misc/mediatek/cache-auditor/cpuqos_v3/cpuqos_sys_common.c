@@ -27,6 +27,8 @@
 static struct attribute *cpuqos_attrs[] = {
 	&show_cpuqos_status_attr.attr,
 	&set_cache_size_attr.attr,
+	&set_cache_feedback_attr.attr,
+	&set_cache_feedback_thresh_attr.attr,
 	NULL,
 };
 
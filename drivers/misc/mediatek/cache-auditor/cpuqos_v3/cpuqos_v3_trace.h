@@ -146,6 +146,36 @@ TRACE_EVENT(cpuqos_set_cpuqos_mode,
 
 );
 
+TRACE_EVENT(cpuqos_cache_feedback,
+
+	TP_PROTO(u64 ct_refill, u64 nct_refill,
+		int old_portion, int new_portion, int streak),
+
+	TP_ARGS(ct_refill, nct_refill, old_portion, new_portion, streak),
+
+	TP_STRUCT__entry(
+		__field(u64, ct_refill)
+		__field(u64, nct_refill)
+		__field(int, old_portion)
+		__field(int, new_portion)
+		__field(int, streak)
+	),
+
+	TP_fast_assign(
+		__entry->ct_refill	= ct_refill;
+		__entry->nct_refill	= nct_refill;
+		__entry->old_portion	= old_portion;
+		__entry->new_portion	= new_portion;
+		__entry->streak		= streak;
+	),
+
+	TP_printk("ct_refill=%llu, nct_refill=%llu, old_portion=%d, new_portion=%d, streak=%d",
+		__entry->ct_refill, __entry->nct_refill,
+		__entry->old_portion, __entry->new_portion,
+		__entry->streak)
+
+);
+
 
 
 #endif /* _CPUQOS_V3_TRACE_H */
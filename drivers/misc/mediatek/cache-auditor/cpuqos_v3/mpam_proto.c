@@ -12,6 +12,9 @@
 #include <linux/percpu-defs.h>
 #include <trace/events/task.h>
 #include <linux/platform_device.h>
+#include <linux/perf_event.h>
+#include <linux/workqueue.h>
+#include <linux/io.h>
 
 #include <trace/hooks/fpsimd.h>
 #include <trace/hooks/cgroup.h>
@@ -38,6 +41,7 @@
 #define SLC_CPU_DEBUG0_R_OFS    0x88
 #define SLC_CPU_DEBUG1_R_OFS    0x8C
 #define SLC_SRAM_SIZE           0x100
+#define L3CTL_PORTION_MASK      0x3
 static void __iomem *sram_base_addr;
 
 MODULE_LICENSE("GPL");
@@ -103,6 +107,53 @@ enum partid_rank {
 
 static enum perf_mode cpuqos_perf_mode = BALANCE;
 
+#define NR_PARTID		(NCT_PARTID + 1)
+
+/*
+ * LLC miss feedback
+ *
+ * The core PMU L3D_CACHE_REFILL count is billed to the PARTID a CPU was
+ * running with each time mpam_sync_task() switches it, so the per-PARTID
+ * totals stay exact without an MPAM monitor. Every cache_fb_interval_ms
+ * the CT/NCT refill delta decides whether the CT portion of L3CTL
+ * should grow (CT keeps missing) or shrink (CT working set fits), within
+ * [cache_fb_portion_min, cache_fb_portion_max]. A move needs
+ * CACHE_FB_HOLD consecutive votes in the same direction.
+ */
+#define ARMV8_L3D_CACHE_REFILL	0x2A
+#define CACHE_LINE_BYTES	64
+#define CACHE_FB_HOLD		3
+
+struct partid_l3_stat {
+	u64 last;
+	u64 refill[NR_PARTID];
+};
+
+static DEFINE_PER_CPU(struct perf_event *, l3_refill_event);
+static DEFINE_PER_CPU(struct partid_l3_stat, partid_l3_stat);
+
+static DEFINE_MUTEX(cache_fb_lock);
+static int cache_fb_enable;
+static int cache_fb_portion_min;
+static int cache_fb_portion_max = L3CTL_PORTION_MASK;
+static int cache_fb_interval_ms = 100;
+/* CT L3 refills per ms */
+static unsigned int cache_fb_ct_high = 8000;
+static unsigned int cache_fb_ct_low = 1000;
+static int cache_fb_streak;
+static u64 cache_fb_prev[NR_PARTID];
+static u64 cache_fb_last_delta[NR_PARTID];
+static void cache_fb_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(cache_fb_work, cache_fb_work_fn);
+
+static void __iomem *cpuqos_sram_base(void)
+{
+	if (!sram_base_addr)
+		sram_base_addr = ioremap(SLC_SYSRAM_BASE, SLC_SRAM_SIZE);
+
+	return sram_base_addr;
+}
+
 int task_curr_clone(const struct task_struct *p)
 {
 	return cpu_curr(task_cpu(p)) == p;
@@ -253,6 +304,27 @@ static void mpam_write_partid(int partid)
 	write_mpam_partid(this_cpu_read(mpam_local_partid));
 }
 
+/*
+ * Bill the L3 refills since the last switch on this CPU to @partid.
+ * Called with irqs disabled from the switch hook or the partid IPI.
+ */
+static void mpam_account_l3_refill(int partid)
+{
+	struct perf_event *event = this_cpu_read(l3_refill_event);
+	struct partid_l3_stat *stat;
+	u64 val;
+
+	if (!event || partid < 0 || partid >= NR_PARTID)
+		return;
+
+	if (perf_event_read_local(event, &val, NULL, NULL))
+		return;
+
+	stat = this_cpu_ptr(&partid_l3_stat);
+	stat->refill[partid] += val - stat->last;
+	stat->last = val;
+}
+
 /*
  * Sync @p's associated PARTID with this CPU's register.
  */
@@ -262,6 +334,8 @@ static void mpam_sync_task(struct task_struct *p)
 	int old_partid = this_cpu_read(mpam_local_partid);
 	u64 v1, v2;
 
+	mpam_account_l3_refill(old_partid);
+
 	rcu_read_lock();
 	css = task_css(p, cpuqos_subsys_id);
 	rcu_read_unlock();
@@ -494,9 +568,7 @@ static ssize_t show_cpuqos_status(struct kobject *kobj,
 	unsigned int max_len = 4096;
 	unsigned int csize = 0, ctnct = 0;
 
-	sram_base_addr = ioremap(SLC_SYSRAM_BASE, SLC_SRAM_SIZE);
-
-	if (!sram_base_addr) {
+	if (!cpuqos_sram_base()) {
 		pr_info("Remap SLC SYSRAM failed\n");
 		return -EIO;
 	}
@@ -521,9 +593,7 @@ static ssize_t set_cache_size(struct kobject *kobj,
 {
 	unsigned int data = 0, mode = 0, slice = 0, portion = 0;
 
-	sram_base_addr = ioremap(SLC_SYSRAM_BASE, SLC_SRAM_SIZE);
-
-	if (!sram_base_addr) {
+	if (!cpuqos_sram_base()) {
 		pr_info("Remap SLC SYSRAM failed\n");
 		return -EIO;
 	}
@@ -544,9 +614,7 @@ static ssize_t show_cache_size(struct kobject *kobj,
 	unsigned int max_len = 4096;
 	unsigned int data = 0, mode = 0, slice = 0, portion = 0;
 
-	sram_base_addr = ioremap(SLC_SYSRAM_BASE, SLC_SRAM_SIZE);
-
-	if (!sram_base_addr) {
+	if (!cpuqos_sram_base()) {
 		pr_info("Remap SLC SYSRAM failed\n");
 		return -EIO;
 	}
@@ -562,12 +630,224 @@ static ssize_t show_cache_size(struct kobject *kobj,
 	return len;
 }
 
+static void cache_fb_work_fn(struct work_struct *work)
+{
+	u64 sum[NR_PARTID] = {0};
+	u64 ct, nct, ct_rate;
+	unsigned int data;
+	int cpu, i, portion, new_portion, vote = 0;
+
+	mutex_lock(&cache_fb_lock);
+	if (!cache_fb_enable || !cpuqos_sram_base())
+		goto out;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < NR_PARTID; i++)
+			sum[i] += READ_ONCE(per_cpu(partid_l3_stat, cpu).refill[i]);
+
+	for (i = 0; i < NR_PARTID; i++) {
+		cache_fb_last_delta[i] = sum[i] - cache_fb_prev[i];
+		cache_fb_prev[i] = sum[i];
+	}
+
+	ct = cache_fb_last_delta[CT_PARTID];
+	nct = cache_fb_last_delta[NCT_PARTID] + cache_fb_last_delta[DEF_PARTID];
+	ct_rate = div_u64(ct, cache_fb_interval_ms);
+
+	if (ct_rate >= cache_fb_ct_high)
+		vote = 1;
+	else if (ct_rate <= cache_fb_ct_low)
+		vote = -1;
+
+	if (vote && cache_fb_streak * vote >= 0)
+		cache_fb_streak += vote;
+	else
+		cache_fb_streak = vote;
+
+	data = ioread32(sram_base_addr + CPUQOS_L3CTL_M_OFS);
+	portion = data & L3CTL_PORTION_MASK;
+	new_portion = portion;
+
+	if (abs(cache_fb_streak) >= CACHE_FB_HOLD) {
+		new_portion += vote;
+		cache_fb_streak = 0;
+	}
+	new_portion = clamp(new_portion, cache_fb_portion_min,
+			cache_fb_portion_max);
+
+	trace_cpuqos_cache_feedback(ct, nct, portion, new_portion,
+			cache_fb_streak);
+
+	if (new_portion != portion)
+		iowrite32((data & ~L3CTL_PORTION_MASK) | new_portion,
+			sram_base_addr + CPUQOS_L3CTL_M_OFS);
+
+	queue_delayed_work(system_power_efficient_wq, &cache_fb_work,
+			msecs_to_jiffies(cache_fb_interval_ms));
+out:
+	mutex_unlock(&cache_fb_lock);
+}
+
+static void cache_fb_start(void)
+{
+	struct perf_event_attr attr = {
+		.type		= PERF_TYPE_RAW,
+		.config		= ARMV8_L3D_CACHE_REFILL,
+		.size		= sizeof(struct perf_event_attr),
+		.pinned		= 1,
+	};
+	struct perf_event *event;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(l3_refill_event, cpu))
+			continue;
+
+		memset(&per_cpu(partid_l3_stat, cpu), 0,
+			sizeof(struct partid_l3_stat));
+
+		event = perf_event_create_kernel_counter(&attr, cpu,
+				NULL, NULL, NULL);
+		if (IS_ERR(event)) {
+			pr_info("cpuqos: no L3 refill counter on cpu%d\n", cpu);
+			continue;
+		}
+
+		/* Pairs with the switch hook reading it with irqs disabled */
+		smp_store_release(&per_cpu(l3_refill_event, cpu), event);
+	}
+
+	memset(cache_fb_prev, 0, sizeof(cache_fb_prev));
+	cache_fb_streak = 0;
+	queue_delayed_work(system_power_efficient_wq, &cache_fb_work,
+			msecs_to_jiffies(cache_fb_interval_ms));
+}
+
+static void cache_fb_stop(void)
+{
+	struct perf_event *event;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		event = per_cpu(l3_refill_event, cpu);
+		WRITE_ONCE(per_cpu(l3_refill_event, cpu), NULL);
+		per_cpu(partid_l3_stat, cpu).last = 0;
+		if (!event)
+			continue;
+
+		/* Wait out any switch hook still reading the counter */
+		synchronize_rcu();
+		perf_event_release_kernel(event);
+	}
+}
+
+static ssize_t show_cache_feedback(struct kobject *kobj,
+		struct kobj_attribute *attr,
+		char *buf)
+{
+	unsigned int len = 0;
+	unsigned int max_len = 4096;
+	int i;
+
+	mutex_lock(&cache_fb_lock);
+	len += snprintf(buf+len, max_len-len,
+			"enable = %d, portion min/max = %d/%d, interval = %dms\n",
+			cache_fb_enable, cache_fb_portion_min,
+			cache_fb_portion_max, cache_fb_interval_ms);
+
+	for (i = 0; i < NR_PARTID; i++)
+		len += snprintf(buf+len, max_len-len,
+				"partid %d: L3 refill = %llu, miss bw = %llu KB/s\n",
+				i, cache_fb_last_delta[i],
+				div_u64(cache_fb_last_delta[i] * CACHE_LINE_BYTES,
+					cache_fb_interval_ms));
+	mutex_unlock(&cache_fb_lock);
+
+	return len;
+}
+
+/* enable:portion_min:portion_max, e.g. "1:1:3" */
+static ssize_t set_cache_feedback(struct kobject *kobj,
+		struct kobj_attribute *attr,
+		const char *ubuf,
+		size_t cnt)
+{
+	int enable = 0, min = 0, max = 0;
+
+	if (sscanf(ubuf, "%d:%d:%d", &enable, &min, &max) != 3)
+		return -EINVAL;
+
+	if (min < 0 || max > L3CTL_PORTION_MASK || min > max)
+		return -EINVAL;
+
+	mutex_lock(&cache_fb_lock);
+	cache_fb_portion_min = min;
+	cache_fb_portion_max = max;
+	enable = !!enable;
+	if (enable != cache_fb_enable) {
+		cache_fb_enable = enable;
+		if (enable)
+			cache_fb_start();
+	}
+	mutex_unlock(&cache_fb_lock);
+
+	if (!enable) {
+		cancel_delayed_work_sync(&cache_fb_work);
+		mutex_lock(&cache_fb_lock);
+		if (!cache_fb_enable)
+			cache_fb_stop();
+		mutex_unlock(&cache_fb_lock);
+	}
+
+	return cnt;
+}
+
+static ssize_t show_cache_feedback_thresh(struct kobject *kobj,
+		struct kobj_attribute *attr,
+		char *buf)
+{
+	return snprintf(buf, 4096, "ct_high = %u, ct_low = %u, interval = %dms\n",
+			cache_fb_ct_high, cache_fb_ct_low, cache_fb_interval_ms);
+}
+
+/* ct_high:ct_low:interval_ms, thresholds in CT L3 refills per ms */
+static ssize_t set_cache_feedback_thresh(struct kobject *kobj,
+		struct kobj_attribute *attr,
+		const char *ubuf,
+		size_t cnt)
+{
+	unsigned int high = 0, low = 0;
+	int interval = 0;
+
+	if (sscanf(ubuf, "%u:%u:%d", &high, &low, &interval) != 3)
+		return -EINVAL;
+
+	if (low >= high || interval <= 0)
+		return -EINVAL;
+
+	mutex_lock(&cache_fb_lock);
+	cache_fb_ct_high = high;
+	cache_fb_ct_low = low;
+	cache_fb_interval_ms = interval;
+	cache_fb_streak = 0;
+	mutex_unlock(&cache_fb_lock);
+
+	return cnt;
+}
+
 struct kobj_attribute show_cpuqos_status_attr =
 __ATTR(cpuqos_status_info, 0400, show_cpuqos_status, NULL);
 
 struct kobj_attribute set_cache_size_attr =
 __ATTR(cpuqos_set_cache_size, 0600, show_cache_size, set_cache_size);
 
+struct kobj_attribute set_cache_feedback_attr =
+__ATTR(cpuqos_cache_feedback, 0600, show_cache_feedback, set_cache_feedback);
+
+struct kobj_attribute set_cache_feedback_thresh_attr =
+__ATTR(cpuqos_cache_feedback_thresh, 0600, show_cache_feedback_thresh,
+	set_cache_feedback_thresh);
+
 static void mpam_hook_attach(void __always_unused *data,
 			     struct cgroup_subsys *ss, struct cgroup_taskset *tset)
 {
@@ -803,6 +1083,14 @@ static void mpam_reset_partid(void __always_unused *info)
 
 static void __init mpam_proto_exit(void)
 {
+	mutex_lock(&cache_fb_lock);
+	cache_fb_enable = 0;
+	mutex_unlock(&cache_fb_lock);
+	cancel_delayed_work_sync(&cache_fb_work);
+	mutex_lock(&cache_fb_lock);
+	cache_fb_stop();
+	mutex_unlock(&cache_fb_lock);
+
 	unregister_trace_android_vh_is_fpsimd_save(mpam_hook_switch, NULL);
 	unregister_trace_android_vh_cgroup_attach(mpam_hook_attach, NULL);
 	unregister_trace_task_newtask(mpam_task_newtask, NULL);
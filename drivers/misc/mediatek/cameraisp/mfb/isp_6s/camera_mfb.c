@@ -22,6 +22,8 @@
 #include <linux/suspend.h>
 #include <linux/rtc.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/sync_file.h>
 
 #include "camera_mfb.h"
 #include "engine_request.h"
@@ -2603,6 +2605,69 @@ static unsigned int msf_get_reqs(enum exec_mode exec,
 	return ret;
 }
 
+/******************************************************************************
+ * in-fence/out-fence of MFB_MSS/MSF_FENCE_ENQUE_REQ
+ ******************************************************************************/
+static void mfb_fence_abort(struct dma_fence *in_fence,
+	struct dma_fence *out_fence, struct sync_file *sync, int fd)
+{
+	if (fd >= 0)
+		put_unused_fd(fd);
+	if (sync)
+		fput(sync->file);
+	dma_fence_put(out_fence);
+	dma_fence_put(in_fence);
+}
+
+/* out_fence fd is only installed by mfb_fence_commit() */
+static signed int mfb_fence_prepare(struct engine_requests *reqs,
+	struct MFB_FENCE_STRUCT __user *ufence, struct dma_fence **in_fence,
+	struct dma_fence **out_fence, struct sync_file **sync, int *fd)
+{
+	int in_fd = -1;
+	signed int Ret = -ENOMEM;
+
+	if (!reqs || get_user(in_fd, &ufence->in_fence))
+		return -EFAULT;
+
+	if (in_fd >= 0) {
+		*in_fence = sync_file_get_fence(in_fd);
+		if (!*in_fence) {
+			LOG_ERR("invalid in_fence fd(%d)\n", in_fd);
+			return -EINVAL;
+		}
+	}
+
+	*out_fence = mfb_request_fence_create(reqs);
+	if (!*out_fence)
+		goto EXIT;
+	*sync = sync_file_create(*out_fence);
+	if (!*sync)
+		goto EXIT;
+	*fd = get_unused_fd_flags(O_CLOEXEC);
+	if (*fd < 0) {
+		Ret = *fd;
+		goto EXIT;
+	}
+	if (put_user(*fd, &ufence->out_fence)) {
+		Ret = -EFAULT;
+		goto EXIT;
+	}
+
+	return 0;
+EXIT:
+	mfb_fence_abort(*in_fence, *out_fence, *sync, *fd);
+	*in_fence = NULL;
+	*out_fence = NULL;
+	*sync = NULL;
+	*fd = -1;
+	return Ret;
+}
+
+static void mfb_fence_commit(struct sync_file *sync, int fd)
+{
+	fd_install(fd, sync->file);
+}
 
 static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 {
@@ -2622,6 +2687,11 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 			     /* FIX to avoid build warning */
 	struct MFB_MapTable mfb_maptable;
 	unsigned int i = 0;
+	struct MFB_FENCE_STRUCT __user *ufence = NULL;
+	struct dma_fence *in_fence = NULL, *out_fence = NULL;
+	struct sync_file *sync = NULL;
+	int fence_fd = -1;
+	signed int enq = 0;
 
 	if (pFile->private_data == NULL) {
 		LOG_WRN(
@@ -2933,6 +3003,9 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 			}
 			break;
 		}
+	case MFB_MSS_FENCE_ENQUE_REQ:
+		ufence = &((struct MFB_MSSFenceRequest __user *)Param)->fence;
+		fallthrough;
 	case MFB_MSS_ENQUE_REQ:
 		{
 		if (copy_from_user(&mfb_MssReq, (void *)Param,
@@ -2984,16 +3057,34 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 									&reqs);
 			pUserInfo->reqs = reqs;
 
+			if (ufence) {
+				Ret = mfb_fence_prepare(reqs, ufence, &in_fence,
+						&out_fence, &sync, &fence_fd);
+				if (Ret) {
+					mutex_unlock(&gMfbMssMutex);
+					goto EXIT;
+				}
+			}
+
 			spin_lock_irqsave(
 				&(MFBInfo.SpinLockIrq[MFB_IRQ_TYPE_INT_MSS_ST]),
 				flags);
 			kMssReq.m_ReqNum = mfb_MssReq.m_ReqNum;
 			kMssReq.m_pMssConfig = msscfgs;
-			mfb_enque_request(reqs, kMssReq.m_ReqNum, &kMssReq,
-								pUserInfo->Pid);
+			enq = mfb_enque_request_fence(reqs, kMssReq.m_ReqNum,
+					&kMssReq, pUserInfo->Pid,
+					in_fence, out_fence);
 			spin_unlock_irqrestore(
 				&(MFBInfo.SpinLockIrq[MFB_IRQ_TYPE_INT_MSS_ST]),
 				flags);
+			if (ufence) {
+				if (enq < 0) {
+					mfb_fence_abort(in_fence, out_fence,
+							sync, fence_fd);
+					Ret = -EBUSY;
+				} else
+					mfb_fence_commit(sync, fence_fd);
+			}
 			LOG_DBG("ConfigMSS Request!!\n");
 			if (!mfb_request_running(reqs)) {
 				LOG_DBG("direct mfb_request_handler\n");
@@ -3060,6 +3151,9 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 			}
 			break;
 		}
+	case MFB_MSF_FENCE_ENQUE_REQ:
+		ufence = &((struct MFB_MSFFenceRequest __user *)Param)->fence;
+		fallthrough;
 	case MFB_MSF_ENQUE_REQ:
 		{
 		if (copy_from_user(&mfb_MsfReq, (void *)Param,
@@ -3095,6 +3189,13 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 			msf_get_reqs(mfb_MsfReq.exec, &reqs);
 			pUserInfo->reqs = reqs;
 
+			if (ufence) {
+				Ret = mfb_fence_prepare(reqs, ufence, &in_fence,
+						&out_fence, &sync, &fence_fd);
+				if (Ret)
+					goto EXIT;
+			}
+
 			/* Protect the Multi Process */
 			mutex_lock(&gMfbMsfMutex);
 
@@ -3104,12 +3205,21 @@ static long MFB_ioctl(struct file *pFile, unsigned int Cmd, unsigned long Param)
 			kMsfReq.m_ReqNum = mfb_MsfReq.m_ReqNum;
 			kMsfReq.m_pMsfConfig =
 				g_MsfEnqueReq_Struct.MsfFrameConfig;
-			mfb_enque_request(reqs,
+			enq = mfb_enque_request_fence(reqs,
 				kMsfReq.m_ReqNum,
-				&kMsfReq, pUserInfo->Pid);
+				&kMsfReq, pUserInfo->Pid,
+				in_fence, out_fence);
 			spin_unlock_irqrestore(
 				&(MFBInfo.SpinLockIrq[MFB_IRQ_TYPE_INT_MSF_ST]),
 				flags);
+			if (ufence) {
+				if (enq < 0) {
+					mfb_fence_abort(in_fence, out_fence,
+							sync, fence_fd);
+					Ret = -EBUSY;
+				} else
+					mfb_fence_commit(sync, fence_fd);
+			}
 
 			LOG_DBG("ConfigMSF Request!!\n");
 			if (!mfb_request_running(reqs)) {
@@ -3750,13 +3860,21 @@ static signed int MFB_open(struct inode *pInode, struct file *pFile)
 
 		mfb_register_requests(&mss_reqs, sizeof(struct MFB_MSSConfig));
 		mfb_set_engine_ops(&mss_reqs, &mss_ops);
+		mfb_set_engine_work(&mss_reqs, MFBInfo.wkqueueMss,
+						&MFBInfo.ScheduleMssWork);
 		mfb_register_requests(&vmss_reqs, sizeof(struct MFB_MSSConfig));
 		mfb_set_engine_ops(&vmss_reqs, &vmss_ops);
+		mfb_set_engine_work(&vmss_reqs, MFBInfo.wkqueueMss,
+						&MFBInfo.vmsswork);
 
 		mfb_register_requests(&msf_reqs, sizeof(struct MFB_MSFConfig));
 		mfb_set_engine_ops(&msf_reqs, &msf_ops);
+		mfb_set_engine_work(&msf_reqs, MFBInfo.wkqueueMsf,
+						&MFBInfo.ScheduleMsfWork);
 		mfb_register_requests(&vmsf_reqs, sizeof(struct MFB_MSFConfig));
 		mfb_set_engine_ops(&vmsf_reqs, &vmsf_ops);
+		mfb_set_engine_work(&vmsf_reqs, MFBInfo.wkqueueMsf,
+						&MFBInfo.vmsfwork);
 
 #ifdef MFB_PMQOS
 		qos_total = 0;
@@ -344,6 +344,8 @@ enum MFB_CMD_ENUM {
 	MFB_CMD_MSF_DEQUE_REQ,	/* MSF Deque Request */
 	MFB_CMD_MAP,	/* MFB MAP */
 	MFB_CMD_UNMAP,	/* MFB UNMAP */
+	MFB_CMD_MSS_FENCE_ENQUE_REQ,	/* MSS Enque Request with fences */
+	MFB_CMD_MSF_FENCE_ENQUE_REQ,	/* MSF Enque Request with fences */
 	MFB_CMD_TOTAL,
 };
 
@@ -395,6 +397,26 @@ struct MFB_MSFRequest {
 	enum exec_mode exec;
 };
 
+/*
+ * Fence based enque: the request only starts once the in_fence sync_file
+ * signaled (-1 for none) and out_fence returns a sync_file which signals
+ * when the request finished, so the following DEQUE_REQ never waits.
+ */
+struct MFB_FENCE_STRUCT {
+	int in_fence;
+	int out_fence;
+};
+
+struct MFB_MSSFenceRequest {
+	struct MFB_MSSRequest req; /* must stay first */
+	struct MFB_FENCE_STRUCT fence;
+};
+
+struct MFB_MSFFenceRequest {
+	struct MFB_MSFRequest req; /* must stay first */
+	struct MFB_FENCE_STRUCT fence;
+};
+
 #ifdef CONFIG_COMPAT
 struct compat_MFB_REG_IO_STRUCT {
 	compat_uptr_t pData;
@@ -452,6 +474,12 @@ struct MFB_MapTable {
 	_IOWR(MFB_MAGIC, MFB_CMD_MSF_ENQUE_REQ, struct MFB_MSFRequest)
 #define MFB_MSF_DEQUE_REQ \
 	_IOWR(MFB_MAGIC, MFB_CMD_MSF_DEQUE_REQ, struct MFB_MSFRequest)
+#define MFB_MSS_FENCE_ENQUE_REQ \
+	_IOWR(MFB_MAGIC, MFB_CMD_MSS_FENCE_ENQUE_REQ, \
+					struct MFB_MSSFenceRequest)
+#define MFB_MSF_FENCE_ENQUE_REQ \
+	_IOWR(MFB_MAGIC, MFB_CMD_MSF_FENCE_ENQUE_REQ, \
+					struct MFB_MSFFenceRequest)
 
 #define MFB_MAP \
 	_IOWR(MFB_MAGIC, MFB_CMD_MAP, struct MFB_MapTable)
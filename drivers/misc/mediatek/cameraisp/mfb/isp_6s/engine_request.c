@@ -11,6 +11,7 @@
 #include <linux/module.h>
 #include <linux/seqlock.h>
 #include <linux/irqflags.h>
+#include <linux/slab.h>
 #include "engine_request.h"
 
 /*
@@ -110,9 +111,95 @@ signed int mfb_init_request(struct request_mfb *req)
 
 	req->pending_run = false;
 
+	req->in_fence = NULL;
+	req->out_fence = NULL;
+
 	return 0;
 }
 
+/*
+ * request fences
+ */
+static const char *mfb_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "mfb";
+}
+
+static const char *mfb_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "mfb_request";
+}
+
+static const struct dma_fence_ops mfb_fence_ops = {
+	.get_driver_name = mfb_fence_get_driver_name,
+	.get_timeline_name = mfb_fence_get_timeline_name,
+};
+
+/* seqno is assigned once the fence is enqued with a request */
+struct dma_fence *mfb_request_fence_create(struct engine_requests *eng)
+{
+	struct dma_fence *fence;
+
+	if (!eng)
+		return NULL;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return NULL;
+
+	dma_fence_init(fence, &mfb_fence_ops, &eng->fence_lock,
+						eng->fence_ctx, 0);
+
+	return fence;
+}
+EXPORT_SYMBOL(mfb_request_fence_create);
+
+static void mfb_request_in_fence_cb(struct dma_fence *fence,
+						struct dma_fence_cb *cb)
+{
+	struct request_mfb *req = container_of(cb, struct request_mfb, in_cb);
+	struct engine_requests *eng = req->eng;
+
+	LOG_DBG("[%s]in-fence signaled(%d)\n", __func__, fence->error);
+	if (eng->wq && eng->work)
+		queue_work(eng->wq, eng->work);
+}
+
+/* a pending request is held back until its in-fence signaled */
+static bool mfb_request_blocked(struct request_mfb *req)
+{
+	return req->in_fence && !dma_fence_is_signaled(req->in_fence);
+}
+
+/* request starts running, in-fence errors propagate to the out-fence */
+static void mfb_request_put_in_fence(struct request_mfb *req)
+{
+	if (!req->in_fence)
+		return;
+
+	if (req->in_fence->error && req->out_fence)
+		dma_fence_set_error(req->out_fence, req->in_fence->error);
+	dma_fence_put(req->in_fence);
+	req->in_fence = NULL;
+}
+
+static void mfb_request_signal(struct request_mfb *req, int error)
+{
+	if (req->in_fence) {
+		dma_fence_remove_callback(req->in_fence, &req->in_cb);
+		mfb_request_put_in_fence(req);
+	}
+
+	if (!req->out_fence)
+		return;
+
+	if (error)
+		dma_fence_set_error(req->out_fence, error);
+	dma_fence_signal(req->out_fence);
+	dma_fence_put(req->out_fence);
+	req->out_fence = NULL;
+}
+
 /*
  * per-frame data init
  */
@@ -158,8 +245,13 @@ signed int mfb_register_requests(struct engine_requests *eng, size_t size)
 	memset(_data, 0x0, len);
 	LOG_INF("[%s]Engine struct total size is %zu", __func__, len);
 
+	eng->fence_ctx = dma_fence_context_alloc(1);
+	eng->fence_seqno = 0;
+	spin_lock_init(&eng->fence_lock);
+
 	for (r = 0; r < MFB_MAX_REQUEST_SIZE_PER_ENGINE; r++) {
 		mfb_init_request(&eng->reqs[r]);
+		eng->reqs[r].eng = eng;
 
 		for (f = 0; f < MFB_MAX_FRAMES_PER_REQUEST; f++) {
 			d = (r * MFB_MAX_FRAMES_PER_REQUEST + f) * size;
@@ -192,6 +284,7 @@ signed int mfb_unregister_requests(struct engine_requests *eng)
 	vfree(eng->reqs[0].frames[0].data);
 
 	for (r = 0; r < MFB_MAX_REQUEST_SIZE_PER_ENGINE; r++) {
+		mfb_request_signal(&eng->reqs[r], -ECANCELED);
 		mfb_init_request(&eng->reqs[r]);
 
 		for (f = 0; f < MFB_MAX_FRAMES_PER_REQUEST; f++)
@@ -221,6 +314,20 @@ int mfb_set_engine_ops(struct engine_requests *eng,
 }
 EXPORT_SYMBOL(mfb_set_engine_ops);
 
+/* work which runs mfb_request_handler() once an in-fence signaled */
+int mfb_set_engine_work(struct engine_requests *eng,
+	struct workqueue_struct *wq, struct work_struct *work)
+{
+	if (!eng || !wq || !work)
+		return -1;
+
+	eng->wq = wq;
+	eng->work = work;
+
+	return 0;
+}
+EXPORT_SYMBOL(mfb_set_engine_work);
+
 bool mfb_request_running(struct engine_requests *eng)
 {
 	unsigned int seq;
@@ -242,6 +349,19 @@ EXPORT_SYMBOL(mfb_request_running);
 /*TODO: called in ENQUE_REQ */
 signed int mfb_enque_request(struct engine_requests *eng, unsigned int fcnt,
 						void *req, pid_t pid)
+{
+	return mfb_enque_request_fence(eng, fcnt, req, pid, NULL, NULL);
+}
+EXPORT_SYMBOL(mfb_enque_request);
+
+/*
+ * The request takes over the fence references on success: it is not
+ * started before in_fence signaled and out_fence signals once the last
+ * frame finished. Either fence may be NULL.
+ */
+signed int mfb_enque_request_fence(struct engine_requests *eng,
+	unsigned int fcnt, void *req, pid_t pid,
+	struct dma_fence *in_fence, struct dma_fence *out_fence)
 {
 	unsigned int r;
 	unsigned int f;
@@ -276,6 +396,15 @@ signed int mfb_enque_request(struct engine_requests *eng, unsigned int fcnt,
 
 	eng->reqs[r].pid = pid;
 
+	if (out_fence)
+		out_fence->seqno = ++eng->fence_seqno;
+	eng->reqs[r].out_fence = out_fence;
+	eng->reqs[r].in_fence = in_fence;
+	/* -ENOENT: already signaled, in_cb is left unlinked */
+	if (in_fence)
+		dma_fence_add_callback(in_fence, &eng->reqs[r].in_cb,
+						mfb_request_in_fence_cb);
+
 	eng->reqs[r].fctl.wcnt = fcnt;
 	eng->reqs[r].fctl.size = fcnt;
 
@@ -302,7 +431,7 @@ signed int mfb_enque_request(struct engine_requests *eng, unsigned int fcnt,
 ERROR:
 	return -1;
 }
-EXPORT_SYMBOL(mfb_enque_request);
+EXPORT_SYMBOL(mfb_enque_request_fence);
 
 /* ConfigWMFERequest / ConfigOCCRequest abstraction
  * TODO: locking should be here NOT camera_owe.c
@@ -339,7 +468,8 @@ signed int mfb_request_handler(struct engine_requests *eng, spinlock_t *lock)
 	rstate = eng->reqs[r].state;
 #if REQUEST_REGULATION
 	(void) fn;
-	if (rstate != REQUEST_STATE_PENDING) {
+	if (rstate != REQUEST_STATE_PENDING ||
+				mfb_request_blocked(&eng->reqs[r])) {
 		LOG_DBG("[%s]No pending request(%d), state:%d\n", __func__,
 								r, rstate);
 		write_seqlock(&eng->seqlock);
@@ -356,6 +486,7 @@ signed int mfb_request_handler(struct engine_requests *eng, spinlock_t *lock)
 	}
 	/* running request contains all running frames */
 	eng->reqs[r].state = REQUEST_STATE_RUNNING;
+	mfb_request_put_in_fence(&eng->reqs[r]);
 
 	for (f = 0; f < MFB_MAX_FRAMES_PER_REQUEST; f++) {
 		fstate = eng->reqs[r].frames[f].state;
@@ -381,7 +512,8 @@ signed int mfb_request_handler(struct engine_requests *eng, spinlock_t *lock)
 	 * frame-based reguest handling should be used instead.
 	 */
 	if (eng->reqs[r].pending_run == false) {
-		if (rstate != REQUEST_STATE_PENDING) {
+		if (rstate != REQUEST_STATE_PENDING ||
+				mfb_request_blocked(&eng->reqs[r])) {
 			LOG_DBG("[%s]No pending request(%d), state:%d\n",
 							__func__, r, rstate);
 			write_seqlock(&eng->seqlock);
@@ -398,6 +530,7 @@ signed int mfb_request_handler(struct engine_requests *eng, spinlock_t *lock)
 		}
 		eng->reqs[r].pending_run = true;
 		eng->reqs[r].state = REQUEST_STATE_RUNNING;
+		mfb_request_put_in_fence(&eng->reqs[r]);
 	} else
 		if (rstate != REQUEST_STATE_RUNNING) {
 			LOG_WRN(
@@ -521,6 +654,7 @@ int mfb_update_request(struct engine_requests *eng, pid_t *pid)
 			(*pid) = eng->reqs[i].pid;
 
 			eng->reqs[i].state = REQUEST_STATE_FINISHED;
+			mfb_request_signal(&eng->reqs[i], 0);
 			eng->req_ctl.icnt = (eng->req_ctl.icnt + 1) %
 						MFB_MAX_REQUEST_SIZE_PER_ENGINE;
 		} else {
@@ -4,6 +4,8 @@
  */
 
 #include <linux/completion.h>
+#include <linux/dma-fence.h>
+#include <linux/workqueue.h>
 
 #ifndef _ENGINE_REQUESTS_H_
 #define _ENGINE_REQUESTS_H_
@@ -46,12 +48,19 @@ struct frame {
 	void *data; /* points to engine data */
 };
 
+struct engine_requests;
+
 struct request_mfb {
 	enum REQUEST_STATE_ENUM state;
 	pid_t pid;
 	struct ring_ctrl fctl;
 	struct frame frames[MFB_MAX_FRAMES_PER_REQUEST];
 	bool pending_run; /* pending frame in a running request */
+
+	struct engine_requests *eng;
+	struct dma_fence *in_fence; /* request is held until signaled */
+	struct dma_fence_cb in_cb;
+	struct dma_fence *out_fence; /* signaled when request finished */
 };
 
 struct engine_ops {
@@ -69,6 +78,13 @@ struct engine_requests {
 
 	bool req_running;
 	seqlock_t seqlock;
+
+	/* out-fence timeline, in-fences kick work on wq */
+	u64 fence_ctx;
+	unsigned int fence_seqno;
+	spinlock_t fence_lock;
+	struct workqueue_struct *wq;
+	struct work_struct *work;
 };
 
 signed int mfb_init_ring_ctl(struct ring_ctrl *rctl);
@@ -82,9 +98,15 @@ signed int mfb_request_handler(struct engine_requests *eng, spinlock_t *lock);
 /*TODO: APIs to manipulate requests  */
 int mfb_set_engine_ops(struct engine_requests *eng,
 	const struct engine_ops *ops);
+int mfb_set_engine_work(struct engine_requests *eng,
+	struct workqueue_struct *wq, struct work_struct *work);
+struct dma_fence *mfb_request_fence_create(struct engine_requests *eng);
 
 signed int mfb_enque_request(struct engine_requests *eng, unsigned int fcnt,
 							void *req, pid_t pid);
+signed int mfb_enque_request_fence(struct engine_requests *eng,
+	unsigned int fcnt, void *req, pid_t pid,
+	struct dma_fence *in_fence, struct dma_fence *out_fence);
 signed int mfb_deque_request(struct engine_requests *eng, unsigned int *fcnt,
 								void *req);
 int mfb_update_request(struct engine_requests *eng, pid_t *pid);
@@ -38,6 +38,7 @@
 #include <linux/debugfs.h>
 #include <linux/preempt.h>
 #include <linux/stacktrace.h>
+#include <linux/smp.h>
 #include "ccmni.h"
 #include "ccci_debug.h"
 #include "rps_perf.h"
@@ -108,14 +109,169 @@ void set_ccmni_rps(unsigned long value)
 	int i = 0;
 	struct ccmni_ctl_block *ctlb = ccmni_ctl_blk[0];
 
+	/* value is the CPU set rps_perf balances the map within */
 	for (i = 0; i < ctlb->ccci_ops->ccmni_num; i++)
-		set_rps_map(ctlb->ccmni_inst[i]->dev->_rx, value);
+		rps_perf_dyn_set(ctlb->ccmni_inst[i]->dev, value);
 }
 EXPORT_SYMBOL(set_ccmni_rps);
 
+#ifdef ENABLE_WQ_GRO
+/* CPUs the RX queues are pinned to, in queue order */
+static unsigned long ccmni_rxq_cpus = 0xF0;
+module_param(ccmni_rxq_cpus, ulong, 0644);
+
+/* RX queues used at or above each downlink speed (bps) */
+static const struct {
+	u64 speed;
+	unsigned int rxq_num;
+} ccmni_rxq_class[] = {
+	{ 2000000000ULL, 4 },
+	{ 1000000000ULL, 2 },
+	{ 0, 1 },
+};
+
+/* a single queue means the legacy ccmni->napi path */
+static unsigned int ccmni_rxq_num = 1;
+static unsigned int ccmni_rxq_want = 1;
+static int ccmni_rxq_cpu[CCMNI_RXQ_MAX];
+
+/* bit in ccmni_rxq.state: the queue's NAPI is scheduled or about to be */
+#define CCMNI_RXQ_SCHED		0
+
+static void ccmni_rxq_update(struct work_struct *work)
+{
+	unsigned long mask = READ_ONCE(ccmni_rxq_cpus);
+	unsigned int want = READ_ONCE(ccmni_rxq_want);
+	unsigned int num = 0, old;
+	int cpu;
+
+	for_each_set_bit(cpu, &mask, min_t(int, nr_cpu_ids, BITS_PER_LONG)) {
+		if (num == want)
+			break;
+		if (cpu_online(cpu))
+			WRITE_ONCE(ccmni_rxq_cpu[num++], cpu);
+	}
+
+	old = ccmni_rxq_num;
+	WRITE_ONCE(ccmni_rxq_num, max(num, 1U));
+	CCMNI_INF_MSG(0, "rxq: %u -> %u queues, cpus 0x%lx\n",
+		old, ccmni_rxq_num, mask);
+
+	/* RPS on top of the RX queues would only move packets again */
+	if (ccmni_ctl_blk[0] && (old > 1) != (ccmni_rxq_num > 1))
+		set_ccmni_rps(ccmni_rxq_num > 1 ? 0 : 0x70);
+}
+static DECLARE_WORK(ccmni_rxq_work, ccmni_rxq_update);
+
+static void ccmni_rxq_kick(void *info)
+{
+	struct ccmni_rxq *rxq = info;
+
+	napi_schedule(&rxq->napi);
+}
+
+static int ccmni_rxq_poll(struct napi_struct *napi, int budget)
+{
+	struct ccmni_rxq *rxq = container_of(napi, struct ccmni_rxq, napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget && (skb = skb_dequeue(&rxq->skb_list))) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget && napi_complete_done(napi, work)) {
+		clear_bit(CCMNI_RXQ_SCHED, &rxq->state);
+		smp_mb__after_atomic();
+		/* catch a packet queued after the last dequeue */
+		if (!skb_queue_empty(&rxq->skb_list) &&
+		    !test_and_set_bit(CCMNI_RXQ_SCHED, &rxq->state))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+
+/* called in process context, as ccmni_rx_callback() is with WQ GRO */
+static void ccmni_rxq_rx(struct ccmni_instance *ccmni, struct sk_buff *skb,
+	unsigned int num)
+{
+	unsigned int idx = reciprocal_scale(skb_get_hash(skb), num);
+	struct ccmni_rxq *rxq = &ccmni->rxq[idx];
+	int cpu = READ_ONCE(ccmni_rxq_cpu[idx]);
+
+	skb_queue_tail(&rxq->skb_list, skb);
+	if (test_and_set_bit(CCMNI_RXQ_SCHED, &rxq->state))
+		return;
+
+	preempt_disable();
+	if (cpu != smp_processor_id() && cpu_online(cpu) &&
+	    !smp_call_function_single_async(cpu, &rxq->csd)) {
+		preempt_enable();
+		return;
+	}
+	preempt_enable();
+
+	local_bh_disable();
+	napi_schedule(&rxq->napi);
+	local_bh_enable();
+}
+
+static void ccmni_rxq_init(struct ccmni_instance *ccmni,
+	struct net_device *dev)
+{
+	struct ccmni_rxq *rxq;
+	int i;
+
+	/* optional, the legacy path is used if this fails */
+	ccmni->rxq = kcalloc(CCMNI_RXQ_MAX, sizeof(*rxq), GFP_KERNEL);
+	if (!ccmni->rxq)
+		return;
+
+	for (i = 0; i < CCMNI_RXQ_MAX; i++) {
+		rxq = &ccmni->rxq[i];
+		skb_queue_head_init(&rxq->skb_list);
+		rxq->csd.func = ccmni_rxq_kick;
+		rxq->csd.info = rxq;
+		netif_napi_add(dev, &rxq->napi, ccmni_rxq_poll,
+			NAPI_POLL_WEIGHT);
+	}
+}
+
+static void ccmni_rxq_enable(struct ccmni_instance *ccmni, bool enable)
+{
+	struct ccmni_rxq *rxq;
+	int i;
+
+	if (!ccmni->rxq)
+		return;
+
+	for (i = 0; i < CCMNI_RXQ_MAX; i++) {
+		rxq = &ccmni->rxq[i];
+		if (enable) {
+			clear_bit(CCMNI_RXQ_SCHED, &rxq->state);
+			napi_enable(&rxq->napi);
+		} else {
+			napi_disable(&rxq->napi);
+			skb_queue_purge(&rxq->skb_list);
+		}
+	}
+}
+#endif
 
 void ccmni_set_cur_speed(u64 cur_dl_speed)
 {
+#ifdef ENABLE_WQ_GRO
+	int i;
+
+	for (i = 0; cur_dl_speed < ccmni_rxq_class[i].speed; i++)
+		;
+	if (ccmni_rxq_class[i].rxq_num != READ_ONCE(ccmni_rxq_want)) {
+		WRITE_ONCE(ccmni_rxq_want, ccmni_rxq_class[i].rxq_num);
+		schedule_work(&ccmni_rxq_work);
+	}
+#endif
 	g_cur_dl_speed = cur_dl_speed;
 }
 EXPORT_SYMBOL(ccmni_set_cur_speed);
@@ -298,11 +454,8 @@ void ccmni_clr_flush_timer(void)
 }
 EXPORT_SYMBOL(ccmni_clr_flush_timer);
 
-static inline void napi_gro_list_flush(struct ccmni_instance *ccmni)
+static inline void __napi_gro_list_flush(struct napi_struct *napi)
 {
-	struct napi_struct *napi;
-
-	napi = ccmni->napi;
 	napi_gro_flush(napi, false);
 	if (napi->rx_count) {
 		netif_receive_skb_list(&napi->rx_list);
@@ -311,6 +464,15 @@ static inline void napi_gro_list_flush(struct ccmni_instance *ccmni)
 	}
 }
 
+static inline void napi_gro_list_flush(struct ccmni_instance *ccmni)
+{
+	__napi_gro_list_flush(ccmni->napi);
+	if (ccmni->gro) {
+		ccmni->gro->deadline = 0;
+		hrtimer_try_to_cancel(&ccmni->gro->timer);
+	}
+}
+
 static void ccmni_gro_flush(struct ccmni_instance *ccmni)
 {
 	struct timespec64 curr_time, diff;
@@ -326,6 +488,109 @@ static void ccmni_gro_flush(struct ccmni_instance *ccmni)
 		ktime_get_real_ts64(&ccmni->flush_time);
 	}
 }
+
+/* 0: fixed gro_flush_timer policy above */
+static bool gro_adaptive = true;
+module_param(gro_adaptive, bool, 0644);
+
+/* flows below this average length are flushed at once (games, ACKs) */
+#define CCMNI_GRO_SMALL_LEN	256
+/* flows of full-sized packets arriving this fast are bulk downloads */
+#define CCMNI_GRO_BULK_LEN	1000
+#define CCMNI_GRO_BULK_GAP_NS	50000
+/* a flow idle for this long starts its estimate over */
+#define CCMNI_GRO_IDLE_NS	100000000ULL
+
+static enum hrtimer_restart ccmni_gro_timer_fn(struct hrtimer *timer)
+{
+	struct ccmni_gro_ctl *gro =
+		container_of(timer, struct ccmni_gro_ctl, timer);
+
+	/* soft hrtimer, i.e. already in softirq like spin_lock_bh users */
+	spin_lock(gro->spinlock);
+	if (gro->deadline) {
+		__napi_gro_list_flush(gro->napi);
+		gro->deadline = 0;
+		gro->timer_flush_cnt++;
+	}
+	spin_unlock(gro->spinlock);
+
+	return HRTIMER_NORESTART;
+}
+
+static void ccmni_gro_init(struct ccmni_instance *ccmni)
+{
+	/* optional, ccmni_gro_flush() is used if this fails */
+	ccmni->gro = kzalloc(sizeof(*ccmni->gro), GFP_KERNEL);
+	if (!ccmni->gro)
+		return;
+
+	hrtimer_init(&ccmni->gro->timer, CLOCK_MONOTONIC,
+		HRTIMER_MODE_REL_SOFT);
+	ccmni->gro->timer.function = ccmni_gro_timer_fn;
+	ccmni->gro->napi = ccmni->napi;
+	ccmni->gro->spinlock = ccmni->spinlock;
+}
+
+/*
+ * Returns how long (ns) the packet of @hash and @len may be held in GRO,
+ * from its flow's history: 0 for small-packet flows, twice
+ * gro_flush_timer for bulk ones.
+ */
+static u64 ccmni_gro_hold_ns(struct ccmni_gro_ctl *gro, u32 hash, u32 len,
+	u64 now)
+{
+	struct ccmni_gro_flow *flow = &gro->flows[hash % CCMNI_GRO_FLOWS];
+	u64 gap;
+
+	gap = now - flow->last_ns;
+	if (flow->hash != hash || gap > CCMNI_GRO_IDLE_NS) {
+		flow->hash = hash;
+		flow->len = len;
+		flow->gap_ns = CCMNI_GRO_IDLE_NS;
+	} else {
+		flow->len = (flow->len * 7 + len) >> 3;
+		flow->gap_ns = (flow->gap_ns * 7ULL + gap) >> 3;
+	}
+	flow->last_ns = now;
+
+	if (flow->len < CCMNI_GRO_SMALL_LEN)
+		return 0;
+	if (flow->len >= CCMNI_GRO_BULK_LEN &&
+	    flow->gap_ns < CCMNI_GRO_BULK_GAP_NS)
+		return gro_flush_timer * 2;
+	return gro_flush_timer;
+}
+
+/* caller holds ccmni->spinlock and has just passed the skb to GRO */
+static void ccmni_gro_flush_adaptive(struct ccmni_instance *ccmni,
+	u32 hash, u32 len)
+{
+	struct ccmni_gro_ctl *gro = ccmni->gro;
+	u64 now = ktime_get_ns();
+	u64 deadline = now + ccmni_gro_hold_ns(gro, hash, len, now);
+
+	if (deadline <= now || (gro->deadline && gro->deadline <= now)) {
+		napi_gro_list_flush(ccmni);
+		gro->now_flush_cnt++;
+		return;
+	}
+
+	if (!gro->deadline || deadline < gro->deadline) {
+		gro->deadline = deadline;
+		hrtimer_start(&gro->timer, ns_to_ktime(deadline - now),
+			HRTIMER_MODE_REL_SOFT);
+	}
+}
+
+/* end of a HIF RX batch: keep bulk aggregates open until their deadline */
+static bool ccmni_gro_batch_hold(struct ccmni_instance *ccmni)
+{
+	struct ccmni_gro_ctl *gro = ccmni->gro;
+
+	return gro_adaptive && gro && gro->deadline &&
+		gro->deadline > ktime_get_ns();
+}
 #endif
 
 static inline int ccmni_forward_rx(struct ccmni_instance *ccmni,
@@ -498,6 +763,9 @@ static int ccmni_open(struct net_device *dev)
 		napi_enable(ccmni->napi);
 		napi_schedule(ccmni->napi);
 	}
+#ifdef ENABLE_WQ_GRO
+	ccmni_rxq_enable(ccmni, true);
+#endif
 
 	atomic_inc(&ccmni->usage);
 	ccmni_tmp = ccmni_ctl->ccmni_inst[ccmni->index];
@@ -557,6 +825,11 @@ static int ccmni_close(struct net_device *dev)
 
 	if (unlikely(ccmni_ctl->ccci_ops->md_ability & MODEM_CAP_NAPI))
 		napi_disable(ccmni->napi);
+#ifdef ENABLE_WQ_GRO
+	ccmni_rxq_enable(ccmni, false);
+	if (ccmni->gro)
+		hrtimer_cancel(&ccmni->gro->timer);
+#endif
 
 	ret = ccmni_ctl->ccci_ops->ccci_handle_port_list(DEV_CLOSE, dev->name);
 	CCMNI_INF_MSG(ccmni->md_id, "%s_Close:cnt=(%d, %d)\n",
@@ -1145,9 +1418,12 @@ static inline int ccmni_inst_init(int md_id, struct ccmni_instance *ccmni,
 			ctlb->ccci_ops->napi_poll_weigh);
 	}
 #ifdef ENABLE_WQ_GRO
-	if (dev)
+	if (dev) {
 		netif_napi_add(dev, ccmni->napi, ccmni_napi_poll,
 			ctlb->ccci_ops->napi_poll_weigh);
+		ccmni_rxq_init(ccmni, dev);
+		ccmni_gro_init(ccmni);
+	}
 #endif
 
 	atomic_set(&ccmni->usage, 0);
@@ -1492,6 +1768,23 @@ static void ccmni_exit(int md_id)
 	}
 }
 
+static inline void ccmni_rx_set_header(struct net_device *dev,
+	struct sk_buff *skb)
+{
+	int pkt_type = skb->data[0] & 0xF0;
+
+	skb_reset_transport_header(skb);
+	skb_reset_network_header(skb);
+	skb_set_mac_header(skb, 0);
+	skb_reset_mac_len(skb);
+
+	skb->dev = dev;
+	if (pkt_type == 0x60)
+		skb->protocol  = htons(ETH_P_IPV6);
+	else
+		skb->protocol  = htons(ETH_P_IP);
+}
+
 static int ccmni_rx_callback(int md_id, int ccmni_idx, struct sk_buff *skb,
 		void *priv_data)
 {
@@ -1499,7 +1792,10 @@ static int ccmni_rx_callback(int md_id, int ccmni_idx, struct sk_buff *skb,
 	/* struct ccci_header *ccci_h = (struct ccci_header*)skb->data; */
 	struct ccmni_instance *ccmni = NULL;
 	struct net_device *dev = NULL;
-	int pkt_type, skb_len;
+	int skb_len;
+#ifdef ENABLE_WQ_GRO
+	unsigned int rxq_num;
+#endif
 #if defined(CCCI_SKB_TRACE)
 	struct iphdr *iph;
 #endif
@@ -1525,18 +1821,7 @@ static int ccmni_rx_callback(int md_id, int ccmni_idx, struct sk_buff *skb,
 	ccmni = ctlb->ccmni_inst[ccmni_idx];
 	dev = ccmni->dev;
 
-	pkt_type = skb->data[0] & 0xF0;
-
-	skb_reset_transport_header(skb);
-	skb_reset_network_header(skb);
-	skb_set_mac_header(skb, 0);
-	skb_reset_mac_len(skb);
-
-	skb->dev = dev;
-	if (pkt_type == 0x60)
-		skb->protocol  = htons(ETH_P_IPV6);
-	else
-		skb->protocol  = htons(ETH_P_IP);
+	ccmni_rx_set_header(dev, skb);
 
 	//skb->ip_summed = CHECKSUM_NONE;
 	skb_len = skb->len;
@@ -1560,11 +1845,19 @@ static int ccmni_rx_callback(int md_id, int ccmni_idx, struct sk_buff *skb,
 #endif
 	} else {
 #ifdef ENABLE_WQ_GRO
-		if (is_skb_gro(skb)) {
+		rxq_num = READ_ONCE(ccmni_rxq_num);
+		if (rxq_num > 1 && ccmni->rxq && netif_running(dev)) {
+			ccmni_rxq_rx(ccmni, skb, rxq_num);
+		} else if (is_skb_gro(skb)) {
+			u32 hash = skb_get_hash(skb);
+
 			preempt_disable();
 			spin_lock_bh(ccmni->spinlock);
 			napi_gro_receive(ccmni->napi, skb);
-			ccmni_gro_flush(ccmni);
+			if (gro_adaptive && ccmni->gro)
+				ccmni_gro_flush_adaptive(ccmni, hash, skb_len);
+			else
+				ccmni_gro_flush(ccmni);
 			spin_unlock_bh(ccmni->spinlock);
 			preempt_enable();
 		} else {
@@ -1600,6 +1893,124 @@ static int ccmni_rx_callback(int md_id, int ccmni_idx, struct sk_buff *skb,
 	return 0;
 }
 
+#ifdef ENABLE_WQ_GRO
+/*
+ * Stable insertion sort by flow hash, so packets of one flow stay in
+ * arrival order but end up next to each other for GRO and for the
+ * list receive path. Batches are bounded by CCMNI_RX_BATCH_MAX.
+ */
+static void ccmni_rx_sort_by_flow(struct sk_buff **skbs, int num)
+{
+	struct sk_buff *key;
+	int i, j;
+
+	for (i = 1; i < num; i++) {
+		key = skbs[i];
+		for (j = i - 1; j >= 0 && skbs[j]->hash > key->hash; j--)
+			skbs[j + 1] = skbs[j];
+		skbs[j + 1] = key;
+	}
+}
+
+static void ccmni_rx_list_deliver(struct ccmni_instance *ccmni,
+	struct sk_buff **skbs, int num)
+{
+	struct net_device *dev = ccmni->dev;
+	struct sk_buff *skb;
+	LIST_HEAD(rx_list);
+	u32 hash, len;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		ccmni_rx_set_header(dev, skbs[i]);
+		skb_get_hash(skbs[i]);
+		dev->stats.rx_packets++;
+		dev->stats.rx_bytes += skbs[i]->len;
+	}
+	ccmni_rx_sort_by_flow(skbs, num);
+
+	preempt_disable();
+	spin_lock_bh(ccmni->spinlock);
+	for (i = 0; i < num; i++) {
+		skb = skbs[i];
+		if (!is_skb_gro(skb)) {
+			list_add_tail(&skb->list, &rx_list);
+			continue;
+		}
+		hash = skb->hash;
+		len = skb->len;
+		napi_gro_receive(ccmni->napi, skb);
+		if (gro_adaptive && ccmni->gro)
+			ccmni_gro_flush_adaptive(ccmni, hash, len);
+		else
+			ccmni_gro_flush(ccmni);
+	}
+	spin_unlock_bh(ccmni->spinlock);
+
+	if (!list_empty(&rx_list)) {
+		local_bh_disable();
+		netif_receive_skb_list(&rx_list);
+		local_bh_enable();
+	}
+	preempt_enable();
+	ccmni->rx_list_cnt++;
+}
+#endif
+
+/*
+ * Deliver a batch of packets gathered by the HIF for one ccmni. With WQ
+ * GRO and a single RX queue, the batch is sorted by flow, fed to GRO
+ * under one lock hold and the rest handed to netif_receive_skb_list(),
+ * so the stack entry cost is paid once per batch rather than per packet.
+ * Every other configuration falls back to ccmni_rx_callback() per skb.
+ */
+static int ccmni_rx_list_callback(int md_id, int ccmni_idx,
+		struct sk_buff_head *list)
+{
+	struct ccmni_ctl_block *ctlb = NULL;
+	struct sk_buff *skb;
+#ifdef ENABLE_WQ_GRO
+	struct ccmni_instance *ccmni = NULL;
+	struct sk_buff *skbs[CCMNI_RX_BATCH_MAX];
+	int num;
+#endif
+
+	if (md_id < 0 || md_id >= MAX_MD_NUM || ccmni_idx < 0) {
+		CCMNI_INF_MSG(-1, "%s : invalid md_id or index:md_id = %d,index = %d\n",
+			__func__, md_id, ccmni_idx);
+		__skb_queue_purge(list);
+		return -1;
+	}
+	ctlb = ccmni_ctl_blk[md_id];
+	if (unlikely(ctlb == NULL || ctlb->ccci_ops == NULL)) {
+		CCMNI_PR_DBG(md_id,
+			"invalid CCMNI%d ctrl/ops struct\n",
+			ccmni_idx);
+		__skb_queue_purge(list);
+		return -1;
+	}
+
+#ifdef ENABLE_WQ_GRO
+	ccmni = ctlb->ccmni_inst[ccmni_idx];
+	if (!(ctlb->ccci_ops->md_ability & MODEM_CAP_NAPI) &&
+		READ_ONCE(ccmni_rxq_num) <= 1) {
+		while (!skb_queue_empty(list)) {
+			num = 0;
+			while (num < CCMNI_RX_BATCH_MAX &&
+				(skb = __skb_dequeue(list)) != NULL)
+				skbs[num++] = skb;
+			ccmni_rx_list_deliver(ccmni, skbs, num);
+		}
+		__pm_wakeup_event(ctlb->ccmni_wakelock, jiffies_to_msecs(HZ));
+		return 0;
+	}
+#endif
+	while ((skb = __skb_dequeue(list)) != NULL)
+		ccmni_rx_callback(md_id, ccmni_idx, skb, NULL);
+
+	return 0;
+}
+
 static void ccmni_queue_state_callback(int md_id, int ccmni_idx,
 	enum HIF_STATE state, int is_ack)
 {
@@ -1632,7 +2043,8 @@ static void ccmni_queue_state_callback(int md_id, int ccmni_idx,
 		preempt_disable();
 		spin_lock_bh(ccmni->spinlock);
 		ccmni->rx_gro_cnt++;
-		napi_gro_list_flush(ccmni);
+		if (!ccmni_gro_batch_hold(ccmni))
+			napi_gro_list_flush(ccmni);
 		spin_unlock_bh(ccmni->spinlock);
 		preempt_enable();
 		break;
@@ -1767,6 +2179,7 @@ static void ccmni_md_state_callback(int md_id, int ccmni_idx,
 		}
 		ccmni->rx_seq_num = 0;
 		ccmni->rx_gro_cnt = 0;
+		ccmni->rx_list_cnt = 0;
 		break;
 
 	case EXCEPTION:
@@ -1817,6 +2230,10 @@ static void ccmni_dump(int md_id, int ccmni_idx, unsigned int flag)
 	dev_queue = netdev_get_tx_queue(dev, 0);
 	CCMNI_INF_MSG(md_id, "to:clr(%lu:%lu)\r\n",
 		timeout_flush_num, clear_flush_num);
+	if (ccmni->gro)
+		CCMNI_INF_MSG(md_id, "gro now:timer(%lu:%lu)\r\n",
+			ccmni->gro->now_flush_cnt,
+			ccmni->gro->timer_flush_cnt);
 	if (ctlb->ccci_ops->md_ability & MODEM_CAP_CCMNI_MQ) {
 		ack_queue = netdev_get_tx_queue(dev, CCMNI_TXQ_FAST);
 		qdisc = dev_queue->qdisc;
@@ -1828,14 +2245,14 @@ static void ccmni_dump(int md_id, int ccmni_idx, unsigned int flag)
 		 * packets is count by qdisc in net device layer
 		 */
 		CCMNI_INF_MSG(md_id,
-			"%s(%d,%d), irat_MD%d, rx=(%ld,%ld,%d), tx=(%ld,%d,%lld), txq_len=(%d,%d), tx_drop=(%ld,%d,%d), rx_drop=(%ld,%ld), tx_busy=(%ld,%ld), sta=(0x%lx,0x%x,0x%lx,0x%lx)\n",
+			"%s(%d,%d), irat_MD%d, rx=(%ld,%ld,%d,%d), tx=(%ld,%d,%lld), txq_len=(%d,%d), tx_drop=(%ld,%d,%d), rx_drop=(%ld,%ld), tx_busy=(%ld,%ld), sta=(0x%lx,0x%x,0x%lx,0x%lx)\n",
 				  dev->name,
 				  atomic_read(&ccmni->usage),
 				  atomic_read(&ccmni_tmp->usage),
 				  (ccmni->md_id + 1),
 			      dev->stats.rx_packets,
 				  dev->stats.rx_bytes,
-				  ccmni->rx_gro_cnt,
+				  ccmni->rx_gro_cnt, ccmni->rx_list_cnt,
 			      dev->stats.tx_packets, qdisc->bstats.packets,
 				  ack_qdisc->bstats.packets,
 			      qdisc->q.qlen, ack_qdisc->q.qlen,
@@ -1848,12 +2265,12 @@ static void ccmni_dump(int md_id, int ccmni_idx, unsigned int flag)
 				  ack_queue->state);
 	} else
 		CCMNI_INF_MSG(md_id,
-			"%s(%d,%d), irat_MD%d, rx=(%ld,%ld,%d), tx=(%ld,%ld), txq_len=%d, tx_drop=(%ld,%d), rx_drop=(%ld,%ld), tx_busy=(%ld,%ld), sta=(0x%lx,0x%x,0x%lx)\n",
+			"%s(%d,%d), irat_MD%d, rx=(%ld,%ld,%d,%d), tx=(%ld,%ld), txq_len=%d, tx_drop=(%ld,%d), rx_drop=(%ld,%ld), tx_busy=(%ld,%ld), sta=(0x%lx,0x%x,0x%lx)\n",
 			      dev->name, atomic_read(&ccmni->usage),
 				  atomic_read(&ccmni_tmp->usage),
 						(ccmni->md_id + 1),
 			      dev->stats.rx_packets, dev->stats.rx_bytes,
-				  ccmni->rx_gro_cnt,
+				  ccmni->rx_gro_cnt, ccmni->rx_list_cnt,
 			      dev->stats.tx_packets, dev->stats.tx_bytes,
 			      dev->qdisc->q.qlen, dev->stats.tx_dropped,
 				  dev->qdisc->qstats.drops,
@@ -1903,6 +2320,7 @@ struct ccmni_dev_ops ccmni_ops = {
 	.skb_alloc_size = 1600,
 	.init = &ccmni_init,
 	.rx_callback = &ccmni_rx_callback,
+	.rx_list_callback = &ccmni_rx_list_callback,
 	.md_state_callback = &ccmni_md_state_callback,
 	.queue_state_callback = &ccmni_queue_state_callback,
 	.exit = ccmni_exit,
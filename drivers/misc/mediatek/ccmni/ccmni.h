@@ -20,6 +20,7 @@
 #include <linux/wait.h>
 #include <linux/dma-mapping.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 #include <linux/if_ether.h>
 #include <linux/bitops.h>
 #include <linux/dma-mapping.h>
@@ -67,6 +68,47 @@
 #define CCMNI_TX_MET_ID         0xF1000
 #endif
 
+/*
+ * multi-queue RX, ENABLE_WQ_GRO only: at high downlink speed, packets are
+ * hashed by flow into up to CCMNI_RXQ_MAX NAPI contexts, each scheduled
+ * on its own CPU, so GRO and the stack above run on several cores.
+ */
+#define  CCMNI_RXQ_MAX          4
+
+/* upper bound of one flow-sorted batch in ccmni_rx_list_callback() */
+#define  CCMNI_RX_BATCH_MAX     64
+
+struct ccmni_rxq {
+	struct napi_struct napi;
+	struct sk_buff_head skb_list;
+	call_single_data_t csd;
+	unsigned long      state;
+};
+
+/*
+ * adaptive GRO flush, ENABLE_WQ_GRO only: a per-flow estimate of packet
+ * size and inter-arrival time decides how long an aggregate may be held,
+ * across HIF RX_FLUSH batches, before a timer pushes it up the stack.
+ */
+#define  CCMNI_GRO_FLOWS        16
+
+struct ccmni_gro_flow {
+	u32                hash;
+	u32                gap_ns;	/* EWMA inter-arrival time */
+	u32                len;		/* EWMA packet length */
+	u64                last_ns;
+};
+
+struct ccmni_gro_ctl {
+	struct hrtimer     timer;
+	struct napi_struct *napi;
+	spinlock_t         *spinlock;
+	/* ktime by which held packets must be flushed, 0 if none held */
+	u64                deadline;
+	unsigned long      now_flush_cnt;
+	unsigned long      timer_flush_cnt;
+	struct ccmni_gro_flow flows[CCMNI_GRO_FLOWS];
+};
 
 struct ccmni_ch {
 	int		   rx;
@@ -117,6 +159,8 @@ struct ccmni_instance {
 	struct timer_list  *timer;
 	struct net_device  *dev;
 	struct napi_struct *napi;
+	struct ccmni_rxq   *rxq;
+	struct ccmni_gro_ctl *gro;
 	unsigned int       rx_seq_num;
 	unsigned int       tx_seq_num[2];
 	unsigned int       flags[2];
@@ -128,6 +172,7 @@ struct ccmni_instance {
 	unsigned int       tx_full_cnt[2];
 	unsigned int       tx_irq_cnt[2];
 	unsigned int       rx_gro_cnt;
+	unsigned int       rx_list_cnt;
 	unsigned int       flt_cnt;
 	struct ccmni_fwd_filter flt_tbl[CCMNI_FLT_NUM];
 #if defined(CCMNI_MET_DEBUG)
@@ -176,6 +221,9 @@ struct ccmni_dev_ops {
 	int  (*init)(int md_id, struct ccmni_ccci_ops *ccci_info);
 	int  (*rx_callback)(int md_id, int ccmni_idx,
 			struct sk_buff *skb, void *priv_data);
+	/* optional, batched delivery; consumes every skb on the list */
+	int  (*rx_list_callback)(int md_id, int ccmni_idx,
+			struct sk_buff_head *list);
 	void (*md_state_callback)(int md_id,
 		int ccmni_idx, enum MD_STATE state);
 	void (*queue_state_callback)(int md_id, int ccmni_idx,
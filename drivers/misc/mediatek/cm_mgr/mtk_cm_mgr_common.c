@@ -29,6 +29,9 @@
 #include <linux/suspend.h>
 #include <linux/topology.h>
 #include <linux/math64.h>
+#include <linux/cpufreq.h>
+#include <linux/perf_event.h>
+#include <linux/workqueue.h>
 
 #include <linux/pm_domain.h>
 #include <linux/of.h>
@@ -53,6 +56,7 @@
 
 static struct delayed_work cm_mgr_work;
 static int cm_mgr_cpu_to_dram_opp;
+static int cm_mgr_cpu_map_opp = -1;
 
 #if !IS_ENABLED(CONFIG_MTK_CM_IPI)
 /* FIXME: */
@@ -127,6 +131,14 @@ int cm_mgr_cpu_map_emi_opp = 1;
 int cm_mgr_cpu_map_skip_cpu_opp = 2;
 unsigned int cm_work_flag;
 
+/* adaptive cpu-to-dram coupling, thresholds may be tuned per platform */
+static int cm_mgr_adaptive_enable;
+static int cm_mgr_adaptive_stall_up = 400;	/* permille of cycles */
+static int cm_mgr_adaptive_stall_down = 150;	/* permille of cycles */
+static int cm_mgr_adaptive_miss_up = 8;	/* LLC read miss per kcycles */
+static int cm_mgr_adaptive_period_ms = 20;
+static int cm_mgr_adaptive_state;
+
 #if IS_ENABLED(CONFIG_MTK_CM_IPI)
 int get_cm_step_num(void)
 {
@@ -411,6 +423,198 @@ static void cm_mgr_add_cpu_opp_to_ddr_req(void)
 		cm_mgr_cpu_map_update_table();
 }
 
+/*
+ * Adaptive mode: the cpu opp table says how much DRAM a cluster could
+ * use at its current frequency, the PMU says whether it actually waits
+ * on memory. Backend stall cycles together with LLC read misses mark a
+ * memory bound phase, which gets one DRAM opp above the table; a phase
+ * with few stalls on every busy cluster gains nothing from DRAM and
+ * drops the vote.
+ */
+#define CM_MGR_ADAPTIVE_MIN_KCYCLES	1000
+
+struct cm_mgr_pmu_cpu {
+	struct perf_event *cycles;
+	struct perf_event *stall;
+	struct perf_event *miss;
+	u64 prev_cycles;
+	u64 prev_stall;
+	u64 prev_miss;
+};
+
+static DEFINE_PER_CPU(struct cm_mgr_pmu_cpu, cm_mgr_pmu);
+static void cm_mgr_adaptive_process(struct work_struct *work);
+static DECLARE_DELAYED_WORK(cm_mgr_adaptive_work, cm_mgr_adaptive_process);
+
+static struct perf_event_attr cm_mgr_pmu_attr = {
+	.type		= PERF_TYPE_RAW,
+	.size		= sizeof(struct perf_event_attr),
+	.pinned		= 1,
+};
+
+static struct perf_event *cm_mgr_pmu_create(int cpu, u64 config)
+{
+	struct perf_event_attr attr = cm_mgr_pmu_attr;
+	struct perf_event *event;
+
+	attr.config = config;
+	event = perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+	if (IS_ERR(event)) {
+		pr_info("[CM_MGR] create (%d) pmu 0x%llx error (%d)\n",
+				cpu, config, (int)PTR_ERR(event));
+		return NULL;
+	}
+	perf_event_enable(event);
+
+	return event;
+}
+
+static void cm_mgr_pmu_release(struct perf_event **event)
+{
+	if (*event) {
+		perf_event_disable(*event);
+		perf_event_release_kernel(*event);
+		*event = NULL;
+	}
+}
+
+static u64 cm_mgr_pmu_delta(struct perf_event *event, u64 *prev)
+{
+	u64 enabled, running, val, delta;
+
+	if (!event)
+		return 0;
+
+	val = perf_event_read_value(event, &enabled, &running);
+	delta = val - *prev;
+	*prev = val;
+
+	return delta;
+}
+
+/* 1: memory bound, -1: compute bound, 0: keep the table vote */
+static int cm_mgr_adaptive_classify(void)
+{
+	struct cpufreq_policy *policy;
+	struct cm_mgr_pmu_cpu *pc;
+	u64 cycles, stall, miss;
+	int cpu, sib;
+	int busy = 0, state = -1;
+
+	for_each_online_cpu(cpu) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		if (cpu != cpumask_first_and(policy->related_cpus,
+					cpu_online_mask)) {
+			cpufreq_cpu_put(policy);
+			continue;
+		}
+
+		cycles = stall = miss = 0;
+		for_each_cpu_and(sib, policy->related_cpus, cpu_online_mask) {
+			pc = &per_cpu(cm_mgr_pmu, sib);
+			cycles += cm_mgr_pmu_delta(pc->cycles,
+					&pc->prev_cycles);
+			stall += cm_mgr_pmu_delta(pc->stall, &pc->prev_stall);
+			miss += cm_mgr_pmu_delta(pc->miss, &pc->prev_miss);
+		}
+		cpufreq_cpu_put(policy);
+
+		/* an idle cluster says nothing about the workload */
+		if (cycles < CM_MGR_ADAPTIVE_MIN_KCYCLES * 1000)
+			continue;
+		busy = 1;
+
+		stall = div64_u64(stall * 1000, cycles);
+		miss = div64_u64(miss * 1000, cycles);
+		if (stall >= cm_mgr_adaptive_stall_up &&
+				miss >= cm_mgr_adaptive_miss_up)
+			state = 1;
+		else if (stall >= cm_mgr_adaptive_stall_down && state < 0)
+			state = 0;
+	}
+
+	return busy ? state : 0;
+}
+
+static int cm_mgr_adaptive_opp(int dram_opp)
+{
+	if (!cm_mgr_adaptive_enable)
+		return dram_opp;
+
+	if (cm_mgr_adaptive_state > 0 && dram_opp > 0)
+		return dram_opp - 1;
+	if (cm_mgr_adaptive_state < 0)
+		return cm_mgr_num_perf;
+
+	return dram_opp;
+}
+
+static void cm_mgr_adaptive_process(struct work_struct *work)
+{
+	int map_opp, dram_opp;
+
+	cm_mgr_adaptive_state = cm_mgr_adaptive_classify();
+
+	map_opp = cm_mgr_cpu_map_opp;
+	if (cm_work_flag && map_opp >= 0) {
+		dram_opp = cm_mgr_adaptive_opp(map_opp);
+		if (dram_opp != cm_mgr_cpu_to_dram_opp) {
+			cm_mgr_cpu_to_dram_opp = dram_opp;
+			schedule_delayed_work(&cm_mgr_work, 0);
+		}
+	}
+
+	if (cm_mgr_adaptive_enable)
+		schedule_delayed_work(&cm_mgr_adaptive_work,
+				msecs_to_jiffies(cm_mgr_adaptive_period_ms));
+}
+
+static void cm_mgr_adaptive_stop(void)
+{
+	struct cm_mgr_pmu_cpu *pc;
+	int cpu;
+
+	cm_mgr_adaptive_enable = 0;
+	cancel_delayed_work_sync(&cm_mgr_adaptive_work);
+	cm_mgr_adaptive_state = 0;
+
+	for_each_possible_cpu(cpu) {
+		pc = &per_cpu(cm_mgr_pmu, cpu);
+		cm_mgr_pmu_release(&pc->cycles);
+		cm_mgr_pmu_release(&pc->stall);
+		cm_mgr_pmu_release(&pc->miss);
+	}
+}
+
+static void cm_mgr_adaptive_start(void)
+{
+	struct cm_mgr_pmu_cpu *pc;
+	int cpu;
+
+	if (cm_mgr_adaptive_enable)
+		return;
+
+	/* counters follow the cpus online now, hotplugged cpus are skipped */
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		pc = &per_cpu(cm_mgr_pmu, cpu);
+		pc->cycles = cm_mgr_pmu_create(cpu,
+				ARMV8_PMUV3_PERFCTR_CPU_CYCLES);
+		pc->stall = cm_mgr_pmu_create(cpu,
+				ARMV8_PMUV3_PERFCTR_STALL_BACKEND);
+		pc->miss = cm_mgr_pmu_create(cpu,
+				ARMV8_PMUV3_PERFCTR_LL_CACHE_MISS_RD);
+		pc->prev_cycles = pc->prev_stall = pc->prev_miss = 0;
+	}
+	cpus_read_unlock();
+
+	cm_mgr_adaptive_enable = 1;
+	schedule_delayed_work(&cm_mgr_adaptive_work,
+			msecs_to_jiffies(cm_mgr_adaptive_period_ms));
+}
+
 static ssize_t dbg_cm_mgr_show(struct kobject *kobj,
 		struct kobj_attribute *attr, char *buff)
 {
@@ -448,6 +652,20 @@ static ssize_t dbg_cm_mgr_show(struct kobject *kobj,
 			len += cm_mgr_print(" %d", cm_mgr_cpu_opp_to_dram[i]);
 		len += cm_mgr_print("\n");
 	}
+	len += cm_mgr_print("cm_mgr_adaptive_enable %d\n",
+			cm_mgr_adaptive_enable);
+	if (cm_mgr_adaptive_enable) {
+		len += cm_mgr_print("cm_mgr_adaptive_state %d\n",
+				cm_mgr_adaptive_state);
+		len += cm_mgr_print("cm_mgr_adaptive_stall_up %d\n",
+				cm_mgr_adaptive_stall_up);
+		len += cm_mgr_print("cm_mgr_adaptive_stall_down %d\n",
+				cm_mgr_adaptive_stall_down);
+		len += cm_mgr_print("cm_mgr_adaptive_miss_up %d\n",
+				cm_mgr_adaptive_miss_up);
+		len += cm_mgr_print("cm_mgr_adaptive_period_ms %d\n",
+				cm_mgr_adaptive_period_ms);
+	}
 
 	len += cm_mgr_print("cm_mgr_disable_fb %d\n", cm_mgr_disable_fb);
 	len += cm_mgr_print("light_load_cps %d\n", light_load_cps);
@@ -668,6 +886,20 @@ static ssize_t dbg_cm_mgr_store(struct  kobject *kobj,
 	} else if (!strcmp(cmd, "cm_mgr_cpu_map_emi_opp")) {
 		cm_mgr_cpu_map_emi_opp = val_1;
 		cm_mgr_cpu_map_update_table();
+	} else if (!strcmp(cmd, "cm_mgr_adaptive_enable")) {
+		if (val_1)
+			cm_mgr_adaptive_start();
+		else
+			cm_mgr_adaptive_stop();
+	} else if (!strcmp(cmd, "cm_mgr_adaptive_stall_up")) {
+		cm_mgr_adaptive_stall_up = val_1;
+	} else if (!strcmp(cmd, "cm_mgr_adaptive_stall_down")) {
+		cm_mgr_adaptive_stall_down = val_1;
+	} else if (!strcmp(cmd, "cm_mgr_adaptive_miss_up")) {
+		cm_mgr_adaptive_miss_up = val_1;
+	} else if (!strcmp(cmd, "cm_mgr_adaptive_period_ms")) {
+		if (val_1 > 0)
+			cm_mgr_adaptive_period_ms = val_1;
 #if IS_ENABLED(CONFIG_MTK_CM_IPI)
 	} else if (!strcmp(cmd, "dsu_enable")) {
 		dsu_enable = val_1;
@@ -798,6 +1030,25 @@ int cm_mgr_check_dts_setting(struct platform_device *pdev)
 	pr_info("#@# %s(%d) cm_mgr_use_cpu_to_dram_map_new %d\n",
 			__func__, __LINE__, cm_mgr_use_cpu_to_dram_map_new);
 
+	ret = of_property_read_string(node,
+			"use_adaptive", (const char **)&buf);
+	if (!ret && !strcmp(buf, "enable"))
+		cm_mgr_adaptive_enable = 1;
+	of_property_read_s32(node, "cm_mgr,adaptive_stall_up",
+			&cm_mgr_adaptive_stall_up);
+	of_property_read_s32(node, "cm_mgr,adaptive_stall_down",
+			&cm_mgr_adaptive_stall_down);
+	of_property_read_s32(node, "cm_mgr,adaptive_miss_up",
+			&cm_mgr_adaptive_miss_up);
+	pr_info("#@# %s(%d) cm_mgr_adaptive_enable %d (%d %d %d)\n",
+			__func__, __LINE__, cm_mgr_adaptive_enable,
+			cm_mgr_adaptive_stall_up, cm_mgr_adaptive_stall_down,
+			cm_mgr_adaptive_miss_up);
+	if (cm_mgr_adaptive_enable) {
+		cm_mgr_adaptive_enable = 0;
+		cm_mgr_adaptive_start();
+	}
+
 	/* get bcpu weight from dts */
 	ret = of_property_read_s32(node, "cpu_power_bcpu_weight_max",
 			&cpu_power_bcpu_weight_max);
@@ -879,6 +1130,7 @@ void cm_mgr_update_dram_by_cpu_opp(int cpu_opp)
 
 
 	if (cm_mgr_disable_fb == 1 && cm_mgr_blank_status == 1) {
+		cm_mgr_cpu_map_opp = -1;
 		if (cm_mgr_cpu_to_dram_opp != cm_mgr_num_perf) {
 			cm_mgr_cpu_to_dram_opp = cm_mgr_num_perf;
 			ret = schedule_delayed_work(&cm_mgr_work, 1);
@@ -887,6 +1139,7 @@ void cm_mgr_update_dram_by_cpu_opp(int cpu_opp)
 	}
 
 	if (!cm_mgr_cpu_map_dram_enable) {
+		cm_mgr_cpu_map_opp = -1;
 		if (cm_mgr_cpu_to_dram_opp != cm_mgr_num_perf) {
 			cm_mgr_cpu_to_dram_opp = cm_mgr_num_perf;
 			ret = schedule_delayed_work(&cm_mgr_work, 1);
@@ -900,7 +1153,8 @@ void cm_mgr_update_dram_by_cpu_opp(int cpu_opp)
 	//if (cm_mgr_cpu_to_dram_opp == dram_opp)
 	//	return;
 
-	cm_mgr_cpu_to_dram_opp = dram_opp;
+	cm_mgr_cpu_map_opp = dram_opp;
+	cm_mgr_cpu_to_dram_opp = cm_mgr_adaptive_opp(dram_opp);
 
 	ret = schedule_delayed_work(&cm_mgr_work, 1);
 }
@@ -1101,6 +1355,8 @@ void cm_mgr_common_exit(void)
 {
 	int ret;
 
+	cm_mgr_adaptive_stop();
+
 	kfree(cm_mgr_cpu_opp_to_dram);
 	kfree(cm_mgr_buf);
 
@@ -1022,6 +1022,49 @@ static void cmdq_test_mbox_reuse_buf_va(struct cmdq_test *test)
 		cmdq_msg("val:%#x equals to ans:%#x", val, ans);
 }
 
+static void cmdq_test_mbox_template(struct cmdq_test *test)
+{
+	unsigned long	va = (unsigned long)(CMDQ_GPR_R32(
+		test->gce.va, CMDQ_GPR_DEBUG_DUMMY));
+	unsigned long	pa = CMDQ_GPR_R32(
+		test->gce.pa, CMDQ_GPR_DEBUG_DUMMY);
+
+	struct cmdq_pkt_template *tpl;
+	s32 slot, i, val;
+
+	if (clk_prepare_enable(test->gce.clk)) {
+		cmdq_err("clk fail");
+		return;
+	}
+
+	writel(0xdeaddead, (void *)va);
+
+	tpl = cmdq_pkt_template_create(test->clt, 1);
+	if (IS_ERR(tpl)) {
+		clk_disable_unprepare(test->gce.clk);
+		return;
+	}
+
+	slot = cmdq_pkt_template_write_slot(tpl, "dummy", pa, 0, ~0);
+	if (slot < 0 || cmdq_pkt_template_find_slot(tpl, "dummy") != slot)
+		cmdq_err("slot:%d lookup failed", slot);
+
+	for (i = 1; i <= CMDQ_INST_SIZE; i++) {
+		cmdq_pkt_template_set(tpl, slot, i);
+		if (cmdq_pkt_template_submit(tpl, NULL, NULL) < 0)
+			break;
+		cmdq_pkt_wait_complete(tpl->pkt);
+
+		val = readl((void *)va);
+		if (val != i)
+			cmdq_err("frame:%d val:%#x not equal to ans:%#x", i, val, i);
+	}
+
+	cmdq_pkt_template_destroy(tpl);
+	clk_disable_unprepare(test->gce.clk);
+	cmdq_msg("%s done frames:%d", __func__, i - 1);
+}
+
 static void cmdq_test_mbox_prebuilt_instr(struct cmdq_test *test,
 	const u16 mod, const u16 event)
 {
@@ -1406,6 +1449,9 @@ cmdq_test_trigger(struct cmdq_test *test, const s32 sec, const s32 id)
 	case 23:
 		cmdq_test_mbox_write_dma_cpr(test, sec, 3);
 		break;
+	case 24:
+		cmdq_test_mbox_template(test);
+		break;
 	default:
 		break;
 	}
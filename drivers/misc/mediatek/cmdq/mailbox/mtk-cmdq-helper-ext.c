@@ -117,11 +117,26 @@ struct vcp_control {
 struct vcp_control vcp;
 
 
+/* per-cpu stash of free pool buffers, refilled on free, taken on alloc */
+#define CMDQ_BUF_CACHE_NR	4
+
+struct cmdq_buf_cache {
+	void *va[CMDQ_BUF_CACHE_NR];
+	dma_addr_t pa[CMDQ_BUF_CACHE_NR];
+	u32 cnt;
+};
+
 struct client_priv {
 	struct dma_pool *buf_pool;
 	u32 pool_limit;
 	atomic_t buf_cnt;
 	struct workqueue_struct *flushq;
+	struct cmdq_buf_cache __percpu *buf_cache;
+	/* pool usage instrumentation */
+	atomic_t buf_peak;
+	atomic_t cache_hit;
+	atomic_t pool_alloc;
+	atomic_t dma_fallback;
 };
 
 struct cmdq_instruction {
@@ -263,6 +278,7 @@ struct cmdq_client *cmdq_mbox_create(struct device *dev, int index)
 	}
 
 	priv->pool_limit = CMDQ_MBOX_BUF_LIMIT;
+	priv->buf_cache = alloc_percpu(struct cmdq_buf_cache);
 	priv->flushq = create_singlethread_workqueue("cmdq_flushq");
 	client->cl_priv = (void *)priv;
 
@@ -500,9 +516,23 @@ void cmdq_mbox_pool_create(struct cmdq_client *cl)
 }
 EXPORT_SYMBOL(cmdq_mbox_pool_create);
 
+void cmdq_mbox_pool_dump(struct cmdq_client *cl)
+{
+	struct client_priv *priv = (struct client_priv *)cl->cl_priv;
+
+	cmdq_msg("pool:0x%p in use:%d peak:%d limit:%u cache hit:%d pool alloc:%d dma fallback:%d",
+		priv->buf_pool, atomic_read(&priv->buf_cnt),
+		atomic_read(&priv->buf_peak), priv->pool_limit,
+		atomic_read(&priv->cache_hit), atomic_read(&priv->pool_alloc),
+		atomic_read(&priv->dma_fallback));
+}
+EXPORT_SYMBOL(cmdq_mbox_pool_dump);
+
 void cmdq_mbox_pool_clear(struct cmdq_client *cl)
 {
 	struct client_priv *priv = (struct client_priv *)cl->cl_priv;
+	struct cmdq_buf_cache *cache;
+	int cpu;
 
 	/* check pool still in use */
 	if (unlikely((atomic_read(&priv->buf_cnt)))) {
@@ -511,13 +541,74 @@ void cmdq_mbox_pool_clear(struct cmdq_client *cl)
 		return;
 	}
 
+	cmdq_mbox_pool_dump(cl);
+
+	/* give the stashed buffers back before the pool goes away */
+	if (priv->buf_cache && priv->buf_pool) {
+		for_each_possible_cpu(cpu) {
+			cache = per_cpu_ptr(priv->buf_cache, cpu);
+			while (cache->cnt) {
+				cache->cnt--;
+				dma_pool_free(priv->buf_pool,
+					cache->va[cache->cnt],
+					cache->pa[cache->cnt]);
+			}
+		}
+	}
+
 	dma_pool_destroy(priv->buf_pool);
 	priv->buf_pool = NULL;
 }
 EXPORT_SYMBOL(cmdq_mbox_pool_clear);
 
+static void *cmdq_mbox_cache_get(struct cmdq_buf_cache __percpu *pcache,
+	dma_addr_t *pa_out)
+{
+	struct cmdq_buf_cache *cache;
+	unsigned long flags;
+	void *va = NULL;
+
+	if (!pcache)
+		return NULL;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pcache);
+	if (cache->cnt) {
+		cache->cnt--;
+		va = cache->va[cache->cnt];
+		*pa_out = cache->pa[cache->cnt];
+	}
+	local_irq_restore(flags);
+
+	return va;
+}
+
+static bool cmdq_mbox_cache_put(struct cmdq_buf_cache __percpu *pcache,
+	void *va, dma_addr_t pa)
+{
+	struct cmdq_buf_cache *cache;
+	unsigned long flags;
+	bool stashed = false;
+
+	if (!pcache)
+		return false;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pcache);
+	if (cache->cnt < CMDQ_BUF_CACHE_NR) {
+		cache->va[cache->cnt] = va;
+		cache->pa[cache->cnt] = pa;
+		cache->cnt++;
+		stashed = true;
+	}
+	local_irq_restore(flags);
+
+	return stashed;
+}
+
 static void *cmdq_mbox_pool_alloc_impl(struct dma_pool *pool,
-	dma_addr_t *pa_out, atomic_t *cnt, u32 limit)
+	dma_addr_t *pa_out, atomic_t *cnt, u32 limit,
+	struct cmdq_buf_cache __percpu *cache)
 {
 	void *va;
 	dma_addr_t pa;
@@ -528,6 +619,10 @@ static void *cmdq_mbox_pool_alloc_impl(struct dma_pool *pool,
 		return NULL;
 	}
 
+	va = cmdq_mbox_cache_get(cache, pa_out);
+	if (va)
+		return va;
+
 	va = dma_pool_alloc(pool, GFP_KERNEL, &pa);
 	if (!va) {
 		atomic_dec(cnt);
@@ -544,7 +639,7 @@ static void *cmdq_mbox_pool_alloc_impl(struct dma_pool *pool,
 }
 
 static void cmdq_mbox_pool_free_impl(struct dma_pool *pool, void *va,
-	dma_addr_t pa, atomic_t *cnt)
+	dma_addr_t pa, atomic_t *cnt, struct cmdq_buf_cache __percpu *cache)
 {
 	if (unlikely(atomic_read(cnt) <= 0 || !pool)) {
 		cmdq_err("free pool cnt:%d pool:0x%p",
@@ -552,10 +647,24 @@ static void cmdq_mbox_pool_free_impl(struct dma_pool *pool, void *va,
 		return;
 	}
 
-	dma_pool_free(pool, va, pa);
+	if (!cmdq_mbox_cache_put(cache, va, pa))
+		dma_pool_free(pool, va, pa);
 	atomic_dec(cnt);
 }
 
+static void cmdq_mbox_pool_account(struct client_priv *priv, bool hit)
+{
+	s32 cnt = atomic_read(&priv->buf_cnt);
+
+	if (cnt > atomic_read(&priv->buf_peak))
+		atomic_set(&priv->buf_peak, cnt);
+
+	if (hit)
+		atomic_inc(&priv->cache_hit);
+	else
+		atomic_inc(&priv->pool_alloc);
+}
+
 static void *cmdq_mbox_pool_alloc(struct cmdq_client *cl, dma_addr_t *pa_out)
 {
 	struct client_priv *priv = (struct client_priv *)cl->cl_priv;
@@ -570,14 +679,15 @@ static void *cmdq_mbox_pool_alloc(struct cmdq_client *cl, dma_addr_t *pa_out)
 	}
 
 	return cmdq_mbox_pool_alloc_impl(priv->buf_pool,
-		pa_out, &priv->buf_cnt, priv->pool_limit);
+		pa_out, &priv->buf_cnt, priv->pool_limit, priv->buf_cache);
 }
 
 static void cmdq_mbox_pool_free(struct cmdq_client *cl, void *va, dma_addr_t pa)
 {
 	struct client_priv *priv = (struct client_priv *)cl->cl_priv;
 
-	cmdq_mbox_pool_free_impl(priv->buf_pool, va, pa, &priv->buf_cnt);
+	cmdq_mbox_pool_free_impl(priv->buf_pool, va, pa, &priv->buf_cnt,
+		priv->buf_cache);
 }
 
 static void *cmdq_mbox_buf_alloc_dev(struct device *dev, dma_addr_t *pa_out)
@@ -691,8 +801,10 @@ EXPORT_SYMBOL(cmdq_dev_get_event);
 struct cmdq_pkt_buffer *cmdq_pkt_alloc_buf(struct cmdq_pkt *pkt)
 {
 	struct cmdq_client *cl = (struct cmdq_client *)pkt->cl;
+	struct client_priv *priv = cl ? (struct client_priv *)cl->cl_priv : NULL;
 	struct cmdq_pkt_buffer *buf;
 	bool use_iommu = false;
+	u32 hit = 0;
 
 	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
 	if (!buf)
@@ -713,28 +825,37 @@ struct cmdq_pkt_buffer *cmdq_pkt_alloc_buf(struct cmdq_pkt *pkt)
 		return ERR_PTR(-ENODEV);
 	}
 
+	/* racy peek is fine, only used for the hit statistic */
+	if (priv && priv->buf_cache)
+		hit = raw_cpu_ptr(priv->buf_cache)->cnt;
+
 	/* try dma pool if available */
 	if (pkt->cur_pool.pool)
 		buf->va_base = cmdq_mbox_pool_alloc_impl(pkt->cur_pool.pool,
 			use_iommu ? &buf->iova_base : &buf->pa_base,
-			pkt->cur_pool.cnt, *pkt->cur_pool.limit);
+			pkt->cur_pool.cnt, *pkt->cur_pool.limit,
+			pkt->cur_pool.cache);
 	else if (cl) {
-		struct client_priv *priv = (struct client_priv *)cl->cl_priv;
-
 		buf->va_base = cmdq_mbox_pool_alloc(cl,
 			use_iommu ? &buf->iova_base : &buf->pa_base);
 		if (buf->va_base) {
 			pkt->cur_pool.pool = priv->buf_pool;
 			pkt->cur_pool.cnt = &priv->buf_cnt;
 			pkt->cur_pool.limit = &priv->pool_limit;
+			pkt->cur_pool.cache = priv->buf_cache;
 		}
 	}
 
-	if (buf->va_base)
+	if (buf->va_base) {
 		buf->use_pool = true;
-	else	/* allocate directly */
+		if (priv && pkt->cur_pool.cnt == &priv->buf_cnt)
+			cmdq_mbox_pool_account(priv, hit);
+	} else {	/* allocate directly */
+		if (priv)
+			atomic_inc(&priv->dma_fallback);
 		buf->va_base = cmdq_mbox_buf_alloc_dev(pkt->dev,
 			use_iommu ? &buf->iova_base : &buf->pa_base);
+	}
 
 
 	if (!buf->va_base) {
@@ -780,7 +901,8 @@ void cmdq_pkt_free_buf(struct cmdq_pkt *pkt)
 				cmdq_mbox_pool_free_impl(pkt->cur_pool.pool,
 					buf->va_base,
 					CMDQ_BUF_ADDR(buf),
-					pkt->cur_pool.cnt);
+					pkt->cur_pool.cnt,
+					pkt->cur_pool.cache);
 			else {
 				cmdq_err("free pool:%s dev:%#lx pa:%pa iova:%pa cl:%p",
 					buf->use_pool ? "true" : "false",
@@ -844,7 +966,11 @@ EXPORT_SYMBOL(cmdq_pkt_add_cmd_buffer);
 
 void cmdq_mbox_destroy(struct cmdq_client *client)
 {
+	struct client_priv *priv = (struct client_priv *)client->cl_priv;
+
 	mbox_free_channel(client->chan);
+	if (priv)
+		free_percpu(priv->buf_cache);
 	kfree(client->cl_priv);
 	kfree(client);
 }
@@ -1326,6 +1452,171 @@ void cmdq_reuse_refresh(struct cmdq_pkt *pkt, struct cmdq_reuse *reuse, u32 cnt)
 }
 EXPORT_SYMBOL(cmdq_reuse_refresh);
 
+struct cmdq_pkt_template *cmdq_pkt_template_create(struct cmdq_client *client,
+	u32 slot_max)
+{
+	struct cmdq_pkt_template *tpl;
+
+	if (!client || !slot_max)
+		return ERR_PTR(-EINVAL);
+
+	tpl = kzalloc(sizeof(*tpl), GFP_KERNEL);
+	if (!tpl)
+		return ERR_PTR(-ENOMEM);
+
+	tpl->slot = kcalloc(slot_max, sizeof(*tpl->slot), GFP_KERNEL);
+	tpl->slot_name = kcalloc(slot_max, sizeof(*tpl->slot_name),
+		GFP_KERNEL);
+	if (!tpl->slot || !tpl->slot_name)
+		goto err;
+
+	tpl->pkt = cmdq_pkt_create(client);
+	if (IS_ERR(tpl->pkt))
+		goto err;
+
+	tpl->slot_max = slot_max;
+	return tpl;
+
+err:
+	kfree(tpl->slot_name);
+	kfree(tpl->slot);
+	kfree(tpl);
+	return ERR_PTR(-ENOMEM);
+}
+EXPORT_SYMBOL(cmdq_pkt_template_create);
+
+void cmdq_pkt_template_destroy(struct cmdq_pkt_template *tpl)
+{
+	if (IS_ERR_OR_NULL(tpl))
+		return;
+
+	cmdq_pkt_destroy(tpl->pkt);
+	kfree(tpl->slot_name);
+	kfree(tpl->slot);
+	kfree(tpl);
+}
+EXPORT_SYMBOL(cmdq_pkt_template_destroy);
+
+static s32 cmdq_pkt_template_new_slot(struct cmdq_pkt_template *tpl,
+	const char *name)
+{
+	if (tpl->sealed) {
+		cmdq_err("template:%p sealed, slot:%s", tpl, name);
+		return -EPERM;
+	}
+
+	if (tpl->slot_cnt >= tpl->slot_max) {
+		cmdq_err("template:%p slot full:%u slot:%s",
+			tpl, tpl->slot_max, name);
+		return -ENOSPC;
+	}
+
+	tpl->slot_name[tpl->slot_cnt] = name;
+	return tpl->slot_cnt;
+}
+
+s32 cmdq_pkt_template_write_slot(struct cmdq_pkt_template *tpl,
+	const char *name, dma_addr_t addr, u32 value, u32 mask)
+{
+	s32 slot = cmdq_pkt_template_new_slot(tpl, name);
+	s32 err;
+
+	if (slot < 0)
+		return slot;
+
+	err = cmdq_pkt_write_value_addr_reuse(tpl->pkt, addr, value, mask,
+		&tpl->slot[slot]);
+	if (err < 0)
+		return err;
+
+	tpl->slot[slot].val = value;
+	tpl->slot_cnt++;
+	return slot;
+}
+EXPORT_SYMBOL(cmdq_pkt_template_write_slot);
+
+s32 cmdq_pkt_template_assign_slot(struct cmdq_pkt_template *tpl,
+	const char *name, u16 reg_idx, u32 value)
+{
+	s32 slot = cmdq_pkt_template_new_slot(tpl, name);
+	s32 err;
+
+	if (slot < 0)
+		return slot;
+
+	err = cmdq_pkt_assign_command_reuse(tpl->pkt, reg_idx, value,
+		&tpl->slot[slot]);
+	if (err < 0)
+		return err;
+
+	tpl->slot[slot].val = value;
+	tpl->slot_cnt++;
+	return slot;
+}
+EXPORT_SYMBOL(cmdq_pkt_template_assign_slot);
+
+s32 cmdq_pkt_template_seal(struct cmdq_pkt_template *tpl)
+{
+	s32 err;
+
+	if (tpl->sealed)
+		return 0;
+
+	err = cmdq_pkt_finalize(tpl->pkt);
+	if (err < 0)
+		return err;
+
+	tpl->sealed = true;
+	return 0;
+}
+EXPORT_SYMBOL(cmdq_pkt_template_seal);
+
+s32 cmdq_pkt_template_find_slot(struct cmdq_pkt_template *tpl,
+	const char *name)
+{
+	u32 i;
+
+	for (i = 0; i < tpl->slot_cnt; i++)
+		if (!strcmp(tpl->slot_name[i], name))
+			return i;
+
+	return -ENOENT;
+}
+EXPORT_SYMBOL(cmdq_pkt_template_find_slot);
+
+s32 cmdq_pkt_template_set(struct cmdq_pkt_template *tpl, u32 slot,
+	u32 value)
+{
+	if (slot >= tpl->slot_cnt)
+		return -EINVAL;
+
+	if (cmdq_pkt_is_exec(tpl->pkt))
+		return -EBUSY;
+
+	tpl->slot[slot].val = value;
+	cmdq_pkt_reuse_value(tpl->pkt, &tpl->slot[slot]);
+	return 0;
+}
+EXPORT_SYMBOL(cmdq_pkt_template_set);
+
+s32 cmdq_pkt_template_submit(struct cmdq_pkt_template *tpl,
+	cmdq_async_flush_cb cb, void *data)
+{
+	s32 err;
+
+	if (cmdq_pkt_is_exec(tpl->pkt)) {
+		cmdq_log("template:%p still executing", tpl);
+		return -EBUSY;
+	}
+
+	err = cmdq_pkt_template_seal(tpl);
+	if (err < 0)
+		return err;
+
+	return cmdq_pkt_flush_async(tpl->pkt, cb, data);
+}
+EXPORT_SYMBOL(cmdq_pkt_template_submit);
+
 s32 cmdq_pkt_copy(struct cmdq_pkt *dst, struct cmdq_pkt *src)
 {
 	struct list_head entry;
@@ -152,6 +152,7 @@ struct cmdq_task {
 	struct cmdq_pkt		*pkt; /* the packet sent from mailbox client */
 	u64			exec_time;
 	u64			end_time;
+	s32			err; /* result kept for the batched callback */
 };
 
 struct cmdq_buf_dump {
@@ -926,6 +927,41 @@ static void cmdq_task_exec_done(struct cmdq_task *task, s32 err)
 	list_del_init(&task->list_entry);
 }
 
+/*
+ * IRQ side completion: take the task off the thread under the channel
+ * lock but leave the client callback to cmdq_task_done_batch(), so the
+ * lock is not held across callbacks and submitters on a shared thread
+ * are not stalled behind them.
+ */
+static void cmdq_task_exec_done_defer(struct cmdq_task *task, s32 err,
+	struct list_head *done)
+{
+	task->err = err;
+	task->end_time = sched_clock();
+	list_move_tail(&task->list_entry, done);
+}
+
+static void cmdq_task_done_batch(struct cmdq *cmdq, struct list_head *done)
+{
+	struct cmdq_task *task;
+	unsigned long flags;
+
+	if (list_empty(done))
+		return;
+
+	list_for_each_entry(task, done, list_entry) {
+#if IS_ENABLED(CONFIG_MTK_CMDQ_MBOX_EXT)
+		task->pkt->rec_irq = sched_clock();
+#endif
+		cmdq_task_callback(task->pkt, task->err);
+		cmdq_log("pkt:0x%p done err:%d", task->pkt, task->err);
+	}
+
+	spin_lock_irqsave(&cmdq->irq_removes_lock, flags);
+	list_splice_tail_init(done, &cmdq->irq_removes);
+	spin_unlock_irqrestore(&cmdq->irq_removes_lock, flags);
+}
+
 static void cmdq_buf_dump_schedule(struct cmdq_task *task, bool timeout,
 				   dma_addr_t pa_curr)
 {
@@ -984,13 +1020,12 @@ static void cmdq_thread_dump_pkt_by_pc(struct cmdq_thread *thread, const u64 pc,
 }
 
 static void cmdq_thread_irq_handler(struct cmdq *cmdq,
-	struct cmdq_thread *thread, struct list_head *removes)
+	struct cmdq_thread *thread, struct list_head *done)
 {
 	struct cmdq_task *task, *tmp, *curr_task = NULL;
 	u32 irq_flag;
 	dma_addr_t curr_pa, task_end_pa;
 	s32 err = 0;
-	unsigned long flags;
 
 	if (atomic_read(&cmdq->usage) <= 0) {
 		cmdq_log("irq handling during gce off gce:%lx thread:%u",
@@ -1106,19 +1141,13 @@ static void cmdq_thread_irq_handler(struct cmdq *cmdq,
 					"remove task that not ending pkt:0x%p %pa to %pa",
 					curr_task->pkt, &curr_pa, &task_end_pa);
 			}
-			cmdq_task_exec_done(task, 0);
-			spin_lock_irqsave(&cmdq->irq_removes_lock, flags);
-			list_add_tail(&task->list_entry, &cmdq->irq_removes);
-			spin_unlock_irqrestore(&cmdq->irq_removes_lock, flags);
+			cmdq_task_exec_done_defer(task, 0, done);
 		} else if (err) {
 			cmdq_err("pkt:0x%p thread:%u err:%d",
 				curr_task->pkt, thread->idx, err);
 			cmdq_buf_dump_schedule(task, false, curr_pa);
-			cmdq_task_exec_done(task, err);
+			cmdq_task_exec_done_defer(task, err, done);
 			cmdq_task_handle_error(curr_task);
-			spin_lock_irqsave(&cmdq->irq_removes_lock, flags);
-			list_add_tail(&task->list_entry, &cmdq->irq_removes);
-			spin_unlock_irqrestore(&cmdq->irq_removes_lock, flags);
 		}
 
 		if (curr_task)
@@ -1150,6 +1179,7 @@ static irqreturn_t cmdq_irq_handler(int irq, void *dev)
 	u64 start = sched_clock(), end[4];
 	u32 end_cnt = 0, thd_cnt = 0;
 	static u8 time;
+	LIST_HEAD(done);
 
 	if (atomic_read(&cmdq->usage) == -1)
 		cmdq_util_aee("CMDQ", "%s irq:%d cmdq:%pa suspend:%d usage:%d",
@@ -1195,12 +1225,15 @@ static irqreturn_t cmdq_irq_handler(int irq, void *dev)
 
 		irq_time = sched_clock();
 		spin_lock_irqsave(&thread->chan->lock, flags);
-		cmdq_thread_irq_handler(cmdq, thread, &cmdq->irq_removes);
+		cmdq_thread_irq_handler(cmdq, thread, &done);
 		spin_unlock_irqrestore(&thread->chan->lock, flags);
 		thread->irq_time = sched_clock() - irq_time;
 		thd_cnt += 1;
 	}
 
+	/* one callback pass for every thread handled in this irq */
+	cmdq_task_done_batch(cmdq, &done);
+
 	end[end_cnt++] = sched_clock();
 
 	set_bit(CMDQ_THR_MAX_COUNT, &cmdq->err_irq_idx);
@@ -1342,6 +1375,7 @@ static void cmdq_thread_handle_timeout_work(struct work_struct *work_item)
 	 * so check this condition again.
 	 */
 	cmdq_thread_irq_handler(cmdq, thread, &removes);
+	cmdq_task_done_batch(cmdq, &removes);
 
 	if (list_empty(&thread->task_busy_list)) {
 		cmdq_err("thread:%u empty after irq handle in timeout",
@@ -1788,6 +1822,7 @@ void cmdq_mbox_thread_remove_task(struct mbox_chan *chan,
 	 * so check this condition again.
 	 */
 	cmdq_thread_irq_handler(cmdq, thread, &removes);
+	cmdq_task_done_batch(cmdq, &removes);
 
 	if (list_empty(&thread->task_busy_list)) {
 		cmdq_err("thread:%u empty after irq handle in timeout",
@@ -1882,6 +1917,7 @@ static void cmdq_mbox_thread_stop(struct cmdq_thread *thread)
 	 * so check this condition again.
 	 */
 	cmdq_thread_irq_handler(cmdq, thread, &removes);
+	cmdq_task_done_batch(cmdq, &removes);
 	if (list_empty(&thread->task_busy_list)) {
 		cmdq_err("thread:%u empty after irq handle in disable thread",
 			thread->idx);
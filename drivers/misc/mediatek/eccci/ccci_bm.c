@@ -31,6 +31,22 @@ struct ccci_skb_queue skb_pool_16;
 
 struct workqueue_struct *pool_reload_work_queue;
 
+/*
+ * Zero-copy RX buffers. Each packet buffer is a page fragment with
+ * NET_SKB_PAD of headroom and room for skb_shared_info behind it, so that
+ * build_skb() can use it as skb head in place. The page_frag_cache reuses
+ * a page once the stack has freed every skb built on it, which gives the
+ * same recycling as the skb pools without copying the payload.
+ */
+#define CCCI_RX_FRAG_HEADROOM NET_SKB_PAD
+#define CCCI_RX_FRAG_SIZE(len) \
+	(SKB_DATA_ALIGN(CCCI_RX_FRAG_HEADROOM + (len)) + \
+	SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
+static DEFINE_PER_CPU(struct page_frag_cache, ccci_rx_frag_cache);
+static atomic_t rx_frag_alloc_count = ATOMIC_INIT(0);
+static atomic_t rx_frag_fail_count = ATOMIC_INIT(0);
+
 #ifdef CCCI_BM_TRACE
 struct timer_list ccci_bm_stat_timer;
 void ccci_bm_stat_timer_func(unsigned long data)
@@ -397,6 +413,12 @@ void ccci_free_skb(struct sk_buff *skb)
 	struct ccci_buffer_ctrl *buf_ctrl = NULL;
 	enum DATA_POLICY policy = FREE;
 
+	/* fragment based skb, its headroom holds no ccci_buffer_ctrl */
+	if (skb->head_frag) {
+		dev_kfree_skb_any(skb);
+		return;
+	}
+
 	/*skb is onlink from caller cldma_gpd_bd_tx_collect*/
 	buf_ctrl = (struct ccci_buffer_ctrl *)(skb->head + NET_SKB_PAD -
 		sizeof(struct ccci_buffer_ctrl));
@@ -453,9 +475,70 @@ void ccci_dump_skb_pool_usage(int md_id)
 	skb_pool_16.max_occupied = 0;
 	skb_pool_16.enq_count = 0;
 	skb_pool_16.deq_count = 0;
+	CCCI_REPEAT_LOG(md_id, BM,
+		"rx_frag: \t\talloc_count %08d, fail_count %08d\n",
+		atomic_xchg(&rx_frag_alloc_count, 0),
+		atomic_xchg(&rx_frag_fail_count, 0));
 }
 EXPORT_SYMBOL(ccci_dump_skb_pool_usage);
 
+/* returns where DMA may write up to @len bytes, or NULL */
+void *ccci_rx_frag_alloc(unsigned int len, gfp_t gfp_mask)
+{
+	unsigned int fragsz = CCCI_RX_FRAG_SIZE(len);
+	unsigned long flags;
+	void *buf;
+
+	if (unlikely(fragsz > PAGE_SIZE))
+		return NULL;
+
+	/* HIF may refill from both its IRQ and process context */
+	local_irq_save(flags);
+	buf = page_frag_alloc(this_cpu_ptr(&ccci_rx_frag_cache), fragsz,
+		gfp_mask);
+	local_irq_restore(flags);
+	if (unlikely(!buf)) {
+		atomic_inc(&rx_frag_fail_count);
+		return NULL;
+	}
+	atomic_inc(&rx_frag_alloc_count);
+
+	return buf + CCCI_RX_FRAG_HEADROOM;
+}
+EXPORT_SYMBOL(ccci_rx_frag_alloc);
+
+/*
+ * wrap a buffer from ccci_rx_frag_alloc() holding @pkt_len bytes into an
+ * skb; on failure, NULL is returned and the buffer still belongs to caller
+ */
+struct sk_buff *ccci_rx_frag_build_skb(void *data, unsigned int len,
+	unsigned int pkt_len)
+{
+	struct sk_buff *skb;
+
+	if (unlikely(pkt_len > len))
+		return NULL;
+
+	skb = build_skb(data - CCCI_RX_FRAG_HEADROOM, CCCI_RX_FRAG_SIZE(len));
+	if (unlikely(!skb)) {
+		CCCI_ERROR_LOG(-1, BM, "%ps build skb fail, len=%d\n",
+			__builtin_return_address(0), pkt_len);
+		return NULL;
+	}
+	skb_reserve(skb, CCCI_RX_FRAG_HEADROOM);
+	skb_put(skb, pkt_len);
+
+	return skb;
+}
+EXPORT_SYMBOL(ccci_rx_frag_build_skb);
+
+/* drop a buffer that never made it into an skb, e.g. on ring teardown */
+void ccci_rx_frag_free(void *data)
+{
+	skb_free_frag(data - CCCI_RX_FRAG_HEADROOM);
+}
+EXPORT_SYMBOL(ccci_rx_frag_free);
+
 static void __4K_reload_work(struct work_struct *work)
 {
 	struct sk_buff *skb = NULL;
@@ -199,7 +199,7 @@ static void fsm_routine_exception(struct ccci_fsm_ctl *ctl,
 	struct ccci_fsm_command *cmd, enum CCCI_EE_REASON reason)
 {
 	int count = 0, ex_got = 0;
-	int rec_ok_got = 0, pass_got = 0;
+	int rec_ok_got = 0;
 	struct ccci_fsm_event *event = NULL;
 	unsigned long flags;
 
@@ -281,23 +281,8 @@ static void fsm_routine_exception(struct ccci_fsm_ctl *ctl,
 			msleep(EVENT_POLL_INTEVAL);
 		}
 		fsm_md_exception_stage(&ctl->ee_ctl, 1);
-		count = 0;
-		while (count < MD_EX_PASS_TIMEOUT/EVENT_POLL_INTEVAL) {
-			spin_lock_irqsave(&ctl->event_lock, flags);
-			if (!list_empty(&ctl->event_queue)) {
-				event = list_first_entry(&ctl->event_queue,
-					struct ccci_fsm_event, entry);
-				if (event->event_id == CCCI_EVENT_MD_EX_PASS) {
-					pass_got = 1;
-					fsm_finish_event(ctl, event);
-				}
-			}
-			spin_unlock_irqrestore(&ctl->event_lock, flags);
-			if (pass_got)
-				break;
-			count++;
-			msleep(EVENT_POLL_INTEVAL);
-		}
+		fsm_poll_md_event(ctl, CCCI_EVENT_MD_EX_PASS,
+			MD_EX_PASS_TIMEOUT);
 		fsm_md_exception_stage(&ctl->ee_ctl, 2);
 		break;
 	default:
@@ -494,6 +479,8 @@ static void fsm_routine_stop(struct ccci_fsm_ctl *ctl,
 	/*reset fsm poller*/
 	ctl->poller_ctl.poller_state = FSM_POLLER_RECEIVED_RESPONSE;
 	wake_up(&ctl->poller_ctl.status_rx_wq);
+	/* deferred EE dumps read MD memory, finish them before reset */
+	flush_work(&ctl->ee_ctl.dump_work);
 	/* 4. hardware stop */
 	ccci_md_stop(ctl->md_id,
 	cmd->flag & FSM_CMD_FLAG_FLIGHT_MODE
@@ -812,6 +799,36 @@ struct ccci_fsm_ctl *fsm_get_entity_by_md_id(int md_id)
 	return NULL;
 }
 
+/*
+ * poll the head of event queue for event_id, for MD messages which
+ * end a wait that would otherwise run into its timeout (ms).
+ */
+int fsm_poll_md_event(struct ccci_fsm_ctl *ctl, enum CCCI_FSM_EVENT event_id,
+	int timeout)
+{
+	int count = 0, got = 0;
+	struct ccci_fsm_event *event = NULL;
+	unsigned long flags;
+
+	while (count < timeout/EVENT_POLL_INTEVAL) {
+		spin_lock_irqsave(&ctl->event_lock, flags);
+		if (!list_empty(&ctl->event_queue)) {
+			event = list_first_entry(&ctl->event_queue,
+				struct ccci_fsm_event, entry);
+			if (event->event_id == event_id) {
+				got = 1;
+				fsm_finish_event(ctl, event);
+			}
+		}
+		spin_unlock_irqrestore(&ctl->event_lock, flags);
+		if (got)
+			break;
+		count++;
+		msleep(EVENT_POLL_INTEVAL);
+	}
+	return got;
+}
+
 int ccci_fsm_init(int md_id)
 {
 	struct ccci_fsm_ctl *ctl = NULL;
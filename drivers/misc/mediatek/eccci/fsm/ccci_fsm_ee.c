@@ -74,7 +74,6 @@ void fsm_md_exception_stage(struct ccci_fsm_ee *ee_ctl, int stage)
 		unsigned int ee_info_flag = 0;
 		unsigned int md_dump_flag = 0;
 		int md_id = ee_ctl->md_id;
-		struct ccci_mem_layout *mem_layout = ccci_md_get_mem(md_id);
 		struct ccci_smem_region *mdss_dbg
 			= ccci_md_get_smem_by_user_id(ee_ctl->md_id,
 				SMEM_USER_RAW_MDSS_DBG);
@@ -142,14 +141,12 @@ void fsm_md_exception_stage(struct ccci_fsm_ee *ee_ctl, int stage)
 			+ CCCI_EE_OFFSET_CCIF_SRAM,
 			CCCI_EE_SIZE_CCIF_SRAM);
 
-		/* Dump MD memory layout */
-		CCCI_MEM_LOG_TAG(md_id, FSM, "Dump MD layout struct\n");
-		ccci_util_mem_dump(md_id, CCCI_DUMP_MEM_DUMP, mem_layout,
-			sizeof(struct ccci_mem_layout));
-		/* Dump CCB memory */
-		ccci_md_dump_info(md_id,
-			DUMP_FLAG_SMEM_CCB_CTRL | DUMP_FLAG_SMEM_CCB_DATA,
-			NULL, 0);
+		/*
+		 * layout and CCB memory only go to the memory log, copy them
+		 * while we wait for MD_EX_PASS, fsm_routine_stop() flushes
+		 * this before MD is reset.
+		 */
+		schedule_work(&ee_ctl->dump_work);
 
 		CCCI_ERROR_LOG(md_id, FSM, "MD exception stage 1: end\n");
 _dump_done:
@@ -206,6 +203,7 @@ void fsm_md_exception_stage(struct ccci_fsm_ee *ee_ctl, int stage)
 		 */
 		ee_ctl->ee_info_flag = 0;
 		spin_unlock_irqrestore(&ee_ctl->ctrl_lock, flags);
+		wake_up(&ee_ctl->ee_done_wq);
 
 		if (md_wdt_ee && md_id == MD_SYS3) {
 			CCCI_ERROR_LOG(md_id, FSM,
@@ -218,6 +216,37 @@ void fsm_md_exception_stage(struct ccci_fsm_ee *ee_ctl, int stage)
 	}
 }
 
+static void fsm_ee_deferred_dump(struct work_struct *work)
+{
+	struct ccci_fsm_ee *ee_ctl
+		= container_of(work, struct ccci_fsm_ee, dump_work);
+	int md_id = ee_ctl->md_id;
+	struct ccci_mem_layout *mem_layout = ccci_md_get_mem(md_id);
+
+	/* Dump MD memory layout */
+	CCCI_MEM_LOG_TAG(md_id, FSM, "Dump MD layout struct\n");
+	ccci_util_mem_dump(md_id, CCCI_DUMP_MEM_DUMP, mem_layout,
+		sizeof(struct ccci_mem_layout));
+	/* Dump CCB memory */
+	ccci_md_dump_info(md_id,
+		DUMP_FLAG_SMEM_CCB_CTRL | DUMP_FLAG_SMEM_CCB_DATA,
+		NULL, 0);
+	CCCI_MEM_LOG_TAG(md_id, FSM, "deferred EE dump done\n");
+}
+
+/*
+ * MD may still report MD_EX_PASS after a WDT or no response EE,
+ * don't sit out the whole timeout once it did.
+ */
+static void fsm_md_wait_ex_pass(struct ccci_fsm_ee *ee_ctl)
+{
+	struct ccci_fsm_ctl *ctl
+		= container_of(ee_ctl, struct ccci_fsm_ctl, ee_ctl);
+
+	if (fsm_poll_md_event(ctl, CCCI_EVENT_MD_EX_PASS, MD_EX_PASS_TIMEOUT))
+		CCCI_NORMAL_LOG(ee_ctl->md_id, FSM, "got MD_EX_PASS\n");
+}
+
 void fsm_md_wdt_handler(struct ccci_fsm_ee *ee_ctl)
 {
 	unsigned long flags;
@@ -226,7 +255,7 @@ void fsm_md_wdt_handler(struct ccci_fsm_ee *ee_ctl)
 	ee_ctl->ee_info_flag |= (MD_EE_FLOW_START | MD_EE_WDT_GET);
 	spin_unlock_irqrestore(&ee_ctl->ctrl_lock, flags);
 	fsm_md_exception_stage(ee_ctl, 1);
-	msleep(MD_EX_PASS_TIMEOUT);
+	fsm_md_wait_ex_pass(ee_ctl);
 	fsm_md_exception_stage(ee_ctl, 2);
 }
 
@@ -238,7 +267,7 @@ void fsm_md_no_response_handler(struct ccci_fsm_ee *ee_ctl)
 	ee_ctl->ee_info_flag |= (MD_EE_FLOW_START | MD_EE_PENDING_TOO_LONG);
 	spin_unlock_irqrestore(&ee_ctl->ctrl_lock, flags);
 	fsm_md_exception_stage(ee_ctl, 1);
-	msleep(MD_EX_PASS_TIMEOUT);
+	fsm_md_wait_ex_pass(ee_ctl);
 	fsm_md_exception_stage(ee_ctl, 2);
 }
 
@@ -305,6 +334,14 @@ void fsm_ee_message_handler(struct ccci_fsm_ee *ee_ctl, struct sk_buff *skb)
 	}
 }
 
+static bool fsm_ee_is_done(struct ccci_fsm_ee *ee_ctl)
+{
+	if (ccci_port_get_critical_user(ee_ctl->md_id, CRIT_USR_MDLOG))
+		return !(ee_ctl->ee_info_flag & MD_EE_FLOW_START)
+			&& ee_ctl->mdlog_dump_done;
+	return !(ee_ctl->ee_info_flag & MD_EE_FLOW_START);
+}
+
 int fsm_check_ee_done(struct ccci_fsm_ee *ee_ctl, int timeout)
 {
 	int count = 0;
@@ -315,15 +352,15 @@ int fsm_check_ee_done(struct ccci_fsm_ee *ee_ctl, int timeout)
 	CCCI_BOOTUP_LOG(ee_ctl->md_id, FSM, "checking EE status\n");
 	while (ccci_fsm_get_md_state(ee_ctl->md_id) == EXCEPTION) {
 		if (ccci_port_get_critical_user(ee_ctl->md_id,
-				CRIT_USR_MDLOG)) {
+				CRIT_USR_MDLOG))
 			CCCI_DEBUG_LOG(ee_ctl->md_id, FSM,
 				"MD logger is running, waiting for EE dump done\n");
-			is_ee_done = !(ee_ctl->ee_info_flag & MD_EE_FLOW_START)
-				&& ee_ctl->mdlog_dump_done;
-		} else
-			is_ee_done = !(ee_ctl->ee_info_flag & MD_EE_FLOW_START);
+		is_ee_done = fsm_ee_is_done(ee_ctl);
 		if (!is_ee_done) {
-			msleep(time_step);
+			/* woken up by EE stage 2 and MDLOG_DUMP_DONE */
+			wait_event_timeout(ee_ctl->ee_done_wq,
+				fsm_ee_is_done(ee_ctl),
+				msecs_to_jiffies(time_step));
 			count++;
 		} else
 			break;
@@ -361,6 +398,8 @@ int fsm_ee_init(struct ccci_fsm_ee *ee_ctl)
 
 	ee_ctl->md_id = ctl->md_id;
 	spin_lock_init(&ee_ctl->ctrl_lock);
+	init_waitqueue_head(&ee_ctl->ee_done_wq);
+	INIT_WORK(&ee_ctl->dump_work, fsm_ee_deferred_dump);
 	if (ee_ctl->md_id == MD_SYS1) {
 #if (MD_GENERATION >= 6297)
 		ret = mdee_dumper_v5_alloc(ee_ctl);
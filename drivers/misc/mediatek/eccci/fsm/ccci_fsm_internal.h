@@ -211,6 +211,9 @@ struct ccci_fsm_ee {
 	char ex_mpu_string[MD_EX_MPU_STR_LEN];
 	char ex_start_time[MD_EX_START_TIME_LEN];
 	unsigned int mdlog_dump_done;
+	wait_queue_head_t ee_done_wq;
+	/* bulk memory dumps, run in parallel with the EE handshake */
+	struct work_struct dump_work;
 };
 
 struct ccci_fsm_monitor {
@@ -273,6 +276,8 @@ int fsm_append_command(struct ccci_fsm_ctl *ctl,
 	enum CCCI_FSM_COMMAND cmd_id, unsigned int flag);
 int fsm_append_event(struct ccci_fsm_ctl *ctl, enum CCCI_FSM_EVENT event_id,
 	unsigned char *data, unsigned int length);
+int fsm_poll_md_event(struct ccci_fsm_ctl *ctl, enum CCCI_FSM_EVENT event_id,
+	int timeout);
 
 #ifndef CCCI_KMODULE_ENABLE
 int fsm_scp_init(struct ccci_fsm_scp *scp_ctl);
@@ -578,6 +578,7 @@ long ccci_fsm_ioctl(int md_id, unsigned int cmd, unsigned long arg)
 		CCCI_NORMAL_LOG(md_id, FSM,
 		"MD logger dump done ioctl called by %s\n", current->comm);
 		ctl->ee_ctl.mdlog_dump_done = 1;
+		wake_up(&ctl->ee_ctl.ee_done_wq);
 		break;
 	case CCCI_IOC_RESET_MD1_MD3_PCCIF:
 		ccci_md_reset_pccif(md_id);
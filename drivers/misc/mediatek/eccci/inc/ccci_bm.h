@@ -83,6 +83,16 @@ void ccci_skb_enqueue(struct ccci_skb_queue *queue, struct sk_buff *newsk);
 void ccci_skb_queue_init(struct ccci_skb_queue *queue,
 	unsigned int skb_size, unsigned int max_len, char fill_now);
 void ccci_dump_skb_pool_usage(int md_id);
+
+/*
+ * zero-copy RX: HIF hands out page fragments as DMA buffers and wraps the
+ * filled ones with build_skb(). @len is the largest packet the buffer
+ * must hold and has to be the same for alloc and build.
+ */
+void *ccci_rx_frag_alloc(unsigned int len, gfp_t gfp_mask);
+struct sk_buff *ccci_rx_frag_build_skb(void *data, unsigned int len,
+	unsigned int pkt_len);
+void ccci_rx_frag_free(void *data);
 void ccci_error_dump(int md_id, void *start_addr, int len);
 void ccci_mem_dump(int md_id, void *start_addr, int len);
 void ccci_cmpt_mem_dump(int md_id, void *start_addr, int len);
@@ -30,6 +30,8 @@
 
 #define NET_ACK_TXQ_INDEX(p) ((p)->txq_exp_index&0x0F)
 #define GET_CCMNI_IDX(p) ((p)->minor - CCCI_NET_MINOR_BASE)
+/* same as a NAPI poll budget */
+#define NET_RX_BATCH_BUDGET 64
 
 /* now we only support MBIM Tx/Rx in CCMNI_U context */
 static atomic_t mbim_ccmni_index[MAX_MD_NUM];
@@ -378,6 +380,7 @@ static int port_net_init(struct port_t *port)
 		return -EINVAL;
 	}
 	port->minor += CCCI_NET_MINOR_BASE;
+	skb_queue_head_init(&port->port_rx_batch);
 	if (port->rx_ch == CCCI_CCMNI1_RX) {
 		atomic_set(&mbim_ccmni_index[port->md_id], -1);
 
@@ -439,6 +442,11 @@ int mtk_ccci_handle_port_list(int status, char *name)
 			!= NULL)
 			dev_kfree_skb_any(skb);
 		spin_unlock_irqrestore(&port->port_rx_list.lock, flags);
+		spin_lock_irqsave(&port->port_rx_batch.lock, flags);
+		while ((skb = __skb_dequeue(&port->port_rx_batch))
+			!= NULL)
+			dev_kfree_skb_any(skb);
+		spin_unlock_irqrestore(&port->port_rx_batch.lock, flags);
 		return ret;
 	}
 	while (!skb_queue_empty(&port->port_rx_list))
@@ -446,6 +454,31 @@ int mtk_ccci_handle_port_list(int status, char *name)
 	return ret;
 }
 
+static void ccmni_flush_rx_batch(struct port_t *port)
+{
+	struct sk_buff_head list;
+	unsigned long flags;
+
+	__skb_queue_head_init(&list);
+	spin_lock_irqsave(&port->port_rx_batch.lock, flags);
+	skb_queue_splice_init(&port->port_rx_batch, &list);
+	spin_unlock_irqrestore(&port->port_rx_batch.lock, flags);
+	if (!skb_queue_empty(&list))
+		ccmni_ops.rx_list_callback(port->md_id, GET_CCMNI_IDX(port),
+					&list);
+}
+
+/*
+ * Packets are only batched once the HIF has shown that it ends its Rx
+ * batches with RX_FLUSH, otherwise the last packets of a burst would
+ * wait for the next one.
+ */
+static inline int ccmni_rx_batch_enabled(struct port_t *port)
+{
+	return ccmni_ops.rx_list_callback &&
+		(port->flags & PORT_F_NET_RX_BATCH);
+}
+
 static void ccmni_queue_recv_skb(struct port_t *port, struct sk_buff *skb)
 {
 	unsigned long flags;
@@ -454,6 +487,14 @@ static void ccmni_queue_recv_skb(struct port_t *port, struct sk_buff *skb)
 		while (!skb_queue_empty(&port->port_rx_list))
 			recv_from_port_list(port);
 
+		if (ccmni_rx_batch_enabled(port)) {
+			skb_queue_tail(&port->port_rx_batch, skb);
+			if (skb_queue_len(&port->port_rx_batch) >=
+				NET_RX_BATCH_BUDGET)
+				ccmni_flush_rx_batch(port);
+			return;
+		}
+
 		/*The packet may be out of order when ccmni is up at the*/
 		/* same time, it will be correctly handled by TCP stack.*/
 		ccmni_ops.rx_callback(port->md_id, GET_CCMNI_IDX(port),
@@ -563,6 +604,15 @@ static void port_net_queue_state_notify(struct port_t *port, int dir,
 		}
 	}
 #endif
+	if (state == RX_FLUSH && dir == IN) {
+		if (!(port->flags & PORT_F_NET_RX_BATCH)) {
+			spin_lock_irqsave(&port->flag_lock, flags);
+			port->flags |= PORT_F_NET_RX_BATCH;
+			spin_unlock_irqrestore(&port->flag_lock, flags);
+		}
+		/* hand the batch over before ccmni flushes its GRO lists */
+		ccmni_flush_rx_batch(port);
+	}
 	ccmni_ops.queue_state_callback(port->md_id,
 		GET_CCMNI_IDX(port), state, is_ack);
 
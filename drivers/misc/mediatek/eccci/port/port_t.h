@@ -32,6 +32,8 @@
 #define PORT_F_CLEAN            (1<<9)
 /*Dump pkt of ccmni*/
 #define PORT_F_NET_DUMP         (1<<10)
+/*HIF ends its Rx batches with RX_FLUSH, net pkts can be delivered as a list*/
+#define PORT_F_NET_RX_BATCH     (1<<11)
 enum {
 	PORT_DBG_DUMP_RILD = 0,
 	PORT_DBG_DUMP_AUDIO,
@@ -113,6 +115,7 @@ struct port_t {
 	unsigned int tx_pkg_cnt;
 	port_skb_handler skb_handler;
 	struct sk_buff_head port_rx_list;
+	struct sk_buff_head port_rx_batch; /*delivered to ccmni on RX_FLUSH*/
 	atomic_t is_up; /*for ccmni status*/
 	spinlock_t flag_lock;
 };
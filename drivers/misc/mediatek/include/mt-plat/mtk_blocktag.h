@@ -39,6 +39,28 @@ struct page_pid_logger {
 	short mode;
 };
 
+/*
+ * Sampling pid logger: instead of tagging every page, 1 out of
+ * pidlog_sample_rate bios is recorded in a small per-CPU ring at submit
+ * time, so memory no longer scales with DRAM size.
+ */
+#define BLOCKTAG_PIDLOG_SAMPLES 256
+
+struct mtk_btag_pidlog_sample {
+	pid_t pid;
+	__u32 len;
+	bool write;
+	char comm[TASK_COMM_LEN];
+};
+
+struct mtk_btag_pidlog_sample_ring {
+	spinlock_t lock;
+	unsigned int count;	/* bios seen, to pick every Nth one */
+	unsigned int head;
+	unsigned int nr;
+	struct mtk_btag_pidlog_sample ent[BLOCKTAG_PIDLOG_SAMPLES];
+};
+
 #ifdef CONFIG_MTK_USE_RESERVED_EXT_MEM
 extern void *extmem_malloc_page_align(size_t bytes);
 #endif
@@ -112,6 +134,21 @@ struct mtk_btag_mictx_iostat_struct {
 	__u16 q_depth;   /* storage cmdq queue depth */
 };
 
+/*
+ * Latency SLO of top-app requests: a log2(us) histogram of the current
+ * window, from which p95 is taken when the window closes.
+ */
+#define BTAG_SLO_BUCKETS	16
+
+struct mtk_btag_slo {
+	__u64 window_begin;
+	__u32 hist[BTAG_SLO_BUCKETS];
+	__u32 count;
+	__u32 p95_us;      /* p95 of the last closed window */
+	__u32 violations;  /* windows whose p95 missed the target */
+	__u16 level;       /* boost level requested by the SLO, 0 = none */
+};
+
 /*
  * mini context for integration with
  * other performance analysis tools.
@@ -142,6 +179,9 @@ struct mtk_btag_mictx_struct {
 	bool earaio_allowed;
 	bool uevt_req;
 	bool uevt_state;
+	__u16 uevt_level_req;
+	__u16 uevt_level_state;
+	struct mtk_btag_slo slo;
 	struct workqueue_struct *uevt_workq;
 	struct work_struct uevt_work;
 };
@@ -252,7 +292,7 @@ void mtk_btag_free(struct mtk_blocktag *btag);
 
 struct mtk_btag_trace *mtk_btag_curr_trace(struct mtk_btag_ringtrace *rt);
 struct mtk_btag_trace *mtk_btag_next_trace(struct mtk_btag_ringtrace *rt);
-void mtk_btag_commit_req(struct request *rq, bool is_sd);
+bool mtk_btag_commit_req(struct request *rq, bool is_sd);
 int mtk_btag_pidlog_add_mmc(struct request_queue *q, short pid,
 	__u32 len, int rw, bool is_sd);
 int mtk_btag_pidlog_add_ufs(struct request_queue *q, short pid, __u32 len,
@@ -289,6 +329,8 @@ void mtk_btag_mictx_eval_tp(
 void mtk_btag_mictx_eval_req(
 	struct mtk_blocktag *btag,
 	unsigned int rw, __u32 cnt, __u32 size, bool top);
+void mtk_btag_mictx_eval_lat(struct mtk_blocktag *btag, bool top,
+	__u64 lat);
 int mtk_btag_mictx_get_data(
 	struct mtk_btag_mictx_iostat_struct *iostat);
 void mtk_btag_mictx_update(struct mtk_blocktag *btag, __u32 q_depth);
@@ -325,6 +367,7 @@ void set_mmc_perf_mode(struct mmc_host *mmc, bool boost);
 #define mtk_btag_mictx_enable(...)
 #define mtk_btag_mictx_eval_tp(...)
 #define mtk_btag_mictx_eval_req(...)
+#define mtk_btag_mictx_eval_lat(...)
 #define mtk_btag_mictx_get_data(...)
 #define mtk_btag_mictx_update(...)
 
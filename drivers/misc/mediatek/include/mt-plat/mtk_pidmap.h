@@ -28,6 +28,33 @@ enum PIDMAP_PROC_MODE {
 	PIDMAP_PROC_DUMP_READABLE = 1,
 };
 
+/*
+ * /proc/pidmap_delta, incremental export for continuous profilers.
+ *
+ * read() returns whole struct pidmap_delta records. A new reader first
+ * gets one PIDMAP_DELTA_SNAPSHOT record per known pid followed by
+ * PIDMAP_DELTA_SNAPSHOT_END, then every NEW/RENAME logged after the
+ * snapshot started. If the reader falls more than PIDMAP_DELTA_CNT
+ * records behind, it gets a fresh snapshot instead of the lost deltas.
+ */
+#define PIDMAP_DELTA_CNT          (1024)	/* power of two */
+
+enum PIDMAP_DELTA_TYPE {
+	PIDMAP_DELTA_NEW          = 0,
+	PIDMAP_DELTA_RENAME       = 1,
+	PIDMAP_DELTA_SNAPSHOT     = 2,
+	PIDMAP_DELTA_SNAPSHOT_END = 3,
+};
+
+struct pidmap_delta {
+	__u64 seq;
+	__s32 pid;
+	__s32 tgid;
+	__u32 type;
+	__u32 reserved;
+	char comm[TASK_COMM_LEN];
+};
+
 #ifndef USER_BUILD_KERNEL
 #define PIDMAP_PROC_PERM          (0660)
 #else
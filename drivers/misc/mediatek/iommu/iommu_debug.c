@@ -17,6 +17,8 @@
 #include <linux/platform_device.h>
 #include <linux/of_platform.h>
 #include <linux/list_sort.h>
+#include <linux/rbtree.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
@@ -3329,17 +3331,126 @@ struct iova_map_info {
 	u64			time_high;
 	u64			time_low;
 	size_t			size;
-	struct list_head	list_node;
+	struct rb_node		node;
 };
 
+/* per iova space, sorted by iova so unmap doesn't walk every mapping */
 struct iova_map_list {
 	atomic_t		init_flag;
 	spinlock_t		lock;
-	struct list_head	head[MTK_IOVA_SPACE_NUM];
+	struct rb_root		root[MTK_IOVA_SPACE_NUM];
 };
 
 static struct iova_map_list map_list = {.init_flag = ATOMIC_INIT(0)};
 
+static void iova_map_insert(struct rb_root *root, struct iova_map_info *new)
+{
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+	struct iova_map_info *info;
+
+	while (*p) {
+		parent = *p;
+		info = rb_entry(parent, struct iova_map_info, node);
+		if (new->iova < info->iova)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&new->node, parent, p);
+	rb_insert_color(&new->node, root);
+}
+
+/* the lowest mapping at or above @iova */
+static struct iova_map_info *iova_map_first(struct rb_root *root, u64 iova)
+{
+	struct rb_node *node = root->rb_node;
+	struct iova_map_info *info, *first = NULL;
+
+	while (node) {
+		info = rb_entry(node, struct iova_map_info, node);
+		if (info->iova >= iova) {
+			first = info;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return first;
+}
+
+static struct iova_map_info *iova_map_next(struct iova_map_info *info)
+{
+	return rb_entry_safe(rb_next(&info->node), struct iova_map_info, node);
+}
+
+/* latency buckets: <1us, <10us, <100us, <1ms, >=1ms */
+#define IOMMU_OP_HIST_NUM	5
+
+struct iommu_op_stat {
+	atomic64_t	count;
+	atomic64_t	bytes;
+	atomic64_t	total_ns;
+	u64		max_ns;
+	atomic64_t	hist[IOMMU_OP_HIST_NUM];
+};
+
+static struct iommu_op_stat op_stats[MTK_IOMMU_OP_NUM];
+static const char * const op_stat_name[MTK_IOMMU_OP_NUM] = {
+	"map", "unmap", "sync",
+};
+static atomic64_t sync_trace_count = ATOMIC64_INIT(0);
+static atomic64_t sync_trace_bytes = ATOMIC64_INIT(0);
+
+void mtk_iommu_op_time(enum mtk_iommu_op op, size_t size, u64 ns)
+{
+	struct iommu_op_stat *st;
+	u64 limit = NSEC_PER_USEC;
+	int i;
+
+	if (op >= MTK_IOMMU_OP_NUM)
+		return;
+
+	st = &op_stats[op];
+	atomic64_inc(&st->count);
+	atomic64_add(size, &st->bytes);
+	atomic64_add(ns, &st->total_ns);
+	/* racy, but only ever grows */
+	if (ns > READ_ONCE(st->max_ns))
+		WRITE_ONCE(st->max_ns, ns);
+
+	for (i = 0; i < IOMMU_OP_HIST_NUM - 1 && ns >= limit; i++)
+		limit *= 10;
+	atomic64_inc(&st->hist[i]);
+}
+EXPORT_SYMBOL_GPL(mtk_iommu_op_time);
+
+static void mtk_iommu_op_stats_dump(struct seq_file *s)
+{
+	int i, j;
+
+	iommu_dump(s, "iommu op stats:\n");
+	iommu_dump(s, "%-6s %-10s %-14s %-10s %-10s %s\n", "op", "count",
+		   "bytes", "avg_ns", "max_ns",
+		   "<1us <10us <100us <1ms >=1ms");
+	for (i = 0; i < MTK_IOMMU_OP_NUM; i++) {
+		struct iommu_op_stat *st = &op_stats[i];
+		u64 count = atomic64_read(&st->count);
+
+		iommu_dump(s, "%-6s %-10llu %-14llu %-10llu %-10llu",
+			   op_stat_name[i], count, atomic64_read(&st->bytes),
+			   count ? div64_u64(atomic64_read(&st->total_ns),
+					     count) : 0,
+			   READ_ONCE(st->max_ns));
+		for (j = 0; j < IOMMU_OP_HIST_NUM; j++)
+			iommu_dump(s, " %llu", atomic64_read(&st->hist[j]));
+		iommu_dump(s, "\n");
+	}
+	iommu_dump(s, "tlb sync trace: count %llu, bytes %llu\n",
+		   atomic64_read(&sync_trace_count),
+		   atomic64_read(&sync_trace_bytes));
+}
+
 void mtk_iova_map(int tab_id, u64 iova, size_t size)
 {
 	u32 id = (iova >> 32);
@@ -3362,7 +3473,7 @@ void mtk_iova_map(int tab_id, u64 iova, size_t size)
 	iova_buf->iova = iova;
 	iova_buf->size = size;
 	spin_lock_irqsave(&map_list.lock, flags);
-	list_add(&iova_buf->list_node, &map_list.head[id]);
+	iova_map_insert(&map_list.root[id], iova_buf);
 	spin_unlock_irqrestore(&map_list.lock, flags);
 
 	mtk_iommu_iova_trace(IOMMU_MAP, iova, size, tab_id, NULL);
@@ -3385,17 +3496,18 @@ void mtk_iova_unmap(int tab_id, u64 iova, size_t size)
 
 	spin_lock_irqsave(&map_list.lock, flags);
 	start_t = sched_clock();
-	list_for_each_entry_safe(plist, tmp_plist,
-				 &map_list.head[id], list_node) {
-		if (plist->iova >= iova &&
-		    (plist->iova + plist->size) <= (iova + size) &&
+	plist = iova_map_first(&map_list.root[id], iova);
+	while (plist && plist->iova < iova + size) {
+		tmp_plist = iova_map_next(plist);
+		if ((plist->iova + plist->size) <= (iova + size) &&
 		    plist->tab_id == tab_id) {
 			total += plist->size;
-			list_del(&plist->list_node);
+			rb_erase(&plist->node, &map_list.root[id]);
 			kfree(plist);
 			if (total == size)
 				break;
 		}
+		plist = tmp_plist;
 	}
 	end_t = sched_clock();
 	if ((end_t - start_t) > 5000000) //5ms
@@ -3417,7 +3529,7 @@ static void mtk_iommu_iova_map_dump(struct seq_file *s, u64 iova, u32 tab_id)
 	u32 i, id = (iova >> 32);
 	unsigned long flags;
 	struct iova_map_info *plist = NULL;
-	struct iova_map_info *n = NULL;
+	struct rb_node *rb;
 
 	if (id >= MTK_IOVA_SPACE_NUM) {
 		pr_err("out of iova space: 0x%llx\n", iova);
@@ -3431,21 +3543,24 @@ static void mtk_iommu_iova_map_dump(struct seq_file *s, u64 iova, u32 tab_id)
 	spin_lock_irqsave(&map_list.lock, flags);
 	if (!iova) {
 		for (i = 0; i < MTK_IOVA_SPACE_NUM; i++) {
-			list_for_each_entry_safe(plist, n, &map_list.head[i], list_node)
+			for (rb = rb_first(&map_list.root[i]); rb; rb = rb_next(rb)) {
+				plist = rb_entry(rb, struct iova_map_info, node);
 				if (plist->tab_id == tab_id)
 					iommu_dump(s, "%-6u 0x%-12llx 0x%-8zx %u.%06u\n",
 						   plist->tab_id, plist->iova,
 						   plist->size,
 						   plist->time_high,
 						   plist->time_low);
+			}
 		}
 		spin_unlock_irqrestore(&map_list.lock, flags);
 		return;
 	}
 
-	list_for_each_entry_safe(plist, n, &map_list.head[id], list_node)
-		if (plist->tab_id == tab_id && iova <= (plist->iova + SZ_4M) &&
-		    iova >= (plist->iova - SZ_4M))
+	plist = iova_map_first(&map_list.root[id],
+			       iova > SZ_4M ? iova - SZ_4M : 0);
+	for (; plist && plist->iova <= iova + SZ_4M; plist = iova_map_next(plist))
+		if (plist->tab_id == tab_id)
 			iommu_dump(s, "%-6u 0x%-12llx 0x%-8zx %u.%06u\n",
 				plist->tab_id, plist->iova,
 				plist->size,
@@ -3712,7 +3827,8 @@ static int mtk_iommu_debug_help(struct seq_file *s)
 	iommu_dump(s, "debug: iommu main debug file, receive debug command\n");
 	iommu_dump(s, "iommu_dump: iova trace dump file\n");
 	iommu_dump(s, "iova_alloc: iova alloc list dump file\n");
-	iommu_dump(s, "iova_map: iova map list dump file\n\n");
+	iommu_dump(s, "iova_map: iova map list dump file\n");
+	iommu_dump(s, "iova_stats: map/unmap/tlb sync count and latency\n\n");
 
 	iommu_dump(s, "iommu debug command:\n");
 	iommu_dump(s, "echo 1 > /proc/iommu_debug/debug: iommu debug help\n");
@@ -3995,8 +4111,16 @@ DEFINE_PROC_FOPS_RO(mtk_iommu_help_fops);
 DEFINE_PROC_FOPS_RO(mtk_iommu_dump_fops);
 /* adb shell cat /proc/iommu_debug/iova_alloc */
 DEFINE_PROC_FOPS_RO(mtk_iommu_iova_alloc_fops);
+static int mtk_iommu_iova_stats_fops_proc_show(struct seq_file *s, void *unused)
+{
+	mtk_iommu_op_stats_dump(s);
+	return 0;
+}
+
 /* adb shell cat /proc/iommu_debug/iova_map */
 DEFINE_PROC_FOPS_RO(mtk_iommu_iova_map_fops);
+/* adb shell cat /proc/iommu_debug/iova_stats */
+DEFINE_PROC_FOPS_RO(mtk_iommu_iova_stats_fops);
 #endif
 
 static void mtk_iommu_trace_init(struct mtk_m4u_data *data)
@@ -4100,6 +4224,8 @@ static void mtk_iommu_iova_trace(int event, dma_addr_t iova, size_t size,
 
 void mtk_iommu_tlb_sync_trace(u64 iova, size_t size, int iommu_ids)
 {
+	atomic64_inc(&sync_trace_count);
+	atomic64_add(size, &sync_trace_bytes);
 	mtk_iommu_trace_rec_write(IOMMU_SYNC, (unsigned long) iova, size,
 				(unsigned long) iommu_ids, NULL);
 }
@@ -4153,6 +4279,11 @@ static int m4u_debug_init(struct mtk_m4u_data *data)
 			S_IFREG | 0644, data->debug_root, &mtk_iommu_iova_map_fops, NULL);
 		if (IS_ERR_OR_NULL(debug_file))
 			pr_err("failed to proc_create iova_map file\n");
+
+		debug_file = proc_create_data("iova_stats",
+			S_IFREG | 0644, data->debug_root, &mtk_iommu_iova_stats_fops, NULL);
+		if (IS_ERR_OR_NULL(debug_file))
+			pr_err("failed to proc_create iova_stats file\n");
 	}
 
 	mtk_iommu_trace_init(data);
@@ -4164,10 +4295,10 @@ static int m4u_debug_init(struct mtk_m4u_data *data)
 
 	if (!atomic_cmpxchg(&map_list.init_flag, 0, 1)) {
 		spin_lock_init(&map_list.lock);
-		INIT_LIST_HEAD(&map_list.head[MTK_IOVA_SPACE0]);
-		INIT_LIST_HEAD(&map_list.head[MTK_IOVA_SPACE1]);
-		INIT_LIST_HEAD(&map_list.head[MTK_IOVA_SPACE2]);
-		INIT_LIST_HEAD(&map_list.head[MTK_IOVA_SPACE3]);
+		map_list.root[MTK_IOVA_SPACE0] = RB_ROOT;
+		map_list.root[MTK_IOVA_SPACE1] = RB_ROOT;
+		map_list.root[MTK_IOVA_SPACE2] = RB_ROOT;
+		map_list.root[MTK_IOVA_SPACE3] = RB_ROOT;
 	}
 
 	spin_lock_init(&count_list.lock);
@@ -53,6 +53,16 @@ void mtk_iova_map_dump(u64 iova, u32 tab_id);
 void mtk_iommu_tlb_sync_trace(u64 iova, size_t size, int iommu_ids);
 void mtk_iommu_pm_trace(struct device *dev, bool resume);
 
+enum mtk_iommu_op {
+	MTK_IOMMU_OP_MAP,
+	MTK_IOMMU_OP_UNMAP,
+	MTK_IOMMU_OP_SYNC,
+	MTK_IOMMU_OP_NUM,
+};
+
+/* account one map/unmap/tlb sync of @size bytes that took @ns */
+void mtk_iommu_op_time(enum mtk_iommu_op op, size_t size, u64 ns);
+
 void mtk_iommu_debug_reset(void);
 enum peri_iommu get_peri_iommu_id(u32 bus_id);
 char *peri_tf_analyse(enum peri_iommu iommu_id, u32 fault_id);
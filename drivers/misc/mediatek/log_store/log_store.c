@@ -25,6 +25,9 @@
 #include <linux/kmsg_dump.h>
 #include <linux/suspend.h>
 #include <linux/platform_device.h>
+#include <linux/lz4.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/workqueue.h>
 #include "log_store_kernel.h"
 
 static struct sram_log_header *sram_header;
@@ -285,6 +288,362 @@ static const struct proc_ops pl_lk_file_ops = {
 	.proc_release = single_release,
 };
 
+#if IS_ENABLED(CONFIG_MTK_DRAM_LOG_STORE_LZ4)
+/*
+ * Kernel log kept lz4 compressed in a reserved region (the "memory-region"
+ * of the logstore node), in the format described in log_store_kernel.h.
+ * A worker compresses the printk records into KLOG_LZ4_RAW_SIZE blocks;
+ * the block being filled is only written out once full or from the kmsg
+ * dumper on panic and reboot, and until then is still in the printk
+ * buffer the preloader saves.
+ *
+ * The previous boot's region is left alone and exposed read-only at
+ * /proc/klog_lz4_last (read or mmap) until "0" is written to it or
+ * lz4_hold_s expires, and only then reused.
+ */
+#define KLOG_LZ4_RAW_SIZE (32 * 1024)
+#define KLOG_LZ4_LINE_MAX (1024)
+
+static unsigned int klog_lz4_interval_ms = 2000;
+module_param_named(lz4_interval_ms, klog_lz4_interval_ms, uint, 0644);
+MODULE_PARM_DESC(lz4_interval_ms, "lz4 kernel log store interval");
+
+static unsigned int klog_lz4_hold_s = 300;
+module_param_named(lz4_hold_s, klog_lz4_hold_s, uint, 0444);
+MODULE_PARM_DESC(lz4_hold_s, "keep the last boot lz4 kernel log this long");
+
+static struct klog_lz4_header *klog_hdr;
+static char *klog_ring;
+static phys_addr_t klog_phys;
+static size_t klog_size;
+static bool klog_last_valid;
+static bool klog_running;
+static DEFINE_SPINLOCK(klog_lock);
+/* private printk cursor, never registered */
+static struct kmsg_dumper klog_iter;
+static struct kmsg_dumper klog_dumper;
+static char *klog_raw;
+static size_t klog_raw_len;
+static u32 klog_raw_seq;
+static char *klog_line;
+static char *klog_comp;
+static void *klog_wrkmem;
+static struct delayed_work klog_work;
+static struct proc_dir_entry *klog_entry;
+
+static void klog_lz4_evict(void)
+{
+	u32 head = klog_hdr->head;
+	struct klog_lz4_block *blk = (void *)(klog_ring + head);
+
+	if (head + sizeof(*blk) > klog_hdr->size ||
+	    blk->magic == KLOG_LZ4_WRAP_MAGIC) {
+		head = 0;
+	} else {
+		head += ALIGN(sizeof(*blk) + blk->clen, KLOG_LZ4_ALIGN);
+		klog_hdr->nr_blocks--;
+	}
+	klog_hdr->head = head;
+}
+
+static void klog_lz4_commit(u32 clen)
+{
+	u32 total = ALIGN(sizeof(struct klog_lz4_block) + clen, KLOG_LZ4_ALIGN);
+	u32 pos = klog_hdr->tail;
+	struct klog_lz4_block *blk;
+
+	if (pos + total > klog_hdr->size) {
+		/* drop the blocks up to the end of the ring, then wrap */
+		while (klog_hdr->nr_blocks && klog_hdr->head >= pos)
+			klog_lz4_evict();
+		if (pos + sizeof(*blk) <= klog_hdr->size) {
+			blk = (void *)(klog_ring + pos);
+			blk->magic = KLOG_LZ4_WRAP_MAGIC;
+		}
+		pos = 0;
+	}
+	while (klog_hdr->nr_blocks && klog_hdr->head >= pos &&
+	       klog_hdr->head < pos + total)
+		klog_lz4_evict();
+	if (!klog_hdr->nr_blocks)
+		klog_hdr->head = pos;
+	/* evicted blocks leave head..tail before they get overwritten */
+	wmb();
+
+	blk = (void *)(klog_ring + pos);
+	memcpy(blk + 1, klog_comp, clen);
+	blk->clen = clen;
+	blk->rlen = klog_raw_len;
+	blk->seq = klog_raw_seq;
+	blk->magic = KLOG_LZ4_BLOCK_MAGIC;
+	/* the block is complete before tail covers it */
+	wmb();
+	klog_hdr->tail = pos + total;
+	klog_hdr->nr_blocks++;
+}
+
+/* klog_lock must be held */
+static void klog_lz4_flush(void)
+{
+	int clen;
+
+	if (!klog_raw_len)
+		return;
+
+	clen = LZ4_compress_default(klog_raw, klog_comp, klog_raw_len,
+			LZ4_COMPRESSBOUND(KLOG_LZ4_RAW_SIZE), klog_wrkmem);
+	if (clen > 0)
+		klog_lz4_commit(clen);
+	klog_raw_len = 0;
+}
+
+/*
+ * Move printk records into the raw block. Stops once a full block has
+ * been written out and returns true if there may be more to do.
+ * klog_lock must be held.
+ */
+static bool klog_lz4_drain(void)
+{
+	size_t len;
+	u64 seq;
+
+	for (;;) {
+		seq = klog_iter.cur_seq;
+		if (!kmsg_dump_get_line(&klog_iter, true, klog_line,
+					KLOG_LZ4_LINE_MAX, &len))
+			return false;
+
+		/* cur_seq is one past the record just read */
+		klog_hdr->lost += klog_iter.cur_seq - 1 - seq;
+
+		if (klog_raw_len + len > KLOG_LZ4_RAW_SIZE) {
+			klog_lz4_flush();
+			klog_raw_seq = klog_iter.cur_seq - 1;
+			memcpy(klog_raw, klog_line, len);
+			klog_raw_len = len;
+			return true;
+		}
+		if (!klog_raw_len)
+			klog_raw_seq = klog_iter.cur_seq - 1;
+		memcpy(klog_raw + klog_raw_len, klog_line, len);
+		klog_raw_len += len;
+	}
+}
+
+static void klog_lz4_start(void)
+{
+	spin_lock(&klog_lock);
+	WRITE_ONCE(klog_last_valid, false);
+	klog_hdr->sig = 0;
+	wmb();
+	klog_hdr->version = KLOG_LZ4_VERSION;
+	klog_hdr->size = klog_size - sizeof(*klog_hdr);
+	klog_hdr->head = 0;
+	klog_hdr->tail = 0;
+	klog_hdr->nr_blocks = 0;
+	klog_hdr->lost = 0;
+	wmb();
+	klog_hdr->sig = KLOG_LZ4_SIG;
+
+	klog_iter.active = true;
+	kmsg_dump_rewind(&klog_iter);
+	klog_raw_len = 0;
+	WRITE_ONCE(klog_running, true);
+	spin_unlock(&klog_lock);
+	pr_notice("log_store: lz4 klog started, region 0x%zx bytes.\n",
+		klog_size);
+}
+
+static void klog_lz4_work_fn(struct work_struct *work)
+{
+	bool more;
+
+	if (!READ_ONCE(klog_running))
+		klog_lz4_start();
+
+	do {
+		spin_lock(&klog_lock);
+		more = klog_lz4_drain();
+		spin_unlock(&klog_lock);
+		cond_resched();
+	} while (more);
+
+	schedule_delayed_work(&klog_work,
+		msecs_to_jiffies(klog_lz4_interval_ms));
+}
+
+static void klog_lz4_dump(struct kmsg_dumper *dumper,
+	enum kmsg_dump_reason reason)
+{
+	/* the worker was interrupted mid block, leave it to the printk buffer */
+	if (!READ_ONCE(klog_running) || !spin_trylock(&klog_lock))
+		return;
+
+	while (klog_lz4_drain())
+		;
+	klog_lz4_flush();
+	spin_unlock(&klog_lock);
+}
+
+static ssize_t klog_lz4_last_read(struct file *file, char __user *ubuf,
+	size_t cnt, loff_t *ppos)
+{
+	if (!READ_ONCE(klog_last_valid))
+		return -ENODATA;
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, klog_hdr, klog_size);
+}
+
+static ssize_t klog_lz4_last_write(struct file *file,
+	const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 10, &val);
+	if (ret < 0)
+		return ret;
+
+	/* done with the last boot log, start storing this boot */
+	if (val == 0 && !READ_ONCE(klog_running))
+		mod_delayed_work(system_wq, &klog_work, 0);
+
+	return cnt;
+}
+
+static int klog_lz4_last_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	size_t size = vma->vm_end - vma->vm_start;
+
+	if (!READ_ONCE(klog_last_valid))
+		return -ENODATA;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff || size > PAGE_ALIGN(klog_size))
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start, klog_phys >> PAGE_SHIFT,
+			size, vma->vm_page_prot);
+}
+
+static const struct proc_ops klog_lz4_last_ops = {
+	.proc_read = klog_lz4_last_read,
+	.proc_write = klog_lz4_last_write,
+	.proc_mmap = klog_lz4_last_mmap,
+	.proc_lseek = default_llseek,
+};
+
+static void klog_lz4_free(void)
+{
+	vfree(klog_raw);
+	vfree(klog_comp);
+	vfree(klog_wrkmem);
+	kfree(klog_line);
+	klog_raw = NULL;
+	klog_comp = NULL;
+	klog_wrkmem = NULL;
+	klog_line = NULL;
+}
+
+static void klog_lz4_init(void)
+{
+	struct device_node *np, *np_mem;
+	struct reserved_mem *rmem;
+
+	if (!sram_header)
+		return;
+
+	np = of_find_node_by_name(NULL, "logstore");
+	if (!np)
+		return;
+	np_mem = of_parse_phandle(np, "memory-region", 0);
+	of_node_put(np);
+	if (!np_mem)
+		return;
+	rmem = of_reserved_mem_lookup(np_mem);
+	of_node_put(np_mem);
+	if (!rmem || !PAGE_ALIGNED(rmem->base) ||
+	    rmem->size < sizeof(*klog_hdr) +
+			 4 * LZ4_COMPRESSBOUND(KLOG_LZ4_RAW_SIZE)) {
+		pr_notice("log_store: no usable lz4 klog region.\n");
+		return;
+	}
+
+	klog_raw = vmalloc(KLOG_LZ4_RAW_SIZE);
+	klog_comp = vmalloc(LZ4_COMPRESSBOUND(KLOG_LZ4_RAW_SIZE));
+	klog_wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	klog_line = kmalloc(KLOG_LZ4_LINE_MAX, GFP_KERNEL);
+	if (!klog_raw || !klog_comp || !klog_wrkmem || !klog_line) {
+		klog_lz4_free();
+		return;
+	}
+
+	klog_hdr = remap_lowmem(rmem->base, rmem->size);
+	if (!klog_hdr) {
+		klog_lz4_free();
+		return;
+	}
+	klog_phys = rmem->base;
+	klog_size = rmem->size;
+	klog_ring = (char *)(klog_hdr + 1);
+	klog_last_valid = klog_hdr->sig == KLOG_LZ4_SIG &&
+		klog_hdr->version == KLOG_LZ4_VERSION &&
+		klog_hdr->size == klog_size - sizeof(*klog_hdr);
+
+	/* let the preloader know where to find it, same as klog_addr */
+#ifdef CONFIG_PHYS_ADDR_T_64BIT
+	if ((klog_phys >> 32) == 0)
+		sram_header->reserve[SRAM_KLOG_LZ4_ADDR] =
+			(u32)(klog_phys & 0xffffffff);
+	else
+		sram_header->reserve[SRAM_KLOG_LZ4_ADDR] = 0;
+#else
+	sram_header->reserve[SRAM_KLOG_LZ4_ADDR] = klog_phys;
+#endif
+	sram_header->reserve[SRAM_KLOG_LZ4_SIZE] = klog_size;
+
+	INIT_DELAYED_WORK(&klog_work, klog_lz4_work_fn);
+	klog_dumper.dump = klog_lz4_dump;
+	klog_dumper.max_reason = KMSG_DUMP_MAX;
+	kmsg_dump_register(&klog_dumper);
+
+	if (klog_last_valid) {
+		klog_entry = proc_create("klog_lz4_last", 0640, NULL,
+				&klog_lz4_last_ops);
+		pr_notice("log_store: last lz4 klog %u blocks, lost %u.\n",
+			klog_hdr->nr_blocks, klog_hdr->lost);
+	}
+	schedule_delayed_work(&klog_work,
+		klog_last_valid ? klog_lz4_hold_s * HZ : 0);
+}
+
+#ifdef MODULE
+static void klog_lz4_exit(void)
+{
+	if (!klog_hdr)
+		return;
+
+	kmsg_dump_unregister(&klog_dumper);
+	cancel_delayed_work_sync(&klog_work);
+	if (klog_entry)
+		proc_remove(klog_entry);
+	vunmap(klog_hdr);
+	klog_lz4_free();
+}
+#endif
+#else
+static inline void klog_lz4_init(void)
+{
+}
+
+static inline void klog_lz4_exit(void)
+{
+}
+#endif
+
 struct logstore_tag_bootmode {
 	u32 size;
 	u32 tag;
@@ -329,6 +688,7 @@ static int __init log_store_late_init(void)
 	logstore_pm_nb.notifier_call = logstore_pm_notify;
 	register_pm_notifier(&logstore_pm_nb);
 	set_boot_phase(BOOT_PHASE_KERNEL);
+	klog_lz4_init();
 	if (sram_dram_buff == NULL) {
 		pr_notice("log_store: sram header DRAM buff is null.\n");
 		dram_log_store_status = BUFF_ALLOC_ERROR;
@@ -527,6 +887,7 @@ static void __exit log_store_exit(void)
 
 	if (entry)
 		proc_remove(entry);
+	klog_lz4_exit();
 
 	logstore_pm_nb.notifier_call = logstore_pm_notify;
 	unregister_pm_notifier(&logstore_pm_nb);
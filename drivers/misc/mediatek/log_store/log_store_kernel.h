@@ -83,11 +83,51 @@ struct sram_log_header {
 	/* reserve[1] save block size for kernel use */
 	/* reserve[2] pmic save boot phase enable/disable */
 	/* reserve[3] save history boot phase */
+	/* reserve[4] lz4 kernel log region address */
+	/* reserve[5] lz4 kernel log region size */
 } __packed;
 #define SRAM_RECORD_LOG_SIZE 0X00
 #define SRAM_BLOCK_SIZE 0x01
 #define SRAM_PMIC_BOOT_PHASE 0x02
 #define SRAM_HISTORY_BOOT_PHASE 0x03
+#define SRAM_KLOG_LZ4_ADDR 0x04
+#define SRAM_KLOG_LZ4_SIZE 0x05
+
+/*
+ * lz4 kernel log region: a klog_lz4_header followed by a ring of blocks.
+ * Each block is a klog_lz4_block followed by clen bytes of one lz4 block
+ * (no frame) that decompresses to rlen bytes of "<level>text\n" lines,
+ * padded to KLOG_LZ4_ALIGN. The live blocks run from head to tail, and
+ * a KLOG_LZ4_WRAP_MAGIC block, or less than a block header left before
+ * the end of the ring, means the next block is at offset 0. head and
+ * tail are only updated once the blocks they cover are complete, so the
+ * region stays readable whenever the system goes down.
+ */
+#define KLOG_LZ4_SIG 0x345a4c4b		// ascii-KLZ4
+#define KLOG_LZ4_VERSION 1
+#define KLOG_LZ4_BLOCK_MAGIC 0x4b4c4221	// ascii-!BLK
+#define KLOG_LZ4_WRAP_MAGIC 0x4b4c5721	// ascii-!WLK
+#define KLOG_LZ4_ALIGN 8
+
+/* total 32 bytes */
+struct klog_lz4_header {
+	u32 sig;
+	u32 version;
+	u32 size;		// ring size, following this header
+	u32 head;		// ring offset of the oldest block
+	u32 tail;		// ring offset past the newest block
+	u32 nr_blocks;
+	u32 lost;		// records dropped before they were stored
+	u32 reserve;
+} __packed;
+
+/* total 16 bytes */
+struct klog_lz4_block {
+	u32 magic;
+	u32 clen;		// compressed size
+	u32 rlen;		// uncompressed size
+	u32 seq;		// low 32 bits of the first record's sequence
+} __packed;
 
 
 /* emmc last block struct */
@@ -15,7 +15,10 @@
 #include <net/netfilter/nf_conntrack_extend.h>
 #include <net/route.h>
 #include <linux/in6.h>
+#include <linux/rhashtable.h>
 #include <linux/timer.h>
+#include <linux/workqueue.h>
+#include <net/genetlink.h>
 
 #include "mddp_ctrl.h"
 #include "mddp_debug.h"
@@ -55,6 +58,36 @@ struct mddp_f_cb {
 	bool is_uplink;
 };
 
+/*
+ * "MDDP_FLOW" generic netlink family, see mddp_filter_nl.c. A dump of
+ * MDDP_FLOW_CMD_GET lists the tracked IPv4 flows; the "events" group
+ * reports flows handed to MD (NEW), aged out (DEL) or not trackable (MISS).
+ */
+enum mddp_flow_cmd_e {
+	MDDP_FLOW_CMD_UNSPEC,
+	MDDP_FLOW_CMD_GET,
+	MDDP_FLOW_CMD_NEW,
+	MDDP_FLOW_CMD_DEL,
+	MDDP_FLOW_CMD_MISS,
+	__MDDP_FLOW_CMD_MAX,
+};
+
+enum mddp_flow_attr_e {
+	MDDP_FLOW_ATTR_UNSPEC,
+	MDDP_FLOW_ATTR_PAD,
+	MDDP_FLOW_ATTR_SRC_IP,		/* be32 */
+	MDDP_FLOW_ATTR_DST_IP,		/* be32 */
+	MDDP_FLOW_ATTR_SRC_PORT,	/* be16 */
+	MDDP_FLOW_ATTR_DST_PORT,	/* be16 */
+	MDDP_FLOW_ATTR_PROTO,		/* u8 */
+	MDDP_FLOW_ATTR_PACKETS,		/* u64, seen by the kernel path */
+	MDDP_FLOW_ATTR_BYTES,		/* u64, seen by the kernel path */
+	MDDP_FLOW_ATTR_TAGS,		/* u32, packets tagged for MD */
+	MDDP_FLOW_ATTR_AGE_MS,		/* u32, since the flow was tracked */
+	__MDDP_FLOW_ATTR_MAX,
+};
+#define MDDP_FLOW_ATTR_MAX (__MDDP_FLOW_ATTR_MAX - 1)
+
 #define MDDP_F_MAX_TRACK_NUM 512
 #define MDDP_F_MAX_TRACK_TABLE_LIST 16
 #define MDDP_F_TABLE_BUFFER_NUM 3000
@@ -90,6 +123,10 @@ static int32_t mddp_f_init_nat_tuple(void);
 static void mddp_f_uninit_nat_tuple(void);
 static int32_t mddp_f_init_router_tuple(void);
 static void mddp_f_uninit_router_tuple(void);
+static int32_t mddp_f_init_nl(void);
+static void mddp_f_uninit_nl(void);
+struct nat_tuple;
+static void mddp_f_nl_flow_event(struct nat_tuple *t, uint8_t cmd);
 //------------------------------------------------------------------------------
 // Registered callback function.
 //------------------------------------------------------------------------------
@@ -553,6 +590,13 @@ int32_t mddp_filter_init(void)
 		return ret;
 	}
 
+	ret = mddp_f_init_nl();
+	if (ret < 0)
+		/* flow stats are optional, offload works without them */
+		MDDP_F_LOG(MDDP_LL_NOTICE,
+				"%s: Cannot register flow netlink(%d)!\n",
+				__func__, ret);
+
 	return 0;
 }
 
@@ -561,9 +605,11 @@ void mddp_filter_uninit(void)
 {
 	mddp_netfilter_unhook();
 	atomic_set(&mddp_filter_quit, 1);
+	mddp_f_uninit_nl();
 	mddp_f_uninit_nat_tuple();
 	mddp_f_uninit_router_tuple();
 }
 
 #include "mddp_filter_v4.c"
 #include "mddp_filter_v6.c"
+#include "mddp_filter_nl.c"
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2020 MediaTek Inc.
+ */
+
+//------------------------------------------------------------------------------
+// Private variables.
+//------------------------------------------------------------------------------
+enum mddp_flow_mcgrp_e {
+	MDDP_FLOW_MCGRP_EVENTS,
+};
+
+static const struct genl_multicast_group mddp_flow_mcgrps[] = {
+	[MDDP_FLOW_MCGRP_EVENTS] = { .name = "events", },
+};
+
+static int mddp_f_nl_dump_flows(struct sk_buff *skb,
+		struct netlink_callback *cb);
+
+static const struct genl_ops mddp_flow_ops[] = {
+	{
+		.cmd = MDDP_FLOW_CMD_GET,
+		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
+		.dumpit = mddp_f_nl_dump_flows,
+		.flags = GENL_ADMIN_PERM,
+	},
+};
+
+static struct genl_family mddp_flow_family = {
+	.name = "MDDP_FLOW",
+	.version = 1,
+	.maxattr = MDDP_FLOW_ATTR_MAX,
+	.module = THIS_MODULE,
+	.ops = mddp_flow_ops,
+	.n_ops = ARRAY_SIZE(mddp_flow_ops),
+	.mcgrps = mddp_flow_mcgrps,
+	.n_mcgrps = ARRAY_SIZE(mddp_flow_mcgrps),
+};
+
+static bool mddp_f_nl_registered;
+
+//------------------------------------------------------------------------------
+// Private functions.
+//------------------------------------------------------------------------------
+static int mddp_f_nl_fill_flow(struct sk_buff *skb, struct nat_tuple *t,
+		u32 portid, u32 seq, int flags, uint8_t cmd)
+{
+	void *hdr;
+
+	hdr = genlmsg_put(skb, portid, seq, &mddp_flow_family, flags, cmd);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_in_addr(skb, MDDP_FLOW_ATTR_SRC_IP, t->src_ip) ||
+		nla_put_in_addr(skb, MDDP_FLOW_ATTR_DST_IP, t->dst_ip) ||
+		nla_put_be16(skb, MDDP_FLOW_ATTR_SRC_PORT, t->src.all) ||
+		nla_put_be16(skb, MDDP_FLOW_ATTR_DST_PORT, t->dst.all) ||
+		nla_put_u8(skb, MDDP_FLOW_ATTR_PROTO, t->proto) ||
+		nla_put_u64_64bit(skb, MDDP_FLOW_ATTR_PACKETS,
+			atomic64_read(&t->packets), MDDP_FLOW_ATTR_PAD) ||
+		nla_put_u64_64bit(skb, MDDP_FLOW_ATTR_BYTES,
+			atomic64_read(&t->bytes), MDDP_FLOW_ATTR_PAD) ||
+		nla_put_u32(skb, MDDP_FLOW_ATTR_TAGS,
+			atomic_read(&t->tags)) ||
+		nla_put_u32(skb, MDDP_FLOW_ATTR_AGE_MS,
+			jiffies_to_msecs(jiffies - t->since))) {
+		genlmsg_cancel(skb, hdr);
+		return -EMSGSIZE;
+	}
+
+	genlmsg_end(skb, hdr);
+	return 0;
+}
+
+/* cb->args[0] counts flows already dumped, the walk restarts every call */
+static int mddp_f_nl_dump_flows(struct sk_buff *skb,
+		struct netlink_callback *cb)
+{
+	struct rhashtable_iter iter;
+	struct nat_tuple *t;
+	long idx = 0;
+
+	rhashtable_walk_enter(&nat_tuple_table, &iter);
+	rhashtable_walk_start(&iter);
+	while ((t = rhashtable_walk_next(&iter)) != NULL) {
+		if (IS_ERR(t)) {
+			if (PTR_ERR(t) == -EAGAIN)
+				continue;
+			break;
+		}
+		if (idx++ < cb->args[0])
+			continue;
+		if (mddp_f_nl_fill_flow(skb, t, NETLINK_CB(cb->skb).portid,
+					cb->nlh->nlmsg_seq, NLM_F_MULTI,
+					MDDP_FLOW_CMD_GET)) {
+			idx--;
+			break;
+		}
+	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
+
+	cb->args[0] = idx;
+	return skb->len;
+}
+
+static void mddp_f_nl_flow_event(struct nat_tuple *t, uint8_t cmd)
+{
+	struct sk_buff *skb;
+
+	if (!mddp_f_nl_registered ||
+		!genl_has_listeners(&mddp_flow_family, &init_net,
+			MDDP_FLOW_MCGRP_EVENTS))
+		return;
+
+	skb = genlmsg_new(NLMSG_GOODSIZE, GFP_ATOMIC);
+	if (!skb)
+		return;
+
+	if (mddp_f_nl_fill_flow(skb, t, 0, 0, 0, cmd)) {
+		nlmsg_free(skb);
+		return;
+	}
+	genlmsg_multicast(&mddp_flow_family, skb, 0,
+			MDDP_FLOW_MCGRP_EVENTS, GFP_ATOMIC);
+}
+
+static int32_t mddp_f_init_nl(void)
+{
+	int ret;
+
+	ret = genl_register_family(&mddp_flow_family);
+	if (ret)
+		return ret;
+
+	mddp_f_nl_registered = true;
+	return 0;
+}
+
+static void mddp_f_uninit_nl(void)
+{
+	if (!mddp_f_nl_registered)
+		return;
+
+	mddp_f_nl_registered = false;
+	genl_unregister_family(&mddp_flow_family);
+}
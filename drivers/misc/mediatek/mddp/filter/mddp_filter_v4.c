@@ -29,8 +29,14 @@ struct tuple {
 	} nat;
 };
 
+/*
+ * NAT tuples live in a resizable RCU hash table, so the netfilter hook
+ * looks them up without any lock. src_ip..proto is the lookup key and
+ * must stay laid out like struct tuple.nat.
+ */
 struct nat_tuple {
-	struct list_head list;
+	struct rhash_head node;
+	struct rcu_head rcu;
 
 	u_int32_t src_ip;
 	u_int32_t dst_ip;
@@ -54,127 +60,154 @@ struct nat_tuple {
 	} dst;
 	u_int8_t proto;
 
-	struct timer_list timeout_used;
+	unsigned long expires;
 
 	u_int32_t last_cnt;
-	u_int32_t curr_cnt;
-	bool is_need_tag;
+	atomic_t curr_cnt;
+	unsigned long flags;
+
+	/* exported through MDDP_FLOW netlink */
+	unsigned long since;
+	atomic64_t packets;
+	atomic64_t bytes;
+	atomic_t tags;
 };
 
-static int mddp_f_max_nat = 10 * MD_DIRECT_TETHERING_RULE_NUM;
-static struct kmem_cache *mddp_f_nat_tuple_cache;
-
-static spinlock_t mddp_f_nat_tuple_lock;
-#define MDDP_F_NAT_TUPLE_INIT_LOCK(LOCK) spin_lock_init((LOCK))
-#define MDDP_F_NAT_TUPLE_LOCK(LOCK, FLAG) spin_lock_irqsave((LOCK), (FLAG))
-#define MDDP_F_NAT_TUPLE_UNLOCK(LOCK, FLAG) spin_unlock_irqrestore((LOCK), (FLAG))
+/* nat_tuple flags */
+#define NAT_TUPLE_NEED_TAG	0
 
-/* Have to be power of 2 */
-#define NAT_TUPLE_HASH_SIZE		(MD_DIRECT_TETHERING_RULE_NUM)
+#define NAT_TUPLE_KEY_LEN \
+	(offsetofend(struct nat_tuple, proto) - \
+	offsetof(struct nat_tuple, src_ip))
 
-static struct list_head *nat_tuple_hash;
-static unsigned int nat_tuple_hash_rnd;
+static int mddp_f_max_nat = 10 * MD_DIRECT_TETHERING_RULE_NUM;
+static struct kmem_cache *mddp_f_nat_tuple_cache;
 
-#define HASH_TUPLE_TCPUDP(t) \
-	(jhash_3words((t)->nat.src, ((t)->nat.dst ^ (t)->nat.proto), \
-	((t)->nat.s.all | ((t)->nat.d.all << 16)), \
-	nat_tuple_hash_rnd) & (NAT_TUPLE_HASH_SIZE - 1))
+static const struct rhashtable_params nat_tuple_params = {
+	.head_offset = offsetof(struct nat_tuple, node),
+	.key_offset = offsetof(struct nat_tuple, src_ip),
+	.key_len = NAT_TUPLE_KEY_LEN,
+	.nelem_hint = MD_DIRECT_TETHERING_RULE_NUM,
+	.automatic_shrinking = true,
+};
 
-#define HASH_NAT_TUPLE_TCPUDP(t) \
-	(jhash_3words((t)->src_ip, ((t)->dst_ip ^ (t)->proto), \
-	((t)->src.all | ((t)->dst.all << 16)), \
-	nat_tuple_hash_rnd) & (NAT_TUPLE_HASH_SIZE - 1))
+static struct rhashtable nat_tuple_table;
 
 static atomic_t mddp_f_nat_cnt = ATOMIC_INIT(0);
-static struct wait_queue_head nat_wq;
+
+/* one sweep per USED_TIMEOUT ages every tuple instead of per-tuple timers */
+static void mddp_f_nat_tuple_gc(struct work_struct *work);
+static DECLARE_DELAYED_WORK(nat_tuple_gc_work, mddp_f_nat_tuple_gc);
 
 static int32_t mddp_f_init_nat_tuple(void)
 {
-	int i;
-
-	MDDP_F_NAT_TUPLE_INIT_LOCK(&mddp_f_nat_tuple_lock);
-	init_waitqueue_head(&nat_wq);
-
-	/* get 4 bytes random number */
-	get_random_bytes(&nat_tuple_hash_rnd, 4);
-
-	/* allocate memory for two nat hash tables */
-	nat_tuple_hash =
-		vmalloc(sizeof(struct list_head) * NAT_TUPLE_HASH_SIZE);
-	if (!nat_tuple_hash)
-		return -ENOMEM;
+	int ret;
 
+	BUILD_BUG_ON(offsetof(struct nat_tuple, proto) -
+			offsetof(struct nat_tuple, src_ip) !=
+			offsetof(struct tuple, nat.proto) -
+			offsetof(struct tuple, nat.src));
 
-	/* init hash table */
-	for (i = 0; i < NAT_TUPLE_HASH_SIZE; i++)
-		INIT_LIST_HEAD(&nat_tuple_hash[i]);
+	ret = rhashtable_init(&nat_tuple_table, &nat_tuple_params);
+	if (ret)
+		return ret;
 
 	mddp_f_nat_tuple_cache =
 		kmem_cache_create("mddp_f_nat_tuple",
 					sizeof(struct nat_tuple), 0,
 					SLAB_HWCACHE_ALIGN, NULL);
+	if (!mddp_f_nat_tuple_cache) {
+		rhashtable_destroy(&nat_tuple_table);
+		return -ENOMEM;
+	}
+
+	schedule_delayed_work(&nat_tuple_gc_work, HZ * USED_TIMEOUT);
 
 	return 0;
 }
 
+static void mddp_f_free_nat_tuple_rcu(struct rcu_head *head)
+{
+	struct nat_tuple *t = container_of(head, struct nat_tuple, rcu);
+
+	kmem_cache_free(mddp_f_nat_tuple_cache, t);
+}
+
+static void mddp_f_free_nat_tuple(void *ptr, void *arg)
+{
+	kmem_cache_free(mddp_f_nat_tuple_cache, ptr);
+}
+
 static void mddp_f_uninit_nat_tuple(void)
 {
-	wait_event(nat_wq, !atomic_read(&mddp_f_nat_cnt));
+	cancel_delayed_work_sync(&nat_tuple_gc_work);
+	rhashtable_free_and_destroy(&nat_tuple_table,
+			mddp_f_free_nat_tuple, NULL);
+	atomic_set(&mddp_f_nat_cnt, 0);
+	/* wait for tuples freed from the sweep */
+	rcu_barrier();
 	kmem_cache_destroy(mddp_f_nat_tuple_cache);
-	vfree(nat_tuple_hash);
 }
 
-static void mddp_f_del_nat_tuple_w_unlock(struct nat_tuple *t, unsigned long flag)
+static void mddp_f_del_nat_tuple(struct nat_tuple *t)
 {
 	MDDP_F_LOG(MDDP_LL_DEBUG,
-			"%s: Del nat tuple[%p], next[%p], prev[%p].\n",
-			__func__, t, t->list.next, t->list.prev);
-
-	atomic_dec(&mddp_f_nat_cnt);
+			"%s: Del nat tuple[%p].\n", __func__, t);
 
-	/* remove from the list */
-	if (t->list.next != LIST_POISON1 && t->list.prev != LIST_POISON2) {
-		list_del(&t->list);
-	} else {
+	if (rhashtable_remove_fast(&nat_tuple_table, &t->node,
+				nat_tuple_params)) {
 		MDDP_F_LOG(MDDP_LL_WARN,
-				"%s: Del nat tuple fail, tuple[%p], next[%p], prev[%p].\n",
-				__func__, t, t->list.next, t->list.prev);
+				"%s: Del nat tuple fail, tuple[%p].\n",
+				__func__, t);
 		WARN_ON(1);
+		return;
 	}
-	MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
+	atomic_dec(&mddp_f_nat_cnt);
 
-	kmem_cache_free(mddp_f_nat_tuple_cache, t);
+	call_rcu(&t->rcu, mddp_f_free_nat_tuple_rcu);
 }
 
-static void mddp_f_timeout_nat_tuple(struct timer_list *timer)
+static void mddp_f_nat_tuple_gc(struct work_struct *work)
 {
-	struct nat_tuple *t = from_timer(t, timer, timeout_used);
-	unsigned long flag;
+	struct rhashtable_iter iter;
+	struct nat_tuple *t;
+	unsigned int curr_cnt;
 
-	if (unlikely(atomic_read(&mddp_filter_quit))) {
-		kmem_cache_free(mddp_f_nat_tuple_cache, t);
-		if (atomic_dec_and_test(&mddp_f_nat_cnt))
-			wake_up(&nat_wq);
+	if (unlikely(atomic_read(&mddp_filter_quit)))
 		return;
-	}
-	MDDP_F_NAT_TUPLE_LOCK(&mddp_f_nat_tuple_lock, flag);
-	if (t->curr_cnt == t->last_cnt)
-		mddp_f_del_nat_tuple_w_unlock(t, flag);
-	else {
-		t->is_need_tag = true;
-		t->last_cnt = t->curr_cnt;
 
-		MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
+	rhashtable_walk_enter(&nat_tuple_table, &iter);
+	rhashtable_walk_start(&iter);
+	while ((t = rhashtable_walk_next(&iter)) != NULL) {
+		if (IS_ERR(t)) {
+			/* table resized, tuples may be seen twice */
+			if (PTR_ERR(t) == -EAGAIN)
+				continue;
+			break;
+		}
+
+		if (time_before(jiffies, READ_ONCE(t->expires)))
+			continue;
 
-		mod_timer(&t->timeout_used, jiffies + HZ * USED_TIMEOUT);
+		curr_cnt = atomic_read(&t->curr_cnt);
+		if (curr_cnt == READ_ONCE(t->last_cnt)) {
+			mddp_f_nl_flow_event(t, MDDP_FLOW_CMD_DEL);
+			mddp_f_del_nat_tuple(t);
+			continue;
+		}
+		set_bit(NAT_TUPLE_NEED_TAG, &t->flags);
+		WRITE_ONCE(t->last_cnt, curr_cnt);
+		WRITE_ONCE(t->expires, jiffies + HZ * USED_TIMEOUT);
 	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
+
+	schedule_delayed_work(&nat_tuple_gc_work, HZ * USED_TIMEOUT);
 }
 
 static bool mddp_f_add_nat_tuple(struct nat_tuple *t)
 {
-	unsigned long flag;
-	unsigned int hash;
-	struct nat_tuple *found_nat_tuple;
+	int ret;
 
 	MDDP_F_LOG(MDDP_LL_DEBUG,
 			"%s: Add new nat tuple[%p] with src_port[%d] & proto[%d].\n",
@@ -184,6 +217,7 @@ static bool mddp_f_add_nat_tuple(struct nat_tuple *t)
 		MDDP_F_LOG(MDDP_LL_NOTICE,
 				"%s: Nat tuple table is full! Tuple[%p] is about to free.\n",
 				__func__, t);
+		mddp_f_nl_flow_event(t, MDDP_FLOW_CMD_MISS);
 		kmem_cache_free(mddp_f_nat_tuple_cache, t);
 		return false;
 	}
@@ -191,138 +225,84 @@ static bool mddp_f_add_nat_tuple(struct nat_tuple *t)
 	switch (t->proto) {
 	case IPPROTO_TCP:
 	case IPPROTO_UDP:
-		hash = HASH_NAT_TUPLE_TCPUDP(t);
 		break;
 	default:
 		kmem_cache_free(mddp_f_nat_tuple_cache, t);
 		return false;
 	}
 
-	MDDP_F_NAT_TUPLE_LOCK(&mddp_f_nat_tuple_lock, flag);
-	INIT_LIST_HEAD(&t->list);
+	t->last_cnt = 0;
+	atomic_set(&t->curr_cnt, 0);
+	t->flags = 0;
+	t->expires = jiffies + HZ * USED_TIMEOUT;
+	t->since = jiffies;
+	atomic64_set(&t->packets, 0);
+	atomic64_set(&t->bytes, 0);
+	atomic_set(&t->tags, 1);
+
 	/* prevent from duplicating */
-	list_for_each_entry(found_nat_tuple, &nat_tuple_hash[hash], list) {
-		if (found_nat_tuple->src_ip != t->src_ip)
-			continue;
-		if (found_nat_tuple->dst_ip != t->dst_ip)
-			continue;
-		if (found_nat_tuple->proto != t->proto)
-			continue;
-		if (found_nat_tuple->src.all != t->src.all)
-			continue;
-		if (found_nat_tuple->dst.all != t->dst.all)
-			continue;
-		MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
+	ret = rhashtable_lookup_insert_fast(&nat_tuple_table, &t->node,
+			nat_tuple_params);
+	if (ret) {
 		MDDP_F_LOG(MDDP_LL_DEBUG,
-				"%s: Nat tuple[%p] is duplicated!\n",
-				__func__, t);
+				"%s: Nat tuple[%p] is not added(%d)!\n",
+				__func__, t, ret);
+		if (ret != -EEXIST)
+			mddp_f_nl_flow_event(t, MDDP_FLOW_CMD_MISS);
 		kmem_cache_free(mddp_f_nat_tuple_cache, t);
-		return false;   /* duplication */
+		return false;
 	}
-
-	t->last_cnt = 0;
-	t->curr_cnt = 0;
-	t->is_need_tag = false;
-
-	/* add to the list */
-	list_add_tail(&t->list, &nat_tuple_hash[hash]);
 	atomic_inc(&mddp_f_nat_cnt);
-	MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
 
 	MDDP_F_LOG(MDDP_LL_DEBUG,
-			"%s: Add nat tuple[%p], next[%p], prev[%p].\n",
-			__func__, t, t->list.next, t->list.prev);
-
-	/* init timer and start it */
-	timer_setup(&t->timeout_used, mddp_f_timeout_nat_tuple, 0);
-	t->timeout_used.expires = jiffies + HZ * USED_TIMEOUT;
-
-	add_timer(&t->timeout_used);
+			"%s: Add nat tuple[%p].\n", __func__, t);
+	mddp_f_nl_flow_event(t, MDDP_FLOW_CMD_NEW);
 
 	return true;
 }
 
-static inline struct nat_tuple *mddp_f_get_nat_tuple_ip4_tcpudp_wo_lock(
+/* must be called under rcu_read_lock() */
+static inline struct nat_tuple *mddp_f_get_nat_tuple_ip4_tcpudp(
 	struct tuple *t)
 {
-	unsigned int hash;
-	int not_match;
-	struct nat_tuple *found_nat_tuple;
-
-	hash = HASH_TUPLE_TCPUDP(t);
-
-	list_for_each_entry(found_nat_tuple, &nat_tuple_hash[hash], list) {
-		not_match = 0;
-		not_match +=
-			(found_nat_tuple->src_ip != t->nat.src) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->dst_ip != t->nat.dst) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->proto != t->nat.proto) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->src.all != t->nat.s.all) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->dst.all != t->nat.d.all) ? 1 : 0;
-		if (unlikely(not_match))
-			continue;
-
-		return found_nat_tuple;
-	}
-	/* not found */
-	return 0;
+	return rhashtable_lookup(&nat_tuple_table, &t->nat,
+			nat_tuple_params);
 }
 
 static inline bool mddp_f_check_pkt_need_track_nat_tuple_ip4(
 	struct tuple *t,
+	unsigned int len,
 	struct nat_tuple **matched_tuple)
 {
-	unsigned long flag;
-	unsigned int hash;
-	int not_match;
 	struct nat_tuple *found_nat_tuple;
-
-	hash = HASH_TUPLE_TCPUDP(t);
-
-	MDDP_F_NAT_TUPLE_LOCK(&mddp_f_nat_tuple_lock, flag);
-	list_for_each_entry(found_nat_tuple, &nat_tuple_hash[hash], list) {
-		not_match = 0;
-		not_match +=
-			(found_nat_tuple->src_ip != t->nat.src) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->dst_ip != t->nat.dst) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->proto != t->nat.proto) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->src.all != t->nat.s.all) ? 1 : 0;
-		not_match +=
-			(found_nat_tuple->dst.all != t->nat.d.all) ? 1 : 0;
-		if (unlikely(not_match))
-			continue;
-
-		*matched_tuple = found_nat_tuple;
-		found_nat_tuple->curr_cnt++;
-
-		MDDP_F_LOG(MDDP_LL_DEBUG,
-			"%s: check tcpudp nat tuple[%p], last_cnt[%d], curr_cnt[%d], need_tag[%d].\n",
-			__func__, found_nat_tuple,
-			found_nat_tuple->last_cnt,
-			found_nat_tuple->curr_cnt,
-			found_nat_tuple->is_need_tag);
-
-		if (found_nat_tuple->is_need_tag == true) {
-			found_nat_tuple->is_need_tag = false;
-			MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
-
-			return true;
-		}
-		MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
-
-		return false;
+	bool need_tag;
+
+	rcu_read_lock();
+	found_nat_tuple = mddp_f_get_nat_tuple_ip4_tcpudp(t);
+	if (!found_nat_tuple) {
+		rcu_read_unlock();
+		/* not found */
+		return true;
 	}
-	MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
 
-	/* not found */
-	return true;
+	*matched_tuple = found_nat_tuple;
+	atomic_inc(&found_nat_tuple->curr_cnt);
+	atomic64_inc(&found_nat_tuple->packets);
+	atomic64_add(len, &found_nat_tuple->bytes);
+
+	MDDP_F_LOG(MDDP_LL_DEBUG,
+		"%s: check tcpudp nat tuple[%p], last_cnt[%d], curr_cnt[%d], need_tag[%d].\n",
+		__func__, found_nat_tuple,
+		READ_ONCE(found_nat_tuple->last_cnt),
+		atomic_read(&found_nat_tuple->curr_cnt),
+		test_bit(NAT_TUPLE_NEED_TAG, &found_nat_tuple->flags));
+
+	need_tag = test_bit(NAT_TUPLE_NEED_TAG, &found_nat_tuple->flags) &&
+		test_and_clear_bit(NAT_TUPLE_NEED_TAG,
+				&found_nat_tuple->flags);
+	rcu_read_unlock();
+
+	return need_tag;
 }
 
 static inline void mddp_f_ip4_tcp(
@@ -339,7 +319,8 @@ static inline void mddp_f_ip4_tcp(
 	t->nat.s.tcp.port = tcp->th_sport;
 	t->nat.d.tcp.port = tcp->th_dport;
 
-	ret = mddp_f_check_pkt_need_track_nat_tuple_ip4(t, &found_nat_tuple);
+	ret = mddp_f_check_pkt_need_track_nat_tuple_ip4(t, skb->len,
+			&found_nat_tuple);
 	MDDP_F_LOG(MDDP_LL_DEBUG,
 		"%s: IPv4 TCP is_need_track[%d], found_tuple[%p], src_ip[%x], dst_ip[%x], ip_p[%d], sport[%x], dport[%x].\n",
 		__func__, ret, found_nat_tuple, t->nat.src, t->nat.dst,
@@ -362,7 +343,8 @@ static inline void mddp_f_ip4_udp(
 	t->nat.s.udp.port = udp->uh_sport;
 	t->nat.d.udp.port = udp->uh_dport;
 
-	ret = mddp_f_check_pkt_need_track_nat_tuple_ip4(t, &found_nat_tuple);
+	ret = mddp_f_check_pkt_need_track_nat_tuple_ip4(t, skb->len,
+			&found_nat_tuple);
 	MDDP_F_LOG(MDDP_LL_DEBUG,
 		"%s: IPv4 UDP is_need_track[%d], found_tuple[%p], src_ip[%x], dst_ip[%x], ip_p[%d], sport[%x], dport[%x].\n",
 		__func__, ret, found_nat_tuple, t->nat.src, t->nat.dst,
@@ -469,7 +451,6 @@ static void mddp_f_out_nf_ipv4(struct sk_buff *skb, struct mddp_f_cb *cb)
 	struct udpheader *udp;
 	unsigned char tcp_state;
 	unsigned char ext_offset;
-	unsigned long flag;
 	unsigned int tuple_hit_cnt = 0;
 	int ret;
 	unsigned char *offset2 = skb_network_header(skb);
@@ -541,15 +522,16 @@ static void mddp_f_out_nf_ipv4(struct sk_buff *skb, struct mddp_f_cb *cb)
 		}
 
 		/* Tag this packet for MD tracking */
-		MDDP_F_NAT_TUPLE_LOCK(&mddp_f_nat_tuple_lock, flag);
+		rcu_read_lock();
 		found_nat_tuple =
-			mddp_f_get_nat_tuple_ip4_tcpudp_wo_lock(&t);
+			mddp_f_get_nat_tuple_ip4_tcpudp(&t);
 
 		if (found_nat_tuple) {
-			tuple_hit_cnt = found_nat_tuple->curr_cnt;
-			found_nat_tuple->last_cnt = 0;
-			found_nat_tuple->curr_cnt = 0;
-			MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
+			tuple_hit_cnt =
+				atomic_xchg(&found_nat_tuple->curr_cnt, 0);
+			WRITE_ONCE(found_nat_tuple->last_cnt, 0);
+			atomic_inc(&found_nat_tuple->tags);
+			rcu_read_unlock();
 
 			MDDP_F_LOG(MDDP_LL_DEBUG,
 				"%s: tuple[%p] is found!!\n",
@@ -563,7 +545,7 @@ static void mddp_f_out_nf_ipv4(struct sk_buff *skb, struct mddp_f_cb *cb)
 
 			goto out;
 		} else {
-			MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock, flag);
+			rcu_read_unlock();
 
 			/* Save tuple to avoid tag many packets */
 			found_nat_tuple = kmem_cache_alloc(
@@ -641,18 +623,16 @@ static void mddp_f_out_nf_ipv4(struct sk_buff *skb, struct mddp_f_cb *cb)
 			/* Don't fastpath dhcp packet */
 
 			/* Tag this packet for MD tracking */
-			MDDP_F_NAT_TUPLE_LOCK(&mddp_f_nat_tuple_lock, flag);
+			rcu_read_lock();
 			found_nat_tuple =
-				mddp_f_get_nat_tuple_ip4_tcpudp_wo_lock(
-						&t);
+				mddp_f_get_nat_tuple_ip4_tcpudp(&t);
 
 			if (found_nat_tuple) {
-				tuple_hit_cnt =
-					found_nat_tuple->curr_cnt;
-				found_nat_tuple->last_cnt = 0;
-				found_nat_tuple->curr_cnt = 0;
-				MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock,
-						flag);
+				tuple_hit_cnt = atomic_xchg(
+					&found_nat_tuple->curr_cnt, 0);
+				WRITE_ONCE(found_nat_tuple->last_cnt, 0);
+				atomic_inc(&found_nat_tuple->tags);
+				rcu_read_unlock();
 
 				MDDP_F_LOG(MDDP_LL_DEBUG,
 						"%s: tuple[%p] is found!!\n",
@@ -670,8 +650,7 @@ static void mddp_f_out_nf_ipv4(struct sk_buff *skb, struct mddp_f_cb *cb)
 
 				goto out;
 			} else {
-				MDDP_F_NAT_TUPLE_UNLOCK(&mddp_f_nat_tuple_lock,
-						flag);
+				rcu_read_unlock();
 
 				/* Save tuple to avoid tag many packets */
 				found_nat_tuple = kmem_cache_alloc(
@@ -48,12 +48,20 @@ int mkp_set_mapping_xxx_helper(unsigned long addr, int nr_pages, uint32_t policy
 		unsigned long start_pfn = 0, count = 1;
 		phys_addr_t phys_addr = 0;
 
+		rcu_read_lock();
 		for (i = 0; i < nr_pages; i++) {
-			pfn_cur = vmalloc_to_pfn((void *)(addr+i*PAGE_SIZE));
+			/* pfn_next, if set, was looked up for this page already */
+			if (pfn_next)
+				pfn_cur = pfn_next;
+			else
+				pfn_cur = vmalloc_to_pfn((void *)(addr+i*PAGE_SIZE));
+			pfn_next = 0;
 			if (start_pfn == 0)
 				start_pfn = pfn_cur;
 			phys_addr = start_pfn << PAGE_SHIFT;
-			found = mkp_rbtree_search(&mkp_rbtree, phys_addr);
+			/* the start of a growing run was looked up already */
+			found = (count == 1) ?
+				mkp_rbtree_search(&mkp_rbtree, phys_addr) : NULL;
 			if (found != NULL) {
 				if (found->addr == 0 && found->size == 0) {
 					start_pfn = 0; count = 1;
@@ -102,6 +110,7 @@ int mkp_set_mapping_xxx_helper(unsigned long addr, int nr_pages, uint32_t policy
 				start_pfn = 0; count = 1;
 			}
 		}
+		rcu_read_unlock();
 	}
 	return ret;
 }
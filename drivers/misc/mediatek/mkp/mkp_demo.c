@@ -76,7 +76,7 @@ static void mkp_trace_event_func(struct timer_list *unused) // do not use sleep
 }
 #endif
 
-struct rb_root mkp_rbtree = RB_ROOT;
+struct latch_tree_root mkp_rbtree;
 
 #if !defined(CONFIG_KASAN_GENERIC) && !defined(CONFIG_KASAN_SW_TAGS)
 static void *p_stext;
@@ -145,7 +145,7 @@ static void probe_android_vh_set_memory_nx(void *ignore, unsigned long addr,
 {
 	int ret;
 	int region;
-	int i = 0;
+	int i = 0, skip;
 	unsigned long pfn;
 	struct mkp_rb_node *found = NULL;
 	phys_addr_t phys_addr;
@@ -169,15 +169,20 @@ static void probe_android_vh_set_memory_nx(void *ignore, unsigned long addr,
 #endif
 	}
 
+	rcu_read_lock();
 	for (i = 0; i < nr_pages; i++) {
 		pfn = vmalloc_to_pfn((void *)(addr+i*PAGE_SIZE));
 		phys_addr = pfn << PAGE_SHIFT;
 		found = mkp_rbtree_search(&mkp_rbtree, phys_addr);
 		if (found != NULL && found->addr != 0 && found->size != 0) {
+			/* the rest of this range needs no lookup */
+			skip = (found->size >> PAGE_SHIFT) - 1;
 			ret = mkp_destroy_handle(policy, found->handle);
 			ret = mkp_rbtree_erase(&mkp_rbtree, phys_addr);
+			i += skip;
 		}
 	}
+	rcu_read_unlock();
 }
 
 #if !defined(CONFIG_KASAN_GENERIC) && !defined(CONFIG_KASAN_SW_TAGS)
@@ -32,6 +32,6 @@ struct cred_sbuf_content {
 	};
 };
 
-extern struct rb_root mkp_rbtree;
+extern struct latch_tree_root mkp_rbtree;
 int __init mkp_demo_init(void);
 #endif
@@ -5,9 +5,15 @@
  */
 
 #include "mkp_rbtree.h"
-#include <linux/rwlock.h>
+#include <linux/spinlock.h>
 
-DEFINE_RWLOCK(mkp_rbtree_rwlock);
+/*
+ * Protected ranges are kept in a latched rbtree, like the module
+ * address tree: lookups from the set_memory_* hooks run under RCU
+ * without touching a shared lock, updates are serialized by
+ * mkp_rbtree_lock and nodes are freed after a grace period.
+ */
+static DEFINE_SPINLOCK(mkp_rbtree_lock);
 DEBUG_SET_LEVEL(DEBUG_LEVEL_ERR);
 
 static struct mkp_rb_node fail_node = {
@@ -16,110 +22,128 @@ static struct mkp_rb_node fail_node = {
 	.handle = 0,
 };
 
-void traverse_rbtree(struct rb_root *root)
+static __always_inline struct mkp_rb_node *
+mkp_rb_entry(struct latch_tree_node *n)
+{
+	return container_of(n, struct mkp_rb_node, lt_node);
+}
+
+static __always_inline bool
+mkp_rb_less(struct latch_tree_node *a, struct latch_tree_node *b)
+{
+	return mkp_rb_entry(a)->addr < mkp_rb_entry(b)->addr;
+}
+
+static __always_inline int
+mkp_rb_comp(void *key, struct latch_tree_node *n)
+{
+	phys_addr_t addr = *(phys_addr_t *)key;
+	struct mkp_rb_node *cur = mkp_rb_entry(n);
+
+	if (addr < cur->addr)
+		return -1;
+	if (addr >= cur->addr + cur->size)
+		return 1;
+	return 0;
+}
+
+static const struct latch_tree_ops mkp_rb_ops = {
+	.less = mkp_rb_less,
+	.comp = mkp_rb_comp,
+};
+
+void traverse_rbtree(struct latch_tree_root *root)
 {
 	struct rb_node *node;
 	unsigned long flags;
 
-	read_lock_irqsave(&mkp_rbtree_rwlock, flags);
-	for (node = rb_first(root); node; node=rb_next(node)) {
-		struct mkp_rb_node *data = rb_entry(node, struct mkp_rb_node, rb_node);
+	/* writers only ever touch tree[0] under the lock, walk that one */
+	spin_lock_irqsave(&mkp_rbtree_lock, flags);
+	for (node = rb_first(&root->tree[0]); node; node = rb_next(node)) {
+		struct mkp_rb_node *data = container_of(node, struct mkp_rb_node,
+							lt_node.node[0]);
 
 		MKP_DEBUG("%s: addr: 0x%pa, size: %pa\n", __func__, &data->addr, &data->size);
 	}
-	read_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
-	return;
+	spin_unlock_irqrestore(&mkp_rbtree_lock, flags);
 }
 
-struct mkp_rb_node *mkp_rbtree_search(struct rb_root *root, phys_addr_t addr)
+/*
+ * Returns the range starting at @addr, &fail_node if @addr is inside a
+ * range or NULL. The caller must hold rcu_read_lock() for as long as it
+ * uses the returned node.
+ */
+struct mkp_rb_node *mkp_rbtree_search(struct latch_tree_root *root, phys_addr_t addr)
 {
-	struct rb_node *n;
-	unsigned long flags;
-
-	read_lock_irqsave(&mkp_rbtree_rwlock, flags);
-	n = root->rb_node;
-	while (n) {
-		struct mkp_rb_node *cur = container_of(n, struct mkp_rb_node, rb_node);
-
-		if (addr > cur->addr && addr < cur->addr+cur->size) {
-			MKP_WARN("%s: fail node\n", __func__);
-			read_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
-			return &fail_node;
-		}
-		if (addr < cur->addr)
-			n = n->rb_left;
-		else if (addr > cur->addr)
-			n = n->rb_right;
-		else {
-			read_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
-			return cur;
-		}
+	struct latch_tree_node *n;
+	struct mkp_rb_node *cur;
+
+	rcu_read_lock();
+	n = latch_tree_find(&addr, root, &mkp_rb_ops);
+	rcu_read_unlock();
+	if (!n)
+		return NULL;
+
+	cur = mkp_rb_entry(n);
+	if (cur->addr != addr) {
+		MKP_WARN("%s: fail node\n", __func__);
+		return &fail_node;
 	}
-	read_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
-	return NULL;
+	return cur;
 }
-int mkp_rbtree_insert(struct rb_root *root, struct mkp_rb_node *ins)
+
+int mkp_rbtree_insert(struct latch_tree_root *root, struct mkp_rb_node *ins)
 {
-	struct rb_node **new, *parent = NULL;
+	struct rb_node *n;
 	unsigned long flags;
 
-	write_lock_irqsave(&mkp_rbtree_rwlock, flags);
-	new = &(root->rb_node);
-	while (*new) {
-		struct mkp_rb_node *cur = container_of(*new, struct mkp_rb_node, rb_node); // also can use rb_entry
+	spin_lock_irqsave(&mkp_rbtree_lock, flags);
+	n = root->tree[0].rb_node;
+	while (n) {
+		struct mkp_rb_node *cur = container_of(n, struct mkp_rb_node,
+						       lt_node.node[0]);
 
-		parent = *new;
 		if (ins->addr >= cur->addr + cur->size)
-			new = &((*new)->rb_right);
+			n = n->rb_right;
 		else if (ins->addr + ins->size <= cur->addr &&
 			ins->addr < ins->addr + ins->size)
-			new = &((*new)->rb_left);
+			n = n->rb_left;
 		else {
 			MKP_ERR("Cannot insert node (existing overlapp)\n");
-			write_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
+			spin_unlock_irqrestore(&mkp_rbtree_lock, flags);
 			return -EEXIST;
 		}
 	}
 
-	/* Add new node and rebalance tree. */
-	rb_link_node(&ins->rb_node, parent, new);
-	rb_insert_color(&ins->rb_node, root);
+	latch_tree_insert(&ins->lt_node, root, &mkp_rb_ops);
 
-	write_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
+	spin_unlock_irqrestore(&mkp_rbtree_lock, flags);
 	return 0;
 }
 
-int mkp_rbtree_erase(struct rb_root *root, phys_addr_t addr)
+int mkp_rbtree_erase(struct latch_tree_root *root, phys_addr_t addr)
 {
 	struct mkp_rb_node *data = NULL;
-	struct rb_node *n;
+	struct latch_tree_node *n;
 	unsigned long flags;
 
-	write_lock_irqsave(&mkp_rbtree_rwlock, flags);
-	n = root->rb_node;
-	while (n) {
-		struct mkp_rb_node *cur = container_of(n, struct mkp_rb_node, rb_node);
-
-		if (addr > cur->addr && addr < cur->addr+cur->size) {
+	spin_lock_irqsave(&mkp_rbtree_lock, flags);
+	n = latch_tree_find(&addr, root, &mkp_rb_ops);
+	if (n) {
+		data = mkp_rb_entry(n);
+		if (data->addr != addr) {
 			MKP_WARN("%s: fail node\n", __func__);
-			break;
-		}
-		if (addr < cur->addr)
-			n = n->rb_left;
-		else if (addr > cur->addr)
-			n = n->rb_right;
-		else {
-			data = cur;
-			break;
+			data = NULL;
 		}
 	}
 
 	if (data) {
-		rb_erase(&data->rb_node, root);
-		kfree(data);
-		write_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
+		latch_tree_erase(&data->lt_node, root, &mkp_rb_ops);
+		spin_unlock_irqrestore(&mkp_rbtree_lock, flags);
+		/* lockless readers may still look at it */
+		kfree_rcu(data, rcu);
 		return 0;
 	}
-	write_unlock_irqrestore(&mkp_rbtree_rwlock, flags);
+	spin_unlock_irqrestore(&mkp_rbtree_lock, flags);
 	return -1;
 }
@@ -7,6 +7,8 @@
 #define _MKP_RBTREE_H_
 
 #include <linux/rbtree.h>
+#include <linux/rbtree_latch.h>
+#include <linux/rcupdate.h>
 #include <linux/types.h> // for phys_addr_t
 #include <linux/random.h>
 
@@ -40,14 +42,15 @@
 #include "debug.h"
 
 struct mkp_rb_node {
-	struct rb_node rb_node;
+	struct latch_tree_node lt_node;
 	phys_addr_t addr;
 	phys_addr_t size;
 	uint32_t handle;
+	struct rcu_head rcu;
 };
 
-void traverse_rbtree(struct rb_root *root);
-struct mkp_rb_node *mkp_rbtree_search(struct rb_root *root, phys_addr_t addr);
-int mkp_rbtree_insert(struct rb_root *root, struct mkp_rb_node *ins);
-int mkp_rbtree_erase(struct rb_root *root, phys_addr_t addr);
+void traverse_rbtree(struct latch_tree_root *root);
+struct mkp_rb_node *mkp_rbtree_search(struct latch_tree_root *root, phys_addr_t addr);
+int mkp_rbtree_insert(struct latch_tree_root *root, struct mkp_rb_node *ins);
+int mkp_rbtree_erase(struct latch_tree_root *root, phys_addr_t addr);
 #endif /* _MKP_RBTREE_H */
@@ -8,9 +8,21 @@
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
 #include "mmqos_wrapper.h"
 static DEFINE_MUTEX(bw_mutex);
 static u32 max_bw_bound;
+/*
+ * Raised votes go to icc right away, lowered ones are held for one frame
+ * window so a drop and the raise that follows it within the same frame do
+ * not cause two EMI DVFS transitions. 0 sends every vote immediately.
+ */
+static u32 bw_drop_delay_ms = 16;
+module_param(bw_drop_delay_ms, uint, 0644);
+MODULE_PARM_DESC(bw_drop_delay_ms, "defer bw drops by this window (ms)");
+static LIST_HEAD(pending_drop_list);
+static void mm_qos_drop_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(mm_qos_drop_work, mm_qos_drop_work_fn);
 struct wrapper_data {
 	const u32 max_ostd;
 	const u32 icc_dst_id;
@@ -52,6 +64,9 @@ s32 mm_qos_add_request(struct list_head *owner_list,
 	req->hrt_value = 0;
 	pr_info("[mmqos]mm_qos_add_request3\n");
 	INIT_LIST_HEAD(&(req->owner_node));
+	INIT_LIST_HEAD(&(req->pending_node));
+	req->icc_avg = 0;
+	req->icc_peak = 0;
 	pr_info("[mmqos]mm_qos_add_request4\n");
 	list_add_tail(&(req->owner_node), owner_list);
 	pr_info("[mmqos]mm_qos_add_request5\n");
@@ -117,10 +132,56 @@ static inline u32 get_comp_value(u32 bw_value, u32 comp_type)
 		return COMP_BW_UPDATE(bw_value);
 	return bw_value;
 }
-void mm_qos_update_all_request(struct list_head *owner_list)
+/* bw_mutex held */
+static void mm_qos_send_vote(struct mm_qos_request *req, u32 avg, u32 peak)
+{
+	if (req->icc_avg == avg && req->icc_peak == peak)
+		return;
+	mtk_icc_set_bw(req->icc_path, avg, peak);
+	req->icc_avg = avg;
+	req->icc_peak = peak;
+}
+/* bw_mutex held */
+static void mm_qos_update_request(struct mm_qos_request *req, bool defer)
 {
-	struct mm_qos_request *req = NULL;
 	u64 comp_bw;
+	u32 avg, peak;
+
+	comp_bw = get_comp_value(req->bw_value, req->comp_type);
+	avg = (req->bw_value == MTK_MMQOS_MAX_BW)
+		? MTK_MMQOS_MAX_BW : MBps_to_icc(comp_bw);
+	peak = (req->hrt_value == MTK_MMQOS_MAX_BW)
+		? MTK_MMQOS_MAX_BW : MBps_to_icc(req->hrt_value);
+
+	if (!defer || !bw_drop_delay_ms ||
+		(avg >= req->icc_avg && peak >= req->icc_peak)) {
+		list_del_init(&req->pending_node);
+		mm_qos_send_vote(req, avg, peak);
+		return;
+	}
+
+	/* apply the raised part now, keep the old vote for the dropped part */
+	mm_qos_send_vote(req, max(avg, req->icc_avg), max(peak, req->icc_peak));
+	if (list_empty(&req->pending_node)) {
+		list_add_tail(&req->pending_node, &pending_drop_list);
+		if (!delayed_work_pending(&mm_qos_drop_work))
+			schedule_delayed_work(&mm_qos_drop_work,
+				msecs_to_jiffies(bw_drop_delay_ms));
+	}
+}
+static void mm_qos_drop_work_fn(struct work_struct *work)
+{
+	struct mm_qos_request *req, *temp;
+
+	mutex_lock(&bw_mutex);
+	list_for_each_entry_safe(req, temp, &pending_drop_list, pending_node)
+		mm_qos_update_request(req, false);
+	mutex_unlock(&bw_mutex);
+}
+static void __mm_qos_update_all_request(struct list_head *owner_list,
+	bool defer)
+{
+	struct mm_qos_request *req = NULL;
 
 	if (!owner_list || list_empty(owner_list)) {
 		pr_notice("%s: owner_list is invalid\n", __func__);
@@ -130,16 +191,15 @@ void mm_qos_update_all_request(struct list_head *owner_list)
 	list_for_each_entry(req, owner_list, owner_node) {
 		if (!req->updated)
 			continue;
-		comp_bw = get_comp_value(req->bw_value, req->comp_type);
-		mtk_icc_set_bw(req->icc_path,
-			(req->bw_value == MTK_MMQOS_MAX_BW)
-			? MTK_MMQOS_MAX_BW : MBps_to_icc(comp_bw),
-			(req->hrt_value == MTK_MMQOS_MAX_BW)
-			? MTK_MMQOS_MAX_BW : MBps_to_icc(req->hrt_value));
+		mm_qos_update_request(req, defer);
 		req->updated = false;
 	}
 	mutex_unlock(&bw_mutex);
 }
+void mm_qos_update_all_request(struct list_head *owner_list)
+{
+	__mm_qos_update_all_request(owner_list, true);
+}
 EXPORT_SYMBOL_GPL(mm_qos_update_all_request);
 void mm_qos_remove_all_request(struct list_head *owner_list)
 {
@@ -149,6 +209,7 @@ void mm_qos_remove_all_request(struct list_head *owner_list)
 	list_for_each_entry_safe(req, temp, owner_list, owner_node) {
 		pr_notice("mm_del(0x%08x)\n", req->master_id);
 		list_del(&(req->owner_node));
+		list_del_init(&(req->pending_node));
 		req->init = false;
 	}
 	mutex_unlock(&bw_mutex);
@@ -161,7 +222,8 @@ void mm_qos_update_all_request_zero(struct list_head *owner_list)
 	list_for_each_entry(req, owner_list, owner_node) {
 		mm_qos_set_request(req, 0, 0, 0);
 	}
-	mm_qos_update_all_request(owner_list);
+	/* callers are powering down, release the bw without delay */
+	__mm_qos_update_all_request(owner_list, false);
 }
 EXPORT_SYMBOL_GPL(mm_qos_update_all_request_zero);
 s32 mm_hrt_get_available_hrt_bw(u32 master_id)
@@ -244,6 +306,7 @@ static int __init mtk_mmqos_wrapper_init(void)
 }
 static void __exit mtk_mmqos_wrapper_exit(void)
 {
+	cancel_delayed_work_sync(&mm_qos_drop_work);
 	platform_driver_unregister(&mmqos_wrapper_drv);
 }
 module_init(mtk_mmqos_wrapper_init);
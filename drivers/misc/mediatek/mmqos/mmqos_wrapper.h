@@ -27,6 +27,9 @@ struct mm_qos_request {
 	bool init;	/* initialized check */
 	bool updated;	/* update check */
 	struct icc_path *icc_path;
+	struct list_head pending_node;	/* deferred bw drop */
+	u32 icc_avg;	/* last avg vote sent to icc */
+	u32 icc_peak;	/* last peak vote sent to icc */
 };
 #if IS_ENABLED(CONFIG_INTERCONNECT_MTK_MMQOS_COMMON)
 /**
@@ -4,6 +4,7 @@
  */
 
 #include <linux/cdev.h>
+#include <linux/coresight.h>
 #include <linux/debug_locks.h>
 #include <linux/delay.h>
 #include <linux/device.h>
@@ -47,6 +48,7 @@
 
 #include "aed/aed.h"
 #include "hang_detect.h"
+#include "hang_sample.h"
 #include "hang_unwind.h"
 #include "mrdump/mrdump_private.h"
 #include "mrdump/mrdump_mini.h"
@@ -100,6 +102,7 @@ EXPORT_SYMBOL_GPL(monitor_hang_regist_ldt);
 static void reset_hang_info(void)
 {
 	Hang_first_done = false;
+	hang_sample_reset();
 }
 
 int add_white_list(char *name)
@@ -459,6 +462,35 @@ static void log_hang_info(const char *fmt, ...)
 #endif
 }
 
+/* the aggregated report is small, so it always goes to the kernel log */
+static void log_hang_sample(const char *fmt, ...)
+{
+	char buf[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vscnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	log_hang_info("%s", buf);
+	pr_info("%s", buf);
+}
+
+/* ask the user space dumpers for their own backtraces */
+static void signal_hang_dumpers(void)
+{
+	struct task_struct *p;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (!strcmp(p->comm, "aee_aed"))
+			send_sig(SIGUSR1, p, 1);
+		else if (!strcmp(p->comm, "system_server") ||
+			strstr(p->comm, "monkey"))
+			send_sig(SIGQUIT, p, 1);
+	}
+	rcu_read_unlock();
+}
+
 #ifdef CONFIG_MTK_HANG_DETECT_DB
 #ifndef MODULE
 static void buffer_hang_info(const char *buff, unsigned long size)
@@ -1350,6 +1382,9 @@ static int hang_detect_thread(void *arg)
 				log_hang_info(
 					"[Hang_detect]Dump the %d time process bt.\n",
 					Hang_first_done ? 2 : 1);
+				/* keep the trace leading to the hang */
+				if (!Hang_first_done)
+					coresight_freeze_trace("hang_detect");
 #ifdef CONFIG_MTK_HANG_DETECT_DB
 				if (!Hang_first_done) {
 					memset(Hang_Info, 0, MaxHangInfoSize);
@@ -1370,6 +1405,14 @@ static int hang_detect_thread(void *arg)
 							dump_bt_done_wait,
 							dump_bt_done == 1,
 							HZ*10);
+				} else if (!Hang_first_done &&
+					hang_sample_report(log_hang_sample)) {
+					/*
+					 * The sampled stacks stand in for the
+					 * first full dump, the system is only
+					 * dumped completely before the DB.
+					 */
+					signal_hang_dumpers();
 				} else
 					wake_up_dump();
 
@@ -1443,6 +1486,8 @@ int hang_detect_init(void)
 	if (hd_thread)
 		wake_up_process(hd_thread);
 
+	hang_sample_start();
+
 	return 0;
 }
 
@@ -1480,6 +1525,7 @@ static int __init monitor_hang_init(void)
 static void __exit monitor_hang_exit(void)
 {
 	mrdump_regist_hang_bt(NULL);
+	hang_sample_stop();
 	misc_deregister(&Hang_Monitor_dev);
 #ifdef CONFIG_MTK_HANG_DETECT_DB
 	/* kfree(NULL) is safe */
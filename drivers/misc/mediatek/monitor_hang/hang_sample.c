@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2021 MediaTek Inc.
+ */
+#include <linux/bitmap.h>
+#include <linux/jhash.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task_stack.h>
+#include <linux/spinlock.h>
+#include <linux/stacktrace.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+#include "hang_sample.h"
+#include "hang_unwind.h"
+
+/*
+ * Low rate sampler of blocked tasks. Every HS_PERIOD_MS the kernel
+ * stacks of tasks in D state, and of tasks that have been waiting on a
+ * runqueue for longer than HS_RUNNABLE_NS, are hashed into a fixed
+ * histogram. On a hang only the hottest stacks are reported, instead
+ * of dumping every thread in the system.
+ */
+#define HS_BUCKETS	256	/* power of two */
+#define HS_MAX_USED	(HS_BUCKETS * 3 / 4)
+#define HS_DEPTH	16
+#define HS_PERIOD_MS	2000
+#define HS_RUNNABLE_NS	(500 * NSEC_PER_MSEC)
+#define HS_REPORT_MAX	16
+
+struct hs_entry {
+	u32 hash;
+	u32 count;
+	char state;
+	unsigned int nr_entries;
+	unsigned long stack[HS_DEPTH];
+	/* last task seen with this stack */
+	char comm[TASK_COMM_LEN];
+	pid_t pid;
+};
+
+static struct hs_entry hs_table[HS_BUCKETS];
+static unsigned int hs_used;
+static unsigned int hs_dropped;
+static unsigned int hs_rounds;
+static DEFINE_SPINLOCK(hs_lock);
+static struct delayed_work hs_work;
+
+static char hs_task_state(struct task_struct *p, u64 now)
+{
+	/* TASK_IDLE kthreads sleep in D state by design */
+	if ((p->state & TASK_UNINTERRUPTIBLE) && !(p->state & TASK_NOLOAD))
+		return 'D';
+#ifdef CONFIG_SCHED_INFO
+	/* last_queued is only set while the task waits on a runqueue */
+	if (p->state == TASK_RUNNING && p->sched_info.last_queued &&
+	    now > p->sched_info.last_queued + HS_RUNNABLE_NS)
+		return 'R';
+#endif
+	return 0;
+}
+
+static void hs_account(struct task_struct *p, char state,
+		       unsigned long *stack, unsigned int nr_entries)
+{
+	struct hs_entry *e;
+	u32 hash, i, idx;
+
+	hash = jhash(stack, nr_entries * sizeof(*stack), state);
+
+	spin_lock(&hs_lock);
+	for (i = 0; i < HS_BUCKETS; i++) {
+		idx = (hash + i) & (HS_BUCKETS - 1);
+		e = &hs_table[idx];
+		if (!e->count)
+			break;
+		if (e->hash == hash && e->state == state &&
+		    e->nr_entries == nr_entries &&
+		    !memcmp(e->stack, stack, nr_entries * sizeof(*stack)))
+			goto found;
+	}
+
+	if (i == HS_BUCKETS || hs_used >= HS_MAX_USED) {
+		hs_dropped++;
+		goto out;
+	}
+
+	e->hash = hash;
+	e->state = state;
+	e->nr_entries = nr_entries;
+	memcpy(e->stack, stack, nr_entries * sizeof(*stack));
+	hs_used++;
+found:
+	e->count++;
+	memcpy(e->comm, p->comm, TASK_COMM_LEN);
+	e->pid = task_pid_nr(p);
+out:
+	spin_unlock(&hs_lock);
+}
+
+static void hs_sample(struct work_struct *work)
+{
+	struct task_struct *p, *t;
+	unsigned long stack[HS_DEPTH];
+	unsigned int nr_entries;
+	u64 now = sched_clock();
+	char state;
+
+	rcu_read_lock();
+	for_each_process_thread(p, t) {
+		state = hs_task_state(t, now);
+		if (!state || !try_get_task_stack(t))
+			continue;
+#ifndef __aarch64__
+		nr_entries = stack_trace_save_tsk(t, stack, HS_DEPTH, 0);
+#else
+		nr_entries = hang_kernel_trace(t, stack, HS_DEPTH);
+#endif
+		put_task_stack(t);
+		if (nr_entries)
+			hs_account(t, state, stack, nr_entries);
+	}
+	rcu_read_unlock();
+
+	spin_lock(&hs_lock);
+	hs_rounds++;
+	spin_unlock(&hs_lock);
+
+	queue_delayed_work(system_power_efficient_wq, &hs_work,
+			   msecs_to_jiffies(HS_PERIOD_MS));
+}
+
+/* start a new window, called whenever user space kicks hang_detect */
+void hang_sample_reset(void)
+{
+	spin_lock(&hs_lock);
+	memset(hs_table, 0, sizeof(hs_table));
+	hs_used = 0;
+	hs_dropped = 0;
+	hs_rounds = 0;
+	spin_unlock(&hs_lock);
+}
+
+/*
+ * Print the most frequent stacks of the current window through @out,
+ * returns the number of stacks printed.
+ */
+int hang_sample_report(void (*out)(const char *fmt, ...))
+{
+	DECLARE_BITMAP(done, HS_BUCKETS);
+	struct hs_entry *e;
+	int n, i, j, best;
+
+	bitmap_zero(done, HS_BUCKETS);
+
+	spin_lock(&hs_lock);
+	out("hang sample: %u rounds of %dms, %u stacks, %u dropped\n",
+		hs_rounds, HS_PERIOD_MS, hs_used, hs_dropped);
+	for (n = 0; n < HS_REPORT_MAX; n++) {
+		best = -1;
+		for (i = 0; i < HS_BUCKETS; i++) {
+			if (!hs_table[i].count || test_bit(i, done))
+				continue;
+			if (best < 0 || hs_table[i].count > hs_table[best].count)
+				best = i;
+		}
+		if (best < 0)
+			break;
+		__set_bit(best, done);
+
+		e = &hs_table[best];
+		out("#%d %c hits %u, last %s:%d\n", n, e->state, e->count,
+			e->comm, e->pid);
+		for (j = 0; j < e->nr_entries; j++)
+			out("  <%lx> %pS\n", e->stack[j], (void *)e->stack[j]);
+	}
+	spin_unlock(&hs_lock);
+
+	return n;
+}
+
+void hang_sample_start(void)
+{
+	INIT_DEFERRABLE_WORK(&hs_work, hs_sample);
+	queue_delayed_work(system_power_efficient_wq, &hs_work,
+			   msecs_to_jiffies(HS_PERIOD_MS));
+}
+
+void hang_sample_stop(void)
+{
+	cancel_delayed_work_sync(&hs_work);
+}
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2021 MediaTek Inc.
+ */
+#ifndef _HANG_SAMPLE_H
+#define _HANG_SAMPLE_H
+extern void hang_sample_start(void);
+extern void hang_sample_stop(void);
+extern void hang_sample_reset(void);
+extern int hang_sample_report(void (*out)(const char *fmt, ...));
+#endif
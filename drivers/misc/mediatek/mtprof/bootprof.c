@@ -3,6 +3,7 @@
  * Copyright (c) 2020 MediaTek Inc.
  */
 
+#include <linux/async.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/proc_fs.h>
@@ -13,7 +14,9 @@
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/seq_file.h>
+#include <linux/sort.h>
 #include <linux/tracepoint.h>
+#include <linux/vmalloc.h>
 #include <trace/events/initcall.h>
 
 /* Define */
@@ -21,6 +24,9 @@
 #define BUF_COUNT 12
 #define LOGS_PER_BUF 80
 #define MSG_SIZE 128
+#define TL_MAX 2048
+#define TL_NAME_SIZE 32
+#define TL_REPORT_TOP 20
 
 #ifdef CONFIG_BOOTPROF_THRESHOLD_MS
 #define BOOTPROF_THRESHOLD (CONFIG_BOOTPROF_THRESHOLD_MS*1000000)
@@ -54,10 +60,44 @@ struct tracepoints_table {
 struct initcall_list_t {
 	pid_t pid;
 	pid_t tid;
+	int cpu;
+	initcall_t fn;
 	u64 timestamp;
 	struct list_head dev_entry;
 };
+
+/**
+ * Boot timeline: one entry per initcall and per driver probe attempt,
+ * whatever its duration, for the critical path report
+ */
+enum tl_type {
+	TL_INITCALL,
+	TL_PROBE,
+};
+
+#define TL_DONE		BIT(0)	/* end is valid */
+#define TL_BOUND	BIT(1)	/* probe bound the driver */
+#define TL_ASYNC	BIT(2)	/* probe ran from an async thread */
+#define TL_FORCE_SYNC	BIT(3)	/* driver is PROBE_FORCE_SYNCHRONOUS */
+#define TL_PREFER_ASYNC	BIT(4)	/* driver is PROBE_PREFER_ASYNCHRONOUS */
+
+struct tl_event_t {
+	u64 start;
+	u64 end;
+	const void *key;	/* initcall fn or probed device */
+	initcall_t parent;	/* initcall a probe ran from, if any */
+	pid_t pid;
+	u16 attempt;		/* probe attempts of this device so far */
+	s16 unblocked_by;	/* last bind before a deferred retry */
+	u8 type;
+	u8 flags;
+	u8 cpu_start;
+	u8 cpu_end;
+	char name[TL_NAME_SIZE];
+	char drv[TL_NAME_SIZE];
+};
 static void tp_deinit(void);
+static void tl_deinit(void);
 
 /* Parameters */
 static struct log_t *bootprof[BUF_COUNT];
@@ -74,6 +114,12 @@ static struct list_head initcall_list;
 static DEFINE_SPINLOCK(initcall_lock);
 atomic_t initcall_num = ATOMIC_INIT(0);
 
+static struct tl_event_t *tl_events;
+static unsigned int tl_count;
+static int tl_last_bound = -1;
+static bool tl_init_done;
+static DEFINE_SPINLOCK(tl_lock);
+
 /*Get info form cmdline*/
 module_param_named(pl_t, bf_pl_t, int, 0644);
 module_param_named(lk_t, bf_lk_t, int, 0644);
@@ -265,6 +311,348 @@ void bootprof_pdev_register(unsigned long long ts, struct platform_device *pdev)
 EXPORT_SYMBOL_GPL(bootprof_pdev_register);
 #endif /*MODULE END*/
 
+/* Take a timeline entry, tl_lock must be held */
+static struct tl_event_t *tl_new(enum tl_type type, const void *key, u64 ts)
+{
+	struct tl_event_t *e;
+
+	if (!tl_events || tl_count >= TL_MAX || boot_finish)
+		return NULL;
+
+	e = &tl_events[tl_count++];
+	memset(e, 0, sizeof(*e));
+	e->type = type;
+	e->key = key;
+	e->start = ts;
+	e->pid = current->pid;
+	e->unblocked_by = -1;
+	e->cpu_start = raw_smp_processor_id();
+
+	return e;
+}
+
+static __init_or_module void
+tl_initcall(initcall_t fn, u64 start_ts, u64 end_ts, int cpu)
+{
+	struct tl_event_t *e;
+
+	spin_lock(&tl_lock);
+	e = tl_new(TL_INITCALL, fn, start_ts);
+	if (e) {
+		e->end = end_ts;
+		e->cpu_start = cpu;
+		e->cpu_end = raw_smp_processor_id();
+		e->flags = TL_DONE;
+		/* module init text is gone by the time the report is read */
+		scnprintf(e->name, sizeof(e->name), "%ps", fn);
+	}
+	spin_unlock(&tl_lock);
+}
+
+/* initcall the current task is running, if any */
+static initcall_t tl_current_initcall(void)
+{
+	struct initcall_list_t *pos;
+	initcall_t fn = NULL;
+
+	spin_lock(&initcall_lock);
+	list_for_each_entry(pos, &initcall_list, dev_entry) {
+		if ((pos->pid == task_pid_nr(current)) &&
+		    (pos->tid == task_pid_vnr(current))) {
+			fn = pos->fn;
+			break;
+		}
+	}
+	spin_unlock(&initcall_lock);
+
+	return fn;
+}
+
+static void tl_probe_start(struct device *dev)
+{
+	struct device_driver *drv = dev->driver;
+	initcall_t parent = tl_current_initcall();
+	u64 ts = sched_clock();
+	struct tl_event_t *e;
+	u16 attempt = 1;
+	int i;
+
+	spin_lock(&tl_lock);
+	for (i = tl_count - 1; i >= 0; i--) {
+		if (tl_events[i].type == TL_PROBE && tl_events[i].key == dev) {
+			attempt = tl_events[i].attempt + 1;
+			break;
+		}
+	}
+
+	e = tl_new(TL_PROBE, dev, ts);
+	if (!e)
+		goto out;
+
+	e->attempt = attempt;
+	e->parent = parent;
+	if (attempt > 1)
+		e->unblocked_by = tl_last_bound;
+	if (current_is_async())
+		e->flags |= TL_ASYNC;
+	strlcpy(e->name, dev_name(dev), sizeof(e->name));
+	if (drv) {
+		strlcpy(e->drv, drv->name, sizeof(e->drv));
+		if (drv->probe_type == PROBE_FORCE_SYNCHRONOUS)
+			e->flags |= TL_FORCE_SYNC;
+		else if (drv->probe_type == PROBE_PREFER_ASYNCHRONOUS)
+			e->flags |= TL_PREFER_ASYNC;
+	}
+out:
+	spin_unlock(&tl_lock);
+}
+
+static void tl_probe_end(struct device *dev, bool bound)
+{
+	u64 ts = sched_clock();
+	struct tl_event_t *e;
+	int i;
+
+	spin_lock(&tl_lock);
+	for (i = tl_count - 1; i >= 0; i--) {
+		e = &tl_events[i];
+		if (e->type != TL_PROBE || e->key != dev)
+			continue;
+		if (e->flags & TL_DONE)
+			break;
+
+		e->end = ts;
+		e->cpu_end = raw_smp_processor_id();
+		e->flags |= TL_DONE;
+		if (bound) {
+			e->flags |= TL_BOUND;
+			tl_last_bound = i;
+		}
+		break;
+	}
+	spin_unlock(&tl_lock);
+}
+
+/* Probe start/end of platform devices, deferred or not */
+static int tl_bus_notify(struct notifier_block *nb, unsigned long action,
+			 void *data)
+{
+	struct device *dev = data;
+
+	switch (action) {
+	case BUS_NOTIFY_BIND_DRIVER:
+		tl_probe_start(dev);
+		break;
+	case BUS_NOTIFY_BOUND_DRIVER:
+		tl_probe_end(dev, true);
+		break;
+	case BUS_NOTIFY_DRIVER_NOT_BOUND:
+		tl_probe_end(dev, false);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block tl_bus_nb = {
+	.notifier_call = tl_bus_notify,
+};
+
+static void tl_init(void)
+{
+	tl_events = vzalloc(TL_MAX * sizeof(*tl_events));
+	if (!tl_events) {
+		pr_info("[BOOTPROF] fail to allocate timeline\n");
+		return;
+	}
+
+	if (bus_register_notifier(&platform_bus_type, &tl_bus_nb)) {
+		pr_info("[BOOTPROF] fail to register bus notifier\n");
+		return;
+	}
+	tl_init_done = true;
+}
+
+/* Stop recording, the timeline is kept for the report */
+static void tl_deinit(void)
+{
+	if (tl_init_done) {
+		bus_unregister_notifier(&platform_bus_type, &tl_bus_nb);
+		tl_init_done = false;
+	}
+}
+
+static u64 tl_duration(const struct tl_event_t *e)
+{
+	return (e->flags & TL_DONE) ? e->end - e->start : 0;
+}
+
+static int mt_bootprof_tl_show(struct seq_file *m, void *v)
+{
+	struct tl_event_t *e;
+	unsigned int i;
+
+	seq_puts(m, "# start end dur(ms) cpu pid type attempt flags name drv parent unblocked_by\n");
+	for (i = 0; i < READ_ONCE(tl_count); i++) {
+		e = &tl_events[i];
+		seq_printf(m, "%llu.%06lu %llu.%06lu %llu.%06lu %u-%u %d %s %u %c%c%c%c %s %s %ps %d\n",
+			msec_high(e->start), msec_low(e->start),
+			msec_high(e->end), msec_low(e->end),
+			msec_high(tl_duration(e)), msec_low(tl_duration(e)),
+			e->cpu_start, e->cpu_end, e->pid,
+			e->type == TL_INITCALL ? "initcall" : "probe",
+			e->attempt,
+			(e->flags & TL_BOUND) ? 'B' : '-',
+			(e->flags & TL_ASYNC) ? 'A' : '-',
+			(e->flags & TL_FORCE_SYNC) ? 'S' : '-',
+			(e->flags & TL_PREFER_ASYNC) ? 'P' : '-',
+			e->name, e->drv[0] ? e->drv : "-",
+			e->parent, e->unblocked_by);
+	}
+
+	return 0;
+}
+
+static int tl_cmp_duration(const void *a, const void *b)
+{
+	u64 da = tl_duration(&tl_events[*(const u32 *)a]);
+	u64 db = tl_duration(&tl_events[*(const u32 *)b]);
+
+	return da < db ? 1 : (da > db ? -1 : 0);
+}
+
+/*
+ * Critical path: initcalls run one after another from kernel_init, and a
+ * probe that runs from one of them (sync probe) holds up every later
+ * initcall. Probes from async threads or the deferred probe work only
+ * cost boot time when something waits for them.
+ */
+static int mt_bootprof_critical_show(struct seq_file *m, void *v)
+{
+	unsigned int count = READ_ONCE(tl_count);
+	u64 first = U64_MAX, last = 0, busy = 0;
+	u64 initcall_sum = 0, sync_probe = 0, defer_waste = 0;
+	struct tl_event_t *e, *u;
+	unsigned int i, n = 0;
+	u32 *idx;
+
+	for (i = 0; i < count; i++) {
+		e = &tl_events[i];
+		if (!(e->flags & TL_DONE))
+			continue;
+		first = min(first, e->start);
+		last = max(last, e->end);
+		if (e->type == TL_INITCALL) {
+			initcall_sum += tl_duration(e);
+			busy += tl_duration(e);
+		} else if (e->parent && !(e->flags & TL_ASYNC)) {
+			sync_probe += tl_duration(e);
+		} else {
+			busy += tl_duration(e);
+		}
+		if (e->type == TL_PROBE && !(e->flags & TL_BOUND))
+			defer_waste += tl_duration(e);
+	}
+	if (first >= last) {
+		seq_puts(m, "no timeline recorded\n");
+		return 0;
+	}
+
+	seq_puts(m, "----------------------------------------\n");
+	seq_printf(m, "%10lld.%06ld : span (%u events%s)\n",
+		msec_high(last - first), msec_low(last - first), count,
+		count >= TL_MAX ? ", full" : "");
+	seq_printf(m, "%10lld.%06ld : initcalls\n",
+		msec_high(initcall_sum), msec_low(initcall_sum));
+	seq_printf(m, "%10lld.%06ld : sync probes inside initcalls\n",
+		msec_high(sync_probe), msec_low(sync_probe));
+	seq_printf(m, "%10lld.%06ld : failed/deferred probe attempts\n",
+		msec_high(defer_waste), msec_low(defer_waste));
+	seq_printf(m, "%10llu.%02llu  : average parallelism\n",
+		div64_u64(busy, last - first),
+		div64_u64(busy * 100, last - first) % 100);
+
+	idx = kmalloc_array(count, sizeof(*idx), GFP_KERNEL);
+	if (!idx)
+		return -ENOMEM;
+
+	/* sync probes holding up the initcall sequence */
+	for (i = 0; i < count; i++) {
+		e = &tl_events[i];
+		if (e->type == TL_PROBE && e->parent &&
+		    !(e->flags & TL_ASYNC) && (e->flags & TL_DONE))
+			idx[n++] = i;
+	}
+	sort(idx, n, sizeof(*idx), tl_cmp_duration, NULL);
+	seq_puts(m, "----------------------------------------\n");
+	seq_puts(m, "serializing probes (async: could be PROBE_PREFER_ASYNCHRONOUS)\n");
+	for (i = 0; i < min_t(unsigned int, n, TL_REPORT_TOP); i++) {
+		e = &tl_events[idx[i]];
+		seq_printf(m, "%10lld.%06ld : %s drv=%s from %ps%s\n",
+			msec_high(tl_duration(e)), msec_low(tl_duration(e)),
+			e->name, e->drv, e->parent,
+			(e->flags & TL_FORCE_SYNC) ? " (forced sync)" : " (async)");
+	}
+
+	/* slowest initcalls */
+	for (i = 0, n = 0; i < count; i++) {
+		if (tl_events[i].type == TL_INITCALL)
+			idx[n++] = i;
+	}
+	sort(idx, n, sizeof(*idx), tl_cmp_duration, NULL);
+	seq_puts(m, "----------------------------------------\n");
+	seq_puts(m, "slowest initcalls\n");
+	for (i = 0; i < min_t(unsigned int, n, TL_REPORT_TOP); i++) {
+		e = &tl_events[idx[i]];
+		seq_printf(m, "%10lld.%06ld : %s cpu%u-%u pid %d\n",
+			msec_high(tl_duration(e)), msec_low(tl_duration(e)),
+			e->name, e->cpu_start, e->cpu_end, e->pid);
+	}
+
+	/* devices bound on a retry, and the bind that let them through */
+	seq_puts(m, "----------------------------------------\n");
+	seq_puts(m, "deferred probe chains\n");
+	for (i = 0; i < count; i++) {
+		e = &tl_events[i];
+		if (e->type != TL_PROBE || e->attempt < 2 ||
+		    !(e->flags & TL_BOUND))
+			continue;
+		u = e->unblocked_by >= 0 ? &tl_events[e->unblocked_by] : NULL;
+		seq_printf(m, "%10lld.%06ld : %s drv=%s bound on attempt %u after %s\n",
+			msec_high(e->end), msec_low(e->end), e->name, e->drv,
+			e->attempt, u ? u->name : "-");
+	}
+	seq_puts(m, "----------------------------------------\n");
+	kfree(idx);
+
+	return 0;
+}
+
+static int mt_bootprof_tl_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, mt_bootprof_tl_show, inode->i_private,
+			(READ_ONCE(tl_count) + 1) * 192);
+}
+
+static int mt_bootprof_critical_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mt_bootprof_critical_show, inode->i_private);
+}
+
+static const struct proc_ops mt_bootprof_tl_fops = {
+	.proc_open = mt_bootprof_tl_open,
+	.proc_read = seq_read,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
+static const struct proc_ops mt_bootprof_critical_fops = {
+	.proc_open = mt_bootprof_critical_open,
+	.proc_read = seq_read,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
 /*  initcalls tracepoint cb while initcall_debug=1 */
 static __init_or_module void
 tp_initcall_start_cb(void *data, initcall_t fn)
@@ -282,6 +670,8 @@ tp_initcall_start_cb(void *data, initcall_t fn)
 
 	obj->pid = task_pid_nr(current);
 	obj->tid = task_pid_vnr(current);
+	obj->cpu = raw_smp_processor_id();
+	obj->fn = fn;
 	obj->timestamp = sched_clock();
 
 	/*Check if there is duplicated enrty.*/
@@ -317,6 +707,7 @@ tp_initcall_finish_cb(void *data, initcall_t fn, int ret)
 	struct list_head memfree_list;
 	unsigned long long end_ts = sched_clock();
 	unsigned long long duration;
+	int start_cpu = 0;
 
 	INIT_LIST_HEAD(&memfree_list);
 
@@ -325,6 +716,7 @@ tp_initcall_finish_cb(void *data, initcall_t fn, int ret)
 		if ((pos->pid == task_pid_nr(current)) &&
 		    (pos->tid == task_pid_vnr(current))) {
 			start_ts = pos->timestamp;
+			start_cpu = pos->cpu;
 			list_del(&pos->dev_entry);
 			list_add_tail(&pos->dev_entry, &memfree_list);
 			break;
@@ -350,6 +742,7 @@ tp_initcall_finish_cb(void *data, initcall_t fn, int ret)
 	}
 	duration = end_ts - start_ts;
 	bootprof_initcall(fn, duration);
+	tl_initcall(fn, start_ts, end_ts, start_cpu);
 }
 
 static struct tracepoints_table interests[] = {
@@ -455,6 +848,7 @@ static void mt_bootprof_switch(int on)
 				boot_finish = true;
 				/* Unregister Initcall tracepointsk while boot finish */
 				tp_deinit();
+				tl_deinit();
 			}
 		}
 	}
@@ -572,7 +966,11 @@ static int __init bootprof_init(void)
 		pr_info("[BOOTPROF] fail to create file node\n");
 		return -ENOMEM;
 	}
+	proc_create("bootprof_timeline", 0444, NULL, &mt_bootprof_tl_fops);
+	proc_create("bootprof_critical", 0444, NULL,
+		&mt_bootprof_critical_fops);
 	bootprof_bootloader();
+	tl_init();
 	tp_init();
 	mt_bootprof_switch(1);
 
@@ -585,6 +983,7 @@ static void __exit bootprof_exit(void)
 	unsigned int i;
 
 	tp_deinit();
+	tl_deinit();
 
 	if (log_count > 0) {
 		spin_lock(&bootprof_lock);
@@ -599,7 +998,10 @@ static void __exit bootprof_exit(void)
 
 		spin_unlock(&bootprof_lock);
 	}
+	remove_proc_entry("bootprof_critical", NULL);
+	remove_proc_entry("bootprof_timeline", NULL);
 	remove_proc_entry("bootprof", NULL);
+	vfree(tl_events);
 	pr_info("bootprof module exit.\n");
 }
 
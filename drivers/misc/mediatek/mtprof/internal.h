@@ -31,6 +31,22 @@ void irq_count_tracer_proc_init(struct proc_dir_entry *parent);
 #define TO_BOTH       (TO_FTRACE | TO_KERNEL_LOG)
 
 #define MAX_MSG_LEN 160
+#define MAX_IRQ_NUM 1024
+
+// duration histograms
+#define IRQ_MON_HIST_BUCKETS 16
+int irq_mon_hist_init(void);
+void irq_mon_hist_exit(void);
+void irq_mon_hist_proc_init(struct proc_dir_entry *parent);
+void irq_mon_hist_irq(int irq, unsigned long long duration);
+void irq_mon_hist_softirq(unsigned int vec_nr, unsigned long long duration);
+void irq_mon_hist_section(int irq, unsigned long ip, unsigned long long duration);
+
+// load aware irq balancing
+int irq_balance_init(void);
+void irq_balance_exit(void);
+void irq_balance_proc_init(struct proc_dir_entry *parent);
+void irq_balance_irq(int irq, unsigned long long duration);
 
 void irq_mon_msg(unsigned int out, char *buf, ...);
 
@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2021 MediaTek Inc.
+ */
+
+/*
+ * Load aware irq balancing.
+ *
+ * The generic code spreads managed irqs once at allocation time and
+ * leaves everything else wherever the driver or init put it, which is
+ * usually CPU0. This moves device irqs off CPUs that are busy or that
+ * userspace marked as latency critical (protect_cpus) and onto the least
+ * busy lowest capacity CPU, but only when the handler is cheap enough
+ * for such a core:
+ *  - the handler cost comes from the irq handler tracer, scaled by the
+ *    capacity ratio between the source and the target CPU; when the
+ *    tracer is off the irq rate from kstat is used instead
+ *  - the CPU busy time comes from the nohz idle time accounting
+ *
+ * Managed, per-cpu, non-balanceable irqs and irqs with a driver affinity
+ * hint are left alone. A moved irq is not touched again for hold_ms.
+ * The balancer runs from a deferrable work, so it never wakes an idle
+ * system just to look at it.
+ */
+
+#include <linux/cpumask.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/irqdesc.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/percpu-defs.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/topology.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/tick.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include "internal.h"
+
+struct irq_balance_irq {
+	unsigned int count;
+	u64 cost_ns;
+	unsigned long moved;
+};
+
+struct irq_balance_cpu {
+	u64 idle_us;
+	u64 wall_us;
+	/* busy permille of the last period, plus what was moved on it */
+	unsigned int busy;
+};
+
+static bool irq_balance;
+static bool irq_balance_primed;
+static unsigned int irq_balance_period_ms = 1000;
+static unsigned int irq_balance_busy_th = 800;		/* permille */
+static unsigned int irq_balance_cost_th = 50;		/* permille */
+static unsigned int irq_balance_rate_th = 2000;		/* irqs/s */
+static unsigned int irq_balance_hold_ms = 10000;
+static unsigned int irq_balance_max_moves = 4;
+static unsigned int irq_balance_moves;
+static struct cpumask irq_balance_protect;
+
+static DEFINE_MUTEX(irq_balance_lock);
+static DEFINE_PER_CPU(u64 *, irq_balance_cost);
+static DEFINE_PER_CPU(struct irq_balance_cpu, irq_balance_cpu);
+static struct irq_balance_irq *irq_balance_irqs;
+static unsigned int irq_balance_nr_irqs;
+
+static void irq_balance_workfn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(irq_balance_work, irq_balance_workfn);
+
+/* irq handler tracer, hardirq context */
+void irq_balance_irq(int irq, unsigned long long duration)
+{
+	u64 *cost = __this_cpu_read(irq_balance_cost);
+
+	if (!cost || irq < 0 || irq >= irq_balance_nr_irqs)
+		return;
+
+	cost[irq] += duration;
+}
+
+static unsigned int irq_balance_irq_count(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	unsigned int sum = 0;
+	int cpu;
+
+	if (!desc || !desc->kstat_irqs)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		sum += *per_cpu_ptr(desc->kstat_irqs, cpu);
+	return sum;
+}
+
+static void irq_balance_update_cpus(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct irq_balance_cpu *c = per_cpu_ptr(&irq_balance_cpu, cpu);
+		u64 idle, wall = 0;
+
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL || wall <= c->wall_us) {
+			c->busy = 0;
+		} else {
+			u64 d_wall = wall - c->wall_us;
+			u64 d_idle = min(idle - c->idle_us, d_wall);
+
+			c->busy = div64_u64((d_wall - d_idle) * 1000, d_wall);
+		}
+		c->idle_us = idle;
+		c->wall_us = wall;
+	}
+}
+
+/*
+ * The least busy online CPU of the lowest capacity that is not protected.
+ * Returns nr_cpu_ids if every such CPU is protected.
+ */
+static int irq_balance_target(const struct cpumask *protect,
+		unsigned long *cap)
+{
+	unsigned long min_cap = ULONG_MAX;
+	unsigned int min_busy = UINT_MAX;
+	int cpu, target = nr_cpu_ids;
+
+	for_each_online_cpu(cpu)
+		min_cap = min(min_cap, arch_scale_cpu_capacity(cpu));
+
+	for_each_online_cpu(cpu) {
+		unsigned int busy = per_cpu(irq_balance_cpu.busy, cpu);
+
+		if (arch_scale_cpu_capacity(cpu) != min_cap ||
+		    cpumask_test_cpu(cpu, protect))
+			continue;
+		if (busy < min_busy) {
+			min_busy = busy;
+			target = cpu;
+		}
+	}
+	*cap = min_cap;
+	return target;
+}
+
+/* only irqs nobody else has placed on purpose */
+static bool irq_balance_eligible(struct irq_desc *desc)
+{
+	struct irq_data *d = irq_desc_get_irq_data(desc);
+
+	return desc->action && !desc->affinity_hint &&
+		irqd_can_balance(d) && !irqd_is_per_cpu(d) &&
+		!irqd_affinity_is_managed(d);
+}
+
+static void irq_balance_run(void)
+{
+	unsigned int period_ms = max(irq_balance_period_ms, 1U);
+	unsigned int moves = 0;
+	struct cpumask protect;
+	unsigned long min_cap;
+	int irq, cpu, target;
+
+	irq_balance_update_cpus();
+
+	cpumask_and(&protect, &irq_balance_protect, cpu_online_mask);
+	for_each_online_cpu(cpu)
+		if (per_cpu(irq_balance_cpu.busy, cpu) >= irq_balance_busy_th)
+			cpumask_set_cpu(cpu, &protect);
+
+	target = irq_balance_target(&protect, &min_cap);
+	/* the first run after enabling only takes the baseline */
+	if (!irq_balance_primed) {
+		irq_balance_primed = true;
+		target = nr_cpu_ids;
+	}
+
+	for (irq = 0; irq < irq_balance_nr_irqs; irq++) {
+		struct irq_balance_irq *s = &irq_balance_irqs[irq];
+		struct irq_desc *desc = irq_to_desc(irq);
+		unsigned int count;
+		u64 cost = 0, d_cost, rate, load;
+		unsigned long flags;
+		unsigned long cap;
+		bool eligible;
+		int src;
+
+		if (!desc)
+			continue;
+
+		count = irq_balance_irq_count(irq);
+		for_each_possible_cpu(cpu) {
+			u64 *c = per_cpu(irq_balance_cost, cpu);
+
+			cost += c ? c[irq] : 0;
+		}
+		d_cost = cost - s->cost_ns;
+		rate = div_u64((u64)(count - s->count) * MSEC_PER_SEC, period_ms);
+		load = div_u64(d_cost, period_ms * NSEC_PER_USEC);
+		s->count = count;
+		s->cost_ns = cost;
+
+		if (target >= nr_cpu_ids || moves >= irq_balance_max_moves)
+			continue;
+		if (!rate || time_before(jiffies, s->moved +
+				msecs_to_jiffies(irq_balance_hold_ms)))
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		eligible = irq_balance_eligible(desc);
+		src = cpumask_first_and(irq_data_get_effective_affinity_mask(
+				irq_desc_get_irq_data(desc)), cpu_online_mask);
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+		if (!eligible || src >= nr_cpu_ids ||
+		    !cpumask_test_cpu(src, &protect))
+			continue;
+
+		/* the handler runs slower on the target, scale its cost */
+		cap = arch_scale_cpu_capacity(src);
+		if (d_cost)
+			load = div_u64(load * cap, max(min_cap, 1UL));
+		else if (rate > irq_balance_rate_th)
+			continue;
+		if (load > irq_balance_cost_th)
+			continue;
+
+		if (__irq_set_affinity(irq, cpumask_of(target), false))
+			continue;
+
+		pr_info("irq_balance: irq %d (%s) cpu%d -> cpu%d, %llu/s, %llu permille\n",
+			irq, irq_to_name(irq), src, target, rate, load);
+		per_cpu(irq_balance_cpu.busy, target) += load;
+		s->moved = jiffies;
+		moves++;
+		irq_balance_moves++;
+
+		/* the cheapest core may have changed */
+		target = irq_balance_target(&protect, &min_cap);
+	}
+}
+
+static void irq_balance_workfn(struct work_struct *work)
+{
+	irq_balance_run();
+	if (READ_ONCE(irq_balance))
+		queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				msecs_to_jiffies(irq_balance_period_ms));
+}
+
+static void irq_balance_set(bool val)
+{
+	if (irq_balance == val)
+		return;
+
+	WRITE_ONCE(irq_balance, val);
+	if (val) {
+		irq_balance_primed = false;
+		queue_delayed_work(system_power_efficient_wq,
+				&irq_balance_work, 0);
+	} else {
+		cancel_delayed_work_sync(&irq_balance_work);
+	}
+}
+
+static ssize_t irq_balance_write(struct file *filp,
+		const char *ubuf, size_t count, loff_t *data)
+{
+	int ret;
+	bool val;
+
+	ret = kstrtobool_from_user(ubuf, count, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&irq_balance_lock);
+	irq_balance_set(val);
+	mutex_unlock(&irq_balance_lock);
+
+	return count;
+}
+
+static const struct proc_ops irq_balance_pops = {
+	.proc_open = irq_mon_bool_open,
+	.proc_write = irq_balance_write,
+	.proc_read = seq_read,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
+static int irq_balance_protect_show(struct seq_file *s, void *p)
+{
+	seq_printf(s, "%*pbl\n", cpumask_pr_args(&irq_balance_protect));
+	return 0;
+}
+
+static int irq_balance_protect_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_protect_show, NULL);
+}
+
+/* cpu list, e.g. "4-7" */
+static ssize_t irq_balance_protect_write(struct file *filp,
+		const char *ubuf, size_t count, loff_t *data)
+{
+	cpumask_var_t mask;
+	int ret;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpumask_parselist_user(ubuf, count, mask);
+	if (!ret)
+		cpumask_copy(&irq_balance_protect, mask);
+	free_cpumask_var(mask);
+
+	return ret ? ret : count;
+}
+
+static const struct proc_ops irq_balance_protect_pops = {
+	.proc_open = irq_balance_protect_open,
+	.proc_write = irq_balance_protect_write,
+	.proc_read = seq_read,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
+void irq_balance_proc_init(struct proc_dir_entry *parent)
+{
+	struct proc_dir_entry *dir;
+
+	if (!irq_balance_irqs)
+		return;
+
+	dir = proc_mkdir("irq_balance", parent);
+	if (!dir)
+		return;
+
+	proc_create_data("irq_balance", 0644, dir, &irq_balance_pops,
+			(void *)&irq_balance);
+	proc_create("protect_cpus", 0644, dir, &irq_balance_protect_pops);
+	IRQ_MON_TRACER_PROC_ENTRY(period_ms, 0644, uint, dir, &irq_balance_period_ms);
+	IRQ_MON_TRACER_PROC_ENTRY(busy_th, 0644, uint, dir, &irq_balance_busy_th);
+	IRQ_MON_TRACER_PROC_ENTRY(cost_th, 0644, uint, dir, &irq_balance_cost_th);
+	IRQ_MON_TRACER_PROC_ENTRY(rate_th, 0644, uint, dir, &irq_balance_rate_th);
+	IRQ_MON_TRACER_PROC_ENTRY(hold_ms, 0644, uint, dir, &irq_balance_hold_ms);
+	IRQ_MON_TRACER_PROC_ENTRY(max_moves, 0644, uint, dir, &irq_balance_max_moves);
+	IRQ_MON_TRACER_PROC_ENTRY(moves, 0444, uint, dir, &irq_balance_moves);
+}
+
+int irq_balance_init(void)
+{
+	int cpu;
+
+	irq_balance_nr_irqs = min_t(unsigned int, nr_irqs, MAX_IRQ_NUM);
+	irq_balance_irqs = kcalloc(irq_balance_nr_irqs,
+			sizeof(*irq_balance_irqs), GFP_KERNEL);
+	if (!irq_balance_irqs)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(irq_balance_cost, cpu) =
+			kcalloc_node(irq_balance_nr_irqs, sizeof(u64),
+				GFP_KERNEL, cpu_to_node(cpu));
+		if (!per_cpu(irq_balance_cost, cpu))
+			goto fail;
+	}
+
+	return 0;
+fail:
+	pr_info("Failed to alloc irq_balance\n");
+	irq_balance_exit();
+	return -ENOMEM;
+}
+
+/* called after the tracepoints are gone */
+void irq_balance_exit(void)
+{
+	int cpu;
+
+	irq_balance_set(false);
+	for_each_possible_cpu(cpu) {
+		kfree(per_cpu(irq_balance_cost, cpu));
+		per_cpu(irq_balance_cost, cpu) = NULL;
+	}
+	kfree(irq_balance_irqs);
+	irq_balance_irqs = NULL;
+	irq_balance_nr_irqs = 0;
+}
@@ -149,7 +149,6 @@ static unsigned int irq_mon_irqs_cpu(unsigned int irq, int cpu)
 #define irq_mon_irqs_cpu(irq, cpu) kstat_irqs_cpu(irq, cpu)
 #endif
 
-#define MAX_IRQ_NUM 1024
 
 struct irq_count_stat {
 	int enabled;
@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2021 MediaTek Inc.
+ */
+
+/*
+ * Duration histograms for the irq monitor tracers, so that sections well
+ * below the ftrace/AEE thresholds still show up:
+ *  - irq handler duration per irq
+ *  - softirq duration per vector
+ *  - irq-off and preempt-off sections, per disabling caller
+ *
+ * Bucket 0 is below 1us and bucket n covers [2^(n-1), 2^n) us, the last
+ * one being open ended. Every CPU only writes its own tables, from the
+ * tracer probes with irqs or preemption still disabled, so no locking is
+ * needed; readers sum all CPUs and may see slightly stale counts.
+ */
+
+#include <linux/hash.h>
+#include <linux/interrupt.h>
+#include <linux/irqnr.h>
+#include <linux/percpu-defs.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+
+#include "internal.h"
+
+#define IRQ_MON_HIST_CALLERS 64
+
+struct irq_mon_hist_caller {
+	unsigned long ip;
+	u32 count;
+	u64 sum_ns;
+	u64 max_ns;
+	u32 hist[IRQ_MON_HIST_BUCKETS];
+};
+
+struct irq_mon_hist_section {
+	u32 hist[IRQ_MON_HIST_BUCKETS];
+	/* sections whose caller did not fit in callers[] */
+	u32 dropped;
+	struct irq_mon_hist_caller callers[IRQ_MON_HIST_CALLERS];
+};
+
+struct irq_mon_hist_cpu {
+	u32 (*irq)[IRQ_MON_HIST_BUCKETS];
+	u32 softirq[NR_SOFTIRQS][IRQ_MON_HIST_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct irq_mon_hist_cpu, irq_mon_hist);
+static struct irq_mon_hist_section __percpu *irq_off_hist;
+static struct irq_mon_hist_section __percpu *preempt_off_hist;
+static unsigned int irq_mon_hist_nr_irqs;
+
+static unsigned int irq_mon_hist_bucket(unsigned long long duration)
+{
+	u64 us = div_u64(duration, NSEC_PER_USEC);
+
+	return min_t(unsigned int, fls64(us), IRQ_MON_HIST_BUCKETS - 1);
+}
+
+void irq_mon_hist_irq(int irq, unsigned long long duration)
+{
+	u32 (*hist)[IRQ_MON_HIST_BUCKETS] = __this_cpu_read(irq_mon_hist.irq);
+
+	if (!hist || irq < 0 || irq >= irq_mon_hist_nr_irqs)
+		return;
+
+	hist[irq][irq_mon_hist_bucket(duration)]++;
+}
+
+void irq_mon_hist_softirq(unsigned int vec_nr, unsigned long long duration)
+{
+	if (vec_nr >= NR_SOFTIRQS)
+		return;
+
+	__this_cpu_inc(irq_mon_hist.softirq[vec_nr][irq_mon_hist_bucket(duration)]);
+}
+
+/* irq: 1 = irq, 0 = preempt */
+void irq_mon_hist_section(int irq, unsigned long ip, unsigned long long duration)
+{
+	struct irq_mon_hist_section __percpu *pcp =
+		irq ? irq_off_hist : preempt_off_hist;
+	struct irq_mon_hist_section *sec;
+	struct irq_mon_hist_caller *c;
+	unsigned int b = irq_mon_hist_bucket(duration);
+	unsigned int i, h;
+
+	if (!pcp)
+		return;
+	sec = raw_cpu_ptr(pcp);
+
+	sec->hist[b]++;
+
+	/* open addressing on the caller, entries are never removed */
+	h = hash_long(ip, ilog2(IRQ_MON_HIST_CALLERS));
+	for (i = 0; i < IRQ_MON_HIST_CALLERS; i++) {
+		c = &sec->callers[(h + i) % IRQ_MON_HIST_CALLERS];
+		if (c->ip == ip)
+			break;
+		if (!c->ip) {
+			c->ip = ip;
+			break;
+		}
+	}
+	if (i == IRQ_MON_HIST_CALLERS) {
+		sec->dropped++;
+		return;
+	}
+
+	c->count++;
+	c->sum_ns += duration;
+	if (duration > c->max_ns)
+		c->max_ns = duration;
+	c->hist[b]++;
+}
+
+static void irq_mon_hist_seq_header(struct seq_file *s, const char *name)
+{
+	unsigned int b;
+
+	seq_printf(s, "%-24s", name);
+	seq_printf(s, " %6s", "<1us");
+	for (b = 1; b < IRQ_MON_HIST_BUCKETS - 1; b++)
+		seq_printf(s, " %6lu", 1UL << (b - 1));
+	seq_printf(s, " >=%4lu\n", 1UL << (IRQ_MON_HIST_BUCKETS - 2));
+}
+
+static bool irq_mon_hist_seq_row(struct seq_file *s, const char *name,
+		const u32 *hist)
+{
+	unsigned int b;
+
+	for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+		if (hist[b])
+			break;
+	if (b == IRQ_MON_HIST_BUCKETS)
+		return false;
+
+	seq_printf(s, "%-24s", name);
+	for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+		seq_printf(s, " %6u", hist[b]);
+	seq_puts(s, "\n");
+
+	return true;
+}
+
+static int irq_mon_hist_irq_show(struct seq_file *s, void *p)
+{
+	u32 hist[IRQ_MON_HIST_BUCKETS];
+	char name[24];
+	unsigned int irq, b;
+	int cpu;
+
+	irq_mon_hist_seq_header(s, "irq");
+	for (irq = 0; irq < irq_mon_hist_nr_irqs; irq++) {
+		memset(hist, 0, sizeof(hist));
+		for_each_possible_cpu(cpu) {
+			u32 (*h)[IRQ_MON_HIST_BUCKETS] =
+				per_cpu(irq_mon_hist.irq, cpu);
+
+			if (!h)
+				continue;
+			for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+				hist[b] += READ_ONCE(h[irq][b]);
+		}
+		scnprintf(name, sizeof(name), "%u:%s", irq,
+			irq_to_name(irq) ? : "-");
+		irq_mon_hist_seq_row(s, name, hist);
+	}
+
+	return 0;
+}
+
+static int irq_mon_hist_softirq_show(struct seq_file *s, void *p)
+{
+	u32 hist[IRQ_MON_HIST_BUCKETS];
+	unsigned int vec, b;
+	int cpu;
+
+	irq_mon_hist_seq_header(s, "softirq");
+	for (vec = 0; vec < NR_SOFTIRQS; vec++) {
+		memset(hist, 0, sizeof(hist));
+		for_each_possible_cpu(cpu)
+			for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+				hist[b] += READ_ONCE(per_cpu(irq_mon_hist.softirq[vec][b], cpu));
+		irq_mon_hist_seq_row(s, softirq_to_name[vec], hist);
+	}
+
+	return 0;
+}
+
+static int irq_mon_hist_cmp_max(const void *a, const void *b)
+{
+	const struct irq_mon_hist_caller *ca = a, *cb = b;
+
+	return ca->max_ns < cb->max_ns ? 1 : (ca->max_ns > cb->max_ns ? -1 : 0);
+}
+
+static int irq_mon_hist_section_show(struct seq_file *s, void *p)
+{
+	struct irq_mon_hist_section __percpu *pcp =
+		(struct irq_mon_hist_section __percpu __force *)s->private;
+	struct irq_mon_hist_caller *merged, *c, *m;
+	u32 hist[IRQ_MON_HIST_BUCKETS];
+	unsigned int i, j, b, nr = 0;
+	char name[24];
+	u32 dropped = 0;
+	int cpu;
+
+	merged = kcalloc(num_possible_cpus() * IRQ_MON_HIST_CALLERS,
+			sizeof(*merged), GFP_KERNEL);
+	if (!merged)
+		return -ENOMEM;
+
+	memset(hist, 0, sizeof(hist));
+	for_each_possible_cpu(cpu) {
+		struct irq_mon_hist_section *sec = per_cpu_ptr(pcp, cpu);
+
+		dropped += READ_ONCE(sec->dropped);
+		for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+			hist[b] += READ_ONCE(sec->hist[b]);
+
+		for (i = 0; i < IRQ_MON_HIST_CALLERS; i++) {
+			c = &sec->callers[i];
+			if (!READ_ONCE(c->ip))
+				continue;
+			for (j = 0; j < nr; j++)
+				if (merged[j].ip == c->ip)
+					break;
+			m = &merged[j];
+			if (j == nr) {
+				m->ip = c->ip;
+				nr++;
+			}
+			m->count += c->count;
+			m->sum_ns += c->sum_ns;
+			m->max_ns = max(m->max_ns, c->max_ns);
+			for (b = 0; b < IRQ_MON_HIST_BUCKETS; b++)
+				m->hist[b] += c->hist[b];
+		}
+	}
+
+	sort(merged, nr, sizeof(*merged), irq_mon_hist_cmp_max, NULL);
+
+	irq_mon_hist_seq_header(s, "all");
+	irq_mon_hist_seq_row(s, "all", hist);
+	seq_printf(s, "dropped callers: %u\n\n", dropped);
+
+	seq_puts(s, "caller count max(us) avg(us) histogram\n");
+	for (i = 0; i < nr; i++) {
+		m = &merged[i];
+		seq_printf(s, "%pS %u %llu %llu\n", (void *)m->ip, m->count,
+			usec_high(m->max_ns),
+			usec_high(div_u64(m->sum_ns, m->count ? : 1)));
+		scnprintf(name, sizeof(name), "  [<%px>]", (void *)m->ip);
+		irq_mon_hist_seq_row(s, name, m->hist);
+	}
+	kfree(merged);
+
+	return 0;
+}
+
+static void irq_mon_hist_reset(void *data)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct irq_mon_hist_cpu *h = per_cpu_ptr(&irq_mon_hist, cpu);
+
+		if (data == irq_mon_hist_irq_show && h->irq)
+			memset(h->irq, 0, irq_mon_hist_nr_irqs * sizeof(*h->irq));
+		else if (data == irq_mon_hist_softirq_show)
+			memset(h->softirq, 0, sizeof(h->softirq));
+		else if (data == irq_off_hist || data == preempt_off_hist)
+			memset(per_cpu_ptr((struct irq_mon_hist_section __percpu *)data, cpu),
+				0, sizeof(struct irq_mon_hist_section));
+	}
+}
+
+static int irq_mon_hist_open(struct inode *inode, struct file *file)
+{
+	void *data = PDE_DATA(inode);
+
+	if (data == irq_mon_hist_irq_show)
+		return single_open(file, irq_mon_hist_irq_show, NULL);
+	if (data == irq_mon_hist_softirq_show)
+		return single_open(file, irq_mon_hist_softirq_show, NULL);
+
+	return single_open_size(file, irq_mon_hist_section_show, data,
+			(num_possible_cpus() * IRQ_MON_HIST_CALLERS + 4) * 256);
+}
+
+/* write anything to clear the histogram */
+static ssize_t irq_mon_hist_write(struct file *filp,
+		const char *ubuf, size_t count, loff_t *data)
+{
+	irq_mon_hist_reset(PDE_DATA(file_inode(filp)));
+
+	return count;
+}
+
+static const struct proc_ops irq_mon_hist_pops = {
+	.proc_open = irq_mon_hist_open,
+	.proc_write = irq_mon_hist_write,
+	.proc_read = seq_read,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
+void irq_mon_hist_proc_init(struct proc_dir_entry *parent)
+{
+	struct proc_dir_entry *dir;
+
+	dir = proc_mkdir("irq_mon_hist", parent);
+	if (!dir)
+		return;
+
+	proc_create_data("irq", 0644, dir, &irq_mon_hist_pops,
+			irq_mon_hist_irq_show);
+	proc_create_data("softirq", 0644, dir, &irq_mon_hist_pops,
+			irq_mon_hist_softirq_show);
+	if (irq_off_hist)
+		proc_create_data("irq_off", 0644, dir, &irq_mon_hist_pops,
+				(void __force *)irq_off_hist);
+	if (preempt_off_hist)
+		proc_create_data("preempt_off", 0644, dir, &irq_mon_hist_pops,
+				(void __force *)preempt_off_hist);
+}
+
+int irq_mon_hist_init(void)
+{
+	int cpu;
+
+	irq_mon_hist_nr_irqs = min_t(unsigned int, nr_irqs, MAX_IRQ_NUM);
+	for_each_possible_cpu(cpu) {
+		per_cpu(irq_mon_hist.irq, cpu) =
+			kcalloc_node(irq_mon_hist_nr_irqs,
+				sizeof(*per_cpu(irq_mon_hist.irq, cpu)),
+				GFP_KERNEL, cpu_to_node(cpu));
+		if (!per_cpu(irq_mon_hist.irq, cpu))
+			goto fail;
+	}
+
+	irq_off_hist = alloc_percpu(struct irq_mon_hist_section);
+	preempt_off_hist = alloc_percpu(struct irq_mon_hist_section);
+	if (!irq_off_hist || !preempt_off_hist)
+		goto fail;
+
+	return 0;
+fail:
+	pr_info("Failed to alloc irq_mon_hist\n");
+	irq_mon_hist_exit();
+	return -ENOMEM;
+}
+
+void irq_mon_hist_exit(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		kfree(per_cpu(irq_mon_hist.irq, cpu));
+		per_cpu(irq_mon_hist.irq, cpu) = NULL;
+	}
+	free_percpu(irq_off_hist);
+	free_percpu(preempt_off_hist);
+	irq_off_hist = NULL;
+	preempt_off_hist = NULL;
+}
@@ -244,6 +244,7 @@ static void check_preemptirq_stat(struct preemptirq_stat *pi_stat, int irq)
 		return;
 
 	duration = pi_stat->enable_timestamp - pi_stat->disable_timestamp;
+	irq_mon_hist_section(irq, pi_stat->disable_ip, duration);
 	out = check_threshold(duration, tracer);
 	if (!out)
 		return;
@@ -277,7 +278,6 @@ static struct trace_stat __percpu *softirq_trace_stat;
 static struct trace_stat __percpu *ipi_trace_stat;
 static struct trace_stat __percpu *hrtimer_trace_stat;
 
-#define MAX_IRQ_NUM 1024
 static int irq_aee_state[MAX_IRQ_NUM];
 
 #define stat_dur(stat) (stat->end_timestamp - stat->start_timestamp)
@@ -355,6 +355,8 @@ static void probe_irq_handler_exit(void *ignore,
 	trace_stat->end_timestamp = ts;
 
 	duration = stat_dur(trace_stat);
+	irq_mon_hist_irq(irq, duration);
+	irq_balance_irq(irq, duration);
 	out = check_threshold(duration, tracer);
 	if (out) {
 		char msg[MAX_MSG_LEN];
@@ -442,6 +444,7 @@ static void probe_softirq_exit(void *ignore, unsigned int vec_nr)
 	trace_stat->end_timestamp = ts;
 
 	duration = stat_dur(trace_stat);
+	irq_mon_hist_softirq(vec_nr, duration);
 	out = check_threshold(duration, tracer);
 	if (out) {
 		irq_mon_msg(out,
@@ -1160,6 +1163,8 @@ static void irq_mon_proc_init(void)
 	irq_mon_tracer_proc_init(&preempt_off_tracer, dir);
 	irq_mon_tracer_proc_init(&hrtimer_expire_tracer, dir);
 	irq_count_tracer_proc_init(dir);
+	irq_mon_hist_proc_init(dir);
+	irq_balance_proc_init(dir);
 	mt_irq_monitor_test_init(dir);
 }
 
@@ -1198,6 +1203,10 @@ static int __init irq_monitor_init(void)
 		return -ENOMEM;
 	}
 
+	/* histograms and balancing are optional, the tracers run without them */
+	irq_mon_hist_init();
+	irq_balance_init();
+
 	// tracepoint init
 	pr_info("irq monitor init start!!\n");
 	ret = irq_mon_tracepoint_init();
@@ -1242,6 +1251,8 @@ static void __exit irq_monitor_exit(void)
 	remove_proc_subtree("mtmon", NULL);
 	irq_count_tracer_exit();
 	irq_mon_tracepoint_exit();
+	irq_mon_hist_exit();
+	irq_balance_exit();
 
 	free_percpu(irq_pi_stat);
 	free_percpu(preempt_pi_stat);
@@ -11,6 +11,8 @@
 extern int fpsgo_fbt2xgf_get_dep_list_num(int pid, unsigned long long bufID);
 extern int fpsgo_fbt2xgf_get_dep_list(int pid, int count,
 		struct fpsgo_loading *arr, unsigned long long bufID);
+extern int fpsgo_fbt2xgf_get_critical_path(int pid, unsigned long long bufID,
+		struct fpsgo_loading *arr, int count);
 
 #if defined(CONFIG_MTK_FPSGO) || defined(CONFIG_MTK_FPSGO_V3)
 void fpsgo_ctrl2fbt_dfrc_fps(int fps_limit);
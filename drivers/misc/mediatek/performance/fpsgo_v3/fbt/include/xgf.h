@@ -30,6 +30,9 @@
 #define XGF_MAX_SPID_LIST_LENGTH 20
 #define DEFAULT_DFRC 60
 #define TARGET_FPS_LEVEL 10
+#define XGF_CP_MAX_THREADS 16
+#define XGF_CP_MAX_HOPS 64
+#define XGF_CP_MAX_WINDOW 100000000
 #define N 8
 
 enum XGF_ERROR {
@@ -111,6 +114,11 @@ struct xgf_ema2_predictor {
 	int err_code;
 };
 
+struct xgf_cp_thread {
+	pid_t tid;
+	unsigned long long runtime;
+};
+
 struct xgf_render {
 	struct hlist_node hlist;
 	pid_t parent;
@@ -154,6 +162,11 @@ struct xgf_render {
 
 	int hwui_flag;
 	struct xgf_ema2_predictor *ema2_pt;
+
+	/* runtime of each thread on the last frame's critical path */
+	struct xgf_cp_thread cp[XGF_CP_MAX_THREADS];
+	int cp_num;
+	unsigned long long cp_len;
 };
 
 struct xgff_frame {
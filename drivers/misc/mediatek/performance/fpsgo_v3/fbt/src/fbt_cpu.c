@@ -33,6 +33,7 @@
 #include <linux/sched/task.h>
 #include <sched/sched.h>
 #include <linux/cpufreq.h>
+#include <linux/coresight.h>
 #include "sugov/cpufreq.h"
 
 #include <mt-plat/fpsgo_common.h>
@@ -252,6 +253,10 @@ static int gcc_deq_bound_quota;
 static int gcc_positive_clamp;
 static int boost_LR;
 static int aa_retarget;
+static int boost_cp;
+static int cp_min_pct;
+/* stop the always-on ETR trace when the second rescue fires */
+static int jank_trace_freeze;
 
 module_param(bhr, int, 0644);
 module_param(bhr_opp, int, 0644);
@@ -290,6 +295,7 @@ module_param(rescue_second_enhance_f, int, 0644);
 module_param(rescue_second_g_time, int, 0644);
 module_param(rescue_second_g_group, int, 0644);
 module_param(rescue_second_g_enable, int, 0644);
+module_param(jank_trace_freeze, int, 0644);
 module_param(qr_enable, int, 0644);
 module_param(qr_t2wnt_x, int, 0644);
 module_param(qr_t2wnt_y_p, int, 0644);
@@ -321,6 +327,8 @@ module_param(gcc_deq_bound_quota, int, 0644);
 module_param(gcc_positive_clamp, int, 0644);
 module_param(boost_LR, int, 0644);
 module_param(aa_retarget, int, 0644);
+module_param(boost_cp, int, 0644);
+module_param(cp_min_pct, int, 0644);
 
 static DEFINE_SPINLOCK(freq_slock);
 static DEFINE_MUTEX(fbt_mlock);
@@ -1357,6 +1365,43 @@ static int fbt_get_heavy_pid(int size, struct fpsgo_loading *dep_arr)
 	return ret_pid;
 }
 
+/*
+ * Threads holding at least cp_min_pct of the last frame's critical
+ * path, as extracted by xgf. Returns 0 when there is no path, in which
+ * case the whole dep list is boosted as before.
+ */
+static int fbt_get_critical_path(struct render_info *thr,
+	struct fpsgo_loading *cp_arr, int size)
+{
+	int i, num, cp_num = 0;
+
+	if (!boost_cp)
+		return 0;
+
+	num = fpsgo_fbt2xgf_get_critical_path(thr->pid, thr->buffer_id,
+		cp_arr, size);
+
+	for (i = 0; i < num; i++) {
+		if (cp_arr[i].loading < cp_min_pct)
+			continue;
+		cp_arr[cp_num++] = cp_arr[i];
+	}
+
+	return cp_num;
+}
+
+static int fbt_on_critical_path(int pid, struct fpsgo_loading *cp_arr,
+	int cp_num)
+{
+	int i;
+
+	for (i = 0; i < cp_num; i++)
+		if (cp_arr[i].pid == pid)
+			return 1;
+
+	return 0;
+}
+
 static int fbt_get_opp_by_normalized_cap(unsigned int cap, int cluster)
 {
 	int tgt_opp;
@@ -1393,6 +1438,8 @@ static void fbt_set_min_cap_locked(struct render_info *thr, int min_cap,
 	int max_cap = 100;
 	struct fpsgo_loading dep_need_set[MAX_DEP_NUM];
 	int temp_size_need_set = 0;
+	struct fpsgo_loading cp_arr[XGF_CP_MAX_THREADS];
+	int cp_num;
 
 
 	if (!uclamp_boost_enable)
@@ -1484,6 +1531,9 @@ static void fbt_set_min_cap_locked(struct render_info *thr, int min_cap,
 	if (boost_affinity || boost_LR)
 		heavy_pid = fbt_get_heavy_pid(thr->dep_valid_size, thr->dep_arr);
 
+	cp_num = fbt_get_critical_path(thr, cp_arr, XGF_CP_MAX_THREADS);
+	fpsgo_systrace_c_fbt(thr->pid, thr->buffer_id, cp_num, "cp_num");
+
 	dep_str = kcalloc(size + 1, MAX_PID_DIGIT * sizeof(char),
 				GFP_KERNEL);
 	if (!dep_str)
@@ -1530,7 +1580,12 @@ static void fbt_set_min_cap_locked(struct render_info *thr, int min_cap,
 			}
 		}
 
-		if (fbt_is_light_loading(fl->loading) && bhr_opp != (NR_FREQ_CPU - 1)) {
+		if (cp_num && fl->pid != thr->pid &&
+			!fbt_on_critical_path(fl->pid, cp_arr, cp_num)) {
+			/* off the critical path, speeding it up buys no frame time */
+			fbt_set_per_task_cap(fl->pid, 0, max_cap);
+			fbt_reset_task_setting(fl, 0);
+		} else if (fbt_is_light_loading(fl->loading) && bhr_opp != (NR_FREQ_CPU - 1)) {
 			fbt_set_per_task_cap(fl->pid,
 				(!loading_policy) ? 0
 				: min_cap * loading_policy / 100, max_cap);
@@ -2064,6 +2119,10 @@ static void fbt_do_sjerk(struct work_struct *work)
 	max_blc_stage = FPSGO_JERK_SECOND;
 	fpsgo_systrace_c_fbt_debug(-100, 0, max_blc_stage, "max_blc_stage");
 
+	/* still late after the first rescue, the frame will be dropped */
+	if (jank_trace_freeze)
+		coresight_freeze_trace("fpsgo jank");
+
 	kfree(pld);
 
 EXIT:
@@ -6086,6 +6145,7 @@ int __init fbt_cpu_init(void)
 	kmin = 10;
 	floor_opp = 2;
 	loading_th = 0;
+	cp_min_pct = 5;
 	sampling_period_MS = 256;
 	rescue_enhance_f = 25;
 	rescue_second_enhance_f = 100;
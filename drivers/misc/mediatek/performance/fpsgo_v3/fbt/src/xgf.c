@@ -61,6 +61,7 @@ static int xgf_spid_list_length;
 static int xgf_wspid_list_length;
 static int xgf_cfg_spid;
 static int xgf_ema2_enable = 1;
+static int xgf_cp_enable;
 static int xgf_camera_flag;
 static int xgf_display_rate = DEFAULT_DFRC;
 static DEFINE_MUTEX(fstb_ko_lock);
@@ -95,6 +96,7 @@ module_param(xgf_uboost, int, 0644);
 module_param(xgf_stddev_multi, int, 0644);
 module_param(xgf_cfg_spid, int, 0644);
 module_param(xgf_ema2_enable, int, 0644);
+module_param(xgf_cp_enable, int, 0644);
 module_param(fstb_frame_num, int, 0644);
 module_param(fstb_no_stable_thr, int, 0644);
 module_param(fstb_can_update_thr, int, 0644);
@@ -1430,6 +1432,8 @@ static int xgf_get_render(pid_t rpid, unsigned long long bufID,
 		iter->raw_r_runtime = 0;
 		iter->hwui_flag = hwui_flag;
 		iter->ema2_pt = 0;
+		iter->cp_num = 0;
+		iter->cp_len = 0;
 	}
 
 	INIT_HLIST_HEAD(&iter->sector_head);
@@ -2607,6 +2611,141 @@ static void xgf_calculate_u_avg2sd(struct xgf_render *render)
 	}
 }
 
+static void xgf_cp_add(struct xgf_render *render, pid_t tid,
+	unsigned long long runtime)
+{
+	int i;
+
+	for (i = 0; i < render->cp_num; i++) {
+		if (render->cp[i].tid == tid) {
+			render->cp[i].runtime += runtime;
+			return;
+		}
+	}
+
+	if (render->cp_num >= XGF_CP_MAX_THREADS)
+		return;
+
+	render->cp[render->cp_num].tid = tid;
+	render->cp[render->cp_num].runtime = runtime;
+	render->cp_num++;
+}
+
+/*
+ * Walk the frame backwards from queue end through fstb_event_data:
+ * while the current thread ran, its runtime is on the critical path;
+ * when it was woken from sleep, the path continues in the waker just
+ * before the wakeup. Runqueue waits stay with the same thread. A frame
+ * whose walk loses track of a wakeup keeps no path.
+ */
+static void xgf_update_critical_path(struct xgf_render *render,
+	unsigned long long start_ts, unsigned long long end_ts)
+{
+	struct fstb_trace_event *fte;
+	pid_t cur = render->render;
+	unsigned long long t = end_ts;
+	int running = 1, complete = 0;
+	int head, idx, scanned, hops = 0;
+
+	render->cp_num = 0;
+	render->cp_len = 0;
+
+	if (!fstb_event_data || MAX_EVENT_NUM <= 0 || end_ts <= start_ts)
+		return;
+
+	head = atomic_read(&fstb_event_data_idx);
+	if (head <= 0 || head > MAX_EVENT_NUM)
+		head = MAX_EVENT_NUM;
+
+	for (scanned = 0, idx = head - 1; scanned < MAX_EVENT_NUM;
+		scanned++, idx--) {
+		if (idx < 0)
+			idx = MAX_EVENT_NUM - 1;
+
+		fte = &fstb_event_data[idx];
+		if (!fte->ts || fte->ts > t)
+			continue;
+
+		if (fte->ts < start_ts) {
+			complete = 1;
+			break;
+		}
+
+		if (fte->event == SCHED_SWITCH) {
+			if (running && fte->pid == cur) {
+				xgf_cp_add(render, cur, t - fte->ts);
+				t = fte->ts;
+				running = 0;
+			} else if (!running && fte->note == cur) {
+				/* went to sleep without a recorded wakeup */
+				if (fte->state)
+					break;
+				t = fte->ts;
+				running = 1;
+			}
+		} else if (fte->event == SCHED_WAKING) {
+			if (!running && fte->pid == cur) {
+				/* woken from idle or irq, nothing to follow */
+				if (!fte->note || ++hops > XGF_CP_MAX_HOPS) {
+					complete = 1;
+					break;
+				}
+				cur = fte->note;
+				t = fte->ts;
+				running = 1;
+			}
+		}
+	}
+
+	if (!complete) {
+		render->cp_num = 0;
+		return;
+	}
+
+	if (running && t > start_ts)
+		xgf_cp_add(render, cur, t - start_ts);
+
+	render->cp_len = end_ts - start_ts;
+}
+
+/*
+ * Fill @arr with the threads on the last critical path of the render,
+ * loading being each thread's share of the path in percent.
+ */
+int fpsgo_fbt2xgf_get_critical_path(int pid, unsigned long long bufID,
+	struct fpsgo_loading *arr, int count)
+{
+	struct xgf_render *render_iter;
+	struct hlist_node *n;
+	int i, index = 0;
+
+	if (!pid || !count || !xgf_cp_enable)
+		return 0;
+
+	xgf_lock(__func__);
+
+	hlist_for_each_entry_safe(render_iter, n, &xgf_renders, hlist) {
+		if (render_iter->render != pid || render_iter->bufID != bufID)
+			continue;
+
+		if (!render_iter->cp_len)
+			break;
+
+		for (i = 0; i < render_iter->cp_num && index < count; i++) {
+			arr[index].pid = render_iter->cp[i].tid;
+			arr[index].loading = (int)div64_u64(
+				render_iter->cp[i].runtime * 100,
+				render_iter->cp_len);
+			index++;
+		}
+		break;
+	}
+
+	xgf_unlock(__func__);
+
+	return index;
+}
+
 int fpsgo_comp2xgf_qudeq_notify(int rpid, unsigned long long bufID, int cmd,
 	unsigned long long *run_time, unsigned long long *mid,
 	unsigned long long ts, int hwui_flag)
@@ -2687,6 +2826,12 @@ int fpsgo_comp2xgf_qudeq_notify(int rpid, unsigned long long bufID, int cmd,
 
 		fpsgo_systrace_c_fbt(rpid, bufID, ret, "xgf_ret");
 
+		if (xgf_cp_enable) {
+			xgf_update_critical_path(r, ts - min_t(unsigned long long,
+				q2q_time, XGF_CP_MAX_WINDOW), ts);
+			fpsgo_systrace_c_fbt(rpid, bufID, r->cp_num, "cp_threads");
+		}
+
 		if (do_extra_sub)
 			cur_xgf_extra_sub = 0;
 
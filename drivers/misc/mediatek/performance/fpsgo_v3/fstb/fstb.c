@@ -567,6 +567,139 @@ static int cmplonglong(const void *a, const void *b)
 	return *(long long *)a - *(long long *)b;
 }
 
+static void fstb_p2_reset(struct fstb_p2_quantile *p2, int quantile)
+{
+	p2->count = 0;
+	p2->quantile = quantile;
+	p2->dn[0] = 0;
+	p2->dn[1] = quantile;
+	p2->dn[2] = 2 * quantile;
+	p2->dn[3] = 100 + quantile;
+	p2->dn[4] = FSTB_P2_SCALE;
+}
+
+static void fstb_p2_set_desired(struct fstb_p2_quantile *p2)
+{
+	int i;
+
+	for (i = 0; i < FSTB_P2_MARKERS; i++)
+		p2->np[i] = FSTB_P2_SCALE +
+			(long long)(p2->n[FSTB_P2_MARKERS - 1] - 1) * p2->dn[i];
+}
+
+static long long fstb_p2_parabolic(struct fstb_p2_quantile *p2,
+	int i, int d)
+{
+	long long a, b;
+
+	a = div64_s64((long long)(p2->n[i] - p2->n[i - 1] + d) *
+		(p2->q[i + 1] - p2->q[i]), p2->n[i + 1] - p2->n[i]);
+	b = div64_s64((long long)(p2->n[i + 1] - p2->n[i] - d) *
+		(p2->q[i] - p2->q[i - 1]), p2->n[i] - p2->n[i - 1]);
+
+	return p2->q[i] + div64_s64(d * (a + b), p2->n[i + 1] - p2->n[i - 1]);
+}
+
+static void fstb_p2_update(struct fstb_p2_quantile *p2, long long x)
+{
+	int i, k, d;
+	long long delta, qp;
+
+	if (p2->quantile != QUANTILE)
+		fstb_p2_reset(p2, QUANTILE);
+
+	if (p2->count < FSTB_P2_MARKERS) {
+		p2->q[p2->count++] = x;
+		if (p2->count == FSTB_P2_MARKERS) {
+			sort(p2->q, FSTB_P2_MARKERS, sizeof(long long),
+				cmplonglong, NULL);
+			for (i = 0; i < FSTB_P2_MARKERS; i++)
+				p2->n[i] = i + 1;
+			fstb_p2_set_desired(p2);
+		}
+		return;
+	}
+
+	if (x < p2->q[0]) {
+		p2->q[0] = x;
+		k = 0;
+	} else if (x >= p2->q[4]) {
+		p2->q[4] = x;
+		k = 3;
+	} else {
+		for (k = 0; k < 3; k++)
+			if (x < p2->q[k + 1])
+				break;
+	}
+
+	for (i = k + 1; i < FSTB_P2_MARKERS; i++)
+		p2->n[i]++;
+	for (i = 0; i < FSTB_P2_MARKERS; i++)
+		p2->np[i] += p2->dn[i];
+	p2->count++;
+
+	for (i = 1; i < FSTB_P2_MARKERS - 1; i++) {
+		delta = p2->np[i] - (long long)p2->n[i] * FSTB_P2_SCALE;
+
+		if (!((delta >= FSTB_P2_SCALE && p2->n[i + 1] - p2->n[i] > 1) ||
+			(delta <= -FSTB_P2_SCALE &&
+			 p2->n[i - 1] - p2->n[i] < -1)))
+			continue;
+
+		d = delta >= 0 ? 1 : -1;
+		qp = fstb_p2_parabolic(p2, i, d);
+		if (p2->q[i - 1] < qp && qp < p2->q[i + 1])
+			p2->q[i] = qp;
+		else
+			p2->q[i] += div64_s64(d * (p2->q[i + d] - p2->q[i]),
+				p2->n[i + d] - p2->n[i]);
+		p2->n[i] += d;
+	}
+}
+
+/*
+ * Halve the weight of the history so the estimate follows the last few
+ * adjust intervals rather than the whole lifetime of the buffer queue.
+ */
+static void fstb_p2_decay(struct fstb_p2_quantile *p2)
+{
+	int i;
+
+	if (p2->count < 2 * FSTB_P2_MARKERS)
+		return;
+
+	for (i = 1; i < FSTB_P2_MARKERS; i++)
+		p2->n[i] = max(p2->n[i - 1] + 1, 1 + (p2->n[i] - 1) / 2);
+	p2->count = p2->n[FSTB_P2_MARKERS - 1];
+	fstb_p2_set_desired(p2);
+}
+
+static long long fstb_p2_get(struct fstb_p2_quantile *p2,
+	unsigned long long *window, int nr)
+{
+	long long small[FSTB_P2_MARKERS];
+
+	if (p2->quantile != QUANTILE || !p2->count) {
+		/* seed from the current window when restarting */
+		fstb_p2_reset(p2, QUANTILE);
+		while (nr-- > 0)
+			fstb_p2_update(p2, window[nr]);
+	}
+
+	if (p2->count < FSTB_P2_MARKERS) {
+		memcpy(small, p2->q, sizeof(long long) * p2->count);
+		sort(small, p2->count, sizeof(long long), cmplonglong, NULL);
+		return small[min(QUANTILE * p2->count / 100, p2->count - 1)];
+	}
+
+	if (!QUANTILE)
+		return p2->q[0];
+	if (QUANTILE == 100)
+		return p2->q[4];
+
+	return p2->q[2];
+}
+
 void fpsgo_ctrl2fstb_dfrc_fps(int fps)
 {
 	mutex_lock(&fstb_lock);
@@ -677,6 +810,8 @@ void gpu_time_update(long long t_gpu, unsigned int cur_freq,
 		fpsgo_systrace_c_fstb_man(iter->pid, iter->bufid,
 		(int)iter->weighted_gpu_time[iter->weighted_gpu_time_end],
 		"weighted_gpu_time");
+		fstb_p2_update(&iter->gpu_time_p2,
+			iter->weighted_gpu_time[iter->weighted_gpu_time_end]);
 		iter->weighted_gpu_time_end++;
 	}
 
@@ -697,37 +832,20 @@ void gpu_time_update(long long t_gpu, unsigned int cur_freq,
 static int get_gpu_frame_time(struct FSTB_FRAME_INFO *iter)
 {
 	int ret = INT_MAX;
-	/*copy entries to temp array*/
-	/*sort this array*/
-	if (iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin
-		> 0 &&
-		iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin
-		< FRAME_TIME_BUFFER_SIZE) {
-		memcpy(iter->sorted_weighted_gpu_time,
-		&(iter->weighted_gpu_time[iter->weighted_gpu_time_begin]),
-		sizeof(long long) *
-		(iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin));
-		sort(iter->sorted_weighted_gpu_time,
-		iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin,
-		sizeof(long long), cmplonglong, NULL);
-	}
-
-	/*update nth value*/
-	if (iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin) {
-		if (
-			iter->sorted_weighted_gpu_time[
-				QUANTILE*
-				(iter->weighted_gpu_time_end-
-				 iter->weighted_gpu_time_begin)/100]
-			> INT_MAX)
-			ret = INT_MAX;
-		else
-			ret =
-				iter->sorted_weighted_gpu_time[
-					QUANTILE*
-					(iter->weighted_gpu_time_end-
-					 iter->weighted_gpu_time_begin)/100];
-	} else
+	long long quantile;
+
+	/*nth value from the streaming estimator, no sort needed*/
+	if (iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin > 0 &&
+		iter->weighted_gpu_time_end - iter->weighted_gpu_time_begin <
+		FRAME_TIME_BUFFER_SIZE) {
+		quantile = fstb_p2_get(&iter->gpu_time_p2,
+			&(iter->weighted_gpu_time[iter->weighted_gpu_time_begin]),
+			iter->weighted_gpu_time_end -
+			iter->weighted_gpu_time_begin);
+		fstb_p2_decay(&iter->gpu_time_p2);
+		ret = quantile > INT_MAX ? INT_MAX : quantile;
+	} else if (iter->weighted_gpu_time_end ==
+		iter->weighted_gpu_time_begin)
 		ret = -1;
 
 	fpsgo_systrace_c_fstb_man(iter->pid, iter->bufid, ret,
@@ -956,6 +1074,7 @@ int fpsgo_fbt2fstb_update_cpu_frame_info(
 	iter->weighted_cpu_time_ts[iter->weighted_cpu_time_end] =
 		cur_time_us;
 	iter->weighted_cpu_time_end++;
+	fstb_p2_update(&iter->cpu_time_p2, wct);
 
 out:
 	mtk_fstb_dprintk(
@@ -1168,38 +1287,20 @@ void fpsgo_comp2fstb_prepare_calculate_target_fps(int pid, unsigned long long bu
 static long long get_cpu_frame_time(struct FSTB_FRAME_INFO *iter)
 {
 	long long ret = INT_MAX;
-	/*copy entries to temp array*/
-	/*sort this array*/
+	long long quantile;
+
+	/*nth value from the streaming estimator, no sort needed*/
 	if (iter->weighted_cpu_time_end - iter->weighted_cpu_time_begin > 0 &&
 		iter->weighted_cpu_time_end - iter->weighted_cpu_time_begin <
 		FRAME_TIME_BUFFER_SIZE) {
-		memcpy(iter->sorted_weighted_cpu_time,
-		&(iter->weighted_cpu_time[iter->weighted_cpu_time_begin]),
-		sizeof(long long) *
-		(iter->weighted_cpu_time_end -
-		 iter->weighted_cpu_time_begin));
-		sort(iter->sorted_weighted_cpu_time,
-		iter->weighted_cpu_time_end -
-		iter->weighted_cpu_time_begin,
-		sizeof(long long), cmplonglong, NULL);
-	}
-
-	/*update nth value*/
-	if (iter->weighted_cpu_time_end - iter->weighted_cpu_time_begin) {
-		if (
-			iter->sorted_weighted_cpu_time[
-				QUANTILE*
-				(iter->weighted_cpu_time_end-
-				 iter->weighted_cpu_time_begin)/100]
-			> INT_MAX)
-			ret = INT_MAX;
-		else
-			ret =
-				iter->sorted_weighted_cpu_time[
-					QUANTILE*
-					(iter->weighted_cpu_time_end-
-					 iter->weighted_cpu_time_begin)/100];
-	} else
+		quantile = fstb_p2_get(&iter->cpu_time_p2,
+			&(iter->weighted_cpu_time[iter->weighted_cpu_time_begin]),
+			iter->weighted_cpu_time_end -
+			iter->weighted_cpu_time_begin);
+		fstb_p2_decay(&iter->cpu_time_p2);
+		ret = quantile > INT_MAX ? INT_MAX : quantile;
+	} else if (iter->weighted_cpu_time_end ==
+		iter->weighted_cpu_time_begin)
 		ret = -1;
 
 	fpsgo_systrace_c_fstb_man(iter->pid, iter->bufid, ret,
@@ -1367,6 +1468,8 @@ void fpsgo_comp2fstb_queue_time_update(int pid, unsigned long long bufID,
 		new_frame_info->weighted_gpu_time_end = 0;
 		new_frame_info->quantile_cpu_time = -1;
 		new_frame_info->quantile_gpu_time = -1;
+		fstb_p2_reset(&new_frame_info->cpu_time_p2, QUANTILE);
+		fstb_p2_reset(&new_frame_info->gpu_time_p2, QUANTILE);
 		new_frame_info->new_info = 1;
 		new_frame_info->fps_raise_flag = 0;
 		new_frame_info->vote_i = 0;
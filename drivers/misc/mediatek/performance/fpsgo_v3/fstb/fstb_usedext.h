@@ -39,6 +39,24 @@ extern int (*fbt_notifier_cpu_frame_time_fps_stabilizer)(
 extern void (*ged_kpi_output_gfx_info2_fp)(long long t_gpu,
 	unsigned int cur_freq, unsigned int cur_max_freq, u64 ulID);
 
+/*
+ * Streaming P-square quantile estimator: five markers whose heights
+ * track the min, p/2, p, (1+p)/2 and max quantiles of the samples seen,
+ * each sample costs O(1) and no history is kept. Desired positions are
+ * in units of 1/FSTB_P2_SCALE of a sample.
+ */
+#define FSTB_P2_MARKERS 5
+#define FSTB_P2_SCALE 200
+
+struct fstb_p2_quantile {
+	int count;
+	int quantile;
+	long long q[FSTB_P2_MARKERS];
+	int n[FSTB_P2_MARKERS];
+	long long np[FSTB_P2_MARKERS];
+	long long dn[FSTB_P2_MARKERS];
+};
+
 struct FSTB_FRAME_INFO {
 	struct hlist_node hlist;
 
@@ -80,8 +98,8 @@ struct FSTB_FRAME_INFO {
 	int weighted_cpu_time_end;
 	int weighted_gpu_time_begin;
 	int weighted_gpu_time_end;
-	unsigned long long sorted_weighted_cpu_time[FRAME_TIME_BUFFER_SIZE];
-	unsigned long long sorted_weighted_gpu_time[FRAME_TIME_BUFFER_SIZE];
+	struct fstb_p2_quantile cpu_time_p2;
+	struct fstb_p2_quantile gpu_time_p2;
 	int quantile_cpu_time;
 	int quantile_gpu_time;
 
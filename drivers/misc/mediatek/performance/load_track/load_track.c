@@ -12,9 +12,21 @@
 #include <linux/slab.h>
 #include <linux/cpufreq.h>
 #include <linux/cpumask.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 
 #define TAG "[LT]"
 
+/*
+ * All users share one deferrable sampling work: each run reads every
+ * CPU's idle/wall counters once into lt_cpu_sample and serves all users
+ * that are due, then sleeps until the earliest next deadline. Users
+ * due within 1/8 (LT_COALESCE_SHIFT) of their period are served early
+ * so that close periods share one wakeup, and since the timer is
+ * deferrable an idle system is never woken just to sample loading.
+ */
+#define LT_COALESCE_SHIFT 3
+
 struct LT_USER_DATA {
 	void (*fn)(int loading, int mask_loading);
 	unsigned long polling_ms;
@@ -22,13 +34,12 @@ struct LT_USER_DATA {
 	u64 *prev_idle_time;
 	u64 *prev_wall_time;
 	struct hlist_node user_list_node;
-	struct LT_WORK_DATA *link2work;
+	ktime_t target_expire;
 };
 
-struct LT_WORK_DATA {
-	struct LT_USER_DATA *link2user;
-	struct delayed_work s_work;
-	ktime_t target_expire;
+struct lt_cpu_sample {
+	u64 idle_time;
+	u64 wall_time;
 };
 
 static int nr_cpus;
@@ -36,7 +47,9 @@ static int nr_cpus;
 static struct workqueue_struct *ps_lk_wq;
 static HLIST_HEAD(lt_user_list);
 DEFINE_MUTEX(lt_mlock);
+static DEFINE_PER_CPU(struct lt_cpu_sample, lt_cpu_sample);
 static void lt_work_fn(struct work_struct *ps_work);
+static DECLARE_DEFERRABLE_WORK(lt_sample_work, lt_work_fn);
 
 static inline void lt_lock(const char *tag)
 {
@@ -53,35 +66,24 @@ static inline void lt_lockprove(const char *tag)
 	WARN_ON(!mutex_is_locked(&lt_mlock));
 }
 
-static void *new_lt_work(struct LT_USER_DATA *lt_user)
+static void lt_sample_cpus(void)
 {
-	struct LT_WORK_DATA *new_work;
-
-	lt_lockprove(__func__);
-	new_work = kzalloc(sizeof(*new_work), GFP_KERNEL);
-	if (!new_work)
-		goto new_lt_work_out;
-
-	new_work->link2user = lt_user;
-	INIT_DELAYED_WORK(&new_work->s_work, lt_work_fn);
-	new_work->target_expire =
-		ktime_add_ms(ktime_get(), lt_user->polling_ms);
-
-new_lt_work_out:
-	return new_work;
-}
+	struct lt_cpu_sample *sample;
+	int cpu;
 
-static inline void free_lt_work(struct LT_WORK_DATA *lt_work)
-{
 	lt_lockprove(__func__);
-	kfree(lt_work);
+	for_each_possible_cpu(cpu) {
+		sample = &per_cpu(lt_cpu_sample, cpu);
+		sample->idle_time =
+			get_cpu_idle_time(cpu, &sample->wall_time, 1);
+	}
 }
 
 static int lt_update_mask_loading(struct LT_USER_DATA *lt_data)
 {
 	int ret = -EOVERFLOW;
 	int cpu;
-	u64 cur_idle_time_i, cur_wall_time_i;
+	struct lt_cpu_sample *sample;
 	u64 cpu_idle_time = 0, cpu_wall_time = 0;
 
 	lt_lockprove(__func__);
@@ -91,10 +93,10 @@ static int lt_update_mask_loading(struct LT_USER_DATA *lt_data)
 
 	for_each_possible_cpu(cpu) {
 		if (cpumask_test_cpu(cpu, lt_data->cpu_mask)) {
-			cur_idle_time_i = get_cpu_idle_time(cpu, &cur_wall_time_i, 1);
+			sample = &per_cpu(lt_cpu_sample, cpu);
 
-			cpu_idle_time += cur_idle_time_i - lt_data->prev_idle_time[cpu];
-			cpu_wall_time += cur_wall_time_i - lt_data->prev_wall_time[cpu];
+			cpu_idle_time += sample->idle_time - lt_data->prev_idle_time[cpu];
+			cpu_wall_time += sample->wall_time - lt_data->prev_wall_time[cpu];
 		}
 	}
 
@@ -109,18 +111,18 @@ static int lt_update_loading(struct LT_USER_DATA *lt_data)
 {
 	int ret = -EOVERFLOW;
 	int cpu;
-	u64 cur_idle_time_i, cur_wall_time_i;
+	struct lt_cpu_sample *sample;
 	u64 cpu_idle_time = 0, cpu_wall_time = 0;
 
 	lt_lockprove(__func__);
 	for_each_possible_cpu(cpu) {
-		cur_idle_time_i = get_cpu_idle_time(cpu, &cur_wall_time_i, 1);
+		sample = &per_cpu(lt_cpu_sample, cpu);
 
-		cpu_idle_time += cur_idle_time_i - lt_data->prev_idle_time[cpu];
-		cpu_wall_time += cur_wall_time_i - lt_data->prev_wall_time[cpu];
+		cpu_idle_time += sample->idle_time - lt_data->prev_idle_time[cpu];
+		cpu_wall_time += sample->wall_time - lt_data->prev_wall_time[cpu];
 
-		lt_data->prev_idle_time[cpu] = cur_idle_time_i;
-		lt_data->prev_wall_time[cpu] = cur_wall_time_i;
+		lt_data->prev_idle_time[cpu] = sample->idle_time;
+		lt_data->prev_wall_time[cpu] = sample->wall_time;
 	}
 
 	if (cpu_wall_time > 0 && cpu_wall_time >= cpu_idle_time)
@@ -131,33 +133,60 @@ static int lt_update_loading(struct LT_USER_DATA *lt_data)
 	return ret;
 }
 
+static inline bool lt_user_due(struct LT_USER_DATA *lt_user, ktime_t ktime_now)
+{
+	ktime_t slack = ms_to_ktime(lt_user->polling_ms >> LT_COALESCE_SHIFT);
+
+	return !ktime_after(lt_user->target_expire,
+		ktime_add(ktime_now, slack));
+}
+
+/* Rearm the shared work for the earliest pending user deadline */
+static void lt_schedule_locked(ktime_t ktime_now)
+{
+	struct LT_USER_DATA *lt_user;
+	ktime_t next = KTIME_MAX;
+
+	lt_lockprove(__func__);
+	hlist_for_each_entry(lt_user, &lt_user_list, user_list_node)
+		if (ktime_before(lt_user->target_expire, next))
+			next = lt_user->target_expire;
+
+	if (next == KTIME_MAX)
+		return;
+
+	mod_delayed_work(ps_lk_wq, &lt_sample_work,
+		ktime_after(next, ktime_now) ?
+		msecs_to_jiffies(ktime_ms_delta(next, ktime_now)) : 0);
+}
+
 static void lt_work_fn(struct work_struct *ps_work)
 {
-	struct delayed_work *dwork;
-	struct LT_WORK_DATA *lt_work;
 	struct LT_USER_DATA *lt_user;
 	ktime_t ktime_now;
+	bool sampled = false;
 
 	lt_lock(__func__);
-	dwork = container_of(ps_work, struct delayed_work, work);
-	lt_work = container_of(dwork, struct LT_WORK_DATA, s_work);
-	lt_user = lt_work->link2user;
-	if (lt_user) {
+	ktime_now = ktime_get();
+	hlist_for_each_entry(lt_user, &lt_user_list, user_list_node) {
+		if (!lt_user_due(lt_user, ktime_now))
+			continue;
+
+		if (!sampled) {
+			lt_sample_cpus();
+			sampled = true;
+		}
+
 		lt_user->fn(lt_update_mask_loading(lt_user), lt_update_loading(lt_user));
 
-		ktime_now = ktime_get();
 		do {
-			lt_work->target_expire =
-				ktime_add_ms(lt_work->target_expire,
+			lt_user->target_expire =
+				ktime_add_ms(lt_user->target_expire,
 					lt_user->polling_ms);
-		} while (!ktime_after(lt_work->target_expire, ktime_now));
-
-		queue_delayed_work(ps_lk_wq, &lt_work->s_work,
-			msecs_to_jiffies(ktime_ms_delta(
-				lt_work->target_expire, ktime_now)));
-	} else
-		free_lt_work(lt_work);
+		} while (lt_user_due(lt_user, ktime_now));
+	}
 
+	lt_schedule_locked(ktime_now);
 	lt_unlock(__func__);
 }
 
@@ -189,6 +218,7 @@ static void *new_lt_user(void (*fn)(int loading, int mask_loading),
 		new_lt->prev_idle_time[cpu] =
 			get_cpu_idle_time(cpu, &new_lt->prev_wall_time[cpu], 1);
 
+	new_lt->target_expire = ktime_add_ms(ktime_get(), polling_ms);
 	hlist_add_head(&new_lt->user_list_node, &lt_user_list);
 
 	return new_lt;
@@ -204,9 +234,6 @@ static void *new_lt_user(void (*fn)(int loading, int mask_loading),
 static void free_lt_user(struct LT_USER_DATA *node)
 {
 	lt_lockprove(__func__);
-	if (node->link2work)
-		node->link2work->link2user = NULL;
-
 	hlist_del(&node->user_list_node);
 	kfree(node->prev_idle_time);
 	kfree(node->prev_wall_time);
@@ -229,7 +256,6 @@ int reg_loading_tracking_sp(void (*fn)(int loading, int mask_loading), unsigned
 	const struct cpumask *cpu_mask, const char *caller)
 {
 	struct LT_USER_DATA *ltiter = NULL, *new_user;
-	struct LT_WORK_DATA *new_work;
 	int ret = 0;
 
 	might_sleep();
@@ -255,21 +281,10 @@ int reg_loading_tracking_sp(void (*fn)(int loading, int mask_loading), unsigned
 		goto reg_loading_tracking_out;
 	}
 
-	new_work = new_lt_work(new_user);
-	if (!new_work)
-		goto reg_loading_tracking_new_work_err;
-
-	new_user->link2work = new_work;
-
-	queue_delayed_work(ps_lk_wq, &new_work->s_work,
-		msecs_to_jiffies(new_user->polling_ms));
+	lt_schedule_locked(ktime_get());
 
 	pr_debug(TAG"%s %s success\n", __func__, caller);
 
-	goto reg_loading_tracking_out;
-
-reg_loading_tracking_new_work_err:
-	free_lt_user(new_user);
 reg_loading_tracking_out:
 	lt_unlock(__func__);
 
@@ -313,7 +328,8 @@ EXPORT_SYMBOL_GPL(unreg_loading_tracking_sp);
 static int __init load_track_init(void)
 {
 	nr_cpus = num_possible_cpus();
-	ps_lk_wq = create_workqueue("lt_wq");
+	ps_lk_wq = alloc_workqueue("lt_wq",
+		WQ_UNBOUND | WQ_POWER_EFFICIENT, 0);
 	if (!ps_lk_wq) {
 		return -EFAULT;
 		pr_debug(TAG"%s OOM\n", __func__);
@@ -325,6 +341,7 @@ static int __init load_track_init(void)
 static void __exit load_track_exit(void)
 {
 	lt_cleanup();
+	cancel_delayed_work_sync(&lt_sample_work);
 	flush_workqueue(ps_lk_wq);
 	destroy_workqueue(ps_lk_wq);
 }
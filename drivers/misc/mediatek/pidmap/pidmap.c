@@ -3,12 +3,15 @@
  * Copyright (C) 2019 MediaTek Inc.
  */
 #include <linux/module.h>
+#include <linux/poll.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/tracepoint.h>
 #include <linux/uaccess.h>
+#include <linux/wait.h>
 #include <mt-plat/mrdump.h>
 #include <mt-plat/mtk_pidmap.h>
 
@@ -31,6 +34,24 @@ static int  mtk_pidmap_max_pid;
 static char mtk_pidmap_proc_cmd_buf[PIDMAP_PROC_CMD_BUF_SIZE];
 static struct proc_dir_entry *mtk_pidmap_proc_entry;
 
+/*
+ * Delta log for /proc/pidmap_delta. The pid map itself stays a lockless
+ * one-way table for AEE; updates are additionally appended here so that
+ * readers can follow changes without rescanning the whole table.
+ */
+static struct pidmap_delta *mtk_pidmap_delta;
+static u64 mtk_pidmap_delta_head = 1;	/* seq of the next record */
+static DEFINE_SPINLOCK(mtk_pidmap_delta_lock);
+static DECLARE_WAIT_QUEUE_HEAD(mtk_pidmap_delta_wq);
+static struct proc_dir_entry *mtk_pidmap_delta_entry;
+
+/* per open file state of a delta reader */
+struct mtk_pidmap_reader {
+	u64 next;		/* seq of the next delta to return */
+	int snap_pos;		/* next pid map entry of the snapshot */
+	bool snapshot;		/* a snapshot is being returned */
+};
+
 /**
  * Data structures to store tracepoints information
  */
@@ -84,16 +105,40 @@ static void mtk_pidmap_update(struct task_struct *task, const char *task_comm)
 	*(name + 1) = (char)(task->tgid >> 8);
 }
 
+static void mtk_pidmap_log(struct task_struct *task, const char *task_comm,
+			   u32 type)
+{
+	struct pidmap_delta *rec;
+
+	if (!mtk_pidmap_delta)
+		return;
+
+	spin_lock(&mtk_pidmap_delta_lock);
+	rec = &mtk_pidmap_delta[mtk_pidmap_delta_head &
+				(PIDMAP_DELTA_CNT - 1)];
+	rec->seq = mtk_pidmap_delta_head++;
+	rec->pid = task->pid;
+	rec->tgid = task->tgid;
+	rec->type = type;
+	strscpy_pad(rec->comm, task_comm, TASK_COMM_LEN);
+	spin_unlock(&mtk_pidmap_delta_lock);
+
+	if (wq_has_sleeper(&mtk_pidmap_delta_wq))
+		wake_up_interruptible(&mtk_pidmap_delta_wq);
+}
+
 static void probe_task_rename(void *data, struct task_struct *task,
 			      const char *comm)
 {
 	mtk_pidmap_update(task, comm);
+	mtk_pidmap_log(task, comm, PIDMAP_DELTA_RENAME);
 }
 
 static void probe_task_newtask(void *data, struct task_struct *task,
 			       unsigned long clone_flags)
 {
 	mtk_pidmap_update(task, task->comm);
+	mtk_pidmap_log(task, task->comm, PIDMAP_DELTA_NEW);
 }
 
 static struct tracepoints_table interests[] = {
@@ -139,6 +184,10 @@ static int mtk_pidmap_init_map(void)
 	if (!mtk_pidmap)
 		return -ENOMEM;
 
+	/* the delta log is optional, the pid map works without it */
+	mtk_pidmap_delta = kcalloc(PIDMAP_DELTA_CNT,
+				   sizeof(*mtk_pidmap_delta), GFP_KERNEL);
+
 	/* Install the tracepoints */
 	for_each_kernel_tracepoint(lookup_tracepoints, NULL);
 
@@ -300,6 +349,147 @@ static const struct proc_ops mtk_pidmap_proc_fops = {
 	.proc_release = single_release,
 };
 
+static int mtk_pidmap_delta_open(struct inode *inode, struct file *file)
+{
+	struct mtk_pidmap_reader *r;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	r->snapshot = true;
+	file->private_data = r;
+
+	return 0;
+}
+
+static int mtk_pidmap_delta_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+/*
+ * Fill @rec with the next snapshot record, returns false once the
+ * snapshot is complete. The pid map is read without locking like the
+ * other dumps; an entry torn by a concurrent update is fixed up by the
+ * delta logged for that update.
+ */
+static bool mtk_pidmap_delta_snapshot(struct mtk_pidmap_reader *r,
+				      struct pidmap_delta *rec)
+{
+	char *name;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->seq = r->next;
+
+	for (; r->snap_pos < mtk_pidmap_max_pid; r->snap_pos++) {
+		name = &mtk_pidmap[r->snap_pos * PIDMAP_ENTRY_SIZE];
+		if (!name[0])
+			continue;
+
+		rec->pid = r->snap_pos + 1;
+		memcpy(rec->comm, name, min_t(int, PIDMAP_TASKNAME_SIZE,
+					      TASK_COMM_LEN - 1));
+		name += PIDMAP_TASKNAME_SIZE;
+		rec->tgid = (u8)name[0] + ((u8)name[1] << 8);
+		rec->type = PIDMAP_DELTA_SNAPSHOT;
+		r->snap_pos++;
+		return true;
+	}
+
+	rec->type = PIDMAP_DELTA_SNAPSHOT_END;
+	r->snapshot = false;
+	return true;
+}
+
+/* returns false if there is no delta pending for this reader */
+static bool mtk_pidmap_delta_next(struct mtk_pidmap_reader *r,
+				  struct pidmap_delta *rec)
+{
+	bool ret = true;
+
+	spin_lock(&mtk_pidmap_delta_lock);
+	if (r->snapshot && !r->snap_pos) {
+		/* deltas from here on are returned after the snapshot */
+		r->next = mtk_pidmap_delta_head;
+	} else if (!r->snapshot) {
+		if (r->next == mtk_pidmap_delta_head) {
+			ret = false;
+		} else if (mtk_pidmap_delta_head - r->next >
+			   PIDMAP_DELTA_CNT) {
+			/* overrun, resync from a new snapshot */
+			r->snapshot = true;
+			r->snap_pos = 0;
+			r->next = mtk_pidmap_delta_head;
+		} else {
+			*rec = mtk_pidmap_delta[r->next &
+						(PIDMAP_DELTA_CNT - 1)];
+			r->next++;
+			spin_unlock(&mtk_pidmap_delta_lock);
+			return true;
+		}
+	}
+	spin_unlock(&mtk_pidmap_delta_lock);
+
+	if (ret && r->snapshot)
+		ret = mtk_pidmap_delta_snapshot(r, rec);
+
+	return ret;
+}
+
+static ssize_t mtk_pidmap_delta_read(struct file *file, char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct mtk_pidmap_reader *r = file->private_data;
+	struct pidmap_delta rec;
+	size_t done = 0;
+	int ret;
+
+	if (count < sizeof(rec))
+		return -EINVAL;
+
+	while (count - done >= sizeof(rec)) {
+		if (!mtk_pidmap_delta_next(r, &rec)) {
+			if (done)
+				break;
+			if (file->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+			ret = wait_event_interruptible(mtk_pidmap_delta_wq,
+				READ_ONCE(mtk_pidmap_delta_head) != r->next);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (copy_to_user(buf + done, &rec, sizeof(rec)))
+			return done ? done : -EFAULT;
+		done += sizeof(rec);
+	}
+
+	return done;
+}
+
+static __poll_t mtk_pidmap_delta_poll(struct file *file, poll_table *wait)
+{
+	struct mtk_pidmap_reader *r = file->private_data;
+
+	poll_wait(file, &mtk_pidmap_delta_wq, wait);
+
+	if (r->snapshot || READ_ONCE(mtk_pidmap_delta_head) != r->next)
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static const struct proc_ops mtk_pidmap_delta_fops = {
+	.proc_open = mtk_pidmap_delta_open,
+	.proc_read = mtk_pidmap_delta_read,
+	.proc_poll = mtk_pidmap_delta_poll,
+	.proc_lseek = noop_llseek,
+	.proc_release = mtk_pidmap_delta_release,
+};
+
 static int mtk_pidmap_proc_init(void)
 {
 	kuid_t uid;
@@ -317,6 +507,15 @@ static int mtk_pidmap_proc_init(void)
 	else
 		pr_info("[pidmap] failed to create /proc/pidmap\n");
 
+	mtk_pidmap_delta_entry = proc_create("pidmap_delta",
+		PIDMAP_PROC_PERM & 0440, NULL,
+		&mtk_pidmap_delta_fops);
+
+	if (mtk_pidmap_delta_entry)
+		proc_set_user(mtk_pidmap_delta_entry, uid, gid);
+	else
+		pr_info("[pidmap] failed to create /proc/pidmap_delta\n");
+
 	return 0;
 }
 
@@ -339,6 +538,7 @@ static int __init mtk_pidmap_init(void)
 
 static void __exit mtk_pidmap_exit(void)
 {
+	proc_remove(mtk_pidmap_delta_entry);
 	proc_remove(mtk_pidmap_proc_entry);
 }
 
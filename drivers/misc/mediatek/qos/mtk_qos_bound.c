@@ -83,6 +83,8 @@ void qos_bound_enable(int enable)
 		pr_info("mtk_qos: bound ver=0x%x apu_num=%d\n",
 				bound->ver, bound->apu_num);
 		qos_bound_enabled = enable;
+		if (enable)
+			qos_bound_mon_init(bound->apu_num);
 	} else {
 		pr_info("mtk_qos: invalid bound version(0x%x, 0x%x)\n",
 				bound->ver, bound->apu_num);
@@ -224,6 +226,8 @@ int qos_notifier_call_chain(unsigned long val, void *v)
 	mtk_mmqos_system_qos_update(state);
 #endif
 
+	qos_bound_mon_record(bound);
+
 	if (is_qos_bound_log_enabled()) {
 		idx = bound->idx;
 		stat = &bound->stats[bound->idx];
@@ -6,6 +6,8 @@
 #ifndef __MTK_QOS_BOUND_H__
 #define __MTK_QOS_BOUND_H__
 
+#include <linux/types.h>
+
 #define QOS_BOUND_BUF_SIZE		16
 #define QOS_BOUND_VER_TAG		0xA3
 
@@ -50,6 +52,33 @@ struct qos_bound {
 	struct qos_bound_stat stats[QOS_BOUND_BUF_SIZE];
 };
 
+#define QOS_BOUND_MON_VER		1
+#define QOS_BOUND_MON_NR_SAMPLES	4096
+#define QOS_BOUND_MON_APU_MAX		8
+
+/* one entry of the mmap-able /dev/qos_bound_mon ring */
+struct qos_bound_mon_sample {
+	u64 ts_ns;
+	u16 idx;
+	u16 state;
+	u16 num;
+	u16 event;
+	u16 emibw_mon[NR_QOS_EMIBM_TYPE];
+	u16 smibw_mon[NR_QOS_SMIBM_TYPE];
+	u16 apubw_mon[QOS_BOUND_MON_APU_MAX];
+	u16 apulat_mon[QOS_BOUND_MON_APU_MAX];
+} __aligned(8);
+
+struct qos_bound_mon_ring {
+	u32 ver;
+	u32 sample_size;
+	u32 nr_samples;
+	u32 apu_num;
+	/* total samples written, slot is head % nr_samples */
+	u64 head;
+	struct qos_bound_mon_sample samples[QOS_BOUND_MON_NR_SAMPLES];
+};
+
 extern void qos_bound_init(void);
 extern struct qos_bound *get_qos_bound(void);
 extern int get_qos_bound_bw_threshold(int state);
@@ -69,4 +98,6 @@ extern unsigned short get_qos_bound_apubw_mon(int idx, int master);
 extern unsigned short get_qos_bound_apulat_mon(int idx, int master);
 extern unsigned short get_qos_bound_emibw_mon(int idx, int master);
 extern unsigned short get_qos_bound_smibw_mon(int idx, int master);
+extern void qos_bound_mon_init(unsigned short apu_num);
+extern void qos_bound_mon_record(struct qos_bound *bound);
 #endif
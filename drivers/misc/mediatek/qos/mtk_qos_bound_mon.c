@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+#include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+
+#include "mtk_qos_bound.h"
+
+/*
+ * /dev/qos_bound_mon exposes a read-only ring of per-interval bound
+ * samples. Userspace mmaps the ring, then either polls or blocks in
+ * read() for the next head sequence number. The only writer is the
+ * QoS IPI receive thread, so no locking is needed on the write side;
+ * readers detect torn samples by re-checking head after copying.
+ */
+
+struct qos_bound_mon_file {
+	u64 seen;
+};
+
+static struct qos_bound_mon_ring *mon_ring;
+static size_t mon_ring_size;
+static unsigned short mon_last_idx = QOS_BOUND_BUF_SIZE;
+static DECLARE_WAIT_QUEUE_HEAD(mon_wq);
+
+static void qos_bound_mon_copy(struct qos_bound *bound, unsigned short idx,
+		u64 ts)
+{
+	struct qos_bound_mon_sample *s;
+	struct qos_bound_stat *stat = &bound->stats[idx];
+	u64 head = mon_ring->head;
+	int i;
+
+	s = &mon_ring->samples[head % QOS_BOUND_MON_NR_SAMPLES];
+	s->ts_ns = ts;
+	s->idx = idx;
+	s->state = bound->state;
+	s->num = stat->num;
+	s->event = stat->event;
+	for (i = 0; i < NR_QOS_EMIBM_TYPE; i++)
+		s->emibw_mon[i] = stat->emibw_mon[i];
+	for (i = 0; i < NR_QOS_SMIBM_TYPE; i++)
+		s->smibw_mon[i] = stat->smibw_mon[i];
+	for (i = 0; i < mon_ring->apu_num; i++) {
+		s->apubw_mon[i] = get_qos_bound_apubw_mon(idx, i);
+		s->apulat_mon[i] = get_qos_bound_apulat_mon(idx, i);
+	}
+
+	smp_wmb(); /* publish sample before head */
+	WRITE_ONCE(mon_ring->head, head + 1);
+}
+
+void qos_bound_mon_record(struct qos_bound *bound)
+{
+	unsigned short idx, cur;
+	u64 ts;
+
+	if (!mon_ring || !bound)
+		return;
+
+	cur = bound->idx;
+	if (cur >= QOS_BOUND_BUF_SIZE)
+		return;
+
+	/*
+	 * SSPM keeps filling its own QOS_BOUND_BUF_SIZE window between
+	 * IPIs, so catch up on every interval written since the last call
+	 * instead of sampling only the current one.
+	 */
+	if (mon_last_idx >= QOS_BOUND_BUF_SIZE)
+		idx = cur;
+	else
+		idx = (mon_last_idx + 1) % QOS_BOUND_BUF_SIZE;
+
+	ts = ktime_get_ns();
+	for (;;) {
+		qos_bound_mon_copy(bound, idx, ts);
+		if (idx == cur)
+			break;
+		idx = (idx + 1) % QOS_BOUND_BUF_SIZE;
+	}
+	mon_last_idx = cur;
+
+	wake_up_interruptible(&mon_wq);
+}
+
+static int qos_bound_mon_open(struct inode *inode, struct file *file)
+{
+	struct qos_bound_mon_file *mf;
+
+	if (!mon_ring)
+		return -ENODEV;
+
+	mf = kzalloc(sizeof(*mf), GFP_KERNEL);
+	if (!mf)
+		return -ENOMEM;
+
+	mf->seen = READ_ONCE(mon_ring->head);
+	file->private_data = mf;
+
+	return 0;
+}
+
+static int qos_bound_mon_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+
+	return 0;
+}
+
+static ssize_t qos_bound_mon_read(struct file *file, char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	struct qos_bound_mon_file *mf = file->private_data;
+	u64 head;
+	int ret;
+
+	if (count < sizeof(head))
+		return -EINVAL;
+
+	if (READ_ONCE(mon_ring->head) == mf->seen) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(mon_wq,
+				READ_ONCE(mon_ring->head) != mf->seen);
+		if (ret)
+			return ret;
+	}
+
+	head = READ_ONCE(mon_ring->head);
+	if (copy_to_user(buf, &head, sizeof(head)))
+		return -EFAULT;
+	mf->seen = head;
+
+	return sizeof(head);
+}
+
+static __poll_t qos_bound_mon_poll(struct file *file, poll_table *wait)
+{
+	struct qos_bound_mon_file *mf = file->private_data;
+
+	poll_wait(file, &mon_wq, wait);
+	if (READ_ONCE(mon_ring->head) != mf->seen)
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static int qos_bound_mon_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(mon_ring_size))
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, mon_ring, 0);
+}
+
+static const struct file_operations qos_bound_mon_fops = {
+	.owner = THIS_MODULE,
+	.open = qos_bound_mon_open,
+	.release = qos_bound_mon_release,
+	.read = qos_bound_mon_read,
+	.poll = qos_bound_mon_poll,
+	.mmap = qos_bound_mon_mmap,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice qos_bound_mon_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "qos_bound_mon",
+	.fops = &qos_bound_mon_fops,
+	.mode = 0444,
+};
+
+void qos_bound_mon_init(unsigned short apu_num)
+{
+	if (mon_ring)
+		return;
+
+	mon_ring_size = sizeof(*mon_ring);
+	mon_ring = vmalloc_user(PAGE_ALIGN(mon_ring_size));
+	if (!mon_ring) {
+		pr_info("mtk_qos: bound mon ring alloc fail\n");
+		return;
+	}
+
+	mon_ring->ver = QOS_BOUND_MON_VER;
+	mon_ring->sample_size = sizeof(struct qos_bound_mon_sample);
+	mon_ring->nr_samples = QOS_BOUND_MON_NR_SAMPLES;
+	mon_ring->apu_num = min_t(unsigned short, apu_num,
+			QOS_BOUND_MON_APU_MAX);
+
+	if (misc_register(&qos_bound_mon_dev)) {
+		pr_info("mtk_qos: bound mon register fail\n");
+		vfree(mon_ring);
+		mon_ring = NULL;
+	}
+}
@@ -31,6 +31,10 @@
 #include <linux/skbuff.h>
 #include <linux/module.h>
 #include <linux/debugfs.h>
+#include <linux/arch_topology.h>
+#include <linux/kernel_stat.h>
+#include <linux/sched/topology.h>
+#include <linux/workqueue.h>
 
 #include "rps_perf.h"
 
@@ -86,6 +90,323 @@ int set_rps_map(struct netdev_rx_queue *queue, unsigned long rps_value)
 #endif
 }
 EXPORT_SYMBOL(set_rps_map);
+
+/*
+ * Dynamic RPS: devices handed over with rps_perf_dyn_set() get their RPS
+ * map rebuilt every dyn_interval_ms out of the CPUs they allow, leaving
+ * out CPUs that are already saturated by NET_RX softirqs, the CPU the
+ * top-app render thread runs on and thermally capped small cores. CPUs
+ * kept above the busy level also get a flow limit table, so one bulk
+ * flow can't starve the others queued there. dyn_interval_ms = 0 falls
+ * back to the static maps.
+ */
+static unsigned int dyn_interval_ms = 200;
+module_param(dyn_interval_ms, uint, 0644);
+
+/* NET_RX softirq time, in percent of the interval, that makes a CPU busy */
+static unsigned int dyn_busy_pct = 60;
+module_param(dyn_busy_pct, uint, 0644);
+
+/* pid of the top-app render thread, set by the perf service */
+static int render_pid;
+module_param(render_pid, int, 0644);
+
+#define RPS_DYN_FLOW_LIMIT_LEN	(1 << 12)
+
+struct rps_dyn_dev {
+	struct list_head list;
+	struct net_device *dev;
+	unsigned long allowed;
+	unsigned long cur;
+};
+
+struct rps_dyn_cpu {
+	u64 softirq_time;
+	unsigned int net_rx_cnt;
+	unsigned int softirq_cnt;
+	unsigned int load;	/* NET_RX softirq, percent of the interval */
+};
+
+static LIST_HEAD(rps_dyn_devs);
+static DEFINE_MUTEX(rps_dyn_mutex);
+static DEFINE_PER_CPU(struct rps_dyn_cpu, rps_dyn_cpus);
+static unsigned long rps_dyn_flow_limit;	/* CPUs we enabled it on */
+static u64 rps_dyn_last_ns;
+
+static void rps_dyn_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(rps_dyn_work, rps_dyn_work_fn);
+
+static void rps_dyn_apply(struct rps_dyn_dev *d, unsigned long value)
+{
+	unsigned int i;
+
+	if (d->cur == value)
+		return;
+	for (i = 0; i < d->dev->real_num_rx_queues; i++)
+		set_rps_map(&d->dev->_rx[i], value);
+	d->cur = value;
+}
+
+static void rps_dyn_sample(void)
+{
+	u64 now = ktime_get_ns();
+	u64 delta_ns = now - rps_dyn_last_ns;
+	int cpu, i;
+
+	rps_dyn_last_ns = now;
+	for_each_possible_cpu(cpu) {
+		struct rps_dyn_cpu *c = per_cpu_ptr(&rps_dyn_cpus, cpu);
+		u64 time = kcpustat_cpu(cpu).cpustat[CPUTIME_SOFTIRQ];
+		unsigned int net_rx, total = 0;
+		u64 rx_time;
+
+		net_rx = kstat_softirqs_cpu(NET_RX_SOFTIRQ, cpu);
+		for (i = 0; i < NR_SOFTIRQS; i++)
+			total += kstat_softirqs_cpu(i, cpu);
+
+		/* softirq time is not split per vector, share it by count */
+		rx_time = time - c->softirq_time;
+		if (total != c->softirq_cnt)
+			rx_time = div_u64(rx_time * (net_rx - c->net_rx_cnt),
+					total - c->softirq_cnt);
+		else
+			rx_time = 0;
+		c->load = delta_ns ?
+			min_t(u64, div64_u64(rx_time * 100, delta_ns), 100) : 0;
+
+		c->softirq_time = time;
+		c->net_rx_cnt = net_rx;
+		c->softirq_cnt = total;
+	}
+}
+
+/* CPUs no device should steer packets to right now */
+static unsigned long rps_dyn_avoid_mask(void)
+{
+	unsigned long max_cap = 0, mask = 0;
+	struct task_struct *t;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		max_cap = max(max_cap, arch_scale_cpu_capacity(cpu));
+	for_each_online_cpu(cpu) {
+		if (cpu >= BITS_PER_LONG)
+			break;
+		if (arch_scale_cpu_capacity(cpu) < max_cap &&
+			arch_scale_thermal_pressure(cpu))
+			mask |= BIT(cpu);
+	}
+
+	if (READ_ONCE(render_pid) > 0) {
+		rcu_read_lock();
+		t = pid_task(find_vpid(READ_ONCE(render_pid)), PIDTYPE_PID);
+		if (t && task_cpu(t) < BITS_PER_LONG)
+			mask |= BIT(task_cpu(t));
+		rcu_read_unlock();
+	}
+
+	return mask;
+}
+
+static void rps_dyn_set_flow_limit(int cpu, bool on)
+{
+#if IS_ENABLED(CONFIG_NET_FLOW_LIMIT)
+	struct softnet_data *sd = &per_cpu(softnet_data, cpu);
+	struct sd_flow_limit *cur;
+
+	cur = rcu_dereference_protected(sd->flow_limit,
+				lockdep_is_held(&rps_dyn_mutex));
+	if (on) {
+		if (cur)
+			return;
+		cur = kzalloc_node(struct_size(cur, buckets,
+				RPS_DYN_FLOW_LIMIT_LEN), GFP_KERNEL,
+				cpu_to_node(cpu));
+		if (!cur)
+			return;
+		cur->num_buckets = RPS_DYN_FLOW_LIMIT_LEN;
+		rcu_assign_pointer(sd->flow_limit, cur);
+		rps_dyn_flow_limit |= BIT(cpu);
+	} else {
+		/* leave tables enabled through the sysctl alone */
+		if (!(rps_dyn_flow_limit & BIT(cpu)))
+			return;
+		rps_dyn_flow_limit &= ~BIT(cpu);
+		RCU_INIT_POINTER(sd->flow_limit, NULL);
+		synchronize_rcu();
+		kfree(cur);
+	}
+#endif
+}
+
+static void rps_dyn_rebalance(void)
+{
+	unsigned long avoid, busy = 0, used = 0, value;
+	struct rps_dyn_dev *d;
+	int cpu;
+
+	rps_dyn_sample();
+	avoid = rps_dyn_avoid_mask();
+	for_each_online_cpu(cpu) {
+		if (cpu >= BITS_PER_LONG)
+			break;
+		if (per_cpu(rps_dyn_cpus, cpu).load >= dyn_busy_pct)
+			busy |= BIT(cpu);
+	}
+
+	list_for_each_entry(d, &rps_dyn_devs, list) {
+		value = d->allowed & *cpumask_bits(cpu_online_mask);
+		/* never leave a device without any RPS CPU */
+		if (value & ~avoid)
+			value &= ~avoid;
+		if (value & ~busy)
+			value &= ~busy;
+		rps_dyn_apply(d, value);
+		used |= value;
+	}
+
+	for (cpu = 0; cpu < min(nr_cpu_ids, (unsigned int)BITS_PER_LONG);
+		cpu++)
+		rps_dyn_set_flow_limit(cpu, (used & busy & BIT(cpu)) != 0);
+}
+
+static void rps_dyn_work_fn(struct work_struct *work)
+{
+	unsigned int interval = READ_ONCE(dyn_interval_ms);
+
+	mutex_lock(&rps_dyn_mutex);
+	if (interval && !list_empty(&rps_dyn_devs)) {
+		rps_dyn_rebalance();
+	} else if (!interval) {
+		struct rps_dyn_dev *d;
+		int cpu;
+
+		/* controller turned off, back to the static maps */
+		list_for_each_entry(d, &rps_dyn_devs, list)
+			rps_dyn_apply(d, d->allowed);
+		for (cpu = 0;
+			cpu < min(nr_cpu_ids, (unsigned int)BITS_PER_LONG);
+			cpu++)
+			rps_dyn_set_flow_limit(cpu, false);
+	}
+	mutex_unlock(&rps_dyn_mutex);
+
+	schedule_delayed_work(&rps_dyn_work,
+		msecs_to_jiffies(interval ? interval : 1000));
+}
+
+static struct rps_dyn_dev *rps_dyn_find(struct net_device *dev)
+{
+	struct rps_dyn_dev *d;
+
+	list_for_each_entry(d, &rps_dyn_devs, list)
+		if (d->dev == dev)
+			return d;
+	return NULL;
+}
+
+/*
+ * Hand the RPS map of @dev to the dynamic controller, @allowed being the
+ * CPUs it may pick from. @allowed = 0 clears the map and gives it back.
+ */
+int rps_perf_dyn_set(struct net_device *dev, unsigned long allowed)
+{
+	struct rps_dyn_dev *d;
+	int ret = 0;
+
+	mutex_lock(&rps_dyn_mutex);
+	d = rps_dyn_find(dev);
+	if (!allowed) {
+		if (d) {
+			rps_dyn_apply(d, 0);
+			list_del(&d->list);
+			dev_put(d->dev);
+			kfree(d);
+		} else {
+			set_rps_map(dev->_rx, 0);
+		}
+		goto out;
+	}
+
+	if (!d) {
+		d = kzalloc(sizeof(*d), GFP_KERNEL);
+		if (!d) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		dev_hold(dev);
+		d->dev = dev;
+		d->cur = ~0UL;
+		list_add_tail(&d->list, &rps_dyn_devs);
+	}
+	d->allowed = allowed;
+	/* start from the full map, the next sample narrows it */
+	rps_dyn_apply(d, allowed);
+out:
+	mutex_unlock(&rps_dyn_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(rps_perf_dyn_set);
+
+static int rps_dyn_netdev_event(struct notifier_block *nb,
+	unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+	struct rps_dyn_dev *d;
+
+	if (event != NETDEV_UNREGISTER)
+		return NOTIFY_DONE;
+
+	mutex_lock(&rps_dyn_mutex);
+	d = rps_dyn_find(dev);
+	if (d) {
+		list_del(&d->list);
+		dev_put(d->dev);
+		kfree(d);
+	}
+	mutex_unlock(&rps_dyn_mutex);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block rps_dyn_netdev_nb = {
+	.notifier_call = rps_dyn_netdev_event,
+};
+
+static int __init rps_perf_init(void)
+{
+	int ret;
+
+	ret = register_netdevice_notifier(&rps_dyn_netdev_nb);
+	if (ret)
+		return ret;
+
+	rps_dyn_last_ns = ktime_get_ns();
+	schedule_delayed_work(&rps_dyn_work, msecs_to_jiffies(1000));
+	return 0;
+}
+
+static void __exit rps_perf_exit(void)
+{
+	struct rps_dyn_dev *d, *tmp;
+	int cpu;
+
+	cancel_delayed_work_sync(&rps_dyn_work);
+	unregister_netdevice_notifier(&rps_dyn_netdev_nb);
+
+	mutex_lock(&rps_dyn_mutex);
+	list_for_each_entry_safe(d, tmp, &rps_dyn_devs, list) {
+		list_del(&d->list);
+		dev_put(d->dev);
+		kfree(d);
+	}
+	for (cpu = 0; cpu < min(nr_cpu_ids, (unsigned int)BITS_PER_LONG);
+		cpu++)
+		rps_dyn_set_flow_limit(cpu, false);
+	mutex_unlock(&rps_dyn_mutex);
+}
+
+module_init(rps_perf_init);
+module_exit(rps_perf_exit);
 MODULE_LICENSE("GPL");
 
 
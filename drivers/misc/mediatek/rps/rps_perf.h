@@ -8,6 +8,7 @@
 #define __RPS_PERF_H__
 
 int set_rps_map(struct netdev_rx_queue *queue, unsigned long rps_value);
+int rps_perf_dyn_set(struct net_device *dev, unsigned long allowed);
 
 #endif /* __RPS_PERF_H__ */
 
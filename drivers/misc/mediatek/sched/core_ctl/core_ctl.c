@@ -77,6 +77,13 @@ struct cluster_data {
 	struct kobject kobj;
 	s64 offline_throttle_ms;
 	s64 next_offline_time;
+	/* trend of new_need_cpus, NEED_AVG_SHIFT fixed point */
+	unsigned int need_avg;
+	unsigned int need_hyst;
+	unsigned int pause_cost_ms;
+	unsigned int flap_level;
+	s64 last_pause_time;
+	s64 last_resume_time;
 	struct cluster_ppm_data ppm_data;
 };
 
@@ -104,6 +111,18 @@ struct cpu_data {
 #define MAX_CPU_TJ_DEGREE	100000
 #define BIG_TASK_AVG_THRESHOLD	25
 
+/*
+ * need_avg follows new_need_cpus once per window: it rises by half of
+ * the gap and decays by 1/8 of it, so a single busy window cannot
+ * resume a CPU that a few quiet windows would pause again.
+ */
+#define NEED_AVG_SHIFT		10
+#define NEED_AVG_ONE		(1U << NEED_AVG_SHIFT)
+#define NEED_AVG_UP_SHIFT	1
+#define NEED_AVG_DOWN_SHIFT	3
+#define MAX_NEED_HYST		(NEED_AVG_ONE / 2)
+#define MAX_FLAP_LEVEL		3
+
 #define for_each_cluster(cluster, idx) \
 	for ((cluster) = &cluster_state[idx]; (idx) < num_clusters;\
 		(idx)++, (cluster) = &cluster_state[idx])
@@ -231,6 +250,70 @@ bool is_cluster_init(unsigned int cid)
 	return  cluster_state[cid].inited;
 }
 
+static void update_need_avg(struct cluster_data *cluster)
+{
+	unsigned int target = cluster->new_need_cpus << NEED_AVG_SHIFT;
+	unsigned int avg = cluster->need_avg;
+
+	if (target > avg)
+		avg += DIV_ROUND_UP(target - avg, 1U << NEED_AVG_UP_SHIFT);
+	else
+		avg -= (avg - target) >> NEED_AVG_DOWN_SHIFT;
+
+	cluster->need_avg = avg;
+}
+
+/*
+ * Turn the need trend into a CPU count. The active count only moves
+ * once the trend has crossed it by need_hyst, except for a jump of
+ * more than one CPU, which is resumed at once to keep wakeup latency
+ * of a real burst low.
+ */
+static unsigned int trend_need_cpus(struct cluster_data *cluster)
+{
+	unsigned int active = cluster->active_cpus << NEED_AVG_SHIFT;
+	unsigned int avg = cluster->need_avg;
+	unsigned int hyst = cluster->need_hyst;
+
+	if (cluster->new_need_cpus > cluster->active_cpus + 1)
+		return cluster->new_need_cpus;
+
+	if (avg > active + hyst)
+		return DIV_ROUND_UP(avg - hyst, NEED_AVG_ONE);
+
+	if (avg + hyst < active)
+		return (avg + hyst) >> NEED_AVG_SHIFT;
+
+	return cluster->active_cpus;
+}
+
+/*
+ * A pause that is undone within pause_cost_ms paid two migrations and
+ * a wakeup for nothing. Each such cycle doubles the time the demand
+ * has to stay low before the next pause, and a resumed CPU that stays
+ * needed for pause_cost_ms earns one level back.
+ */
+static s64 offline_throttle(struct cluster_data *cluster)
+{
+	return cluster->offline_throttle_ms << cluster->flap_level;
+}
+
+static void account_pause_cost(struct cluster_data *cluster,
+		bool core_on, s64 now)
+{
+	if (core_on) {
+		if (now - cluster->last_pause_time < cluster->pause_cost_ms &&
+				cluster->flap_level < MAX_FLAP_LEVEL)
+			cluster->flap_level++;
+		cluster->last_resume_time = now;
+	} else {
+		if (now - cluster->last_resume_time >= cluster->pause_cost_ms &&
+				cluster->flap_level)
+			cluster->flap_level--;
+		cluster->last_pause_time = now;
+	}
+}
+
 static bool demand_eval(struct cluster_data *cluster)
 {
 	unsigned long flags;
@@ -246,13 +329,14 @@ static bool demand_eval(struct cluster_data *cluster)
 
 	spin_lock_irqsave(&state_lock, flags);
 
+	/* check again active cpus. */
+	cluster->active_cpus = get_active_cpu_count(cluster);
+
 	if (cluster->boost || !cluster->enable || !enable_policy)
 		need_cpus = cluster->max_cpus;
 	else
-		need_cpus = cluster->new_need_cpus;
+		need_cpus = trend_need_cpus(cluster);
 
-	/* check again active cpus. */
-	cluster->active_cpus = get_active_cpu_count(cluster);
 	new_need = apply_limits(cluster, need_cpus);
 	/*
 	 * When there is no adjustment in need, avoid
@@ -279,10 +363,13 @@ static bool demand_eval(struct cluster_data *cluster)
 
 		/* Does it exceed throttle time ? */
 		elapsed = now - cluster->next_offline_time;
-		ret = elapsed >= cluster->offline_throttle_ms;
+		ret = elapsed >= offline_throttle(cluster);
 	}
 
 	if (ret) {
+		if (need_flag)
+			account_pause_cost(cluster,
+				new_need > cluster->active_cpus, now);
 		cluster->next_offline_time = now;
 		cluster->need_cpus = new_need;
 	}
@@ -337,6 +424,27 @@ void set_offline_throttle_ms(struct cluster_data *cluster, unsigned int val)
 	apply_demand(cluster);
 }
 
+static void set_need_hyst(struct cluster_data *cluster, unsigned int val)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&state_lock, flags);
+	cluster->need_hyst = val;
+	spin_unlock_irqrestore(&state_lock, flags);
+	apply_demand(cluster);
+}
+
+static void set_pause_cost_ms(struct cluster_data *cluster, unsigned int val)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&state_lock, flags);
+	cluster->pause_cost_ms = val;
+	if (!val)
+		cluster->flap_level = 0;
+	spin_unlock_irqrestore(&state_lock, flags);
+}
+
 static inline
 void update_next_cluster_down_thres(unsigned int index,
 				     unsigned int new_thresh)
@@ -678,6 +786,44 @@ static ssize_t show_offline_throttle_ms(const struct cluster_data *state,
 	return snprintf(buf, PAGE_SIZE, "%u\n", state->offline_throttle_ms);
 }
 
+static ssize_t store_need_hyst(struct cluster_data *state,
+		const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	if (val > MAX_NEED_HYST)
+		return -EINVAL;
+
+	set_need_hyst(state, val);
+	return count;
+}
+
+static ssize_t show_need_hyst(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->need_hyst);
+}
+
+static ssize_t store_pause_cost_ms(struct cluster_data *state,
+		const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	set_pause_cost_ms(state, val);
+	return count;
+}
+
+static ssize_t show_pause_cost_ms(const struct cluster_data *state,
+		char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->pause_cost_ms);
+}
+
 static ssize_t store_up_thres(struct cluster_data *state,
 		const char *buf, size_t count)
 {
@@ -851,6 +997,14 @@ static ssize_t show_global_state(const struct cluster_data *state, char *buf)
 					get_active_cpu_count(cluster));
 			count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tNeed CPUs: %u\n", cluster->need_cpus);
+			count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tNeed avg: %u.%03u\n",
+					cluster->need_avg >> NEED_AVG_SHIFT,
+					((cluster->need_avg & (NEED_AVG_ONE - 1))
+					 * 1000) >> NEED_AVG_SHIFT);
+			count += snprintf(buf + count, PAGE_SIZE - count,
+					"\tFlap level: %u\n",
+					cluster->flap_level);
 			count += snprintf(buf + count, PAGE_SIZE - count,
 					"\tNR Paused CPUs(pause by core_ctl): %u\n",
 					cluster->nr_paused_cpus);
@@ -894,6 +1048,8 @@ __ATTR(_name, 0600, show_##_name, store_##_name)
 core_ctl_attr_rw(min_cpus);
 core_ctl_attr_rw(max_cpus);
 core_ctl_attr_rw(offline_throttle_ms);
+core_ctl_attr_rw(need_hyst);
+core_ctl_attr_rw(pause_cost_ms);
 core_ctl_attr_rw(up_thres);
 core_ctl_attr_rw(not_preferred);
 core_ctl_attr_rw(core_ctl_boost);
@@ -906,6 +1062,8 @@ static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
 	&max_cpus.attr,
 	&offline_throttle_ms.attr,
+	&need_hyst.attr,
+	&pause_cost_ms.attr,
 	&up_thres.attr,
 	&not_preferred.attr,
 	&core_ctl_boost.attr,
@@ -1169,6 +1327,7 @@ static inline void core_ctl_main_algo(void)
 	index = 0;
 	for_each_cluster(cluster, index) {
 		orig_need_cpu[index] = cluster->new_need_cpus;
+		update_need_avg(cluster);
 	}
 
 	trace_core_ctl_algo_info(big_cpu_ts, heaviest_thres, max_util,
@@ -1560,6 +1719,9 @@ static int cluster_init(const struct cpumask *mask)
 	cluster->max_cpus = cluster->num_cpus;
 	cluster->need_cpus = cluster->num_cpus;
 	cluster->offline_throttle_ms = 100;
+	cluster->need_avg = cluster->num_cpus << NEED_AVG_SHIFT;
+	cluster->need_hyst = NEED_AVG_ONE / 4;
+	cluster->pause_cost_ms = 200;
 	cluster->enable = true;
 	cluster->nr_down = 0;
 	cluster->nr_up = 0;
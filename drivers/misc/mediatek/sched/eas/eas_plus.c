@@ -196,6 +196,142 @@ int sort_thermal_headroom(struct cpumask *cpus, int *cpu_order)
 
 #endif
 
+/*
+ * Per-PD evaluation table for mtk_em_cpu_energy(): the performance state
+ * picked for every possible max_util, with the min_freq floor applied,
+ * and per-CPU leakage of every state at the last seen temperature. The
+ * wakeup path indexes them instead of redoing the util-to-freq mapping,
+ * the OPP walk and the leakage polynomial for each candidate CPU.
+ *
+ * util_opp[] is rebuilt when a min freq limit changes; entries are single
+ * bytes, a reader racing a rebuild gets either the old or the new state.
+ * A leakage row is rebuilt, under its seqcount, the first time a CPU is
+ * evaluated at a new temperature.
+ */
+struct mtk_em_table {
+	struct em_perf_domain *pd;
+	u8 util_opp[SCHED_CAPACITY_SCALE + 1];
+};
+
+struct mtk_em_lkg {
+	raw_spinlock_t lock;
+	seqcount_t seq;
+	unsigned int temp;
+	unsigned int *pwr;
+};
+
+static DEFINE_PER_CPU(struct mtk_em_table *, em_table);
+#if IS_ENABLED(CONFIG_MTK_LEAKAGE_AWARE_TEMP)
+static DEFINE_PER_CPU(struct mtk_em_lkg, em_lkg);
+#endif
+
+static void mtk_em_table_build(struct mtk_em_table *table)
+{
+	struct em_perf_domain *pd = table->pd;
+	unsigned long freq, fmax, scale_cpu, util;
+	int cpu, i = 0;
+
+	cpu = cpumask_first(to_cpumask(pd->cpus));
+	scale_cpu = arch_scale_cpu_capacity(cpu);
+	fmax = pd->table[pd->nr_perf_states - 1].frequency;
+
+	/* the mapping is monotonic, so the state only ever moves up */
+	for (util = 0; util <= SCHED_CAPACITY_SCALE; util++) {
+#if IS_ENABLED(CONFIG_NONLINEAR_FREQ_CTL)
+		mtk_map_util_freq(NULL, util, fmax, to_cpumask(pd->cpus), &freq);
+#else
+		freq = map_util_freq(util, fmax, scale_cpu);
+#endif
+		freq = max(freq, per_cpu(min_freq, cpu));
+
+		while (i < pd->nr_perf_states - 1 &&
+		       pd->table[i].frequency < freq)
+			i++;
+
+		WRITE_ONCE(table->util_opp[util], i);
+	}
+}
+
+void mtk_em_table_refresh(int cpu)
+{
+	struct mtk_em_table *table = per_cpu(em_table, cpu);
+
+	if (table)
+		mtk_em_table_build(table);
+}
+
+int mtk_em_table_init(void)
+{
+	struct mtk_em_table *table;
+	struct em_perf_domain *pd;
+	int cpu, sibling;
+
+	for_each_possible_cpu(cpu) {
+		pd = em_cpu_get(cpu);
+		if (!pd || cpu != cpumask_first(to_cpumask(pd->cpus)))
+			continue;
+
+		table = kzalloc(sizeof(*table), GFP_KERNEL);
+		if (!table)
+			return -ENOMEM;
+
+		table->pd = pd;
+		mtk_em_table_build(table);
+
+		for_each_cpu(sibling, to_cpumask(pd->cpus)) {
+#if IS_ENABLED(CONFIG_MTK_LEAKAGE_AWARE_TEMP)
+			struct mtk_em_lkg *lkg = &per_cpu(em_lkg, sibling);
+
+			raw_spin_lock_init(&lkg->lock);
+			seqcount_init(&lkg->seq);
+			lkg->temp = UINT_MAX;
+			lkg->pwr = kcalloc(pd->nr_perf_states,
+					   sizeof(*lkg->pwr), GFP_KERNEL);
+#endif
+			per_cpu(em_table, sibling) = table;
+		}
+	}
+
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_MTK_LEAKAGE_AWARE_TEMP)
+static unsigned int mtk_em_leakage(struct em_perf_domain *pd, int cpu,
+		int opp, unsigned int temp)
+{
+	struct mtk_em_lkg *lkg = &per_cpu(em_lkg, cpu);
+	unsigned int seq, pwr;
+	int i;
+
+	if (!lkg->pwr || !mtk_static_power_ready())
+		return mtk_get_leakage(cpu, opp, temp);
+
+	do {
+		seq = read_seqcount_begin(&lkg->seq);
+		if (lkg->temp != temp)
+			goto rebuild;
+		pwr = lkg->pwr[opp];
+	} while (read_seqcount_retry(&lkg->seq, seq));
+
+	return pwr;
+
+rebuild:
+	/* someone else is at it, do not wait for them */
+	if (!raw_spin_trylock(&lkg->lock))
+		return mtk_get_leakage(cpu, opp, temp);
+
+	write_seqcount_begin(&lkg->seq);
+	for (i = 0; i < pd->nr_perf_states; i++)
+		lkg->pwr[i] = mtk_get_leakage(cpu, i, temp);
+	lkg->temp = temp;
+	write_seqcount_end(&lkg->seq);
+	pwr = lkg->pwr[opp];
+	raw_spin_unlock(&lkg->lock);
+
+	return pwr;
+}
+#endif
+
 /**
  * em_cpu_energy() - Estimates the energy consumed by the CPUs of a
 		performance domain
@@ -214,6 +350,7 @@ unsigned long mtk_em_cpu_energy(struct em_perf_domain *pd,
 		unsigned long max_util, unsigned long sum_util, unsigned int *cpu_temp)
 {
 	unsigned long freq, scale_cpu;
+	struct mtk_em_table *table;
 	struct em_perf_state *ps;
 	int i, cpu, opp = -1;
 	unsigned long dyn_pwr = 0, static_pwr = 0;
@@ -230,6 +367,16 @@ unsigned long mtk_em_cpu_energy(struct em_perf_domain *pd,
 	 */
 	cpu = cpumask_first(to_cpumask(pd->cpus));
 	scale_cpu = arch_scale_cpu_capacity(cpu);
+
+	table = per_cpu(em_table, cpu);
+	if (likely(table && table->pd == pd)) {
+		i = READ_ONCE(table->util_opp[min_t(unsigned long, max_util,
+						     SCHED_CAPACITY_SCALE)]);
+		ps = &pd->table[i];
+		freq = ps->frequency;
+		goto found;
+	}
+
 	ps = &pd->table[pd->nr_perf_states - 1];
 #if IS_ENABLED(CONFIG_NONLINEAR_FREQ_CTL)
 	mtk_map_util_freq(NULL, max_util, ps->frequency, to_cpumask(pd->cpus), &freq);
@@ -248,6 +395,7 @@ unsigned long mtk_em_cpu_energy(struct em_perf_domain *pd,
 			break;
 	}
 
+found:
 #if IS_ENABLED(CONFIG_MTK_LEAKAGE_AWARE_TEMP)
 	i = min(i, pd->nr_perf_states - 1);
 	opp = pd->nr_perf_states - i - 1;
@@ -255,7 +403,7 @@ unsigned long mtk_em_cpu_energy(struct em_perf_domain *pd,
 	for_each_cpu_and(cpu, to_cpumask(pd->cpus), cpu_online_mask) {
 		unsigned int cpu_static_pwr;
 
-		cpu_static_pwr = mtk_get_leakage(cpu, opp, cpu_temp[cpu]);
+		cpu_static_pwr = mtk_em_leakage(pd, cpu, opp, cpu_temp[cpu]);
 		static_pwr += cpu_static_pwr;
 
 		trace_sched_leakage(cpu, opp, cpu_temp[cpu], cpu_static_pwr, static_pwr);
@@ -471,6 +619,17 @@ int select_bigger_idle_cpu(struct task_struct *p)
 	if (i != 0)
 		bigger_idle_cpu = select_idle_cpu_from_domains(p, prefer_pds, i);
 
+	if (mtk_placement_rec_enabled() && i != 0) {
+		struct cpumask cands;
+		int j;
+
+		cpumask_clear(&cands);
+		for (j = 0; j < i; j++)
+			cpumask_or(&cands, &cands, perf_domain_span(prefer_pds[j]));
+		mtk_placement_record(p, LB_BIGGER_IDLE_CPU, cpu, bigger_idle_cpu,
+				&cands);
+	}
+
 	rcu_read_unlock();
 	return bigger_idle_cpu;
 }
@@ -517,6 +676,8 @@ void check_for_migration(struct task_struct *p)
 		if (better_idle_cpu >= 0)
 			new_cpu = better_idle_cpu;
 
+		mtk_placement_record(p, LB_TICK_MISFIT, cpu, new_cpu, cpu_active_mask);
+
 		if (new_cpu < 0) {
 			raw_spin_unlock(&migration_lock);
 			return;
@@ -693,5 +854,8 @@ void mtk_select_task_rq_rt(void *data, struct task_struct *p, int source_cpu,
 out:
 
 	trace_sched_select_task_rq_rt(p, select_reason, *target_cpu, sd_flag, sync);
+	if (select_reason != LB_RT_FAIL)
+		mtk_placement_record(p, select_reason, task_cpu(p), *target_cpu,
+				cpu_active_mask);
 }
 
@@ -2,6 +2,7 @@
 /*
  * Copyright (c) 2021 MediaTek Inc.
  */
+#include <linux/jump_label.h>
 #include <sched/pelt.h>
 
 #ifndef _EAS_PLUS_H
@@ -24,10 +25,12 @@ DECLARE_PER_CPU(unsigned long, min_freq);
 #define LB_BEST_ENERGY_CPU      (0x100)
 #define LB_MAX_SPARE_CPU        (0x200)
 #define LB_IN_INTERRUPT		(0x400)
+#define LB_BIGGER_IDLE_CPU	(0x800)
 #define LB_RT_FAIL      (0x1000)
 #define LB_RT_SYNC      (0x2000)
 #define LB_RT_IDLE      (0x4000)
 #define LB_RT_LOWEST_PRIO  (0x8000)
+#define LB_TICK_MISFIT     (0x10000)
 
 #ifdef CONFIG_SMP
 /*
@@ -52,6 +55,9 @@ extern void mtk_cpu_overutilized(void *data, int cpu, int *overutilized);
 extern unsigned long mtk_em_cpu_energy(struct em_perf_domain *pd,
 		unsigned long max_util, unsigned long sum_util, unsigned int *cpu_temp);
 extern unsigned int mtk_get_leakage(unsigned int cpu, unsigned int opp, unsigned int temperature);
+extern bool mtk_static_power_ready(void);
+extern int mtk_em_table_init(void);
+extern void mtk_em_table_refresh(int cpu);
 extern unsigned int new_idle_balance_interval_ns;
 #if IS_ENABLED(CONFIG_MTK_THERMAL_AWARE_SCHEDULING)
 extern int sort_thermal_headroom(struct cpumask *cpus, int *cpu_order);
@@ -86,6 +92,32 @@ extern void mtk_hook_after_enqueue_task(void *data, struct rq *rq,
 extern void mtk_select_task_rq_rt(void *data, struct task_struct *p, int cpu, int sd_flag,
 				int flags, int *target_cpu);
 extern int mtk_sched_asym_cpucapacity;
+
+#if IS_ENABLED(CONFIG_MTK_SCHED_PLACEMENT_REC)
+DECLARE_STATIC_KEY_FALSE(mtk_placement_rec_key);
+extern void __mtk_placement_record(struct task_struct *p, int reason, int prev_cpu,
+		int chosen_cpu, const struct cpumask *cands);
+extern int mtk_placement_rec_init(void);
+extern void mtk_placement_rec_exit(void);
+
+static inline bool mtk_placement_rec_enabled(void)
+{
+	return static_branch_unlikely(&mtk_placement_rec_key);
+}
+
+static inline void mtk_placement_record(struct task_struct *p, int reason,
+		int prev_cpu, int chosen_cpu, const struct cpumask *cands)
+{
+	if (mtk_placement_rec_enabled())
+		__mtk_placement_record(p, reason, prev_cpu, chosen_cpu, cands);
+}
+#else
+static inline bool mtk_placement_rec_enabled(void) { return false; }
+static inline void mtk_placement_record(struct task_struct *p, int reason,
+		int prev_cpu, int chosen_cpu, const struct cpumask *cands) { }
+static inline int mtk_placement_rec_init(void) { return 0; }
+static inline void mtk_placement_rec_exit(void) { }
+#endif
 #endif
 
 #ifdef CONFIG_SMP
@@ -374,6 +374,35 @@ TRACE_EVENT(sched_select_task_rq_rt,
 		__entry->act_mask)
 );
 
+#if IS_ENABLED(CONFIG_MTK_SCHED_PLACEMENT_REC)
+TRACE_EVENT(sched_placement,
+	TP_PROTO(pid_t pid, int reason, int prev_cpu, int chosen_cpu,
+		unsigned long cand_mask),
+	TP_ARGS(pid, reason, prev_cpu, chosen_cpu, cand_mask),
+	TP_STRUCT__entry(
+		__field(pid_t, pid)
+		__field(int, reason)
+		__field(int, prev_cpu)
+		__field(int, chosen_cpu)
+		__field(unsigned long, cand_mask)
+	),
+	TP_fast_assign(
+		__entry->pid = pid;
+		__entry->reason = reason;
+		__entry->prev_cpu = prev_cpu;
+		__entry->chosen_cpu = chosen_cpu;
+		__entry->cand_mask = cand_mask;
+	),
+	TP_printk(
+		"pid=%4d reason=0x%x prev=%d chosen=%d cand_mask=0x%lx",
+		__entry->pid,
+		__entry->reason,
+		__entry->prev_cpu,
+		__entry->chosen_cpu,
+		__entry->cand_mask)
+);
+#endif
+
 TRACE_EVENT(sched_next_update_thermal_headroom,
 	TP_PROTO(unsigned long now, unsigned long next_update_thermal),
 	TP_ARGS(now, next_update_thermal),
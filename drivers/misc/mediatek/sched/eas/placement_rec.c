@@ -0,0 +1,420 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+/*
+ * Placement recorder: every decision of select_bigger_idle_cpu(),
+ * mtk_select_task_rq_rt() and check_for_migration() is traced and, while
+ * recording is enabled, kept in a ring together with the candidate CPUs:
+ * their idle state, original capacity, utilization and the estimated
+ * energy cost of putting the task there.
+ *
+ * Writing a capacity margin to "replay" re-decides the recorded wakeups
+ * with fits_capacity() using that margin and reports how the picks, the
+ * estimated energy and the number of wakeups landing on a busy CPU would
+ * have changed.
+ *
+ *   /sys/kernel/debug/sched_placement/enable   0/1, clears the ring on 1
+ *   /sys/kernel/debug/sched_placement/records  recorded decisions
+ *   /sys/kernel/debug/sched_placement/replay   margin in, summary out
+ */
+
+#include <linux/debugfs.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <sched/sched.h>
+#include "eas_plus.h"
+#include "eas_trace.h"
+#if IS_ENABLED(CONFIG_MTK_THERMAL_INTERFACE)
+#include <thermal_interface.h>
+#endif
+
+#define PLACEMENT_REC_ENTRIES		1024
+#define PLACEMENT_REC_MAX_CANDS		8
+
+struct placement_cand {
+	s16 cpu;
+	u16 idle;
+	u16 cap_orig;
+	u16 util;
+	unsigned long energy;
+};
+
+struct placement_rec {
+	u64 time;
+	pid_t pid;
+	int reason;
+	s16 prev_cpu;
+	s16 chosen_cpu;
+	u16 task_util;
+	u16 nr_cands;
+	struct placement_cand cands[PLACEMENT_REC_MAX_CANDS];
+};
+
+struct placement_replay {
+	unsigned int margin;
+	unsigned int records;
+	unsigned int changed;
+	long energy_delta;
+	int busy_delta;
+};
+
+DEFINE_STATIC_KEY_FALSE(mtk_placement_rec_key);
+
+static DEFINE_RAW_SPINLOCK(placement_lock);
+static struct placement_rec *placement_ring;
+static unsigned int placement_head;
+static unsigned int placement_count;
+static DEFINE_MUTEX(placement_mutex);
+static struct placement_replay last_replay;
+static struct dentry *placement_debug_dir;
+
+/* energy added to @cpu's PD by @task_util, the way compute_energy sees it */
+static unsigned long placement_energy(int cpu, unsigned long task_util)
+{
+	struct em_perf_domain *pd = em_cpu_get(cpu);
+	unsigned long max_util = 0, sum_util = 0, util;
+	unsigned long energy_base, energy_cur;
+	unsigned int cpu_temp[NR_CPUS] = { 0 };
+	int i;
+
+	if (!pd)
+		return 0;
+
+	for_each_cpu(i, to_cpumask(pd->cpus)) {
+		util = cpu_util(i);
+		max_util = max(max_util, util);
+		sum_util += util;
+#if IS_ENABLED(CONFIG_MTK_THERMAL_INTERFACE)
+		cpu_temp[i] = get_cpu_temp(i) / 1000;
+#endif
+	}
+
+	energy_base = mtk_em_cpu_energy(pd, max_util, sum_util, cpu_temp);
+	max_util = max(max_util, cpu_util(cpu) + task_util);
+	energy_cur = mtk_em_cpu_energy(pd, max_util, sum_util + task_util,
+				       cpu_temp);
+
+	return energy_cur - energy_base;
+}
+
+void __mtk_placement_record(struct task_struct *p, int reason, int prev_cpu,
+		int chosen_cpu, const struct cpumask *cands)
+{
+	struct placement_rec rec;
+	unsigned long task_util;
+	unsigned long flags;
+	int cpu, n = 0;
+
+	trace_sched_placement(p->pid, reason, prev_cpu, chosen_cpu,
+			cpumask_bits(cands)[0]);
+
+	task_util = uclamp_task_util(p);
+
+	rec.time = sched_clock();
+	rec.pid = p->pid;
+	rec.reason = reason;
+	rec.prev_cpu = prev_cpu;
+	rec.chosen_cpu = chosen_cpu;
+	rec.task_util = task_util;
+
+	for_each_cpu_and(cpu, cands, p->cpus_ptr) {
+		struct placement_cand *c = &rec.cands[n];
+
+		if (!cpu_active(cpu))
+			continue;
+
+		c->cpu = cpu;
+		c->idle = idle_cpu(cpu);
+		c->cap_orig = capacity_orig_of(cpu);
+		c->util = cpu_util(cpu);
+		c->energy = placement_energy(cpu, task_util);
+
+		if (++n == PLACEMENT_REC_MAX_CANDS)
+			break;
+	}
+	rec.nr_cands = n;
+
+	raw_spin_lock_irqsave(&placement_lock, flags);
+	if (placement_ring) {
+		placement_ring[placement_head] = rec;
+		placement_head = (placement_head + 1) % PLACEMENT_REC_ENTRIES;
+		if (placement_count < PLACEMENT_REC_ENTRIES)
+			placement_count++;
+	}
+	raw_spin_unlock_irqrestore(&placement_lock, flags);
+}
+
+static struct placement_cand *
+placement_find_cand(struct placement_rec *rec, int cpu)
+{
+	int i;
+
+	for (i = 0; i < rec->nr_cands; i++) {
+		if (rec->cands[i].cpu == cpu)
+			return &rec->cands[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Pick under @margin: an idle CPU the task fits on, then any CPU it fits
+ * on, cheapest first; if it fits nowhere, the one with the most spare
+ * capacity.
+ */
+static struct placement_cand *
+placement_redecide(struct placement_rec *rec, unsigned int margin)
+{
+	struct placement_cand *c, *best = NULL, *spare = NULL;
+	long best_spare = LONG_MIN;
+	bool best_idle = false;
+	int i;
+
+	for (i = 0; i < rec->nr_cands; i++) {
+		unsigned long util;
+
+		c = &rec->cands[i];
+		util = c->util + rec->task_util;
+
+		if ((long)c->cap_orig - (long)util > best_spare) {
+			best_spare = (long)c->cap_orig - (long)util;
+			spare = c;
+		}
+
+		if (util * margin >= c->cap_orig * SCHED_CAPACITY_SCALE)
+			continue;
+
+		if (!best || (c->idle && !best_idle) ||
+		    (c->idle == best_idle && c->energy < best->energy)) {
+			best = c;
+			best_idle = c->idle;
+		}
+	}
+
+	return best ? best : spare;
+}
+
+static void placement_replay(struct placement_replay *r, unsigned int margin)
+{
+	struct placement_cand *old, *new;
+	struct placement_rec *rec;
+	unsigned int i, idx;
+
+	memset(r, 0, sizeof(*r));
+	r->margin = margin;
+
+	for (i = 0; i < placement_count; i++) {
+		idx = (placement_head + PLACEMENT_REC_ENTRIES - placement_count + i) %
+			PLACEMENT_REC_ENTRIES;
+		rec = &placement_ring[idx];
+
+		old = placement_find_cand(rec, rec->chosen_cpu);
+		new = placement_redecide(rec, margin);
+		if (!old || !new)
+			continue;
+
+		r->records++;
+		if (new == old)
+			continue;
+
+		r->changed++;
+		r->energy_delta += (long)new->energy - (long)old->energy;
+		r->busy_delta += !new->idle - !old->idle;
+	}
+}
+
+static int placement_enable_show(struct seq_file *m, void *unused)
+{
+	seq_printf(m, "%d\n", static_key_enabled(&mtk_placement_rec_key));
+
+	return 0;
+}
+
+static ssize_t placement_enable_write(struct file *flip,
+			const char __user *buffer, size_t count, loff_t *pos)
+{
+	struct placement_rec *ring = NULL;
+	unsigned long flags;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buffer, count, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&placement_mutex);
+	if (enable && !placement_ring) {
+		ring = vzalloc(array_size(PLACEMENT_REC_ENTRIES, sizeof(*ring)));
+		if (!ring) {
+			mutex_unlock(&placement_mutex);
+			return -ENOMEM;
+		}
+	}
+
+	raw_spin_lock_irqsave(&placement_lock, flags);
+	if (ring)
+		placement_ring = ring;
+	if (enable) {
+		placement_head = 0;
+		placement_count = 0;
+	}
+	raw_spin_unlock_irqrestore(&placement_lock, flags);
+
+	if (enable) {
+		static_branch_enable(&mtk_placement_rec_key);
+	} else {
+		static_branch_disable(&mtk_placement_rec_key);
+		/* recorders run with preemption off, let them drain */
+		synchronize_rcu();
+	}
+	mutex_unlock(&placement_mutex);
+
+	return count;
+}
+
+static int placement_records_show(struct seq_file *m, void *unused)
+{
+	struct placement_rec *rec;
+	unsigned int i, idx;
+	int j;
+
+	mutex_lock(&placement_mutex);
+	if (!placement_ring || static_key_enabled(&mtk_placement_rec_key)) {
+		seq_puts(m, "disable recording to read the records\n");
+		goto out;
+	}
+
+	seq_puts(m, "time pid reason prev chosen task_util cpu:idle:cap:util:energy...\n");
+	for (i = 0; i < placement_count; i++) {
+		idx = (placement_head + PLACEMENT_REC_ENTRIES - placement_count + i) %
+			PLACEMENT_REC_ENTRIES;
+		rec = &placement_ring[idx];
+
+		seq_printf(m, "%llu %d 0x%x %d %d %u", rec->time, rec->pid,
+			   rec->reason, rec->prev_cpu, rec->chosen_cpu,
+			   rec->task_util);
+		for (j = 0; j < rec->nr_cands; j++)
+			seq_printf(m, " %d:%u:%u:%u:%lu", rec->cands[j].cpu,
+				   rec->cands[j].idle, rec->cands[j].cap_orig,
+				   rec->cands[j].util, rec->cands[j].energy);
+		seq_putc(m, '\n');
+	}
+out:
+	mutex_unlock(&placement_mutex);
+
+	return 0;
+}
+
+static int placement_replay_show(struct seq_file *m, void *unused)
+{
+	struct placement_replay *r = &last_replay;
+
+	mutex_lock(&placement_mutex);
+	if (!r->margin) {
+		seq_puts(m, "no replay yet\n");
+	} else {
+		seq_printf(m, "margin=%u records=%u changed=%u\n",
+			   r->margin, r->records, r->changed);
+		seq_printf(m, "energy_delta=%ld busy_wakeups_delta=%d\n",
+			   r->energy_delta, r->busy_delta);
+	}
+	mutex_unlock(&placement_mutex);
+
+	return 0;
+}
+
+static ssize_t placement_replay_write(struct file *flip,
+			const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int margin;
+	int ret;
+
+	ret = kstrtouint_from_user(buffer, count, 0, &margin);
+	if (ret)
+		return ret;
+
+	if (margin < SCHED_CAPACITY_SCALE)
+		return -EINVAL;
+
+	mutex_lock(&placement_mutex);
+	/* the ring is only stable while nothing is recording */
+	if (!placement_ring || static_key_enabled(&mtk_placement_rec_key)) {
+		mutex_unlock(&placement_mutex);
+		return -EBUSY;
+	}
+	placement_replay(&last_replay, margin);
+	mutex_unlock(&placement_mutex);
+
+	return count;
+}
+
+#define PLACEMENT_DEBUGFS_ENTRY_RO(name) \
+static int placement_##name##_open(struct inode *i, struct file *file) \
+{ \
+	return single_open(file, placement_##name##_show, i->i_private); \
+} \
+\
+static const struct file_operations placement_##name##_fops = { \
+	.owner = THIS_MODULE, \
+	.open = placement_##name##_open, \
+	.read = seq_read, \
+	.llseek = seq_lseek, \
+	.release = single_release, \
+}
+
+#define PLACEMENT_DEBUGFS_ENTRY_RW(name) \
+static int placement_##name##_open(struct inode *i, struct file *file) \
+{ \
+	return single_open(file, placement_##name##_show, i->i_private); \
+} \
+\
+static const struct file_operations placement_##name##_fops = { \
+	.owner = THIS_MODULE, \
+	.open = placement_##name##_open, \
+	.read = seq_read, \
+	.write = placement_##name##_write, \
+	.llseek = seq_lseek, \
+	.release = single_release, \
+}
+
+PLACEMENT_DEBUGFS_ENTRY_RW(enable);
+PLACEMENT_DEBUGFS_ENTRY_RO(records);
+PLACEMENT_DEBUGFS_ENTRY_RW(replay);
+
+int mtk_placement_rec_init(void)
+{
+	placement_debug_dir = debugfs_create_dir("sched_placement", NULL);
+	if (IS_ERR_OR_NULL(placement_debug_dir)) {
+		pr_info("fail to create sched_placement debugfs\n");
+		return -ENOMEM;
+	}
+
+	debugfs_create_file("enable", 0640, placement_debug_dir, NULL,
+			    &placement_enable_fops);
+	debugfs_create_file("records", 0440, placement_debug_dir, NULL,
+			    &placement_records_fops);
+	debugfs_create_file("replay", 0640, placement_debug_dir, NULL,
+			    &placement_replay_fops);
+
+	return 0;
+}
+
+void mtk_placement_rec_exit(void)
+{
+	unsigned long flags;
+	struct placement_rec *ring;
+
+	static_branch_disable(&mtk_placement_rec_key);
+	synchronize_rcu();
+	debugfs_remove_recursive(placement_debug_dir);
+
+	raw_spin_lock_irqsave(&placement_lock, flags);
+	ring = placement_ring;
+	placement_ring = NULL;
+	raw_spin_unlock_irqrestore(&placement_lock, flags);
+	vfree(ring);
+}
@@ -159,6 +159,10 @@ static int __init mtk_scheduler_init(void)
 #if IS_ENABLED(CONFIG_MTK_EAS)
 	mtk_freq_limit_notifier_register();
 
+	ret = mtk_em_table_init();
+	if (ret)
+		pr_info("mtk_em_table_init failed, energy is computed at runtime\n");
+
 	ret = init_sram_info();
 	if (ret)
 		return ret;
@@ -226,6 +230,10 @@ static int __init mtk_scheduler_init(void)
 
 	mtk_sched_trace_init();
 
+#if IS_ENABLED(CONFIG_MTK_EAS)
+	mtk_placement_rec_init();
+#endif
+
 	return ret;
 
 }
@@ -233,6 +241,9 @@ static int __init mtk_scheduler_init(void)
 static void __exit mtk_scheduler_exit(void)
 {
 	mtk_sched_trace_exit();
+#if IS_ENABLED(CONFIG_MTK_EAS)
+	mtk_placement_rec_exit();
+#endif
 	unregister_trace_android_vh_scheduler_tick(hook_scheduler_tick, NULL);
 #if IS_ENABLED(CONFIG_MTK_SCHED_BIG_TASK_ROTATE)
 	unregister_trace_task_newtask(rotat_task_newtask, NULL);
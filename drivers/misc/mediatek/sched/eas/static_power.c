@@ -80,6 +80,11 @@ unsigned int mtk_get_leakage(unsigned int cpu, unsigned int opp, unsigned int te
 }
 EXPORT_SYMBOL_GPL(mtk_get_leakage);
 
+bool mtk_static_power_ready(void)
+{
+	return info.init == 0x5A5A;
+}
+
 #if __LKG_PROCFS__
 #define PROC_FOPS_RW(name)                                              \
 	static int name ## _proc_open(struct inode *inode, struct file *file)\
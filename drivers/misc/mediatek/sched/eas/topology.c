@@ -9,6 +9,7 @@
 #include <linux/slab.h>
 #include <sched/sched.h>
 #include <sugov/cpufreq.h>
+#include "eas_plus.h"
 
 MODULE_LICENSE("GPL");
 /*
@@ -68,7 +69,7 @@ static int freq_limit_max_notifier_call(struct notifier_block *nb,
 static int freq_limit_min_notifier_call(struct notifier_block *nb,
 					 unsigned long freq_limit_min, void *ptr)
 {
-	int cpu, policy_idx = nb - freq_limit_min_notifier;
+	int cpu, first_cpu = -1, policy_idx = nb - freq_limit_min_notifier;
 
 	if (policy_idx < 0 || policy_idx >= policy_num) {
 		pr_info("freq_limit_min_notifier_call: policy_idx over-index\n");
@@ -76,10 +77,16 @@ static int freq_limit_min_notifier_call(struct notifier_block *nb,
 	}
 
 	for_each_possible_cpu(cpu) {
-		if (per_cpu(policy_id_for_cpu, cpu) == policy_idx)
+		if (per_cpu(policy_id_for_cpu, cpu) == policy_idx) {
 			per_cpu(min_freq, cpu) = freq_limit_min;
+			if (first_cpu < 0)
+				first_cpu = cpu;
+		}
 	}
 
+	if (first_cpu >= 0)
+		mtk_em_table_refresh(first_cpu);
+
 	return 0;
 }
 
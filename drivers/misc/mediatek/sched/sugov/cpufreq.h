@@ -15,6 +15,8 @@
 #define CAPACITY_TBL_SIZE 0x100
 #define CAPACITY_ENTRY_SIZE 0x2
 
+#define SUGOV_PREDICT_RING 8
+
 struct pd_capacity_info {
 	int nr_caps;
 	unsigned int *util_opp;
@@ -27,6 +29,29 @@ struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		up_rate_limit_us;
 	unsigned int		down_rate_limit_us;
+	bool			predictive_rampup;
+};
+
+/*
+ * Periodic burst detector: start, length and peak util of the last
+ * bursts, and the period they follow once one is detected.
+ */
+struct sugov_predict {
+	u64			start[SUGOV_PREDICT_RING];
+	u64			len[SUGOV_PREDICT_RING];
+	unsigned long		peak[SUGOV_PREDICT_RING];
+	unsigned int		head;
+	unsigned int		nr;
+
+	bool			in_burst;
+	u64			burst_start;
+	unsigned long		burst_peak;
+
+	u64			period;
+	u64			burst_len;
+	unsigned long		burst_util;
+	u64			hold_until;
+	struct hrtimer		timer;
 };
 
 struct sugov_policy {
@@ -53,6 +78,9 @@ struct sugov_policy {
 
 	bool			limits_changed;
 	bool			need_freq_update;
+
+	bool			predict_enabled;
+	struct sugov_predict	predict;
 };
 
 #if IS_ENABLED(CONFIG_MTK_OPP_CAP_INFO)
@@ -68,4 +96,26 @@ extern unsigned int get_sched_capacity_margin_dvfs(void);
 #endif
 
 extern unsigned long pd_get_opp_capacity(int cpu, int opp);
+
+#if IS_ENABLED(CONFIG_MTK_OPP_CAP_INFO)
+extern unsigned int pd_get_capacity_freq(int cpu, unsigned long cap);
+
+extern int sugov_set_frame_deadline(struct task_struct *p, u64 budget_ns,
+				     u64 work_ns);
+extern void sugov_clear_frame_deadline(struct task_struct *p);
+extern unsigned long sugov_frame_cap(int cpu, unsigned long *frame_util);
+extern int init_frame_deadline(struct proc_dir_entry *dir);
+extern void clear_frame_deadline(void);
+#else
+static inline unsigned int pd_get_capacity_freq(int cpu, unsigned long cap)
+{
+	return 0;
+}
+static inline unsigned long sugov_frame_cap(int cpu, unsigned long *frame_util)
+{
+	return 0;
+}
+static inline int init_frame_deadline(struct proc_dir_entry *dir) { return 0; }
+static inline void clear_frame_deadline(void) { }
+#endif
 #endif /* __CPUFREQ_H__ */
@@ -29,6 +29,11 @@
 
 #define IOWAIT_BOOST_MIN	(SCHED_CAPACITY_SCALE / 8)
 
+#define PREDICT_MIN_BURSTS	4
+#define PREDICT_LEAD_NS		(2 * NSEC_PER_MSEC)
+#define PREDICT_MIN_PERIOD_NS	(4 * NSEC_PER_MSEC)
+#define PREDICT_MAX_PERIOD_NS	(100 * NSEC_PER_MSEC)
+
 struct sugov_cpu {
 	struct update_util_data	update_util;
 	struct sugov_policy	*sg_policy;
@@ -40,6 +45,8 @@ struct sugov_cpu {
 
 	unsigned long		bw_dl;
 	unsigned long		max;
+	/* capacity the frame deadlines of tasks on this CPU ask for */
+	unsigned long		frame_cap;
 
 	/* The field below is for single-CPU policies only: */
 #if IS_ENABLED(CONFIG_NO_HZ_COMMON)
@@ -193,6 +200,166 @@ static unsigned int get_next_freq(struct sugov_policy *sg_policy,
 	return freq;
 }
 
+/*
+ * Raise @freq to the lowest OPP whose capacity covers @cap, the
+ * utilization of the other tasks plus what the frame deadlines need.
+ * The deadline part is not given the DVFS margin, it is exact already.
+ */
+static unsigned int sugov_frame_freq(struct sugov_policy *sg_policy,
+				     unsigned int freq, unsigned long cap)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned int frame_freq;
+	int idx;
+
+	frame_freq = pd_get_capacity_freq(policy->cpu, cap);
+	frame_freq = clamp(frame_freq, policy->min, policy->max);
+	if (frame_freq <= freq)
+		return freq;
+
+	idx = cpufreq_frequency_table_target(policy, frame_freq,
+					     CPUFREQ_RELATION_L);
+	frame_freq = policy->freq_table[idx].frequency;
+	policy->cached_target_freq = frame_freq;
+	policy->cached_resolved_idx = idx;
+	sg_policy->cached_raw_freq = 0;
+
+	return frame_freq;
+}
+
+/************************ Predictive ramp-up ***********************/
+
+/*
+ * A burst starts when the policy's utilization rises above a quarter of
+ * its capacity and ends when it drops below an eighth. Once the last
+ * PREDICT_MIN_BURSTS starts are evenly spaced (within 1/8 of their mean
+ * interval), a pinned hrtimer raises the frequency to what the recent
+ * bursts peaked at PREDICT_LEAD_NS before the next one is due, and the
+ * peak util is held as a floor for the expected burst length. A burst
+ * that does not show up re-arms nothing, so prediction stops by itself.
+ */
+static void sugov_predict_commit(struct sugov_policy *sg_policy, u64 time,
+				 unsigned int next_freq)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+
+	/* the burst is due, the up rate limit does not apply */
+	if (policy->fast_switch_enabled) {
+		if (!cpufreq_this_cpu_can_update(policy))
+			return;
+
+		sg_policy->next_freq = next_freq;
+		sg_policy->last_freq_update_time = time;
+		next_freq = cpufreq_driver_fast_switch(policy, next_freq);
+		if (next_freq)
+			policy->cur = next_freq;
+		return;
+	}
+
+	sg_policy->next_freq = next_freq;
+	sg_policy->last_freq_update_time = time;
+	if (!sg_policy->work_in_progress) {
+		sg_policy->work_in_progress = true;
+		irq_work_queue(&sg_policy->irq_work);
+	}
+}
+
+static enum hrtimer_restart sugov_predict_timer(struct hrtimer *timer)
+{
+	struct sugov_predict *pr = container_of(timer, struct sugov_predict, timer);
+	struct sugov_policy *sg_policy = container_of(pr, struct sugov_policy, predict);
+	unsigned long max = arch_scale_cpu_capacity(sg_policy->policy->cpu);
+	u64 time = sched_clock();
+	unsigned int next_f;
+
+	raw_spin_lock(&sg_policy->update_lock);
+	if (pr->period) {
+		pr->hold_until = time + PREDICT_LEAD_NS + pr->burst_len;
+		next_f = get_next_freq(sg_policy, pr->burst_util, max);
+		if (next_f > sg_policy->next_freq)
+			sugov_predict_commit(sg_policy, time, next_f);
+	}
+	raw_spin_unlock(&sg_policy->update_lock);
+
+	return HRTIMER_NORESTART;
+}
+
+static void sugov_predict_detect(struct sugov_predict *pr, u64 time)
+{
+	u64 interval, sum = 0, len = 0, fire;
+	unsigned long peak = 0;
+	unsigned int i, cur, prev;
+
+	pr->start[pr->head] = pr->burst_start;
+	pr->len[pr->head] = time - pr->burst_start;
+	pr->peak[pr->head] = pr->burst_peak;
+	pr->head = (pr->head + 1) % SUGOV_PREDICT_RING;
+	if (pr->nr < SUGOV_PREDICT_RING)
+		pr->nr++;
+
+	pr->period = 0;
+	if (pr->nr < PREDICT_MIN_BURSTS)
+		return;
+
+	for (i = 0; i < PREDICT_MIN_BURSTS - 1; i++) {
+		cur = (pr->head + SUGOV_PREDICT_RING - 1 - i) % SUGOV_PREDICT_RING;
+		prev = (cur + SUGOV_PREDICT_RING - 1) % SUGOV_PREDICT_RING;
+		sum += pr->start[cur] - pr->start[prev];
+	}
+	interval = div_u64(sum, PREDICT_MIN_BURSTS - 1);
+	if (interval < PREDICT_MIN_PERIOD_NS || interval > PREDICT_MAX_PERIOD_NS)
+		return;
+
+	for (i = 0; i < PREDICT_MIN_BURSTS - 1; i++) {
+		u64 delta;
+
+		cur = (pr->head + SUGOV_PREDICT_RING - 1 - i) % SUGOV_PREDICT_RING;
+		prev = (cur + SUGOV_PREDICT_RING - 1) % SUGOV_PREDICT_RING;
+		delta = pr->start[cur] - pr->start[prev];
+		if (abs((s64)(delta - interval)) > (interval >> 3))
+			return;
+		len += pr->len[cur];
+		peak = max(peak, pr->peak[cur]);
+	}
+
+	pr->period = interval;
+	pr->burst_len = div_u64(len, PREDICT_MIN_BURSTS - 1);
+	pr->burst_util = peak;
+
+	fire = pr->burst_start + interval - PREDICT_LEAD_NS;
+	if (fire > time)
+		hrtimer_start(&pr->timer, ns_to_ktime(fire - time),
+			      HRTIMER_MODE_REL_PINNED);
+}
+
+static unsigned long sugov_predict_util(struct sugov_policy *sg_policy,
+					u64 time, unsigned long util,
+					unsigned long max)
+{
+	struct sugov_predict *pr = &sg_policy->predict;
+
+	if (!READ_ONCE(sg_policy->predict_enabled))
+		return util;
+
+	if (!pr->in_burst) {
+		if (util >= max >> 2) {
+			pr->in_burst = true;
+			pr->burst_start = time;
+			pr->burst_peak = util;
+		}
+	} else if (util < max >> 3) {
+		pr->in_burst = false;
+		sugov_predict_detect(pr, time);
+	} else {
+		pr->burst_peak = max(pr->burst_peak, util);
+	}
+
+	if (pr->period && time < pr->hold_until)
+		util = max(util, pr->burst_util);
+
+	return util;
+}
+
 /*
  * This function computes an effective utilization for the given CPU, to be
  * used for frequency selection given the linear relation: f = u * f_max.
@@ -313,10 +480,16 @@ static unsigned long sugov_get_util(struct sugov_cpu *sg_cpu)
 	struct rq *rq = cpu_rq(sg_cpu->cpu);
 	unsigned long util = cpu_util_cfs(rq);
 	unsigned long max = capacity_orig_of(sg_cpu->cpu);
+	unsigned long frame_util;
 
 	sg_cpu->max = max;
 	sg_cpu->bw_dl = cpu_bw_dl(rq);
 
+	/* frame tasks are accounted by their deadline, not their util */
+	sg_cpu->frame_cap = sugov_frame_cap(sg_cpu->cpu, &frame_util);
+	if (sg_cpu->frame_cap)
+		util -= min(util, frame_util);
+
 	spin_lock(&per_cpu(cpufreq_idle_cpu_lock, sg_cpu->cpu));
 	if (per_cpu(cpufreq_idle_cpu, sg_cpu->cpu)) {
 		spin_unlock(&per_cpu(cpufreq_idle_cpu_lock, sg_cpu->cpu));
@@ -584,6 +757,7 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	util = sugov_get_util(sg_cpu);
 	max = sg_cpu->max;
 	util = sugov_iowait_apply(sg_cpu, time, util, max);
+	util = sugov_predict_util(sg_policy, time, util, max);
 
 	if (trace_sugov_ext_util_enabled()) {
 		rq = cpu_rq(sg_cpu->cpu);
@@ -594,6 +768,9 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	}
 
 	next_f = get_next_freq(sg_policy, util, max);
+	if (sg_cpu->frame_cap)
+		next_f = sugov_frame_freq(sg_policy, next_f,
+					  util + sg_cpu->frame_cap);
 	/*
 	 * Do not reduce the frequency if the CPU has not been idle
 	 * recently, as the reduction is likely to be premature then.
@@ -625,8 +802,8 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 	struct cpufreq_policy *policy = sg_policy->policy;
 	struct rq *rq;
 	unsigned long umin, umax;
-	unsigned long util = 0, max = 1;
-	unsigned int j;
+	unsigned long util = 0, max = 1, frame_cap = 0;
+	unsigned int next_f, j;
 
 	for_each_cpu(j, policy->cpus) {
 		struct sugov_cpu *j_sg_cpu = &per_cpu(sugov_cpu, j);
@@ -648,9 +825,17 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 			util = j_util;
 			max = j_max;
 		}
+
+		if (j_sg_cpu->frame_cap)
+			frame_cap = max(frame_cap, j_util + j_sg_cpu->frame_cap);
 	}
 
-	return get_next_freq(sg_policy, util, max);
+	util = sugov_predict_util(sg_policy, time, util, max);
+	next_f = get_next_freq(sg_policy, util, max);
+	if (frame_cap)
+		next_f = sugov_frame_freq(sg_policy, next_f, frame_cap);
+
+	return next_f;
 }
 
 static void
@@ -799,12 +984,42 @@ down_rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t
 	return count;
 }
 
+static ssize_t predictive_rampup_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%d\n", tunables->predictive_rampup);
+}
+
+static ssize_t
+predictive_rampup_store(struct gov_attr_set *attr_set, const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	bool enable;
+
+	if (kstrtobool(buf, &enable))
+		return -EINVAL;
+
+	tunables->predictive_rampup = enable;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook) {
+		WRITE_ONCE(sg_policy->predict_enabled, enable);
+		if (!enable)
+			hrtimer_cancel(&sg_policy->predict.timer);
+	}
+
+	return count;
+}
+
 static struct governor_attr up_rate_limit_us = __ATTR_RW(up_rate_limit_us);
 static struct governor_attr down_rate_limit_us = __ATTR_RW(down_rate_limit_us);
+static struct governor_attr predictive_rampup = __ATTR_RW(predictive_rampup);
 
 static struct attribute *sugov_attrs[] = {
 	&up_rate_limit_us.attr,
 	&down_rate_limit_us.attr,
+	&predictive_rampup.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(sugov);
@@ -828,6 +1043,9 @@ static struct sugov_policy *sugov_policy_alloc(struct cpufreq_policy *policy)
 
 	sg_policy->policy = policy;
 	raw_spin_lock_init(&sg_policy->update_lock);
+	hrtimer_init(&sg_policy->predict.timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL_PINNED);
+	sg_policy->predict.timer.function = sugov_predict_timer;
 	return sg_policy;
 }
 
@@ -963,6 +1181,7 @@ static int sugov_init(struct cpufreq_policy *policy)
 
 	tunables->up_rate_limit_us = cpufreq_policy_transition_delay_us(policy);
 	tunables->down_rate_limit_us = cpufreq_policy_transition_delay_us(policy);
+	tunables->predictive_rampup = true;
 
 	policy->governor_data = sg_policy;
 	sg_policy->tunables = tunables;
@@ -1035,6 +1254,9 @@ static int sugov_start(struct cpufreq_policy *policy)
 	sg_policy->need_freq_update		= false;
 	sg_policy->cached_raw_freq		= 0;
 
+	memset(&sg_policy->predict, 0, offsetof(struct sugov_predict, timer));
+	sg_policy->predict_enabled = sg_policy->tunables->predictive_rampup;
+
 	for_each_cpu(cpu, policy->cpus) {
 		struct sugov_cpu *sg_cpu = &per_cpu(sugov_cpu, cpu);
 
@@ -1064,6 +1286,8 @@ static void sugov_stop(struct cpufreq_policy *policy)
 
 	synchronize_rcu();
 
+	hrtimer_cancel(&sg_policy->predict.timer);
+
 	if (!policy->fast_switch_enabled) {
 		irq_work_sync(&sg_policy->irq_work);
 		kthread_cancel_work_sync(&sg_policy->work);
@@ -1105,6 +1329,8 @@ static int __init cpufreq_mtk_init(void)
 	ret = init_opp_cap_info(dir);
 	if (ret)
 		return ret;
+
+	init_frame_deadline(dir);
 #if IS_ENABLED(CONFIG_NONLINEAR_FREQ_CTL)
 	ret = register_trace_android_vh_arch_set_freq_scale(
 			mtk_arch_set_freq_scale, NULL);
@@ -1117,6 +1343,7 @@ static int __init cpufreq_mtk_init(void)
 
 static void __exit cpufreq_mtk_exit(void)
 {
+	clear_frame_deadline();
 	clear_opp_cap_info();
 	cpufreq_unregister_governor(&mtk_gov);
 }
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+/*
+ * Frame deadlines: fpsgo (or a compositor through
+ * /proc/mtk_scheduler/frame_deadline) tells sugov how long a render task
+ * has until its frame is due and how much work is left, as run time at
+ * SCHED_CAPACITY_SCALE. While such a task is runnable, sugov replaces its
+ * utilization with the capacity that finishes the remaining work exactly
+ * at the deadline and picks the lowest OPP of the capacity table that
+ * provides it, instead of boosting on a utilization hint.
+ */
+
+#include <linux/kernel.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/task.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <sched/sched.h>
+#include "cpufreq.h"
+
+#define FRAME_TASKS		16
+/* a deadline stops applying this long after it passed */
+#define FRAME_GRACE_NS		(16 * NSEC_PER_MSEC)
+
+struct frame_task {
+	struct task_struct *p;
+	u64 deadline;
+	u64 work;
+	u64 exec_start;
+};
+
+static struct frame_task frame_tasks[FRAME_TASKS];
+static int nr_frame_tasks;
+static DEFINE_RAW_SPINLOCK(frame_lock);
+
+/**
+ * sugov_set_frame_deadline - register the frame deadline of a task
+ * @p:		the render task
+ * @budget_ns:	time left until the frame is due
+ * @work_ns:	remaining work, as run time at SCHED_CAPACITY_SCALE
+ *
+ * Replaces the previous deadline of @p. A reference on @p is held until
+ * sugov_clear_frame_deadline(), callers must clear before dropping @p.
+ *
+ * Return: 0 on success, -ENOSPC when all slots are in use.
+ */
+int sugov_set_frame_deadline(struct task_struct *p, u64 budget_ns, u64 work_ns)
+{
+	struct frame_task *ft, *slot = NULL;
+	unsigned long flags;
+	u64 now = sched_clock();
+	int i;
+
+	raw_spin_lock_irqsave(&frame_lock, flags);
+	for (i = 0; i < FRAME_TASKS; i++) {
+		ft = &frame_tasks[i];
+		if (ft->p == p) {
+			slot = ft;
+			break;
+		}
+		if (!ft->p && !slot)
+			slot = ft;
+	}
+
+	if (!slot) {
+		raw_spin_unlock_irqrestore(&frame_lock, flags);
+		return -ENOSPC;
+	}
+
+	if (!slot->p) {
+		get_task_struct(p);
+		slot->p = p;
+		WRITE_ONCE(nr_frame_tasks, nr_frame_tasks + 1);
+	}
+	slot->deadline = now + budget_ns;
+	slot->work = work_ns;
+	slot->exec_start = READ_ONCE(p->se.sum_exec_runtime);
+	raw_spin_unlock_irqrestore(&frame_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sugov_set_frame_deadline);
+
+void sugov_clear_frame_deadline(struct task_struct *p)
+{
+	struct task_struct *put = NULL;
+	unsigned long flags;
+	int i;
+
+	raw_spin_lock_irqsave(&frame_lock, flags);
+	for (i = 0; i < FRAME_TASKS; i++) {
+		if (frame_tasks[i].p == p) {
+			put = p;
+			frame_tasks[i].p = NULL;
+			WRITE_ONCE(nr_frame_tasks, nr_frame_tasks - 1);
+			break;
+		}
+	}
+	raw_spin_unlock_irqrestore(&frame_lock, flags);
+
+	if (put)
+		put_task_struct(put);
+}
+EXPORT_SYMBOL_GPL(sugov_clear_frame_deadline);
+
+/*
+ * Capacity the frame tasks runnable on @cpu need to meet their deadlines,
+ * and in @frame_util the utilization they account for in the CPU's util.
+ * Work done since registration is estimated from the run time at the
+ * CPU's current capacity.
+ */
+unsigned long sugov_frame_cap(int cpu, unsigned long *frame_util)
+{
+	unsigned long cap = 0, cap_curr;
+	struct frame_task *ft;
+	u64 now, ran, left;
+	int i;
+
+	*frame_util = 0;
+	if (likely(!READ_ONCE(nr_frame_tasks)))
+		return 0;
+
+	now = sched_clock();
+	cap_curr = arch_scale_cpu_capacity(cpu) *
+		   arch_scale_freq_capacity(cpu) >> SCHED_CAPACITY_SHIFT;
+
+	raw_spin_lock(&frame_lock);
+	for (i = 0; i < FRAME_TASKS; i++) {
+		ft = &frame_tasks[i];
+		if (!ft->p || task_cpu(ft->p) != cpu ||
+		    !task_on_rq_queued(ft->p))
+			continue;
+
+		if (now > ft->deadline + FRAME_GRACE_NS)
+			continue;
+
+		*frame_util += READ_ONCE(ft->p->se.avg.util_avg);
+
+		ran = READ_ONCE(ft->p->se.sum_exec_runtime) - ft->exec_start;
+		ran = ran * cap_curr >> SCHED_CAPACITY_SHIFT;
+		if (ran >= ft->work)
+			continue;
+		left = ft->work - ran;
+
+		/* late: whatever is left is needed right away */
+		if (now >= ft->deadline) {
+			cap += arch_scale_cpu_capacity(cpu);
+			continue;
+		}
+
+		cap += div64_u64(left * SCHED_CAPACITY_SCALE, ft->deadline - now);
+	}
+	raw_spin_unlock(&frame_lock);
+
+	return min(cap, arch_scale_cpu_capacity(cpu));
+}
+
+static int frame_deadline_show(struct seq_file *m, void *v)
+{
+	u64 now = sched_clock();
+	unsigned long flags;
+	int i;
+
+	raw_spin_lock_irqsave(&frame_lock, flags);
+	for (i = 0; i < FRAME_TASKS; i++) {
+		struct frame_task *ft = &frame_tasks[i];
+
+		if (!ft->p)
+			continue;
+
+		seq_printf(m, "pid=%d cpu=%d left_ns=%lld work_ns=%llu\n",
+			   ft->p->pid, task_cpu(ft->p),
+			   (s64)(ft->deadline - now), ft->work);
+	}
+	raw_spin_unlock_irqrestore(&frame_lock, flags);
+
+	return 0;
+}
+
+/* "<pid> <budget_us> <work_us>", a zero work clears the pid's deadline */
+static ssize_t frame_deadline_write(struct file *file, const char __user *ubuf,
+				    size_t count, loff_t *ppos)
+{
+	struct task_struct *p;
+	u64 budget_us, work_us;
+	char buf[64];
+	int pid, ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%d %llu %llu", &pid, &budget_us, &work_us) != 3)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_task_by_vpid(pid);
+	if (p)
+		get_task_struct(p);
+	rcu_read_unlock();
+	if (!p)
+		return -ESRCH;
+
+	if (work_us) {
+		ret = sugov_set_frame_deadline(p, budget_us * NSEC_PER_USEC,
+					       work_us * NSEC_PER_USEC);
+	} else {
+		sugov_clear_frame_deadline(p);
+		ret = 0;
+	}
+	put_task_struct(p);
+
+	return ret ? ret : count;
+}
+
+static int frame_deadline_open(struct inode *in, struct file *file)
+{
+	return single_open(file, frame_deadline_show, NULL);
+}
+
+static const struct proc_ops frame_deadline_ops = {
+	.proc_open = frame_deadline_open,
+	.proc_read = seq_read,
+	.proc_write = frame_deadline_write,
+	.proc_lseek = seq_lseek,
+	.proc_release = single_release,
+};
+
+int init_frame_deadline(struct proc_dir_entry *dir)
+{
+	struct proc_dir_entry *entry;
+
+	entry = proc_create("frame_deadline", 0664, dir, &frame_deadline_ops);
+	if (!entry)
+		pr_info("mtk_scheduler/frame_deadline entry create failed\n");
+
+	return 0;
+}
+
+void clear_frame_deadline(void)
+{
+	int i;
+
+	for (i = 0; i < FRAME_TASKS; i++) {
+		if (frame_tasks[i].p)
+			sugov_clear_frame_deadline(frame_tasks[i].p);
+	}
+}
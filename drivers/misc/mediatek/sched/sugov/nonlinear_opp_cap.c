@@ -39,6 +39,32 @@ unsigned long pd_get_opp_capacity(int cpu, int opp)
 }
 EXPORT_SYMBOL_GPL(pd_get_opp_capacity);
 
+/* frequency of the lowest OPP of @cpu's PD whose capacity is at least @cap */
+unsigned int pd_get_capacity_freq(int cpu, unsigned long cap)
+{
+	int i;
+	struct pd_capacity_info *pd_info;
+
+	if (!pd_capacity_tbl)
+		return 0;
+
+	for (i = 0; i < pd_count; i++) {
+		pd_info = &pd_capacity_tbl[i];
+
+		if (!cpumask_test_cpu(cpu, &pd_info->cpus))
+			continue;
+
+		if (!pd_info->util_freq)
+			return 0;
+
+		cap = min(cap, pd_info->caps[0]);
+		return pd_info->util_freq[cap];
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(pd_get_capacity_freq);
+
 static void free_capacity_table(void)
 {
 	int i;
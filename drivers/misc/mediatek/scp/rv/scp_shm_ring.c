@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+#include <linux/err.h>
+#include <linux/log2.h>
+#include <linux/notifier.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include "scp_ipi.h"
+#include "scp_helper.h"
+#include "scp_shm_ring.h"
+
+/* doorbell pin carries no payload, its msg_size must fit in here */
+#define SCP_SHM_RING_DOORBELL_SLOTS	4
+
+struct scp_shm_ring {
+	struct scp_shm_ring_hdr *hdr;
+	void *data;
+	unsigned int elem_size;
+	unsigned int nr_elem;
+	unsigned int ipi_id;
+	u32 tail;
+	unsigned int overrun;
+	spinlock_t lock;
+	scp_shm_ring_handler_t handler;
+	void *priv;
+	struct notifier_block nb;
+	u32 doorbell[SCP_SHM_RING_DOORBELL_SLOTS];
+};
+
+static void scp_shm_ring_reset(struct scp_shm_ring *ring)
+{
+	struct scp_shm_ring_hdr *hdr = ring->hdr;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	ring->tail = 0;
+	WRITE_ONCE(hdr->head, 0);
+	WRITE_ONCE(hdr->tail, 0);
+	WRITE_ONCE(hdr->dropped, 0);
+	WRITE_ONCE(hdr->elem_size, ring->elem_size);
+	WRITE_ONCE(hdr->nr_elem, ring->nr_elem);
+	WRITE_ONCE(hdr->notify, 1);
+	wmb(); /* header valid before scp sees the magic */
+	WRITE_ONCE(hdr->magic, SCP_SHM_RING_MAGIC);
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+
+/*
+ * Consume everything scp has produced, in as few callbacks as the
+ * wrap point allows. The doorbell is masked while draining and head is
+ * re-checked after unmasking, so an element published in between is
+ * never left behind without a doorbell.
+ */
+unsigned int scp_shm_ring_drain(struct scp_shm_ring *ring)
+{
+	struct scp_shm_ring_hdr *hdr = ring->hdr;
+	unsigned int total = 0;
+	unsigned long flags;
+	u32 head, tail, idx, n;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	tail = ring->tail;
+
+	for (;;) {
+		WRITE_ONCE(hdr->notify, 0);
+		head = READ_ONCE(hdr->head);
+		rmb(); /* read elements only after head */
+
+		if (head - tail > ring->nr_elem) {
+			/* producer overran us, skip to the oldest valid one */
+			ring->overrun++;
+			tail = head - ring->nr_elem;
+		}
+
+		while (tail != head) {
+			idx = tail & (ring->nr_elem - 1);
+			n = min(head - tail, ring->nr_elem - idx);
+			ring->handler(ring->priv,
+				ring->data + idx * ring->elem_size, n);
+			tail += n;
+			total += n;
+		}
+
+		mb(); /* done with the elements before giving them back */
+		WRITE_ONCE(hdr->tail, tail);
+		WRITE_ONCE(hdr->notify, 1);
+		mb(); /* unmask doorbell before re-checking head */
+		if (READ_ONCE(hdr->head) == tail)
+			break;
+	}
+
+	ring->tail = tail;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return total;
+}
+EXPORT_SYMBOL_GPL(scp_shm_ring_drain);
+
+static int scp_shm_ring_doorbell(unsigned int id, void *prdata, void *data,
+		unsigned int len)
+{
+	scp_shm_ring_drain(prdata);
+
+	return 0;
+}
+
+static int scp_shm_ring_notify(struct notifier_block *nb,
+		unsigned long event, void *ptr)
+{
+	struct scp_shm_ring *ring = container_of(nb, struct scp_shm_ring, nb);
+
+	if (event == SCP_EVENT_READY)
+		scp_shm_ring_reset(ring);
+
+	return NOTIFY_DONE;
+}
+
+/*
+ * Set up a scp -> ap ring in reserved memory block mem_id, notified
+ * through the receive ipi ipi_id. The ring keeps a power of two number
+ * of elem_size elements.
+ */
+struct scp_shm_ring *scp_shm_ring_create(enum scp_reserve_mem_id_t mem_id,
+		unsigned int ipi_id, unsigned int elem_size,
+		scp_shm_ring_handler_t handler, void *priv)
+{
+	struct scp_shm_ring *ring;
+	phys_addr_t virt, size;
+	int ret;
+
+	if (!handler || !elem_size || !IS_ALIGNED(elem_size, 4))
+		return ERR_PTR(-EINVAL);
+
+	virt = scp_get_reserve_mem_virt(mem_id);
+	size = scp_get_reserve_mem_size(mem_id);
+	if (!virt || size < sizeof(struct scp_shm_ring_hdr) + elem_size)
+		return ERR_PTR(-ENOMEM);
+
+	if (!mbox_check_recv_table(ipi_id))
+		return ERR_PTR(-ENODEV);
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return ERR_PTR(-ENOMEM);
+
+	spin_lock_init(&ring->lock);
+	ring->hdr = (struct scp_shm_ring_hdr *)(uintptr_t)virt;
+	ring->data = ring->hdr + 1;
+	ring->elem_size = elem_size;
+	ring->nr_elem = rounddown_pow_of_two((size - sizeof(*ring->hdr)) /
+			elem_size);
+	ring->ipi_id = ipi_id;
+	ring->handler = handler;
+	ring->priv = priv;
+	scp_shm_ring_reset(ring);
+
+	ret = mtk_ipi_register(&scp_ipidev, ipi_id,
+			(void *)scp_shm_ring_doorbell, ring, ring->doorbell);
+	if (ret != IPI_ACTION_DONE) {
+		pr_notice("[SCP] %s: ipi %u register fail %d\n",
+			__func__, ipi_id, ret);
+		kfree(ring);
+		return ERR_PTR(-EIO);
+	}
+
+	ring->nb.notifier_call = scp_shm_ring_notify;
+	scp_A_register_notify(&ring->nb);
+
+	pr_info("[SCP] shm ring mem %d ipi %u: %u x %u bytes\n",
+		mem_id, ipi_id, ring->nr_elem, elem_size);
+
+	return ring;
+}
+EXPORT_SYMBOL_GPL(scp_shm_ring_create);
+
+void scp_shm_ring_destroy(struct scp_shm_ring *ring)
+{
+	if (IS_ERR_OR_NULL(ring))
+		return;
+
+	WRITE_ONCE(ring->hdr->notify, 0);
+	WRITE_ONCE(ring->hdr->magic, 0);
+	scp_A_unregister_notify(&ring->nb);
+	mtk_ipi_unregister(&scp_ipidev, ring->ipi_id);
+	kfree(ring);
+}
+EXPORT_SYMBOL_GPL(scp_shm_ring_destroy);
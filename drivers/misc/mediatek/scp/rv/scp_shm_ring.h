@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+#ifndef _SCP_SHM_RING_H_
+#define _SCP_SHM_RING_H_
+
+#include <linux/types.h>
+#include "scp.h"
+
+#define SCP_SHM_RING_MAGIC	0x52494E47	/* "RING" */
+
+/*
+ * ring header at the start of the reserved memory block, shared with
+ * scp firmware. head/tail are free running element counters: scp only
+ * writes head and dropped, ap only writes tail and notify. scp raises
+ * the doorbell ipi only while notify is set.
+ */
+struct scp_shm_ring_hdr {
+	u32 magic;
+	u32 elem_size;
+	u32 nr_elem;
+	u32 notify;
+	u32 head;
+	u32 tail;
+	u32 dropped;
+	u32 reserved;
+};
+
+/*
+ * consumer callback, called with a contiguous span of nr elements that
+ * live in the shared memory itself; the span is handed back to scp
+ * once the callback returns.
+ */
+typedef void (*scp_shm_ring_handler_t)(void *priv, void *data,
+		unsigned int nr);
+
+struct scp_shm_ring;
+
+extern struct scp_shm_ring *scp_shm_ring_create(
+		enum scp_reserve_mem_id_t mem_id, unsigned int ipi_id,
+		unsigned int elem_size, scp_shm_ring_handler_t handler,
+		void *priv);
+extern void scp_shm_ring_destroy(struct scp_shm_ring *ring);
+extern unsigned int scp_shm_ring_drain(struct scp_shm_ring *ring);
+
+#endif
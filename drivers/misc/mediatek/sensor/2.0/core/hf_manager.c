@@ -19,6 +19,8 @@
 #include <uapi/linux/sched/types.h>
 #include <linux/sched_clock.h>
 #include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 #include "hf_manager.h"
 
@@ -103,6 +105,49 @@ static bool filter_event_by_timestamp(struct hf_client_fifo *hf_fifo,
 	return false;
 }
 
+/*
+ * Shared ring support, see struct hf_manager_ring_header.
+ * sync_tail and publish require the buffer lock to be held.
+ */
+static void hf_fifo_ring_sync_tail(struct hf_client_fifo *hf_fifo)
+{
+	unsigned int mask = hf_fifo->bufsize - 1;
+	unsigned int tail = 0;
+
+	if (!hf_fifo->ring)
+		return;
+
+	tail = READ_ONCE(hf_fifo->ring->tail) & mask;
+	if (tail == hf_fifo->tail)
+		return;
+	/* only accept a reader tail that stays within queued events */
+	if (((tail - hf_fifo->tail) & mask) <=
+			((hf_fifo->head - hf_fifo->tail) & mask)) {
+		hf_fifo->tail = tail;
+		hf_fifo->buffull = false;
+		hf_fifo->client_active = ktime_get_boottime_ns();
+	}
+}
+
+static void hf_fifo_ring_publish(struct hf_client_fifo *hf_fifo, bool tail)
+{
+	if (!hf_fifo->ring)
+		return;
+
+	if (tail)
+		WRITE_ONCE(hf_fifo->ring->tail, hf_fifo->tail);
+	/* events must be visible before the head that covers them */
+	smp_store_release(&hf_fifo->ring->head, hf_fifo->head);
+}
+
+static bool hf_fifo_has_event(struct hf_client_fifo *hf_fifo)
+{
+	if (hf_fifo->ring)
+		return (READ_ONCE(hf_fifo->ring->tail) &
+			(hf_fifo->bufsize - 1)) != READ_ONCE(hf_fifo->head);
+	return READ_ONCE(hf_fifo->head) != READ_ONCE(hf_fifo->tail);
+}
+
 static int hf_manager_report_event(struct hf_client *client,
 		struct hf_manager_event *event)
 {
@@ -113,6 +158,7 @@ static int hf_manager_report_event(struct hf_client *client,
 	struct hf_client_fifo *hf_fifo = &client->hf_fifo;
 
 	spin_lock_irqsave(&hf_fifo->buffer_lock, flags);
+	hf_fifo_ring_sync_tail(hf_fifo);
 	if (unlikely(hf_fifo->buffull == true)) {
 		hang_time = ktime_get_boottime_ns() - hf_fifo->hang_begin;
 		if (hang_time >= max_hang_time) {
@@ -120,6 +166,7 @@ static int hf_manager_report_event(struct hf_client *client,
 			hf_fifo->buffull = false;
 			hf_fifo->head = 0;
 			hf_fifo->tail = 0;
+			hf_fifo_ring_publish(hf_fifo, true);
 			pr_err_ratelimited("[%s][%d:%d] buffer reset %lld\n",
 				client->proc_comm, client->leader_pid,
 				client->ppid, hang_time);
@@ -152,6 +199,7 @@ static int hf_manager_report_event(struct hf_client *client,
 	}
 	hf_fifo->buffer[hf_fifo->head++] = *event;
 	hf_fifo->head &= hf_fifo->bufsize - 1;
+	hf_fifo_ring_publish(hf_fifo, false);
 	/* remain 1 count */
 	next = hf_fifo->head + 1;
 	next &= hf_fifo->bufsize - 1;
@@ -168,6 +216,16 @@ static int hf_manager_report_event(struct hf_client *client,
 	}
 	spin_unlock_irqrestore(&hf_fifo->buffer_lock, flags);
 
+	/*
+	 * a ring reader drains without syscalls and only wants a wakeup
+	 * once it announced it is going to sleep, pairs with the reader
+	 * setting waiting before it re-reads head.
+	 */
+	if (hf_fifo->ring) {
+		smp_mb();
+		if (!READ_ONCE(hf_fifo->ring->waiting))
+			return 0;
+	}
 	wake_up_interruptible(&hf_fifo->wait);
 	return 0;
 }
@@ -1042,7 +1100,10 @@ void hf_client_destroy(struct hf_client *client)
 	list_del(&client->list);
 	spin_unlock_irqrestore(&client->core->client_lock, flags);
 
-	kfree(client->hf_fifo.buffer);
+	if (client->hf_fifo.ring)
+		vfree(client->hf_fifo.ring);
+	else
+		kfree(client->hf_fifo.buffer);
 	kfree(client);
 }
 EXPORT_SYMBOL_GPL(hf_client_destroy);
@@ -1110,10 +1171,13 @@ static int fetch_next(struct hf_client_fifo *hf_fifo,
 	int have_event;
 
 	spin_lock_irqsave(&hf_fifo->buffer_lock, flags);
+	hf_fifo_ring_sync_tail(hf_fifo);
 	have_event = hf_fifo->head != hf_fifo->tail;
 	if (have_event) {
 		*event = hf_fifo->buffer[hf_fifo->tail++];
 		hf_fifo->tail &= hf_fifo->bufsize - 1;
+		if (hf_fifo->ring)
+			WRITE_ONCE(hf_fifo->ring->tail, hf_fifo->tail);
 		hf_fifo->buffull = false;
 		hf_fifo->client_active = ktime_get_boottime_ns();
 	}
@@ -1131,7 +1195,7 @@ int hf_client_poll_sensor_timeout(struct hf_client *client,
 
 	/* ret must be long to fill timeout(MAX_SCHEDULE_TIMEOUT) */
 	ret = wait_event_interruptible_timeout(hf_fifo->wait,
-		READ_ONCE(hf_fifo->head) != READ_ONCE(hf_fifo->tail), timeout);
+		hf_fifo_has_event(hf_fifo), timeout);
 
 	if (!ret)
 		return -ETIMEDOUT;
@@ -1139,7 +1203,7 @@ int hf_client_poll_sensor_timeout(struct hf_client *client,
 		return ret;
 
 	for (;;) {
-		if (READ_ONCE(hf_fifo->head) == READ_ONCE(hf_fifo->tail))
+		if (!hf_fifo_has_event(hf_fifo))
 			return 0;
 		if (count == 0)
 			break;
@@ -1198,7 +1262,7 @@ static ssize_t hf_manager_read(struct file *filp,
 		return -EINVAL;
 
 	for (;;) {
-		if (READ_ONCE(hf_fifo->head) == READ_ONCE(hf_fifo->tail))
+		if (!hf_fifo_has_event(hf_fifo))
 			return 0;
 		if (count == 0)
 			break;
@@ -1242,12 +1306,68 @@ static unsigned int hf_manager_poll(struct file *filp,
 
 	poll_wait(filp, &hf_fifo->wait, wait);
 
-	if (READ_ONCE(hf_fifo->head) != READ_ONCE(hf_fifo->tail))
+	if (hf_fifo_has_event(hf_fifo))
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
 }
 
+/*
+ * Map the client's shared event ring, switching the client over to it
+ * on first use. Events queued before that are carried over.
+ */
+static int hf_manager_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct hf_client *client = filp->private_data;
+	struct hf_client_fifo *hf_fifo = &client->hf_fifo;
+	struct hf_manager_ring_header *ring = NULL;
+	struct hf_manager_event *old = NULL, *buffer = NULL;
+	unsigned long flags;
+	unsigned int count = 0;
+	size_t size = PAGE_SIZE + PAGE_ALIGN(HF_MANAGER_RING_SIZE *
+		sizeof(struct hf_manager_event));
+
+	BUILD_BUG_ON(!is_power_of_2(HF_MANAGER_RING_SIZE) ||
+		HF_MANAGER_RING_SIZE < HF_CLIENT_FIFO_SIZE);
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != size)
+		return -EINVAL;
+
+	ring = vmalloc_user(size);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->version = HF_MANAGER_RING_VERSION;
+	ring->bufsize = HF_MANAGER_RING_SIZE;
+	ring->event_size = sizeof(struct hf_manager_event);
+	ring->data_offset = PAGE_SIZE;
+
+	spin_lock_irqsave(&hf_fifo->buffer_lock, flags);
+	if (!hf_fifo->ring) {
+		old = hf_fifo->buffer;
+		buffer = (void *)ring + PAGE_SIZE;
+		while (hf_fifo->tail != hf_fifo->head) {
+			buffer[count++] = old[hf_fifo->tail++];
+			hf_fifo->tail &= hf_fifo->bufsize - 1;
+		}
+		hf_fifo->buffer = buffer;
+		hf_fifo->bufsize = HF_MANAGER_RING_SIZE;
+		hf_fifo->head = count;
+		hf_fifo->tail = 0;
+		hf_fifo->buffull = false;
+		hf_fifo->ring = ring;
+		hf_fifo_ring_publish(hf_fifo, true);
+		ring = NULL;
+	}
+	spin_unlock_irqrestore(&hf_fifo->buffer_lock, flags);
+
+	/* lost the race against another mmap() of this client */
+	vfree(ring);
+	kfree(old);
+
+	return remap_vmalloc_range(vma, hf_fifo->ring, 0);
+}
+
 static long hf_manager_ioctl(struct file *filp,
 			unsigned int cmd, unsigned long arg)
 {
@@ -1340,6 +1460,7 @@ static const struct file_operations hf_manager_fops = {
 	.read           = hf_manager_read,
 	.write          = hf_manager_write,
 	.poll           = hf_manager_poll,
+	.mmap           = hf_manager_mmap,
 	.unlocked_ioctl = hf_manager_ioctl,
 	.compat_ioctl   = hf_manager_ioctl,
 };
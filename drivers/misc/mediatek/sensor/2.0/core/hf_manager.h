@@ -93,6 +93,7 @@ struct hf_client_fifo {
 	int64_t client_active;
 	int64_t last_time_stamp[SENSOR_TYPE_SENSOR_MAX];
 	struct hf_manager_event *buffer;
+	struct hf_manager_ring_header *ring; /* shared ring, once mmapped */
 	wait_queue_head_t wait;
 };
 
@@ -56,6 +56,28 @@ struct hf_manager_event {
 	};
 } __packed __aligned(4);
 
+/*
+ * mmap() of the hf_manager fd at offset 0 maps a shared event ring:
+ * this header in the first page followed by bufsize hf_manager_event
+ * slots at data_offset. The kernel stores events straight into the
+ * ring and advances head, the reader consumes [tail, head) and then
+ * stores tail. A reader about to sleep in poll() sets waiting and
+ * re-reads head, the kernel skips the wakeup while waiting is clear.
+ */
+#define HF_MANAGER_RING_VERSION 1
+#define HF_MANAGER_RING_SIZE    2048
+
+struct hf_manager_ring_header {
+	uint32_t version;
+	uint32_t bufsize;
+	uint32_t event_size;
+	uint32_t data_offset;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t waiting;
+	uint32_t reserved;
+} __packed __aligned(4);
+
 struct sensor_info {
 	uint8_t sensor_type;
 	uint8_t padding[3];
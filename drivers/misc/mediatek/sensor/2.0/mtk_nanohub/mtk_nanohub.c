@@ -116,6 +116,7 @@ static int mtk_nanohub_send_timestamp_to_hub(void);
 static int mtk_nanohub_server_dispatch_data(uint32_t *currWp);
 static int mtk_nanohub_report_to_manager(struct data_unit_t *data);
 static int mtk_nanohub_create_manager(void);
+static void mtk_nanohub_update_watermark(void);
 
 /* arch counter is 13M, mult is 161319385, shift is 21 */
 static inline uint64_t arch_counter_to_ns(uint64_t cyc)
@@ -230,8 +231,13 @@ static int mtk_nanohub_fetch_next_wp(uint32_t *currWp)
 
 	have_event = wp_queue->head != wp_queue->tail;
 	if (have_event) {
-		*currWp = wp_queue->ringbuffer[wp_queue->tail++];
-		wp_queue->tail &= wp_queue->bufsize - 1;
+		/*
+		 * wp is an absolute fifo offset, the newest one covers all
+		 * older ones, so drain once up to it instead of once per IPI.
+		 */
+		*currWp = wp_queue->ringbuffer[(wp_queue->head - 1) &
+			(wp_queue->bufsize - 1)];
+		wp_queue->tail = wp_queue->head;
 	}
 	spin_unlock_irq(&wp_queue->buffer_lock);
 	/* pr_err("head:%d, tail:%d, currWp:%d\n",
@@ -924,6 +930,7 @@ int mtk_nanohub_enable_to_hub(uint8_t sensor_id, int enabledisable)
 		return -1;
 	}
 	sensor_state[sensor_type].enable = enabledisable;
+	mtk_nanohub_update_watermark();
 	init_sensor_config_cmd(&cmd, sensor_type);
 	if (atomic_read(&power_status) == SENSOR_POWER_UP) {
 		ret = nanohub_external_write((const uint8_t *)&cmd,
@@ -937,6 +944,43 @@ int mtk_nanohub_enable_to_hub(uint8_t sensor_id, int enabledisable)
 	return ret < 0 ? ret : 0;
 }
 
+/*
+ * Let SCP coalesce notify IPIs: the watermark covers what enabled
+ * sensors produce within the shortest requested report latency, so no
+ * sensor is reported later than it asked for. Any sensor which asks for
+ * no batching keeps the per-push notify. Caller holds sensor_state_mtx.
+ */
+static void mtk_nanohub_update_watermark(void)
+{
+	struct mtk_nanohub_device *device = mtk_nanohub_dev;
+	struct sensor_fifo *fifo = READ_ONCE(device->scp_sensor_fifo);
+	uint64_t min_latency = U64_MAX, rate_sum = 0, events = 0;
+	uint32_t watermark = 0;
+	int i = 0;
+
+	if (!fifo)
+		return;
+
+	for (i = 0; i < SENSOR_TYPE_SENSOR_MAX; i++) {
+		if (!sensor_state[i].sensorType || !sensor_state[i].enable)
+			continue;
+		if (sensor_state[i].rate == SENSOR_RATE_ONCHANGE ||
+			sensor_state[i].rate == SENSOR_RATE_ONESHOT)
+			continue;
+		min_latency = min(min_latency, sensor_state[i].latency);
+		rate_sum += sensor_state[i].rate;
+	}
+	/* rate is in samples per 1024 seconds */
+	if (min_latency != U64_MAX && min_latency && rate_sum) {
+		events = mul_u64_u64_div_u64(min_latency, rate_sum,
+			1024000000000ULL);
+		events = min_t(uint64_t, events,
+			READ_ONCE(fifo->fifo_size) / SENSOR_DATA_SIZE / 2);
+		watermark = events * SENSOR_DATA_SIZE;
+	}
+	WRITE_ONCE(fifo->watermark, watermark);
+}
+
 int mtk_nanohub_batch_to_hub(uint8_t sensor_id,
 		int flag, int64_t samplingPeriodNs,
 		int64_t maxBatchReportLatencyNs)
@@ -964,6 +1008,7 @@ int mtk_nanohub_batch_to_hub(uint8_t sensor_id,
 		sensor_state[sensor_type].rate = rate;
 	}
 	sensor_state[sensor_type].latency = maxBatchReportLatencyNs;
+	mtk_nanohub_update_watermark();
 	init_sensor_config_cmd(&cmd, sensor_type);
 	if (atomic_read(&power_status) == SENSOR_POWER_UP) {
 		ret = nanohub_external_write((const uint8_t *)&cmd,
@@ -1777,6 +1822,9 @@ void mtk_nanohub_power_up_loop(void *data)
 		((long)scp_get_reserve_mem_size(SENS_MEM_ID) -
 			offsetof(struct sensor_fifo, data)) /
 				SENSOR_DATA_SIZE * SENSOR_DATA_SIZE);
+	mutex_lock(&sensor_state_mtx);
+	mtk_nanohub_update_watermark();
+	mutex_unlock(&sensor_state_mtx);
 	pr_debug("scp_sensor_fifo =%p, wp =%d, rp =%d, size =%d\n",
 		READ_ONCE(device->scp_sensor_fifo),
 		READ_ONCE(device->scp_sensor_fifo->wp),
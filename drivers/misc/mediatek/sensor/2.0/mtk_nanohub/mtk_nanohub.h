@@ -260,7 +260,11 @@ struct sensor_fifo {
 	uint32_t rp;
 	uint32_t wp;
 	uint32_t fifo_size;
-	uint32_t reserve;
+	/*
+	 * written by AP: pending bytes at which SCP raises SCP_FIFO_FULL,
+	 * 0 asks SCP to notify every direct push.
+	 */
+	uint32_t watermark;
 	struct data_unit_t data[0];
 };
 
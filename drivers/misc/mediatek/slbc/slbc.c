@@ -17,9 +17,14 @@
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 
 #include <slbc.h>
 
+#define CREATE_TRACE_POINTS
+#include "slbc_events.h"
+
 int slbc_enable;
 EXPORT_SYMBOL_GPL(slbc_enable);
 
@@ -50,6 +55,50 @@ char *slbc_uid_str[UID_MAX] = {
 };
 EXPORT_SYMBOL_GPL(slbc_uid_str);
 
+/*
+ * Per client usage: ways currently held and the EMI bandwidth the client
+ * reports as served by them. Way assignment itself is made by the SSPM
+ * policy, this only gives it and the tracer the benefit per way.
+ */
+struct slbc_client {
+	unsigned int ways;
+	unsigned int bw;
+	u64 since;
+	u64 held_ns;
+};
+
+static struct slbc_client slbc_clients[UID_MAX];
+static DEFINE_SPINLOCK(slbc_client_lock);
+
+static void slbc_client_update(unsigned int uid, int ways, int bw)
+{
+	struct slbc_client *c;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+	unsigned int cur_ways, cur_bw;
+	u64 held_ms;
+
+	if (uid >= UID_MAX)
+		return;
+
+	c = &slbc_clients[uid];
+
+	spin_lock_irqsave(&slbc_client_lock, flags);
+	if (c->ways)
+		c->held_ns += now - c->since;
+	c->since = now;
+	if (ways >= 0)
+		c->ways = ways;
+	if (bw >= 0)
+		c->bw = bw;
+	cur_ways = c->ways;
+	cur_bw = c->bw;
+	held_ms = div_u64(c->held_ns, NSEC_PER_MSEC);
+	spin_unlock_irqrestore(&slbc_client_lock, flags);
+
+	trace_slbc_client(slbc_uid_str[uid], cur_ways, cur_bw, held_ms);
+}
+
 /* bit count */
 int popcount(unsigned int x)
 {
@@ -85,19 +134,31 @@ EXPORT_SYMBOL_GPL(slbc_sram_write);
 
 int slbc_request(struct slbc_data *d)
 {
-	if (common_ops && common_ops->slbc_request)
-		return common_ops->slbc_request(d);
-	else
+	int ret;
+
+	if (!common_ops || !common_ops->slbc_request)
 		return -ENODEV;
+
+	ret = common_ops->slbc_request(d);
+	if (!ret)
+		slbc_client_update(d->uid, popcount(d->slot_used), -1);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(slbc_request);
 
 int slbc_release(struct slbc_data *d)
 {
-	if (common_ops && common_ops->slbc_release)
-		return common_ops->slbc_release(d);
-	else
+	int ret;
+
+	if (!common_ops || !common_ops->slbc_release)
 		return -ENODEV;
+
+	ret = common_ops->slbc_release(d);
+	if (!ret)
+		slbc_client_update(d->uid, 0, 0);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(slbc_release);
 
@@ -155,6 +216,34 @@ void slbc_update_mic_num(unsigned int num)
 }
 EXPORT_SYMBOL_GPL(slbc_update_mic_num);
 
+/* bw: EMI bandwidth in MB/s the client saves by running out of its ways */
+void slbc_update_client_bw(unsigned int uid, unsigned int bw)
+{
+	slbc_client_update(uid, -1, min_t(unsigned int, bw, INT_MAX));
+}
+EXPORT_SYMBOL_GPL(slbc_update_client_bw);
+
+/* EMI bandwidth saved per way held, 0 if the client holds none */
+unsigned int slbc_get_client_benefit(unsigned int uid)
+{
+	struct slbc_client *c;
+	unsigned int benefit = 0;
+	unsigned long flags;
+
+	if (uid >= UID_MAX)
+		return 0;
+
+	c = &slbc_clients[uid];
+
+	spin_lock_irqsave(&slbc_client_lock, flags);
+	if (c->ways)
+		benefit = c->bw / c->ways;
+	spin_unlock_irqrestore(&slbc_client_lock, flags);
+
+	return benefit;
+}
+EXPORT_SYMBOL_GPL(slbc_get_client_benefit);
+
 void slbc_register_common_ops(struct slbc_common_ops *ops)
 {
 	common_ops = ops;
@@ -55,6 +55,37 @@ TRACE_EVENT(slbc_data,
 		__entry->_data->pwr_ref)
 );
 
+TRACE_EVENT(slbc_client,
+	TP_PROTO(const char *_name,
+		unsigned int _ways,
+		unsigned int _bw,
+		u64 _held_ms),
+	TP_ARGS(_name,
+		_ways,
+		_bw,
+		_held_ms),
+	TP_STRUCT__entry(
+		__string(_name, _name)
+		__field(unsigned int, _ways)
+		__field(unsigned int, _bw)
+		__field(unsigned int, _benefit)
+		__field(u64, _held_ms)
+	),
+	TP_fast_assign(
+		__assign_str(_name, _name);
+		__entry->_ways = _ways;
+		__entry->_bw = _bw;
+		__entry->_benefit = _ways ? _bw / _ways : 0;
+		__entry->_held_ms = _held_ms;
+	),
+	TP_printk("%s ways=%u bw=%u benefit=%u held_ms=%llu",
+		__get_str(_name),
+		__entry->_ways,
+		__entry->_bw,
+		__entry->_benefit,
+		__entry->_held_ms)
+);
+
 #endif /* _TRACE_SLBC_EVENTS_H */
 
 /* This part must be outside protection */
@@ -142,6 +142,8 @@ extern void slbc_update_mm_bw(unsigned int bw);
 extern void slbc_update_mic_num(unsigned int num);
 extern void slbc_update_inner(unsigned int inner);
 extern void slbc_update_outer(unsigned int outer);
+extern void slbc_update_client_bw(unsigned int uid, unsigned int bw);
+extern unsigned int slbc_get_client_benefit(unsigned int uid);
 #else
 __attribute__ ((weak)) int slbc_request(struct slbc_data *d)
 {
@@ -171,6 +173,12 @@ __attribute__ ((weak)) void slbc_update_mm_bw(unsigned int bw) {}
 __attribute__ ((weak)) void slbc_update_mic_num(unsigned int num) {}
 __attribute__ ((weak)) void slbc_update_inner(unsigned int inner) {}
 __attribute__ ((weak)) void slbc_update_outer(unsigned int outer) {}
+__attribute__ ((weak)) void slbc_update_client_bw(unsigned int uid,
+		unsigned int bw) {}
+__attribute__ ((weak)) unsigned int slbc_get_client_benefit(unsigned int uid)
+{
+	return 0;
+};
 #endif /* CONFIG_MTK_SLBC */
 
 #endif /* _SLBC_OPS_H_ */
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+#ifndef __SWPM_TASK_ENERGY_H__
+#define __SWPM_TASK_ENERGY_H__
+
+#define SWPM_TASK_NR_CLUSTER		(4)
+#define SWPM_TASK_NR_ENTRY		(512)
+
+/* swpm interface to hand one log window of cpu power to task attribution
+ * cluster_mw: per cluster power in the order of cpufreq policies
+ * shared_mw:  power of cluster shared blocks (dsu, mcusys)
+ */
+extern void swpm_task_energy_update(const unsigned int *cluster_mw,
+				    unsigned int nr_cluster,
+				    unsigned int shared_mw,
+				    unsigned int interval_ms);
+
+/* swpm interface to create proc node "task_energy" */
+extern int swpm_task_energy_init(void);
+
+#endif
@@ -41,6 +41,7 @@
 #include <mtk_swpm_sysfs.h>
 #include <swpm_dbg_common_v1.h>
 #include <swpm_module.h>
+#include <swpm_task_energy.h>
 #include <swpm_v6983.h>
 #include <swpm_v6983_ext.h>
 
@@ -832,6 +833,7 @@ static void swpm_log_loop(struct timer_list *t)
 {
 	char *ptr = pwr_buf;
 	char *idx_ptr = idx_buf;
+	unsigned int *cpu_pwr;
 	int i;
 #ifdef LOG_LOOP_TIME_PROFILE
 	ktime_t t1, t2;
@@ -882,6 +884,13 @@ static void swpm_log_loop(struct timer_list *t)
 		/* snapshot the last completed average index data */
 		swpm_idx_snap();
 
+		/* charge the window cpu power to the tasks that ran in it */
+		cpu_pwr = share_idx_ref->cpu_idx.cpu_pwr;
+		swpm_task_energy_update(cpu_pwr, CPU_PWR_TYPE_DSU,
+					cpu_pwr[CPU_PWR_TYPE_DSU] +
+					cpu_pwr[CPU_PWR_TYPE_MCUSYS],
+					swpm_log_interval_ms);
+
 		/* set share sram clear flag and release lock */
 		share_idx_ctrl->clear_flag = 1;
 
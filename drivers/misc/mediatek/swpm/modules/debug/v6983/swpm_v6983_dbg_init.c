@@ -22,6 +22,7 @@
 #include <swpm_dbg_common_v1.h>
 #include <swpm_module.h>
 #include <swpm_module_ext.h>
+#include <swpm_task_energy.h>
 #include <swpm_v6983.h>
 #include <swpm_v6983_ext.h>
 
@@ -412,6 +413,7 @@ static void swpm_v6983_dbg_fs_init(void)
 			, 0644, &swpm_pmsr_en_fops, NULL, NULL);
 	mtk_swpm_sysfs_entry_func_node_add("core_static"
 			, 0644, &core_static_replace_fops, NULL, NULL);
+	swpm_task_energy_init();
 #if SWPM_EXT_DBG
 	mtk_swpm_sysfs_entry_func_node_add("swpm_sp_ddr_idx"
 			, 0444, &swpm_sp_ddr_idx_fops, NULL, NULL);
@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2021 MediaTek Inc.
+ */
+
+#include <linux/arch_topology.h>
+#include <linux/cgroup.h>
+#include <linux/cpufreq.h>
+#include <linux/cred.h>
+#include <linux/hash.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/spinlock.h>
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+#include <linux/uidgid.h>
+
+#include <mtk_swpm_common_sysfs.h>
+#include <swpm_module.h>
+#include <swpm_task_energy.h>
+
+/*
+ * Per task energy attribution.
+ *
+ * sched_switch charges every non-idle slice to the (uid, cgroup) of the
+ * task that ran, weighted by the cpu frequency scale so the charge is
+ * proportional to cycles. Each swpm log window the platform hands over
+ * the measured per cluster power; that energy is split between the
+ * entries by their share of the cluster cycles in the window, and the
+ * shared dsu/mcusys power by their share of all cycles.
+ *
+ * The table is fixed size and lives under a raw spinlock since it is
+ * updated from the scheduler; entries that do not fit are charged to
+ * slot 0, reported as uid -1.
+ */
+struct swpm_task_entry {
+	u32 uid;
+	u64 cgid;
+	bool valid;
+	u64 pending[SWPM_TASK_NR_CLUSTER];
+	u64 runtime_ns;
+	u64 energy_uj;
+};
+
+static DEFINE_RAW_SPINLOCK(te_lock);
+static struct swpm_task_entry te_tbl[SWPM_TASK_NR_ENTRY];
+static u64 te_pending_total[SWPM_TASK_NR_CLUSTER];
+static DEFINE_PER_CPU(u64, te_last_ns);
+static int te_cluster[NR_CPUS];
+static unsigned int te_enable;
+
+static void te_map_cluster(void)
+{
+	struct cpufreq_policy *policy;
+	int cpu, sib, cluster = 0;
+
+	for_each_possible_cpu(cpu)
+		te_cluster[cpu] = 0;
+
+	for_each_possible_cpu(cpu) {
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			continue;
+		if (cpu == cpumask_first(policy->related_cpus)) {
+			for_each_cpu(sib, policy->related_cpus)
+				te_cluster[sib] = MIN(cluster,
+						SWPM_TASK_NR_CLUSTER - 1);
+			cluster++;
+		}
+		cpufreq_cpu_put(policy);
+	}
+}
+
+static u64 te_task_cgid(struct task_struct *p)
+{
+#if IS_ENABLED(CONFIG_CGROUPS)
+	return cgroup_id(task_dfl_cgroup(p));
+#else
+	return 0;
+#endif
+}
+
+static struct swpm_task_entry *te_lookup(u32 uid, u64 cgid)
+{
+	struct swpm_task_entry *e;
+	unsigned int i, idx;
+
+	/* slot 0 is the overflow bucket, probe the others linearly */
+	idx = hash_64(((u64)uid << 32) ^ cgid, ilog2(SWPM_TASK_NR_ENTRY));
+	for (i = 0; i < SWPM_TASK_NR_ENTRY - 1; i++) {
+		e = &te_tbl[1 + (idx + i) % (SWPM_TASK_NR_ENTRY - 1)];
+		if (!e->valid) {
+			e->valid = true;
+			e->uid = uid;
+			e->cgid = cgid;
+			return e;
+		}
+		if (e->uid == uid && e->cgid == cgid)
+			return e;
+	}
+
+	return &te_tbl[0];
+}
+
+static void te_sched_switch(void *ignore, bool preempt,
+			    struct task_struct *prev,
+			    struct task_struct *next)
+{
+	struct swpm_task_entry *e;
+	int cpu = smp_processor_id();
+	int cluster = te_cluster[cpu];
+	u64 now = local_clock();
+	u64 last, delta, weight;
+	unsigned long flags;
+
+	last = per_cpu(te_last_ns, cpu);
+	per_cpu(te_last_ns, cpu) = now;
+
+	if (is_idle_task(prev) || !last)
+		return;
+
+	delta = now - last;
+	weight = delta * topology_get_freq_scale(cpu);
+
+	raw_spin_lock_irqsave(&te_lock, flags);
+	e = te_lookup(from_kuid_munged(&init_user_ns, task_uid(prev)),
+		      te_task_cgid(prev));
+	e->pending[cluster] += weight;
+	e->runtime_ns += delta;
+	te_pending_total[cluster] += weight;
+	raw_spin_unlock_irqrestore(&te_lock, flags);
+}
+
+void swpm_task_energy_update(const unsigned int *cluster_mw,
+			     unsigned int nr_cluster,
+			     unsigned int shared_mw,
+			     unsigned int interval_ms)
+{
+	struct swpm_task_entry *e;
+	u64 total = 0, sum, uj;
+	unsigned long flags;
+	int i, c;
+
+	if (!te_enable || !cluster_mw)
+		return;
+
+	nr_cluster = MIN(nr_cluster, SWPM_TASK_NR_CLUSTER);
+
+	raw_spin_lock_irqsave(&te_lock, flags);
+	for (c = 0; c < SWPM_TASK_NR_CLUSTER; c++)
+		total += te_pending_total[c];
+
+	for (i = 0; i < SWPM_TASK_NR_ENTRY; i++) {
+		e = &te_tbl[i];
+		if (!e->valid)
+			continue;
+
+		uj = 0;
+		sum = 0;
+		for (c = 0; c < SWPM_TASK_NR_CLUSTER; c++) {
+			/* mW * ms = uJ */
+			if (c < nr_cluster && te_pending_total[c])
+				uj += mul_u64_u64_div_u64(e->pending[c],
+					(u64)cluster_mw[c] * interval_ms,
+					te_pending_total[c]);
+			sum += e->pending[c];
+			e->pending[c] = 0;
+		}
+		if (total)
+			uj += mul_u64_u64_div_u64(sum,
+				(u64)shared_mw * interval_ms, total);
+		e->energy_uj += uj;
+	}
+
+	for (c = 0; c < SWPM_TASK_NR_CLUSTER; c++)
+		te_pending_total[c] = 0;
+	raw_spin_unlock_irqrestore(&te_lock, flags);
+}
+EXPORT_SYMBOL(swpm_task_energy_update);
+
+static struct tracepoint *te_tp;
+
+static void te_lookup_tracepoint(struct tracepoint *tp, void *ignore)
+{
+	if (!strcmp(tp->name, "sched_switch"))
+		te_tp = tp;
+}
+
+static void te_reset(void)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&te_lock, flags);
+	memset(te_tbl, 0, sizeof(te_tbl));
+	te_tbl[0].valid = true;
+	te_tbl[0].uid = (u32)-1;
+	memset(te_pending_total, 0, sizeof(te_pending_total));
+	raw_spin_unlock_irqrestore(&te_lock, flags);
+}
+
+static int te_set_enable(unsigned int enable)
+{
+	int cpu, ret = 0;
+
+	if (!!enable == te_enable)
+		return 0;
+
+	if (!te_tp)
+		for_each_kernel_tracepoint(te_lookup_tracepoint, NULL);
+	if (!te_tp)
+		return -ENODEV;
+
+	if (enable) {
+		te_map_cluster();
+		te_reset();
+		for_each_possible_cpu(cpu)
+			per_cpu(te_last_ns, cpu) = 0;
+		ret = tracepoint_probe_register(te_tp, te_sched_switch, NULL);
+		if (!ret)
+			te_enable = 1;
+	} else {
+		te_enable = 0;
+		tracepoint_probe_unregister(te_tp, te_sched_switch, NULL);
+		tracepoint_synchronize_unregister();
+	}
+
+	return ret;
+}
+
+#define te_log(fmt, args...) \
+	do { \
+		int l = scnprintf(p, sz, fmt, ##args); \
+		p += l; \
+		sz -= l; \
+	} while (0)
+
+static ssize_t task_energy_read(char *ToUser, size_t sz, void *priv)
+{
+	struct swpm_task_entry *e;
+	char *p = ToUser;
+	int i;
+
+	if (!ToUser)
+		return -EINVAL;
+
+	te_log("echo <0 or 1> > /proc/swpm/task_energy\n");
+	te_log("enable = %u\n", te_enable);
+	te_log("uid cgroup energy_uj runtime_ms\n");
+
+	/* racy snapshot is fine for a monotonic report */
+	for (i = 0; i < SWPM_TASK_NR_ENTRY && sz > 1; i++) {
+		e = &te_tbl[i];
+		if (!e->valid || !e->runtime_ns)
+			continue;
+		te_log("%d %llu %llu %llu\n", (int)e->uid, e->cgid,
+		       e->energy_uj, div_u64(e->runtime_ns, NSEC_PER_MSEC));
+	}
+
+	return p - ToUser;
+}
+
+static ssize_t task_energy_write(char *FromUser, size_t sz, void *priv)
+{
+	unsigned int enable;
+	int ret;
+
+	if (!FromUser)
+		return -EINVAL;
+
+	if (kstrtouint(FromUser, 0, &enable))
+		return -EINVAL;
+
+	swpm_lock(&swpm_mutex);
+	ret = te_set_enable(enable);
+	swpm_unlock(&swpm_mutex);
+
+	return ret ? ret : sz;
+}
+
+static const struct mtk_swpm_sysfs_op task_energy_fops = {
+	.fs_read = task_energy_read,
+	.fs_write = task_energy_write,
+};
+
+int swpm_task_energy_init(void)
+{
+	return mtk_swpm_sysfs_entry_func_node_add("task_energy",
+			0644, &task_energy_fops, NULL, NULL);
+}
+EXPORT_SYMBOL(swpm_task_energy_init);
@@ -14,6 +14,9 @@
 #include <linux/futex.h>
 #include <linux/plist.h>
 #include <linux/percpu-defs.h>
+#include <linux/irq_work.h>
+#include <linux/mutex.h>
+#include <linux/rtmutex.h>
 
 #include <trace/hooks/vendor_hooks.h>
 #include <trace/hooks/sched.h>
@@ -104,6 +107,8 @@ struct static_key sched_feat_keys[__SCHED_FEAT_NR] = {
 #define RWSEM_OWNER_FLAGS_MASK	(RWSEM_READER_OWNED | RWSEM_NONSPINNABLE)
 #define RWSEM_WRITER_LOCKED	(1UL << 0)
 #define RWSEM_WRITER_MASK	RWSEM_WRITER_LOCKED
+#define MUTEX_FLAGS		0x07
+#define RT_MUTEX_HAS_WAITERS	1UL
 
 DEFINE_PER_CPU(struct hmp_domain *, hmp_cpu_domain);
 DEFINE_PER_CPU(unsigned long, cpu_scale) = SCHED_CAPACITY_SCALE;
@@ -150,9 +155,13 @@ static inline void fillin_cluster(struct cluster_info *cinfo,
 static void sys_set_turbo_task(struct task_struct *p);
 static unsigned long capacity_of(int cpu);
 static void init_turbo_attr(struct task_struct *p);
+static void turbo_chain_unwind_work(struct irq_work *work);
 static inline unsigned long cpu_util(int cpu);
 static inline unsigned long task_util(struct task_struct *p);
 static inline unsigned long _task_util_est(struct task_struct *p);
+static void turbo_chain_start(void *lock, int type);
+static void turbo_chain_finish(void);
+static void turbo_chain_wakeup(struct task_struct *p);
 
 
 static void probe_android_rvh_prepare_prio_fork(void *ignore, struct task_struct *p)
@@ -268,6 +277,36 @@ static void probe_android_rvh_setscheduler(void *ignore, struct task_struct *p)
 	}
 }
 
+static void probe_android_vh_mutex_wait_start(void *ignore, struct mutex *lock)
+{
+	turbo_chain_start(lock, MUTEX_INHERIT);
+}
+
+static void probe_android_vh_mutex_wait_finish(void *ignore, struct mutex *lock)
+{
+	turbo_chain_finish();
+}
+
+static void probe_android_vh_rtmutex_wait_start(void *ignore, struct rt_mutex *lock)
+{
+	turbo_chain_start(lock, RTMUTEX_INHERIT);
+}
+
+static void probe_android_vh_rtmutex_wait_finish(void *ignore, struct rt_mutex *lock)
+{
+	turbo_chain_finish();
+}
+
+static void probe_android_vh_rwsem_wait_start(void *ignore, struct rw_semaphore *sem)
+{
+	turbo_chain_start(sem, RWSEM_INHERIT);
+}
+
+static void probe_android_vh_rwsem_wait_finish(void *ignore, struct rw_semaphore *sem)
+{
+	turbo_chain_finish();
+}
+
 static void probe_android_vh_rwsem_write_finished(void *ignore, struct rw_semaphore *sem)
 {
 	rwsem_stop_turbo_inherit(sem);
@@ -373,6 +412,11 @@ static void probe_android_vh_alter_futex_plist_add(void *ignore, struct plist_no
 	int prev_pid = 0;
 	bool prev_turbo = 1;
 
+	/* a PI waiter blocks on pi_state->pi_mutex right after queueing */
+	this = container_of(q_list, struct futex_q, list);
+	if (this->pi_state)
+		turbo_chain_start(&this->pi_state->pi_mutex, FUTEX_INHERIT);
+
 	if (!sub_feat_enable(SUB_FEAT_LOCK) &&
 	    !is_turbo_task(current)) {
 		*already_on_hb = false;
@@ -400,6 +444,7 @@ static void probe_android_rvh_select_task_rq_fair(void *ignore, struct task_stru
 							int prev_cpu, int sd_flag,
 							int wake_flags, int *target_cpu)
 {
+	turbo_chain_wakeup(p);
 	*target_cpu = select_turbo_cpu(p);
 }
 
@@ -861,6 +906,294 @@ static void binder_stop_turbo_inherit(struct task_struct *p)
 	trace_turbo_inherit_end(p);
 }
 
+/*
+ * Generic lock inheritance: a turbo task that blocks on a registered
+ * lock type boosts the owner, and the owner of whatever lock that owner
+ * is blocked on, up to turbo_chain_depth hops. Every task records the
+ * lock it waits for, turbo or not, so a chain can pass through tasks
+ * that were not turbo when they went to sleep.
+ */
+struct turbo_chain_stat {
+	atomic_t chains;
+	atomic_t depth_limited;
+	atomic_t depth[TURBO_CHAIN_MAX_DEPTH];
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
+static unsigned int turbo_chain_depth = TURBO_CHAIN_MAX_DEPTH;
+static const struct turbo_lock_type *turbo_lock_types[END_INHERIT];
+static struct turbo_chain_stat turbo_chain_stats[END_INHERIT];
+
+static struct task_struct *mutex_lock_owner(void *lock)
+{
+	struct mutex *mutex = lock;
+
+	return (struct task_struct *)
+		(atomic_long_read(&mutex->owner) & ~MUTEX_FLAGS);
+}
+
+static struct task_struct *rt_mutex_lock_owner(void *lock)
+{
+	struct rt_mutex *rt_mutex = lock;
+
+	return (struct task_struct *)
+		((unsigned long)READ_ONCE(rt_mutex->owner) & ~RT_MUTEX_HAS_WAITERS);
+}
+
+static struct task_struct *rwsem_lock_owner(void *lock)
+{
+	struct rw_semaphore *sem = lock;
+
+	/* readers are not tracked, there is no single owner to boost */
+	if (is_rwsem_reader_owned(sem))
+		return NULL;
+
+	return rwsem_owner(sem);
+}
+
+static const struct turbo_lock_type mutex_lock_type = {
+	.name = "mutex",
+	.owner = mutex_lock_owner,
+};
+
+static const struct turbo_lock_type rt_mutex_lock_type = {
+	.name = "rt_mutex",
+	.owner = rt_mutex_lock_owner,
+};
+
+/* the lock is pi_state->pi_mutex, which futex_lock_pi() sleeps on */
+static const struct turbo_lock_type futex_pi_lock_type = {
+	.name = "futex_pi",
+	.owner = rt_mutex_lock_owner,
+	.end_on_wakeup = true,
+};
+
+/* rwsem writers keep rwsem_start_turbo_inherit(), chains only pass it */
+static const struct turbo_lock_type rwsem_lock_type = {
+	.name = "rwsem",
+	.owner = rwsem_lock_owner,
+	.hop_only = true,
+};
+
+static int register_turbo_lock_type(int type, const struct turbo_lock_type *lt)
+{
+	if (type <= START_INHERIT || type >= END_INHERIT || !lt->owner)
+		return -EINVAL;
+
+	if (turbo_lock_types[type])
+		return -EBUSY;
+
+	turbo_lock_types[type] = lt;
+	return 0;
+}
+
+static inline bool inherit_types_full(struct task_struct *task, int type)
+{
+	struct task_turbo_t *turbo_data = get_task_turbo_t(task);
+
+	return get_value_with_type(atomic_read(&turbo_data->inherit_types), type) ==
+		get_value_with_type(~0U, type);
+}
+
+static void turbo_set_blocked_on(struct task_struct *p, void *lock, int type)
+{
+	struct turbo_chain *chain = &get_task_turbo_t(p)->chain;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	chain->blocked_on = lock;
+	chain->blocked_type = type;
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+}
+
+static void turbo_chain_account(int type, int depth, u64 delta)
+{
+	struct turbo_chain_stat *stat = &turbo_chain_stats[type];
+	s64 max = atomic64_read(&stat->max_ns);
+
+	atomic_inc(&stat->chains);
+	atomic_inc(&stat->depth[depth - 1]);
+	atomic64_add(delta, &stat->total_ns);
+	while (delta > max) {
+		s64 old = atomic64_cmpxchg(&stat->max_ns, max, delta);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static void turbo_chain_unwind(struct turbo_chain *chain)
+{
+	struct task_struct *owner;
+	int i;
+
+	turbo_chain_account(chain->type, chain->depth,
+			ktime_get_ns() - chain->wait_start);
+
+	for (i = 0; i < chain->depth; i++) {
+		owner = chain->boosted[i];
+		if (!owner)
+			continue;
+
+		if (is_inherit_turbo(owner, chain->type))
+			stop_turbo_inherit(owner, chain->type);
+		trace_turbo_inherit_end(owner);
+		put_task_struct(owner);
+		chain->boosted[i] = NULL;
+	}
+	chain->depth = 0;
+	atomic_set(&chain->state, TURBO_CHAIN_IDLE);
+}
+
+static void turbo_chain_unwind_work(struct irq_work *work)
+{
+	struct turbo_chain *chain =
+		container_of(work, struct turbo_chain, unwind_work);
+	struct task_turbo_t *turbo_data =
+		container_of(chain, struct task_turbo_t, chain);
+	struct task_struct *p = container_of((void *)turbo_data,
+			struct task_struct, android_vendor_data1);
+
+	turbo_chain_unwind(chain);
+	put_task_struct(p);
+}
+
+static void turbo_chain_start(void *lock, int type)
+{
+	const struct turbo_lock_type *lt = turbo_lock_types[type];
+	struct task_turbo_t *turbo_data = get_task_turbo_t(current);
+	struct turbo_chain *chain = &turbo_data->chain;
+	struct task_struct *owner, *next;
+	struct turbo_chain *owner_chain;
+	unsigned long flags;
+	int depth = 0, i;
+
+	if (!lt)
+		return;
+
+	/*
+	 * Without a wait_finish hook blocked_on could outlive the lock,
+	 * so such a type is never walked through.
+	 */
+	turbo_set_blocked_on(current, lt->end_on_wakeup ? NULL : lock, type);
+
+	/*
+	 * A futex chain whose wakeup was not seen (the waiter is pinned
+	 * to one CPU and skipped select_task_rq) is stale by now.
+	 */
+	if (atomic_read(&chain->state) == TURBO_CHAIN_ACTIVE &&
+	    turbo_lock_types[chain->type]->end_on_wakeup &&
+	    atomic_cmpxchg(&chain->state, TURBO_CHAIN_ACTIVE,
+			TURBO_CHAIN_UNWIND) == TURBO_CHAIN_ACTIVE)
+		turbo_chain_unwind(chain);
+
+	if (lt->hop_only || !sub_feat_enable(SUB_FEAT_LOCK))
+		return;
+
+	/* an RT waiter already gets real PI, and misses the wakeup hook */
+	if (lt->end_on_wakeup && !fair_policy(current->policy))
+		return;
+
+	if (!should_set_inherit_turbo(current))
+		return;
+
+	/* previous futex chain not unwound yet, sit this one out */
+	if (atomic_cmpxchg(&chain->state, TURBO_CHAIN_IDLE,
+			TURBO_CHAIN_ACTIVE) != TURBO_CHAIN_IDLE)
+		return;
+
+	chain->type = type;
+	chain->wait_start = ktime_get_ns();
+	/* tasks forked before the module was loaded */
+	if (unlikely(!chain->unwind_work.func))
+		init_irq_work(&chain->unwind_work, turbo_chain_unwind_work);
+
+	rcu_read_lock();
+	owner = lt->owner(lock);
+	while (owner && depth < turbo_chain_depth &&
+	       turbo_data->inherit_cnt + depth < INHERIT_THRESHOLD) {
+		/* a lock cycle is a deadlock, do not spin on it */
+		if (owner == current)
+			break;
+		for (i = 0; i < depth; i++)
+			if (chain->boosted[i] == owner)
+				break;
+		if (i < depth)
+			break;
+
+		get_task_struct(owner);
+		chain->boosted[depth++] = owner;
+
+		next = NULL;
+		owner_chain = &get_task_turbo_t(owner)->chain;
+		raw_spin_lock_irqsave(&owner->pi_lock, flags);
+		if (owner_chain->blocked_on &&
+		    turbo_lock_types[owner_chain->blocked_type])
+			next = turbo_lock_types[owner_chain->blocked_type]->owner(
+					owner_chain->blocked_on);
+		raw_spin_unlock_irqrestore(&owner->pi_lock, flags);
+		owner = next;
+	}
+	rcu_read_unlock();
+
+	if (owner && owner != current && depth == turbo_chain_depth)
+		atomic_inc(&turbo_chain_stats[type].depth_limited);
+
+	chain->depth = depth;
+	if (!depth) {
+		atomic_set(&chain->state, TURBO_CHAIN_IDLE);
+		return;
+	}
+
+	for (i = 0; i < depth; i++) {
+		owner = chain->boosted[i];
+		if (is_turbo_task(owner) || inherit_types_full(owner, type)) {
+			put_task_struct(owner);
+			chain->boosted[i] = NULL;
+			continue;
+		}
+
+		start_turbo_inherit(owner, type, turbo_data->inherit_cnt + i);
+		trace_turbo_inherit_chain(current, owner, type, i + 1);
+	}
+}
+
+static void turbo_chain_finish(void)
+{
+	struct turbo_chain *chain = &get_task_turbo_t(current)->chain;
+
+	turbo_set_blocked_on(current, NULL, START_INHERIT);
+
+	if (atomic_cmpxchg(&chain->state, TURBO_CHAIN_ACTIVE,
+			TURBO_CHAIN_UNWIND) == TURBO_CHAIN_ACTIVE)
+		turbo_chain_unwind(chain);
+}
+
+/*
+ * Called from the wakeup path of a sleeping task with p->pi_lock held,
+ * so the owners can not be re-niced here; hand the unwind to an
+ * irq_work instead.
+ */
+static void turbo_chain_wakeup(struct task_struct *p)
+{
+	struct turbo_chain *chain = &get_task_turbo_t(p)->chain;
+
+	if (atomic_read(&chain->state) != TURBO_CHAIN_ACTIVE)
+		return;
+
+	if (!turbo_lock_types[chain->type]->end_on_wakeup)
+		return;
+
+	if (atomic_cmpxchg(&chain->state, TURBO_CHAIN_ACTIVE,
+			TURBO_CHAIN_UNWIND) != TURBO_CHAIN_ACTIVE)
+		return;
+
+	get_task_struct(p);
+	irq_work_queue(&chain->unwind_work);
+}
+
 static bool is_inherit_turbo(struct task_struct *task, int type)
 {
 	unsigned int inherit_types;
@@ -921,6 +1254,10 @@ static void init_turbo_attr(struct task_struct *p)
 	turbo_data->render = 0;
 	atomic_set(&(turbo_data->inherit_types), 0);
 	turbo_data->inherit_cnt = 0;
+	/* drop the copy of the parent's chain, it holds no references */
+	memset(&turbo_data->chain, 0, sizeof(turbo_data->chain));
+	turbo_data->chain.blocked_type = START_INHERIT;
+	init_irq_work(&turbo_data->chain.unwind_work, turbo_chain_unwind_work);
 }
 
 int get_turbo_feats(void)
@@ -1112,6 +1449,67 @@ module_param_cb(unset_turbo_pid, &unset_turbo_pid_param_ops,
 		&unset_turbo_pid_param, 0644);
 MODULE_PARM_DESC(unset_turbo_pid, "unset turbo task by pid");
 
+static int set_chain_depth(const char *buf, const struct kernel_param *kp)
+{
+	unsigned int val;
+	int retval;
+
+	retval = kstrtouint(buf, 0, &val);
+	if (retval)
+		return retval;
+
+	if (val < 1 || val > TURBO_CHAIN_MAX_DEPTH)
+		return -EINVAL;
+
+	WRITE_ONCE(turbo_chain_depth, val);
+	return 0;
+}
+
+static struct kernel_param_ops chain_depth_param_ops = {
+	.set = set_chain_depth,
+	.get = param_get_uint,
+};
+
+param_check_uint(chain_depth, &turbo_chain_depth);
+module_param_cb(chain_depth, &chain_depth_param_ops, &turbo_chain_depth, 0644);
+MODULE_PARM_DESC(chain_depth, "max owners boosted along one lock chain");
+
+static int get_chain_stats(char *buf, const struct kernel_param *kp)
+{
+	const struct turbo_lock_type *lt;
+	struct turbo_chain_stat *stat;
+	int type, i, chains, len = 0;
+	u64 avg;
+
+	for (type = 0; type < END_INHERIT; type++) {
+		lt = turbo_lock_types[type];
+		if (!lt || lt->hop_only)
+			continue;
+
+		stat = &turbo_chain_stats[type];
+		chains = atomic_read(&stat->chains);
+		avg = chains ? div64_u64(atomic64_read(&stat->total_ns), chains) : 0;
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+			"%s chains=%d avg_us=%llu max_us=%llu depth_limited=%d depth=",
+			lt->name, chains, avg / NSEC_PER_USEC,
+			(u64)atomic64_read(&stat->max_ns) / NSEC_PER_USEC,
+			atomic_read(&stat->depth_limited));
+		for (i = 0; i < TURBO_CHAIN_MAX_DEPTH; i++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%d%c",
+				atomic_read(&stat->depth[i]),
+				i == TURBO_CHAIN_MAX_DEPTH - 1 ? '\n' : '/');
+	}
+
+	return len;
+}
+
+static struct kernel_param_ops chain_stats_param_ops = {
+	.get = get_chain_stats,
+};
+
+module_param_cb(chain_stats, &chain_stats_param_ops, NULL, 0444);
+MODULE_PARM_DESC(chain_stats, "lock chain count, wait latency and depth per lock type");
+
 static inline int get_st_group_id(struct task_struct *task)
 {
 #if IS_ENABLED(CONFIG_CGROUP_SCHED)
@@ -1387,6 +1785,15 @@ static int __init init_task_turbo(void)
 {
 	int ret, ret_erri_line;
 
+	BUILD_BUG_ON(sizeof(struct task_turbo_t) >
+		     sizeof_field(struct task_struct, android_vendor_data1));
+	BUILD_BUG_ON(END_INHERIT * 4 > 32);
+
+	register_turbo_lock_type(RWSEM_INHERIT, &rwsem_lock_type);
+	register_turbo_lock_type(MUTEX_INHERIT, &mutex_lock_type);
+	register_turbo_lock_type(RTMUTEX_INHERIT, &rt_mutex_lock_type);
+	register_turbo_lock_type(FUTEX_INHERIT, &futex_pi_lock_type);
+
 	ret = register_trace_android_rvh_rtmutex_prepare_setprio(
 			probe_android_rvh_rtmutex_prepare_setprio, NULL);
 	if (ret) {
@@ -1480,6 +1887,62 @@ static int __init init_task_turbo(void)
 		goto failed;
 	}
 
+	ret = register_trace_android_vh_mutex_wait_start(
+			probe_android_vh_mutex_wait_start, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_mutex_wait_finish(
+			probe_android_vh_mutex_wait_finish, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rtmutex_wait_start(
+			probe_android_vh_rtmutex_wait_start, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rtmutex_wait_finish(
+			probe_android_vh_rtmutex_wait_finish, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rwsem_read_wait_start(
+			probe_android_vh_rwsem_wait_start, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rwsem_read_wait_finish(
+			probe_android_vh_rwsem_wait_finish, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rwsem_write_wait_start(
+			probe_android_vh_rwsem_wait_start, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
+	ret = register_trace_android_vh_rwsem_write_wait_finish(
+			probe_android_vh_rwsem_wait_finish, NULL);
+	if (ret) {
+		ret_erri_line = __LINE__;
+		goto failed;
+	}
+
 	ret = register_trace_android_vh_alter_futex_plist_add(
 			probe_android_vh_alter_futex_plist_add, NULL);
 	if (ret) {
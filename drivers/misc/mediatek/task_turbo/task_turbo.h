@@ -7,6 +7,7 @@
 
 #include <linux/list.h>
 #include <linux/smp.h>
+#include <linux/irq_work.h>
 
 #define get_task_turbo_t(p)	\
 	((struct task_turbo_t *)&(p)->android_vendor_data1)
@@ -19,9 +20,51 @@ enum {
 	START_INHERIT = -1,
 	RWSEM_INHERIT = 0,
 	BINDER_INHERIT,
+	MUTEX_INHERIT,
+	RTMUTEX_INHERIT,
+	FUTEX_INHERIT,
 	END_INHERIT,
 };
 
+#define TURBO_CHAIN_MAX_DEPTH	4
+
+enum {
+	TURBO_CHAIN_IDLE,
+	TURBO_CHAIN_ACTIVE,
+	TURBO_CHAIN_UNWIND,
+};
+
+/*
+ * A lock type the inheritance engine can walk through. owner() returns
+ * the task currently holding @lock; it is called with the wait_lock of
+ * @lock or the pi_lock of a task blocked on @lock held, so the lock
+ * itself cannot go away underneath it.
+ */
+struct turbo_lock_type {
+	const char *name;
+	struct task_struct *(*owner)(void *lock);
+	/* only hop through it, the type has its own boost path */
+	bool hop_only;
+	/* no wait_finish hook, drop the chain when the waiter wakes */
+	bool end_on_wakeup;
+};
+
+/*
+ * Inheritance chain started by a task while it is blocked on a lock.
+ * blocked_on is written by the task itself under its pi_lock, so a
+ * walker holding that pi_lock sees a lock that is still alive.
+ */
+struct turbo_chain {
+	void *blocked_on;
+	int blocked_type;
+	atomic_t state;
+	int type;
+	int depth;
+	u64 wait_start;
+	struct task_struct *boosted[TURBO_CHAIN_MAX_DEPTH];
+	struct irq_work unwind_work;
+};
+
 enum {
 	SUB_FEAT_LOCK		= 1U << 0,
 	SUB_FEAT_BINDER		= 1U << 1,
@@ -35,8 +78,17 @@ struct task_turbo_t {
 	unsigned short inherit_cnt:14;
 	short nice_backup;
 	atomic_t inherit_types;
+	struct turbo_chain chain;
 };
 
+struct futex_pi_state {
+	struct list_head list;
+	struct rt_mutex pi_mutex;
+	struct task_struct *owner;
+	refcount_t refcount;
+	union futex_key key;
+} __randomize_layout;
+
 struct futex_q {
 	struct plist_node list;
 
@@ -118,6 +118,33 @@ TRACE_EVENT(turbo_inherit_end,
 		__entry->inherit_types)
 );
 
+TRACE_EVENT(turbo_inherit_chain,
+	TP_PROTO(struct task_struct *waiter, struct task_struct *owner,
+		int type, int depth),
+	TP_ARGS(waiter, owner, type, depth),
+
+	TP_STRUCT__entry(
+		__field(pid_t, wpid)
+		__field(pid_t, opid)
+		__field(int, oprio)
+		__field(int, type)
+		__field(int, depth)
+	),
+	TP_fast_assign(
+		__entry->wpid	= waiter->pid;
+		__entry->opid	= owner->pid;
+		__entry->oprio	= owner->prio;
+		__entry->type	= type;
+		__entry->depth	= depth;
+	),
+	TP_printk("waiter=%d owner=%d prio=%d type=%d depth=%d",
+		__entry->wpid,
+		__entry->opid,
+		__entry->oprio,
+		__entry->type,
+		__entry->depth)
+);
+
 TRACE_EVENT(sched_turbo_nice_set,
 	TP_PROTO(struct task_struct *task, int old_prio, int new_prio),
 	TP_ARGS(task, old_prio, new_prio),
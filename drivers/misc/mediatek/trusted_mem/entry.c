@@ -482,6 +482,17 @@ int tmem_core_regmgr_offline(enum TRUSTED_MEM_TYPE mem_type)
 	return regmgr_offline(mem_device->reg_mgr);
 }
 
+void tmem_core_regmgr_stats_dump(enum TRUSTED_MEM_TYPE mem_type)
+{
+	struct trusted_mem_device *mem_device =
+		get_trusted_mem_device(mem_type);
+
+	if (unlikely(INVALID(mem_device)))
+		return;
+
+	regmgr_region_stats_dump(mem_device->reg_mgr);
+}
+
 bool tmem_core_is_device_registered(enum TRUSTED_MEM_TYPE mem_type)
 {
 	struct trusted_mem_device *mem_device =
@@ -135,6 +135,15 @@ struct peer_mgr_desc {
 struct region_mgr_work_data {
 };
 
+struct regmgr_region_stats {
+	u64 cold_on_count;
+	u64 warm_hit_count;
+	u64 on_last_us;
+	u64 on_max_us;
+	u64 on_total_us;
+	u64 off_max_us;
+};
+
 struct region_mgr_desc {
 	struct workqueue_struct *defer_off_wq;
 	struct delayed_work defer_off_work;
@@ -146,6 +155,13 @@ struct region_mgr_desc {
 	enum REGMGR_REGION_STATE state;
 	void *mem_device;
 	enum TRUSTED_MEM_TYPE active_mem_type;
+
+	/* warm pool */
+	u32 region_size;
+	u64 last_off_ns;
+	bool is_warm;
+	bool is_warm_held;
+	struct regmgr_region_stats stats;
 };
 
 #define MAX_DEVICE_NAME_LEN (32)
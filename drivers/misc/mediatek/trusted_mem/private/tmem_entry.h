@@ -31,6 +31,7 @@ u64 tmem_core_get_regmgr_region_online_cnt(enum TRUSTED_MEM_TYPE mem_type);
 u32 tmem_core_get_regmgr_region_ref_cnt(enum TRUSTED_MEM_TYPE mem_type);
 int tmem_core_regmgr_online(enum TRUSTED_MEM_TYPE mem_type);
 int tmem_core_regmgr_offline(enum TRUSTED_MEM_TYPE mem_type);
+void tmem_core_regmgr_stats_dump(enum TRUSTED_MEM_TYPE mem_type);
 
 bool tmem_core_is_device_registered(enum TRUSTED_MEM_TYPE mem_type);
 u32 tmem_core_get_min_chunk_size(enum TRUSTED_MEM_TYPE mem_type);
@@ -33,6 +33,7 @@ u32 get_regmgr_region_ref_cnt(struct region_mgr_desc *mgr_desc);
 int regmgr_online(struct region_mgr_desc *mgr_desc,
 		  enum TRUSTED_MEM_TYPE try_mem_type);
 int regmgr_offline(struct region_mgr_desc *mgr_desc);
+void regmgr_region_stats_dump(struct region_mgr_desc *mgr_desc);
 bool get_device_busy_status(struct trusted_mem_device *mem_device);
 bool is_mtee_mchunks(enum TRUSTED_MEM_TYPE mem_type);
 
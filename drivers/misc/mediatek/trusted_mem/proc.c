@@ -145,6 +145,8 @@ static void trusted_mem_region_status_dump(void)
 		pr_info("mem%d reg_state:%s registered:%s\n", mem_idx,
 			is_region_on ? "BUSY" : "IDLE",
 			is_dev_registered ? "YES" : "NO");
+		if (is_dev_registered)
+			tmem_core_regmgr_stats_dump(mem_idx);
 	}
 }
 
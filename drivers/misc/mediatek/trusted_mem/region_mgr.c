@@ -6,9 +6,12 @@
 #define PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
 #include "private/tmem_pr_fmt.h" PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
 
+#include <linux/atomic.h>
 #include <linux/delay.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
 #include <linux/moduleparam.h>
+#include <linux/sizes.h>
 #include <linux/mutex.h>
 #include <linux/semaphore.h>
 #include <linux/workqueue.h>
@@ -23,7 +26,27 @@
 #define REGMGR_LOCK() mutex_lock(&mgr_desc->lock)
 #define REGMGR_UNLOCK() mutex_unlock(&mgr_desc->lock)
 
-static int trusted_mem_region_poweron(struct trusted_mem_device *mem_device)
+/*
+ * Warm pool: a region that is needed again within warm_reuse_window_ms
+ * of being powered off is marked warm, and from then on is kept on for
+ * warm_hold_ms after its last user instead of the normal defer-off
+ * delay, so the next secure playback skips region bring-up. The total
+ * size of regions held this way is capped by warm_budget_mb.
+ */
+static unsigned int warm_hold_ms;
+module_param(warm_hold_ms, uint, 0644);
+MODULE_PARM_DESC(warm_hold_ms, "hold time of warm regions, 0 disables");
+
+static unsigned int warm_reuse_window_ms = 300000;
+module_param(warm_reuse_window_ms, uint, 0644);
+
+static unsigned int warm_budget_mb = 512;
+module_param(warm_budget_mb, uint, 0644);
+
+static atomic64_t warm_held_bytes = ATOMIC64_INIT(0);
+
+static int trusted_mem_region_poweron(struct trusted_mem_device *mem_device,
+				      u32 *size)
 {
 	int ret;
 	u64 region_pa;
@@ -57,6 +80,7 @@ static int trusted_mem_region_poweron(struct trusted_mem_device *mem_device)
 		goto err_add_mem_failed;
 	}
 
+	*size = region_size;
 	return TMEM_OK;
 
 err_add_mem_failed:
@@ -136,6 +160,8 @@ static int regmgr_try_on(struct region_mgr_desc *mgr_desc,
 {
 	struct trusted_mem_device *mem_device =
 		get_trusted_mem_device(try_mem_type);
+	struct regmgr_region_stats *stats = &mgr_desc->stats;
+	u64 start_ns, now_ns, cost_us;
 
 	pr_debug("%s:%d\n", __func__, __LINE__);
 
@@ -144,10 +170,23 @@ static int regmgr_try_on(struct region_mgr_desc *mgr_desc,
 		return TMEM_OK;
 	}
 
-	if (trusted_mem_region_poweron(mem_device)) {
+	start_ns = ktime_get_ns();
+	if (trusted_mem_region_poweron(mem_device, &mgr_desc->region_size)) {
 		pr_err("trusted mem poweron failed!\n");
 		return TMEM_REGION_POWER_ON_FAILED;
 	}
+	now_ns = ktime_get_ns();
+
+	cost_us = div_u64(now_ns - start_ns, NSEC_PER_USEC);
+	stats->cold_on_count++;
+	stats->on_last_us = cost_us;
+	stats->on_total_us += cost_us;
+	if (cost_us > stats->on_max_us)
+		stats->on_max_us = cost_us;
+
+	mgr_desc->is_warm = mgr_desc->last_off_ns &&
+		(now_ns - mgr_desc->last_off_ns <
+		 (u64)warm_reuse_window_ms * NSEC_PER_MSEC);
 
 	pr_debug("set device:%d to busy\n", try_mem_type);
 
@@ -162,6 +201,7 @@ static int regmgr_try_off(struct region_mgr_desc *mgr_desc)
 {
 	struct trusted_mem_device *mem_device =
 		(struct trusted_mem_device *)mgr_desc->mem_device;
+	u64 start_ns, cost_us;
 
 	pr_debug("%s:%d\n", __func__, __LINE__);
 
@@ -170,10 +210,21 @@ static int regmgr_try_off(struct region_mgr_desc *mgr_desc)
 		return TMEM_OK;
 	}
 
+	start_ns = ktime_get_ns();
 	if (trusted_mem_region_poweroff(mem_device)) {
 		pr_err("trusted mem poweroff failed!\n");
 		return TMEM_REGION_POWER_OFF_FAILED;
 	}
+	mgr_desc->last_off_ns = ktime_get_ns();
+
+	cost_us = div_u64(mgr_desc->last_off_ns - start_ns, NSEC_PER_USEC);
+	if (cost_us > mgr_desc->stats.off_max_us)
+		mgr_desc->stats.off_max_us = cost_us;
+
+	if (mgr_desc->is_warm_held) {
+		atomic64_sub(mgr_desc->region_size, &warm_held_bytes);
+		mgr_desc->is_warm_held = false;
+	}
 
 	pr_debug("set device:%d to idle\n", mem_device->mem_type);
 
@@ -183,10 +234,36 @@ static int regmgr_try_off(struct region_mgr_desc *mgr_desc)
 	return TMEM_OK;
 }
 
+static u32 regmgr_get_defer_off_delay(struct region_mgr_desc *mgr_desc)
+{
+	u64 budget = (u64)warm_budget_mb * SZ_1M;
+
+	if (!warm_hold_ms || !mgr_desc->is_warm ||
+	    warm_hold_ms <= mgr_desc->defer_off_delay_ms)
+		return mgr_desc->defer_off_delay_ms;
+
+	if (!mgr_desc->is_warm_held) {
+		if (atomic64_add_return(mgr_desc->region_size,
+					&warm_held_bytes) > budget) {
+			atomic64_sub(mgr_desc->region_size, &warm_held_bytes);
+			return mgr_desc->defer_off_delay_ms;
+		}
+		mgr_desc->is_warm_held = true;
+	}
+
+	return warm_hold_ms;
+}
+
 static void regmgr_trigger_defer_off_work(struct region_mgr_desc *mgr_desc)
 {
+	u32 delay_ms;
+
+	REGMGR_LOCK();
+	delay_ms = regmgr_get_defer_off_delay(mgr_desc);
+	REGMGR_UNLOCK();
+
 	queue_delayed_work(mgr_desc->defer_off_wq, &mgr_desc->defer_off_work,
-			   msecs_to_jiffies(mgr_desc->defer_off_delay_ms));
+			   msecs_to_jiffies(delay_ms));
 }
 
 static void regmgr_cancel_defer_off_work(struct delayed_work *work)
@@ -274,6 +351,9 @@ int regmgr_online(struct region_mgr_desc *mgr_desc,
 	regmgr_cancel_defer_off_work(&mgr_desc->defer_off_work);
 
 	REGMGR_LOCK();
+	if (is_region_on(mgr_desc->state) &&
+	    IS_ZERO(mgr_desc->valid_ref_count))
+		mgr_desc->stats.warm_hit_count++;
 	ret = regmgr_try_on(mgr_desc, try_mem_type);
 	REGMGR_UNLOCK();
 	return ret;
@@ -285,6 +365,24 @@ int regmgr_offline(struct region_mgr_desc *mgr_desc)
 	return TMEM_OK;
 }
 
+void regmgr_region_stats_dump(struct region_mgr_desc *mgr_desc)
+{
+	struct regmgr_region_stats stats;
+	bool is_warm;
+
+	REGMGR_LOCK();
+	stats = mgr_desc->stats;
+	is_warm = mgr_desc->is_warm;
+	REGMGR_UNLOCK();
+
+	pr_info("  warm:%d cold_on:%llu warm_hit:%llu on_us(last/max/avg):%llu/%llu/%llu off_max_us:%llu\n",
+		is_warm, stats.cold_on_count, stats.warm_hit_count,
+		stats.on_last_us, stats.on_max_us,
+		stats.cold_on_count ?
+		div64_u64(stats.on_total_us, stats.cold_on_count) : 0,
+		stats.off_max_us);
+}
+
 struct region_mgr_desc *
 create_reg_mgr_desc(enum TRUSTED_MEM_TYPE register_type,
 		    struct trusted_mem_device *mem_device)
@@ -308,6 +406,11 @@ create_reg_mgr_desc(enum TRUSTED_MEM_TYPE register_type,
 	t_mgr_desc->valid_ref_count = 0;
 	t_mgr_desc->mem_device = NULL;
 	t_mgr_desc->active_mem_type = TRUSTED_MEM_INVALID;
+	t_mgr_desc->region_size = 0;
+	t_mgr_desc->last_off_ns = 0;
+	t_mgr_desc->is_warm = false;
+	t_mgr_desc->is_warm_held = false;
+	memset(&t_mgr_desc->stats, 0, sizeof(t_mgr_desc->stats));
 
 	snprintf(wq_name, 32, "tmem_regmgr_defer_off_%d", register_type);
 	t_mgr_desc->defer_off_wq = create_singlethread_workqueue(wq_name);
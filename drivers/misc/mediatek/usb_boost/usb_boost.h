@@ -23,13 +23,18 @@ struct act_arg_obj {
 	int arg1;
 	int arg2;
 	int arg3;
+	/* boost strength in percent, scaled by the throughput controller */
+	int level;
 };
 
+#define USB_BOOST_LEVEL_MAX 100
+
 void usb_boost_set_para_and_arg(int id, int *para, int para_range,
 	struct act_arg_obj *act_arg);
 
 void usb_boost_by_id(int id);
 void usb_boost(void);
+void usb_boost_account(unsigned int bytes);
 int usb_boost_init(void);
 void usb_audio_boost(bool enable);
 int audio_core_hold(void);
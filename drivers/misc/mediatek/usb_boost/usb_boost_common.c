@@ -15,6 +15,9 @@
 #include <linux/workqueue.h>
 #include <linux/kdev_t.h>
 #include <linux/timekeeping.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/atomic.h>
 #include <linux/usb/composite.h>
 #include <trace/hooks/sound.h>
 #include <linux/pm_wakeup.h>
@@ -32,6 +35,7 @@ enum{
 	ATTR_TIMEOUT,
 	ATTR_POLLING_INTVAL,
 	ATTR_RAW,
+	ATTR_TARGET_TPUT,
 	_ATTR_PARA_RW_MAXID,
 
 	ATTR_CMD,
@@ -39,6 +43,8 @@ enum{
 	ATTR_RO_REF_TIME,
 	ATTR_RO_IS_RUNNING,
 	ATTR_RO_WORK_CNT,
+	ATTR_RO_LEVEL,
+	ATTR_RO_TPUT,
 	_ATTR_PARA_MAXID
 };
 enum{
@@ -56,6 +62,7 @@ static char *attr_name[_ATTR_MAXID] = {
 	"timeout",
 	"poll_intval",
 	"raw",
+	"target_tput",
 	"para_rx_maxid",
 
 	"cmd",
@@ -63,6 +70,8 @@ static char *attr_name[_ATTR_MAXID] = {
 	"ro_ref_time",
 	"ro_is_running",
 	"ro_work_cnt",
+	"ro_level",
+	"ro_tput",
 
 	/* arg part */
 	"arg1",
@@ -105,9 +114,22 @@ static int enabled;
 static int inited;
 static struct class *usb_boost_class;
 static struct wakeup_source *usb_boost_ws;
-static int cpu_freq_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0};
-static int cpu_core_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0};
-static int dram_vcore_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0};
+/* target_tput in KB/s, 0 keeps the boost at full strength until timeout */
+static int cpu_freq_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0, 400000};
+static int cpu_core_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0, 0};
+static int dram_vcore_dft_para[_ATTR_PARA_RW_MAXID] = {1, 3, 300, 0, 400000};
+
+/* bytes completed on boosted bulk endpoints, sampled by boost_work */
+static atomic64_t usb_boost_bytes = ATOMIC64_INIT(0);
+
+/*
+ * Throughput controller: hill-climb the boost level in LEVEL_STEP
+ * increments. Keep moving while the move pays off (raising gains more
+ * than 1/TPUT_GAIN_SHIFT, or lowering loses less than that), turn
+ * around otherwise, and back off as soon as target_tput is met.
+ */
+#define LEVEL_STEP 10
+#define TPUT_GAIN_SHIFT 5
 static void __usb_boost_empty(void) { return; }
 static void __usb_boost_cnt(void) { trigger_cnt_disabled++; return; }
 static void __usb_boost_id_empty(int id) { return; }
@@ -149,6 +171,11 @@ static struct mtk_usb_boost {
 	int work_cnt;
 	struct act_arg_obj act_arg;
 	void (*request_func)(int id);
+	/* throughput controller state */
+	u64 last_bytes;
+	ktime_t last_sample;
+	unsigned int tput;
+	int dir;
 } boost_inst[_TYPE_MAXID];
 
 static struct mtk_usb_audio_boost {
@@ -202,6 +229,11 @@ void usb_boost_by_id(int id)
 	__the_boost_ops.boost_by_id[id](id);
 }
 
+void usb_boost_account(unsigned int bytes)
+{
+	atomic64_add(bytes, &usb_boost_bytes);
+}
+
 void register_usb_boost_act(int type_id, int action_id,
 	int (*func)(struct act_arg_obj *arg))
 {
@@ -266,6 +298,12 @@ static void dump_info(int id)
 	USB_BOOST_NOTICE("id<%d>, attr<%s>, val<%d>\n",
 		id, attr_name[ATTR_RO_WORK_CNT], boost_inst[id].work_cnt);
 
+	USB_BOOST_NOTICE("id<%d>, attr<%s>, val<%d>\n",
+		id, attr_name[ATTR_RO_LEVEL], boost_inst[id].act_arg.level);
+
+	USB_BOOST_NOTICE("id<%d>, attr<%s>, val<%u>\n",
+		id, attr_name[ATTR_RO_TPUT], boost_inst[id].tput);
+
 	/* ARG */
 	USB_BOOST_NOTICE("id<%d>, attr<%s>, val<%d>\n",
 		id, attr_name[ATTR_ARG1], boost_inst[id].act_arg.arg1);
@@ -305,6 +343,57 @@ static bool check_timeout(int id)
 	return false;
 }
 
+static void tput_sample_start(struct mtk_usb_boost *ptr_inst)
+{
+	ptr_inst->last_bytes = atomic64_read(&usb_boost_bytes);
+	ptr_inst->last_sample = ktime_get();
+	ptr_inst->tput = 0;
+	ptr_inst->dir = -1;
+	ptr_inst->act_arg.level = USB_BOOST_LEVEL_MAX;
+}
+
+/* returns true when the boost level changed and must be re-applied */
+static bool tput_control(struct mtk_usb_boost *ptr_inst)
+{
+	int target = ptr_inst->para[ATTR_TARGET_TPUT];
+	unsigned int prev = ptr_inst->tput, tput;
+	u64 bytes = atomic64_read(&usb_boost_bytes);
+	ktime_t now = ktime_get();
+	s64 elapsed_us = ktime_us_delta(now, ptr_inst->last_sample);
+	int level = ptr_inst->act_arg.level;
+
+	if (elapsed_us <= 0)
+		return false;
+
+	/* KB/s */
+	tput = div64_u64((bytes - ptr_inst->last_bytes) * USEC_PER_SEC,
+			 (u64)elapsed_us * 1024);
+	ptr_inst->last_bytes = bytes;
+	ptr_inst->last_sample = now;
+	ptr_inst->tput = tput;
+
+	/* idle intervals are left to the timeout */
+	if (target <= 0 || !tput)
+		return false;
+
+	if (tput >= target)
+		ptr_inst->dir = -1;
+	else if (ptr_inst->dir > 0 && tput < prev + (prev >> TPUT_GAIN_SHIFT))
+		ptr_inst->dir = -1;
+	else if (ptr_inst->dir < 0 && tput + (tput >> TPUT_GAIN_SHIFT) < prev)
+		ptr_inst->dir = 1;
+
+	level = clamp(level + ptr_inst->dir * LEVEL_STEP, 0,
+		      USB_BOOST_LEVEL_MAX);
+	if (level == ptr_inst->act_arg.level)
+		return false;
+
+	USB_BOOST_DBG("id<%d>, tput<%u>, level<%d -> %d>\n", ptr_inst->id,
+		tput, ptr_inst->act_arg.level, level);
+	ptr_inst->act_arg.level = level;
+	return true;
+}
+
 static void boost_work(struct work_struct *work_struct)
 {
 	struct mtk_usb_boost *ptr_inst =
@@ -318,6 +407,8 @@ static void boost_work(struct work_struct *work_struct)
 	ptr_inst->work_cnt++;
 	USB_BOOST_NOTICE("id:%d, begin of work\n", id);
 
+	/* start at full strength so a new transfer ramps up at once */
+	tput_sample_start(ptr_inst);
 	/* dump_info(id); */
 	__boost_act(id, ACT_HOLD);
 	/* dump_info(id); */
@@ -335,7 +426,7 @@ static void boost_work(struct work_struct *work_struct)
 			break;
 		}
 
-		if (raw)
+		if (tput_control(ptr_inst) || raw)
 			__boost_act(id, ACT_HOLD);
 
 		msleep(poll_intval);
@@ -496,6 +587,7 @@ static ssize_t attr_store(struct device *dev, struct device_attribute *attr,
 	case ATTR_TIMEOUT:
 	case ATTR_POLLING_INTVAL:
 	case ATTR_RAW:
+	case ATTR_TARGET_TPUT:
 		boost_inst[i].para[idx] = (int)tmp;
 		break;
 	/* command series */
@@ -573,6 +665,7 @@ static ssize_t attr_show(struct device *dev,
 	case ATTR_TIMEOUT:
 	case ATTR_POLLING_INTVAL:
 	case ATTR_RAW:
+	case ATTR_TARGET_TPUT:
 		count = sprintf(buf, "%d\n", boost_inst[i].para[idx]);
 		break;
 	case _ATTR_PARA_RW_MAXID:
@@ -611,6 +704,12 @@ static ssize_t attr_show(struct device *dev,
 	case ATTR_RO_WORK_CNT:
 		count = sprintf(buf, "%d\n", boost_inst[i].work_cnt);
 		break;
+	case ATTR_RO_LEVEL:
+		count = sprintf(buf, "%d\n", boost_inst[i].act_arg.level);
+		break;
+	case ATTR_RO_TPUT:
+		count = sprintf(buf, "%u\n", boost_inst[i].tput);
+		break;
 	/* ARG usage */
 	case ATTR_ARG1:
 		count = sprintf(buf, "%d\n", boost_inst[i].act_arg.arg1);
@@ -801,12 +900,16 @@ static void mtu3_req_complete_boost(void *unused, struct mtu3_request *mreq)
 
 	switch (type) {
 	case USB_TYPE_MTP:
+	case USB_TYPE_ADB:
+		usb_boost_account(req->actual);
 		if (req->actual >= 8192)
 			usb_boost();
 		break;
 	case USB_TYPE_RNDIS:
-		if (mep->is_in && mep->type == USB_ENDPOINT_XFER_BULK)
+		if (mep->is_in && mep->type == USB_ENDPOINT_XFER_BULK) {
+			usb_boost_account(req->actual);
 			usb_boost();
+		}
 		break;
 	default:
 		break;
@@ -831,6 +934,7 @@ void xhci_urb_giveback_dbg(void *unused, struct urb *urb)
 {
 	switch (usb_endpoint_type(&urb->ep->desc)) {
 	case USB_ENDPOINT_XFER_BULK:
+		usb_boost_account(urb->actual_length);
 		if (urb->actual_length >= 8192) {
 			__pm_wakeup_event(usb_boost_ws, 10000);
 			usb_boost();
@@ -859,6 +963,7 @@ int usb_boost_init(void)
 		count = sprintf(wq_name, "%s_wq", type_name[id]);
 		wq_name[count] = '\0';
 		boost_inst[id].id  = id;
+		boost_inst[id].act_arg.level = USB_BOOST_LEVEL_MAX;
 		update_time(id);
 		boost_inst[id].wq  = create_singlethread_workqueue(wq_name);
 		INIT_WORK(&boost_inst[id].work, boost_work);
@@ -63,8 +63,12 @@ static int freq_hold(struct act_arg_obj *arg)
 	}
 
 	list_for_each_entry(req_policy, &usb_policy_list, list) {
-		USB_BOOST_NOTICE("%s: update request cpu(%x)\n", __func__, req_policy->policy->cpu);
-		freq_qos_update_request(&req_policy->qos_req, req_policy->policy->max);
+		unsigned int freq = mult_frac(req_policy->policy->max,
+			arg->level, USB_BOOST_LEVEL_MAX);
+
+		USB_BOOST_NOTICE("%s: update request cpu(%x) freq(%u)\n", __func__,
+			req_policy->policy->cpu, freq);
+		freq_qos_update_request(&req_policy->qos_req, freq);
 	}
 
 	return 0;
@@ -110,7 +114,8 @@ static int vcorefs_hold(struct act_arg_obj *arg)
 	USB_BOOST_DBG("\n");
 
 	if (usb_icc_path)
-		icc_set_bw(usb_icc_path, 0, peak_bw);
+		icc_set_bw(usb_icc_path, 0,
+			mult_frac(peak_bw, arg->level, USB_BOOST_LEVEL_MAX));
 
 	return 0;
 }
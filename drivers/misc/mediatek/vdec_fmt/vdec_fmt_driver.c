@@ -11,6 +11,7 @@
 #include <linux/of_address.h>
 #include <linux/of_device.h>
 #include <linux/namei.h>
+#include <linux/sync_file.h>
 #include "vdec_fmt_driver.h"
 #include "vdec_fmt_dmabuf.h"
 #include "vdec_fmt_pm.h"
@@ -475,11 +476,15 @@ static int fmt_gce_timeout_aee(struct cmdq_cb_data data)
 	return CMDQ_AEE_WARN;
 }
 
-static int fmt_gce_cmd_flush(unsigned long arg)
+/*
+ * Build the GCE packet described by @buff, power the pipe up and bind the
+ * packet to a task slot. Returns the task id, the packet is not flushed yet.
+ */
+static int fmt_gce_cmd_prepare(struct gce_cmdq_obj *buff_ptr)
 {
 	int i, taskid, ret;
 	unsigned char *user_data_addr = NULL;
-	struct gce_cmdq_obj buff;
+	struct gce_cmdq_obj buff = *buff_ptr;
 	struct cmdq_pkt *pkt_ptr;
 	struct cmdq_client *cl;
 	struct gce_cmds *cmds;
@@ -490,22 +495,11 @@ static int fmt_gce_cmd_flush(unsigned long arg)
 	struct dmabuf_info iinfo, oinfo;
 	struct dmabufmap map[FMT_FD_RESERVE];
 
-	fmt_debug(1, "+");
-
 	if (atomic_read(&fmt->fmt_error) == 1) {
 		fmt_err("fmt in error status, flushed failed!");
 		return -EINVAL;
 	}
 
-	user_data_addr = (unsigned char *)arg;
-	ret = (long)copy_from_user(&buff, user_data_addr,
-				   (unsigned long)sizeof(struct gce_cmdq_obj));
-	if (ret != 0L) {
-		fmt_err("gce_cmdq_obj copy_from_user failed! %d",
-			ret);
-		return -EINVAL;
-	}
-
 	identifier = buff.identifier;
 	if (identifier >= fmt->gce_th_num) {
 		fmt_err("invalid identifier %u",
@@ -655,6 +649,34 @@ static int fmt_gce_cmd_flush(unsigned long arg)
 
 	memcpy(&fmt->gce_task[taskid].cmdq_buff, &buff, sizeof(buff));
 
+	return taskid;
+}
+
+static int fmt_gce_cmd_flush(unsigned long arg)
+{
+	int taskid, ret;
+	unsigned char *user_data_addr = NULL;
+	struct gce_cmdq_obj buff;
+	struct cmdq_pkt *pkt_ptr;
+	struct mtk_vdec_fmt *fmt = fmt_mtkdev;
+
+	fmt_debug(1, "+");
+
+	user_data_addr = (unsigned char *)arg;
+	ret = (long)copy_from_user(&buff, user_data_addr,
+				   (unsigned long)sizeof(struct gce_cmdq_obj));
+	if (ret != 0L) {
+		fmt_err("gce_cmdq_obj copy_from_user failed! %d",
+			ret);
+		return -EINVAL;
+	}
+
+	taskid = fmt_gce_cmd_prepare(&buff);
+	if (taskid < 0)
+		return taskid;
+
+	pkt_ptr = fmt->gce_task[taskid].pkt_ptr;
+
 	// flush cmd async
 	fmt_debug(1, "call cmdq_pkt_flush_async");
 	pkt_ptr->aee_cb = fmt_gce_timeout_aee;
@@ -668,42 +690,18 @@ static int fmt_gce_cmd_flush(unsigned long arg)
 
 	fmt_debug(1, "-");
 
-	return ret;
+	return 0;
 }
 
-static int fmt_gce_wait_callback(unsigned long arg)
+/*
+ * Drop the power, bandwidth and GCE thread references of a finished task and
+ * release its packet and slot.
+ */
+static int fmt_gce_task_finish(unsigned int taskid)
 {
-	int ret, i;
-	unsigned int identifier, taskid;
-	unsigned char *user_data_addr = NULL;
+	int ret = 0, i;
 	struct mtk_vdec_fmt *fmt = fmt_mtkdev;
-
-	user_data_addr = (unsigned char *)arg;
-	ret = (long)copy_from_user(&taskid, user_data_addr,
-				   (unsigned long)sizeof(unsigned int));
-	if (ret != 0L) {
-		fmt_err("copy_from_user failed!%d",
-			ret);
-		return -EINVAL;
-	}
-
-	if (taskid >= FMT_INST_MAX) {
-		fmt_err("invalid taskid %u",
-			taskid);
-		return -EINVAL;
-	}
-
-	identifier = fmt->gce_task[taskid].identifier;
-	if (identifier >= fmt->gce_th_num) {
-		fmt_err("invalid identifier %u",
-			identifier);
-		return -EINVAL;
-	}
-
-	fmt_debug(1, "id %d taskid %d pkt_ptr %p",
-		identifier, taskid, fmt->gce_task[taskid].pkt_ptr);
-
-	cmdq_pkt_wait_complete(fmt->gce_task[taskid].pkt_ptr);
+	unsigned int identifier = fmt->gce_task[taskid].identifier;
 
 	if (fmt_dbg_level == 4)
 		fmt_dump_addr_reg();
@@ -738,6 +736,200 @@ static int fmt_gce_wait_callback(unsigned long arg)
 	return ret;
 }
 
+static void fmt_gce_queue_callback(struct cmdq_cb_data data)
+{
+	struct gce_cmdq_task *task = data.data;
+	struct mtk_vdec_fmt *fmt = fmt_mtkdev;
+
+	if (data.err < 0) {
+		fmt_err("pkt_ptr %p", task->pkt_ptr);
+		atomic_set(&fmt->fmt_error, 1);
+		fmt_dump_addr_reg();
+		task->err = data.err;
+	}
+
+	queue_work(system_highpri_wq, &task->done_work);
+}
+
+static void fmt_gce_queue_submit(struct gce_cmdq_task *task)
+{
+	if (task->in_fence && task->in_fence->error)
+		task->err = task->in_fence->error;
+
+	task->pkt_ptr->aee_cb = fmt_gce_timeout_aee;
+	cmdq_pkt_flush_async(task->pkt_ptr, fmt_gce_queue_callback, task);
+}
+
+static void fmt_gce_submit_work(struct work_struct *work)
+{
+	fmt_gce_queue_submit(container_of(work, struct gce_cmdq_task,
+					  submit_work));
+}
+
+static void fmt_gce_in_fence_cb(struct dma_fence *fence,
+				struct dma_fence_cb *cb)
+{
+	struct gce_cmdq_task *task = container_of(cb, struct gce_cmdq_task,
+						  in_cb);
+
+	/* fence callbacks run in atomic context, the flush may sleep */
+	queue_work(system_highpri_wq, &task->submit_work);
+}
+
+static void fmt_gce_done_work(struct work_struct *work)
+{
+	struct gce_cmdq_task *task = container_of(work, struct gce_cmdq_task,
+						  done_work);
+	struct dma_fence *in_fence = task->in_fence;
+	struct dma_fence *out_fence = task->out_fence;
+
+	cmdq_pkt_wait_complete(task->pkt_ptr);
+
+	if (task->err)
+		dma_fence_set_error(out_fence, task->err);
+	dma_fence_signal(out_fence);
+
+	task->in_fence = NULL;
+	task->out_fence = NULL;
+	task->err = 0;
+
+	/* the slot may be reused as soon as it is cleared */
+	fmt_gce_task_finish(task - fmt_mtkdev->gce_task);
+
+	dma_fence_put(out_fence);
+	if (in_fence)
+		dma_fence_put(in_fence);
+}
+
+/*
+ * Queue a command buffer behind an input fence and hand back an output
+ * fence instead of a task id, so userspace never waits for the GCE itself.
+ */
+static int fmt_gce_cmd_queue(unsigned long arg)
+{
+	int fd, taskid, ret;
+	struct gce_cmdq_queue_obj qbuff;
+	struct gce_cmdq_obj buff;
+	struct gce_cmdq_task *task;
+	struct dma_fence *in_fence = NULL, *out_fence;
+	struct sync_file *sync_file;
+	struct mtk_vdec_fmt *fmt = fmt_mtkdev;
+
+	if (copy_from_user(&qbuff, (void __user *)arg, sizeof(qbuff))) {
+		fmt_err("gce_cmdq_queue_obj copy_from_user failed!");
+		return -EFAULT;
+	}
+
+	if (qbuff.in_fence >= 0) {
+		in_fence = sync_file_get_fence(qbuff.in_fence);
+		if (!in_fence) {
+			fmt_err("invalid in fence %d", qbuff.in_fence);
+			return -EINVAL;
+		}
+	}
+
+	out_fence = fmt_sync_gce_fence_create();
+	if (!out_fence) {
+		ret = -ENOMEM;
+		goto err_in_fence;
+	}
+
+	sync_file = sync_file_create(out_fence);
+	if (!sync_file) {
+		ret = -ENOMEM;
+		goto err_out_fence;
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_sync_file;
+	}
+
+	memset(&buff, 0, sizeof(buff));
+	buff.cmds_user_ptr = qbuff.cmds_user_ptr;
+	buff.identifier = qbuff.identifier;
+	buff.secure = qbuff.secure;
+	buff.pmqos_param = qbuff.pmqos_param;
+
+	taskid = fmt_gce_cmd_prepare(&buff);
+	if (taskid < 0) {
+		ret = taskid;
+		goto err_fd;
+	}
+
+	qbuff.out_fence = fd;
+	if (copy_to_user((void __user *)arg, &qbuff, sizeof(qbuff))) {
+		fmt_err("copy out fence to user fail");
+		fmt_gce_task_finish(taskid);
+		ret = -EFAULT;
+		goto err_fd;
+	}
+	fd_install(fd, sync_file->file);
+
+	task = &fmt->gce_task[taskid];
+	task->in_fence = in_fence;
+	task->out_fence = out_fence;
+	task->err = 0;
+
+	fmt_debug(1, "id %d taskid %d in fence %d out fence %d",
+		qbuff.identifier, taskid, qbuff.in_fence, fd);
+
+	if (!in_fence || dma_fence_add_callback(in_fence, &task->in_cb,
+						fmt_gce_in_fence_cb))
+		fmt_gce_queue_submit(task);
+
+	return 0;
+
+err_fd:
+	put_unused_fd(fd);
+err_sync_file:
+	fput(sync_file->file);
+err_out_fence:
+	dma_fence_put(out_fence);
+err_in_fence:
+	if (in_fence)
+		dma_fence_put(in_fence);
+	return ret;
+}
+
+static int fmt_gce_wait_callback(unsigned long arg)
+{
+	int ret;
+	unsigned int identifier, taskid;
+	unsigned char *user_data_addr = NULL;
+	struct mtk_vdec_fmt *fmt = fmt_mtkdev;
+
+	user_data_addr = (unsigned char *)arg;
+	ret = (long)copy_from_user(&taskid, user_data_addr,
+				   (unsigned long)sizeof(unsigned int));
+	if (ret != 0L) {
+		fmt_err("copy_from_user failed!%d",
+			ret);
+		return -EINVAL;
+	}
+
+	if (taskid >= FMT_INST_MAX) {
+		fmt_err("invalid taskid %u",
+			taskid);
+		return -EINVAL;
+	}
+
+	identifier = fmt->gce_task[taskid].identifier;
+	if (identifier >= fmt->gce_th_num) {
+		fmt_err("invalid identifier %u",
+			identifier);
+		return -EINVAL;
+	}
+
+	fmt_debug(1, "id %d taskid %d pkt_ptr %p",
+		identifier, taskid, fmt->gce_task[taskid].pkt_ptr);
+
+	cmdq_pkt_wait_complete(fmt->gce_task[taskid].pkt_ptr);
+
+	return fmt_gce_task_finish(taskid);
+}
+
 static int fmt_get_platform_dts(unsigned long arg)
 {
 	struct dts_info *dts;
@@ -780,6 +972,9 @@ static long vdec_fmt_ioctl(struct file *file, unsigned int cmd, unsigned long ar
 	case FMT_GCE_WAIT_CALLBACK:
 		ret = fmt_gce_wait_callback(arg);
 		break;
+	case FMT_GCE_QUEUE_FLUSH:
+		ret = fmt_gce_cmd_queue(arg);
+		break;
 	case FMT_GET_PLATFORM_DTS:
 		ret = fmt_get_platform_dts(arg);
 		break;
@@ -896,6 +1091,7 @@ static long compat_vdec_fmt_ioctl(struct file *file, unsigned int cmd,
 	}
 	case FMT_GCE_WAIT_CALLBACK:
 	case FMT_GET_PLATFORM_DTS:
+	case FMT_GCE_QUEUE_FLUSH:
 		return file->f_op->unlocked_ioctl(file, cmd, arg);
 	default:
 		fmt_err("Unknown cmd");
@@ -1150,6 +1346,8 @@ static int vdec_fmt_probe(struct platform_device *pdev)
 		fmt->gce_task[i].pkt_ptr = NULL;
 		fmt->gce_task[i].used = 0;
 		fmt->gce_task[i].identifier = 0;
+		INIT_WORK(&fmt->gce_task[i].submit_work, fmt_gce_submit_work);
+		INIT_WORK(&fmt->gce_task[i].done_work, fmt_gce_done_work);
 	}
 
 	for (i = 0; i < fmt->gce_th_num; i++) {
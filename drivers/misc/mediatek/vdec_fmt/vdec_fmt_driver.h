@@ -8,6 +8,8 @@
 #include <linux/mutex.h>
 #include <linux/semaphore.h>
 #include <linux/notifier.h>
+#include <linux/dma-fence.h>
+#include <linux/workqueue.h>
 #include <linux/soc/mediatek/mtk-cmdq-ext.h>
 #include <soc/mediatek/smi.h>
 #include <cmdq-util.h>
@@ -63,6 +65,20 @@ struct gce_cmdq_obj {
 	struct fmt_pmqos pmqos_param;
 };
 
+/*
+ * Queued submission: the command buffer runs on GCE once @in_fence (-1 for
+ * none) signals, @out_fence returns a sync_file fd signaled on completion.
+ */
+struct gce_cmdq_queue_obj {
+	u64 cmds_user_ptr;
+	u32 identifier;
+	u32 secure;
+	struct fmt_pmqos pmqos_param;
+	s32 in_fence;
+	s32 out_fence;
+	u32 reserved;
+};
+
 #if IS_ENABLED(CONFIG_COMPAT)
 struct compat_gce_cmdq_obj {
 	u64 cmds_user_ptr;
@@ -86,6 +102,13 @@ struct gce_cmdq_task {
 	u32 used;
 	struct dmabuf_info iinfo;
 	struct dmabuf_info oinfo;
+	/* queued mode only */
+	struct dma_fence *in_fence;
+	struct dma_fence *out_fence;
+	struct dma_fence_cb in_cb;
+	struct work_struct submit_work;
+	struct work_struct done_work;
+	int err;
 };
 
 struct dts_info {
@@ -192,10 +215,12 @@ struct mtk_vdec_fmt {
 #define FMT_GCE_SET_CMD_FLUSH _IOW('f', 0, struct gce_cmdq_obj)
 #define FMT_GCE_WAIT_CALLBACK _IOW('f', 1, unsigned int)
 #define FMT_GET_PLATFORM_DTS  _IOW('f', 2, struct dts_info)
+#define FMT_GCE_QUEUE_FLUSH   _IOWR('f', 3, struct gce_cmdq_queue_obj)
 
 #if IS_ENABLED(CONFIG_COMPAT)
 #define COMPAT_FMT_GCE_SET_CMD_FLUSH _IOW('f', 0, struct compat_gce_cmdq_obj)
 #endif
 int fmt_sync_device_init(void);
+struct dma_fence *fmt_sync_gce_fence_create(void);
 
 #endif /* _MTK_FMT_H */
@@ -455,3 +455,40 @@ int fmt_sync_device_init(void)
 	return misc_register(&fmt_sync_dev);
 }
 
+static DEFINE_SPINLOCK(fmt_gce_fence_lock);
+
+static const char *fmt_gce_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "vdec_fmt";
+}
+
+static const char *fmt_gce_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "fmt_gce";
+}
+
+static const struct dma_fence_ops fmt_gce_fence_ops = {
+	.get_driver_name = fmt_gce_fence_get_driver_name,
+	.get_timeline_name = fmt_gce_fence_get_timeline_name,
+};
+
+/**
+ * fmt_sync_gce_fence_create() - creates a fence for a queued GCE task
+ *
+ * Queued tasks start when their input fence signals, so they complete out of
+ * submission order and each fence gets its own context. Signaled by the
+ * driver when the task is done. Returns the fence or NULL in case of error.
+ */
+struct dma_fence *fmt_sync_gce_fence_create(void)
+{
+	struct dma_fence *fence;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return NULL;
+
+	dma_fence_init(fence, &fmt_gce_fence_ops, &fmt_gce_fence_lock,
+		       dma_fence_context_alloc(1), 1);
+
+	return fence;
+}
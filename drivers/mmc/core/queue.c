@@ -282,10 +282,12 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	case MMC_ISSUE_ASYNC:
 		/*
-		 * For MMC host software queue, we only allow 2 requests in
-		 * flight to avoid a long latency.
+		 * For MMC host software queue, the number of requests in
+		 * flight is bounded by the depth it picked for the current
+		 * workload, to avoid a long latency.
 		 */
-		if (host->hsq_enabled && mq->in_flight[issue_type] > 2) {
+		if (host->hsq_enabled &&
+		    mq->in_flight[issue_type] > host->hsq_depth) {
 			spin_unlock_irq(&mq->lock);
 			return BLK_STS_RESOURCE;
 		}
@@ -10,12 +10,21 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 
 #include "mmc_hsq.h"
 
 #define HSQ_NUM_SLOTS	64
 #define HSQ_INVALID_TAG	HSQ_NUM_SLOTS
 
+/* requests of at most this size count as small random writes */
+#define HSQ_SMALL_WRITE_SIZE	SZ_16K
+
+static unsigned int hsq_perf_depth = HSQ_PERFORMANCE_DEPTH;
+module_param(hsq_perf_depth, uint, 0644);
+MODULE_PARM_DESC(hsq_perf_depth,
+		 "Requests in flight allowed for small random writes");
+
 static void mmc_hsq_retry_handler(struct work_struct *work)
 {
 	struct mmc_hsq *hsq = container_of(work, struct mmc_hsq, retry_work);
@@ -209,6 +218,34 @@ static void mmc_hsq_recovery_finish(struct mmc_host *mmc)
 		mmc_hsq_pump_requests(hsq);
 }
 
+/*
+ * Let the block layer keep more requests in flight while the queue holds
+ * several small writes, so that their dispatch overlaps the card's busy
+ * time, and fall back to the normal depth for anything else to keep read
+ * latency low.
+ */
+static void mmc_hsq_modify_threshold(struct mmc_hsq *hsq)
+{
+	struct mmc_host *mmc = hsq->mmc;
+	struct mmc_request *mrq;
+	unsigned int tag, need_change = 0;
+	unsigned int depth;
+
+	for (tag = 0; tag < HSQ_NUM_SLOTS; tag++) {
+		mrq = hsq->slot[tag].mrq;
+		if (mrq && mrq->data &&
+		    (mrq->data->flags & MMC_DATA_WRITE) &&
+		    mrq->data->blksz * mrq->data->blocks <=
+		    HSQ_SMALL_WRITE_SIZE &&
+		    ++need_change == 2)
+			break;
+	}
+
+	depth = clamp_t(unsigned int, READ_ONCE(hsq_perf_depth),
+			HSQ_NORMAL_DEPTH, HSQ_NUM_SLOTS);
+	mmc->hsq_depth = need_change > 1 ? depth : HSQ_NORMAL_DEPTH;
+}
+
 static int mmc_hsq_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct mmc_hsq *hsq = mmc->cqe_private;
@@ -229,6 +266,8 @@ static int mmc_hsq_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	hsq->slot[tag].mrq = mrq;
 
+	mmc_hsq_modify_threshold(hsq);
+
 	/*
 	 * Set the next tag as current request tag if no available
 	 * next tag.
@@ -350,6 +389,7 @@ int mmc_hsq_init(struct mmc_hsq *hsq, struct mmc_host *mmc)
 	hsq->mmc = mmc;
 	hsq->mmc->cqe_private = hsq;
 	mmc->cqe_ops = &mmc_hsq_ops;
+	mmc->hsq_depth = HSQ_NORMAL_DEPTH;
 
 	INIT_WORK(&hsq->retry_work, mmc_hsq_retry_handler);
 	spin_lock_init(&hsq->lock);
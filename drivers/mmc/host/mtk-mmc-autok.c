@@ -4513,6 +4513,88 @@ int sd_execute_autok(struct msdc_host *host, u32 opcode)
 }
 EXPORT_SYMBOL(sd_execute_autok);
 
+/* tuning blocks sent to check cached parameters before reusing them */
+#define AUTOK_CACHE_CHECK_CNT	4
+
+static bool autok_cache_match(struct msdc_host *host, u32 opcode)
+{
+	struct mmc_host *mmc = mmc_from_priv(host);
+
+	if (opcode != MMC_SEND_TUNING_BLOCK &&
+	    opcode != MMC_SEND_TUNING_BLOCK_HS200)
+		return false;
+
+	/* HS400 and the low speed modes keep their own tuning flow */
+	return mmc->ios.timing == MMC_TIMING_MMC_HS200 ||
+	       mmc->ios.timing == MMC_TIMING_UHS_SDR104 ||
+	       mmc->ios.timing == MMC_TIMING_UHS_SDR50;
+}
+
+/*
+ * Reuse the parameters of the last successful autok if the card (by CID),
+ * timing and clock are unchanged and a few tuning blocks pass with them.
+ * Returns 0 when the cached result was applied, otherwise full autok has
+ * to be run.
+ */
+int autok_cached_tuning(struct msdc_host *host, u32 opcode)
+{
+	struct msdc_autok_cache *cache = &host->autok_cache;
+	struct mmc_host *mmc = mmc_from_priv(host);
+	int i, ret = 0;
+
+	if (!cache->valid || !autok_cache_match(host, opcode) ||
+	    cache->timing != mmc->ios.timing ||
+	    cache->clock != mmc->ios.clock ||
+	    memcmp(cache->cid, host->last_cid, sizeof(cache->cid)))
+		return -ENOENT;
+
+	if (mmc->ios.timing == MMC_TIMING_MMC_HS200)
+		autok_init_hs200(host);
+	else
+		autok_init_sdr104(host);
+	autok_tuning_parameter_init(host, cache->res);
+
+	for (i = 0; i < AUTOK_CACHE_CHECK_CNT; i++) {
+		ret = mmc_send_tuning(mmc, opcode, NULL);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		pr_notice("[AUTOK]msdc%d cached tuning check fail (%d)\n",
+			  host->id, ret);
+		cache->valid = false;
+		/* the failed check is not an error of the transfer path */
+		host->need_tune = TUNE_NONE;
+		return ret;
+	}
+
+	pr_notice("[AUTOK]msdc%d reuse cached tuning\n", host->id);
+	return 0;
+}
+EXPORT_SYMBOL(autok_cached_tuning);
+
+void autok_cache_save(struct msdc_host *host, u32 opcode)
+{
+	struct msdc_autok_cache *cache = &host->autok_cache;
+	struct mmc_host *mmc = mmc_from_priv(host);
+	unsigned int value = 0;
+	int i;
+
+	if (!autok_cache_match(host, opcode))
+		return;
+
+	for (i = 0; i < TUNING_PARAM_COUNT; i++) {
+		autok_adjust_param(host, i, &value, AUTOK_READ);
+		cache->res[i] = value;
+	}
+	memcpy(cache->cid, host->last_cid, sizeof(cache->cid));
+	cache->timing = mmc->ios.timing;
+	cache->clock = mmc->ios.clock;
+	cache->valid = true;
+}
+EXPORT_SYMBOL(autok_cache_save);
+
 void msdc_init_tune_path(struct msdc_host *host, unsigned char timing)
 {
 	u32 tune_reg = host->dev_comp->pad_tune_reg;
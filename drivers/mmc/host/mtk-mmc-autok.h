@@ -682,6 +682,8 @@ extern int emmc_execute_dvfs_autok(struct msdc_host *host, u32 opcode);
 extern int sd_execute_dvfs_autok(struct msdc_host *host, u32 opcode);
 extern int emmc_execute_autok(struct msdc_host *host, u32 opcode);
 extern int sd_execute_autok(struct msdc_host *host, u32 opcode);
+extern int autok_cached_tuning(struct msdc_host *host, u32 opcode);
+extern void autok_cache_save(struct msdc_host *host, u32 opcode);
 extern void msdc_init_tune_path(struct msdc_host *host, unsigned char timing);
 extern void msdc_init_tune_setting(struct msdc_host *host);
 
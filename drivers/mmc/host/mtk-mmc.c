@@ -814,6 +814,11 @@ static bool msdc_cmd_done(struct msdc_host *host, int events,
 			rsp[1] = readl(host->base + SDC_RESP2);
 			rsp[2] = readl(host->base + SDC_RESP1);
 			rsp[3] = readl(host->base + SDC_RESP0);
+			/* remember which card autok is about to tune for */
+			if (cmd->opcode == MMC_ALL_SEND_CID &&
+			    (events & MSDC_INT_CMDRDY))
+				memcpy(host->last_cid, rsp,
+				       sizeof(host->last_cid));
 		} else {
 			rsp[0] = readl(host->base + SDC_RESP0);
 		}
@@ -2234,11 +2239,27 @@ static int msdc_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	}
 
 	host->tuning_in_progress = true;
+	if (!host->need_tune) {
+		ret = autok_cached_tuning(host, opcode);
+		if (!ret) {
+			host->tuning_in_progress = false;
+			goto end;
+		}
+		/* start over from the defaults if a cached result failed */
+		if (ret != -ENOENT) {
+			msdc_init_tune_path(host, mmc->ios.timing);
+			autok_msdc_tx_setting(host, &mmc->ios);
+		}
+		ret = 0;
+	}
+
 	if (host->id == MSDC_EMMC)
 		ret = emmc_execute_autok(host, opcode);
 	else if (host->id == MSDC_SD || host->id == MSDC_SDIO)
 		ret = sd_execute_autok(host, opcode);
 	host->tuning_in_progress = false;
+	if (!ret)
+		autok_cache_save(host, opcode);
 
 #if IS_ENABLED(CONFIG_MMC_DEBUG)
 	if (ret)
@@ -571,6 +571,15 @@ struct msdc_tune_para {
 	u32 emmc_top_cmd;
 };
 
+/* last good autok result, reused while the same card comes back */
+struct msdc_autok_cache {
+	bool valid;
+	unsigned char timing;
+	u32 clock;
+	u32 cid[4];
+	u8 res[TUNING_PARAM_COUNT];
+};
+
 struct msdc_delay_phase {
 	u8 maxlen;
 	u8 start;
@@ -645,6 +654,8 @@ struct msdc_host {
 	int autok_error;
 	u32 tune_latch_ck_cnt;
 	u8 autok_res[AUTOK_VCORE_NUM+1][TUNING_PARA_SCAN_COUNT];
+	u32 last_cid[4];	/* CMD2 response of the card being set up */
+	struct msdc_autok_cache autok_cache;
 	u8 card_inserted;  /* the status of card inserted */
 	bool block_bad_card;
 	int retune_times;
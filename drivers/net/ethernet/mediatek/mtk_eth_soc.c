@@ -19,6 +19,7 @@
 #include <linux/interrupt.h>
 #include <linux/pinctrl/devinfo.h>
 #include <linux/phylink.h>
+#include <linux/bpf_trace.h>
 
 #include "mtk_eth_soc.h"
 
@@ -789,7 +790,7 @@ static inline int mtk_max_frag_size(int mtu)
 
 static inline int mtk_max_buf_size(int frag_size)
 {
-	int buf_size = frag_size - NET_SKB_PAD - NET_IP_ALIGN -
+	int buf_size = frag_size - MTK_RX_HEADROOM - NET_IP_ALIGN -
 		       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 
 	WARN_ON(buf_size < MTK_MAX_RX_LENGTH);
@@ -1256,6 +1257,47 @@ static void mtk_update_rx_cpu_idx(struct mtk_eth *eth)
 	}
 }
 
+/* returns the XDP verdict, the buffer is consumed unless it is XDP_PASS */
+static u32 mtk_xdp_run(struct mtk_rx_ring *ring, struct xdp_buff *xdp,
+		       struct net_device *dev)
+{
+	struct mtk_mac *mac = netdev_priv(dev);
+	struct bpf_prog *prog;
+	u32 act = XDP_PASS;
+
+	rcu_read_lock();
+	prog = rcu_dereference(mac->xdp_prog);
+	if (!prog)
+		goto unlock;
+
+	xdp->rxq = &ring->xdp_q;
+	xdp->frame_sz = ring->frag_size;
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		goto unlock;
+	case XDP_REDIRECT:
+		if (likely(!xdp_do_redirect(dev, xdp, prog)))
+			goto unlock;
+		dev->stats.rx_dropped++;
+		goto out;
+	default:
+		/* no XDP_TX until the TX ring can carry xdp frames */
+		bpf_warn_invalid_xdp_action(act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+out:
+	skb_free_frag(xdp->data_hard_start);
+unlock:
+	rcu_read_unlock();
+	return act;
+}
+
 static int mtk_poll_rx(struct napi_struct *napi, int budget,
 		       struct mtk_eth *eth)
 {
@@ -1264,10 +1306,12 @@ static int mtk_poll_rx(struct napi_struct *napi, int budget,
 	struct sk_buff *skb;
 	u8 *data, *new_data;
 	struct mtk_rx_dma *rxd, trxd;
+	bool xdp_flush = false;
 	int done = 0;
 
 	while (done < budget) {
 		struct net_device *netdev;
+		struct xdp_buff xdp;
 		unsigned int pktlen;
 		dma_addr_t dma_addr;
 		int mac;
@@ -1309,7 +1353,7 @@ static int mtk_poll_rx(struct napi_struct *napi, int budget,
 			goto release_desc;
 		}
 		dma_addr = dma_map_single(eth->dev,
-					  new_data + NET_SKB_PAD +
+					  new_data + MTK_RX_HEADROOM +
 					  eth->ip_align,
 					  ring->buf_size,
 					  DMA_FROM_DEVICE);
@@ -1319,20 +1363,31 @@ static int mtk_poll_rx(struct napi_struct *napi, int budget,
 			goto release_desc;
 		}
 
+		dma_unmap_single(eth->dev, trxd.rxd1,
+				 ring->buf_size, DMA_FROM_DEVICE);
+		pktlen = RX_DMA_GET_PLEN0(trxd.rxd2);
+
+		xdp.data_hard_start = data;
+		xdp.data = data + MTK_RX_HEADROOM + NET_IP_ALIGN;
+		xdp_set_data_meta_invalid(&xdp);
+		xdp.data_end = xdp.data + pktlen;
+
+		if (ring == &eth->rx_ring[0] &&
+		    mtk_xdp_run(ring, &xdp, netdev) != XDP_PASS) {
+			xdp_flush = true;
+			goto refill;
+		}
+
 		/* receive data */
 		skb = build_skb(data, ring->frag_size);
 		if (unlikely(!skb)) {
-			skb_free_frag(new_data);
+			skb_free_frag(data);
 			netdev->stats.rx_dropped++;
-			goto release_desc;
+			goto refill;
 		}
-		skb_reserve(skb, NET_SKB_PAD + NET_IP_ALIGN);
-
-		dma_unmap_single(eth->dev, trxd.rxd1,
-				 ring->buf_size, DMA_FROM_DEVICE);
-		pktlen = RX_DMA_GET_PLEN0(trxd.rxd2);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
 		skb->dev = netdev;
-		skb_put(skb, pktlen);
+		skb_put(skb, xdp.data_end - xdp.data);
 		if (trxd.rxd4 & eth->rx_dma_l4_valid)
 			skb->ip_summed = CHECKSUM_UNNECESSARY;
 		else
@@ -1346,6 +1401,7 @@ static int mtk_poll_rx(struct napi_struct *napi, int budget,
 		skb_record_rx_queue(skb, 0);
 		napi_gro_receive(napi, skb);
 
+refill:
 		ring->data[idx] = new_data;
 		rxd->rxd1 = (unsigned int)dma_addr;
 
@@ -1361,6 +1417,9 @@ static int mtk_poll_rx(struct napi_struct *napi, int budget,
 	}
 
 rx_done:
+	if (xdp_flush)
+		xdp_do_flush();
+
 	if (done) {
 		/* make sure that all changes to the dma ring are flushed before
 		 * we continue
@@ -1713,7 +1772,7 @@ static int mtk_rx_alloc(struct mtk_eth *eth, int ring_no, int rx_flag)
 
 	for (i = 0; i < rx_dma_size; i++) {
 		dma_addr_t dma_addr = dma_map_single(eth->dev,
-				ring->data[i] + NET_SKB_PAD + eth->ip_align,
+				ring->data[i] + MTK_RX_HEADROOM + eth->ip_align,
 				ring->buf_size,
 				DMA_FROM_DEVICE);
 		if (unlikely(dma_mapping_error(eth->dev, dma_addr)))
@@ -1729,6 +1788,19 @@ static int mtk_rx_alloc(struct mtk_eth *eth, int ring_no, int rx_flag)
 	ring->calc_idx_update = false;
 	ring->calc_idx = rx_dma_size - 1;
 	ring->crx_idx_reg = MTK_PRX_CRX_IDX_CFG(ring_no);
+
+	/* XDP only runs on the normal ring, shared by all MACs */
+	if (rx_flag == MTK_RX_FLAGS_NORMAL) {
+		int err;
+
+		err = xdp_rxq_info_reg(&ring->xdp_q, &eth->dummy_dev, ring_no);
+		if (err)
+			return err;
+		err = xdp_rxq_info_reg_mem_model(&ring->xdp_q,
+						 MEM_TYPE_PAGE_SHARED, NULL);
+		if (err)
+			return err;
+	}
 	/* make sure that all changes to the dma ring are flushed before we
 	 * continue
 	 */
@@ -1769,6 +1841,9 @@ static void mtk_rx_clean(struct mtk_eth *eth, struct mtk_rx_ring *ring)
 				  ring->phys);
 		ring->dma = NULL;
 	}
+
+	if (xdp_rxq_info_is_reg(&ring->xdp_q))
+		xdp_rxq_info_unreg(&ring->xdp_q);
 }
 
 static int mtk_hwlro_rx_init(struct mtk_eth *eth)
@@ -2033,6 +2108,37 @@ static int mtk_set_features(struct net_device *dev, netdev_features_t features)
 	return err;
 }
 
+static int mtk_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			 struct netlink_ext_ack *extack)
+{
+	struct mtk_mac *mac = netdev_priv(dev);
+	struct mtk_eth *eth = mac->hw;
+	struct bpf_prog *old_prog;
+
+	if (eth->hwlro) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP is not supported with HW LRO");
+		return -EOPNOTSUPP;
+	}
+
+	/* buffers carry XDP headroom already, no need to restart the rings */
+	old_prog = rcu_replace_pointer(mac->xdp_prog, prog,
+				       lockdep_rtnl_is_held());
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int mtk_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return mtk_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 /* wait for DMA to finish whatever it is doing before we start using it again */
 static int mtk_dma_busy_wait(struct mtk_eth *eth)
 {
@@ -2276,12 +2382,17 @@ static int mtk_open(struct net_device *dev)
 
 	/* we run 2 netdevs on the same dma ring so we only bring it up once */
 	if (!refcount_read(&eth->dma_refcnt)) {
-		int err = mtk_start_dma(eth);
+		u32 gdm_config = MTK_GDMA_TO_PDMA;
+		int err;
 
+		err = mtk_start_dma(eth);
 		if (err)
 			return err;
 
-		mtk_gdm_config(eth, MTK_GDMA_TO_PDMA);
+		if (eth->soc->offload_version && mtk_ppe_start(&eth->ppe) == 0)
+			gdm_config = MTK_GDMA_TO_PPE;
+
+		mtk_gdm_config(eth, gdm_config);
 
 		napi_enable(&eth->tx_napi);
 		napi_enable(&eth->rx_napi);
@@ -2337,6 +2448,9 @@ static int mtk_stop(struct net_device *dev)
 
 	mtk_gdm_config(eth, MTK_GDMA_DROP_ALL);
 
+	if (eth->soc->offload_version)
+		mtk_ppe_stop(&eth->ppe);
+
 	mtk_tx_irq_disable(eth, MTK_TX_DONE_INT);
 	mtk_rx_irq_disable(eth, MTK_RX_DONE_INT);
 	napi_disable(&eth->tx_napi);
@@ -2820,6 +2934,8 @@ static const struct net_device_ops mtk_netdev_ops = {
 	.ndo_get_stats64        = mtk_get_stats64,
 	.ndo_fix_features	= mtk_fix_features,
 	.ndo_set_features	= mtk_set_features,
+	.ndo_bpf		= mtk_xdp,
+	.ndo_setup_tc		= mtk_eth_setup_tc,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller	= mtk_poll_controller,
 #endif
@@ -2908,6 +3024,8 @@ static int mtk_add_mac(struct mtk_eth *eth, struct device_node *np)
 	eth->netdev[id]->hw_features = eth->soc->hw_features;
 	if (eth->hwlro)
 		eth->netdev[id]->hw_features |= NETIF_F_LRO;
+	if (eth->soc->offload_version)
+		eth->netdev[id]->hw_features |= NETIF_F_HW_TC;
 
 	eth->netdev[id]->vlan_features = eth->soc->hw_features &
 		~(NETIF_F_HW_VLAN_CTAG_TX | NETIF_F_HW_VLAN_CTAG_RX);
@@ -3069,6 +3187,17 @@ static int mtk_probe(struct platform_device *pdev)
 	if (err)
 		goto err_free_dev;
 
+	if (eth->soc->offload_version) {
+		err = mtk_ppe_init(&eth->ppe, eth->dev,
+				   eth->base + MTK_ETH_PPE_BASE, 2);
+		if (err)
+			goto err_free_dev;
+
+		err = mtk_eth_offload_init(eth);
+		if (err)
+			goto err_free_dev;
+	}
+
 	/* No MT7628/88 support yet */
 	if (!MTK_HAS_CAPS(eth->soc->caps, MTK_SOC_MT7628)) {
 		err = mtk_mdio_init(eth);
@@ -3150,6 +3279,7 @@ static const struct mtk_soc_data mt7621_data = {
 	.hw_features = MTK_HW_FEATURES,
 	.required_clks = MT7621_CLKS_BITMAP,
 	.required_pctl = false,
+	.offload_version = 2,
 };
 
 static const struct mtk_soc_data mt7622_data = {
@@ -3158,6 +3288,7 @@ static const struct mtk_soc_data mt7622_data = {
 	.hw_features = MTK_HW_FEATURES,
 	.required_clks = MT7622_CLKS_BITMAP,
 	.required_pctl = false,
+	.offload_version = 2,
 };
 
 static const struct mtk_soc_data mt7623_data = {
@@ -3165,6 +3296,7 @@ static const struct mtk_soc_data mt7623_data = {
 	.hw_features = MTK_HW_FEATURES,
 	.required_clks = MT7623_CLKS_BITMAP,
 	.required_pctl = true,
+	.offload_version = 2,
 };
 
 static const struct mtk_soc_data mt7629_data = {
@@ -8,6 +8,7 @@
 #define __MT76x02_H
 
 #include <linux/kfifo.h>
+#include <linux/dim.h>
 
 #include "mt76.h"
 #include "mt76x02_regs.h"
@@ -90,6 +91,17 @@ struct mt76x02_dev {
 	u32 tx_airtime;
 	u32 ampdu_ref;
 
+	/* tx done interrupt moderation */
+	u32 tx_coal_done;
+	unsigned long tx_coal_time;
+	u8 tx_coal_level;
+
+	/* rx done interrupt moderation, driven by net_dim */
+	struct dim rx_dim;
+	u16 rx_dim_events;
+	u64 rx_dim_pkts;
+	u64 rx_dim_bytes;
+
 	struct sk_buff *rx_head;
 
 	struct delayed_work cal_work;
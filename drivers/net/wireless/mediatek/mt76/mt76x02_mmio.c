@@ -161,22 +161,125 @@ static void mt76x02_tx_worker(struct mt76_worker *w)
 	mt76_txq_schedule_all(&dev->mphy);
 }
 
+#define MT_TX_COAL_INTERVAL	(HZ / 4)
+
+/* tx done interrupt moderation levels, by completion rate */
+static const struct {
+	u32 rate;	/* frames per second, at least */
+	u8 pint;	/* max pending frames */
+	u8 ptime;	/* max pending time, in 20us units */
+} mt76x02_tx_coal[] = {
+	{ 0, 0, 0 },
+	{ 2000, 8, 25 },
+	{ 20000, 32, 50 },
+};
+
+static void mt76x02_tx_coal_update(struct mt76x02_dev *dev, int done)
+{
+	unsigned long elapsed = jiffies - dev->tx_coal_time;
+	u32 rate, val = 0;
+	int level;
+
+	dev->tx_coal_done += done;
+	if (elapsed < MT_TX_COAL_INTERVAL)
+		return;
+
+	rate = div_u64((u64)dev->tx_coal_done * HZ, elapsed);
+	dev->tx_coal_done = 0;
+	dev->tx_coal_time = jiffies;
+
+	for (level = ARRAY_SIZE(mt76x02_tx_coal) - 1; level > 0; level--)
+		if (rate >= mt76x02_tx_coal[level].rate)
+			break;
+
+	if (level == dev->tx_coal_level)
+		return;
+
+	dev->tx_coal_level = level;
+	if (level)
+		val = MT_WPDMA_DELAY_INT_TX_EN |
+		      FIELD_PREP(MT_WPDMA_DELAY_INT_TX_PINT,
+				 mt76x02_tx_coal[level].pint) |
+		      FIELD_PREP(MT_WPDMA_DELAY_INT_TX_PTIME,
+				 mt76x02_tx_coal[level].ptime);
+	mt76_rmw(dev, MT_WPDMA_DELAY_INT_CFG, MT_WPDMA_DELAY_INT_TX, val);
+}
+
+/*
+ * rx done interrupt moderation profiles, indexed by dim->profile_ix.
+ * Low indexes favour latency (one interrupt per frame), high indexes
+ * favour interrupt rate when net_dim sees bulk throughput.
+ */
+static const struct {
+	u8 pint;	/* max pending frames */
+	u8 ptime;	/* max pending time, in 20us units */
+} mt76x02_rx_coal[NET_DIM_PARAMS_NUM_PROFILES] = {
+	{ 0, 0 },
+	{ 4, 2 },
+	{ 8, 5 },
+	{ 16, 10 },
+	{ 32, 25 },
+};
+
+static void mt76x02_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct mt76x02_dev *dev = container_of(dim, struct mt76x02_dev,
+					       rx_dim);
+	u8 ix = dim->profile_ix;
+	u32 val = 0;
+
+	if (mt76x02_rx_coal[ix].pint)
+		val = MT_WPDMA_DELAY_INT_RX_EN |
+		      FIELD_PREP(MT_WPDMA_DELAY_INT_RX_PINT,
+				 mt76x02_rx_coal[ix].pint) |
+		      FIELD_PREP(MT_WPDMA_DELAY_INT_RX_PTIME,
+				 mt76x02_rx_coal[ix].ptime);
+	mt76_rmw(dev, MT_WPDMA_DELAY_INT_CFG, MT_WPDMA_DELAY_INT_RX, val);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void mt76x02_rx_dim_update(struct mt76x02_dev *dev)
+{
+	struct dim_sample sample = {};
+
+	dim_update_sample(++dev->rx_dim_events, dev->rx_dim_pkts,
+			  dev->rx_dim_bytes, &sample);
+	net_dim(&dev->rx_dim, sample);
+}
+
+static int mt76x02_tx_cleanup(struct mt76x02_dev *dev)
+{
+	int i, done = 0;
+
+	for (i = MT_TXQ_MCU; i >= 0; i--) {
+		struct mt76_queue *q = dev->mt76.q_tx[i];
+		int queued = q ? q->queued : 0;
+
+		mt76_queue_tx_cleanup(dev, i, false);
+		if (q)
+			done += queued - q->queued;
+	}
+
+	return done;
+}
+
 static int mt76x02_poll_tx(struct napi_struct *napi, int budget)
 {
 	struct mt76x02_dev *dev = container_of(napi, struct mt76x02_dev,
 					       mt76.tx_napi);
-	int i;
+	int done;
 
 	mt76x02_mac_poll_tx_status(dev, false);
 
-	for (i = MT_TXQ_MCU; i >= 0; i--)
-		mt76_queue_tx_cleanup(dev, i, false);
+	done = mt76x02_tx_cleanup(dev);
 
 	if (napi_complete_done(napi, 0))
 		mt76x02_irq_enable(dev, MT_INT_TX_DONE_ALL);
 
-	for (i = MT_TXQ_MCU; i >= 0; i--)
-		mt76_queue_tx_cleanup(dev, i, false);
+	done += mt76x02_tx_cleanup(dev);
+	mt76x02_tx_coal_update(dev, done);
 
 	mt76_worker_schedule(&dev->mt76.tx_worker);
 
@@ -198,6 +301,10 @@ int mt76x02_dma_init(struct mt76x02_dev *dev)
 		return -ENOMEM;
 
 	dev->mt76.tx_worker.fn = mt76x02_tx_worker;
+	dev->tx_coal_level = U8_MAX;
+	dev->tx_coal_time = jiffies;
+	INIT_WORK(&dev->rx_dim.work, mt76x02_rx_dim_work);
+	dev->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 	tasklet_init(&dev->mt76.pre_tbtt_tasklet, mt76x02_pre_tbtt_tasklet,
 		     (unsigned long)dev);
 
@@ -254,6 +361,8 @@ void mt76x02_rx_poll_complete(struct mt76_dev *mdev, enum mt76_rxq_id q)
 	struct mt76x02_dev *dev;
 
 	dev = container_of(mdev, struct mt76x02_dev, mt76);
+	if (q == MT_RXQ_MAIN)
+		mt76x02_rx_dim_update(dev);
 	mt76x02_irq_enable(dev, MT_INT_RX_DONE(q));
 }
 EXPORT_SYMBOL_GPL(mt76x02_rx_poll_complete);
@@ -474,6 +583,9 @@ static void mt76x02_watchdog_reset(struct mt76x02_dev *dev)
 
 	if (restart)
 		mt76_mcu_restart(dev);
+	/* the moderation setting may be gone, write it again */
+	dev->tx_coal_level = U8_MAX;
+	mt76x02_rx_dim_work(&dev->rx_dim.work);
 
 	for (i = 0; i < __MT_TXQ_MAX; i++)
 		mt76_queue_tx_cleanup(dev, i, true);
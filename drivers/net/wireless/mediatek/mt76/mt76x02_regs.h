@@ -137,6 +137,14 @@
 #define MT_WPDMA_RST_IDX		0x020c
 
 #define MT_WPDMA_DELAY_INT_CFG		0x0210
+#define MT_WPDMA_DELAY_INT_RX_PTIME	GENMASK(7, 0)
+#define MT_WPDMA_DELAY_INT_RX_PINT	GENMASK(14, 8)
+#define MT_WPDMA_DELAY_INT_RX_EN	BIT(15)
+#define MT_WPDMA_DELAY_INT_RX		GENMASK(15, 0)
+#define MT_WPDMA_DELAY_INT_TX_PTIME	GENMASK(23, 16)
+#define MT_WPDMA_DELAY_INT_TX_PINT	GENMASK(30, 24)
+#define MT_WPDMA_DELAY_INT_TX_EN	BIT(31)
+#define MT_WPDMA_DELAY_INT_TX		GENMASK(31, 16)
 
 #define MT_WMM_AIFSN			0x0214
 #define MT_WMM_AIFSN_MASK		GENMASK(3, 0)
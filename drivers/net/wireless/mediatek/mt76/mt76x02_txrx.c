@@ -43,6 +43,9 @@ void mt76x02_queue_rx_skb(struct mt76_dev *mdev, enum mt76_rxq_id q,
 		return;
 	}
 
+	dev->rx_dim_pkts++;
+	dev->rx_dim_bytes += skb->len;
+
 	skb_pull(skb, sizeof(struct mt76x02_rxwi));
 	if (mt76x02_mac_process_rx(dev, skb, rxwi)) {
 		dev_kfree_skb(skb);
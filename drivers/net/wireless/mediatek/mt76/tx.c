@@ -440,8 +440,6 @@ mt76_txq_send_burst(struct mt76_phy *phy, struct mt76_queue *q,
 		n_frames++;
 	} while (1);
 
-	dev->queue_ops->kick(dev, q);
-
 	return n_frames;
 }
 
@@ -454,8 +452,10 @@ mt76_txq_schedule_list(struct mt76_phy *phy, enum mt76_txq_id qid)
 	struct mt76_txq *mtxq;
 	struct mt76_wcid *wcid;
 	int ret = 0;
+	u16 head;
 
 	spin_lock_bh(&q->lock);
+	head = q->head;
 	while (1) {
 		if (test_bit(MT76_STATE_PM, &phy->state) ||
 		    test_bit(MT76_RESET, &phy->state)) {
@@ -491,6 +491,12 @@ mt76_txq_schedule_list(struct mt76_phy *phy, enum mt76_txq_id qid)
 		ret += mt76_txq_send_burst(phy, q, mtxq);
 		ieee80211_return_txq(phy->hw, txq, false);
 	}
+
+	/* one doorbell for all bursts of this pass; a pass never fills
+	 * the whole ring, so an unchanged head means nothing was queued
+	 */
+	if (q->head != head)
+		dev->queue_ops->kick(dev, q);
 	spin_unlock_bh(&q->lock);
 
 	return ret;
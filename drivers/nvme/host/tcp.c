@@ -127,6 +127,7 @@ struct nvme_tcp_queue {
 	size_t			data_remaining;
 	size_t			ddgst_remaining;
 	unsigned int		nr_cqe;
+	unsigned int		nr_r2t;
 
 	/* send state */
 	struct nvme_tcp_request *request;
@@ -677,7 +678,9 @@ static int nvme_tcp_handle_r2t(struct nvme_tcp_queue *queue,
 	req->state = NVME_TCP_SEND_H2C_PDU;
 	req->offset = 0;
 
-	nvme_tcp_queue_request(req, false, true);
+	/* sent in one batch once the receive pass is done */
+	nvme_tcp_queue_request(req, false, false);
+	queue->nr_r2t++;
 
 	return 0;
 }
@@ -1156,6 +1159,23 @@ static int nvme_tcp_try_send(struct nvme_tcp_queue *queue)
 	return ret;
 }
 
+/*
+ * R2Ts seen in one receive pass were only queued. Send all of their
+ * H2C data now instead of scheduling io_work once per R2T, directly
+ * if we are on the queue's io_cpu and nobody else is sending.
+ */
+static void nvme_tcp_send_r2t_batch(struct nvme_tcp_queue *queue)
+{
+	if (queue->io_cpu == raw_smp_processor_id() &&
+	    mutex_trylock(&queue->send_mutex)) {
+		nvme_tcp_send_all(queue);
+		mutex_unlock(&queue->send_mutex);
+	}
+
+	if (nvme_tcp_queue_more(queue))
+		queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+}
+
 static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 {
 	struct socket *sock = queue->sock;
@@ -1167,8 +1187,12 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	rd_desc.count = 1;
 	lock_sock(sk);
 	queue->nr_cqe = 0;
+	queue->nr_r2t = 0;
 	consumed = sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
 	release_sock(sk);
+
+	if (queue->nr_r2t)
+		nvme_tcp_send_r2t_batch(queue);
 	return consumed;
 }
 
@@ -24,6 +24,8 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
+#include <linux/interval_tree_generic.h>
+#include <linux/huge_mm.h>
 #include "ashmem.h"
 
 #define ASHMEM_NAME_PREFIX "dev/ashmem/"
@@ -33,7 +35,7 @@
 /**
  * struct ashmem_area - The anonymous shared memory area
  * @name:		The optional name in /proc/pid/maps
- * @unpinned_list:	The list of all ashmem areas
+ * @unpinned_tree:	The unpinned ranges of this area, indexed by page
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
@@ -45,7 +47,7 @@
  */
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN];
-	struct list_head unpinned_list;
+	struct rb_root_cached unpinned_tree;
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
@@ -54,7 +56,8 @@ struct ashmem_area {
 /**
  * struct ashmem_range - A range of unpinned/evictable pages
  * @lru:	         The entry in the LRU list
- * @unpinned:	         The entry in its area's unpinned list
+ * @rb:		         The node in its area's unpinned tree
+ * @subtree_last:        The last page of the subtree rooted at @rb
  * @asma:	         The associated anonymous shared memory area.
  * @pgstart:	         The starting page (inclusive)
  * @pgend:	         The ending page (inclusive)
@@ -65,13 +68,20 @@ struct ashmem_area {
  */
 struct ashmem_range {
 	struct list_head lru;
-	struct list_head unpinned;
+	struct rb_node rb;
+	size_t subtree_last;
 	struct ashmem_area *asma;
 	size_t pgstart;
 	size_t pgend;
 	unsigned int purged;
 };
 
+#define range_tree_start(range)	((range)->pgstart)
+#define range_tree_last(range)	((range)->pgend)
+
+INTERVAL_TREE_DEFINE(struct ashmem_range, rb, size_t, subtree_last,
+		     range_tree_start, range_tree_last, static, range_tree)
+
 /* LRU list of unpinned pages, protected by ashmem_mutex */
 static LIST_HEAD(ashmem_lru_list);
 
@@ -126,23 +136,6 @@ static inline bool page_range_subsumed_by_range(struct ashmem_range *range,
 	return (range->pgstart <= start) && (range->pgend >= end);
 }
 
-static inline bool page_in_range(struct ashmem_range *range, size_t page)
-{
-	return (range->pgstart <= page) && (range->pgend >= page);
-}
-
-static inline bool page_range_in_range(struct ashmem_range *range,
-				       size_t start, size_t end)
-{
-	return page_in_range(range, start) || page_in_range(range, end) ||
-		page_range_subsumes_range(range, start, end);
-}
-
-static inline bool range_before_page(struct ashmem_range *range,
-				     size_t page)
-{
-	return range->pgend < page;
-}
 
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
@@ -175,15 +168,13 @@ static inline void lru_del(struct ashmem_range *range)
 /**
  * range_alloc() - Allocates and initializes a new ashmem_range structure
  * @asma:	   The associated ashmem_area
- * @prev_range:	   The previous ashmem_range in the sorted asma->unpinned list
  * @purged:	   Initial purge status (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
  * This function is protected by ashmem_mutex.
  */
-static void range_alloc(struct ashmem_area *asma,
-			struct ashmem_range *prev_range, unsigned int purged,
+static void range_alloc(struct ashmem_area *asma, unsigned int purged,
 			size_t start, size_t end,
 			struct ashmem_range **new_range)
 {
@@ -195,7 +186,7 @@ static void range_alloc(struct ashmem_area *asma,
 	range->pgend = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	range_tree_insert(range, &asma->unpinned_tree);
 
 	if (range_on_lru(range))
 		lru_add(range);
@@ -207,7 +198,7 @@ static void range_alloc(struct ashmem_area *asma,
  */
 static void range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
+	range_tree_remove(range, &range->asma->unpinned_tree);
 	if (range_on_lru(range))
 		lru_del(range);
 	kmem_cache_free(ashmem_range_cachep, range);
@@ -230,8 +221,11 @@ static inline void range_shrink(struct ashmem_range *range,
 {
 	size_t pre = range_size(range);
 
+	/* the interval tree is keyed on the bounds, re-index the range */
+	range_tree_remove(range, &range->asma->unpinned_tree);
 	range->pgstart = start;
 	range->pgend = end;
+	range_tree_insert(range, &range->asma->unpinned_tree);
 
 	if (range_on_lru(range))
 		lru_count -= pre - range_size(range);
@@ -260,7 +254,7 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	if (!asma)
 		return -ENOMEM;
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	asma->unpinned_tree = RB_ROOT_CACHED;
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -279,10 +273,11 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 
 	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
+	while ((range = range_tree_iter_first(&asma->unpinned_tree,
+					      0, SIZE_MAX)))
 		range_del(range);
 	mutex_unlock(&ashmem_mutex);
 
@@ -374,6 +369,22 @@ ashmem_vmfile_get_unmapped_area(struct file *file, unsigned long addr,
 	return current->mm->get_unmapped_area(file, addr, len, pgoff, flags);
 }
 
+/*
+ * Large shared regions get a PMD aligned address from shmem, so that they
+ * can be backed by huge pages.
+ */
+static unsigned long
+ashmem_get_unmapped_area(struct file *file, unsigned long addr,
+			 unsigned long len, unsigned long pgoff,
+			 unsigned long flags)
+{
+	if (IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE) &&
+	    (flags & MAP_SHARED) && len >= HPAGE_PMD_SIZE)
+		return shmem_get_unmapped_area(NULL, addr, len, pgoff, flags);
+
+	return current->mm->get_unmapped_area(file, addr, len, pgoff, flags);
+}
+
 static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	static struct file_operations vmfile_fops;
@@ -450,6 +461,16 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 		vma_set_anonymous(vma);
 	}
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/*
+	 * Same as madvise(MADV_HUGEPAGE): large regions fault in huge pages
+	 * unless THP (or THP for shmem) is disabled altogether. Purging a
+	 * partial huge page just splits it.
+	 */
+	if (vma->vm_end - vma->vm_start >= HPAGE_PMD_SIZE)
+		vma->vm_flags |= VM_HUGEPAGE;
+#endif
+
 	if (vma->vm_file)
 		fput(vma->vm_file);
 	vma->vm_file = asma->file;
@@ -637,10 +658,14 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
 	struct ashmem_range *range, *next;
 	int ret = ASHMEM_NOT_PURGED;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* moved past last applicable page; we can short circuit */
-		if (range_before_page(range, pgstart))
-			break;
+	/*
+	 * Only ranges overlapping [pgstart, pgend] are visited. The adjusted
+	 * ranges no longer overlap it, so @next stays a valid cursor.
+	 */
+	for (range = range_tree_iter_first(&asma->unpinned_tree,
+					   pgstart, pgend);
+	     range; range = next) {
+		next = range_tree_iter_next(range, pgstart, pgend);
 
 		/*
 		 * The user can ask us to pin pages that span multiple ranges,
@@ -657,38 +682,35 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
 		 *    so we have to update one side of the range and then
 		 *    create a new range for the other side.
 		 */
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			/* Case #1: Easy. Just nuke the whole thing. */
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
-
-			/* Case #2: We overlap from the start, so adjust it */
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			/* Case #3: We overlap from the rear, so adjust it */
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart,
-					     pgstart - 1);
-				continue;
-			}
-
-			/*
-			 * Case #4: We eat a chunk out of the middle. A bit
-			 * more complicated, we allocate a new range for the
-			 * second half and adjust the first chunk's endpoint.
-			 */
-			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend, new_range);
+		ret |= range->purged;
+
+		/* Case #1: Easy. Just nuke the whole thing. */
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			range_del(range);
+			continue;
+		}
+
+		/* Case #2: We overlap from the start, so adjust it */
+		if (range->pgstart >= pgstart) {
+			range_shrink(range, pgend + 1, range->pgend);
+			continue;
+		}
+
+		/* Case #3: We overlap from the rear, so adjust it */
+		if (range->pgend <= pgend) {
 			range_shrink(range, range->pgstart, pgstart - 1);
-			break;
+			continue;
 		}
+
+		/*
+		 * Case #4: We eat a chunk out of the middle. A bit
+		 * more complicated, we allocate a new range for the
+		 * second half and adjust the first chunk's endpoint.
+		 */
+		range_alloc(asma, range->purged, pgend + 1, range->pgend,
+			    new_range);
+		range_shrink(range, range->pgstart, pgstart - 1);
+		break;
 	}
 
 	return ret;
@@ -702,31 +724,24 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
 			struct ashmem_range **new_range)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
+	while ((range = range_tree_iter_first(&asma->unpinned_tree,
+					      pgstart, pgend))) {
 		/*
 		 * The user can ask us to unpin pages that are already entirely
 		 * or partially pinned. We handle those two cases here.
 		 */
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min(range->pgstart, pgstart);
-			pgend = max(range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+		pgstart = min(range->pgstart, pgstart);
+		pgend = max(range->pgend, pgend);
+		purged |= range->purged;
+		range_del(range);
 	}
 
-	range_alloc(asma, range, purged, pgstart, pgend, new_range);
+	range_alloc(asma, purged, pgstart, pgend, new_range);
 	return 0;
 }
 
@@ -739,19 +754,37 @@ static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend,
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
+	if (range_tree_iter_first(&asma->unpinned_tree, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
 
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
+	return ASHMEM_IS_PINNED;
+}
 
-	return ret;
+/*
+ * ashmem_pin_pages - Converts @pin into the page interval it covers.
+ *
+ * Caller must hold ashmem_mutex.
+ */
+static int ashmem_pin_pages(struct ashmem_area *asma, struct ashmem_pin *pin,
+			    size_t *pgstart, size_t *pgend)
+{
+	/* per custom, you can pass zero for len to mean "everything onward" */
+	if (!pin->len)
+		pin->len = PAGE_ALIGN(asma->size) - pin->offset;
+
+	if ((pin->offset | pin->len) & ~PAGE_MASK)
+		return -EINVAL;
+
+	if (((__u32)-1) - pin->offset < pin->len)
+		return -EINVAL;
+
+	if (PAGE_ALIGN(asma->size) < pin->offset + pin->len)
+		return -EINVAL;
+
+	*pgstart = pin->offset / PAGE_SIZE;
+	*pgend = *pgstart + (pin->len / PAGE_SIZE) - 1;
+
+	return 0;
 }
 
 static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
@@ -777,22 +810,9 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	if (!asma->file)
 		goto out_unlock;
 
-	/* per custom, you can pass zero for len to mean "everything onward" */
-	if (!pin.len)
-		pin.len = PAGE_ALIGN(asma->size) - pin.offset;
-
-	if ((pin.offset | pin.len) & ~PAGE_MASK)
-		goto out_unlock;
-
-	if (((__u32)-1) - pin.offset < pin.len)
+	if (ashmem_pin_pages(asma, &pin, &pgstart, &pgend))
 		goto out_unlock;
 
-	if (PAGE_ALIGN(asma->size) < pin.offset + pin.len)
-		goto out_unlock;
-
-	pgstart = pin.offset / PAGE_SIZE;
-	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
-
 	switch (cmd) {
 	case ASHMEM_PIN:
 		ret = ashmem_pin(asma, pgstart, pgend, &range);
@@ -813,6 +833,82 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	return ret;
 }
 
+/*
+ * ashmem_pin_unpin_vec - ASHMEM_PIN_VEC and ASHMEM_UNPIN_VEC, which apply
+ * a batch of ranges under one ashmem_mutex hold. Every range is checked
+ * before any is applied. For PIN_VEC the return value is ASHMEM_WAS_PURGED
+ * if any of the ranges had been purged.
+ */
+static int ashmem_pin_unpin_vec(struct ashmem_area *asma, unsigned long cmd,
+				void __user *p)
+{
+	struct ashmem_pin_vec vec;
+	struct ashmem_pin *pins;
+	struct ashmem_range **ranges;
+	size_t pgstart, pgend;
+	int ret = 0, i;
+
+	if (copy_from_user(&vec, p, sizeof(vec)))
+		return -EFAULT;
+
+	if (!vec.count || vec.count > ASHMEM_PIN_VEC_MAX || vec.reserved)
+		return -EINVAL;
+
+	pins = memdup_user(u64_to_user_ptr(vec.pins),
+			   vec.count * sizeof(*pins));
+	if (IS_ERR(pins))
+		return PTR_ERR(pins);
+
+	/* each range may split one unpinned range, preallocate for all */
+	ranges = kcalloc(vec.count, sizeof(*ranges), GFP_KERNEL);
+	if (!ranges) {
+		ret = -ENOMEM;
+		goto out_free_pins;
+	}
+	for (i = 0; i < vec.count; i++) {
+		ranges[i] = kmem_cache_zalloc(ashmem_range_cachep, GFP_KERNEL);
+		if (!ranges[i]) {
+			ret = -ENOMEM;
+			goto out_free_ranges;
+		}
+	}
+
+	mutex_lock(&ashmem_mutex);
+	wait_event(ashmem_shrink_wait, !atomic_read(&ashmem_shrink_inflight));
+
+	ret = -EINVAL;
+	if (!asma->file)
+		goto out_unlock;
+
+	for (i = 0; i < vec.count; i++) {
+		if (ashmem_pin_pages(asma, &pins[i], &pgstart, &pgend))
+			goto out_unlock;
+	}
+
+	ret = ASHMEM_NOT_PURGED;
+	for (i = 0; i < vec.count; i++) {
+		pgstart = pins[i].offset / PAGE_SIZE;
+		pgend = pgstart + (pins[i].len / PAGE_SIZE) - 1;
+		if (cmd == ASHMEM_PIN_VEC)
+			ret |= ashmem_pin(asma, pgstart, pgend, &ranges[i]);
+		else
+			ashmem_unpin(asma, pgstart, pgend, &ranges[i]);
+	}
+
+out_unlock:
+	mutex_unlock(&ashmem_mutex);
+out_free_ranges:
+	for (i = 0; i < vec.count; i++) {
+		if (ranges[i])
+			kmem_cache_free(ashmem_range_cachep, ranges[i]);
+	}
+	kfree(ranges);
+out_free_pins:
+	kfree(pins);
+
+	return ret;
+}
+
 static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct ashmem_area *asma = file->private_data;
@@ -848,6 +944,10 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case ASHMEM_GET_PIN_STATUS:
 		ret = ashmem_pin_unpin(asma, cmd, (void __user *)arg);
 		break;
+	case ASHMEM_PIN_VEC:
+	case ASHMEM_UNPIN_VEC:
+		ret = ashmem_pin_unpin_vec(asma, cmd, (void __user *)arg);
+		break;
 	case ASHMEM_PURGE_ALL_CACHES:
 		ret = -EPERM;
 		if (capable(CAP_SYS_ADMIN)) {
@@ -906,6 +1006,7 @@ static const struct file_operations ashmem_fops = {
 	.read_iter = ashmem_read_iter,
 	.llseek = ashmem_llseek,
 	.mmap = ashmem_mmap,
+	.get_unmapped_area = ashmem_get_unmapped_area,
 	.unlocked_ioctl = ashmem_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = compat_ashmem_ioctl,
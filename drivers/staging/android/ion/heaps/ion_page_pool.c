@@ -5,6 +5,7 @@
  * Copyright (C) 2011 Google, Inc.
  */
 
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
@@ -14,9 +15,21 @@
 
 static inline struct page *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
+	struct page *page;
+	u64 start, us;
+
 	if (fatal_signal_pending(current))
 		return NULL;
-	return alloc_pages(pool->gfp_mask, pool->order);
+
+	start = ktime_get_ns();
+	page = alloc_pages(pool->gfp_mask, pool->order);
+	us = (ktime_get_ns() - start) / NSEC_PER_USEC;
+
+	atomic_long_inc(&pool->alloc_lat[min_t(unsigned int, fls64(us),
+					       ION_PAGE_POOL_LAT_BUCKETS - 1)]);
+	if (!page)
+		atomic_long_inc(&pool->alloc_fails);
+	return page;
 }
 
 static void ion_page_pool_free_pages(struct ion_page_pool *pool,
@@ -74,10 +87,13 @@ struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
 		page = ion_page_pool_remove(pool, false);
 	mutex_unlock(&pool->mutex);
 
-	if (!page)
-		page = ion_page_pool_alloc_pages(pool);
+	if (page) {
+		atomic_long_inc(&pool->hits);
+		return page;
+	}
 
-	return page;
+	atomic_long_inc(&pool->misses);
+	return ion_page_pool_alloc_pages(pool);
 }
 EXPORT_SYMBOL_GPL(ion_page_pool_alloc);
 
@@ -148,7 +164,7 @@ EXPORT_SYMBOL_GPL(ion_page_pool_shrink);
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
-	struct ion_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	struct ion_page_pool *pool = kzalloc(sizeof(*pool), GFP_KERNEL);
 
 	if (!pool)
 		return NULL;
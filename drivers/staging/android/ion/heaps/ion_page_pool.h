@@ -8,6 +8,7 @@
 #ifndef _ION_PAGE_POOL_H
 #define _ION_PAGE_POOL_H
 
+#include <linux/atomic.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
 #include <linux/shrinker.h>
@@ -21,6 +22,9 @@
  * many systems
  */
 
+/* buddy allocation latency buckets: <1us, then powers of two up to ~16ms */
+#define ION_PAGE_POOL_LAT_BUCKETS	16
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -32,6 +36,10 @@
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @hits:		allocations served from the pool
+ * @misses:		allocations that had to go to the buddy allocator
+ * @alloc_fails:	buddy allocations that failed
+ * @alloc_lat:		histogram of buddy allocation latency, log2 usecs
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -47,6 +55,10 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t alloc_fails;
+	atomic_long_t alloc_lat[ION_PAGE_POOL_LAT_BUCKETS];
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
@@ -6,6 +6,7 @@
  */
 
 #include <asm/page.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
@@ -13,6 +14,7 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 
@@ -41,9 +43,14 @@ static inline unsigned int order_to_size(int order)
 	return PAGE_SIZE << order;
 }
 
+/*
+ * @fallbacks counts, per order, pages that were handed out at a lower
+ * order although the remaining size would have taken one of this order.
+ */
 struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool *pools[NUM_ORDERS];
+	atomic_long_t fallbacks[NUM_ORDERS];
 };
 
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
@@ -96,6 +103,20 @@ static struct page *alloc_largest_available(struct ion_system_heap *heap,
 	return NULL;
 }
 
+static void ion_system_heap_account_page(struct ion_system_heap *heap,
+					 unsigned long size, struct page *page)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		if (size < order_to_size(orders[i]))
+			continue;
+		if (compound_order(page) < orders[i])
+			atomic_long_inc(&heap->fallbacks[i]);
+		return;
+	}
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				    struct ion_buffer *buffer,
 				    unsigned long size,
@@ -121,6 +142,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 					       max_order);
 		if (!page)
 			goto free_pages;
+		ion_system_heap_account_page(sys_heap, size_remaining, page);
 		list_add_tail(&page->lru, &pages);
 		size_remaining -= page_size(page);
 		max_order = compound_order(page);
@@ -254,6 +276,35 @@ static int ion_system_heap_create_pools(struct ion_page_pool **pools)
 	return -ENOMEM;
 }
 
+static int ion_system_heap_stats_show(struct seq_file *s, void *unused)
+{
+	struct ion_system_heap *sys_heap = s->private;
+	int i, j;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		struct ion_page_pool *pool = sys_heap->pools[i];
+
+		seq_printf(s, "order%u: fallbacks:%ld pool:%d hits:%ld misses:%ld fails:%ld\n",
+			   orders[i], atomic_long_read(&sys_heap->fallbacks[i]),
+			   READ_ONCE(pool->high_count) +
+			   READ_ONCE(pool->low_count),
+			   atomic_long_read(&pool->hits),
+			   atomic_long_read(&pool->misses),
+			   atomic_long_read(&pool->alloc_fails));
+
+		/* bucket j holds latencies below 2^j us, the last one the rest */
+		seq_puts(s, "\tbuddy latency(us):");
+		for (j = 0; j < ION_PAGE_POOL_LAT_BUCKETS - 1; j++)
+			seq_printf(s, " <%lu:%ld", 1UL << j,
+				   atomic_long_read(&pool->alloc_lat[j]));
+		seq_printf(s, " >=%lu:%ld\n", 1UL << (j - 1),
+			   atomic_long_read(&pool->alloc_lat[j]));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ion_system_heap_stats);
+
 static struct ion_heap_ops system_heap_ops = {
 	.allocate = ion_system_heap_allocate,
 	.free = ion_system_heap_free,
@@ -276,7 +327,15 @@ static int __init ion_system_heap_init(void)
 	if (ret)
 		return ret;
 
-	return ion_device_add_heap(&system_heap.heap);
+	ret = ion_device_add_heap(&system_heap.heap);
+	if (ret) {
+		ion_system_heap_destroy_pools(system_heap.pools);
+		return ret;
+	}
+
+	debugfs_create_file("stats", 0444, system_heap.heap.debugfs_dir,
+			    &system_heap, &ion_system_heap_stats_fops);
+	return 0;
 }
 
 static void __exit ion_system_heap_exit(void)
@@ -6,6 +6,7 @@
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -14,6 +15,8 @@
 #include <linux/uaccess.h>
 #include "optee_private.h"
 #include "optee_smc.h"
+#define CREATE_TRACE_POINTS
+#include "optee_trace.h"
 
 struct optee_call_waiter {
 	struct list_head list_node;
@@ -114,16 +117,18 @@ static struct optee_session *find_session(struct optee_context_data *ctxdata,
 }
 
 /**
- * optee_do_call_with_arg() - Do an SMC to OP-TEE in secure world
+ * optee_do_call_with_stats() - Do an SMC to OP-TEE in secure world
  * @ctx:	calling context
  * @parg:	physical address of message to pass to secure world
+ * @stats:	if not NULL, accumulates where the time of the call went
  *
  * Does and SMC to OP-TEE in secure world and handles eventual resulting
  * Remote Procedure Calls (RPC) from OP-TEE.
  *
  * Returns return code from secure world, 0 is OK
  */
-u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
+u32 optee_do_call_with_stats(struct tee_context *ctx, phys_addr_t parg,
+			     struct optee_call_stats *stats)
 {
 	struct optee *optee = tee_get_drvdata(ctx->teedev);
 	struct optee_call_waiter w;
@@ -137,10 +142,19 @@ u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
 	optee_cq_wait_init(&optee->call_queue, &w);
 	while (true) {
 		struct arm_smccc_res res;
+		u64 t = 0;
 
+		if (stats)
+			t = ktime_get_ns();
+		trace_optee_invoke_fn_begin(&param);
 		optee->invoke_fn(param.a0, param.a1, param.a2, param.a3,
 				 param.a4, param.a5, param.a6, param.a7,
 				 &res);
+		trace_optee_invoke_fn_end(&param, &res);
+		if (stats) {
+			stats->smc_ns += ktime_get_ns() - t;
+			stats->smc_count++;
+		}
 
 		if (res.a0 == OPTEE_SMC_RETURN_ETHREAD_LIMIT) {
 			/*
@@ -155,7 +169,11 @@ u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
 			param.a1 = res.a1;
 			param.a2 = res.a2;
 			param.a3 = res.a3;
+			if (stats)
+				t = ktime_get_ns();
 			optee_handle_rpc(ctx, &param, &call_ctx);
+			if (stats)
+				stats->rpc_ns += ktime_get_ns() - t;
 		} else {
 			ret = res.a0;
 			break;
@@ -172,16 +190,65 @@ u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
 	return ret;
 }
 
+/**
+ * optee_do_call_with_arg() - Do an SMC to OP-TEE in secure world
+ * @ctx:	calling context
+ * @parg:	physical address of message to pass to secure world
+ *
+ * Returns return code from secure world, 0 is OK
+ */
+u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg)
+{
+	return optee_do_call_with_stats(ctx, parg, NULL);
+}
+
+static struct tee_shm *arg_cache_get(struct optee *optee)
+{
+	struct optee_arg_cache *cache = &optee->arg_cache;
+	struct tee_shm *shm = NULL;
+
+	mutex_lock(&cache->mutex);
+	if (cache->count)
+		shm = cache->shm[--cache->count];
+	mutex_unlock(&cache->mutex);
+
+	return shm;
+}
+
+void optee_free_arg_cache(struct optee *optee)
+{
+	struct optee_arg_cache *cache = &optee->arg_cache;
+
+	mutex_lock(&cache->mutex);
+	while (cache->count)
+		tee_shm_free(cache->shm[--cache->count]);
+	mutex_unlock(&cache->mutex);
+}
+
+/*
+ * Every call needs a message argument in shared memory. Allocating and
+ * freeing one from the pool per call shows up next to the SMC itself on
+ * short commands, so the common sizes are recycled instead.
+ */
 static struct tee_shm *get_msg_arg(struct tee_context *ctx, size_t num_params,
 				   struct optee_msg_arg **msg_arg,
 				   phys_addr_t *msg_parg)
 {
+	struct optee *optee = tee_get_drvdata(ctx->teedev);
 	int rc;
-	struct tee_shm *shm;
+	struct tee_shm *shm = NULL;
 	struct optee_msg_arg *ma;
 
-	shm = tee_shm_alloc(ctx, OPTEE_MSG_GET_ARG_SIZE(num_params),
-			    TEE_SHM_MAPPED | TEE_SHM_PRIV);
+	if (optee->ctx && num_params <= OPTEE_ARG_CACHE_PARAMS) {
+		shm = arg_cache_get(optee);
+		if (!shm)
+			shm = tee_shm_alloc(optee->ctx,
+				OPTEE_MSG_GET_ARG_SIZE(OPTEE_ARG_CACHE_PARAMS),
+				TEE_SHM_MAPPED | TEE_SHM_PRIV);
+	} else {
+		shm = tee_shm_alloc(ctx, OPTEE_MSG_GET_ARG_SIZE(num_params),
+				    TEE_SHM_MAPPED | TEE_SHM_PRIV);
+	}
 	if (IS_ERR(shm))
 		return shm;
 
@@ -207,6 +274,24 @@ static struct tee_shm *get_msg_arg(struct tee_context *ctx, size_t num_params,
 	return shm;
 }
 
+static void put_msg_arg(struct tee_context *ctx, struct tee_shm *shm)
+{
+	struct optee *optee = tee_get_drvdata(ctx->teedev);
+	struct optee_arg_cache *cache = &optee->arg_cache;
+
+	if (shm->ctx == optee->ctx) {
+		mutex_lock(&cache->mutex);
+		if (cache->count < OPTEE_ARG_CACHE_SIZE) {
+			cache->shm[cache->count++] = shm;
+			shm = NULL;
+		}
+		mutex_unlock(&cache->mutex);
+	}
+
+	if (shm)
+		tee_shm_free(shm);
+}
+
 int optee_open_session(struct tee_context *ctx,
 		       struct tee_ioctl_open_session_arg *arg,
 		       struct tee_param *param)
@@ -217,6 +302,9 @@ int optee_open_session(struct tee_context *ctx,
 	struct optee_msg_arg *msg_arg;
 	phys_addr_t msg_parg;
 	struct optee_session *sess = NULL;
+	struct optee_call_stats stats = { };
+	bool traced = trace_optee_call_done_enabled();
+	u64 start = traced ? ktime_get_ns() : 0;
 	uuid_t client_uuid;
 
 	/* +2 for the meta parameters added below */
@@ -254,14 +342,25 @@ int optee_open_session(struct tee_context *ctx,
 		goto out;
 	}
 
-	if (optee_do_call_with_arg(ctx, msg_parg)) {
+	if (optee_do_call_with_stats(ctx, msg_parg, traced ? &stats : NULL)) {
 		msg_arg->ret = TEEC_ERROR_COMMUNICATION;
 		msg_arg->ret_origin = TEEC_ORIGIN_COMMS;
 	}
 
+	if (traced) {
+		uuid_t uuid;
+
+		import_uuid(&uuid, arg->uuid);
+		trace_optee_call_done(&uuid, msg_arg->session,
+				      OPTEE_MSG_CMD_OPEN_SESSION, 0,
+				      msg_arg->ret, ktime_get_ns() - start,
+				      &stats);
+	}
+
 	if (msg_arg->ret == TEEC_SUCCESS) {
 		/* A new session has been created, add it to the list. */
 		sess->session_id = msg_arg->session;
+		import_uuid(&sess->uuid, arg->uuid);
 		mutex_lock(&ctxdata->mutex);
 		list_add(&sess->list_node, &ctxdata->sess_list);
 		mutex_unlock(&ctxdata->mutex);
@@ -280,7 +379,7 @@ int optee_open_session(struct tee_context *ctx,
 		arg->ret_origin = msg_arg->ret_origin;
 	}
 out:
-	tee_shm_free(shm);
+	put_msg_arg(ctx, shm);
 
 	return rc;
 }
@@ -311,7 +410,7 @@ int optee_close_session(struct tee_context *ctx, u32 session)
 	msg_arg->session = session;
 	optee_do_call_with_arg(ctx, msg_parg);
 
-	tee_shm_free(shm);
+	put_msg_arg(ctx, shm);
 	return 0;
 }
 
@@ -323,11 +422,17 @@ int optee_invoke_func(struct tee_context *ctx, struct tee_ioctl_invoke_arg *arg,
 	struct optee_msg_arg *msg_arg;
 	phys_addr_t msg_parg;
 	struct optee_session *sess;
+	struct optee_call_stats stats = { };
+	bool traced = trace_optee_call_done_enabled();
+	u64 start = traced ? ktime_get_ns() : 0;
+	uuid_t uuid;
 	int rc;
 
 	/* Check that the session is valid */
 	mutex_lock(&ctxdata->mutex);
 	sess = find_session(ctxdata, arg->session);
+	if (sess)
+		uuid = sess->uuid;
 	mutex_unlock(&ctxdata->mutex);
 	if (!sess)
 		return -EINVAL;
@@ -344,7 +449,7 @@ int optee_invoke_func(struct tee_context *ctx, struct tee_ioctl_invoke_arg *arg,
 	if (rc)
 		goto out;
 
-	if (optee_do_call_with_arg(ctx, msg_parg)) {
+	if (optee_do_call_with_stats(ctx, msg_parg, traced ? &stats : NULL)) {
 		msg_arg->ret = TEEC_ERROR_COMMUNICATION;
 		msg_arg->ret_origin = TEEC_ORIGIN_COMMS;
 	}
@@ -354,10 +459,16 @@ int optee_invoke_func(struct tee_context *ctx, struct tee_ioctl_invoke_arg *arg,
 		msg_arg->ret_origin = TEEC_ORIGIN_COMMS;
 	}
 
+	if (traced)
+		trace_optee_call_done(&uuid, arg->session,
+				      OPTEE_MSG_CMD_INVOKE_COMMAND, arg->func,
+				      msg_arg->ret, ktime_get_ns() - start,
+				      &stats);
+
 	arg->ret = msg_arg->ret;
 	arg->ret_origin = msg_arg->ret_origin;
 out:
-	tee_shm_free(shm);
+	put_msg_arg(ctx, shm);
 	return rc;
 }
 
@@ -385,7 +496,7 @@ int optee_cancel_req(struct tee_context *ctx, u32 cancel_id, u32 session)
 	msg_arg->cancel_id = cancel_id;
 	optee_do_call_with_arg(ctx, msg_parg);
 
-	tee_shm_free(shm);
+	put_msg_arg(ctx, shm);
 	return 0;
 }
 
@@ -555,14 +666,64 @@ static size_t get_pages_list_size(size_t num_entries)
 	return pages * OPTEE_MSG_NONCONTIG_PAGE_SIZE;
 }
 
+/*
+ * Single page lists cover registrations of up to 2MB, which is nearly
+ * all of them, so a few are kept instead of going back to the page
+ * allocator on every register and RPC buffer.
+ */
+#define PAGES_LIST_CACHE_SIZE	4
+
+static DEFINE_SPINLOCK(pages_list_lock);
+static void *pages_list_cache[PAGES_LIST_CACHE_SIZE];
+static unsigned int pages_list_count;
+
 u64 *optee_allocate_pages_list(size_t num_entries)
 {
-	return alloc_pages_exact(get_pages_list_size(num_entries), GFP_KERNEL);
+	size_t size = get_pages_list_size(num_entries);
+	void *list = NULL;
+
+	if (size == PAGE_SIZE) {
+		spin_lock(&pages_list_lock);
+		if (pages_list_count)
+			list = pages_list_cache[--pages_list_count];
+		spin_unlock(&pages_list_lock);
+		if (list)
+			return list;
+	}
+
+	return alloc_pages_exact(size, GFP_KERNEL);
 }
 
 void optee_free_pages_list(void *list, size_t num_entries)
 {
-	free_pages_exact(list, get_pages_list_size(num_entries));
+	size_t size = get_pages_list_size(num_entries);
+
+	if (size == PAGE_SIZE) {
+		spin_lock(&pages_list_lock);
+		if (pages_list_count < PAGES_LIST_CACHE_SIZE) {
+			pages_list_cache[pages_list_count++] = list;
+			list = NULL;
+		}
+		spin_unlock(&pages_list_lock);
+		if (!list)
+			return;
+	}
+
+	free_pages_exact(list, size);
+}
+
+void optee_free_pages_list_cache(void)
+{
+	void *list;
+
+	spin_lock(&pages_list_lock);
+	while (pages_list_count) {
+		list = pages_list_cache[--pages_list_count];
+		spin_unlock(&pages_list_lock);
+		free_pages_exact(list, PAGE_SIZE);
+		spin_lock(&pages_list_lock);
+	}
+	spin_unlock(&pages_list_lock);
 }
 
 static bool is_normal_memory(pgprot_t p)
@@ -654,7 +815,7 @@ int optee_shm_register(struct tee_context *ctx, struct tee_shm *shm,
 	    msg_arg->ret != TEEC_SUCCESS)
 		rc = -EINVAL;
 
-	tee_shm_free(shm_arg);
+	put_msg_arg(ctx, shm_arg);
 out:
 	optee_free_pages_list(pages_list, num_pages);
 	return rc;
@@ -679,7 +840,7 @@ int optee_shm_unregister(struct tee_context *ctx, struct tee_shm *shm)
 	if (optee_do_call_with_arg(ctx, msg_parg) ||
 	    msg_arg->ret != TEEC_SUCCESS)
 		rc = -EINVAL;
-	tee_shm_free(shm_arg);
+	put_msg_arg(ctx, shm_arg);
 	return rc;
 }
 
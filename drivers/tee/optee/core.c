@@ -588,6 +588,7 @@ static int optee_remove(struct platform_device *pdev)
 	/* Unregister OP-TEE specific client devices on TEE bus */
 	optee_unregister_devices();
 
+	optee_free_arg_cache(optee);
 	teedev_close_context(optee->ctx);
 	/*
 	 * Ask OP-TEE to free all cached shared memory objects to decrease
@@ -609,6 +610,8 @@ static int optee_remove(struct platform_device *pdev)
 	optee_wait_queue_exit(&optee->wait_queue);
 	optee_supp_uninit(&optee->supp);
 	mutex_destroy(&optee->call_queue.mutex);
+	mutex_destroy(&optee->arg_cache.mutex);
+	optee_free_pages_list_cache();
 
 	kfree(optee);
 
@@ -719,6 +722,7 @@ static int optee_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&optee->call_queue.waiters);
 	optee_wait_queue_init(&optee->wait_queue);
 	optee_supp_init(&optee->supp);
+	mutex_init(&optee->arg_cache.mutex);
 	optee->memremaped_shm = memremaped_shm;
 	optee->pool = pool;
 	ctx = teedev_open(optee->teedev);
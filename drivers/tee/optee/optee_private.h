@@ -66,6 +66,26 @@ struct optee_supp {
 	struct completion reqs_c;
 };
 
+/*
+ * Message arguments small enough for a regular open session or invoke
+ * (four parameters plus the two open session meta parameters) are
+ * allocated from @ctx and kept around once freed.
+ */
+#define OPTEE_ARG_CACHE_PARAMS	6
+#define OPTEE_ARG_CACHE_SIZE	8
+
+/**
+ * struct optee_arg_cache - free message argument buffers
+ * @mutex:		held while accessing content of this struct
+ * @shm:		cached buffers, all allocated from optee->ctx
+ * @count:		number of valid entries in @shm
+ */
+struct optee_arg_cache {
+	struct mutex mutex;
+	struct tee_shm *shm[OPTEE_ARG_CACHE_SIZE];
+	unsigned int count;
+};
+
 /**
  * struct optee - main service struct
  * @supp_teedev:	supplicant device
@@ -76,6 +96,7 @@ struct optee_supp {
  * @wait_queue:		queue of threads from secure world waiting for a
  *			secure world sync object
  * @supp:		supplicant synchronization struct for RPC to supplicant
+ * @arg_cache:		message argument buffers kept for reuse
  * @pool:		shared memory pool
  * @memremaped_shm	virtual address of memory in shared memory pool
  * @sec_caps:		secure world capabilities defined by
@@ -92,6 +113,7 @@ struct optee {
 	struct optee_call_queue call_queue;
 	struct optee_wait_queue wait_queue;
 	struct optee_supp supp;
+	struct optee_arg_cache arg_cache;
 	struct tee_shm_pool *pool;
 	void *memremaped_shm;
 	u32 sec_caps;
@@ -103,6 +125,7 @@ struct optee {
 struct optee_session {
 	struct list_head list_node;
 	u32 session_id;
+	uuid_t uuid;
 };
 
 struct optee_context_data {
@@ -122,6 +145,18 @@ struct optee_rpc_param {
 	u32	a7;
 };
 
+/**
+ * struct optee_call_stats - where the time of one STD call went
+ * @smc_ns:		time spent inside invoke_fn, secure world and switches
+ * @rpc_ns:		time spent in the normal world serving RPCs
+ * @smc_count:		number of world switches into secure world
+ */
+struct optee_call_stats {
+	u64 smc_ns;
+	u64 rpc_ns;
+	u32 smc_count;
+};
+
 /* Holds context that is preserved during one STD call */
 struct optee_call_ctx {
 	/* information about pages list used in last allocation */
@@ -151,6 +186,8 @@ int optee_supp_send(struct tee_context *ctx, u32 ret, u32 num_params,
 		    struct tee_param *param);
 
 u32 optee_do_call_with_arg(struct tee_context *ctx, phys_addr_t parg);
+u32 optee_do_call_with_stats(struct tee_context *ctx, phys_addr_t parg,
+			     struct optee_call_stats *stats);
 int optee_open_session(struct tee_context *ctx,
 		       struct tee_ioctl_open_session_arg *arg,
 		       struct tee_param *param);
@@ -180,6 +217,8 @@ int optee_to_msg_param(struct optee_msg_param *msg_params, size_t num_params,
 
 u64 *optee_allocate_pages_list(size_t num_entries);
 void optee_free_pages_list(void *array, size_t num_entries);
+void optee_free_pages_list_cache(void);
+void optee_free_arg_cache(struct optee *optee);
 void optee_fill_pages_list(u64 *dst, struct page **pages, int num_pages,
 			   size_t page_offset);
 
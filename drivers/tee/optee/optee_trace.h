@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * optee trace points
+ *
+ * Copyright (C) 2021 MediaTek Inc.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM optee
+
+#if !defined(_TRACE_OPTEE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_OPTEE_H
+
+#include <linux/arm-smccc.h>
+#include <linux/tracepoint.h>
+#include <linux/uuid.h>
+#include "optee_private.h"
+
+TRACE_EVENT(optee_invoke_fn_begin,
+	TP_PROTO(struct optee_rpc_param *param),
+	TP_ARGS(param),
+
+	TP_STRUCT__entry(
+		__field(void *, param)
+		__array(u32, args, 8)
+	),
+
+	TP_fast_assign(
+		__entry->param = param;
+		BUILD_BUG_ON(sizeof(*param) < sizeof(__entry->args));
+		memcpy(__entry->args, param, sizeof(__entry->args));
+	),
+
+	TP_printk("param=%p (%x, %x, %x, %x, %x, %x, %x, %x)", __entry->param,
+		  __entry->args[0], __entry->args[1], __entry->args[2],
+		  __entry->args[3], __entry->args[4], __entry->args[5],
+		  __entry->args[6], __entry->args[7])
+);
+
+TRACE_EVENT(optee_invoke_fn_end,
+	TP_PROTO(struct optee_rpc_param *param, struct arm_smccc_res *res),
+	TP_ARGS(param, res),
+
+	TP_STRUCT__entry(
+		__field(void *, param)
+		__array(unsigned long, rets, 4)
+	),
+
+	TP_fast_assign(
+		__entry->param = param;
+		BUILD_BUG_ON(sizeof(*res) < sizeof(__entry->rets));
+		memcpy(__entry->rets, res, sizeof(__entry->rets));
+	),
+
+	TP_printk("param=%p ret (%lx, %lx, %lx, %lx)", __entry->param,
+		  __entry->rets[0], __entry->rets[1], __entry->rets[2],
+		  __entry->rets[3])
+);
+
+/*
+ * One event per open session or invoke command, emitted on completion.
+ * @ta is the leading 64 bits of the TA UUID so it can be used as a hist
+ * trigger key, e.g. for per-TA, per-command latency distributions:
+ *
+ *   echo 'hist:keys=ta,func,secure_ns.log2' > events/optee/optee_call_done/trigger
+ *
+ * secure_ns covers world switches plus secure world execution, rpc_ns is
+ * normal world time spent servicing RPCs from the TA, driver_ns is the
+ * rest, including waiting for a free secure world thread.
+ */
+TRACE_EVENT(optee_call_done,
+	TP_PROTO(const uuid_t *uuid, u32 session, u32 cmd, u32 func, u32 ret,
+		 u64 total_ns, const struct optee_call_stats *stats),
+	TP_ARGS(uuid, session, cmd, func, ret, total_ns, stats),
+
+	TP_STRUCT__entry(
+		__field(u64, ta)
+		__array(u8, uuid, UUID_SIZE)
+		__field(u32, session)
+		__field(u32, cmd)
+		__field(u32, func)
+		__field(u32, ret)
+		__field(u64, total_ns)
+		__field(u64, driver_ns)
+		__field(u64, secure_ns)
+		__field(u64, rpc_ns)
+		__field(u32, smcs)
+	),
+
+	TP_fast_assign(
+		memcpy(&__entry->ta, uuid, sizeof(__entry->ta));
+		memcpy(__entry->uuid, uuid, UUID_SIZE);
+		__entry->session = session;
+		__entry->cmd = cmd;
+		__entry->func = func;
+		__entry->ret = ret;
+		__entry->total_ns = total_ns;
+		__entry->secure_ns = stats->smc_ns;
+		__entry->rpc_ns = stats->rpc_ns;
+		__entry->driver_ns = total_ns - stats->smc_ns - stats->rpc_ns;
+		__entry->smcs = stats->smc_count;
+	),
+
+	TP_printk("ta=%pUb session=0x%x cmd=%u func=0x%x ret=0x%x total_ns=%llu driver_ns=%llu secure_ns=%llu rpc_ns=%llu smcs=%u",
+		  __entry->uuid, __entry->session, __entry->cmd,
+		  __entry->func, __entry->ret, __entry->total_ns,
+		  __entry->driver_ns, __entry->secure_ns, __entry->rpc_ns,
+		  __entry->smcs)
+);
+
+#endif /* _TRACE_OPTEE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE optee_trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -49,11 +49,44 @@ static inline s64 div_frac(s64 x, s64 y)
 	return div_s64(x << FRAC_BITS, y);
 }
 
+/*
+ * Predictive mode: a per-actor linear thermal response model,
+ *
+ *	dT = sum(gain[i] * power[i]) + gain_bias * PA_MPC_BIAS_MW
+ *
+ * learnt online with normalised LMS, gains in Q16 mC per mW per period.
+ */
+#define PA_MPC_GAIN_BITS	16
+#define PA_MPC_BIAS_MW		1024
+#define PA_MPC_GAIN_INIT	(1 << (PA_MPC_GAIN_BITS - 6))
+#define PA_MPC_GAIN_MIN		1
+#define PA_MPC_MU_SHIFT		3
+#define PA_MPC_MIN_SAMPLES	16
+#define PA_MPC_HORIZON		4
+
+/**
+ * struct power_allocator_actor - learnt response of one power actor
+ * @cdev:	cooling device the entry was learnt for
+ * @gain:	temperature rise per mW over one period, Q16
+ * @weight:	performance value of a mW granted to this actor
+ */
+struct power_allocator_actor {
+	struct thermal_cooling_device *cdev;
+	s64 gain;
+	int weight;
+};
+
 /**
  * struct power_allocator_params - parameters for the power allocator governor
  * @allocated_tzp:	whether we have allocated tzp for this thermal zone and
  *			it needs to be freed on unbind
  * @err_integral:	accumulated error in the PID controller.
+ * @actors:	per-actor response model for the predictive mode
+ * @num_model_actors:	number of entries in @actors
+ * @gain_bias:	learnt response to everything that isn't an actor, Q16
+ * @samples:	number of periods the model has been trained on
+ * @have_prev:	the previous period was also throttled, so the last
+ *		temperature delta is a valid training sample
  * @prev_err:	error in the previous iteration of the PID controller.
  *		Used to calculate the derivative term.
  * @trip_switch_on:	first passive trip point of the thermal zone.  The
@@ -67,6 +100,11 @@ static inline s64 div_frac(s64 x, s64 y)
 struct power_allocator_params {
 	bool allocated_tzp;
 	s64 err_integral;
+	struct power_allocator_actor *actors;
+	int num_model_actors;
+	s64 gain_bias;
+	unsigned int samples;
+	bool have_prev;
 	s32 prev_err;
 	int trip_switch_on;
 	int trip_max_desired_temperature;
@@ -322,6 +360,190 @@ static void divvy_up_power(u32 *req_power, u32 *max_power, int num_actors,
 					extra_power) / capped_extra_power;
 }
 
+#ifdef CONFIG_THERMAL_GOV_POWER_ALLOCATOR_PREDICTIVE
+static int mpc_model_prepare(struct thermal_zone_device *tz, int num_actors)
+{
+	struct power_allocator_params *params = tz->governor_data;
+	struct power_allocator_actor *actors;
+	int i;
+
+	if (params->num_model_actors == num_actors)
+		return 0;
+
+	actors = kcalloc(num_actors, sizeof(*actors), GFP_KERNEL);
+	if (!actors)
+		return -ENOMEM;
+
+	for (i = 0; i < num_actors; i++)
+		actors[i].gain = PA_MPC_GAIN_INIT;
+
+	kfree(params->actors);
+	params->actors = actors;
+	params->num_model_actors = num_actors;
+	params->gain_bias = -PA_MPC_GAIN_INIT *
+		(s64)estimate_sustainable_power(tz) / PA_MPC_BIAS_MW;
+	params->samples = 0;
+	params->have_prev = false;
+
+	return 0;
+}
+
+static void mpc_model_set_actor(struct power_allocator_params *params, int i,
+				struct thermal_cooling_device *cdev, int weight)
+{
+	struct power_allocator_actor *actor = &params->actors[i];
+
+	if (actor->cdev != cdev) {
+		actor->cdev = cdev;
+		actor->gain = PA_MPC_GAIN_INIT;
+		params->samples = 0;
+	}
+	actor->weight = weight;
+}
+
+/*
+ * @power holds what each actor dissipated during the period that just
+ * ended, which is what moved the temperature from last_temperature.
+ */
+static void mpc_model_learn(struct thermal_zone_device *tz, u32 *power,
+			    int num_actors)
+{
+	struct power_allocator_params *params = tz->governor_data;
+	s64 pred, err, norm;
+	int i;
+
+	if (!params->have_prev)
+		return;
+
+	norm = (s64)PA_MPC_BIAS_MW * PA_MPC_BIAS_MW;
+	pred = params->gain_bias * PA_MPC_BIAS_MW;
+	for (i = 0; i < num_actors; i++) {
+		norm += (s64)power[i] * power[i];
+		pred += params->actors[i].gain * power[i];
+	}
+
+	err = tz->temperature - tz->last_temperature;
+	err -= pred >> PA_MPC_GAIN_BITS;
+	err = (err << PA_MPC_GAIN_BITS) >> PA_MPC_MU_SHIFT;
+
+	for (i = 0; i < num_actors; i++) {
+		struct power_allocator_actor *actor = &params->actors[i];
+
+		actor->gain += div64_s64(err * power[i], norm);
+		actor->gain = max_t(s64, actor->gain, PA_MPC_GAIN_MIN);
+	}
+	params->gain_bias += div64_s64(err * PA_MPC_BIAS_MW, norm);
+
+	if (params->samples < PA_MPC_MIN_SAMPLES)
+		params->samples++;
+}
+
+/**
+ * mpc_allocate() - allocate power from the learnt response model
+ * @tz:		thermal zone we are operating in
+ * @control_temp:	the target temperature
+ * @req_power:	each actor's requested power
+ * @max_power:	each actor's maximum power
+ * @granted_power:	output array: each actor's granted power
+ * @done:	scratch array of @num_actors entries
+ * @num_actors:	number of actors
+ *
+ * Spread the distance to @control_temp over PA_MPC_HORIZON periods and
+ * turn it into a heat budget using the model.  The budget is handed out
+ * in order of performance per degree (weight / gain), first up to each
+ * actor's request and then, if anything is left, up to its maximum.  For
+ * a linear model this maximises the weighted granted power under the
+ * temperature bound, and spreading the error over the horizon is what
+ * avoids the PID's overshoot and oscillation once the zone saturates.
+ *
+ * Return: true if power was allocated, false while the model isn't
+ * trained yet and the PID controller should be used instead.
+ */
+static bool mpc_allocate(struct thermal_zone_device *tz, int control_temp,
+			 u32 *req_power, u32 *max_power, u32 *granted_power,
+			 u32 *done, int num_actors)
+{
+	struct power_allocator_params *params = tz->governor_data;
+	s64 budget;
+	int pass, n, i;
+
+	if (params->samples < PA_MPC_MIN_SAMPLES)
+		return false;
+
+	budget = (s64)(control_temp - tz->temperature) / PA_MPC_HORIZON;
+	budget <<= PA_MPC_GAIN_BITS;
+	budget -= params->gain_bias * PA_MPC_BIAS_MW;
+
+	for (i = 0; i < num_actors; i++)
+		granted_power[i] = 0;
+
+	for (pass = 0; pass < 2; pass++) {
+		u32 *limit = pass ? max_power : req_power;
+
+		for (i = 0; i < num_actors; i++)
+			done[i] = 0;
+
+		for (n = 0; n < num_actors && budget > 0; n++) {
+			struct power_allocator_actor *best = NULL, *actor;
+			int best_i = 0;
+			s64 want, cost;
+
+			for (i = 0; i < num_actors; i++) {
+				actor = &params->actors[i];
+				if (done[i])
+					continue;
+				if (!best || (s64)actor->weight * best->gain >
+					     (s64)best->weight * actor->gain) {
+					best = actor;
+					best_i = i;
+				}
+			}
+			done[best_i] = 1;
+
+			if (limit[best_i] <= granted_power[best_i])
+				continue;
+
+			want = limit[best_i] - granted_power[best_i];
+			cost = want * best->gain;
+			if (cost > budget) {
+				want = div64_s64(budget, best->gain);
+				cost = budget;
+			}
+			granted_power[best_i] += want;
+			budget -= cost;
+		}
+	}
+
+	return true;
+}
+#else
+static inline int mpc_model_prepare(struct thermal_zone_device *tz,
+				    int num_actors)
+{
+	return 0;
+}
+
+static inline void mpc_model_set_actor(struct power_allocator_params *params,
+				       int i,
+				       struct thermal_cooling_device *cdev,
+				       int weight)
+{
+}
+
+static inline void mpc_model_learn(struct thermal_zone_device *tz,
+				   u32 *power, int num_actors)
+{
+}
+
+static inline bool mpc_allocate(struct thermal_zone_device *tz,
+				int control_temp, u32 *req_power,
+				u32 *max_power, u32 *granted_power,
+				u32 *done, int num_actors)
+{
+	return false;
+}
+#endif
+
 static int allocate_power(struct thermal_zone_device *tz,
 			  int control_temp)
 {
@@ -351,6 +573,10 @@ static int allocate_power(struct thermal_zone_device *tz,
 		goto unlock;
 	}
 
+	ret = mpc_model_prepare(tz, num_actors);
+	if (ret)
+		goto unlock;
+
 	/*
 	 * We need to allocate five arrays of the same size:
 	 * req_power, max_power, granted_power, extra_actor_power and
@@ -401,6 +627,8 @@ static int allocate_power(struct thermal_zone_device *tz,
 		if (power_actor_get_max_power(cdev, &max_power[i]))
 			continue;
 
+		mpc_model_set_actor(params, i, cdev, weight);
+
 		total_req_power += req_power[i];
 		max_allocatable_power += max_power[i];
 		total_weighted_req_power += weighted_req_power[i];
@@ -408,11 +636,22 @@ static int allocate_power(struct thermal_zone_device *tz,
 		i++;
 	}
 
-	power_range = pid_controller(tz, control_temp, max_allocatable_power);
+	mpc_model_learn(tz, req_power, i);
 
-	divvy_up_power(weighted_req_power, max_power, num_actors,
-		       total_weighted_req_power, power_range, granted_power,
-		       extra_actor_power);
+	if (mpc_allocate(tz, control_temp, req_power, max_power, granted_power,
+			 extra_actor_power, i)) {
+		power_range = 0;
+		for (i = 0; i < num_actors; i++)
+			power_range += granted_power[i];
+	} else {
+		power_range = pid_controller(tz, control_temp,
+					     max_allocatable_power);
+
+		divvy_up_power(weighted_req_power, max_power, num_actors,
+			       total_weighted_req_power, power_range,
+			       granted_power, extra_actor_power);
+	}
+	params->have_prev = true;
 
 	total_granted_power = 0;
 	i = 0;
@@ -509,6 +748,7 @@ static void reset_pid_controller(struct power_allocator_params *params)
 {
 	params->err_integral = 0;
 	params->prev_err = 0;
+	params->have_prev = false;
 }
 
 static void allow_maximum_power(struct thermal_zone_device *tz)
@@ -598,6 +838,7 @@ static void power_allocator_unbind(struct thermal_zone_device *tz)
 		tz->tzp = NULL;
 	}
 
+	kfree(params->actors);
 	kfree(tz->governor_data);
 	tz->governor_data = NULL;
 }
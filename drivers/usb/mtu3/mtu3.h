@@ -364,7 +364,9 @@ struct mtu3_request {
 	struct list_head list;
 	struct mtu3_ep *mep;
 	struct mtu3 *mtu;
-	struct qmu_gpd *gpd;
+	struct qmu_gpd *gpd;	/* the first one if chained */
+	int num_gpds;
+	void *bounce;		/* linear copy of an SG request, if any */
 	int epnum;
 };
 
@@ -10,6 +10,56 @@
 #include "mtu3.h"
 #include "mtu3_trace.h"
 
+/*
+ * QMU can't end an RX chain early on a short packet, and a long TX SG
+ * list would eat up the gpd ring, so such requests go through a linear
+ * bounce buffer instead.
+ */
+static int mtu3_map_bounce(struct mtu3_ep *mep, struct mtu3_request *mreq,
+		gfp_t gfp_flags)
+{
+	struct usb_request *req = &mreq->request;
+	struct mtu3 *mtu = mep->mtu;
+	enum dma_data_direction dir;
+
+	mreq->bounce = kmalloc(req->length, gfp_flags);
+	if (!mreq->bounce)
+		return -ENOMEM;
+
+	if (mep->is_in)
+		sg_copy_to_buffer(req->sg, req->num_sgs, mreq->bounce,
+				  req->length);
+
+	dir = mep->is_in ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	req->dma = dma_map_single(mtu->dev, mreq->bounce, req->length, dir);
+	if (dma_mapping_error(mtu->dev, req->dma)) {
+		kfree(mreq->bounce);
+		mreq->bounce = NULL;
+		req->dma = DMA_ADDR_INVALID;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void mtu3_unmap_bounce(struct mtu3_ep *mep, struct mtu3_request *mreq)
+{
+	struct usb_request *req = &mreq->request;
+	struct mtu3 *mtu = mep->mtu;
+	enum dma_data_direction dir;
+
+	dir = mep->is_in ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	dma_unmap_single(mtu->dev, req->dma, req->length, dir);
+
+	if (!mep->is_in)
+		sg_copy_from_buffer(req->sg, req->num_sgs, mreq->bounce,
+				    req->actual);
+
+	kfree(mreq->bounce);
+	mreq->bounce = NULL;
+	req->dma = DMA_ADDR_INVALID;
+}
+
 void mtu3_req_complete(struct mtu3_ep *mep,
 		     struct usb_request *req, int status)
 __releases(mep->mtu->lock)
@@ -26,7 +76,9 @@ __acquires(mep->mtu->lock)
 	spin_unlock(&mtu->lock);
 
 	/* ep0 makes use of PIO, needn't unmap it */
-	if (mep->epnum)
+	if (mreq->bounce)
+		mtu3_unmap_bounce(mep, mreq);
+	else if (mep->epnum)
 		usb_gadget_unmap_request(&mtu->g, req, mep->is_in);
 
 	dev_dbg(mtu->dev, "%s complete req: %p, sts %d, %d/%d\n",
@@ -305,7 +357,7 @@ static int mtu3_gadget_queue(struct usb_ep *ep,
 	if (!mtu->softconnect)
 		return -ESHUTDOWN;
 
-	if (!req->buf)
+	if (!req->buf && !req->num_sgs)
 		return -ENODATA;
 
 	if (mreq->mep != mep)
@@ -335,15 +387,19 @@ static int mtu3_gadget_queue(struct usb_ep *ep,
 	mreq->request.actual = 0;
 	mreq->request.status = -EINPROGRESS;
 
-	ret = usb_gadget_map_request(&mtu->g, req, mep->is_in);
+	if (req->num_sgs && (!mep->is_in || req->num_sgs > MTU3_SG_MAX_GPDS))
+		ret = mtu3_map_bounce(mep, mreq, gfp_flags);
+	else
+		ret = usb_gadget_map_request(&mtu->g, req, mep->is_in);
 	if (ret) {
 		dev_err(mtu->dev, "dma mapping failed\n");
 		return ret;
 	}
+	mreq->num_gpds = req->num_mapped_sgs ? req->num_mapped_sgs : 1;
 
 	spin_lock_irqsave(&mtu->lock, flags);
 
-	if (mtu3_prepare_transfer(mep)) {
+	if (mtu3_prepare_transfer(mep, mreq->num_gpds)) {
 		dev_info(mtu->dev, "prepare transfer failed\n");
 		ret = -EAGAIN;
 		goto error;
@@ -357,6 +413,13 @@ static int mtu3_gadget_queue(struct usb_ep *ep,
 	spin_unlock_irqrestore(&mtu->lock, flags);
 	trace_mtu3_gadget_queue(mreq);
 
+	if (ret) {
+		if (mreq->bounce)
+			mtu3_unmap_bounce(mep, mreq);
+		else
+			usb_gadget_unmap_request(&mtu->g, req, mep->is_in);
+	}
+
 	return ret;
 }
 
@@ -738,7 +801,7 @@ int mtu3_gadget_setup(struct mtu3 *mtu)
 	mtu->g.ops = &mtu3_gadget_ops;
 	mtu->g.max_speed = mtu->max_speed;
 	mtu->g.speed = USB_SPEED_UNKNOWN;
-	mtu->g.sg_supported = 0;
+	mtu->g.sg_supported = 1;
 	mtu->g.name = MTU3_DRIVER_NAME;
 	mtu->g.irq = mtu->irq;
 	mtu->is_active = 0;
@@ -13,7 +13,8 @@
  * By preparing General Purpose Descriptor (GPD) and Buffer Descriptor (BD),
  * SW links data buffers and triggers QMU to send / receive data to
  * host / from device at a time.
- * And now only GPD is supported.
+ * And now only GPD is supported; a TX scatter-gather request is queued
+ * as a chain of GPDs with IOC set on the last one only.
  *
  * For more detailed information, please refer to QMU Programming Guide
  */
@@ -235,12 +236,25 @@ static int gpd_ring_empty(struct mtu3_gpd_ring *ring)
 	return next == ring->dequeue;
 }
 
-int mtu3_prepare_transfer(struct mtu3_ep *mep)
+/* number of free gpds, not counting the reserved one */
+static int gpd_ring_avail(struct mtu3_gpd_ring *ring)
 {
-	return gpd_ring_empty(&mep->gpd_ring);
+	int used = ring->enqueue - ring->dequeue;
+
+	if (used < 0)
+		used += MAX_GPD_NUM;
+
+	return MAX_GPD_NUM - 1 - used;
 }
 
-static int mtu3_prepare_tx_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq)
+/* check if there is room for @num_gpds more gpds */
+int mtu3_prepare_transfer(struct mtu3_ep *mep, int num_gpds)
+{
+	return gpd_ring_avail(&mep->gpd_ring) < num_gpds;
+}
+
+static void mtu3_prepare_tx_one_gpd(struct mtu3_ep *mep,
+		struct mtu3_request *mreq, dma_addr_t dma, u32 len, bool last)
 {
 	struct qmu_gpd *enq;
 	struct mtu3_gpd_ring *ring = &mep->gpd_ring;
@@ -251,9 +265,9 @@ static int mtu3_prepare_tx_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq)
 	u32 ext_addr;
 
 	gpd->dw0_info = 0;	/* SW own it */
-	gpd->buffer = cpu_to_le32(lower_32_bits(req->dma));
-	ext_addr = GPD_EXT_BUF(mtu, upper_32_bits(req->dma));
-	gpd->dw3_info = cpu_to_le32(GPD_DATA_LEN(mtu, req->length));
+	gpd->buffer = cpu_to_le32(lower_32_bits(dma));
+	ext_addr = GPD_EXT_BUF(mtu, upper_32_bits(dma));
+	gpd->dw3_info = cpu_to_le32(GPD_DATA_LEN(mtu, len));
 
 	/* get the next GPD */
 	enq = advance_enq_gpd(ring);
@@ -266,7 +280,7 @@ static int mtu3_prepare_tx_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq)
 	ext_addr |= GPD_EXT_NGP(mtu, upper_32_bits(enq_dma));
 	gpd->dw0_info = cpu_to_le32(ext_addr);
 
-	if (req->zero) {
+	if (last && req->zero) {
 		if (mtu->gen2cp)
 			gpd->dw0_info |= cpu_to_le32(GPD_FLAGS_ZLP);
 		else
@@ -275,10 +289,29 @@ static int mtu3_prepare_tx_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq)
 
 	/* prevent reorder, make sure GPD's HWO is set last */
 	mb();
-	gpd->dw0_info |= cpu_to_le32(GPD_FLAGS_IOC | GPD_FLAGS_HWO);
+	/* only interrupt once per request */
+	gpd->dw0_info |= cpu_to_le32((last ? GPD_FLAGS_IOC : 0) |
+				     GPD_FLAGS_HWO);
 
-	mreq->gpd = gpd;
 	trace_mtu3_prepare_gpd(mep, gpd);
+}
+
+static int mtu3_prepare_tx_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq)
+{
+	struct usb_request *req = &mreq->request;
+	struct scatterlist *sg;
+	int i;
+
+	mreq->gpd = mep->gpd_ring.enqueue;
+
+	if (!req->num_mapped_sgs) {
+		mtu3_prepare_tx_one_gpd(mep, mreq, req->dma, req->length, true);
+		return 0;
+	}
+
+	for_each_sg(req->sg, sg, req->num_mapped_sgs, i)
+		mtu3_prepare_tx_one_gpd(mep, mreq, sg_dma_address(sg),
+			sg_dma_len(sg), i == req->num_mapped_sgs - 1);
 
 	return 0;
 }
@@ -497,6 +530,9 @@ static void qmu_done_tx(struct mtu3 *mtu, u8 epnum)
 
 	while (gpd != NULL && gpd != gpd_current &&
 			!GET_GPD_HWO(gpd)) {
+		struct qmu_gpd *last = gpd;
+		u32 actual = 0;
+		int i, num;
 
 		mreq = next_request(mep);
 
@@ -505,12 +541,27 @@ static void qmu_done_tx(struct mtu3 *mtu, u8 epnum)
 			break;
 		}
 
+		/* a chained request is done once its last gpd is */
+		num = mreq->num_gpds;
+		for (i = 1; i < num; i++)
+			last = (last < ring->end) ? last + 1 : ring->start;
+		if (last == gpd_current || GET_GPD_HWO(last))
+			break;
+
+		last = gpd;
+		for (i = 0; i < num; i++) {
+			actual += GPD_DATA_LEN(mtu, le32_to_cpu(last->dw3_info));
+			trace_mtu3_complete_gpd(mep, last);
+			last = (last < ring->end) ? last + 1 : ring->start;
+		}
+
 		request = &mreq->request;
-		request->actual = GPD_DATA_LEN(mtu, le32_to_cpu(gpd->dw3_info));
-		trace_mtu3_complete_gpd(mep, gpd);
+		request->actual = actual;
 		mtu3_req_complete(mep, request, 0);
 
-		gpd = advance_deq_gpd(ring);
+		/* mreq may be requeued by the completion, use the copy */
+		for (i = 0; i < num; i++)
+			gpd = advance_deq_gpd(ring);
 	}
 
 	dev_dbg(mtu->dev, "%s EP%d, deq=%p, enq=%p, complete\n",
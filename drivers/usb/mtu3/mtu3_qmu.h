@@ -17,6 +17,9 @@
 #define GPD_BUF_SIZE		65532
 #define GPD_BUF_SIZE_EL		1048572
 
+/* SG requests needing more GPDs than this are bounced */
+#define MTU3_SG_MAX_GPDS	(MAX_GPD_NUM / 2)
+
 void mtu3_qmu_stop(struct mtu3_ep *mep);
 int mtu3_qmu_start(struct mtu3_ep *mep);
 void mtu3_qmu_resume(struct mtu3_ep *mep);
@@ -24,7 +27,7 @@ void mtu3_qmu_flush(struct mtu3_ep *mep);
 
 void mtu3_insert_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq);
 void mtu3_clean_gpd(struct mtu3_ep *mep, struct mtu3_request *mreq);
-int mtu3_prepare_transfer(struct mtu3_ep *mep);
+int mtu3_prepare_transfer(struct mtu3_ep *mep, int num_gpds);
 
 int mtu3_gpd_ring_alloc(struct mtu3_ep *mep);
 void mtu3_gpd_ring_free(struct mtu3_ep *mep);
@@ -105,6 +105,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Inside virtqueue_add_batch(): defer publishing avail->idx. */
+	bool batching;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -412,6 +415,15 @@ static struct vring_desc *alloc_indirect_split(struct virtqueue *_vq,
 	return desc;
 }
 
+static void virtqueue_publish_split(struct vring_virtqueue *vq)
+{
+	/* Descriptors and available array need to be set before we expose the
+	 * new available array entries. */
+	virtio_wmb(vq->weak_barriers);
+	vq->split.vring.avail->idx = cpu_to_virtio16(vq->vq.vdev,
+						vq->split.avail_idx_shadow);
+}
+
 static inline int virtqueue_add_split(struct virtqueue *_vq,
 				      struct scatterlist *sgs[],
 				      unsigned int total_sg,
@@ -546,12 +558,9 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	avail = vq->split.avail_idx_shadow & (vq->split.vring.num - 1);
 	vq->split.vring.avail->ring[avail] = cpu_to_virtio16(_vq->vdev, head);
 
-	/* Descriptors and available array need to be set before we expose the
-	 * new available array entries. */
-	virtio_wmb(vq->weak_barriers);
 	vq->split.avail_idx_shadow++;
-	vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
-						vq->split.avail_idx_shadow);
+	if (!vq->batching)
+		virtqueue_publish_split(vq);
 	vq->num_added++;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -559,8 +568,11 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* This is very unlikely, but theoretically possible.  Kick
 	 * just in case. */
-	if (unlikely(vq->num_added == (1 << 16) - 1))
+	if (unlikely(vq->num_added == (1 << 16) - 1)) {
+		if (vq->batching)
+			virtqueue_publish_split(vq);
 		virtqueue_kick(_vq);
+	}
 
 	return 0;
 
@@ -1626,6 +1638,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->batching = false;
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -1752,6 +1765,63 @@ int virtqueue_add_sgs(struct virtqueue *_vq,
 }
 EXPORT_SYMBOL_GPL(virtqueue_add_sgs);
 
+/**
+ * virtqueue_add_batch - expose several buffers to other end at once
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: the buffers to add, in order.
+ * @num: the number of entries in @bufs.
+ * @gfp: how to do memory allocations (if necessary).
+ *
+ * Like calling virtqueue_add_sgs() for each of @bufs, except that on a
+ * split ring the available index is published once for the whole batch,
+ * so the other side never sees part of it and there is one write barrier
+ * instead of one per buffer.  Follow with a single virtqueue_kick(), which
+ * honours event index suppression and usually avoids the notification
+ * entirely while the device is still working through the ring.
+ *
+ * Caller must ensure we don't call this with other virtqueue operations
+ * at the same time (except where noted).
+ *
+ * Returns the number of buffers added, which is less than @num if the
+ * ring filled up, or a negative error (ie. ENOSPC, ENOMEM, EIO) if not
+ * even the first one could be added.
+ */
+int virtqueue_add_batch(struct virtqueue *_vq,
+			const struct virtqueue_buf *bufs,
+			unsigned int num,
+			gfp_t gfp)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int i, j, total_sg;
+	int err = 0;
+
+	vq->batching = !vq->packed_ring;
+
+	for (i = 0; i < num; i++) {
+		const struct virtqueue_buf *buf = &bufs[i];
+		struct scatterlist *sg;
+
+		total_sg = 0;
+		for (j = 0; j < buf->out_sgs + buf->in_sgs; j++)
+			for (sg = buf->sgs[j]; sg; sg = sg_next(sg))
+				total_sg++;
+
+		err = virtqueue_add(_vq, buf->sgs, total_sg, buf->out_sgs,
+				    buf->in_sgs, buf->data, NULL, gfp);
+		if (err)
+			break;
+	}
+
+	if (vq->batching) {
+		vq->batching = false;
+		if (i)
+			virtqueue_publish_split(vq);
+	}
+
+	return i ? i : err;
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_batch);
+
 /**
  * virtqueue_add_outbuf - expose output buffers to other end
  * @vq: the struct virtqueue we're talking about.
@@ -2103,6 +2173,7 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->batching = false;
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
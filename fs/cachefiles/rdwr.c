@@ -436,6 +436,9 @@ int cachefiles_read_or_alloc_page(struct fscache_retrieval *op,
 	       (unsigned long long) (page->index << shift),
 	       (unsigned long long) block);
 
+	atomic_inc(block ? &object->fscache.n_page_hits :
+		   &object->fscache.n_page_misses);
+
 	if (block) {
 		/* submit the apparently valid page to the backing fs to be
 		 * read from disk */
@@ -458,6 +461,30 @@ int cachefiles_read_or_alloc_page(struct fscache_retrieval *op,
 	return -ENOBUFS;
 }
 
+/*
+ * start readahead on the backing file over the span of a netfs readahead
+ * window, so that the per-page ->readpage() calls below mostly find pages
+ * already under I/O rather than each issuing a single-page read
+ * - the span may have holes; only spans up to the backing fs's readahead
+ *   window are prefetched so that a sparse list doesn't pull in much else
+ */
+static void cachefiles_prefetch_backing_file(struct cachefiles_object *object,
+					     pgoff_t first, pgoff_t last)
+{
+	struct address_space *bmapping = d_backing_inode(object->backer)->i_mapping;
+	struct file_ra_state ra;
+
+	if (first >= last)
+		return;
+
+	file_ra_state_init(&ra, bmapping);
+	if (last - first + 1 > ra.ra_pages)
+		return;
+
+	page_cache_sync_readahead(bmapping, &ra, NULL, first,
+				  last - first + 1);
+}
+
 /*
  * read the corresponding pages to the given set from the backing file
  * - any uncertain pages are simply discarded, to be tried again another time
@@ -690,7 +717,8 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 	struct pagevec pagevec;
 	struct inode *inode;
 	struct page *page, *_n;
-	unsigned shift, nrbackpages;
+	pgoff_t first_index = ULONG_MAX, last_index = 0;
+	unsigned shift, nrbackpages, nr_requested = *nr_pages;
 	int ret, ret2, space;
 
 	object = container_of(op->op.object,
@@ -750,6 +778,10 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 			list_move(&page->lru, &backpages);
 			(*nr_pages)--;
 			nrbackpages++;
+			if (page->index < first_index)
+				first_index = page->index;
+			if (page->index > last_index)
+				last_index = page->index;
 		} else if (space && pagevec_add(&pagevec, page) == 0) {
 			fscache_mark_pages_cached(op, &pagevec);
 			fscache_retrieval_complete(op, 1);
@@ -765,9 +797,14 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 	if (list_empty(pages))
 		ret = 0;
 
+	atomic_add(nrbackpages, &object->fscache.n_page_hits);
+	atomic_add(nr_requested - nrbackpages, &object->fscache.n_page_misses);
+
 	/* submit the apparently valid pages to the backing fs to be read from
 	 * disk */
 	if (nrbackpages > 0) {
+		cachefiles_prefetch_backing_file(object, first_index,
+						 last_index);
 		ret2 = cachefiles_read_backing_file(object, op, &backpages);
 		if (ret2 == -ENOMEM || ret2 == -EINTR)
 			ret = ret2;
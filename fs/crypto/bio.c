@@ -24,20 +24,35 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/namei.h>
+#include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
+/*
+ * All pages of a read bio belong to the same inode, so a single skcipher
+ * request is allocated for the whole bio and reused for every block, rather
+ * than allocating and freeing one per block.  (Each block still has its own
+ * IV, so the blocks can't be merged into one request.)
+ */
 void fscrypt_decrypt_bio(struct bio *bio)
 {
+	struct skcipher_request *req = NULL;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int ret = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-							   bv->bv_offset);
+		int ret;
+
+		if (!req)
+			req = skcipher_request_alloc(
+				page->mapping->host->i_crypt_info->ci_enc_key.tfm,
+				GFP_NOFS);
+		ret = fscrypt_decrypt_pagecache_blocks_req(page, bv->bv_len,
+							   bv->bv_offset, req);
 		if (ret)
 			SetPageError(page);
 	}
+	skcipher_request_free(req);
 }
 EXPORT_SYMBOL(fscrypt_decrypt_bio);
 
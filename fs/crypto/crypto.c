@@ -36,6 +36,21 @@ MODULE_PARM_DESC(num_prealloc_crypto_pages,
 
 static mempool_t *fscrypt_bounce_page_pool = NULL;
 
+/*
+ * A few bounce pages are cached per CPU in front of the mempool, so that
+ * writeback on a busy CPU doesn't contend on the mempool lock for every page.
+ * Pages are only cached once the mempool's reserve is full again, so the
+ * forward-progress guarantee of the mempool is unaffected.
+ */
+#define FSCRYPT_PCP_BOUNCE_PAGES	8
+
+struct fscrypt_bounce_cache {
+	unsigned int nr;
+	struct page *pages[FSCRYPT_PCP_BOUNCE_PAGES];
+};
+
+static DEFINE_PER_CPU(struct fscrypt_bounce_cache, fscrypt_bounce_cache);
+
 static struct workqueue_struct *fscrypt_read_workqueue;
 static DEFINE_MUTEX(fscrypt_init_mutex);
 
@@ -49,6 +64,18 @@ EXPORT_SYMBOL(fscrypt_enqueue_decrypt_work);
 
 struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags)
 {
+	struct fscrypt_bounce_cache *cache;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&fscrypt_bounce_cache);
+	if (cache->nr)
+		page = cache->pages[--cache->nr];
+	local_irq_restore(flags);
+	if (page)
+		return page;
+
 	return mempool_alloc(fscrypt_bounce_page_pool, gfp_flags);
 }
 
@@ -61,10 +88,27 @@ struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags)
  */
 void fscrypt_free_bounce_page(struct page *bounce_page)
 {
+	struct fscrypt_bounce_cache *cache;
+	unsigned long flags;
+
 	if (!bounce_page)
 		return;
 	set_page_private(bounce_page, (unsigned long)NULL);
 	ClearPagePrivate(bounce_page);
+
+	/* Refill the mempool's reserve first; see fscrypt_bounce_cache. */
+	if (READ_ONCE(fscrypt_bounce_page_pool->curr_nr) >=
+	    fscrypt_bounce_page_pool->min_nr) {
+		local_irq_save(flags);
+		cache = this_cpu_ptr(&fscrypt_bounce_cache);
+		if (cache->nr < FSCRYPT_PCP_BOUNCE_PAGES) {
+			cache->pages[cache->nr++] = bounce_page;
+			bounce_page = NULL;
+		}
+		local_irq_restore(flags);
+		if (!bounce_page)
+			return;
+	}
 	mempool_free(bounce_page, fscrypt_bounce_page_pool);
 }
 EXPORT_SYMBOL(fscrypt_free_bounce_page);
@@ -97,18 +141,22 @@ void fscrypt_generate_iv(union fscrypt_iv *iv, u64 lblk_num,
 	iv->lblk_num = cpu_to_le64(lblk_num);
 }
 
-/* Encrypt or decrypt a single filesystem block of file contents */
-int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
-			u64 lblk_num, struct page *src_page,
-			struct page *dest_page, unsigned int len,
-			unsigned int offs, gfp_t gfp_flags)
+/*
+ * Encrypt or decrypt a single filesystem block of file contents, using a
+ * skcipher request that the caller allocated for @inode's key.  Callers that
+ * process many blocks reuse one request for all of them.
+ */
+static int fscrypt_crypt_block_req(const struct inode *inode,
+				   struct skcipher_request *req,
+				   fscrypt_direction_t rw, u64 lblk_num,
+				   struct page *src_page,
+				   struct page *dest_page, unsigned int len,
+				   unsigned int offs)
 {
 	union fscrypt_iv iv;
-	struct skcipher_request *req = NULL;
 	DECLARE_CRYPTO_WAIT(wait);
 	struct scatterlist dst, src;
 	struct fscrypt_info *ci = inode->i_crypt_info;
-	struct crypto_skcipher *tfm = ci->ci_enc_key.tfm;
 	int res = 0;
 
 	if (WARN_ON_ONCE(len <= 0))
@@ -118,10 +166,6 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 
 	fscrypt_generate_iv(&iv, lblk_num, ci);
 
-	req = skcipher_request_alloc(tfm, gfp_flags);
-	if (!req)
-		return -ENOMEM;
-
 	skcipher_request_set_callback(
 		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
 		crypto_req_done, &wait);
@@ -135,7 +179,6 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 		res = crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
 	else
 		res = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
-	skcipher_request_free(req);
 	if (res) {
 		fscrypt_err(inode, "%scryption failed for block %llu: %d",
 			    (rw == FS_DECRYPT ? "De" : "En"), lblk_num, res);
@@ -144,6 +187,25 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	return 0;
 }
 
+/* Encrypt or decrypt a single filesystem block of file contents */
+int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
+			u64 lblk_num, struct page *src_page,
+			struct page *dest_page, unsigned int len,
+			unsigned int offs, gfp_t gfp_flags)
+{
+	struct skcipher_request *req;
+	int res;
+
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     gfp_flags);
+	if (!req)
+		return -ENOMEM;
+	res = fscrypt_crypt_block_req(inode, req, rw, lblk_num, src_page,
+				      dest_page, len, offs);
+	skcipher_request_free(req);
+	return res;
+}
+
 /**
  * fscrypt_encrypt_pagecache_blocks() - Encrypt filesystem blocks from a
  *					pagecache page
@@ -178,6 +240,7 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	const struct inode *inode = page->mapping->host;
 	const unsigned int blockbits = inode->i_blkbits;
 	const unsigned int blocksize = 1 << blockbits;
+	struct skcipher_request *req;
 	struct page *ciphertext_page;
 	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
 		       (offs >> blockbits);
@@ -190,19 +253,28 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
 		return ERR_PTR(-EINVAL);
 
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     gfp_flags);
+	if (!req)
+		return ERR_PTR(-ENOMEM);
+
 	ciphertext_page = fscrypt_alloc_bounce_page(gfp_flags);
-	if (!ciphertext_page)
+	if (!ciphertext_page) {
+		skcipher_request_free(req);
 		return ERR_PTR(-ENOMEM);
+	}
 
 	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk_num,
-					  page, ciphertext_page,
-					  blocksize, i, gfp_flags);
+		err = fscrypt_crypt_block_req(inode, req, FS_ENCRYPT, lblk_num,
+					      page, ciphertext_page,
+					      blocksize, i);
 		if (err) {
+			skcipher_request_free(req);
 			fscrypt_free_bounce_page(ciphertext_page);
 			return ERR_PTR(err);
 		}
 	}
+	skcipher_request_free(req);
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
 	return ciphertext_page;
@@ -235,6 +307,48 @@ int fscrypt_encrypt_block_inplace(const struct inode *inode, struct page *page,
 }
 EXPORT_SYMBOL(fscrypt_encrypt_block_inplace);
 
+/*
+ * Like fscrypt_decrypt_pagecache_blocks(), but @req may be a skcipher request
+ * already allocated for the inode's key, which then is reused for all blocks.
+ * fscrypt_decrypt_bio() uses this so that a whole bio needs one allocation.
+ */
+int fscrypt_decrypt_pagecache_blocks_req(struct page *page, unsigned int len,
+					 unsigned int offs,
+					 struct skcipher_request *req)
+{
+	const struct inode *inode = page->mapping->host;
+	const unsigned int blockbits = inode->i_blkbits;
+	const unsigned int blocksize = 1 << blockbits;
+	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
+		       (offs >> blockbits);
+	struct skcipher_request *own_req = NULL;
+	unsigned int i;
+	int err = 0;
+
+	if (WARN_ON_ONCE(!PageLocked(page)))
+		return -EINVAL;
+
+	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
+		return -EINVAL;
+
+	if (!req) {
+		own_req = skcipher_request_alloc(
+				inode->i_crypt_info->ci_enc_key.tfm, GFP_NOFS);
+		if (!own_req)
+			return -ENOMEM;
+		req = own_req;
+	}
+
+	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
+		err = fscrypt_crypt_block_req(inode, req, FS_DECRYPT, lblk_num,
+					      page, page, blocksize, i);
+		if (err)
+			break;
+	}
+	skcipher_request_free(own_req);
+	return err;
+}
+
 /**
  * fscrypt_decrypt_pagecache_blocks() - Decrypt filesystem blocks in a
  *					pagecache page
@@ -255,27 +369,7 @@ EXPORT_SYMBOL(fscrypt_encrypt_block_inplace);
 int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 				     unsigned int offs)
 {
-	const struct inode *inode = page->mapping->host;
-	const unsigned int blockbits = inode->i_blkbits;
-	const unsigned int blocksize = 1 << blockbits;
-	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
-		       (offs >> blockbits);
-	unsigned int i;
-	int err;
-
-	if (WARN_ON_ONCE(!PageLocked(page)))
-		return -EINVAL;
-
-	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
-		return -EINVAL;
-
-	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
-					  page, blocksize, i, GFP_NOFS);
-		if (err)
-			return err;
-	}
-	return 0;
+	return fscrypt_decrypt_pagecache_blocks_req(page, len, offs, NULL);
 }
 EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
@@ -267,6 +267,10 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 			struct page *dest_page, unsigned int len,
 			unsigned int offs, gfp_t gfp_flags);
 struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags);
+struct skcipher_request;
+int fscrypt_decrypt_pagecache_blocks_req(struct page *page, unsigned int len,
+					 unsigned int offs,
+					 struct skcipher_request *req);
 
 void __printf(3, 4) __cold
 fscrypt_msg(const struct inode *inode, const char *level, const char *fmt, ...);
@@ -81,8 +81,40 @@ static inline bool z_erofs_put_shortlivedpage(struct list_head *pagepool,
 	return true;
 }
 
+struct z_erofs_decompressor {
+	int (*config)(struct super_block *sb, struct erofs_super_block *dsb,
+		      void *data, int size);
+	/*
+	 * if destpages have sparsed pages, fill them with bounce pages.
+	 * it also check whether destpages indicate continuous physical memory.
+	 */
+	int (*prepare_destpages)(struct z_erofs_decompress_req *rq,
+				 struct list_head *pagepool);
+	int (*decompress)(struct z_erofs_decompress_req *rq, u8 *out);
+	void (*init)(void);
+	void (*exit)(void);
+	char *name;
+};
+
+void *z_erofs_handle_inplace_io(struct z_erofs_decompress_req *rq,
+			void *inpage, unsigned int *inputmargin, int *maptype,
+			bool support_0padding);
+void z_erofs_unmap_inpages(struct z_erofs_decompress_req *rq, void *src,
+			   int maptype);
+
 int z_erofs_decompress(struct z_erofs_decompress_req *rq,
 		       struct list_head *pagepool);
 
+#ifdef CONFIG_EROFS_FS_ZIP_ZSTD
+int z_erofs_load_zstd_config(struct super_block *sb,
+			     struct erofs_super_block *dsb,
+			     void *data, int size);
+int z_erofs_zstd_prepare_destpages(struct z_erofs_decompress_req *rq,
+				   struct list_head *pagepool);
+int z_erofs_zstd_decompress(struct z_erofs_decompress_req *rq, u8 *out);
+void z_erofs_zstd_init(void);
+void z_erofs_zstd_exit(void);
+#endif
+
 #endif
 
@@ -17,17 +17,6 @@
 #define LZ4_DECOMPRESS_INPLACE_MARGIN(srcsize)  (((srcsize) >> 8) + 32)
 #endif
 
-struct z_erofs_decompressor {
-	/*
-	 * if destpages have sparsed pages, fill them with bounce pages.
-	 * it also check whether destpages indicate continuous physical memory.
-	 */
-	int (*prepare_destpages)(struct z_erofs_decompress_req *rq,
-				 struct list_head *pagepool);
-	int (*decompress)(struct z_erofs_decompress_req *rq, u8 *out);
-	char *name;
-};
-
 int z_erofs_load_lz4_config(struct super_block *sb,
 			    struct erofs_super_block *dsb,
 			    struct z_erofs_lz4_cfgs *lz4, int size)
@@ -64,6 +53,13 @@ int z_erofs_load_lz4_config(struct super_block *sb,
 	return erofs_pcpubuf_growsize(sbi->lz4.max_pclusterblks);
 }
 
+static int z_erofs_lz4_config(struct super_block *sb,
+			      struct erofs_super_block *dsb,
+			      void *data, int size)
+{
+	return z_erofs_load_lz4_config(sb, dsb, data, size);
+}
+
 static int z_erofs_lz4_prepare_destpages(struct z_erofs_decompress_req *rq,
 					 struct list_head *pagepool)
 {
@@ -120,7 +116,7 @@ static int z_erofs_lz4_prepare_destpages(struct z_erofs_decompress_req *rq,
 	return kaddr ? 1 : 0;
 }
 
-static void *z_erofs_handle_inplace_io(struct z_erofs_decompress_req *rq,
+void *z_erofs_handle_inplace_io(struct z_erofs_decompress_req *rq,
 			void *inpage, unsigned int *inputmargin, int *maptype,
 			bool support_0padding)
 {
@@ -190,6 +186,19 @@ static void *z_erofs_handle_inplace_io(struct z_erofs_decompress_req *rq,
 	return src;
 }
 
+void z_erofs_unmap_inpages(struct z_erofs_decompress_req *rq, void *src,
+			   int maptype)
+{
+	if (maptype == 0)
+		kunmap_atomic(src);
+	else if (maptype == 1)
+		vm_unmap_ram(src, PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT);
+	else if (maptype == 2)
+		erofs_put_pcpubuf(src);
+	else
+		DBG_BUGON(1);
+}
+
 static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 {
 	unsigned int inputmargin;
@@ -244,16 +253,11 @@ static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 		ret = -EIO;
 	}
 
-	if (maptype == 0) {
-		kunmap_atomic(src);
-	} else if (maptype == 1) {
-		vm_unmap_ram(src, PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT);
-	} else if (maptype == 2) {
-		erofs_put_pcpubuf(src);
-	} else {
+	if (maptype < 0 || maptype > 2) {
 		DBG_BUGON(1);
 		return -EFAULT;
 	}
+	z_erofs_unmap_inpages(rq, src, maptype);
 	return ret;
 }
 
@@ -262,12 +266,57 @@ static struct z_erofs_decompressor decompressors[] = {
 		.name = "shifted"
 	},
 	[Z_EROFS_COMPRESSION_LZ4] = {
+		.config = z_erofs_lz4_config,
 		.prepare_destpages = z_erofs_lz4_prepare_destpages,
 		.decompress = z_erofs_lz4_decompress,
 		.name = "lz4"
 	},
+#ifdef CONFIG_EROFS_FS_ZIP_ZSTD
+	[Z_EROFS_COMPRESSION_ZSTD] = {
+		.config = z_erofs_load_zstd_config,
+		.prepare_destpages = z_erofs_zstd_prepare_destpages,
+		.decompress = z_erofs_zstd_decompress,
+		.init = z_erofs_zstd_init,
+		.exit = z_erofs_zstd_exit,
+		.name = "zstd"
+	},
+#endif
 };
 
+bool z_erofs_decompressor_available(unsigned int alg)
+{
+	return alg < Z_EROFS_COMPRESSION_MAX && decompressors[alg].decompress;
+}
+
+int z_erofs_load_compr_config(struct super_block *sb,
+			      struct erofs_super_block *dsb,
+			      unsigned int alg, void *data, int size)
+{
+	if (!z_erofs_decompressor_available(alg) || !decompressors[alg].config) {
+		erofs_err(sb, "compression algorithm %u isn't enabled", alg);
+		return -EOPNOTSUPP;
+	}
+	return decompressors[alg].config(sb, dsb, data, size);
+}
+
+void z_erofs_init_decompressors(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(decompressors); ++i)
+		if (decompressors[i].init)
+			decompressors[i].init();
+}
+
+void z_erofs_exit_decompressors(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(decompressors); ++i)
+		if (decompressors[i].exit)
+			decompressors[i].exit();
+}
+
 static void copy_from_pcpubuf(struct page **out, const char *dst,
 			      unsigned short pageofs_out,
 			      unsigned int outputsize)
@@ -305,6 +354,12 @@ static int z_erofs_decompress_generic(struct z_erofs_decompress_req *rq,
 	void *dst;
 	int ret;
 
+	if (!z_erofs_decompressor_available(rq->alg)) {
+		erofs_err(rq->sb, "decompressor for algorithm %u isn't enabled",
+			  rq->alg);
+		return -EOPNOTSUPP;
+	}
+
 	/* two optimized fast paths only for non bigpcluster cases yet */
 	if (rq->inputsize <= PAGE_SIZE) {
 		if (nrpages_out == 1 && !rq->inplace_io) {
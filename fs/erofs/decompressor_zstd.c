@@ -0,0 +1,246 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Zstandard decompression backend.
+ *
+ * Like the per-CPU buffers in pcpubuf.c, a streaming decompression context
+ * is reserved for each possible CPU in advance, sized for the largest
+ * window among all mounted filesystems, so that decoding never has to
+ * allocate (or sleep) on the I/O completion path.
+ */
+#include <linux/zstd.h>
+#include <linux/vmalloc.h>
+#include "compress.h"
+
+/* per-CPU workspaces are kept for windows up to the maximum pcluster size */
+#define Z_EROFS_ZSTD_MAX_WINDOWLOG	ilog2(Z_EROFS_PCLUSTER_MAX_SIZE)
+
+struct z_erofs_zstd_pcpu {
+	raw_spinlock_t lock;
+	ZSTD_DStream *stream;
+	void *wksp;
+};
+
+static DEFINE_PER_CPU(struct z_erofs_zstd_pcpu, z_erofs_zstd_pcs);
+
+static ZSTD_DStream *z_erofs_get_zstd_stream(void)
+	__acquires(pcs->lock)
+{
+	struct z_erofs_zstd_pcpu *pcs = &get_cpu_var(z_erofs_zstd_pcs);
+
+	raw_spin_lock(&pcs->lock);
+	return pcs->stream;
+}
+
+static void z_erofs_put_zstd_stream(void) __releases(pcs->lock)
+{
+	struct z_erofs_zstd_pcpu *pcs =
+		&per_cpu(z_erofs_zstd_pcs, smp_processor_id());
+
+	raw_spin_unlock(&pcs->lock);
+	put_cpu_var(z_erofs_zstd_pcs);
+}
+
+/* avoid shrinking workspaces, since no idea how many fses rely on */
+static int z_erofs_zstd_growsize(unsigned int windowsize)
+{
+	static DEFINE_MUTEX(zstd_resize_mutex);
+	static unsigned int zstd_windowsize;
+	size_t wkspsz;
+	int cpu, ret = 0;
+
+	mutex_lock(&zstd_resize_mutex);
+	if (windowsize <= zstd_windowsize)
+		goto out;
+
+	wkspsz = ZSTD_DStreamWorkspaceBound(windowsize);
+	for_each_possible_cpu(cpu) {
+		struct z_erofs_zstd_pcpu *pcs = &per_cpu(z_erofs_zstd_pcs, cpu);
+		ZSTD_DStream *stream;
+		void *wksp, *old_wksp;
+
+		wksp = vmalloc(wkspsz);
+		if (!wksp) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		stream = ZSTD_initDStream(windowsize, wksp, wkspsz);
+		if (!stream) {
+			vfree(wksp);
+			ret = -EINVAL;
+			break;
+		}
+
+		raw_spin_lock(&pcs->lock);
+		old_wksp = pcs->wksp;
+		pcs->wksp = wksp;
+		pcs->stream = stream;
+		raw_spin_unlock(&pcs->lock);
+		vfree(old_wksp);
+	}
+	if (!ret)
+		zstd_windowsize = windowsize;
+out:
+	mutex_unlock(&zstd_resize_mutex);
+	return ret;
+}
+
+int z_erofs_load_zstd_config(struct super_block *sb,
+			     struct erofs_super_block *dsb,
+			     void *data, int size)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	struct z_erofs_zstd_cfgs *zstd = data;
+	unsigned int windowlog;
+	int ret;
+
+	if (!erofs_sb_has_lz4_0padding(sbi)) {
+		erofs_err(sb, "zstd requires the 0padding feature");
+		return -EINVAL;
+	}
+
+	if (!zstd || size < sizeof(struct z_erofs_zstd_cfgs) || zstd->format) {
+		erofs_err(sb, "unsupported zstd format, size=%u", size);
+		return -EINVAL;
+	}
+
+	windowlog = zstd->windowlog + ZSTD_WINDOWLOG_MIN;
+	if (windowlog > Z_EROFS_ZSTD_MAX_WINDOWLOG) {
+		erofs_err(sb, "unsupported zstd window log %u", windowlog);
+		return -EINVAL;
+	}
+	ret = z_erofs_zstd_growsize(1U << windowlog);
+	if (ret)
+		return ret;
+
+	/* overlapped compressed data is copied to the per-CPU buffer */
+	return erofs_pcpubuf_growsize(erofs_sb_has_big_pcluster(sbi) ?
+			Z_EROFS_PCLUSTER_MAX_SIZE / EROFS_BLKSIZ : 1);
+}
+
+/*
+ * zstd may reference anything decoded so far within the window, so bounce
+ * pages can't be recycled as the rolling lz4 ones are.
+ */
+int z_erofs_zstd_prepare_destpages(struct z_erofs_decompress_req *rq,
+				   struct list_head *pagepool)
+{
+	const unsigned int nr =
+		PAGE_ALIGN(rq->pageofs_out + rq->outputsize) >> PAGE_SHIFT;
+	void *kaddr = NULL;
+	unsigned int i;
+
+	for (i = 0; i < nr; ++i) {
+		struct page *const page = rq->out[i];
+
+		if (page) {
+			if (kaddr) {
+				if (kaddr + PAGE_SIZE == page_address(page))
+					kaddr += PAGE_SIZE;
+				else
+					kaddr = NULL;
+			} else if (!i) {
+				kaddr = page_address(page);
+			}
+			continue;
+		}
+		kaddr = NULL;
+		rq->out[i] = erofs_allocpage(pagepool,
+					     GFP_KERNEL | __GFP_NOFAIL);
+		set_page_private(rq->out[i], Z_EROFS_SHORTLIVED_PAGE);
+	}
+	return kaddr ? 1 : 0;
+}
+
+int z_erofs_zstd_decompress(struct z_erofs_decompress_req *rq, u8 *out)
+{
+	ZSTD_inBuffer in_buf = { NULL, 0, 0 };
+	ZSTD_outBuffer out_buf = { NULL, 0, 0 };
+	unsigned int inputmargin;
+	ZSTD_DStream *stream;
+	u8 *headpage, *src;
+	size_t zerr;
+	int ret, maptype;
+
+	DBG_BUGON(*rq->in == NULL);
+	headpage = kmap_atomic(*rq->in);
+
+	/* compressed data is always 0-padded at the head */
+	inputmargin = 0;
+	while (!headpage[inputmargin & ~PAGE_MASK])
+		if (!(++inputmargin & ~PAGE_MASK))
+			break;
+
+	if (inputmargin >= rq->inputsize) {
+		kunmap_atomic(headpage);
+		return -EIO;
+	}
+
+	/*
+	 * zstd has no safe in-place decoding margin, so overlapped
+	 * compressed data is always copied to the per-CPU buffer instead.
+	 */
+	rq->inputsize -= inputmargin;
+	src = z_erofs_handle_inplace_io(rq, headpage, &inputmargin, &maptype,
+					false);
+	if (IS_ERR(src))
+		return PTR_ERR(src);
+
+	stream = z_erofs_get_zstd_stream();
+	if (!stream) {
+		DBG_BUGON(1);
+		ret = -EFAULT;
+		goto out;
+	}
+
+	zerr = ZSTD_resetDStream(stream);
+	in_buf.src = src + inputmargin;
+	in_buf.size = rq->inputsize;
+	out_buf.dst = out;
+	out_buf.size = rq->outputsize;
+	/* stop at the end of the frame or once enough data is decoded */
+	while (!ZSTD_isError(zerr)) {
+		zerr = ZSTD_decompressStream(stream, &out_buf, &in_buf);
+		if (!zerr || out_buf.pos >= out_buf.size ||
+		    in_buf.pos >= in_buf.size)
+			break;
+	}
+
+	ret = 0;
+	if (ZSTD_isError(zerr) || out_buf.pos != rq->outputsize) {
+		erofs_err(rq->sb, "failed to decompress %zu (err %d) in[%u, %u] out[%u]",
+			  out_buf.pos, ZSTD_isError(zerr) ?
+			  ZSTD_getErrorCode(zerr) : 0,
+			  rq->inputsize, inputmargin, rq->outputsize);
+		memset(out + out_buf.pos, 0, rq->outputsize - out_buf.pos);
+		ret = -EIO;
+	}
+out:
+	z_erofs_put_zstd_stream();
+	z_erofs_unmap_inpages(rq, src, maptype);
+	return ret;
+}
+
+void z_erofs_zstd_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct z_erofs_zstd_pcpu *pcs = &per_cpu(z_erofs_zstd_pcs, cpu);
+
+		raw_spin_lock_init(&pcs->lock);
+	}
+}
+
+void z_erofs_zstd_exit(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct z_erofs_zstd_pcpu *pcs = &per_cpu(z_erofs_zstd_pcs, cpu);
+
+		vfree(pcs->wksp);
+		pcs->wksp = NULL;
+		pcs->stream = NULL;
+	}
+}
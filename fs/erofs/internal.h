@@ -55,10 +55,16 @@ struct erofs_fs_context {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* # of workers a background decompression queue can fan out to */
+	unsigned int max_decompress_workers;
 #endif
 	unsigned int mount_opt;
 };
 
+/* upper bound of the decompress_workers mount option */
+#define EROFS_MAX_DECOMPRESS_WORKERS	8
+
 /* all filesystem-wide lz4 configurations */
 struct erofs_sb_lz4_info {
 	/* # of pages needed for EROFS lz4 rolling decompression */
@@ -82,6 +88,16 @@ struct erofs_sb_info {
 	/* pseudo inode to manage cached pages */
 	struct inode *managed_cache;
 
+	/* managed cache budget in pages (0 - unlimited) */
+	unsigned long cache_limit_pages;
+	struct work_struct cache_trim_work;
+
+	/* managed cache statistics */
+	atomic_long_t nr_workgroups;
+	atomic_long_t cache_hits;
+	atomic_long_t cache_misses;
+	atomic_long_t inplace_io;
+
 	struct erofs_sb_lz4_info lz4;
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	u32 blocks;
@@ -108,6 +124,10 @@ struct erofs_sb_info {
 	u32 feature_incompat;
 
 	struct erofs_fs_context ctx;	/* options */
+
+	/* sysfs support */
+	struct kobject s_kobj;		/* /sys/fs/erofs/<devname> */
+	struct completion s_kobj_unregister;
 };
 
 #define EROFS_SB(sb) ((struct erofs_sb_info *)(sb)->s_fs_info)
@@ -137,6 +157,9 @@ struct erofs_workgroup {
 
 	/* overall workgroup reference count */
 	atomic_t refcount;
+
+	/* looked up since the last managed cache trimming pass */
+	bool referenced;
 };
 
 #if defined(CONFIG_SMP)
@@ -348,6 +371,8 @@ struct erofs_map_blocks {
 	u64 m_plen, m_llen;
 
 	unsigned int m_flags;
+	/* compression algorithm of the extent (if EROFS_MAP_ZIPPED) */
+	unsigned char m_algorithmformat;
 
 	struct page *mpage;
 };
@@ -423,6 +448,12 @@ int erofs_pcpubuf_growsize(unsigned int nrpages);
 void erofs_pcpubuf_init(void);
 void erofs_pcpubuf_exit(void);
 
+/* sysfs.c */
+int erofs_register_sysfs(struct super_block *sb);
+void erofs_unregister_sysfs(struct super_block *sb);
+int __init erofs_init_sysfs(void);
+void erofs_exit_sysfs(void);
+
 /* utils.c / zdata.c */
 struct page *erofs_allocpage(struct list_head *pool, gfp_t gfp);
 
@@ -435,6 +466,7 @@ struct erofs_workgroup *erofs_insert_workgroup(struct super_block *sb,
 void erofs_workgroup_free_rcu(struct erofs_workgroup *grp);
 void erofs_shrinker_register(struct super_block *sb);
 void erofs_shrinker_unregister(struct super_block *sb);
+void erofs_trim_managed_cache(struct erofs_sb_info *sbi);
 int __init erofs_init_shrinker(void);
 void erofs_exit_shrinker(void);
 int __init z_erofs_init_zip_subsystem(void);
@@ -446,6 +478,12 @@ int erofs_try_to_free_cached_page(struct address_space *mapping,
 int z_erofs_load_lz4_config(struct super_block *sb,
 			    struct erofs_super_block *dsb,
 			    struct z_erofs_lz4_cfgs *lz4, int len);
+int z_erofs_load_compr_config(struct super_block *sb,
+			      struct erofs_super_block *dsb,
+			      unsigned int alg, void *data, int size);
+bool z_erofs_decompressor_available(unsigned int alg);
+void z_erofs_init_decompressors(void);
+void z_erofs_exit_decompressors(void);
 #else
 static inline void erofs_shrinker_register(struct super_block *sb) {}
 static inline void erofs_shrinker_unregister(struct super_block *sb) {}
@@ -453,6 +491,8 @@ static inline int erofs_init_shrinker(void) { return 0; }
 static inline void erofs_exit_shrinker(void) {}
 static inline int z_erofs_init_zip_subsystem(void) { return 0; }
 static inline void z_erofs_exit_zip_subsystem(void) {}
+static inline void z_erofs_init_decompressors(void) {}
+static inline void z_erofs_exit_decompressors(void) {}
 static inline int z_erofs_load_lz4_config(struct super_block *sb,
 				  struct erofs_super_block *dsb,
 				  struct z_erofs_lz4_cfgs *lz4, int len)
@@ -221,14 +221,7 @@ static int erofs_load_compr_cfgs(struct super_block *sb,
 			goto err;
 		}
 
-		switch (alg) {
-		case Z_EROFS_COMPRESSION_LZ4:
-			ret = z_erofs_load_lz4_config(sb, dsb, data, size);
-			break;
-		default:
-			DBG_BUGON(1);
-			ret = -EFAULT;
-		}
+		ret = z_erofs_load_compr_config(sb, dsb, alg, data, size);
 		kfree(data);
 		if (ret)
 			goto err;
@@ -343,6 +336,7 @@ static void erofs_default_options(struct erofs_fs_context *ctx)
 	ctx->cache_strategy = EROFS_ZIP_CACHE_READAROUND;
 	ctx->max_sync_decompress_pages = 3;
 	ctx->readahead_sync_decompress = false;
+	ctx->max_decompress_workers = 1;
 #endif
 #ifdef CONFIG_EROFS_FS_XATTR
 	set_opt(ctx, XATTR_USER);
@@ -356,6 +350,7 @@ enum {
 	Opt_user_xattr,
 	Opt_acl,
 	Opt_cache_strategy,
+	Opt_decompress_workers,
 	Opt_err
 };
 
@@ -371,6 +366,7 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 	fsparam_flag_no("acl",		Opt_acl),
 	fsparam_enum("cache_strategy",	Opt_cache_strategy,
 		     erofs_param_cache_strategy),
+	fsparam_u32("decompress_workers", Opt_decompress_workers),
 	{}
 };
 
@@ -411,6 +407,19 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 		ctx->cache_strategy = result.uint_32;
 #else
 		errorfc(fc, "compression not supported, cache_strategy ignored");
+#endif
+		break;
+	case Opt_decompress_workers:
+#ifdef CONFIG_EROFS_FS_ZIP
+		if (!result.uint_32 ||
+		    result.uint_32 > EROFS_MAX_DECOMPRESS_WORKERS) {
+			errorfc(fc, "decompress_workers must be in [1, %u]",
+				EROFS_MAX_DECOMPRESS_WORKERS);
+			return -EINVAL;
+		}
+		ctx->max_decompress_workers = result.uint_32;
+#else
+		errorfc(fc, "compression not supported, decompress_workers ignored");
 #endif
 		break;
 	default:
@@ -541,6 +550,10 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 	if (err)
 		return err;
 
+	err = erofs_register_sysfs(sb);
+	if (err)
+		return err;
+
 	erofs_info(sb, "mounted with root inode @ nid %llu.", ROOT_NID(sbi));
 	return 0;
 }
@@ -621,6 +634,7 @@ static void erofs_put_super(struct super_block *sb)
 
 	DBG_BUGON(!sbi);
 
+	erofs_unregister_sysfs(sb);
 	erofs_shrinker_unregister(sb);
 #ifdef CONFIG_EROFS_FS_ZIP
 	iput(sbi->managed_cache);
@@ -657,10 +671,15 @@ static int __init erofs_module_init(void)
 		goto shrinker_err;
 
 	erofs_pcpubuf_init();
+	z_erofs_init_decompressors();
 	err = z_erofs_init_zip_subsystem();
 	if (err)
 		goto zip_err;
 
+	err = erofs_init_sysfs();
+	if (err)
+		goto sysfs_err;
+
 	err = register_filesystem(&erofs_fs_type);
 	if (err)
 		goto fs_err;
@@ -668,8 +687,11 @@ static int __init erofs_module_init(void)
 	return 0;
 
 fs_err:
+	erofs_exit_sysfs();
+sysfs_err:
 	z_erofs_exit_zip_subsystem();
 zip_err:
+	z_erofs_exit_decompressors();
 	erofs_exit_shrinker();
 shrinker_err:
 	kmem_cache_destroy(erofs_inode_cachep);
@@ -680,12 +702,14 @@ static int __init erofs_module_init(void)
 static void __exit erofs_module_exit(void)
 {
 	unregister_filesystem(&erofs_fs_type);
+	erofs_exit_sysfs();
 	z_erofs_exit_zip_subsystem();
 	erofs_exit_shrinker();
 
 	/* Ensure all RCU free inodes are safe before cache is destroyed. */
 	rcu_barrier();
 	kmem_cache_destroy(erofs_inode_cachep);
+	z_erofs_exit_decompressors();
 	erofs_pcpubuf_exit();
 }
 
@@ -734,6 +758,9 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",cache_strategy=readahead");
 	else if (ctx->cache_strategy == EROFS_ZIP_CACHE_READAROUND)
 		seq_puts(seq, ",cache_strategy=readaround");
+	if (ctx->max_decompress_workers > 1)
+		seq_printf(seq, ",decompress_workers=%u",
+			   ctx->max_decompress_workers);
 #endif
 	return 0;
 }
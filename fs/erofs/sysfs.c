@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-filesystem tunables and statistics under /sys/fs/erofs/<disk>/
+ */
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+
+#include "internal.h"
+
+enum {
+	attr_pointer_ui,
+	attr_pointer_atomic_long,
+	attr_cache_limit,
+	attr_cached,
+};
+
+struct erofs_attr {
+	struct attribute attr;
+	short attr_id;
+	int offset;
+};
+
+#define EROFS_ATTR(_name, _mode, _id, _offset)				\
+static struct erofs_attr erofs_attr_##_name = {				\
+	.attr = {.name = __stringify(_name), .mode = _mode },		\
+	.attr_id = attr_##_id,						\
+	.offset = _offset,						\
+}
+
+#define EROFS_SBI_ATTR_RO(_name, _id, _elname)				\
+	EROFS_ATTR(_name, 0444, _id,					\
+		   offsetof(struct erofs_sb_info, _elname))
+
+#define EROFS_SBI_ATTR_RW(_name, _id, _elname)				\
+	EROFS_ATTR(_name, 0644, _id,					\
+		   offsetof(struct erofs_sb_info, _elname))
+
+#define ATTR_LIST(name) (&erofs_attr_##name.attr)
+
+#ifdef CONFIG_EROFS_FS_ZIP
+EROFS_ATTR(cache_limit_kb, 0644, cache_limit, 0);
+EROFS_ATTR(cached_kb, 0444, cached, 0);
+EROFS_SBI_ATTR_RO(cached_pclusters, pointer_atomic_long, nr_workgroups);
+EROFS_SBI_ATTR_RO(cache_hits, pointer_atomic_long, cache_hits);
+EROFS_SBI_ATTR_RO(cache_misses, pointer_atomic_long, cache_misses);
+EROFS_SBI_ATTR_RO(inplace_io, pointer_atomic_long, inplace_io);
+#endif
+
+static struct attribute *erofs_attrs[] = {
+#ifdef CONFIG_EROFS_FS_ZIP
+	ATTR_LIST(cache_limit_kb),
+	ATTR_LIST(cached_kb),
+	ATTR_LIST(cached_pclusters),
+	ATTR_LIST(cache_hits),
+	ATTR_LIST(cache_misses),
+	ATTR_LIST(inplace_io),
+#endif
+	NULL,
+};
+ATTRIBUTE_GROUPS(erofs);
+
+static ssize_t erofs_attr_show(struct kobject *kobj,
+			       struct attribute *attr, char *buf)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+	struct erofs_attr *a = container_of(attr, struct erofs_attr, attr);
+	unsigned char *ptr = (unsigned char *)sbi + a->offset;
+
+	switch (a->attr_id) {
+	case attr_pointer_ui:
+		return sysfs_emit(buf, "%u\n", *(unsigned int *)ptr);
+	case attr_pointer_atomic_long:
+		return sysfs_emit(buf, "%ld\n",
+				  atomic_long_read((atomic_long_t *)ptr));
+#ifdef CONFIG_EROFS_FS_ZIP
+	case attr_cache_limit:
+		return sysfs_emit(buf, "%lu\n",
+				  READ_ONCE(sbi->cache_limit_pages) <<
+				  (PAGE_SHIFT - 10));
+	case attr_cached:
+		return sysfs_emit(buf, "%lu\n",
+				  READ_ONCE(sbi->managed_cache->i_mapping->nrpages) <<
+				  (PAGE_SHIFT - 10));
+#endif
+	}
+	return 0;
+}
+
+static ssize_t erofs_attr_store(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t len)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+	struct erofs_attr *a = container_of(attr, struct erofs_attr, attr);
+	unsigned char *ptr = (unsigned char *)sbi + a->offset;
+	unsigned long t;
+	int ret;
+
+	switch (a->attr_id) {
+	case attr_pointer_ui:
+		ret = kstrtoul(skip_spaces(buf), 0, &t);
+		if (ret)
+			return ret;
+		if (t != (unsigned int)t)
+			return -ERANGE;
+		*(unsigned int *)ptr = t;
+		return len;
+#ifdef CONFIG_EROFS_FS_ZIP
+	case attr_cache_limit:
+		ret = kstrtoul(skip_spaces(buf), 0, &t);
+		if (ret)
+			return ret;
+		WRITE_ONCE(sbi->cache_limit_pages, t >> (PAGE_SHIFT - 10));
+		erofs_trim_managed_cache(sbi);
+		return len;
+#endif
+	}
+	return 0;
+}
+
+static void erofs_sb_release(struct kobject *kobj)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+
+	complete(&sbi->s_kobj_unregister);
+}
+
+static const struct sysfs_ops erofs_attr_ops = {
+	.show	= erofs_attr_show,
+	.store	= erofs_attr_store,
+};
+
+static struct kobj_type erofs_sb_ktype = {
+	.default_groups = erofs_groups,
+	.sysfs_ops	= &erofs_attr_ops,
+	.release	= erofs_sb_release,
+};
+
+static struct kobj_type erofs_ktype = {
+	.sysfs_ops	= &erofs_attr_ops,
+};
+
+static struct kset erofs_root = {
+	.kobj	= {.ktype = &erofs_ktype},
+};
+
+int erofs_register_sysfs(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	int err;
+
+	sbi->s_kobj.kset = &erofs_root;
+	init_completion(&sbi->s_kobj_unregister);
+	err = kobject_init_and_add(&sbi->s_kobj, &erofs_sb_ktype, NULL,
+				   "%s", sb->s_id);
+	if (err)
+		goto put_sb_kobj;
+	return 0;
+
+put_sb_kobj:
+	kobject_put(&sbi->s_kobj);
+	wait_for_completion(&sbi->s_kobj_unregister);
+	return err;
+}
+
+void erofs_unregister_sysfs(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+
+	if (!sbi->s_kobj.state_in_sysfs)
+		return;
+
+	kobject_del(&sbi->s_kobj);
+	kobject_put(&sbi->s_kobj);
+	wait_for_completion(&sbi->s_kobj_unregister);
+}
+
+int __init erofs_init_sysfs(void)
+{
+	kobject_set_name(&erofs_root.kobj, "erofs");
+	erofs_root.kobj.parent = fs_kobj;
+	return kset_register(&erofs_root);
+}
+
+void erofs_exit_sysfs(void)
+{
+	kset_unregister(&erofs_root);
+}
@@ -60,6 +60,8 @@ struct erofs_workgroup *erofs_find_workgroup(struct super_block *sb,
 		}
 
 		DBG_BUGON(index != grp->index);
+		if (!READ_ONCE(grp->referenced))
+			WRITE_ONCE(grp->referenced, true);
 	}
 	rcu_read_unlock();
 	return grp;
@@ -93,6 +95,8 @@ struct erofs_workgroup *erofs_insert_workgroup(struct super_block *sb,
 		}
 		atomic_dec(&grp->refcount);
 		grp = pre;
+	} else {
+		atomic_long_inc(&sbi->nr_workgroups);
 	}
 	xa_unlock(&sbi->managed_pslots);
 	return grp;
@@ -143,6 +147,7 @@ static bool erofs_try_to_release_workgroup(struct erofs_sb_info *sbi,
 	 * DBG_BUGON to observe this in advance.
 	 */
 	DBG_BUGON(__xa_erase(&sbi->managed_pslots, grp->index) != grp);
+	atomic_long_dec(&sbi->nr_workgroups);
 
 	/* last refcount should be connected with its managed pslot.  */
 	erofs_workgroup_unfreeze(grp, 0);
@@ -173,6 +178,59 @@ static unsigned long erofs_shrink_workstation(struct erofs_sb_info *sbi,
 	return freed;
 }
 
+/*
+ * Bring the managed cache back under 7/8 of cache_limit_pages. This is a
+ * CLOCK pass over the workstation: workgroups looked up since the previous
+ * pass only lose their referenced mark, the others are released together
+ * with their cached pages. The second round catches the ones whose mark
+ * was just cleared if the first one wasn't enough.
+ */
+static void erofs_cache_trim_workfn(struct work_struct *work)
+{
+	struct erofs_sb_info *sbi = container_of(work, struct erofs_sb_info,
+						 cache_trim_work);
+	struct address_space *mc = sbi->managed_cache->i_mapping;
+	unsigned long limit = READ_ONCE(sbi->cache_limit_pages);
+	unsigned long target = limit - limit / 8;
+	struct erofs_workgroup *grp;
+	unsigned long index;
+	int round;
+
+	if (!limit)
+		return;
+
+	for (round = 0; round < 2; ++round) {
+		xa_lock(&sbi->managed_pslots);
+		xa_for_each(&sbi->managed_pslots, index, grp) {
+			if (READ_ONCE(mc->nrpages) <= target)
+				break;
+
+			if (READ_ONCE(grp->referenced)) {
+				WRITE_ONCE(grp->referenced, false);
+				continue;
+			}
+
+			if (!erofs_try_to_release_workgroup(sbi, grp))
+				continue;
+			xa_unlock(&sbi->managed_pslots);
+			cond_resched();
+			xa_lock(&sbi->managed_pslots);
+		}
+		xa_unlock(&sbi->managed_pslots);
+
+		if (READ_ONCE(mc->nrpages) <= target)
+			break;
+	}
+}
+
+void erofs_trim_managed_cache(struct erofs_sb_info *sbi)
+{
+	unsigned long limit = READ_ONCE(sbi->cache_limit_pages);
+
+	if (limit && READ_ONCE(sbi->managed_cache->i_mapping->nrpages) > limit)
+		queue_work(system_unbound_wq, &sbi->cache_trim_work);
+}
+
 /* protected by 'erofs_sb_list_lock' */
 static unsigned int shrinker_run_no;
 
@@ -185,6 +243,7 @@ void erofs_shrinker_register(struct super_block *sb)
 	struct erofs_sb_info *sbi = EROFS_SB(sb);
 
 	mutex_init(&sbi->umount_mutex);
+	INIT_WORK(&sbi->cache_trim_work, erofs_cache_trim_workfn);
 
 	spin_lock(&erofs_sb_list_lock);
 	list_add(&sbi->list, &erofs_sb_list);
@@ -195,6 +254,7 @@ void erofs_shrinker_unregister(struct super_block *sb)
 {
 	struct erofs_sb_info *const sbi = EROFS_SB(sb);
 
+	cancel_work_sync(&sbi->cache_trim_work);
 	mutex_lock(&sbi->umount_mutex);
 	/* clean up all remaining workgroups in memory */
 	erofs_shrink_workstation(sbi, ~0UL);
@@ -239,6 +239,7 @@ static void preload_compressed_pages(struct z_erofs_collector *clt,
 				     enum z_erofs_cache_alloctype type,
 				     struct list_head *pagepool)
 {
+	struct erofs_sb_info *const sbi = EROFS_I_SB(mc->host);
 	struct z_erofs_pcluster *pcl = clt->pcl;
 	bool standalone = true;
 	gfp_t gfp = (mapping_gfp_mask(mc) & ~__GFP_DIRECT_RECLAIM) |
@@ -263,8 +264,10 @@ static void preload_compressed_pages(struct z_erofs_collector *clt,
 		page = find_get_page(mc, index);
 
 		if (page) {
+			atomic_long_inc(&sbi->cache_hits);
 			t = tag_compressed_page_justfound(page);
 		} else {
+			atomic_long_inc(&sbi->cache_misses);
 			/* I/O is needed, no possible to decompress directly */
 			standalone = false;
 			switch (type) {
@@ -384,8 +387,10 @@ static int z_erofs_attach_page(struct z_erofs_collector *clt,
 	/* give priority for inplaceio */
 	if (clt->mode >= COLLECT_PRIMARY &&
 	    type == Z_EROFS_PAGE_TYPE_EXCLUSIVE &&
-	    z_erofs_try_inplace_io(clt, page))
+	    z_erofs_try_inplace_io(clt, page)) {
+		atomic_long_inc(&EROFS_I_SB(page->mapping->host)->inplace_io);
 		return 0;
+	}
 
 	ret = z_erofs_pagevec_enqueue(&clt->vector, page, type,
 				      pvec_safereuse);
@@ -495,7 +500,7 @@ static int z_erofs_register_collection(struct z_erofs_collector *clt,
 			Z_EROFS_PCLUSTER_FULL_LENGTH : 0);
 
 	if (map->m_flags & EROFS_MAP_ZIPPED)
-		pcl->algorithmformat = Z_EROFS_COMPRESSION_LZ4;
+		pcl->algorithmformat = map->m_algorithmformat;
 	else
 		pcl->algorithmformat = Z_EROFS_COMPRESSION_SHIFTED;
 
@@ -648,6 +653,20 @@ static bool should_alloc_managed_pages(struct z_erofs_decompress_frontend *fe,
 		la < fe->headoffset;
 }
 
+/*
+ * Once the managed cache is over its budget, stop growing it and let the
+ * trimming work shrink it back; in-place I/O is used instead meanwhile.
+ */
+static bool z_erofs_managed_cache_full(struct erofs_sb_info *sbi)
+{
+	unsigned long limit = READ_ONCE(sbi->cache_limit_pages);
+
+	if (!limit || READ_ONCE(MNGD_MAPPING(sbi)->nrpages) < limit)
+		return false;
+	erofs_trim_managed_cache(sbi);
+	return true;
+}
+
 static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 				struct page *page, struct list_head *pagepool)
 {
@@ -701,7 +720,8 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 		goto err_out;
 
 	/* preload all compressed pages (maybe downgrade role if necessary) */
-	if (should_alloc_managed_pages(fe, sbi->ctx.cache_strategy, map->m_la))
+	if (should_alloc_managed_pages(fe, sbi->ctx.cache_strategy, map->m_la) &&
+	    !z_erofs_managed_cache_full(sbi))
 		cache_strategy = TRYALLOC;
 	else
 		cache_strategy = DONTALLOC;
@@ -1063,6 +1083,93 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+/* decompress a sub-queue split off by z_erofs_fanout_queue() */
+static void z_erofs_decompress_subqueue_work(struct work_struct *work)
+{
+	struct z_erofs_decompressqueue *q =
+		container_of(work, struct z_erofs_decompressqueue, u.work);
+	LIST_HEAD(pagepool);
+
+	z_erofs_decompress_queue(q, &pagepool);
+
+	put_pages_list(&pagepool);
+	kvfree(q);
+}
+
+/* don't bother fanning out fewer pclusters than this to a worker */
+#define Z_EROFS_MIN_PCLUSTERS_PER_WORKER	4
+
+/*
+ * Split a closed chain into up to max_decompress_workers contiguous
+ * sub-chains and queue all but the first as independent background
+ * queues. The caller decompresses what is left in @io itself.
+ *
+ * Nothing waits for the sub-queues: every output page is unlocked by
+ * z_erofs_onlinepage_endio() once all pclusters covering it are done,
+ * no matter which worker finishes last, so page unlock ordering is the
+ * same as with one worker.
+ */
+static void z_erofs_fanout_queue(struct z_erofs_decompressqueue *io,
+				 struct list_head *pagepool)
+{
+	unsigned int nr_workers = EROFS_SB(io->sb)->ctx.max_decompress_workers;
+	z_erofs_next_pcluster_t owned;
+	struct z_erofs_pcluster *pcl;
+	unsigned int count = 0, chunk, i, n;
+
+	if (nr_workers <= 1)
+		return;
+
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED;
+	     owned = READ_ONCE(pcl->next)) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		++count;
+	}
+
+	nr_workers = min(nr_workers, num_online_cpus());
+	nr_workers = min(nr_workers, count / Z_EROFS_MIN_PCLUSTERS_PER_WORKER);
+	if (nr_workers <= 1)
+		return;
+
+	chunk = DIV_ROUND_UP(count, nr_workers);
+
+	/* skip the chunk which is kept by the current worker */
+	owned = io->head;
+	for (i = 0; i < chunk; ++i) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+	}
+	WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		struct z_erofs_decompressqueue *q;
+		z_erofs_next_pcluster_t head = owned;
+
+		for (n = 0; n < chunk &&
+		     owned != Z_EROFS_PCLUSTER_TAIL_CLOSED; ++n) {
+			pcl = container_of(owned, struct z_erofs_pcluster, next);
+			owned = READ_ONCE(pcl->next);
+		}
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+
+		q = kvzalloc(sizeof(*q), GFP_NOIO | __GFP_NOWARN);
+		if (!q) {
+			/* decompress this sub-chain inline then */
+			struct z_erofs_decompressqueue fallback = {
+				.sb = io->sb,
+				.head = head,
+			};
+
+			z_erofs_decompress_queue(&fallback, pagepool);
+			continue;
+		}
+		q->sb = io->sb;
+		q->head = head;
+		INIT_WORK(&q->u.work, z_erofs_decompress_subqueue_work);
+		queue_work(z_erofs_workqueue, &q->u.work);
+	}
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1070,6 +1177,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	z_erofs_fanout_queue(bgq, &pagepool);
 	z_erofs_decompress_queue(bgq, &pagepool);
 
 	put_pages_list(&pagepool);
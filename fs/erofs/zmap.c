@@ -69,12 +69,20 @@ static int z_erofs_fill_inode_lazy(struct inode *inode)
 	vi->z_algorithmtype[0] = h->h_algorithmtype & 15;
 	vi->z_algorithmtype[1] = h->h_algorithmtype >> 4;
 
-	if (vi->z_algorithmtype[0] >= Z_EROFS_COMPRESSION_MAX) {
+	if (!z_erofs_decompressor_available(vi->z_algorithmtype[0])) {
 		erofs_err(sb, "unknown compression format %u for nid %llu, please upgrade kernel",
 			  vi->z_algorithmtype[0], vi->nid);
 		err = -EOPNOTSUPP;
 		goto unmap_done;
 	}
+	if (vi->z_algorithmtype[0] != Z_EROFS_COMPRESSION_LZ4 &&
+	    !(EROFS_SB(sb)->available_compr_algs &
+	      BIT(vi->z_algorithmtype[0]))) {
+		erofs_err(sb, "compression format %u of nid %llu isn't configured in the superblock",
+			  vi->z_algorithmtype[0], vi->nid);
+		err = -EFSCORRUPTED;
+		goto unmap_done;
+	}
 
 	vi->z_logical_clusterbits = LOG_BLOCK_SIZE + (h->h_clusterbits & 7);
 	if (!erofs_sb_has_big_pcluster(EROFS_SB(sb)) &&
@@ -578,6 +586,8 @@ int z_erofs_map_blocks_iter(struct inode *inode,
 	map->m_llen = end - map->m_la;
 	map->m_pa = blknr_to_addr(m.pblk);
 	map->m_flags |= EROFS_MAP_MAPPED;
+	/* only HEAD (type 1) lclusters exist so far, see z_algorithmtype[] */
+	map->m_algorithmformat = vi->z_algorithmtype[0];
 
 	err = z_erofs_get_extent_compressedlen(&m, initial_lcn);
 	if (err)
@@ -318,6 +318,8 @@ void fscache_object_init(struct fscache_object *object,
 	INIT_LIST_HEAD(&object->pending_ops);
 	object->n_children = 0;
 	object->n_ops = object->n_in_progress = object->n_exclusive = 0;
+	atomic_set(&object->n_page_hits, 0);
+	atomic_set(&object->n_page_misses, 0);
 	object->events = 0;
 	object->store_limit = 0;
 	object->store_limit_l = 0;
@@ -7,6 +7,7 @@
 */
 
 #include "fuse_i.h"
+#include "dev_ring.h"
 
 #include <linux/init.h>
 #include <linux/module.h>
@@ -22,6 +23,11 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/bvec.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -1224,7 +1230,7 @@ __releases(fiq->lock)
  * fuse_request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, bool nonblock,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	ssize_t err;
@@ -1261,7 +1267,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 			break;
 		spin_unlock(&fiq->lock);
 
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
 		err = wait_event_interruptible_exclusive(fiq->waitq,
 				!fiq->connected || request_pending(fiq));
@@ -1387,7 +1393,8 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, struct iov_iter *to)
 
 	fuse_copy_init(&cs, 1, to);
 
-	return fuse_dev_do_read(fud, file, &cs, iov_iter_count(to));
+	return fuse_dev_do_read(fud, file->f_flags & O_NONBLOCK, &cs,
+				iov_iter_count(to));
 }
 
 static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
@@ -1411,7 +1418,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, 1, NULL);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fud, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in->f_flags & O_NONBLOCK, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -2085,6 +2092,193 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+/*
+ * Shared memory rings, see dev_ring.h for the layout. Both directions go
+ * through the same fuse_dev_do_read() and fuse_dev_do_write() paths as
+ * read() and write() do, with the copy state pointed at the slot's pages.
+ */
+#define FUSE_RING_MAX_ENTRIES		1024
+#define FUSE_RING_MAX_ENTRY_SIZE	(FUSE_MAX_MAX_PAGES * PAGE_SIZE + PAGE_SIZE)
+#define FUSE_RING_MAX_SIZE		SZ_64M
+
+struct fuse_ring {
+	/* serializes FUSE_DEV_IOC_RING_ENTER callers */
+	struct mutex lock;
+	struct fuse_ring_header *hdr;
+	void *sq;
+	void *cq;
+	size_t size;
+	unsigned int entries;
+	unsigned int entry_size;
+	/* scratch for the slot being copied, one per page of a slot */
+	struct bio_vec *bvecs;
+};
+
+static void fuse_ring_free(struct fuse_ring *ring)
+{
+	if (!ring)
+		return;
+	kfree(ring->bvecs);
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+static int fuse_ring_setup(struct fuse_dev *fud, void __user *argp)
+{
+	struct fuse_ring_setup setup;
+	struct fuse_ring *ring;
+	int err;
+
+	if (copy_from_user(&setup, argp, sizeof(setup)))
+		return -EFAULT;
+
+	if (setup.flags || setup.padding ||
+	    !is_power_of_2(setup.entries) ||
+	    setup.entries > FUSE_RING_MAX_ENTRIES ||
+	    !setup.entry_size || !PAGE_ALIGNED(setup.entry_size) ||
+	    setup.entry_size > FUSE_RING_MAX_ENTRY_SIZE ||
+	    2 * (u64)setup.entries * setup.entry_size >
+	    FUSE_RING_MAX_SIZE - PAGE_SIZE)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	mutex_init(&ring->lock);
+	ring->entries = setup.entries;
+	ring->entry_size = setup.entry_size;
+	ring->size = PAGE_SIZE + 2 * (size_t)setup.entries * setup.entry_size;
+
+	err = -ENOMEM;
+	ring->bvecs = kcalloc(setup.entry_size >> PAGE_SHIFT,
+			      sizeof(*ring->bvecs), GFP_KERNEL);
+	if (!ring->bvecs)
+		goto err_free;
+	ring->hdr = vmalloc_user(ring->size);
+	if (!ring->hdr)
+		goto err_free;
+
+	ring->sq = (void *)ring->hdr + PAGE_SIZE;
+	ring->cq = ring->sq + (size_t)setup.entries * setup.entry_size;
+	ring->hdr->entries = setup.entries;
+	ring->hdr->entry_size = setup.entry_size;
+
+	/* the ring lives as long as the device, set it up only once */
+	if (cmpxchg(&fud->ring, NULL, ring)) {
+		err = -EBUSY;
+		goto err_free;
+	}
+	return 0;
+
+err_free:
+	fuse_ring_free(ring);
+	return err;
+}
+
+static void fuse_ring_slot_iter(struct fuse_ring *ring, void *slot,
+				size_t len, unsigned int dir,
+				struct iov_iter *iter)
+{
+	unsigned int i, nr = DIV_ROUND_UP(len, PAGE_SIZE);
+
+	for (i = 0; i < nr; i++) {
+		ring->bvecs[i].bv_page = vmalloc_to_page(slot + i * PAGE_SIZE);
+		ring->bvecs[i].bv_offset = 0;
+		ring->bvecs[i].bv_len = min_t(size_t, PAGE_SIZE,
+					      len - i * PAGE_SIZE);
+	}
+	iov_iter_bvec(iter, dir, ring->bvecs, nr, len);
+}
+
+/* hand all replies the daemon queued to their requests */
+static void fuse_ring_complete(struct fuse_dev *fud, struct fuse_ring *ring)
+{
+	struct fuse_ring_header *hdr = ring->hdr;
+	unsigned int mask = ring->entries - 1;
+	u32 head = hdr->cq_head;
+	u32 tail = smp_load_acquire(&hdr->cq_tail);
+
+	while (head != tail && tail - head <= ring->entries) {
+		void *slot = ring->cq + (size_t)(head & mask) * ring->entry_size;
+		u32 len = READ_ONCE(((struct fuse_out_header *)slot)->len);
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+
+		/* a malformed reply is dropped, as a failed write() would be */
+		if (len >= sizeof(struct fuse_out_header) &&
+		    len <= ring->entry_size) {
+			fuse_ring_slot_iter(ring, slot, len, WRITE, &iter);
+			fuse_copy_init(&cs, 0, &iter);
+			fuse_dev_do_write(fud, &cs, len);
+		}
+		head++;
+		smp_store_release(&hdr->cq_head, head);
+	}
+}
+
+static long fuse_ring_enter(struct fuse_dev *fud, unsigned int flags)
+{
+	struct fuse_ring *ring = READ_ONCE(fud->ring);
+	struct fuse_ring_header *hdr;
+	unsigned int mask;
+	long queued = 0;
+	ssize_t err = 0;
+	u32 tail;
+
+	if (!ring)
+		return -EINVAL;
+	if (flags & ~FUSE_RING_ENTER_WAIT)
+		return -EINVAL;
+
+	hdr = ring->hdr;
+	mask = ring->entries - 1;
+
+	mutex_lock(&ring->lock);
+	fuse_ring_complete(fud, ring);
+
+	tail = hdr->sq_tail;
+	while (tail - smp_load_acquire(&hdr->sq_head) < ring->entries) {
+		void *slot = ring->sq + (size_t)(tail & mask) * ring->entry_size;
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+
+		fuse_ring_slot_iter(ring, slot, ring->entry_size, READ, &iter);
+		fuse_copy_init(&cs, 1, &iter);
+		err = fuse_dev_do_read(fud, queued || !(flags & FUSE_RING_ENTER_WAIT),
+				       &cs, ring->entry_size);
+		if (err < 0)
+			break;
+		tail++;
+		smp_store_release(&hdr->sq_tail, tail);
+		queued++;
+	}
+	mutex_unlock(&ring->lock);
+
+	if (queued || err == -EAGAIN)
+		return queued;
+	return err;
+}
+
+static int fuse_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_ring *ring;
+
+	if (!fud)
+		return -EPERM;
+
+	ring = READ_ONCE(fud->ring);
+	if (!ring)
+		return -ENODEV;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(ring->size))
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->hdr, 0);
+}
+
 static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
@@ -2248,6 +2442,7 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 			WARN_ON(fc->iq.fasync != NULL);
 			fuse_abort_conn(fc);
 		}
+		fuse_ring_free(fud->ring);
 		fuse_dev_free(fud);
 	}
 	return 0;
@@ -2287,6 +2482,7 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 {
 	int res;
 	int oldfd;
+	u32 flags;
 	struct fuse_dev *fud = NULL;
 
 	switch (cmd) {
@@ -2324,6 +2520,21 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 				res = fuse_passthrough_open(fud, oldfd);
 		}
 		break;
+	case FUSE_DEV_IOC_RING_SETUP:
+		res = -EINVAL;
+		fud = fuse_get_dev(file);
+		if (fud)
+			res = fuse_ring_setup(fud, (void __user *)arg);
+		break;
+	case FUSE_DEV_IOC_RING_ENTER:
+		res = -EFAULT;
+		if (!get_user(flags, (__u32 __user *)arg)) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_ring_enter(fud, flags);
+		}
+		break;
 	default:
 		res = -ENOTTY;
 		break;
@@ -2340,6 +2551,7 @@ const struct file_operations fuse_dev_operations = {
 	.write_iter	= fuse_dev_write,
 	.splice_write	= fuse_dev_splice_write,
 	.poll		= fuse_dev_poll,
+	.mmap		= fuse_dev_mmap,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
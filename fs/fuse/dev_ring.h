@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * FUSE: shared memory request/reply rings on /dev/fuse
+ *
+ * A daemon thread sets up a ring on its (usually cloned) /dev/fuse file
+ * descriptor with FUSE_DEV_IOC_RING_SETUP and mmap()s it at offset 0. The
+ * mapping starts with a struct fuse_ring_header page, followed by
+ * @entries submission slots and @entries completion slots of @entry_size
+ * bytes each.
+ *
+ * Submission slots hold requests exactly as read() on /dev/fuse would
+ * return them; the kernel advances sq_tail and the daemon sq_head.
+ * Completion slots hold replies and notifications exactly as they would be
+ * write()n; the daemon advances cq_tail and the kernel cq_head. Each
+ * FUSE_DEV_IOC_RING_ENTER call first consumes all completions, then fills
+ * all free submission slots, so one syscall moves a whole batch in both
+ * directions. Setting up one ring per CPU, each on its own cloned device
+ * and served by a thread bound to that CPU, gives per-CPU queues.
+ */
+
+#ifndef _FS_FUSE_DEV_RING_H
+#define _FS_FUSE_DEV_RING_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+struct fuse_ring_setup {
+	__u32	entries;	/* slots per direction, a power of two */
+	__u32	entry_size;	/* bytes per slot, a multiple of the page size */
+	__u32	flags;		/* must be zero */
+	__u32	padding;
+};
+
+struct fuse_ring_header {
+	__u32	sq_head;
+	__u32	sq_tail;
+	__u32	cq_head;
+	__u32	cq_tail;
+	__u32	entries;
+	__u32	entry_size;
+};
+
+/* block until at least one request could be queued */
+#define FUSE_RING_ENTER_WAIT	(1 << 0)
+
+#define FUSE_DEV_IOC_RING_SETUP		_IOW(FUSE_DEV_IOC_MAGIC, 127, \
+					     struct fuse_ring_setup)
+#define FUSE_DEV_IOC_RING_ENTER		_IOW(FUSE_DEV_IOC_MAGIC, 128, __u32)
+
+#endif /* _FS_FUSE_DEV_RING_H */
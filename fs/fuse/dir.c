@@ -1131,8 +1131,8 @@ static int fuse_update_get_attr(struct inode *inode, struct file *file,
 				unsigned int flags)
 {
 	struct fuse_inode *fi = get_fuse_inode(inode);
+	bool sync, expired = false;
 	int err = 0;
-	bool sync;
 
 	if (flags & AT_STATX_FORCE_SYNC)
 		sync = true;
@@ -1141,7 +1141,15 @@ static int fuse_update_get_attr(struct inode *inode, struct file *file,
 	else if (request_mask & READ_ONCE(fi->inval_mask))
 		sync = true;
 	else
-		sync = time_before64(fi->i_time, get_jiffies_64());
+		sync = expired = time_before64(fi->i_time, get_jiffies_64());
+
+	/*
+	 * Attributes that merely timed out can be refreshed from the lower
+	 * inode of a passthrough file, which is what userspace would have
+	 * asked anyway.
+	 */
+	if (expired && !fuse_passthrough_getattr(inode, stat))
+		return 0;
 
 	if (sync) {
 		forget_all_cached_acls(inode);
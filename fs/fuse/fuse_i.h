@@ -156,6 +156,14 @@ struct fuse_inode {
 	 */
 	struct rw_semaphore i_mmap_sem;
 
+	/**
+	 * Lower file system path and credentials of the first passthrough
+	 * open, used to refresh timed out attributes without an upcall.
+	 * Protected by @lock.
+	 */
+	struct path passthrough_path;
+	const struct cred *passthrough_cred;
+
 #ifdef CONFIG_FUSE_DAX
 	/*
 	 * Dax specific inode data
@@ -179,6 +187,7 @@ enum {
 struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
+struct fuse_ring;
 
 /**
  * Reference to lower filesystem file for read/write operations handled in
@@ -501,6 +510,9 @@ struct fuse_dev {
 
 	/** list entry on fc->devices */
 	struct list_head entry;
+
+	/** Shared memory request/reply ring, if set up */
+	struct fuse_ring *ring;
 };
 
 struct fuse_fs_context {
@@ -1265,5 +1277,16 @@ void fuse_passthrough_release(struct fuse_passthrough *passthrough);
 ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
 ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe, size_t len,
+				     unsigned int flags);
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags);
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx);
+void fuse_passthrough_attach_inode(struct inode *inode,
+				   struct fuse_passthrough *passthrough);
+void fuse_passthrough_detach_inode(struct inode *inode);
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat);
 
 #endif /* _FS_FUSE_I_H */
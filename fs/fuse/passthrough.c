@@ -4,6 +4,7 @@
 
 #include <linux/fuse.h>
 #include <linux/idr.h>
+#include <linux/splice.h>
 #include <linux/uio.h>
 
 #define PASSTHROUGH_IOCB_MASK                                                  \
@@ -194,6 +195,200 @@ ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
 	return ret;
 }
 
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe, size_t len,
+				     unsigned int flags)
+{
+	ssize_t ret;
+	const struct cred *old_cred;
+	struct fuse_file *ff = in->private_data;
+	struct file *passthrough_filp = ff->passthrough.filp;
+
+	if (!passthrough_filp->f_op->splice_read)
+		return generic_file_splice_read(in, ppos, pipe, len, flags);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = passthrough_filp->f_op->splice_read(passthrough_filp, ppos, pipe,
+						  len, flags);
+	revert_creds(old_cred);
+
+	fuse_file_accessed(in, passthrough_filp);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags)
+{
+	ssize_t ret;
+	const struct cred *old_cred;
+	struct fuse_file *ff = out->private_data;
+	struct inode *fuse_inode = file_inode(out);
+	struct file *passthrough_filp = ff->passthrough.filp;
+
+	inode_lock(fuse_inode);
+
+	fuse_copyattr(out, passthrough_filp);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	file_start_write(passthrough_filp);
+	if (passthrough_filp->f_op->splice_write)
+		ret = passthrough_filp->f_op->splice_write(pipe,
+							   passthrough_filp,
+							   ppos, len, flags);
+	else
+		ret = iter_file_splice_write(pipe, passthrough_filp, ppos, len,
+					     flags);
+	file_end_write(passthrough_filp);
+	if (ret > 0)
+		fuse_copyattr(out, passthrough_filp);
+	revert_creds(old_cred);
+
+	inode_unlock(fuse_inode);
+
+	return ret;
+}
+
+struct fuse_passthrough_dir_ctx {
+	struct dir_context ctx;
+	struct dir_context *caller;
+};
+
+static int fuse_passthrough_filldir(struct dir_context *ctx, const char *name,
+				    int namelen, loff_t offset, u64 ino,
+				    unsigned int d_type)
+{
+	struct fuse_passthrough_dir_ctx *pctx =
+		container_of(ctx, struct fuse_passthrough_dir_ctx, ctx);
+
+	return pctx->caller->actor(pctx->caller, name, namelen, offset, ino,
+				   d_type);
+}
+
+/*
+ * Directory offsets are those of the lower directory, which is only ever
+ * iterated through this file, so its position simply mirrors ours.
+ */
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx)
+{
+	int ret;
+	const struct cred *old_cred;
+	struct fuse_file *ff = file->private_data;
+	struct file *passthrough_filp = ff->passthrough.filp;
+	struct fuse_passthrough_dir_ctx pctx = {
+		.ctx.actor = fuse_passthrough_filldir,
+		.caller = ctx,
+	};
+
+	passthrough_filp->f_pos = ctx->pos;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = iterate_dir(passthrough_filp, &pctx.ctx);
+	revert_creds(old_cred);
+
+	ctx->pos = passthrough_filp->f_pos;
+
+	fuse_file_accessed(file, passthrough_filp);
+
+	return ret;
+}
+
+/**
+ * fuse_passthrough_attach_inode - remember the lower inode behind an inode
+ * @inode:	FUSE inode that was opened in passthrough mode
+ * @passthrough: the open's passthrough file and credentials
+ *
+ * Only the first passthrough open of an inode is recorded; the lower path
+ * stays referenced until the FUSE inode is evicted.
+ */
+void fuse_passthrough_attach_inode(struct inode *inode,
+				   struct fuse_passthrough *passthrough)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	spin_lock(&fi->lock);
+	if (!fi->passthrough_path.dentry) {
+		fi->passthrough_path = passthrough->filp->f_path;
+		path_get(&fi->passthrough_path);
+		fi->passthrough_cred = get_cred(passthrough->cred);
+	}
+	spin_unlock(&fi->lock);
+}
+
+void fuse_passthrough_detach_inode(struct inode *inode)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	if (!fi->passthrough_path.dentry)
+		return;
+
+	path_put(&fi->passthrough_path);
+	put_cred(fi->passthrough_cred);
+	fi->passthrough_path.mnt = NULL;
+	fi->passthrough_path.dentry = NULL;
+	fi->passthrough_cred = NULL;
+}
+
+/**
+ * fuse_passthrough_getattr - refresh attributes from the lower inode
+ * @inode:	FUSE inode whose attributes timed out
+ * @stat:	filled in like fuse_update_get_attr() would, may be NULL
+ *
+ * Ownership and permissions are whatever userspace last told us, since it
+ * may well present them differently from the lower file system; only the
+ * size and timestamps, which passthrough I/O changes underneath us, are
+ * taken from the lower inode. Returns -ENOENT if the inode was never
+ * opened in passthrough mode.
+ */
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	const struct cred *old_cred, *cred;
+	struct kstat lower_stat;
+	struct path path;
+	int err;
+
+	spin_lock(&fi->lock);
+	if (!fi->passthrough_path.dentry) {
+		spin_unlock(&fi->lock);
+		return -ENOENT;
+	}
+	path = fi->passthrough_path;
+	path_get(&path);
+	cred = get_cred(fi->passthrough_cred);
+	spin_unlock(&fi->lock);
+
+	old_cred = override_creds(cred);
+	err = vfs_getattr(&path, &lower_stat,
+			  STATX_SIZE | STATX_ATIME | STATX_MTIME | STATX_CTIME,
+			  AT_STATX_SYNC_AS_STAT);
+	revert_creds(old_cred);
+	put_cred(cred);
+	path_put(&path);
+	if (err)
+		return err;
+
+	spin_lock(&fi->lock);
+	inode->i_atime = lower_stat.atime;
+	inode->i_mtime = lower_stat.mtime;
+	inode->i_ctime = lower_stat.ctime;
+	/* with writeback caching the kernel's size is the authoritative one */
+	if (S_ISREG(inode->i_mode) && !fc->writeback_cache &&
+	    !test_bit(FUSE_I_SIZE_UNSTABLE, &fi->state))
+		i_size_write(inode, lower_stat.size);
+	spin_unlock(&fi->lock);
+
+	if (stat) {
+		generic_fillattr(inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
+	}
+
+	return 0;
+}
+
 int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd)
 {
 	int res;
@@ -212,8 +407,11 @@ int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd)
 		return -EBADF;
 	}
 
-	if (!passthrough_filp->f_op->read_iter ||
-	    !passthrough_filp->f_op->write_iter) {
+	if (S_ISDIR(file_inode(passthrough_filp)->i_mode) ?
+	    (!passthrough_filp->f_op->iterate_shared &&
+	     !passthrough_filp->f_op->iterate) :
+	    (!passthrough_filp->f_op->read_iter ||
+	     !passthrough_filp->f_op->write_iter)) {
 		pr_err("FUSE: passthrough file misses file operations.\n");
 		res = -EBADF;
 		goto err_free_file;
@@ -574,6 +574,10 @@ int fuse_readdir(struct file *file, struct dir_context *ctx)
 	if (fuse_is_bad(inode))
 		return -EIO;
 
+	if (ff->passthrough.filp &&
+	    S_ISDIR(file_inode(ff->passthrough.filp)->i_mode))
+		return fuse_passthrough_readdir(file, ctx);
+
 	mutex_lock(&ff->readdir.lock);
 
 	err = UNCACHED;
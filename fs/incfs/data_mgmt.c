@@ -37,12 +37,17 @@ static void zstd_free_workspace(struct work_struct *work)
 	struct delayed_work *dw = container_of(work, struct delayed_work, work);
 	struct mount_info *mi =
 		container_of(dw, struct mount_info, mi_zstd_cleanup_work);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mi->mi_zstd); ++i) {
+		struct incfs_zstd_stream *zs = &mi->mi_zstd[i];
 
-	mutex_lock(&mi->mi_zstd_workspace_mutex);
-	kvfree(mi->mi_zstd_workspace);
-	mi->mi_zstd_workspace = NULL;
-	mi->mi_zstd_stream = NULL;
-	mutex_unlock(&mi->mi_zstd_workspace_mutex);
+		mutex_lock(&zs->lock);
+		kvfree(zs->workspace);
+		zs->workspace = NULL;
+		zs->stream = NULL;
+		mutex_unlock(&zs->lock);
+	}
 }
 
 struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
@@ -52,6 +57,7 @@ struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
 	struct mount_info *mi = NULL;
 	int error = 0;
 	struct incfs_sysfs_node *node;
+	int i;
 
 	mi = kzalloc(sizeof(*mi), GFP_NOFS);
 	if (!mi)
@@ -71,7 +77,8 @@ struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
 	spin_lock_init(&mi->pending_read_lock);
 	INIT_LIST_HEAD(&mi->mi_reads_list_head);
 	spin_lock_init(&mi->mi_per_uid_read_timeouts_lock);
-	mutex_init(&mi->mi_zstd_workspace_mutex);
+	for (i = 0; i < ARRAY_SIZE(mi->mi_zstd); ++i)
+		mutex_init(&mi->mi_zstd[i].lock);
 	INIT_DELAYED_WORK(&mi->mi_zstd_cleanup_work, zstd_free_workspace);
 	mutex_init(&mi->mi_le_mutex);
 
@@ -168,7 +175,8 @@ void incfs_free_mount_info(struct mount_info *mi)
 	dput(mi->mi_incomplete_dir);
 	path_put(&mi->mi_backing_dir_path);
 	mutex_destroy(&mi->mi_dir_struct_mutex);
-	mutex_destroy(&mi->mi_zstd_workspace_mutex);
+	for (i = 0; i < ARRAY_SIZE(mi->mi_zstd); ++i)
+		mutex_destroy(&mi->mi_zstd[i].lock);
 	put_cred(mi->mi_owner);
 	kfree(mi->mi_log.rl_ring_buf);
 	for (i = 0; i < ARRAY_SIZE(mi->pseudo_file_xattr); ++i)
@@ -180,9 +188,11 @@ void incfs_free_mount_info(struct mount_info *mi)
 
 static void data_file_segment_init(struct data_file_segment *segment)
 {
-	init_waitqueue_head(&segment->new_data_arrival_wq);
+	int i;
+
 	init_rwsem(&segment->rwsem);
-	INIT_LIST_HEAD(&segment->reads_list_head);
+	for (i = 0; i < ARRAY_SIZE(segment->reads_hash); i++)
+		INIT_HLIST_HEAD(&segment->reads_hash[i]);
 }
 
 char *file_id_to_str(incfs_uuid_t id)
@@ -421,18 +431,37 @@ void incfs_free_dir_file(struct dir_file *dir)
 	kfree(dir);
 }
 
+/*
+ * Take any idle zstd context so concurrent readers of a mount don't
+ * serialize on one stream; only block when all of them are busy.
+ */
+static struct incfs_zstd_stream *zstd_get_stream(struct mount_info *mi)
+{
+	struct incfs_zstd_stream *zs;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mi->mi_zstd); ++i)
+		if (mutex_trylock(&mi->mi_zstd[i].lock))
+			return &mi->mi_zstd[i];
+
+	zs = &mi->mi_zstd[raw_smp_processor_id() % ARRAY_SIZE(mi->mi_zstd)];
+	if (mutex_lock_interruptible(&zs->lock))
+		return NULL;
+	return zs;
+}
+
 static ssize_t zstd_decompress_safe(struct mount_info *mi,
 				    struct mem_range src, struct mem_range dst)
 {
 	ssize_t result;
 	ZSTD_inBuffer inbuf = {.src = src.data,	.size = src.len};
 	ZSTD_outBuffer outbuf = {.dst = dst.data, .size = dst.len};
+	struct incfs_zstd_stream *zs = zstd_get_stream(mi);
 
-	result = mutex_lock_interruptible(&mi->mi_zstd_workspace_mutex);
-	if (result)
-		return result;
+	if (!zs)
+		return -EINTR;
 
-	if (!mi->mi_zstd_stream) {
+	if (!zs->stream) {
 		unsigned int workspace_size = ZSTD_DStreamWorkspaceBound(
 						INCFS_DATA_FILE_BLOCK_SIZE);
 		void *workspace = kvmalloc(workspace_size, GFP_NOFS);
@@ -451,18 +480,18 @@ static ssize_t zstd_decompress_safe(struct mount_info *mi,
 			goto out;
 		}
 
-		mi->mi_zstd_workspace = workspace;
-		mi->mi_zstd_stream = stream;
+		zs->workspace = workspace;
+		zs->stream = stream;
 	}
 
-	result = ZSTD_decompressStream(mi->mi_zstd_stream, &outbuf, &inbuf) ?
+	result = ZSTD_decompressStream(zs->stream, &outbuf, &inbuf) ?
 		-EBADMSG : outbuf.pos;
 
 	mod_delayed_work(system_wq, &mi->mi_zstd_cleanup_work,
 			 msecs_to_jiffies(5000));
 
 out:
-	mutex_unlock(&mi->mi_zstd_workspace_mutex);
+	mutex_unlock(&zs->lock);
 	return result;
 }
 
@@ -792,6 +821,15 @@ static struct data_file_segment *get_file_segment(struct data_file *df,
 	return &df->df_segments[seg_idx];
 }
 
+static struct hlist_head *get_pending_reads_bucket(
+		struct data_file_segment *segment, int block_index)
+{
+	int bucket = (block_index / SEGMENTS_PER_FILE) %
+		     ARRAY_SIZE(segment->reads_hash);
+
+	return &segment->reads_hash[bucket];
+}
+
 static bool is_data_block_present(struct data_file_block *block)
 {
 	return (block->db_backing_file_data_offset != 0) &&
@@ -1034,6 +1072,7 @@ static struct pending_read *add_pending_read(struct data_file *df,
 	result->block_index = block_index;
 	result->timestamp_us = ktime_to_us(ktime_get());
 	result->uid = current_uid().val;
+	init_waitqueue_head(&result->wait);
 
 	spin_lock(&mi->pending_read_lock);
 
@@ -1041,7 +1080,8 @@ static struct pending_read *add_pending_read(struct data_file *df,
 	mi->mi_pending_reads_count++;
 
 	list_add_rcu(&result->mi_reads_list, &mi->mi_reads_list_head);
-	list_add_rcu(&result->segment_reads_list, &segment->reads_list_head);
+	hlist_add_head_rcu(&result->segment_reads_node,
+			   get_pending_reads_bucket(segment, block_index));
 
 	spin_unlock(&mi->pending_read_lock);
 
@@ -1074,7 +1114,7 @@ static void remove_pending_read(struct data_file *df, struct pending_read *read)
 	spin_lock(&mi->pending_read_lock);
 
 	list_del_rcu(&read->mi_reads_list);
-	list_del_rcu(&read->segment_reads_list);
+	hlist_del_rcu(&read->segment_reads_node);
 
 	mi->mi_pending_reads_count--;
 
@@ -1092,13 +1132,15 @@ static void notify_pending_reads(struct mount_info *mi,
 
 	/* Notify pending reads waiting for this block. */
 	rcu_read_lock();
-	list_for_each_entry_rcu(entry, &segment->reads_list_head,
-						segment_reads_list) {
-		if (entry->block_index == index)
+	hlist_for_each_entry_rcu(entry,
+				 get_pending_reads_bucket(segment, index),
+				 segment_reads_node) {
+		if (entry->block_index == index) {
 			set_read_done(entry);
+			wake_up(&entry->wait);
+		}
 	}
 	rcu_read_unlock();
-	wake_up_all(&segment->new_data_arrival_wq);
 
 	atomic_inc(&mi->mi_blocks_written);
 	wake_up_all(&mi->mi_blocks_written_notif_wq);
@@ -1120,6 +1162,22 @@ static int usleep_interruptible(u32 us)
 		return msleep_interruptible(us / 1000);
 }
 
+static int lookup_data_block(struct data_file *df, int block_index,
+			     struct data_file_block *block)
+{
+	struct data_file_segment *segment = get_file_segment(df, block_index);
+	int error;
+
+	error = down_read_killable(&segment->rwsem);
+	if (error)
+		return error;
+
+	error = get_data_file_block(df, block_index, block);
+
+	up_read(&segment->rwsem);
+	return error;
+}
+
 static int wait_for_data_block(struct data_file *df, int block_index,
 			       struct data_file_block *res_block,
 			       struct incfs_read_data_file_timeouts *timeouts)
@@ -1145,15 +1203,8 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 	mi = df->df_mount_info;
 	segment = get_file_segment(df, block_index);
 
-	error = down_read_killable(&segment->rwsem);
-	if (error)
-		return error;
-
 	/* Look up the given block */
-	error = get_data_file_block(df, block_index, &block);
-
-	up_read(&segment->rwsem);
-
+	error = lookup_data_block(df, block_index, &block);
 	if (error)
 		return error;
 
@@ -1184,9 +1235,17 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 		return -EFSCORRUPTED;
 	}
 
+	/*
+	 * The block may have been written after the lookup above but before
+	 * the pending read became visible to notify_pending_reads().
+	 */
+	if (!lookup_data_block(df, block_index, &block) &&
+	    is_data_block_present(&block))
+		set_read_done(read);
+
 	/* Wait for notifications about block's arrival */
 	wait_res =
-		wait_event_interruptible_timeout(segment->new_data_arrival_wq,
+		wait_event_interruptible_timeout(read->wait,
 			(is_read_done(read)),
 			usecs_to_jiffies(timeouts->max_pending_time_us));
 
@@ -1280,46 +1339,33 @@ static int incfs_update_sysfs_error(struct file *file, int index, int result,
 	return 0;
 }
 
-ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
-			int index, struct mem_range tmp,
-			struct incfs_read_data_file_timeouts *timeouts)
+/* Read, decompress and verify one data block already known to be present */
+static ssize_t decode_data_file_block(struct mem_range dst, struct file *f,
+				      int index, struct data_file_block *block,
+				      struct mem_range tmp)
 {
-	loff_t pos;
-	ssize_t result;
-	size_t bytes_to_read;
-	struct mount_info *mi = NULL;
-	struct backing_file_context *bfc = NULL;
-	struct data_file_block block = {};
 	struct data_file *df = get_incfs_data_file(f);
+	struct mount_info *mi = df->df_mount_info;
+	struct backing_file_context *bfc = df->df_backing_file_context;
+	size_t bytes_to_read;
+	ssize_t result;
+	loff_t pos;
 
-	if (!dst.data || !df || !tmp.data)
-		return -EFAULT;
-
-	if (tmp.len < 2 * INCFS_DATA_FILE_BLOCK_SIZE)
-		return -ERANGE;
-
-	mi = df->df_mount_info;
-	bfc = df->df_backing_file_context;
-
-	result = wait_for_data_block(df, index, &block, timeouts);
-	if (result < 0)
-		goto out;
-
-	pos = block.db_backing_file_data_offset;
-	if (block.db_comp_alg == COMPRESSION_NONE) {
-		bytes_to_read = min(dst.len, block.db_stored_size);
+	pos = block->db_backing_file_data_offset;
+	if (block->db_comp_alg == COMPRESSION_NONE) {
+		bytes_to_read = min(dst.len, block->db_stored_size);
 		result = incfs_kread(bfc, dst.data, bytes_to_read, pos);
 
 		/* Some data was read, but not enough */
 		if (result >= 0 && result != bytes_to_read)
 			result = -EIO;
 	} else {
-		bytes_to_read = min(tmp.len, block.db_stored_size);
+		bytes_to_read = min(tmp.len, block->db_stored_size);
 		result = incfs_kread(bfc, tmp.data, bytes_to_read, pos);
 		if (result == bytes_to_read) {
 			result =
 				decompress(mi, range(tmp.data, bytes_to_read),
-					   dst, block.db_comp_alg);
+					   dst, block->db_comp_alg);
 			if (result < 0) {
 				const char *name =
 				    bfc->bc_file->f_path.dentry->d_name.name;
@@ -1340,22 +1386,167 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 			result = err;
 	}
 
+	return result;
+}
+
+static void account_block_read(struct file *f, int index, ssize_t result)
+{
+	struct data_file *df = get_incfs_data_file(f);
+	struct mount_info *mi = df->df_mount_info;
+
 	if (result >= 0)
 		log_block_read(mi, &df->df_id, index);
-
-out:
-	if (result == -ETIME)
+	else if (result == -ETIME)
 		mi->mi_reads_failed_timed_out++;
 	else if (result == -EBADMSG)
 		mi->mi_reads_failed_hash_verification++;
-	else if (result < 0)
+	else
 		mi->mi_reads_failed_other++;
 
 	incfs_update_sysfs_error(f, index, result, mi, df);
+}
+
+ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
+			int index, struct mem_range tmp,
+			struct incfs_read_data_file_timeouts *timeouts)
+{
+	ssize_t result;
+	struct data_file_block block = {};
+	struct data_file *df = get_incfs_data_file(f);
 
+	if (!dst.data || !df || !tmp.data)
+		return -EFAULT;
+
+	if (tmp.len < 2 * INCFS_DATA_FILE_BLOCK_SIZE)
+		return -ERANGE;
+
+	result = wait_for_data_block(df, index, &block, timeouts);
+	if (result >= 0)
+		result = decode_data_file_block(dst, f, index, &block, tmp);
+
+	account_block_read(f, index, result);
 	return result;
 }
 
+struct read_batch_work {
+	struct work_struct work;
+	struct file *f;
+	int index;
+	struct data_file_block block;
+	struct incfs_read_batch_block *out;
+	struct mem_range tmp;
+	atomic_t *pending;
+	struct completion *done;
+};
+
+static void read_batch_work_fn(struct work_struct *work)
+{
+	struct read_batch_work *rw =
+		container_of(work, struct read_batch_work, work);
+
+	rw->out->result = decode_data_file_block(rw->out->dst, rw->f,
+						 rw->index, &rw->block,
+						 rw->tmp);
+	if (atomic_dec_and_test(rw->pending))
+		complete(rw->done);
+}
+
+/*
+ * Decode a run of consecutive blocks, typically for readahead. Blocks that
+ * are present are decompressed and verified in parallel; the first one is
+ * done inline before the rest are queued, so that the hash pages it
+ * verifies (usually shared by the whole run) are already PageChecked when
+ * the others look them up. Missing blocks are left for the regular,
+ * waiting read path.
+ */
+int incfs_read_data_file_blocks(struct incfs_read_batch_block *blocks,
+				int count, struct file *f, int first_index)
+{
+	struct data_file *df = get_incfs_data_file(f);
+	DECLARE_COMPLETION_ONSTACK(done);
+	atomic_t pending = ATOMIC_INIT(1);
+	struct read_batch_work *works;
+	struct read_batch_work *first = NULL;
+	int i;
+
+	if (!df)
+		return -EBADF;
+
+	if (count <= 0 || count > INCFS_READ_BATCH_MAX)
+		return -EINVAL;
+
+	if (df->df_blockmap_off <= 0 || !df->df_mount_info)
+		return -ENODATA;
+
+	works = kcalloc(count, sizeof(*works), GFP_NOFS);
+	if (!works)
+		return -ENOMEM;
+
+	for (i = 0; i < count; ++i) {
+		struct read_batch_work *rw = &works[i];
+		int index = first_index + i;
+		int error;
+
+		blocks[i].result = -ETIME;
+		if (!blocks[i].dst.data || index < 0 ||
+		    index >= df->df_data_block_count)
+			continue;
+
+		error = lookup_data_block(df, index, &rw->block);
+		if (error) {
+			blocks[i].result = error;
+			continue;
+		}
+
+		if (!is_data_block_present(&rw->block))
+			continue;
+
+		rw->tmp.len = 2 * INCFS_DATA_FILE_BLOCK_SIZE;
+		rw->tmp.data = (u8 *)__get_free_pages(GFP_NOFS,
+						      get_order(rw->tmp.len));
+		if (!rw->tmp.data) {
+			blocks[i].result = -ENOMEM;
+			continue;
+		}
+
+		rw->f = f;
+		rw->index = index;
+		rw->out = &blocks[i];
+		rw->pending = &pending;
+		rw->done = &done;
+		INIT_WORK(&rw->work, read_batch_work_fn);
+		if (!first)
+			first = rw;
+	}
+
+	if (first) {
+		first->out->result = decode_data_file_block(first->out->dst, f,
+							    first->index,
+							    &first->block,
+							    first->tmp);
+		for (i = first - works + 1; i < count; ++i) {
+			if (!works[i].tmp.data)
+				continue;
+			atomic_inc(&pending);
+			queue_work(system_unbound_wq, &works[i].work);
+		}
+	}
+
+	if (!atomic_dec_and_test(&pending))
+		wait_for_completion(&done);
+
+	for (i = 0; i < count; ++i) {
+		if (!works[i].tmp.data)
+			continue;
+		account_block_read(f, works[i].index, blocks[i].result);
+		free_pages((unsigned long)works[i].tmp.data,
+			   get_order(works[i].tmp.len));
+	}
+
+	kfree(works);
+	return 0;
+}
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset)
 {
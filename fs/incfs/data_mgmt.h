@@ -24,6 +24,12 @@
 
 #define SEGMENTS_PER_FILE 3
 
+/* Number of zstd decompression contexts a mount can use concurrently */
+#define INCFS_ZSTD_STREAMS 4
+
+/* Maximum number of blocks incfs_read_data_file_blocks() decodes at once */
+#define INCFS_READ_BATCH_MAX 16
+
 enum LOG_RECORD_TYPE {
 	FULL,
 	SAME_FILE,
@@ -125,6 +131,12 @@ struct mount_options {
 	char *sysfs_name;
 };
 
+struct incfs_zstd_stream {
+	struct mutex lock;
+	void *workspace;
+	ZSTD_DStream *stream;
+};
+
 struct mount_info {
 	struct super_block *mi_sb;
 
@@ -157,7 +169,7 @@ struct mount_info {
 	 *  - reads_list_head
 	 *  - mi_pending_reads_count
 	 *  - mi_last_pending_read_number
-	 *  - data_file_segment.reads_list_head
+	 *  - data_file_segment.reads_hash
 	 */
 	spinlock_t pending_read_lock;
 
@@ -190,10 +202,8 @@ struct mount_info {
 	struct incfs_per_uid_read_timeouts *mi_per_uid_read_timeouts;
 	int mi_per_uid_read_timeouts_size;
 
-	/* zstd workspace */
-	struct mutex mi_zstd_workspace_mutex;
-	void *mi_zstd_workspace;
-	ZSTD_DStream *mi_zstd_stream;
+	/* zstd workspaces, freed after a while without compressed reads */
+	struct incfs_zstd_stream mi_zstd[INCFS_ZSTD_STREAMS];
 	struct delayed_work mi_zstd_cleanup_work;
 
 	/* sysfs node */
@@ -260,22 +270,28 @@ struct pending_read {
 
 	uid_t uid;
 
+	/* The reader waiting for this block sleeps here */
+	wait_queue_head_t wait;
+
 	struct list_head mi_reads_list;
 
-	struct list_head segment_reads_list;
+	struct hlist_node segment_reads_node;
 
 	struct rcu_head rcu;
 };
 
-struct data_file_segment {
-	wait_queue_head_t new_data_arrival_wq;
+#define PENDING_READ_BUCKETS 8
 
+struct data_file_segment {
 	/* Protects reads and writes from the blockmap */
 	struct rw_semaphore rwsem;
 
-	/* List of active pending_read objects belonging to this segment */
-	/* Protected by mount_info.pending_reads_mutex */
-	struct list_head reads_list_head;
+	/*
+	 * Active pending_read objects belonging to this segment, hashed by
+	 * block index so an arriving block only looks at (and wakes) its own
+	 * waiters. RCU safe, updates protected by mount_info.pending_read_lock
+	 */
+	struct hlist_head reads_hash[PENDING_READ_BUCKETS];
 };
 
 /*
@@ -431,6 +447,18 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 			int index, struct mem_range tmp,
 			struct incfs_read_data_file_timeouts *timeouts);
 
+/*
+ * On return, result holds the number of bytes read into dst, or a negative
+ * error. Blocks that haven't arrived yet fail with -ETIME without waiting.
+ */
+struct incfs_read_batch_block {
+	struct mem_range dst;
+	ssize_t result;
+};
+
+int incfs_read_data_file_blocks(struct incfs_read_batch_block *blocks,
+				int count, struct file *f, int first_index);
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset);
 
@@ -45,6 +45,7 @@ static int dir_rename(struct inode *old_dir, struct dentry *old_dentry,
 static int file_open(struct inode *inode, struct file *file);
 static int file_release(struct inode *inode, struct file *file);
 static int read_single_page(struct file *f, struct page *page);
+static void readahead_pages(struct readahead_control *rac);
 static long dispatch_ioctl(struct file *f, unsigned int req, unsigned long arg);
 
 #ifdef CONFIG_COMPAT
@@ -109,7 +110,7 @@ static const struct dentry_operations incfs_dentry_ops = {
 
 static const struct address_space_operations incfs_address_space_ops = {
 	.readpage = read_single_page,
-	/* .readpages = readpages */
+	.readahead = readahead_pages,
 };
 
 static vm_fault_t incfs_fault(struct vm_fault *vmf)
@@ -475,17 +476,16 @@ static struct dentry *open_or_create_special_dir(struct dentry *backing_dir,
 	return index_dentry;
 }
 
-static int read_single_page_timeouts(struct data_file *df, struct file *f,
-				     int block_index, struct mem_range range,
-				     struct mem_range tmp)
+static void get_read_timeouts(struct mount_info *mi,
+			      struct incfs_read_data_file_timeouts *timeouts)
 {
-	struct mount_info *mi = df->df_mount_info;
-	struct incfs_read_data_file_timeouts timeouts = {
-		.max_pending_time_us = U32_MAX,
-	};
 	int uid = current_uid().val;
 	int i;
 
+	*timeouts = (struct incfs_read_data_file_timeouts) {
+		.max_pending_time_us = U32_MAX,
+	};
+
 	spin_lock(&mi->mi_per_uid_read_timeouts_lock);
 	for (i = 0; i < mi->mi_per_uid_read_timeouts_size /
 		sizeof(*mi->mi_per_uid_read_timeouts); ++i) {
@@ -493,21 +493,29 @@ static int read_single_page_timeouts(struct data_file *df, struct file *f,
 			&mi->mi_per_uid_read_timeouts[i];
 
 		if(t->uid == uid) {
-			timeouts.min_time_us = t->min_time_us;
-			timeouts.min_pending_time_us = t->min_pending_time_us;
-			timeouts.max_pending_time_us = t->max_pending_time_us;
+			timeouts->min_time_us = t->min_time_us;
+			timeouts->min_pending_time_us = t->min_pending_time_us;
+			timeouts->max_pending_time_us = t->max_pending_time_us;
 			break;
 		}
 	}
 	spin_unlock(&mi->mi_per_uid_read_timeouts_lock);
-	if (timeouts.max_pending_time_us == U32_MAX) {
+	if (timeouts->max_pending_time_us == U32_MAX) {
 		u64 read_timeout_us = (u64)mi->mi_options.read_timeout_ms *
 					1000;
 
-		timeouts.max_pending_time_us = read_timeout_us <= U32_MAX ?
+		timeouts->max_pending_time_us = read_timeout_us <= U32_MAX ?
 					       read_timeout_us : U32_MAX;
 	}
+}
 
+static int read_single_page_timeouts(struct data_file *df, struct file *f,
+				     int block_index, struct mem_range range,
+				     struct mem_range tmp)
+{
+	struct incfs_read_data_file_timeouts timeouts;
+
+	get_read_timeouts(df->df_mount_info, &timeouts);
 	return incfs_read_data_file_block(range, f, block_index, tmp,
 					  &timeouts);
 }
@@ -572,6 +580,77 @@ static int read_single_page(struct file *f, struct page *page)
 	return result;
 }
 
+/*
+ * Decode readahead pages in batches so that decompression and hash
+ * verification of neighbouring blocks run in parallel. Pages whose blocks
+ * haven't arrived go through read_single_page() to wait for them as
+ * before; pages that failed are left !Uptodate for ->readpage to retry
+ * and report.
+ */
+static void readahead_pages(struct readahead_control *rac)
+{
+	struct file *f = rac->file;
+	struct data_file *df = get_incfs_data_file(f);
+	struct incfs_read_batch_block blocks[INCFS_READ_BATCH_MAX];
+	struct page *pages[INCFS_READ_BATCH_MAX];
+	struct incfs_read_data_file_timeouts timeouts;
+	struct page *page;
+	int nr, i;
+
+	if (!df)
+		return;
+
+	/* Readers with artificial delays configured go page by page */
+	get_read_timeouts(df->df_mount_info, &timeouts);
+	if (timeouts.min_time_us || timeouts.min_pending_time_us)
+		return;
+
+	do {
+		int first_block;
+
+		for (nr = 0; nr < INCFS_READ_BATCH_MAX; ++nr) {
+			page = readahead_page(rac);
+			if (!page)
+				break;
+			pages[nr] = page;
+			blocks[nr].dst = range(kmap(page), 0);
+			if (page_offset(page) < df->df_size)
+				blocks[nr].dst.len = min_t(loff_t, PAGE_SIZE,
+					df->df_size - page_offset(page));
+			else
+				blocks[nr].dst.data = NULL;
+			blocks[nr].result = -ETIME;
+		}
+		if (!nr)
+			break;
+
+		first_block = (page_offset(pages[0]) + df->df_mapped_offset) /
+			INCFS_DATA_FILE_BLOCK_SIZE;
+		incfs_read_data_file_blocks(blocks, nr, f, first_block);
+
+		for (i = 0; i < nr; ++i) {
+			page = pages[i];
+			if (blocks[i].result == -ETIME) {
+				/* Not there yet: wait for it as ->readpage does */
+				kunmap(page);
+				read_single_page(f, page);
+				put_page(page);
+				continue;
+			}
+			if (blocks[i].result >= 0) {
+				if (blocks[i].result < PAGE_SIZE)
+					zero_user(page, blocks[i].result,
+						  PAGE_SIZE - blocks[i].result);
+				SetPageUptodate(page);
+			}
+			flush_dcache_page(page);
+			kunmap(page);
+			unlock_page(page);
+			put_page(page);
+		}
+	} while (nr == INCFS_READ_BATCH_MAX);
+}
+
 int incfs_link(struct dentry *what, struct dentry *where)
 {
 	struct dentry *parent_dentry = dget_parent(where);
@@ -745,6 +745,13 @@ static size_t iomap_write_end(struct inode *inode, loff_t pos, size_t len,
 	return ret;
 }
 
+/*
+ * The source buffer of a buffered write is faulted in up to this many bytes
+ * at a time, rather than once per page, so a large write into a single extent
+ * walks the user page tables once per batch.
+ */
+#define IOMAP_WRITE_FAULTIN_BYTES	(16 * PAGE_SIZE)
+
 static loff_t
 iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		struct iomap *iomap, struct iomap *srcmap)
@@ -752,6 +759,7 @@ iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 	struct iov_iter *i = data;
 	long status = 0;
 	ssize_t written = 0;
+	size_t faulted_in = 0;	/* Bytes of @i known to be faulted in */
 
 	do {
 		struct page *page;
@@ -775,10 +783,29 @@ iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		 * Not only is this an optimisation, but it is also required
 		 * to check that the address is actually valid, when atomic
 		 * usercopies are used, below.
+		 *
+		 * Fault in the rest of this extent's part of the buffer at the
+		 * same time, up to IOMAP_WRITE_FAULTIN_BYTES, so the following
+		 * pages can skip this step.  If a page is reclaimed again in
+		 * the meantime the copy below comes up short and we retry
+		 * from here.
 		 */
-		if (unlikely(iov_iter_fault_in_readable(i, bytes))) {
-			status = -EFAULT;
-			break;
+		if (bytes > faulted_in) {
+			size_t want = min_t(loff_t, length, iov_iter_count(i));
+
+			want = max_t(size_t, bytes,
+				     min_t(size_t, want,
+					   IOMAP_WRITE_FAULTIN_BYTES));
+			if (unlikely(iov_iter_fault_in_readable(i, want))) {
+				/* the batch may have run past a bad address */
+				if (want == bytes ||
+				    iov_iter_fault_in_readable(i, bytes)) {
+					status = -EFAULT;
+					break;
+				}
+				want = bytes;
+			}
+			faulted_in = want;
 		}
 
 		status = iomap_write_begin(inode, pos, bytes, 0, &page, iomap,
@@ -797,6 +824,10 @@ iomap_write_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		cond_resched();
 
 		iov_iter_advance(i, copied);
+		if (unlikely(copied < bytes))
+			faulted_in = 0;
+		else
+			faulted_in -= copied;
 		if (unlikely(copied == 0)) {
 			/*
 			 * If we were unable to copy any data at all, we must
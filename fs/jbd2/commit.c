@@ -24,6 +24,7 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/bitops.h>
+#include <linux/workqueue.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -46,6 +47,87 @@ static void journal_end_buffer_io_sync(struct buffer_head *bh, int uptodate)
 	unlock_buffer(bh);
 }
 
+/*
+ * Journal blocks of one descriptor batch are mostly contiguous on disk, so
+ * send each contiguous run as a single bio instead of a bio per buffer.
+ * The buffers have to be set up for submit_bh() already; runs that can't
+ * get their bookkeeping allocated just fall back to it.
+ */
+struct jbd2_log_bio {
+	unsigned int nr;
+	struct buffer_head *bhs[];
+};
+
+static void journal_end_log_bio(struct bio *bio)
+{
+	struct jbd2_log_bio *lb = bio->bi_private;
+	int uptodate = !bio->bi_status;
+	unsigned int i;
+
+	for (i = 0; i < lb->nr; i++)
+		journal_end_buffer_io_sync(lb->bhs[i], uptodate);
+
+	kfree(lb);
+	bio_put(bio);
+}
+
+static unsigned int jbd2_log_run(struct buffer_head **bhs, unsigned int nr)
+{
+	unsigned int n;
+
+	for (n = 1; n < min_t(unsigned int, nr, BIO_MAX_PAGES); n++) {
+		if (bhs[n]->b_bdev != bhs[0]->b_bdev ||
+		    bhs[n]->b_size != bhs[0]->b_size ||
+		    bhs[n]->b_blocknr != bhs[0]->b_blocknr + n)
+			break;
+	}
+
+	return n;
+}
+
+static void jbd2_submit_log_bufs(struct buffer_head **bhs, unsigned int nr)
+{
+	while (nr) {
+		unsigned int i, n = jbd2_log_run(bhs, nr);
+		struct buffer_head *bh = bhs[0];
+		struct jbd2_log_bio *lb = NULL;
+		struct bio *bio;
+
+		if (n > 1)
+			lb = kmalloc(struct_size(lb, bhs, n),
+				     GFP_NOFS | __GFP_NOWARN);
+		if (!lb) {
+			for (i = 0; i < n; i++)
+				submit_bh(REQ_OP_WRITE, REQ_SYNC, bhs[i]);
+			bhs += n;
+			nr -= n;
+			continue;
+		}
+
+		bio = bio_alloc(GFP_NOFS, n);
+		bio_set_dev(bio, bh->b_bdev);
+		bio->bi_iter.bi_sector = bh->b_blocknr * (bh->b_size >> 9);
+		bio->bi_end_io = journal_end_log_bio;
+		bio->bi_private = lb;
+		bio_set_op_attrs(bio, REQ_OP_WRITE, REQ_SYNC);
+
+		for (i = 0; i < n; i++) {
+			bh = bhs[i];
+			if (!bio_add_page(bio, bh->b_page, bh->b_size,
+					  bh_offset(bh)))
+				break;
+			if (test_set_buffer_req(bh))
+				clear_buffer_write_io_error(bh);
+			lb->bhs[i] = bh;
+		}
+		lb->nr = i;
+
+		submit_bio(bio);
+		bhs += i;
+		nr -= i;
+	}
+}
+
 /*
  * When an ext4 file is truncated, it is possible that some pages are not
  * successfully freed, because they are attached to a committing transaction.
@@ -372,6 +454,79 @@ static void jbd2_block_tag_csum_set(journal_t *j, journal_block_tag_t *tag,
 	else
 		tag->t_checksum = cpu_to_be16(csum32);
 }
+
+/*
+ * A full descriptor batch of 4K blocks is about a megabyte of crc32c, so
+ * big batches are checksummed by a few unbound workers while the commit
+ * thread takes its own share.
+ */
+#define JBD2_CSUM_CHUNK		64
+#define JBD2_CSUM_WORKERS	4
+
+struct jbd2_csum_work {
+	struct work_struct work;
+	journal_t *journal;
+	journal_block_tag_t **tags;
+	struct buffer_head **bhs;
+	unsigned int nr;
+	__u32 sequence;
+};
+
+static void jbd2_csum_range(journal_t *j, journal_block_tag_t **tags,
+			    struct buffer_head **bhs, unsigned int nr,
+			    __u32 sequence)
+{
+	unsigned int i;
+
+	/* descriptor blocks have no tag of their own */
+	for (i = 0; i < nr; i++)
+		if (tags[i])
+			jbd2_block_tag_csum_set(j, tags[i], bhs[i], sequence);
+}
+
+static void jbd2_csum_workfn(struct work_struct *work)
+{
+	struct jbd2_csum_work *w = container_of(work, struct jbd2_csum_work,
+						work);
+
+	jbd2_csum_range(w->journal, w->tags, w->bhs, w->nr, w->sequence);
+}
+
+static void jbd2_block_tags_csum_set(journal_t *j, journal_block_tag_t **tags,
+				     struct buffer_head **bhs, unsigned int nr,
+				     __u32 sequence)
+{
+	struct jbd2_csum_work works[JBD2_CSUM_WORKERS - 1];
+	unsigned int nw, chunk, i;
+
+	nw = min3(nr / JBD2_CSUM_CHUNK, num_online_cpus(),
+		  (unsigned int)JBD2_CSUM_WORKERS);
+	if (nw <= 1) {
+		jbd2_csum_range(j, tags, bhs, nr, sequence);
+		return;
+	}
+
+	chunk = DIV_ROUND_UP(nr, nw);
+	for (i = 0; i < nw - 1; i++) {
+		struct jbd2_csum_work *w = &works[i];
+
+		INIT_WORK_ONSTACK(&w->work, jbd2_csum_workfn);
+		w->journal = j;
+		w->tags = tags + i * chunk;
+		w->bhs = bhs + i * chunk;
+		w->nr = chunk;
+		w->sequence = sequence;
+		queue_work(system_unbound_wq, &w->work);
+	}
+
+	jbd2_csum_range(j, tags + i * chunk, bhs + i * chunk, nr - i * chunk,
+			sequence);
+
+	for (i = 0; i < nw - 1; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+	}
+}
 /*
  * jbd2_journal_commit_transaction
  *
@@ -385,6 +540,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	struct journal_head *jh;
 	struct buffer_head *descriptor;
 	struct buffer_head **wbuf = journal->j_wbuf;
+	journal_block_tag_t **tags = NULL;
 	int bufs;
 	int flags;
 	int err;
@@ -618,6 +774,11 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	J_ASSERT(commit_transaction->t_nr_buffers <=
 		 atomic_read(&commit_transaction->t_outstanding_credits));
 
+	/* without room to remember the tags, checksum blocks one by one */
+	if (csum_size)
+		tags = kmalloc_array(journal->j_wbufsize, sizeof(*tags),
+				     GFP_NOFS | __GFP_NOWARN);
+
 	err = 0;
 	bufs = 0;
 	descriptor = NULL;
@@ -672,6 +833,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 			first_tag = 1;
 			set_buffer_jwrite(descriptor);
 			set_buffer_dirty(descriptor);
+			if (tags)
+				tags[bufs] = NULL;
 			wbuf[bufs++] = descriptor;
 
 			/* Record it so that we can wait for IO
@@ -728,8 +891,11 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 		tag = (journal_block_tag_t *) tagp;
 		write_tag_block(journal, tag, jh2bh(jh)->b_blocknr);
 		tag->t_flags = cpu_to_be16(tag_flag);
-		jbd2_block_tag_csum_set(journal, tag, wbuf[bufs],
-					commit_transaction->t_tid);
+		if (tags)
+			tags[bufs] = tag;
+		else
+			jbd2_block_tag_csum_set(journal, tag, wbuf[bufs],
+						commit_transaction->t_tid);
 		tagp += tag_bytes;
 		space_left -= tag_bytes;
 		bufs++;
@@ -756,6 +922,9 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 
 			tag->t_flags |= cpu_to_be16(JBD2_FLAG_LAST_TAG);
 start_journal_io:
+			if (tags)
+				jbd2_block_tags_csum_set(journal, tags, wbuf,
+						bufs, commit_transaction->t_tid);
 			if (descriptor)
 				jbd2_descriptor_block_csum_set(journal,
 							descriptor);
@@ -774,8 +943,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 				clear_buffer_dirty(bh);
 				set_buffer_uptodate(bh);
 				bh->b_end_io = journal_end_buffer_io_sync;
-				submit_bh(REQ_OP_WRITE, REQ_SYNC, bh);
 			}
+			jbd2_submit_log_bufs(wbuf, bufs);
 			cond_resched();
 
 			/* Force a new descriptor to be generated next
@@ -784,6 +953,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 			bufs = 0;
 		}
 	}
+	kfree(tags);
 
 	err = journal_finish_inode_data_buffers(journal, commit_transaction);
 	if (err) {
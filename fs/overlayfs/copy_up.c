@@ -141,6 +141,7 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
+	bool copy_range = false;
 	int error = 0;
 
 	if (len == 0)
@@ -162,6 +163,17 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 		goto out;
 	/* Couldn't clone, so now we try to copy the data */
 
+	/*
+	 * If the upper fs can copy (or share) the data itself, e.g. a server
+	 * side copy when lower and upper are the same fs, prefer that over
+	 * bouncing every chunk through a pipe.  The method is called directly,
+	 * as vfs_copy_file_range() would take freeze protection on the upper
+	 * sb a second time.
+	 */
+	if (new_file->f_op->copy_file_range &&
+	    file_inode(old_file)->i_sb == file_inode(new_file)->i_sb)
+		copy_range = true;
+
 	/* Check if lower fs supports seek operation */
 	if (old_file->f_mode & FMODE_LSEEK &&
 	    old_file->f_op->llseek)
@@ -209,6 +221,19 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 			}
 		}
 
+		if (copy_range) {
+			bytes = new_file->f_op->copy_file_range(old_file,
+					old_pos, new_file, new_pos, this_len, 0);
+			if (bytes > 0) {
+				old_pos += bytes;
+				new_pos += bytes;
+				len -= bytes;
+				continue;
+			}
+			/* Splice whatever is left */
+			copy_range = false;
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
@@ -78,6 +78,10 @@ static void buffer_size_add(struct persistent_ram_zone *prz, size_t a)
 	size_t new;
 	unsigned long flags = 0;
 
+	/* Once a zone has wrapped its size never changes again. */
+	if (atomic_read(&prz->buffer->size) == prz->buffer_size)
+		return;
+
 	if (!(prz->flags & PRZ_FLAG_NO_LOCK))
 		raw_spin_lock_irqsave(&prz->buffer_lock, flags);
 
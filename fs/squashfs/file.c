@@ -39,6 +39,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -494,7 +495,97 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Decompress each datablock covered by the readahead request straight into
+ * the page cache pages, without going through the intermediate buffer or
+ * grabbing the other pages of the block one by one as squashfs_readpage()
+ * does.  Only whole, separately compressed blocks are handled here; pages of
+ * a partially covered block, of a sparse block or of the fragment are left
+ * !Uptodate and so are read by squashfs_readpage() as before.
+ */
+static void squashfs_readahead(struct readahead_control *ractl)
+{
+	struct inode *inode = ractl->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	const int shift = msblk->block_log - PAGE_SHIFT;
+	const int max_pages = 1 << shift;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	pgoff_t next = readahead_index(ractl);
+	struct page **pages;
+	int i, nr_pages;
+
+	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
+	if (pages == NULL)
+		return;
+
+	for (;;) {
+		pgoff_t start = next & ~(pgoff_t)(max_pages - 1);
+		int index = next >> shift;
+		int expected = index == file_end ?
+				(i_size_read(inode) & (msblk->block_size - 1)) :
+				 msblk->block_size;
+		struct squashfs_page_actor *actor;
+		u64 block = 0;
+		int bsize, res;
+
+		/* Never take pages past the end of the current block */
+		nr_pages = __readahead_batch(ractl, pages,
+					     start + max_pages - next);
+		if (!nr_pages)
+			break;
+		next += nr_pages;
+
+		if (pages[0]->index != start ||
+		    nr_pages != DIV_ROUND_UP(expected, PAGE_SIZE))
+			goto skip_pages;
+
+		if (index == file_end && squashfs_i(inode)->fragment_block !=
+						SQUASHFS_INVALID_BLK)
+			goto skip_pages;
+
+		bsize = read_blocklist(inode, index, &block);
+		if (bsize <= 0)
+			goto skip_pages;
+
+		actor = squashfs_page_actor_init_special(pages, nr_pages, 0);
+		if (actor == NULL)
+			goto skip_pages;
+
+		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+		kfree(actor);
+
+		if (res == expected) {
+			/* Last page may have trailing bytes not filled */
+			int bytes = res % PAGE_SIZE;
+
+			if (bytes) {
+				void *pageaddr = kmap_atomic(pages[nr_pages - 1]);
+
+				memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+				kunmap_atomic(pageaddr);
+			}
+
+			for (i = 0; i < nr_pages; i++) {
+				flush_dcache_page(pages[i]);
+				SetPageUptodate(pages[i]);
+			}
+		}
+
+skip_pages:
+		for (i = 0; i < nr_pages; i++) {
+			unlock_page(pages[i]);
+			put_page(pages[i]);
+		}
+	}
+
+	kfree(pages);
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readahead = squashfs_readahead,
+#endif
 };
@@ -66,6 +66,42 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 	return -EBADMSG;
 }
 
+/*
+ * The level 0 hash page last used while verifying a bio.  Consecutive data
+ * pages of a bio nearly always hash into the same level 0 page, so keeping a
+ * reference to it saves a page cache lookup (and the ->read_merkle_tree_page()
+ * call) per data page.  It is only a cached reference: whether the page is
+ * trusted is still decided by PageChecked.
+ */
+struct fsverity_hpage_cache {
+	struct page *hpage;
+	pgoff_t hindex;
+};
+
+static struct page *read_level0_page(struct inode *inode,
+				     struct fsverity_hpage_cache *cache,
+				     pgoff_t hindex,
+				     unsigned long level0_ra_pages)
+{
+	struct page *hpage;
+
+	if (cache && cache->hpage && cache->hindex == hindex) {
+		get_page(cache->hpage);
+		return cache->hpage;
+	}
+
+	hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
+							  level0_ra_pages);
+	if (cache && !IS_ERR(hpage)) {
+		if (cache->hpage)
+			put_page(cache->hpage);
+		get_page(hpage);
+		cache->hpage = hpage;
+		cache->hindex = hindex;
+	}
+	return hpage;
+}
+
 /*
  * Verify a single data page against the file's Merkle tree.
  *
@@ -85,7 +121,8 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
  */
 static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+			unsigned long level0_ra_pages,
+			struct fsverity_hpage_cache *cache)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
@@ -118,8 +155,12 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
-		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
-				level == 0 ? level0_ra_pages : 0);
+		if (level == 0)
+			hpage = read_level0_page(inode, cache, hindex,
+						 level0_ra_pages);
+		else
+			hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode,
+								hindex, 0);
 		if (IS_ERR(hpage)) {
 			err = PTR_ERR(hpage);
 			fsverity_err(inode,
@@ -196,7 +237,7 @@ bool fsverity_verify_page(struct page *page)
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(vi->tree_params.hash_alg, GFP_NOFS);
 
-	valid = verify_page(inode, vi, req, page, 0);
+	valid = verify_page(inode, vi, req, page, 0, NULL);
 
 	fsverity_free_hash_request(vi->tree_params.hash_alg, req);
 
@@ -228,6 +269,7 @@ void fsverity_verify_bio(struct bio *bio)
 	struct ahash_request *req;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
+	struct fsverity_hpage_cache cache = {};
 	unsigned long max_ra_pages = 0;
 
 	/* This allocation never fails, since it's mempool-backed. */
@@ -255,10 +297,13 @@ void fsverity_verify_bio(struct bio *bio)
 			min(max_ra_pages, params->level0_blocks - level0_index);
 
 		if (!PageError(page) &&
-		    !verify_page(inode, vi, req, page, level0_ra_pages))
+		    !verify_page(inode, vi, req, page, level0_ra_pages,
+				 &cache))
 			SetPageError(page);
 	}
 
+	if (cache.hpage)
+		put_page(cache.hpage);
 	fsverity_free_hash_request(params->hash_alg, req);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
@@ -182,6 +182,7 @@ struct drm_sched_fence *to_drm_sched_fence(struct dma_fence *f);
  * @s_priority: the priority of the job.
  * @entity: the entity to which this job belongs.
  * @cb: the callback for the parent fence in s_fence.
+ * @deadline: optional time by which the job's result is needed, 0 if none.
  *
  * A job is created by the driver using drm_sched_job_init(), and
  * should call drm_sched_entity_push_job() once it wants the scheduler
@@ -198,6 +199,7 @@ struct drm_sched_job {
 	enum drm_sched_priority		s_priority;
 	struct drm_sched_entity  *entity;
 	struct dma_fence_cb		cb;
+	ktime_t				deadline;
 };
 
 static inline bool drm_sched_invalidate_job(struct drm_sched_job *s_job,
@@ -290,6 +292,20 @@ struct drm_gpu_scheduler {
 	bool				free_guilty;
 };
 
+/**
+ * enum drm_sched_policy - how the scheduler picks the next entity
+ *
+ * @DRM_SCHED_POLICY_RR: strict priority, round robin inside a run queue.
+ * @DRM_SCHED_POLICY_DEADLINE: outside the kernel run queue, the ready job
+ *	with the earliest deadline hint runs first, whatever its priority.
+ *	Jobs without a hint keep the round robin behaviour.
+ */
+enum drm_sched_policy {
+	DRM_SCHED_POLICY_RR,
+	DRM_SCHED_POLICY_DEADLINE,
+	DRM_SCHED_POLICY_COUNT,
+};
+
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
 		   uint32_t hw_submission, unsigned hang_limit, long timeout,
@@ -304,6 +320,7 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
                                    unsigned int num_sched_list);
 
 void drm_sched_job_cleanup(struct drm_sched_job *job);
+void drm_sched_job_set_deadline(struct drm_sched_job *job, ktime_t deadline);
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
 void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad);
 void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery);
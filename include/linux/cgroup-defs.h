@@ -459,6 +459,8 @@ struct cgroup {
 	/* per-cpu recursive resource statistics */
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
+	/* jiffies of the last flush of this subtree, under cgroup_rstat_lock */
+	unsigned long rstat_flush_jiffies;
 
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
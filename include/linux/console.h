@@ -152,6 +152,8 @@ struct console {
 	int	cflag;
 	void	*data;
 	struct	 console *next;
+	u64	printk_seq;
+	struct task_struct *thread;
 };
 
 /*
@@ -8,6 +8,7 @@
 
 #include <linux/device.h>
 #include <linux/io.h>
+#include <linux/notifier.h>
 #include <linux/perf_event.h>
 #include <linux/sched.h>
 
@@ -486,6 +487,10 @@ extern char *coresight_alloc_device_name(struct coresight_dev_list *devs,
 
 extern bool coresight_loses_context_with_cpu(struct device *dev);
 
+extern int coresight_register_freeze_notifier(struct notifier_block *nb);
+extern int coresight_unregister_freeze_notifier(struct notifier_block *nb);
+extern void coresight_freeze_trace(const char *reason);
+
 u32 coresight_relaxed_read32(struct coresight_device *csdev, u32 offset);
 u32 coresight_read32(struct coresight_device *csdev, u32 offset);
 void coresight_write32(struct coresight_device *csdev, u32 val, u32 offset);
@@ -529,6 +534,18 @@ static inline bool coresight_loses_context_with_cpu(struct device *dev)
 	return false;
 }
 
+static inline int coresight_register_freeze_notifier(struct notifier_block *nb)
+{
+	return -ENOSYS;
+}
+
+static inline int coresight_unregister_freeze_notifier(struct notifier_block *nb)
+{
+	return -ENOSYS;
+}
+
+static inline void coresight_freeze_trace(const char *reason) {}
+
 static inline u32 coresight_relaxed_read32(struct coresight_device *csdev, u32 offset)
 {
 	WARN_ON_ONCE(1);
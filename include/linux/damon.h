@@ -390,8 +390,15 @@ struct damon_callback {
  *
  * @min_nr_regions:	The minimum number of adaptive monitoring regions.
  * @max_nr_regions:	The maximum number of adaptive monitoring regions.
+ * @nr_shards:		The number of threads sampling the targets in parallel.
  * @adaptive_targets:	Head of monitoring targets (&damon_target) list.
  * @schemes:		Head of schemes (&damos) list.
+ *
+ * If @nr_shards is larger than one, primitives that support it split the
+ * targets into that many sets and do the access sampling of each set in a
+ * separate worker, so that monitoring many targets does not delay the
+ * sampling.  Aggregation and schemes application are still done by @kdamond
+ * alone.  It should not be changed while @kdamond is running.
  */
 struct damon_ctx {
 	unsigned long sample_interval;
@@ -411,6 +418,7 @@ struct damon_ctx {
 
 	unsigned long min_nr_regions;
 	unsigned long max_nr_regions;
+	unsigned int nr_shards;
 	struct list_head adaptive_targets;
 	struct list_head schemes;
 };
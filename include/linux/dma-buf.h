@@ -627,4 +627,7 @@ long dma_buf_set_name(struct dma_buf *dmabuf, const char *name);
 int dma_buf_get_flags(struct dma_buf *dmabuf, unsigned long *flags);
 int dma_buf_get_uuid(struct dma_buf *dmabuf, uuid_t *uuid);
 
+void dma_buf_pool_account(long nr_pages);
+unsigned long dma_buf_pool_excess(void);
+
 #endif /* __DMA_BUF_H__ */
@@ -19,6 +19,7 @@
  * @lock: spinlock for fence handling
  * @prev: previous fence of the chain
  * @prev_seqno: original previous seqno before garbage collection
+ * @signaled_seqno: every point up to this one is known to be signaled
  * @fence: encapsulated fence
  * @cb: callback structure for signaling
  * @work: irq work item for signaling
@@ -28,6 +29,7 @@ struct dma_fence_chain {
 	spinlock_t lock;
 	struct dma_fence __rcu *prev;
 	u64 prev_seqno;
+	atomic64_t signaled_seqno;
 	struct dma_fence *fence;
 	struct dma_fence_cb cb;
 	struct irq_work work;
@@ -123,6 +123,8 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 				 int count);
 struct page *dma_alloc_contiguous(struct device *dev, size_t size, gfp_t gfp);
 void dma_free_contiguous(struct device *dev, struct page *page, size_t size);
+int dma_prepare_contiguous(struct device *dev, size_t size, unsigned int nr);
+void dma_unprepare_contiguous(struct device *dev);
 
 void dma_contiguous_early_fixup(phys_addr_t base, unsigned long size);
 #else /* CONFIG_DMA_CMA */
@@ -160,6 +162,14 @@ static inline void dma_free_contiguous(struct device *dev, struct page *page,
 {
 	__free_pages(page, get_order(size));
 }
+static inline int dma_prepare_contiguous(struct device *dev, size_t size,
+		unsigned int nr)
+{
+	return -ENOSYS;
+}
+static inline void dma_unprepare_contiguous(struct device *dev)
+{
+}
 #endif /* CONFIG_DMA_CMA*/
 
 #ifdef CONFIG_DMA_PERNUMA_CMA
@@ -27,7 +27,10 @@ struct em_perf_state {
 
 /**
  * em_perf_domain - Performance domain
- * @table:		List of performance states, in ascending order
+ * @table:		List of performance states, in ascending order. It can
+ *			be replaced at runtime by em_dev_update_perf_domain(),
+ *			so readers must hold rcu_read_lock() and access it
+ *			through em_perf_state_table().
  * @nr_perf_states:	Number of performance states
  * @milliwatts:		Flag indicating the power values are in milli-Watts
  *			or some other scale.
@@ -51,6 +54,17 @@ struct em_perf_domain {
 
 #define em_span_cpus(em) (to_cpumask((em)->cpus))
 
+/*
+ * Snapshot of the table of a performance domain. The same snapshot must be
+ * used for the whole computation, as a concurrent update may publish a new
+ * table at any time; the old one stays valid until the end of the RCU read
+ * side critical section.
+ */
+static inline struct em_perf_state *em_perf_state_table(struct em_perf_domain *pd)
+{
+	return READ_ONCE(pd->table);
+}
+
 #ifdef CONFIG_ENERGY_MODEL
 #define EM_MAX_POWER 0xFFFF
 
@@ -101,6 +115,7 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 				struct em_data_callback *cb, cpumask_t *span,
 				bool milliwatts);
 void em_dev_unregister_perf_domain(struct device *dev);
+int em_dev_update_perf_domain(struct device *dev, const unsigned long *power);
 
 /**
  * em_cpu_energy() - Estimates the energy consumed by the CPUs of a
@@ -120,12 +135,14 @@ static inline unsigned long em_cpu_energy(struct em_perf_domain *pd,
 				unsigned long max_util, unsigned long sum_util)
 {
 	unsigned long freq, scale_cpu;
-	struct em_perf_state *ps;
+	struct em_perf_state *table, *ps;
 	int i, cpu;
 
 	if (!sum_util)
 		return 0;
 
+	table = em_perf_state_table(pd);
+
 	/*
 	 * In order to predict the performance state, map the utilization of
 	 * the most utilized CPU of the performance domain to a requested
@@ -133,7 +150,7 @@ static inline unsigned long em_cpu_energy(struct em_perf_domain *pd,
 	 */
 	cpu = cpumask_first(to_cpumask(pd->cpus));
 	scale_cpu = arch_scale_cpu_capacity(cpu);
-	ps = &pd->table[pd->nr_perf_states - 1];
+	ps = &table[pd->nr_perf_states - 1];
 	freq = map_util_freq(max_util, ps->frequency, scale_cpu);
 
 	/*
@@ -141,7 +158,7 @@ static inline unsigned long em_cpu_energy(struct em_perf_domain *pd,
 	 * requested frequency.
 	 */
 	for (i = 0; i < pd->nr_perf_states; i++) {
-		ps = &pd->table[i];
+		ps = &table[i];
 		if (ps->frequency >= freq)
 			break;
 	}
@@ -217,6 +234,11 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 static inline void em_dev_unregister_perf_domain(struct device *dev)
 {
 }
+static inline int em_dev_update_perf_domain(struct device *dev,
+					    const unsigned long *power)
+{
+	return -EINVAL;
+}
 static inline struct em_perf_domain *em_cpu_get(int cpu)
 {
 	return NULL;
@@ -353,6 +353,8 @@ struct fscache_object {
 	int			n_in_progress;	/* number of ops in progress */
 	int			n_exclusive;	/* number of exclusive ops queued or in progress */
 	atomic_t		n_reads;	/* number of read ops in progress */
+	atomic_t		n_page_hits;	/* pages found in the cache */
+	atomic_t		n_page_misses;	/* pages not (yet) in the cache */
 	spinlock_t		lock;		/* state and operations lock */
 
 	unsigned long		lookup_jif;	/* time at which lookup started */
@@ -136,6 +136,7 @@ struct kasan_cache {
 	int alloc_meta_offset;
 	int free_meta_offset;
 	bool is_kmalloc;
+	bool is_untagged;
 };
 
 slab_flags_t __kasan_never_merge(void);
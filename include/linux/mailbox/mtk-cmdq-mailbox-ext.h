@@ -131,10 +131,13 @@ struct cmdq_pkt_buffer {
 	u64			alloc_time;
 };
 
+struct cmdq_buf_cache;
+
 struct cmdq_buf_pool {
 	struct dma_pool *pool;
 	atomic_t *cnt;
 	u32 *limit;
+	struct cmdq_buf_cache __percpu *cache;
 };
 
 struct cmdq_pkt_err {
@@ -192,7 +192,8 @@ struct ip_set_type_variant {
 	/* Region-locking is used */
 	bool region_lock;
 
-	ANDROID_KABI_RESERVE(1);
+	/* Set was swapped in, precompute lookup helpers (optional) */
+	ANDROID_KABI_USE(1, void (*swapped)(struct ip_set *set));
 };
 
 struct ip_set_region {
@@ -588,6 +588,10 @@ struct dev_pm_info {
 	bool			no_pm_callbacks:1;	/* Owned by the PM core */
 	unsigned int		must_resume:1;	/* Owned by the PM core */
 	unsigned int		may_skip_resume:1;	/* Set by subsystems */
+	unsigned int		async_promoted:1;	/* Owned by the PM core */
+	u64			suspend_ns;	/* Owned by the PM core */
+	u64			resume_ns;	/* Ditto */
+	u64			wait_ns;	/* Ditto */
 #else
 	unsigned int		should_wakeup:1;
 #endif
@@ -306,6 +306,8 @@ int freq_qos_add_request(struct freq_constraints *qos,
 			 struct freq_qos_request *req,
 			 enum freq_qos_req_type type, s32 value);
 int freq_qos_update_request(struct freq_qos_request *req, s32 new_value);
+int freq_qos_update_requests(struct freq_qos_request **reqs,
+			     const s32 *values, unsigned int nr);
 int freq_qos_remove_request(struct freq_qos_request *req);
 int freq_qos_apply(struct freq_qos_request *req,
 		   enum pm_qos_req_action action, s32 value);
@@ -1015,6 +1015,10 @@ struct task_struct {
 	unsigned int			sessionid;
 #endif
 	struct seccomp			seccomp;
+#ifdef CONFIG_SYSCALL_LATENCY_HIST
+	/* local_clock() at entry of the tracked syscall, 0 if none */
+	u64				syscall_hist_start;
+#endif
 
 	/* Thread group tracking: */
 	u64				parent_exec_id;
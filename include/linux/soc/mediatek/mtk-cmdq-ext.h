@@ -258,6 +258,21 @@ struct cmdq_poll_reuse {
 	struct cmdq_reuse jump_to_end;
 };
 
+/*
+ * Packet recorded once and submitted many times. A client records the
+ * static part on tpl->pkt with the normal cmdq_pkt_* helpers, records
+ * the per-frame values through cmdq_pkt_template_*_slot(), seals it, and
+ * then each frame only patches slot values in place before submit.
+ */
+struct cmdq_pkt_template {
+	struct cmdq_pkt *pkt;
+	struct cmdq_reuse *slot;
+	const char **slot_name;
+	u32 slot_cnt;
+	u32 slot_max;
+	bool sealed;
+};
+
 u32 cmdq_subsys_id_to_base(struct cmdq_base *cmdq_base, int id);
 
 /**
@@ -297,6 +312,7 @@ s32 cmdq_pkt_readback(struct cmdq_pkt *pkt, enum CMDQ_VCP_ENG_ENUM engine,
 void cmdq_mbox_pool_set_limit(struct cmdq_client *cl, u32 limit);
 void cmdq_mbox_pool_create(struct cmdq_client *cl);
 void cmdq_mbox_pool_clear(struct cmdq_client *cl);
+void cmdq_mbox_pool_dump(struct cmdq_client *cl);
 
 void *cmdq_mbox_buf_alloc(struct cmdq_client *cl, dma_addr_t *pa_out);
 
@@ -384,6 +400,72 @@ void cmdq_reuse_refresh(struct cmdq_pkt *pkt, struct cmdq_reuse *reuse, u32 cnt)
 
 s32 cmdq_pkt_copy(struct cmdq_pkt *dst, struct cmdq_pkt *src);
 
+/**
+ * cmdq_pkt_template_create() - create a packet template
+ * @client:	the CMDQ mailbox client
+ * @slot_max:	max number of patch slots the template can record
+ *
+ * Return: template pointer or ERR_PTR() for failed
+ */
+struct cmdq_pkt_template *cmdq_pkt_template_create(struct cmdq_client *client,
+	u32 slot_max);
+void cmdq_pkt_template_destroy(struct cmdq_pkt_template *tpl);
+
+/**
+ * cmdq_pkt_template_write_slot() - record a write whose value is patched
+ *				    per frame
+ * @tpl:	the template, not sealed yet
+ * @name:	slot name, must stay valid as long as the template
+ * @addr:	destination physical address
+ * @value:	initial value
+ * @mask:	write mask
+ *
+ * Return: slot index on success; else the error code is returned
+ */
+s32 cmdq_pkt_template_write_slot(struct cmdq_pkt_template *tpl,
+	const char *name, dma_addr_t addr, u32 value, u32 mask);
+
+/**
+ * cmdq_pkt_template_assign_slot() - record a GPR assign whose value is
+ *				     patched per frame
+ * @tpl:	the template, not sealed yet
+ * @name:	slot name, must stay valid as long as the template
+ * @reg_idx:	the GPR/SPR index to assign
+ * @value:	initial value
+ *
+ * Return: slot index on success; else the error code is returned
+ */
+s32 cmdq_pkt_template_assign_slot(struct cmdq_pkt_template *tpl,
+	const char *name, u16 reg_idx, u32 value);
+
+s32 cmdq_pkt_template_seal(struct cmdq_pkt_template *tpl);
+
+/* Look up a slot index by name, meant for setup time rather than per frame */
+s32 cmdq_pkt_template_find_slot(struct cmdq_pkt_template *tpl,
+	const char *name);
+
+/**
+ * cmdq_pkt_template_set() - patch one slot value in the recorded buffer
+ * @tpl:	the template
+ * @slot:	slot index returned at record time
+ * @value:	new value
+ *
+ * Return: 0 for success; -EBUSY if the packet is still executing
+ */
+s32 cmdq_pkt_template_set(struct cmdq_pkt_template *tpl, u32 slot,
+	u32 value);
+
+/**
+ * cmdq_pkt_template_submit() - flush the recorded packet without rebuilding
+ * @tpl:	the template, sealed on first submit
+ * @cb:		callback as in cmdq_pkt_flush_async()
+ * @data:	callback data
+ *
+ * Return: 0 for success; -EBUSY if the previous submit is still executing
+ */
+s32 cmdq_pkt_template_submit(struct cmdq_pkt_template *tpl,
+	cmdq_async_flush_cb cb, void *data);
+
 s32 cmdq_pkt_store_value(struct cmdq_pkt *pkt, u16 indirect_dst_reg_idx,
 	u16 dst_addr_low, u32 value, u32 mask);
 
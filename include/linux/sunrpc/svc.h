@@ -19,11 +19,12 @@
 #include <linux/sunrpc/svcauth.h>
 #include <linux/wait.h>
 #include <linux/mm.h>
+#include <linux/percpu.h>
 
 /* statistics for svc_pool structures */
 struct svc_pool_stats {
 	atomic_long_t	packets;
-	unsigned long	sockets_queued;
+	atomic_long_t	sockets_queued;
 	atomic_long_t	threads_woken;
 	atomic_long_t	threads_timedout;
 };
@@ -38,10 +39,16 @@ struct svc_pool_stats {
  * have one pool per NUMA node.  This optimisation reduces cross-
  * node traffic on multi-node NUMA NFS servers.
  */
+struct svc_xprt_queue {
+	spinlock_t		xq_lock;
+	struct list_head	xq_xprts;	/* pending transports */
+};
+
 struct svc_pool {
 	unsigned int		sp_id;	    	/* pool id; also node id on NUMA */
 	spinlock_t		sp_lock;	/* protects all fields */
-	struct list_head	sp_sockets;	/* pending sockets */
+	struct svc_xprt_queue __percpu *sp_queues; /* per-CPU pending xprts */
+	atomic_t		sp_nr_queued;	/* # xprts on sp_queues */
 	unsigned int		sp_nrthreads;	/* # of threads in pool */
 	struct list_head	sp_all_threads;	/* all server threads */
 	struct svc_pool_stats	sp_stats;	/* statistics on pool operation */
@@ -230,6 +237,7 @@ struct svc_rqst {
 	struct list_head	rq_all;		/* all threads list */
 	struct rcu_head		rq_rcu_head;	/* for RCU deferred kfree */
 	struct svc_xprt *	rq_xprt;	/* transport ptr */
+	struct list_head	rq_batch;	/* xprts dequeued along with rq_xprt */
 
 	struct sockaddr_storage	rq_addr;	/* peer address */
 	size_t			rq_addrlen;
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_SYSCALL_HIST_H
+#define _LINUX_SYSCALL_HIST_H
+
+#include <linux/jump_label.h>
+
+#ifdef CONFIG_SYSCALL_LATENCY_HIST
+DECLARE_STATIC_KEY_FALSE(syscall_hist_enabled);
+
+void __syscall_hist_enter(long nr);
+void __syscall_hist_exit(unsigned long nr);
+
+/* Called once the entry work is done, @nr is the syscall to run */
+static __always_inline void syscall_hist_enter(long nr)
+{
+	if (static_branch_unlikely(&syscall_hist_enabled))
+		__syscall_hist_enter(nr);
+}
+
+/* Called before the exit work, with interrupts enabled */
+static __always_inline void syscall_hist_exit(unsigned long nr)
+{
+	if (static_branch_unlikely(&syscall_hist_enabled))
+		__syscall_hist_exit(nr);
+}
+#else
+static inline void syscall_hist_enter(long nr) { }
+static inline void syscall_hist_exit(unsigned long nr) { }
+#endif
+
+#endif /* _LINUX_SYSCALL_HIST_H */
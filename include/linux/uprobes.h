@@ -114,6 +114,8 @@ extern int uprobe_register(struct inode *inode, loff_t offset, struct uprobe_con
 extern int uprobe_register_refctr(struct inode *inode, loff_t offset, loff_t ref_ctr_offset, struct uprobe_consumer *uc);
 extern int uprobe_apply(struct inode *inode, loff_t offset, struct uprobe_consumer *uc, bool);
 extern void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc);
+extern int uprobe_register_batch(struct inode *inode, int cnt, const loff_t *offsets, const loff_t *ref_ctr_offsets, struct uprobe_consumer **ucs);
+extern void uprobe_unregister_batch(struct inode *inode, int cnt, const loff_t *offsets, struct uprobe_consumer **ucs);
 extern int uprobe_mmap(struct vm_area_struct *vma);
 extern void uprobe_munmap(struct vm_area_struct *vma, unsigned long start, unsigned long end);
 extern void uprobe_start_dup_mmap(void);
@@ -166,6 +168,17 @@ static inline void
 uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
 {
 }
+static inline int
+uprobe_register_batch(struct inode *inode, int cnt, const loff_t *offsets,
+		      const loff_t *ref_ctr_offsets, struct uprobe_consumer **ucs)
+{
+	return -ENOSYS;
+}
+static inline void
+uprobe_unregister_batch(struct inode *inode, int cnt, const loff_t *offsets,
+			struct uprobe_consumer **ucs)
+{
+}
 static inline int uprobe_mmap(struct vm_area_struct *vma)
 {
 	return 0;
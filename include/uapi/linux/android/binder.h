@@ -367,6 +367,11 @@ struct binder_transaction_data_sg {
 	binder_size_t buffers_size;
 };
 
+struct binder_transaction_batch {
+	binder_uintptr_t txns;	/* struct binder_transaction_data[count] */
+	binder_size_t count;
+};
+
 struct binder_ptr_cookie {
 	binder_uintptr_t ptr;
 	binder_uintptr_t cookie;
@@ -575,6 +580,13 @@ enum binder_driver_command_protocol {
 	/*
 	 * binder_transaction_data_sg: the sent command.
 	 */
+
+	BC_TRANSACTION_BATCH = _IOW('c', 19, struct binder_transaction_batch),
+	/*
+	 * binder_transaction_batch: up to 64 oneway transactions to the same
+	 * handle, queued with a single wakeup of the target. Each one is
+	 * acknowledged with its own BR_TRANSACTION_COMPLETE.
+	 */
 };
 
 #endif /* _UAPI_LINUX_BINDER_H */
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Shared event ring for evdev clients.
+ *
+ * mmap() of an evdev file descriptor at offset 0 maps a per-client
+ * ring: a struct input_ring_header in the first page followed by
+ * input_ring_header.bufsize struct input_event entries at data_offset.
+ * Once mapped, the kernel stores events straight into the ring.
+ *
+ * The kernel only advances head at SYN_REPORT boundaries, so
+ * [tail, head) always holds complete packets. The reader consumes
+ * events and then stores the new tail. Before sleeping in poll() it
+ * sets waiting, re-reads head, and clears waiting again once it wakes
+ * up. The kernel skips the wakeup for packets delivered while waiting
+ * is clear. On overflow the kernel rewrites tail and queues
+ * EV_SYN/SYN_DROPPED, exactly as for read().
+ */
+
+#ifndef _UAPI_INPUT_RING_H
+#define _UAPI_INPUT_RING_H
+
+#include <linux/types.h>
+
+#define INPUT_RING_VERSION	1
+
+struct input_ring_header {
+	__u32 version;		/* INPUT_RING_VERSION */
+	__u32 bufsize;		/* number of events, power of two */
+	__u32 event_size;	/* sizeof(struct input_event) */
+	__u32 data_offset;	/* offset of the first event */
+	__u32 head;		/* written by the kernel */
+	__u32 tail;		/* written by the reader */
+	__u32 waiting;		/* written by the reader */
+	__u32 reserved;
+};
+
+#endif /* _UAPI_INPUT_RING_H */
@@ -151,6 +151,9 @@ struct cpuset {
 	/* for custom sched domain */
 	int relax_domain_level;
 
+	/* timer slack imposed on member tasks, 0 leaves it to the task */
+	u64 timer_slack_ns;
+
 	/* number of CPUs in subparts_cpus */
 	int nr_subparts_cpus;
 
@@ -443,6 +446,39 @@ static void cpuset_update_task_spread_flag(struct cpuset *cs,
 		task_clear_spread_slab(tsk);
 }
 
+/*
+ * Apply the cpuset's timer slack to @tsk. A cpuset without a slack of
+ * its own only resets tasks that inherited @old_slack, so that a
+ * slack set through prctl() or /proc/<pid>/timerslack_ns survives moves
+ * between cpusets that do not care.
+ *
+ * Call with cpuset_mutex held.
+ */
+static void cpuset_update_task_timer_slack(struct cpuset *cs, u64 old_slack,
+					   struct task_struct *tsk)
+{
+	if (!cs->timer_slack_ns && !old_slack)
+		return;
+
+	task_lock(tsk);
+	tsk->timer_slack_ns = cs->timer_slack_ns ?: tsk->default_timer_slack_ns;
+	task_unlock(tsk);
+}
+
+static void update_timer_slack(struct cpuset *cs, u64 val)
+{
+	u64 old_slack = cs->timer_slack_ns;
+	struct css_task_iter it;
+	struct task_struct *task;
+
+	cs->timer_slack_ns = val;
+
+	css_task_iter_start(&cs->css, 0, &it);
+	while ((task = css_task_iter_next(&it)))
+		cpuset_update_task_timer_slack(cs, old_slack, task);
+	css_task_iter_end(&it);
+}
+
 /*
  * is_cpuset_subset(p, q) - Is cpuset p a subset of cpuset q?
  *
@@ -1068,6 +1104,13 @@ static int update_cpus_allowed(struct cpuset *cs, struct task_struct *p,
 	if (!ret)
 		return ret;
 
+	/*
+	 * Nothing to do, avoid taking the task's rq lock. Affinity changes
+	 * that could race with this are bounded by the cpuset anyway.
+	 */
+	if (cpumask_equal(&p->cpus_mask, new_mask))
+		return 0;
+
 	return set_cpus_allowed_ptr(p, new_mask);
 }
 
@@ -1683,6 +1726,10 @@ static void cpuset_post_attach(void)
 static void cpuset_change_task_nodemask(struct task_struct *tsk,
 					nodemask_t *newmems)
 {
+	/* mems_allowed only changes here, under cpuset_mutex */
+	if (nodes_equal(tsk->mems_allowed, *newmems))
+		return;
+
 	task_lock(tsk);
 
 	local_irq_disable();
@@ -2234,6 +2281,7 @@ static void cpuset_attach(struct cgroup_taskset *tset)
 	struct cgroup_subsys_state *css;
 	struct cpuset *cs;
 	struct cpuset *oldcs = cpuset_attach_old_cs;
+	const struct cpumask *possible_mask = NULL;
 
 	cgroup_taskset_first(tset, &css);
 	cs = css_cs(css);
@@ -2244,10 +2292,18 @@ static void cpuset_attach(struct cgroup_taskset *tset)
 	guarantee_online_mems(cs, &cpuset_attach_nodemask_to);
 
 	cgroup_taskset_for_each(task, css, tset) {
-		if (cs != &top_cpuset)
-			guarantee_online_cpus(task, cpus_attach);
-		else
-			cpumask_copy(cpus_attach, task_cpu_possible_mask(task));
+		/*
+		 * All threads of a process normally share the same possible
+		 * mask, so the target mask only needs computing once per
+		 * distinct possible mask rather than once per thread.
+		 */
+		if (task_cpu_possible_mask(task) != possible_mask) {
+			possible_mask = task_cpu_possible_mask(task);
+			if (cs != &top_cpuset)
+				guarantee_online_cpus(task, cpus_attach);
+			else
+				cpumask_copy(cpus_attach, possible_mask);
+		}
 		/*
 		 * can_attach beforehand should guarantee that this doesn't
 		 * fail.  TODO: have a better way to handle failure here
@@ -2256,6 +2312,7 @@ static void cpuset_attach(struct cgroup_taskset *tset)
 
 		cpuset_change_task_nodemask(task, &cpuset_attach_nodemask_to);
 		cpuset_update_task_spread_flag(cs, task);
+		cpuset_update_task_timer_slack(cs, oldcs->timer_slack_ns, task);
 	}
 
 	/*
@@ -2263,6 +2320,15 @@ static void cpuset_attach(struct cgroup_taskset *tset)
 	 * sleep and should be moved outside migration path proper.
 	 */
 	cpuset_attach_nodemask_to = cs->effective_mems;
+
+	/*
+	 * Moving between cpusets with the same memory nodes, the usual case
+	 * on single node systems, leaves every mempolicy as it is: skip
+	 * taking each mm's mmap_lock just to rebind it to the same nodes.
+	 */
+	if (nodes_equal(oldcs->old_mems_allowed, cpuset_attach_nodemask_to))
+		goto skip_mm;
+
 	cgroup_taskset_for_each_leader(leader, css, tset) {
 		struct mm_struct *mm = get_task_mm(leader);
 
@@ -2285,6 +2351,7 @@ static void cpuset_attach(struct cgroup_taskset *tset)
 		}
 	}
 
+skip_mm:
 	cs->old_mems_allowed = cpuset_attach_nodemask_to;
 
 	cs->attach_in_progress--;
@@ -2314,6 +2381,7 @@ typedef enum {
 	FILE_MEMORY_PRESSURE,
 	FILE_SPREAD_PAGE,
 	FILE_SPREAD_SLAB,
+	FILE_TIMER_SLACK,
 } cpuset_filetype_t;
 
 static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
@@ -2355,6 +2423,9 @@ static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
 	case FILE_SPREAD_SLAB:
 		retval = update_flag(CS_SPREAD_SLAB, cs, val);
 		break;
+	case FILE_TIMER_SLACK:
+		update_timer_slack(cs, val);
+		break;
 	default:
 		retval = -EINVAL;
 		break;
@@ -2522,6 +2593,8 @@ static u64 cpuset_read_u64(struct cgroup_subsys_state *css, struct cftype *cft)
 		return is_spread_page(cs);
 	case FILE_SPREAD_SLAB:
 		return is_spread_slab(cs);
+	case FILE_TIMER_SLACK:
+		return cs->timer_slack_ns;
 	default:
 		BUG();
 	}
@@ -2691,6 +2764,14 @@ static struct cftype legacy_files[] = {
 		.private = FILE_SPREAD_SLAB,
 	},
 
+	{
+		.name = "timer_slack_ns",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_TIMER_SLACK,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+
 	{
 		.name = "memory_pressure_enabled",
 		.flags = CFTYPE_ONLY_ON_ROOT,
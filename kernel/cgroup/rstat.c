@@ -1,11 +1,23 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "cgroup-internal.h"
 
+#include <linux/moduleparam.h>
 #include <linux/sched/cputime.h>
 
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "cgroup."
+
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Stat readers going through cgroup_rstat_flush_hold() (cpu.stat) reuse
+ * a flush of the same subtree done less than rstat_stale_ms ago instead
+ * of walking every CPU again. 0 keeps every read exact.
+ */
+static unsigned int rstat_stale_ms;
+module_param(rstat_stale_ms, uint, 0644);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -148,8 +160,18 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
+		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 		struct cgroup *pos = NULL;
 
+		/*
+		 * Nothing in the subtree was updated on this cpu, skip it
+		 * without bouncing its lock. Racing with an update is the
+		 * same as having flushed just before it.
+		 */
+		if (READ_ONCE(rstatc->updated_children) == cgrp &&
+		    !READ_ONCE(rstatc->updated_next))
+			continue;
+
 		raw_spin_lock(cpu_lock);
 		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu))) {
 			struct cgroup_subsys_state *css;
@@ -173,6 +195,18 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 			spin_lock_irq(&cgroup_rstat_lock);
 		}
 	}
+	cgrp->rstat_flush_jiffies = jiffies;
+}
+
+static bool cgroup_rstat_fresh(struct cgroup *cgrp)
+{
+	unsigned int stale_ms = READ_ONCE(rstat_stale_ms);
+
+	lockdep_assert_held(&cgroup_rstat_lock);
+
+	return stale_ms && cgrp->rstat_flush_jiffies &&
+	       time_before(jiffies, cgrp->rstat_flush_jiffies +
+				    msecs_to_jiffies(stale_ms));
 }
 
 /**
@@ -217,7 +251,8 @@ void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
  * @cgrp: target cgroup
  *
  * Flush stats in @cgrp's subtree and prevent further flushes.  Must be
- * paired with cgroup_rstat_flush_release().
+ * paired with cgroup_rstat_flush_release().  The flush is skipped if the
+ * subtree was flushed within the last cgroup.rstat_stale_ms.
  *
  * This function may block.
  */
@@ -226,7 +261,8 @@ void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 {
 	might_sleep();
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	if (!cgroup_rstat_fresh(cgrp))
+		cgroup_rstat_flush_locked(cgrp, true);
 }
 
 /**
@@ -50,6 +50,10 @@
 #include <linux/sizes.h>
 #include <linux/dma-map-ops.h>
 #include <linux/cma.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 #include <trace/hooks/mm.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
@@ -244,6 +248,302 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 	return 0;
 }
 
+/*
+ * Per-area bookkeeping for allocations that go through this file: latency and
+ * failure statistics, and a list of chunks that dma_prepare_contiguous() has
+ * already evacuated in the background.  Entries are only ever added, so the
+ * lookup can scan the table without taking a lock.
+ */
+#define CONTIG_LAT_BUCKETS	6
+
+struct contig_chunk {
+	struct list_head node;
+	struct page *page;
+	size_t count;
+	unsigned int align;
+};
+
+struct contig_area {
+	struct cma *cma;
+	spinlock_t lock;
+	struct list_head prepared;
+	unsigned long nr_prepared;
+	unsigned long nr_alloc;
+	unsigned long nr_fail;
+	unsigned long nr_prepared_hit;
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long lat_hist[CONTIG_LAT_BUCKETS];
+};
+
+/* Upper bounds of the latency buckets, the last one is open ended */
+static const u64 contig_lat_bounds[CONTIG_LAT_BUCKETS - 1] = {
+	NSEC_PER_MSEC, 4 * NSEC_PER_MSEC, 16 * NSEC_PER_MSEC,
+	64 * NSEC_PER_MSEC, 256 * NSEC_PER_MSEC,
+};
+
+static struct contig_area contig_areas[MAX_CMA_AREAS];
+static DEFINE_SPINLOCK(contig_areas_lock);
+
+static struct contig_area *contig_area_get(struct cma *cma)
+{
+	struct contig_area *area;
+	int i;
+
+	for (i = 0; i < MAX_CMA_AREAS; i++) {
+		struct cma *c = smp_load_acquire(&contig_areas[i].cma);
+
+		if (c == cma)
+			return &contig_areas[i];
+		if (!c)
+			break;
+	}
+
+	spin_lock(&contig_areas_lock);
+	for (i = 0, area = NULL; i < MAX_CMA_AREAS; i++) {
+		if (contig_areas[i].cma == cma) {
+			area = &contig_areas[i];
+			break;
+		}
+		if (!contig_areas[i].cma) {
+			area = &contig_areas[i];
+			spin_lock_init(&area->lock);
+			INIT_LIST_HEAD(&area->prepared);
+			smp_store_release(&area->cma, cma);
+			break;
+		}
+	}
+	spin_unlock(&contig_areas_lock);
+
+	return area;
+}
+
+static void contig_account(struct contig_area *area, u64 ns, bool failed)
+{
+	int b;
+
+	for (b = 0; b < CONTIG_LAT_BUCKETS - 1; b++)
+		if (ns < contig_lat_bounds[b])
+			break;
+
+	spin_lock(&area->lock);
+	area->nr_alloc++;
+	if (failed)
+		area->nr_fail++;
+	area->total_ns += ns;
+	if (ns > area->max_ns)
+		area->max_ns = ns;
+	area->lat_hist[b]++;
+	spin_unlock(&area->lock);
+}
+
+/* Hand out a prepared chunk of exactly @count pages aligned to at least @align */
+static struct page *contig_take_prepared(struct contig_area *area,
+					 size_t count, unsigned int align)
+{
+	struct contig_chunk *chunk, *found = NULL;
+	struct page *page = NULL;
+
+	if (!READ_ONCE(area->nr_prepared))
+		return NULL;
+
+	spin_lock(&area->lock);
+	list_for_each_entry(chunk, &area->prepared, node) {
+		if (chunk->count == count && chunk->align >= align) {
+			found = chunk;
+			list_del(&chunk->node);
+			area->nr_prepared--;
+			area->nr_prepared_hit++;
+			break;
+		}
+	}
+	spin_unlock(&area->lock);
+
+	if (found) {
+		page = found->page;
+		kfree(found);
+	}
+	return page;
+}
+
+static struct page *contig_cma_alloc(struct cma *cma, size_t count,
+				     unsigned int align, gfp_t gfp)
+{
+	struct contig_area *area = contig_area_get(cma);
+	struct page *page;
+	u64 start;
+
+	if (area) {
+		page = contig_take_prepared(area, count, align);
+		if (page)
+			return page;
+	}
+
+	start = ktime_get_ns();
+	page = cma_alloc(cma, count, align, gfp);
+	if (area)
+		contig_account(area, ktime_get_ns() - start, !page);
+
+	return page;
+}
+
+struct contig_prepare_work {
+	struct work_struct work;
+	struct contig_area *area;
+	size_t count;
+	unsigned int align;
+	unsigned int nr;
+};
+
+static void contig_prepare_fn(struct work_struct *work)
+{
+	struct contig_prepare_work *pw =
+		container_of(work, struct contig_prepare_work, work);
+	struct contig_area *area = pw->area;
+	unsigned int i;
+
+	for (i = 0; i < pw->nr; i++) {
+		struct contig_chunk *chunk;
+		u64 start = ktime_get_ns();
+
+		chunk = kmalloc(sizeof(*chunk), GFP_KERNEL);
+		if (!chunk)
+			break;
+
+		chunk->page = cma_alloc(area->cma, pw->count, pw->align,
+					GFP_KERNEL | __GFP_NOWARN);
+		contig_account(area, ktime_get_ns() - start, !chunk->page);
+		if (!chunk->page) {
+			kfree(chunk);
+			break;
+		}
+		chunk->count = pw->count;
+		chunk->align = pw->align;
+
+		spin_lock(&area->lock);
+		list_add_tail(&chunk->node, &area->prepared);
+		area->nr_prepared++;
+		spin_unlock(&area->lock);
+	}
+
+	kfree(pw);
+}
+
+/**
+ * dma_prepare_contiguous() - evacuate contiguous memory ahead of time
+ * @dev:  Pointer to device which is going to allocate the memory.
+ * @size: Size of each buffer the device is going to allocate.
+ * @nr:   Number of such buffers.
+ *
+ * Migrating pages out of a CMA area is what makes large contiguous
+ * allocations slow.  A driver that knows it is about to allocate (e.g. a
+ * camera being opened) can call this to have @nr buffers of @size bytes
+ * allocated from the device's area in the background.  Subsequent
+ * dma_alloc_contiguous() or dma_alloc_from_contiguous() calls of the same
+ * size are then satisfied from these buffers without waiting on migration.
+ * Unused buffers must be given back with dma_unprepare_contiguous().
+ */
+int dma_prepare_contiguous(struct device *dev, size_t size, unsigned int nr)
+{
+	struct cma *cma = dev_get_cma_area(dev);
+	struct contig_prepare_work *pw;
+	struct contig_area *area;
+
+	if (!cma || !size || !nr)
+		return -EINVAL;
+
+	area = contig_area_get(cma);
+	if (!area)
+		return -ENOSPC;
+
+	pw = kmalloc(sizeof(*pw), GFP_KERNEL);
+	if (!pw)
+		return -ENOMEM;
+
+	INIT_WORK(&pw->work, contig_prepare_fn);
+	pw->area = area;
+	pw->count = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	pw->align = min(get_order(size), CONFIG_CMA_ALIGNMENT);
+	pw->nr = nr;
+	queue_work(system_unbound_wq, &pw->work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dma_prepare_contiguous);
+
+/**
+ * dma_unprepare_contiguous() - release buffers left over from preparation
+ * @dev: Pointer to device passed to dma_prepare_contiguous().
+ *
+ * Gives every prepared but unclaimed buffer of the device's area back to CMA.
+ */
+void dma_unprepare_contiguous(struct device *dev)
+{
+	struct cma *cma = dev_get_cma_area(dev);
+	struct contig_chunk *chunk, *tmp;
+	struct contig_area *area;
+	LIST_HEAD(list);
+
+	if (!cma)
+		return;
+
+	area = contig_area_get(cma);
+	if (!area)
+		return;
+
+	spin_lock(&area->lock);
+	list_splice_init(&area->prepared, &list);
+	area->nr_prepared = 0;
+	spin_unlock(&area->lock);
+
+	list_for_each_entry_safe(chunk, tmp, &list, node) {
+		cma_release(cma, chunk->page, chunk->count);
+		kfree(chunk);
+	}
+}
+EXPORT_SYMBOL_GPL(dma_unprepare_contiguous);
+
+#ifdef CONFIG_DEBUG_FS
+static int contig_stats_show(struct seq_file *m, void *v)
+{
+	int i, b;
+
+	seq_puts(m, "area allocs fails prepared_hits prepared avg_us max_us"
+		    " <1ms <4ms <16ms <64ms <256ms >=256ms\n");
+	for (i = 0; i < MAX_CMA_AREAS; i++) {
+		struct contig_area *area = &contig_areas[i];
+		struct cma *cma = smp_load_acquire(&area->cma);
+
+		if (!cma)
+			break;
+
+		spin_lock(&area->lock);
+		seq_printf(m, "%s %lu %lu %lu %lu %llu %llu", cma_get_name(cma),
+			   area->nr_alloc, area->nr_fail, area->nr_prepared_hit,
+			   area->nr_prepared,
+			   area->nr_alloc ?
+			   div64_u64(area->total_ns, area->nr_alloc) /
+			   NSEC_PER_USEC : 0,
+			   div_u64(area->max_ns, NSEC_PER_USEC));
+		for (b = 0; b < CONTIG_LAT_BUCKETS; b++)
+			seq_printf(m, " %lu", area->lat_hist[b]);
+		spin_unlock(&area->lock);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(contig_stats);
+
+static int __init dma_contiguous_debugfs_init(void)
+{
+	struct dentry *root = debugfs_create_dir("dma_contiguous", NULL);
+
+	debugfs_create_file("stats", 0400, root, NULL, &contig_stats_fops);
+	return 0;
+}
+late_initcall(dma_contiguous_debugfs_init);
+#endif
+
 /**
  * dma_alloc_from_contiguous() - allocate pages from contiguous area
  * @dev:   Pointer to device for which the allocation is performed.
@@ -262,7 +562,7 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 	if (align > CONFIG_CMA_ALIGNMENT)
 		align = CONFIG_CMA_ALIGNMENT;
 
-	return cma_alloc(dev_get_cma_area(dev), count, align, GFP_KERNEL |
+	return contig_cma_alloc(dev_get_cma_area(dev), count, align, GFP_KERNEL |
 			(no_warn ? __GFP_NOWARN : 0));
 }
 
@@ -286,7 +586,7 @@ static struct page *cma_alloc_aligned(struct cma *cma, size_t size, gfp_t gfp)
 {
 	unsigned int align = min(get_order(size), CONFIG_CMA_ALIGNMENT);
 
-	return cma_alloc(cma, size >> PAGE_SHIFT, align,
+	return contig_cma_alloc(cma, size >> PAGE_SHIFT, align,
 				GFP_KERNEL | (gfp & __GFP_NOWARN));
 }
 
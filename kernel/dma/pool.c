@@ -9,6 +9,7 @@
 #include <linux/dma-direct.h>
 #include <linux/init.h>
 #include <linux/genalloc.h>
+#include <linux/seq_file.h>
 #include <linux/set_memory.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
@@ -26,6 +27,27 @@ static size_t atomic_pool_size;
 /* Dynamic background expansion when the atomic pool is near capacity */
 static struct work_struct atomic_pool_work;
 
+/*
+ * Per-zone growth policy and telemetry.  An allocation that leaves less than
+ * @low bytes available kicks the worker, which grows the pool until at least
+ * max(@high, twice the bytes handed out since its previous run) is available,
+ * capped at four times @high.  Sizing growth by the recent allocation rate
+ * lets bursty atomic users (network drivers in softirq) get ahead of the
+ * next burst instead of doubling blindly or not growing enough.
+ */
+struct atomic_pool_stats {
+	unsigned long low;
+	unsigned long high;
+	atomic_long_t alloc_bytes;
+	atomic_long_t nr_fail;
+	unsigned long nr_expand;
+	unsigned long nr_expand_fail;
+};
+
+static struct atomic_pool_stats pool_stats_dma;
+static struct atomic_pool_stats pool_stats_dma32;
+static struct atomic_pool_stats pool_stats_kernel;
+
 static int __init early_coherent_pool(char *p)
 {
 	atomic_pool_size = memparse(p, &p);
@@ -33,6 +55,39 @@ static int __init early_coherent_pool(char *p)
 }
 early_param("coherent_pool", early_coherent_pool);
 
+static struct atomic_pool_stats *dma_atomic_pool_stats(struct gen_pool *pool)
+{
+	if (pool == atomic_pool_dma)
+		return &pool_stats_dma;
+	if (pool == atomic_pool_dma32)
+		return &pool_stats_dma32;
+	return &pool_stats_kernel;
+}
+
+static void atomic_pool_stats_show(struct seq_file *m, const char *name,
+				   struct gen_pool *pool,
+				   struct atomic_pool_stats *stats)
+{
+	if (!pool)
+		return;
+
+	seq_printf(m, "%s: size %zu avail %zu low %lu high %lu fail %ld expand %lu expand_fail %lu\n",
+		   name, gen_pool_size(pool), gen_pool_avail(pool),
+		   stats->low, stats->high, atomic_long_read(&stats->nr_fail),
+		   stats->nr_expand, stats->nr_expand_fail);
+}
+
+static int atomic_pool_stats_seq_show(struct seq_file *m, void *v)
+{
+	atomic_pool_stats_show(m, "dma", atomic_pool_dma, &pool_stats_dma);
+	atomic_pool_stats_show(m, "dma32", atomic_pool_dma32,
+			       &pool_stats_dma32);
+	atomic_pool_stats_show(m, "kernel", atomic_pool_kernel,
+			       &pool_stats_kernel);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(atomic_pool_stats_seq);
+
 static void __init dma_atomic_pool_debugfs_init(void)
 {
 	struct dentry *root;
@@ -44,6 +99,15 @@ static void __init dma_atomic_pool_debugfs_init(void)
 	debugfs_create_ulong("pool_size_dma", 0400, root, &pool_size_dma);
 	debugfs_create_ulong("pool_size_dma32", 0400, root, &pool_size_dma32);
 	debugfs_create_ulong("pool_size_kernel", 0400, root, &pool_size_kernel);
+	debugfs_create_ulong("low_dma", 0600, root, &pool_stats_dma.low);
+	debugfs_create_ulong("high_dma", 0600, root, &pool_stats_dma.high);
+	debugfs_create_ulong("low_dma32", 0600, root, &pool_stats_dma32.low);
+	debugfs_create_ulong("high_dma32", 0600, root, &pool_stats_dma32.high);
+	debugfs_create_ulong("low_kernel", 0600, root, &pool_stats_kernel.low);
+	debugfs_create_ulong("high_kernel", 0600, root,
+			     &pool_stats_kernel.high);
+	debugfs_create_file("stats", 0400, root, NULL,
+			    &atomic_pool_stats_seq_fops);
 }
 
 static void dma_atomic_pool_size_add(gfp_t gfp, size_t size)
@@ -147,8 +211,26 @@ free_page: __maybe_unused
 
 static void atomic_pool_resize(struct gen_pool *pool, gfp_t gfp)
 {
-	if (pool && gen_pool_avail(pool) < atomic_pool_size)
-		atomic_pool_expand(pool, gen_pool_size(pool), gfp);
+	struct atomic_pool_stats *stats;
+	size_t avail, target, high;
+
+	if (!pool)
+		return;
+
+	stats = dma_atomic_pool_stats(pool);
+	high = READ_ONCE(stats->high);
+	target = 2 * atomic_long_xchg(&stats->alloc_bytes, 0);
+	target = clamp_t(size_t, target, high, 4 * high);
+
+	avail = gen_pool_avail(pool);
+	while (avail < target) {
+		if (atomic_pool_expand(pool, target - avail, gfp)) {
+			stats->nr_expand_fail++;
+			break;
+		}
+		stats->nr_expand++;
+		avail = gen_pool_avail(pool);
+	}
 }
 
 static void atomic_pool_work_fn(struct work_struct *work)
@@ -202,6 +284,11 @@ static int __init dma_atomic_pool_init(void)
 	}
 	INIT_WORK(&atomic_pool_work, atomic_pool_work_fn);
 
+	pool_stats_dma.low = pool_stats_dma32.low = pool_stats_kernel.low =
+		atomic_pool_size;
+	pool_stats_dma.high = pool_stats_dma32.high = pool_stats_kernel.high =
+		2 * atomic_pool_size;
+
 	atomic_pool_kernel = __dma_atomic_pool_init(atomic_pool_size,
 						    GFP_KERNEL);
 	if (!atomic_pool_kernel)
@@ -244,6 +331,7 @@ static struct page *__dma_alloc_from_pool(struct device *dev, size_t size,
 		struct gen_pool *pool, void **cpu_addr,
 		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t))
 {
+	struct atomic_pool_stats *stats;
 	unsigned long addr;
 	phys_addr_t phys;
 
@@ -257,7 +345,9 @@ static struct page *__dma_alloc_from_pool(struct device *dev, size_t size,
 		return NULL;
 	}
 
-	if (gen_pool_avail(pool) < atomic_pool_size)
+	stats = dma_atomic_pool_stats(pool);
+	atomic_long_add(size, &stats->alloc_bytes);
+	if (gen_pool_avail(pool) < READ_ONCE(stats->low))
 		schedule_work(&atomic_pool_work);
 
 	*cpu_addr = (void *)addr;
@@ -279,6 +369,14 @@ struct page *dma_alloc_from_pool(struct device *dev, size_t size,
 			return page;
 	}
 
+	/* Account the failure to the preferred zone and let it grow */
+	pool = dma_guess_pool(NULL, gfp);
+	if (pool) {
+		atomic_long_inc(&dma_atomic_pool_stats(pool)->nr_fail);
+		atomic_long_add(size, &dma_atomic_pool_stats(pool)->alloc_bytes);
+		schedule_work(&atomic_pool_work);
+	}
+
 	WARN(1, "Failed to get suitable pool for %s\n", dev_name(dev));
 	return NULL;
 }
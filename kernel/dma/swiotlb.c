@@ -46,6 +46,7 @@
 #include <linux/init.h>
 #include <linux/memblock.h>
 #include <linux/iommu-helper.h>
+#include <linux/log2.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/swiotlb.h>
@@ -74,17 +75,33 @@ phys_addr_t io_tlb_start, io_tlb_end;
  */
 static unsigned long io_tlb_nslabs;
 
-/*
- * The number of used IO TLB block
- */
-static unsigned long io_tlb_used;
-
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The slabs are split into io_tlb_nareas equally sized areas, each a multiple
+ * of IO_TLB_SEGSIZE so that no free list run ever crosses into a neighbouring
+ * area.  Every area has its own lock, search index and usage count, and a
+ * mapping starts its search in the area of the current CPU, so concurrent
+ * bouncing devices on different CPUs no longer serialize on a single lock.
+ */
+#define IO_TLB_MAX_AREAS 32
+
+struct io_tlb_area {
+	unsigned long used;
+	unsigned int index;
+	spinlock_t lock;
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area io_tlb_areas[IO_TLB_MAX_AREAS];
+static unsigned int io_tlb_nareas = 1;
+static unsigned long io_tlb_area_nslabs;
+
+/* Requested number of areas, 0 means one per possible CPU */
+static unsigned int io_tlb_req_nareas;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -99,11 +116,6 @@ static unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -127,6 +139,18 @@ setup_io_tlb_npages(char *str)
 }
 early_param("swiotlb", setup_io_tlb_npages);
 
+static int __init
+setup_io_tlb_nareas(char *str)
+{
+	unsigned long nareas;
+
+	if (kstrtoul(str, 0, &nareas) || !nareas)
+		return -EINVAL;
+	io_tlb_req_nareas = min_t(unsigned long, nareas, IO_TLB_MAX_AREAS);
+	return 0;
+}
+early_param("swiotlb_areas", setup_io_tlb_nareas);
+
 static bool no_iotlb_memory;
 
 unsigned long swiotlb_nr_tbl(void)
@@ -183,6 +207,39 @@ static inline unsigned long nr_slots(u64 val)
 	return DIV_ROUND_UP(val, IO_TLB_SIZE);
 }
 
+/*
+ * Split io_tlb_nslabs into a power of two number of areas, shrinking the count
+ * until every area holds a whole number of IO_TLB_SEGSIZE segments.
+ */
+static void swiotlb_init_areas(void)
+{
+	unsigned int nareas = io_tlb_req_nareas ?: num_possible_cpus();
+	unsigned int i;
+
+	nareas = rounddown_pow_of_two(clamp_t(unsigned int, nareas, 1,
+					      IO_TLB_MAX_AREAS));
+	while (nareas > 1 && (io_tlb_nslabs % (nareas * IO_TLB_SEGSIZE)))
+		nareas >>= 1;
+
+	io_tlb_nareas = nareas;
+	io_tlb_area_nslabs = io_tlb_nslabs / nareas;
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].index = i * io_tlb_area_nslabs;
+		io_tlb_areas[i].used = 0;
+	}
+}
+
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+	return used;
+}
+
 /*
  * Early SWIOTLB allocation may be too early to allow an architecture to
  * perform the desired operations.  This function allows the architecture to
@@ -235,7 +292,7 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - io_tlb_offset(i);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	if (verbose)
@@ -369,7 +426,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - io_tlb_offset(i);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	swiotlb_print_info();
@@ -472,20 +529,22 @@ static inline unsigned long get_max_slots(unsigned long boundary_mask)
 	return nr_slots(boundary_mask + 1);
 }
 
-static unsigned int wrap_index(unsigned int index)
+static unsigned int wrap_area_index(unsigned int start, unsigned int index)
 {
-	if (index >= io_tlb_nslabs)
-		return 0;
+	if (index >= start + io_tlb_area_nslabs)
+		return start;
 	return index;
 }
 
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
- * allocate a buffer from that IO TLB pool.
+ * allocate a buffer from the given area of the IO TLB pool.
  */
-static int find_slots(struct device *dev, phys_addr_t orig_addr,
-		size_t alloc_size)
+static int area_find_slots(struct device *dev, unsigned int area_index,
+		phys_addr_t orig_addr, size_t alloc_size)
 {
+	struct io_tlb_area *area = &io_tlb_areas[area_index];
+	unsigned int start = area_index * io_tlb_area_nslabs;
 	unsigned long boundary_mask = dma_get_seg_boundary(dev);
 	dma_addr_t tbl_dma_addr =
 		phys_to_dma_unencrypted(dev, io_tlb_start) & boundary_mask;
@@ -507,15 +566,15 @@ static int find_slots(struct device *dev, phys_addr_t orig_addr,
 	if (alloc_size >= PAGE_SIZE)
 		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
 
-	spin_lock_irqsave(&io_tlb_lock, flags);
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
+	spin_lock_irqsave(&area->lock, flags);
+	if (unlikely(nslots > io_tlb_area_nslabs - area->used))
 		goto not_found;
 
-	index = wrap = wrap_index(ALIGN(io_tlb_index, stride));
+	index = wrap = wrap_area_index(start, ALIGN(area->index, stride));
 	do {
 		if ((slot_addr(tbl_dma_addr, index) & iotlb_align_mask) !=
 		    (orig_addr & iotlb_align_mask)) {
-			index = wrap_index(index + 1);
+			index = wrap_area_index(start, index + 1);
 			continue;
 		}
 
@@ -530,11 +589,11 @@ static int find_slots(struct device *dev, phys_addr_t orig_addr,
 			if (io_tlb_list[index] >= nslots)
 				goto found;
 		}
-		index = wrap_index(index + stride);
+		index = wrap_area_index(start, index + stride);
 	} while (index != wrap);
 
 not_found:
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 	return -1;
 
 found:
@@ -548,16 +607,38 @@ static int find_slots(struct device *dev, phys_addr_t orig_addr,
 	/*
 	 * Update the indices to avoid searching in the next round.
 	 */
-	if (index + nslots < io_tlb_nslabs)
-		io_tlb_index = index + nslots;
+	if (index + nslots < start + io_tlb_area_nslabs)
+		area->index = index + nslots;
 	else
-		io_tlb_index = 0;
-	io_tlb_used += nslots;
+		area->index = start;
+	WRITE_ONCE(area->used, area->used + nslots);
 
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 	return index;
 }
 
+/*
+ * Start in the area of the current CPU and only fall back to the others when
+ * it is full, so the common case touches a single, mostly uncontended lock.
+ */
+static int find_slots(struct device *dev, phys_addr_t orig_addr,
+		size_t alloc_size)
+{
+	unsigned int start = raw_smp_processor_id() & (io_tlb_nareas - 1);
+	unsigned int i = start;
+	int index;
+
+	do {
+		index = area_find_slots(dev, i, orig_addr, alloc_size);
+		if (index >= 0)
+			return index;
+		if (++i >= io_tlb_nareas)
+			i = 0;
+	} while (i != start);
+
+	return -1;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 		size_t mapping_size, size_t alloc_size,
 		enum dma_data_direction dir, unsigned long attrs)
@@ -584,7 +665,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-				 alloc_size, io_tlb_nslabs, io_tlb_used);
+				 alloc_size, io_tlb_nslabs, swiotlb_used());
 		return (phys_addr_t)DMA_MAPPING_ERROR;
 	}
 
@@ -615,6 +696,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	unsigned int offset = swiotlb_align_offset(hwdev, tlb_addr);
 	int i, count, nslots = nr_slots(alloc_size + offset);
 	int index = (tlb_addr - offset - io_tlb_start) >> IO_TLB_SHIFT;
+	struct io_tlb_area *area = &io_tlb_areas[index / io_tlb_area_nslabs];
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
 
 	/*
@@ -631,7 +713,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	spin_lock_irqsave(&area->lock, flags);
 	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
 		count = io_tlb_list[index + nslots];
 	else
@@ -654,8 +736,8 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && io_tlb_list[i];
 	     i--)
 		io_tlb_list[i] = ++count;
-	io_tlb_used -= nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	WRITE_ONCE(area->used, area->used - nslots);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -741,13 +823,21 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file("io_tlb_used", 0400, root, NULL, &fops_io_tlb_used);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
 	return 0;
 }
 
@@ -4,6 +4,7 @@
 #include <linux/entry-common.h>
 #include <linux/livepatch.h>
 #include <linux/audit.h>
+#include <linux/syscall_hist.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/syscalls.h>
@@ -80,6 +81,7 @@ __syscall_enter_from_user_work(struct pt_regs *regs, long syscall)
 	if (ti_work & SYSCALL_ENTER_WORK)
 		syscall = syscall_trace_enter(regs, syscall, ti_work);
 
+	syscall_hist_enter(syscall);
 	return syscall;
 }
 
@@ -247,6 +249,7 @@ static void syscall_exit_to_user_mode_prepare(struct pt_regs *regs)
 			local_irq_enable();
 	}
 
+	syscall_hist_exit(nr);
 	rseq_syscall(regs);
 
 	/*
@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-syscall latency histograms.
+ *
+ * The time from the end of the syscall entry work to the start of the
+ * exit work is accounted, per CPU, into a log2 histogram of the syscall
+ * number. Bucket 0 is below 256ns and bucket n covers
+ * [2^(n+7), 2^(n+8)) ns, the last one being open ended.
+ *
+ * Everything sits behind a static key, so a disabled kernel only pays a
+ * patched out branch on entry and exit. Compat syscalls are not tracked
+ * as their numbers do not match the native table.
+ *
+ * /sys/kernel/debug/syscall_hist/
+ *   enable	1/0, starts or stops tracking
+ *   cgroup	cgroup2 path; only its subtree is tracked, empty for all
+ *   hist	one line per syscall seen; write anything to clear
+ */
+
+#include <linux/cgroup.h>
+#include <linux/compat.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/syscall_hist.h>
+#include <linux/uaccess.h>
+
+#include <asm/unistd.h>
+
+#define SYSCALL_HIST_BUCKETS	24
+#define SYSCALL_HIST_SHIFT	8
+
+struct syscall_hist {
+	u64 count;
+	u64 sum_ns;
+	u64 max_ns;
+	u32 hist[SYSCALL_HIST_BUCKETS];
+};
+
+DEFINE_STATIC_KEY_FALSE(syscall_hist_enabled);
+
+static DEFINE_PER_CPU(struct syscall_hist *, syscall_hists);
+static DEFINE_MUTEX(syscall_hist_mutex);
+static struct cgroup __rcu *syscall_hist_cgrp;
+static char syscall_hist_cgrp_path[PATH_MAX];
+/* starts older than this belong to an earlier enable */
+static u64 syscall_hist_epoch;
+
+static bool syscall_hist_match(void)
+{
+	struct cgroup *cgrp;
+	bool ret = true;
+
+	if (!rcu_access_pointer(syscall_hist_cgrp))
+		return true;
+
+	rcu_read_lock();
+	cgrp = rcu_dereference(syscall_hist_cgrp);
+	if (cgrp)
+		ret = cgroup_is_descendant(task_dfl_cgroup(current), cgrp);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+void __syscall_hist_enter(long nr)
+{
+	if (nr < 0 || nr >= NR_syscalls || in_compat_syscall() ||
+	    !syscall_hist_match()) {
+		current->syscall_hist_start = 0;
+		return;
+	}
+
+	current->syscall_hist_start = local_clock();
+}
+
+void __syscall_hist_exit(unsigned long nr)
+{
+	u64 start = current->syscall_hist_start;
+	struct syscall_hist *h;
+	u64 now, delta;
+
+	if (!start)
+		return;
+	current->syscall_hist_start = 0;
+	if (nr >= NR_syscalls || start < READ_ONCE(syscall_hist_epoch))
+		return;
+
+	preempt_disable();
+	h = this_cpu_read(syscall_hists);
+	now = local_clock();
+	if (h && now > start) {
+		h += nr;
+		delta = now - start;
+		h->count++;
+		h->sum_ns += delta;
+		if (delta > h->max_ns)
+			h->max_ns = delta;
+		h->hist[min_t(unsigned int, fls64(delta >> SYSCALL_HIST_SHIFT),
+			      SYSCALL_HIST_BUCKETS - 1)]++;
+	}
+	preempt_enable();
+}
+
+static int syscall_hist_show(struct seq_file *s, void *p)
+{
+	struct syscall_hist sum;
+	int nr, cpu, i;
+
+	seq_puts(s, "# nr count avg_ns max_ns");
+	for (i = 0; i < SYSCALL_HIST_BUCKETS - 1; i++)
+		seq_printf(s, " <%lluns", 1ULL << (i + SYSCALL_HIST_SHIFT));
+	seq_puts(s, " more\n");
+
+	for (nr = 0; nr < NR_syscalls; nr++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct syscall_hist *h = per_cpu(syscall_hists, cpu);
+
+			if (!h)
+				continue;
+			h += nr;
+			sum.count += h->count;
+			sum.sum_ns += h->sum_ns;
+			sum.max_ns = max(sum.max_ns, h->max_ns);
+			for (i = 0; i < SYSCALL_HIST_BUCKETS; i++)
+				sum.hist[i] += h->hist[i];
+		}
+		if (!sum.count)
+			continue;
+
+		seq_printf(s, "%d %llu %llu %llu", nr, sum.count,
+			   div64_u64(sum.sum_ns, sum.count), sum.max_ns);
+		for (i = 0; i < SYSCALL_HIST_BUCKETS; i++)
+			seq_printf(s, " %u", sum.hist[i]);
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+
+static int syscall_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, syscall_hist_show, NULL,
+				(NR_syscalls + 1) *
+				(SYSCALL_HIST_BUCKETS + 4) * 12);
+}
+
+/* write anything to clear the histograms, racing updates may survive */
+static ssize_t syscall_hist_write(struct file *file, const char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct syscall_hist *h = per_cpu(syscall_hists, cpu);
+
+		if (h)
+			memset(h, 0, NR_syscalls * sizeof(*h));
+	}
+
+	return count;
+}
+
+static const struct file_operations syscall_hist_fops = {
+	.open		= syscall_hist_open,
+	.read		= seq_read,
+	.write		= syscall_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int syscall_hist_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&syscall_hist_enabled);
+	return 0;
+}
+
+static int syscall_hist_enable_set(void *data, u64 val)
+{
+	mutex_lock(&syscall_hist_mutex);
+	if (val && !static_key_enabled(&syscall_hist_enabled)) {
+		WRITE_ONCE(syscall_hist_epoch, local_clock());
+		static_branch_enable(&syscall_hist_enabled);
+	} else if (!val && static_key_enabled(&syscall_hist_enabled)) {
+		static_branch_disable(&syscall_hist_enabled);
+	}
+	mutex_unlock(&syscall_hist_mutex);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(syscall_hist_enable_fops, syscall_hist_enable_get,
+			 syscall_hist_enable_set, "%llu\n");
+
+static int syscall_hist_cgroup_show(struct seq_file *s, void *p)
+{
+	mutex_lock(&syscall_hist_mutex);
+	seq_printf(s, "%s\n", syscall_hist_cgrp_path);
+	mutex_unlock(&syscall_hist_mutex);
+
+	return 0;
+}
+
+static int syscall_hist_cgroup_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, syscall_hist_cgroup_show, NULL);
+}
+
+static ssize_t syscall_hist_cgroup_write(struct file *file,
+					 const char __user *ubuf,
+					 size_t count, loff_t *ppos)
+{
+	struct cgroup *cgrp = NULL, *old;
+	char *path;
+
+	path = memdup_user_nul(ubuf, min_t(size_t, count, PATH_MAX - 1));
+	if (IS_ERR(path))
+		return PTR_ERR(path);
+	strim(path);
+
+	if (*path) {
+		cgrp = cgroup_get_from_path(path);
+		if (IS_ERR(cgrp)) {
+			kfree(path);
+			return PTR_ERR(cgrp);
+		}
+	}
+
+	mutex_lock(&syscall_hist_mutex);
+	old = rcu_replace_pointer(syscall_hist_cgrp, cgrp,
+				  lockdep_is_held(&syscall_hist_mutex));
+	strscpy(syscall_hist_cgrp_path, path, sizeof(syscall_hist_cgrp_path));
+	mutex_unlock(&syscall_hist_mutex);
+	kfree(path);
+
+	if (old) {
+		synchronize_rcu();
+		cgroup_put(old);
+	}
+
+	return count;
+}
+
+static const struct file_operations syscall_hist_cgroup_fops = {
+	.open		= syscall_hist_cgroup_open,
+	.read		= seq_read,
+	.write		= syscall_hist_cgroup_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init syscall_hist_init(void)
+{
+	struct dentry *dir;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(syscall_hists, cpu) =
+			kcalloc_node(NR_syscalls, sizeof(struct syscall_hist),
+				     GFP_KERNEL, cpu_to_node(cpu));
+		if (!per_cpu(syscall_hists, cpu))
+			goto fail;
+	}
+
+	dir = debugfs_create_dir("syscall_hist", NULL);
+	debugfs_create_file_unsafe("enable", 0600, dir, NULL,
+				   &syscall_hist_enable_fops);
+	debugfs_create_file("cgroup", 0600, dir, NULL,
+			    &syscall_hist_cgroup_fops);
+	debugfs_create_file("hist", 0600, dir, NULL, &syscall_hist_fops);
+
+	return 0;
+fail:
+	for_each_possible_cpu(cpu) {
+		kfree(per_cpu(syscall_hists, cpu));
+		per_cpu(syscall_hists, cpu) = NULL;
+	}
+	return -ENOMEM;
+}
+late_initcall(syscall_hist_init);
@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Always-on continuous CPU profiler
+ *
+ * One sampling event per CPU is shared by every consumer. Samples are
+ * not written out one by one: the overflow handler hashes the callchain
+ * and bumps a counter in a small per-CPU table, so a hot stack costs one
+ * slot no matter how often it is hit. Every interval_ms the tables are
+ * flushed as aggregated records into a single system-wide ring, which
+ * is read from /proc/cprof.
+ *
+ * Each CPU has two tables. The flush runs on the owning CPU and flips
+ * the active index first. Any overflow handler that could still write
+ * the old table has interrupted the flush on that same CPU, so it has
+ * finished by the time the flush walks the table.
+ *
+ * The ring is a stream of struct cprof_record, each followed by nr
+ * u64 callchain entries. The entries include the PERF_CONTEXT_* markers
+ * that separate kernel frames from user frames.
+ */
+
+#include <linux/cpu.h>
+#include <linux/jhash.h>
+#include <linux/moduleparam.h>
+#include <linux/perf_event.h>
+#include <linux/poll.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#define CPROF_MAX_STACK		32
+#define CPROF_SLOTS		256	/* per table, power of two */
+#define CPROF_PROBES		8
+
+struct cprof_record {
+	u32	size;		/* of the record including ips */
+	u32	tgid;
+	u32	pid;
+	u32	count;		/* samples folded into this record */
+	u32	cpu;
+	u32	nr;		/* number of u64 ips following */
+	u64	hash;
+	u64	ips[];
+};
+
+struct cprof_slot {
+	u64	hash;
+	u32	tgid;
+	u32	pid;
+	u32	count;
+	u32	nr;
+	u64	ips[CPROF_MAX_STACK];
+};
+
+struct cprof_cpu {
+	struct perf_event	*event;
+	struct perf_event	*dead;
+	struct cprof_slot	*table[2];
+	int			active;
+	unsigned long		dropped;	/* table full */
+	struct delayed_work	flush_work;
+};
+
+static DEFINE_PER_CPU(struct cprof_cpu, cprof_cpu);
+
+static bool cprof_enabled;
+static unsigned int cprof_freq = 99;
+static unsigned int cprof_interval_ms = 1000;
+static unsigned int cprof_ring_kb = 512;
+static bool cprof_user = true;
+module_param_named(freq, cprof_freq, uint, 0644);
+module_param_named(interval_ms, cprof_interval_ms, uint, 0644);
+module_param_named(ring_kb, cprof_ring_kb, uint, 0644);
+module_param_named(user_stacks, cprof_user, bool, 0644);
+
+static DEFINE_MUTEX(cprof_mutex);
+static enum cpuhp_state cprof_hp_state;
+static unsigned int cprof_freq_active;
+
+/* The shared ring, head and tail are byte offsets that only grow. */
+static DEFINE_SPINLOCK(cprof_ring_lock);
+static DECLARE_WAIT_QUEUE_HEAD(cprof_ring_wait);
+static void *cprof_ring;
+static size_t cprof_ring_size;
+static u64 cprof_head, cprof_tail;
+static unsigned long cprof_lost;	/* ring full */
+
+static void cprof_overflow(struct perf_event *event,
+			   struct perf_sample_data *data,
+			   struct pt_regs *regs)
+{
+	struct cprof_cpu *cc = this_cpu_ptr(&cprof_cpu);
+	struct perf_callchain_entry *entry;
+	struct cprof_slot *table, *slot;
+	u32 tgid = task_tgid_nr(current);
+	u32 pid = task_pid_nr(current);
+	u32 nr, i, idx;
+	u64 hash;
+
+	entry = get_perf_callchain(regs, 0, true, READ_ONCE(cprof_user),
+				   CPROF_MAX_STACK, false, true);
+	if (!entry || !entry->nr)
+		return;
+
+	nr = min_t(u32, entry->nr, CPROF_MAX_STACK);
+	hash = jhash2((u32 *)entry->ip, nr * 2, pid);
+	hash = (hash << 32) | jhash_1word(tgid, (u32)hash);
+
+	table = cc->table[READ_ONCE(cc->active)];
+	idx = hash & (CPROF_SLOTS - 1);
+	for (i = 0; i < CPROF_PROBES; i++, idx = (idx + 1) & (CPROF_SLOTS - 1)) {
+		slot = &table[idx];
+		if (!slot->count) {
+			slot->hash = hash;
+			slot->tgid = tgid;
+			slot->pid = pid;
+			slot->nr = nr;
+			memcpy(slot->ips, entry->ip, nr * sizeof(u64));
+			slot->count = 1;
+			return;
+		}
+		if (slot->hash == hash && slot->pid == pid && slot->nr == nr &&
+		    !memcmp(slot->ips, entry->ip, nr * sizeof(u64))) {
+			slot->count++;
+			return;
+		}
+	}
+	cc->dropped++;
+}
+
+static size_t cprof_record_size(u32 nr)
+{
+	return sizeof(struct cprof_record) + nr * sizeof(u64);
+}
+
+/* Copy @len bytes into the ring at byte offset @pos, wrapping around. */
+static void cprof_ring_write(u64 pos, const void *src, size_t len)
+{
+	size_t off = pos % cprof_ring_size;
+	size_t first = min(len, cprof_ring_size - off);
+
+	memcpy(cprof_ring + off, src, first);
+	memcpy(cprof_ring, src + first, len - first);
+}
+
+static void cprof_ring_read(u64 pos, void *dst, size_t len)
+{
+	size_t off = pos % cprof_ring_size;
+	size_t first = min(len, cprof_ring_size - off);
+
+	memcpy(dst, cprof_ring + off, first);
+	memcpy(dst + first, cprof_ring, len - first);
+}
+
+static void cprof_flush_table(int cpu, struct cprof_slot *table)
+{
+	struct cprof_record rec;
+	unsigned long flags;
+	bool wake = false;
+	int i;
+
+	for (i = 0; i < CPROF_SLOTS; i++) {
+		struct cprof_slot *slot = &table[i];
+
+		if (!slot->count)
+			continue;
+
+		rec.size = cprof_record_size(slot->nr);
+		rec.tgid = slot->tgid;
+		rec.pid = slot->pid;
+		rec.count = slot->count;
+		rec.cpu = cpu;
+		rec.nr = slot->nr;
+		rec.hash = slot->hash;
+
+		spin_lock_irqsave(&cprof_ring_lock, flags);
+		if (cprof_head - cprof_tail + rec.size > cprof_ring_size) {
+			cprof_lost += slot->count;
+		} else {
+			cprof_ring_write(cprof_head, &rec, sizeof(rec));
+			cprof_ring_write(cprof_head + sizeof(rec), slot->ips,
+					 slot->nr * sizeof(u64));
+			cprof_head += rec.size;
+			wake = true;
+		}
+		spin_unlock_irqrestore(&cprof_ring_lock, flags);
+
+		slot->count = 0;
+	}
+
+	if (wake)
+		wake_up_interruptible(&cprof_ring_wait);
+}
+
+static void cprof_flush_fn(struct work_struct *work)
+{
+	struct cprof_cpu *cc = container_of(to_delayed_work(work),
+					    struct cprof_cpu, flush_work);
+	int cpu = smp_processor_id();
+	int old = cc->active;
+
+	WRITE_ONCE(cc->active, !old);
+	barrier();
+	cprof_flush_table(cpu, cc->table[old]);
+
+	queue_delayed_work_on(cpu, system_wq, &cc->flush_work,
+			      msecs_to_jiffies(READ_ONCE(cprof_interval_ms)));
+}
+
+static int cprof_cpu_online(unsigned int cpu)
+{
+	struct cprof_cpu *cc = per_cpu_ptr(&cprof_cpu, cpu);
+	struct perf_event_attr attr = {
+		.type		= PERF_TYPE_HARDWARE,
+		.config		= PERF_COUNT_HW_CPU_CYCLES,
+		.size		= sizeof(struct perf_event_attr),
+		.freq		= 1,
+		.sample_freq	= cprof_freq_active,
+		.exclude_idle	= 1,
+	};
+	struct perf_event *event;
+
+	event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+						 cprof_overflow, NULL);
+	if (IS_ERR(event)) {
+		/* No usable PMU, fall back to the hrtimer driven clock. */
+		attr.type = PERF_TYPE_SOFTWARE;
+		attr.config = PERF_COUNT_SW_CPU_CLOCK;
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+							 cprof_overflow, NULL);
+	}
+	if (IS_ERR(event)) {
+		pr_warn("cprof: cannot create event on CPU%u: %ld\n",
+			cpu, PTR_ERR(event));
+		return 0;
+	}
+	cc->event = event;
+
+	/* Deferrable, so that an idle CPU is not woken up just to flush. */
+	INIT_DEFERRABLE_WORK(&cc->flush_work, cprof_flush_fn);
+	queue_delayed_work_on(cpu, system_wq, &cc->flush_work,
+			      msecs_to_jiffies(READ_ONCE(cprof_interval_ms)));
+	return 0;
+}
+
+static void cprof_release_dead(struct work_struct *work)
+{
+	struct perf_event *event;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		event = xchg(&per_cpu(cprof_cpu, cpu).dead, NULL);
+		if (event)
+			perf_event_release_kernel(event);
+	}
+}
+static DECLARE_WORK(cprof_release_work, cprof_release_dead);
+
+/*
+ * perf_event_release_kernel() must not be called with the hotplug lock
+ * held, so park the event and release it from a work item, as the perf
+ * based hardlockup detector does.
+ */
+static int cprof_cpu_offline(unsigned int cpu)
+{
+	struct cprof_cpu *cc = per_cpu_ptr(&cprof_cpu, cpu);
+	struct perf_event *event = cc->event;
+
+	if (!event)
+		return 0;
+
+	cancel_delayed_work_sync(&cc->flush_work);
+	perf_event_disable(event);
+	cc->event = NULL;
+	cprof_flush_table(cpu, cc->table[0]);
+	cprof_flush_table(cpu, cc->table[1]);
+
+	WARN_ON_ONCE(xchg(&cc->dead, event));
+	schedule_work(&cprof_release_work);
+	return 0;
+}
+
+static void cprof_free_tables(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cprof_cpu *cc = per_cpu_ptr(&cprof_cpu, cpu);
+
+		vfree(cc->table[0]);
+		vfree(cc->table[1]);
+		cc->table[0] = cc->table[1] = NULL;
+	}
+	vfree(cprof_ring);
+	cprof_ring = NULL;
+}
+
+static int cprof_start(void)
+{
+	size_t tsize = CPROF_SLOTS * sizeof(struct cprof_slot);
+	int cpu, ret;
+
+	cprof_ring_size = max(cprof_ring_kb, 64U) * SZ_1K;
+	cprof_ring = vmalloc(cprof_ring_size);
+	if (!cprof_ring)
+		return -ENOMEM;
+	cprof_head = cprof_tail = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct cprof_cpu *cc = per_cpu_ptr(&cprof_cpu, cpu);
+
+		cc->table[0] = vzalloc_node(tsize, cpu_to_node(cpu));
+		cc->table[1] = vzalloc_node(tsize, cpu_to_node(cpu));
+		if (!cc->table[0] || !cc->table[1]) {
+			cprof_free_tables();
+			return -ENOMEM;
+		}
+		cc->active = 0;
+	}
+
+	ret = get_callchain_buffers(CPROF_MAX_STACK);
+	if (ret) {
+		cprof_free_tables();
+		return ret;
+	}
+
+	cprof_freq_active = clamp(cprof_freq, 1U, 1000U);
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "perf/cprof:online",
+				cprof_cpu_online, cprof_cpu_offline);
+	if (ret < 0) {
+		put_callchain_buffers();
+		cprof_free_tables();
+		return ret;
+	}
+	cprof_hp_state = ret;
+	return 0;
+}
+
+static void cprof_stop(void)
+{
+	cpuhp_remove_state(cprof_hp_state);
+	flush_work(&cprof_release_work);
+	cprof_release_dead(NULL);
+	put_callchain_buffers();
+
+	/* Let a blocked reader notice that the ring is going away. */
+	wake_up_interruptible(&cprof_ring_wait);
+	spin_lock_irq(&cprof_ring_lock);
+	cprof_head = cprof_tail = 0;
+	spin_unlock_irq(&cprof_ring_lock);
+	cprof_free_tables();
+}
+
+static int param_set_cprof_enable(const char *val, const struct kernel_param *kp)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(val, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&cprof_mutex);
+	if (enable && !cprof_enabled) {
+		ret = cprof_start();
+		if (!ret)
+			cprof_enabled = true;
+	} else if (!enable && cprof_enabled) {
+		cprof_enabled = false;
+		cprof_stop();
+	}
+	mutex_unlock(&cprof_mutex);
+
+	return ret;
+}
+
+static const struct kernel_param_ops cprof_enable_ops = {
+	.set = param_set_cprof_enable,
+	.get = param_get_bool,
+};
+module_param_cb(enable, &cprof_enable_ops, &cprof_enabled, 0644);
+
+static int param_get_cprof_lost(char *buf, const struct kernel_param *kp)
+{
+	unsigned long dropped = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		dropped += per_cpu(cprof_cpu, cpu).dropped;
+
+	return sprintf(buf, "ring=%lu table=%lu\n", READ_ONCE(cprof_lost),
+		       dropped);
+}
+
+static const struct kernel_param_ops cprof_lost_ops = {
+	.get = param_get_cprof_lost,
+};
+module_param_cb(lost, &cprof_lost_ops, NULL, 0444);
+
+/*
+ * read() hands out whole records only and blocks until at least one is
+ * available, unless the file was opened O_NONBLOCK. A buffer too small
+ * for the next record gets -EINVAL.
+ */
+static ssize_t cprof_read(struct file *file, char __user *ubuf,
+			  size_t count, loff_t *ppos)
+{
+	struct cprof_record rec;
+	ssize_t copied = 0;
+	void *kbuf;
+	int ret;
+
+	mutex_lock(&cprof_mutex);
+	if (!cprof_enabled) {
+		mutex_unlock(&cprof_mutex);
+		return -ENODATA;
+	}
+	mutex_unlock(&cprof_mutex);
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		ret = wait_event_interruptible(cprof_ring_wait,
+				READ_ONCE(cprof_head) != READ_ONCE(cprof_tail) ||
+				!READ_ONCE(cprof_enabled));
+		if (ret)
+			return ret;
+	}
+
+	kbuf = kmalloc(cprof_record_size(CPROF_MAX_STACK), GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	mutex_lock(&cprof_mutex);
+	while (cprof_enabled) {
+		spin_lock_irq(&cprof_ring_lock);
+		if (cprof_head == cprof_tail) {
+			spin_unlock_irq(&cprof_ring_lock);
+			break;
+		}
+		cprof_ring_read(cprof_tail, &rec, sizeof(rec));
+		if (rec.size > count - copied) {
+			spin_unlock_irq(&cprof_ring_lock);
+			if (!copied)
+				copied = -EINVAL;
+			break;
+		}
+		cprof_ring_read(cprof_tail, kbuf, rec.size);
+		cprof_tail += rec.size;
+		spin_unlock_irq(&cprof_ring_lock);
+
+		if (copy_to_user(ubuf + copied, kbuf, rec.size)) {
+			copied = copied ?: -EFAULT;
+			break;
+		}
+		copied += rec.size;
+	}
+	mutex_unlock(&cprof_mutex);
+	kfree(kbuf);
+
+	if (!copied && (file->f_flags & O_NONBLOCK))
+		return -EAGAIN;
+	return copied;
+}
+
+static __poll_t cprof_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &cprof_ring_wait, wait);
+	if (READ_ONCE(cprof_head) != READ_ONCE(cprof_tail))
+		return EPOLLIN | EPOLLRDNORM;
+	return 0;
+}
+
+static const struct proc_ops cprof_proc_ops = {
+	.proc_read	= cprof_read,
+	.proc_poll	= cprof_poll,
+	.proc_lseek	= noop_llseek,
+};
+
+static int __init cprof_init(void)
+{
+	proc_create("cprof", 0400, NULL, &cprof_proc_ops);
+	return 0;
+}
+device_initcall(cprof_init);
@@ -41,6 +41,9 @@ static struct rb_root uprobes_tree = RB_ROOT;
 #define no_uprobe_events()	RB_EMPTY_ROOT(&uprobes_tree)
 
 static DEFINE_SPINLOCK(uprobes_treelock);	/* serialize rbtree access */
+/* lets the breakpoint hit path search the rbtree without the lock */
+static seqcount_spinlock_t uprobes_seqcount =
+	SEQCNT_SPINLOCK_ZERO(uprobes_seqcount, &uprobes_treelock);
 
 #define UPROBES_HASH_SZ	13
 /* serialize uprobe->pending_list */
@@ -55,6 +58,7 @@ DEFINE_STATIC_PERCPU_RWSEM(dup_mmap_sem);
 struct uprobe {
 	struct rb_node		rb_node;	/* node in the rb tree */
 	refcount_t		ref;
+	struct rcu_head		rcu;		/* lockless lookups, see find_uprobe_rcu() */
 	struct rw_semaphore	register_rwsem;
 	struct rw_semaphore	consumer_rwsem;
 	struct list_head	pending_list;
@@ -609,7 +613,7 @@ static void put_uprobe(struct uprobe *uprobe)
 		mutex_lock(&delayed_uprobe_lock);
 		delayed_uprobe_remove(uprobe, NULL);
 		mutex_unlock(&delayed_uprobe_lock);
-		kfree(uprobe);
+		kfree_rcu(uprobe, rcu);
 	}
 }
 
@@ -666,6 +670,43 @@ static struct uprobe *find_uprobe(struct inode *inode, loff_t offset)
 	return uprobe;
 }
 
+/*
+ * Lockless variant of find_uprobe() for the breakpoint hit path. The
+ * rbtree is written with WRITE_ONCE() so a concurrent modification can
+ * make the walk miss but never crash; uprobes_seqcount tells us when to
+ * walk again. Memory is RCU freed, and a uprobe whose refcount already
+ * dropped to zero has been erased from the tree, so it is skipped.
+ */
+static struct uprobe *find_uprobe_rcu(struct inode *inode, loff_t offset)
+{
+	struct uprobe u = { .inode = inode, .offset = offset };
+	struct uprobe *uprobe;
+	struct rb_node *n;
+	unsigned int seq;
+	int match;
+
+	rcu_read_lock();
+	do {
+		seq = raw_read_seqcount_begin(&uprobes_seqcount);
+		n = READ_ONCE(uprobes_tree.rb_node);
+		while (n) {
+			uprobe = rb_entry(n, struct uprobe, rb_node);
+			match = match_uprobe(&u, uprobe);
+			if (!match) {
+				if (refcount_inc_not_zero(&uprobe->ref)) {
+					rcu_read_unlock();
+					return uprobe;
+				}
+				break;
+			}
+			n = match < 0 ? READ_ONCE(n->rb_left) : READ_ONCE(n->rb_right);
+		}
+	} while (read_seqcount_retry(&uprobes_seqcount, seq));
+	rcu_read_unlock();
+
+	return NULL;
+}
+
 static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 {
 	struct rb_node **p = &uprobes_tree.rb_node;
@@ -688,10 +729,12 @@ static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 	}
 
 	u = NULL;
+	/* get access + creation ref, before lockless lookups can see it */
+	refcount_set(&uprobe->ref, 2);
+	write_seqcount_begin(&uprobes_seqcount);
 	rb_link_node(&uprobe->rb_node, parent, p);
 	rb_insert_color(&uprobe->rb_node, &uprobes_tree);
-	/* get access + creation ref */
-	refcount_set(&uprobe->ref, 2);
+	write_seqcount_end(&uprobes_seqcount);
 
 	return u;
 }
@@ -943,7 +986,9 @@ static void delete_uprobe(struct uprobe *uprobe)
 		return;
 
 	spin_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	rb_erase(&uprobe->rb_node, &uprobes_tree);
+	write_seqcount_end(&uprobes_seqcount);
 	spin_unlock(&uprobes_treelock);
 	RB_CLEAR_NODE(&uprobe->rb_node); /* for uprobe_is_active() */
 	put_uprobe(uprobe);
@@ -1032,6 +1077,11 @@ build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
 	return curr;
 }
 
+/*
+ * Must be called with dup_mmap_sem held for writing. It is taken outside
+ * uprobe->register_rwsem so that a batch of registrations pays for the
+ * percpu_down_write() (an RCU grace period) only once.
+ */
 static int
 register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 {
@@ -1039,7 +1089,7 @@ register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 	struct map_info *info;
 	int err = 0;
 
-	percpu_down_write(&dup_mmap_sem);
+	percpu_rwsem_assert_held(&dup_mmap_sem);
 	info = build_map_info(uprobe->inode->i_mapping,
 					uprobe->offset, is_register);
 	if (IS_ERR(info)) {
@@ -1082,7 +1132,6 @@ register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 		info = free_map_info(info);
 	}
  out:
-	percpu_up_write(&dup_mmap_sem);
 	return err;
 }
 
@@ -1106,7 +1155,8 @@ __uprobe_unregister(struct uprobe *uprobe, struct uprobe_consumer *uc)
  * @offset: offset from the start of the file.
  * @uc: identify which probe if multiple probes are colocated.
  */
-void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
+static void uprobe_unregister_locked(struct inode *inode, loff_t offset,
+				     struct uprobe_consumer *uc)
 {
 	struct uprobe *uprobe;
 
@@ -1119,6 +1169,13 @@ void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consume
 	up_write(&uprobe->register_rwsem);
 	put_uprobe(uprobe);
 }
+
+void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
+{
+	percpu_down_write(&dup_mmap_sem);
+	uprobe_unregister_locked(inode, offset, uc);
+	percpu_up_write(&dup_mmap_sem);
+}
 EXPORT_SYMBOL_GPL(uprobe_unregister);
 
 /*
@@ -1139,12 +1196,9 @@ EXPORT_SYMBOL_GPL(uprobe_unregister);
  * Return errno if it cannot successully install probes
  * else return 0 (success)
  */
-static int __uprobe_register(struct inode *inode, loff_t offset,
-			     loff_t ref_ctr_offset, struct uprobe_consumer *uc)
+static int uprobe_register_check(struct inode *inode, loff_t offset,
+				 loff_t ref_ctr_offset, struct uprobe_consumer *uc)
 {
-	struct uprobe *uprobe;
-	int ret;
-
 	/* Uprobe must have at least one set consumer */
 	if (!uc->handler && !uc->ret_handler)
 		return -EINVAL;
@@ -1165,6 +1219,16 @@ static int __uprobe_register(struct inode *inode, loff_t offset,
 	if (!IS_ALIGNED(ref_ctr_offset, sizeof(short)))
 		return -EINVAL;
 
+	return 0;
+}
+
+static int __uprobe_register_locked(struct inode *inode, loff_t offset,
+				    loff_t ref_ctr_offset,
+				    struct uprobe_consumer *uc)
+{
+	struct uprobe *uprobe;
+	int ret;
+
  retry:
 	uprobe = alloc_uprobe(inode, offset, ref_ctr_offset);
 	if (!uprobe)
@@ -1192,6 +1256,22 @@ static int __uprobe_register(struct inode *inode, loff_t offset,
 	return ret;
 }
 
+static int __uprobe_register(struct inode *inode, loff_t offset,
+			     loff_t ref_ctr_offset, struct uprobe_consumer *uc)
+{
+	int ret;
+
+	ret = uprobe_register_check(inode, offset, ref_ctr_offset, uc);
+	if (ret)
+		return ret;
+
+	percpu_down_write(&dup_mmap_sem);
+	ret = __uprobe_register_locked(inode, offset, ref_ctr_offset, uc);
+	percpu_up_write(&dup_mmap_sem);
+
+	return ret;
+}
+
 int uprobe_register(struct inode *inode, loff_t offset,
 		    struct uprobe_consumer *uc)
 {
@@ -1206,6 +1286,63 @@ int uprobe_register_refctr(struct inode *inode, loff_t offset,
 }
 EXPORT_SYMBOL_GPL(uprobe_register_refctr);
 
+/*
+ * uprobe_register_batch - register @cnt probes in @inode at once
+ * @inode: the file in which the probes have to be placed.
+ * @cnt: number of probes.
+ * @offsets: offset of each probe from the start of the file.
+ * @ref_ctr_offsets: reference counter offset of each probe, or NULL.
+ * @ucs: consumer of each probe.
+ *
+ * Same as calling uprobe_register_refctr() @cnt times, except that
+ * dup_mmap_sem is taken for writing once for the whole batch instead of
+ * once per probe. Either all probes are registered or none is.
+ */
+int uprobe_register_batch(struct inode *inode, int cnt, const loff_t *offsets,
+			  const loff_t *ref_ctr_offsets,
+			  struct uprobe_consumer **ucs)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < cnt; i++) {
+		ret = uprobe_register_check(inode, offsets[i],
+				ref_ctr_offsets ? ref_ctr_offsets[i] : 0, ucs[i]);
+		if (ret)
+			return ret;
+	}
+
+	percpu_down_write(&dup_mmap_sem);
+	for (i = 0; i < cnt; i++) {
+		ret = __uprobe_register_locked(inode, offsets[i],
+				ref_ctr_offsets ? ref_ctr_offsets[i] : 0, ucs[i]);
+		if (ret)
+			break;
+	}
+	if (ret) {
+		while (--i >= 0)
+			uprobe_unregister_locked(inode, offsets[i], ucs[i]);
+	}
+	percpu_up_write(&dup_mmap_sem);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(uprobe_register_batch);
+
+/*
+ * uprobe_unregister_batch - unregister probes added by uprobe_register_batch()
+ */
+void uprobe_unregister_batch(struct inode *inode, int cnt, const loff_t *offsets,
+			     struct uprobe_consumer **ucs)
+{
+	int i;
+
+	percpu_down_write(&dup_mmap_sem);
+	for (i = 0; i < cnt; i++)
+		uprobe_unregister_locked(inode, offsets[i], ucs[i]);
+	percpu_up_write(&dup_mmap_sem);
+}
+EXPORT_SYMBOL_GPL(uprobe_unregister_batch);
+
 /*
  * uprobe_apply - unregister an already registered probe.
  * @inode: the file in which the probe has to be removed.
@@ -1224,12 +1361,14 @@ int uprobe_apply(struct inode *inode, loff_t offset,
 	if (WARN_ON(!uprobe))
 		return ret;
 
+	percpu_down_write(&dup_mmap_sem);
 	down_write(&uprobe->register_rwsem);
 	for (con = uprobe->consumers; con && con != uc ; con = con->next)
 		;
 	if (con)
 		ret = register_for_each_vma(uprobe, add ? uc : NULL);
 	up_write(&uprobe->register_rwsem);
+	percpu_up_write(&dup_mmap_sem);
 	put_uprobe(uprobe);
 
 	return ret;
@@ -2054,7 +2193,7 @@ static struct uprobe *find_active_uprobe(unsigned long bp_vaddr, int *is_swbp)
 			struct inode *inode = file_inode(vma->vm_file);
 			loff_t offset = vaddr_to_offset(vma, bp_vaddr);
 
-			uprobe = find_uprobe(inode, offset);
+			uprobe = find_uprobe_rcu(inode, offset);
 		}
 
 		if (!uprobe)
@@ -62,6 +62,7 @@ LOCK_EVENT(rwsem_opt_fail)	/* # of failed optspins			*/
 LOCK_EVENT(rwsem_opt_nospin)	/* # of disabled optspins		*/
 LOCK_EVENT(rwsem_opt_norspin)	/* # of disabled reader-only optspins	*/
 LOCK_EVENT(rwsem_opt_rlock2)	/* # of opt-acquired 2ndary read locks	*/
+LOCK_EVENT(rwsem_opt_rspin_ext)	/* # of reader-owned spin extensions	*/
 LOCK_EVENT(rwsem_rlock)		/* # of read locks acquired		*/
 LOCK_EVENT(rwsem_rlock_fast)	/* # of fast read locks acquired	*/
 LOCK_EVENT(rwsem_rlock_fail)	/* # of failed read lock acquisitions	*/
@@ -69,3 +70,13 @@ LOCK_EVENT(rwsem_rlock_handoff)	/* # of read lock handoffs		*/
 LOCK_EVENT(rwsem_wlock)		/* # of write locks acquired		*/
 LOCK_EVENT(rwsem_wlock_fail)	/* # of failed write lock acquisitions	*/
 LOCK_EVENT(rwsem_wlock_handoff)	/* # of write lock handoffs		*/
+LOCK_EVENT(rwsem_rwait_10us)	/* # of read lock waits < 10us		*/
+LOCK_EVENT(rwsem_rwait_100us)	/* # of read lock waits < 100us		*/
+LOCK_EVENT(rwsem_rwait_1ms)	/* # of read lock waits < 1ms		*/
+LOCK_EVENT(rwsem_rwait_10ms)	/* # of read lock waits < 10ms		*/
+LOCK_EVENT(rwsem_rwait_max)	/* # of read lock waits >= 10ms		*/
+LOCK_EVENT(rwsem_wwait_10us)	/* # of write lock waits < 10us		*/
+LOCK_EVENT(rwsem_wwait_100us)	/* # of write lock waits < 100us	*/
+LOCK_EVENT(rwsem_wwait_1ms)	/* # of write lock waits < 1ms		*/
+LOCK_EVENT(rwsem_wwait_10ms)	/* # of write lock waits < 10ms		*/
+LOCK_EVENT(rwsem_wwait_max)	/* # of write lock waits >= 10ms	*/
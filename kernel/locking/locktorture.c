@@ -21,6 +21,7 @@
 #include <linux/smp.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <uapi/linux/sched/types.h>
 #include <linux/rtmutex.h>
 #include <linux/atomic.h>
@@ -37,6 +38,10 @@ torture_param(int, nwriters_stress, -1,
 	     "Number of write-locking stress-test threads");
 torture_param(int, nreaders_stress, -1,
 	     "Number of read-locking stress-test threads");
+torture_param(int, nrt_stress, 0,
+	     "Number of writers and of readers run as SCHED_FIFO");
+torture_param(int, nturbo_stress, 0,
+	     "Number of writers and of readers run at nice 0 as task_turbo candidates");
 torture_param(int, onoff_holdoff, 0, "Time after boot before CPU hotplugs (s)");
 torture_param(int, onoff_interval, 0,
 	     "Time between CPU hotplugs (s), 0=disable");
@@ -61,11 +66,45 @@ static struct task_struct **reader_tasks;
 static bool lock_is_write_held;
 static bool lock_is_read_held;
 
+/* Acquisition latency histogram, bucket i counts latencies < 2^i ns. */
+#define LOCK_LAT_BUCKETS	32
+
 struct lock_stress_stats {
 	long n_lock_fail;
 	long n_lock_acquired;
+	unsigned long lat_hist[LOCK_LAT_BUCKETS];
+	u64 lat_max;
 };
 
+/*
+ * Thread mix: the first nrt_stress writers (and readers) are SCHED_FIFO,
+ * the next nturbo_stress run at nice 0 and have their pids logged so
+ * that they can be written to task_turbo's turbo_pid parameter, and the
+ * remainder run at MAX_NICE as before.
+ */
+static void lock_torture_set_prio(int idx, const char *role)
+{
+	if (idx < nrt_stress) {
+		sched_set_fifo(current);
+	} else if (idx < nrt_stress + nturbo_stress) {
+		set_user_nice(current, 0);
+		pr_alert("%s" TORTURE_FLAG " turbo %s pid %d\n",
+			 torture_type, role, task_pid_nr(current));
+	} else {
+		set_user_nice(current, MAX_NICE);
+	}
+}
+
+static void lock_torture_lat(struct lock_stress_stats *statp, u64 start)
+{
+	u64 delta = local_clock() - start;
+	int b = delta ? fls64(delta) : 0;
+
+	statp->lat_hist[min(b, LOCK_LAT_BUCKETS - 1)]++;
+	if (delta > statp->lat_max)
+		statp->lat_max = delta;
+}
+
 /* Forward reference. */
 static void lock_torture_cleanup(void);
 
@@ -613,16 +652,19 @@ static int lock_torture_writer(void *arg)
 {
 	struct lock_stress_stats *lwsp = arg;
 	DEFINE_TORTURE_RANDOM(rand);
+	u64 start;
 
 	VERBOSE_TOROUT_STRING("lock_torture_writer task started");
-	set_user_nice(current, MAX_NICE);
+	lock_torture_set_prio(lwsp - cxt.lwsa, "writer");
 
 	do {
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
 		cxt.cur_ops->task_boost(&rand);
+		start = local_clock();
 		cxt.cur_ops->writelock();
+		lock_torture_lat(lwsp, start);
 		if (WARN_ON_ONCE(lock_is_write_held))
 			lwsp->n_lock_fail++;
 		lock_is_write_held = true;
@@ -650,15 +692,18 @@ static int lock_torture_reader(void *arg)
 {
 	struct lock_stress_stats *lrsp = arg;
 	DEFINE_TORTURE_RANDOM(rand);
+	u64 start;
 
 	VERBOSE_TOROUT_STRING("lock_torture_reader task started");
-	set_user_nice(current, MAX_NICE);
+	lock_torture_set_prio(lrsp - cxt.lrsa, "reader");
 
 	do {
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
+		start = local_clock();
 		cxt.cur_ops->readlock();
+		lock_torture_lat(lrsp, start);
 		lock_is_read_held = true;
 		if (WARN_ON_ONCE(lock_is_write_held))
 			lrsp->n_lock_fail++; /* rare, but... */
@@ -680,10 +725,14 @@ static int lock_torture_reader(void *arg)
 static void __torture_print_stats(char *page,
 				  struct lock_stress_stats *statp, bool write)
 {
+	static const int pct[] = { 500, 900, 990, 999 };
+	unsigned long hist[LOCK_LAT_BUCKETS] = { 0 };
+	unsigned long nlat = 0, acc;
 	bool fail = false;
-	int i, n_stress;
+	int i, j, n_stress;
 	long max = 0, min = statp ? statp[0].n_lock_acquired : 0;
 	long long sum = 0;
+	u64 lat_max = 0;
 
 	n_stress = write ? cxt.nrealwriters_stress : cxt.nrealreaders_stress;
 	for (i = 0; i < n_stress; i++) {
@@ -694,6 +743,12 @@ static void __torture_print_stats(char *page,
 			max = statp[i].n_lock_acquired;
 		if (min > statp[i].n_lock_acquired)
 			min = statp[i].n_lock_acquired;
+		for (j = 0; j < LOCK_LAT_BUCKETS; j++) {
+			hist[j] += statp[i].lat_hist[j];
+			nlat += statp[i].lat_hist[j];
+		}
+		if (lat_max < statp[i].lat_max)
+			lat_max = statp[i].lat_max;
 	}
 	page += sprintf(page,
 			"%s:  Total: %lld  Max/Min: %ld/%ld %s  Fail: %d %s\n",
@@ -701,6 +756,18 @@ static void __torture_print_stats(char *page,
 			sum, max, min,
 			!onoff_interval && max / 2 > min ? "???" : "",
 			fail, fail ? "!!!" : "");
+
+	/* Percentiles are reported as the upper bound of their bucket. */
+	page += sprintf(page, "%s acquire latency (ns):",
+			write ? "Writes" : "Reads ");
+	for (i = 0, j = 0, acc = 0; i < ARRAY_SIZE(pct) && nlat; i++) {
+		while (j < LOCK_LAT_BUCKETS - 1 &&
+		       (acc + hist[j]) * 1000 < nlat * pct[i])
+			acc += hist[j++];
+		page += sprintf(page, " p%d.%d<%llu", pct[i] / 10, pct[i] % 10,
+				1ULL << j);
+	}
+	page += sprintf(page, " max=%llu\n", lat_max);
 	if (fail)
 		atomic_inc(&cxt.n_lock_torture_errors);
 }
@@ -770,9 +837,10 @@ lock_torture_print_module_parms(struct lock_torture_ops *cur_ops,
 				const char *tag)
 {
 	pr_alert("%s" TORTURE_FLAG
-		 "--- %s%s: nwriters_stress=%d nreaders_stress=%d stat_interval=%d verbose=%d shuffle_interval=%d stutter=%d shutdown_secs=%d onoff_interval=%d onoff_holdoff=%d\n",
+		 "--- %s%s: nwriters_stress=%d nreaders_stress=%d nrt_stress=%d nturbo_stress=%d stat_interval=%d verbose=%d shuffle_interval=%d stutter=%d shutdown_secs=%d onoff_interval=%d onoff_holdoff=%d\n",
 		 torture_type, tag, cxt.debug_lock ? " [debug]": "",
-		 cxt.nrealwriters_stress, cxt.nrealreaders_stress, stat_interval,
+		 cxt.nrealwriters_stress, cxt.nrealreaders_stress,
+		 nrt_stress, nturbo_stress, stat_interval,
 		 verbose, shuffle_interval, stutter, shutdown_secs,
 		 onoff_interval, onoff_holdoff);
 }
@@ -899,9 +967,9 @@ static int __init lock_torture_init(void)
 	/* Initialize the statistics so that each run gets its own numbers. */
 	if (nwriters_stress) {
 		lock_is_write_held = false;
-		cxt.lwsa = kmalloc_array(cxt.nrealwriters_stress,
-					 sizeof(*cxt.lwsa),
-					 GFP_KERNEL);
+		cxt.lwsa = kcalloc(cxt.nrealwriters_stress,
+				   sizeof(*cxt.lwsa),
+				   GFP_KERNEL);
 		if (cxt.lwsa == NULL) {
 			VERBOSE_TOROUT_STRING("cxt.lwsa: Out of memory");
 			firsterr = -ENOMEM;
@@ -930,9 +998,9 @@ static int __init lock_torture_init(void)
 
 		if (nreaders_stress) {
 			lock_is_read_held = false;
-			cxt.lrsa = kmalloc_array(cxt.nrealreaders_stress,
-						 sizeof(*cxt.lrsa),
-						 GFP_KERNEL);
+			cxt.lrsa = kcalloc(cxt.nrealreaders_stress,
+					   sizeof(*cxt.lrsa),
+					   GFP_KERNEL);
 			if (cxt.lrsa == NULL) {
 				VERBOSE_TOROUT_STRING("cxt.lrsa: Out of memory");
 				firsterr = -ENOMEM;
@@ -776,12 +776,27 @@ static inline u64 rwsem_rspin_threshold(struct rw_semaphore *sem)
 	return sched_clock() + delta;
 }
 
+/*
+ * Once the initial threshold is used up, a writer keeps spinning on a
+ * reader-owned rwsem in 5us steps for as long as the reader count keeps
+ * going down between checks, i.e. the readers are visibly winding down.
+ * The total time spent in one reader phase is capped at 50us.
+ */
+#define RWSEM_RSPIN_STEP	(5 * NSEC_PER_USEC)
+#define RWSEM_RSPIN_MAX		(50 * NSEC_PER_USEC)
+
+static inline int rwsem_reader_count(struct rw_semaphore *sem)
+{
+	return atomic_long_read(&sem->count) >> RWSEM_READER_SHIFT;
+}
+
 static bool rwsem_optimistic_spin(struct rw_semaphore *sem, bool wlock)
 {
 	bool taken = false;
 	int prev_owner_state = OWNER_NULL;
 	int loop = 0;
-	u64 rspin_threshold = 0;
+	int rspin_readers = 0;
+	u64 rspin_threshold = 0, rspin_limit = 0, now;
 	unsigned long nonspinnable = wlock ? RWSEM_WR_NONSPINNABLE
 					   : RWSEM_RD_NONSPINNABLE;
 
@@ -828,6 +843,8 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem, bool wlock)
 				if (rwsem_test_oflags(sem, nonspinnable))
 					break;
 				rspin_threshold = rwsem_rspin_threshold(sem);
+				rspin_limit = sched_clock() + RWSEM_RSPIN_MAX;
+				rspin_readers = rwsem_reader_count(sem);
 				loop = 0;
 			}
 
@@ -837,11 +854,25 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem, bool wlock)
 			 * as to reduce the average latency between the times
 			 * when the lock becomes free and when the spinner
 			 * is ready to do a trylock.
+			 *
+			 * When the threshold is reached but readers have
+			 * been leaving since the last check, grant another
+			 * step rather than giving up just before the lock
+			 * is released.
 			 */
-			else if (!(++loop & 0xf) && (sched_clock() > rspin_threshold)) {
-				rwsem_set_nonspinnable(sem);
-				lockevent_inc(rwsem_opt_nospin);
-				break;
+			else if (!(++loop & 0xf) &&
+				 ((now = sched_clock()) > rspin_threshold)) {
+				int readers = rwsem_reader_count(sem);
+
+				if (readers < rspin_readers && now < rspin_limit) {
+					rspin_readers = readers;
+					rspin_threshold = now + RWSEM_RSPIN_STEP;
+					lockevent_inc(rwsem_opt_rspin_ext);
+				} else {
+					rwsem_set_nonspinnable(sem);
+					lockevent_inc(rwsem_opt_nospin);
+					break;
+				}
 			}
 		}
 
@@ -979,6 +1010,45 @@ rwsem_spin_on_owner(struct rw_semaphore *sem, unsigned long nonspinnable)
 #define OWNER_NULL	1
 #endif
 
+#ifdef CONFIG_LOCK_EVENT_COUNTS
+/*
+ * Sort the time a task spent queued on the rwsem into decade buckets
+ * of the rwsem_{r,w}wait_* lock events.
+ */
+static inline u64 rwsem_wait_start(void)
+{
+	return sched_clock();
+}
+
+static void rwsem_wait_account(u64 start, bool wlock)
+{
+	u64 delta = sched_clock() - start;
+	enum lock_events ev;
+
+	if (delta < 10 * NSEC_PER_USEC)
+		ev = LOCKEVENT_rwsem_rwait_10us;
+	else if (delta < 100 * NSEC_PER_USEC)
+		ev = LOCKEVENT_rwsem_rwait_100us;
+	else if (delta < NSEC_PER_MSEC)
+		ev = LOCKEVENT_rwsem_rwait_1ms;
+	else if (delta < 10 * NSEC_PER_MSEC)
+		ev = LOCKEVENT_rwsem_rwait_10ms;
+	else
+		ev = LOCKEVENT_rwsem_rwait_max;
+
+	if (wlock)
+		ev += LOCKEVENT_rwsem_wwait_10us - LOCKEVENT_rwsem_rwait_10us;
+	__lockevent_inc(ev, true);
+}
+#else
+static inline u64 rwsem_wait_start(void)
+{
+	return 0;
+}
+
+static inline void rwsem_wait_account(u64 start, bool wlock) { }
+#endif
+
 /*
  * Wait for the read lock to be granted
  */
@@ -990,6 +1060,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, int state)
 	DEFINE_WAKE_Q(wake_q);
 	bool wake = false;
 	bool already_on_list = false;
+	u64 wait_start;
 
 	/*
 	 * Save the current read-owner of rwsem, if available, and the
@@ -1082,6 +1153,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, int state)
 	wake_up_q(&wake_q);
 
 	/* wait to be given the lock */
+	wait_start = rwsem_wait_start();
 	trace_android_vh_rwsem_read_wait_start(sem);
 	for (;;) {
 		set_current_state(state);
@@ -1103,6 +1175,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, int state)
 
 	__set_current_state(TASK_RUNNING);
 	trace_android_vh_rwsem_read_wait_finish(sem);
+	rwsem_wait_account(wait_start, false);
 	lockevent_inc(rwsem_rlock);
 	return sem;
 
@@ -1145,6 +1218,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	struct rw_semaphore *ret = sem;
 	DEFINE_WAKE_Q(wake_q);
 	bool already_on_list = false;
+	u64 wait_start;
 
 	/* do optimistic spinning and steal lock if possible */
 	if (rwsem_can_spin_on_owner(sem, RWSEM_WR_NONSPINNABLE) &&
@@ -1167,6 +1241,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_WRITE;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
+	wait_start = rwsem_wait_start();
 
 	raw_spin_lock_irq(&sem->wait_lock);
 
@@ -1279,6 +1354,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	list_del(&waiter.list);
 	rwsem_disable_reader_optspin(sem, disable_rspin);
 	raw_spin_unlock_irq(&sem->wait_lock);
+	rwsem_wait_account(wait_start, true);
 	lockevent_inc(rwsem_wlock);
 
 	return ret;
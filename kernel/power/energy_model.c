@@ -30,18 +30,48 @@ static bool _is_cpu_device(struct device *dev)
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *rootdir;
 
-static void em_debug_create_ps(struct em_perf_state *ps, struct dentry *pd)
+/*
+ * The table of a domain may be replaced at runtime, so the debugfs files refer
+ * to a performance state by domain and index rather than by address.
+ */
+struct em_dbg_info {
+	struct em_perf_domain *pd;
+	int ps_id;
+};
+
+#define DEFINE_EM_DBG_SHOW(name)					\
+static int em_debug_##name##_show(struct seq_file *s, void *unused)	\
+{									\
+	struct em_dbg_info *em_dbg = s->private;			\
+	unsigned long val;						\
+									\
+	rcu_read_lock();						\
+	val = em_perf_state_table(em_dbg->pd)[em_dbg->ps_id].name;	\
+	rcu_read_unlock();						\
+									\
+	seq_printf(s, "%lu\n", val);					\
+	return 0;							\
+}									\
+DEFINE_SHOW_ATTRIBUTE(em_debug_##name)
+
+DEFINE_EM_DBG_SHOW(frequency);
+DEFINE_EM_DBG_SHOW(power);
+DEFINE_EM_DBG_SHOW(cost);
+
+static void em_debug_create_ps(struct em_dbg_info *em_dbg, struct dentry *pd)
 {
 	struct dentry *d;
 	char name[24];
 
-	snprintf(name, sizeof(name), "ps:%lu", ps->frequency);
+	snprintf(name, sizeof(name), "ps:%lu",
+		 em_dbg->pd->table[em_dbg->ps_id].frequency);
 
 	/* Create per-ps directory */
 	d = debugfs_create_dir(name, pd);
-	debugfs_create_ulong("frequency", 0444, d, &ps->frequency);
-	debugfs_create_ulong("power", 0444, d, &ps->power);
-	debugfs_create_ulong("cost", 0444, d, &ps->cost);
+	debugfs_create_file("frequency", 0444, d, em_dbg,
+			    &em_debug_frequency_fops);
+	debugfs_create_file("power", 0444, d, em_dbg, &em_debug_power_fops);
+	debugfs_create_file("cost", 0444, d, em_dbg, &em_debug_cost_fops);
 }
 
 static int em_debug_cpus_show(struct seq_file *s, void *unused)
@@ -65,6 +95,7 @@ DEFINE_SHOW_ATTRIBUTE(em_debug_units);
 
 static void em_debug_create_pd(struct device *dev)
 {
+	struct em_dbg_info *em_dbg;
 	struct dentry *d;
 	int i;
 
@@ -77,9 +108,17 @@ static void em_debug_create_pd(struct device *dev)
 
 	debugfs_create_file("units", 0444, d, dev->em_pd, &em_debug_units_fops);
 
+	em_dbg = devm_kcalloc(dev, dev->em_pd->nr_perf_states,
+			      sizeof(*em_dbg), GFP_KERNEL);
+	if (!em_dbg)
+		return;
+
 	/* Create a sub-directory for each performance state */
-	for (i = 0; i < dev->em_pd->nr_perf_states; i++)
-		em_debug_create_ps(&dev->em_pd->table[i], d);
+	for (i = 0; i < dev->em_pd->nr_perf_states; i++) {
+		em_dbg[i].pd = dev->em_pd;
+		em_dbg[i].ps_id = i;
+		em_debug_create_ps(&em_dbg[i], d);
+	}
 
 }
 
@@ -104,13 +143,35 @@ static void em_debug_create_pd(struct device *dev) {}
 static void em_debug_remove_pd(struct device *dev) {}
 #endif
 
+/* Compute the cost of each performance state. */
+static void em_compute_costs(struct device *dev, struct em_perf_state *table,
+			     int nr_states)
+{
+	unsigned long prev_cost = ULONG_MAX;
+	u64 fmax;
+	int i;
+
+	fmax = (u64) table[nr_states - 1].frequency;
+	for (i = nr_states - 1; i >= 0; i--) {
+		unsigned long power_res = em_scale_power(table[i].power);
+
+		table[i].cost = div64_u64(fmax * power_res,
+					  table[i].frequency);
+		if (table[i].cost >= prev_cost) {
+			dev_dbg(dev, "EM: OPP:%lu is inefficient\n",
+				table[i].frequency);
+		} else {
+			prev_cost = table[i].cost;
+		}
+	}
+}
+
 static int em_create_perf_table(struct device *dev, struct em_perf_domain *pd,
 				int nr_states, struct em_data_callback *cb)
 {
-	unsigned long power, freq, prev_freq = 0, prev_cost = ULONG_MAX;
+	unsigned long power, freq, prev_freq = 0;
 	struct em_perf_state *table;
 	int i, ret;
-	u64 fmax;
 
 	table = kcalloc(nr_states, sizeof(*table), GFP_KERNEL);
 	if (!table)
@@ -154,20 +215,7 @@ static int em_create_perf_table(struct device *dev, struct em_perf_domain *pd,
 		table[i].frequency = prev_freq = freq;
 	}
 
-	/* Compute the cost of each performance state. */
-	fmax = (u64) table[nr_states - 1].frequency;
-	for (i = nr_states - 1; i >= 0; i--) {
-		unsigned long power_res = em_scale_power(table[i].power);
-
-		table[i].cost = div64_u64(fmax * power_res,
-					  table[i].frequency);
-		if (table[i].cost >= prev_cost) {
-			dev_dbg(dev, "EM: OPP:%lu is inefficient\n",
-				table[i].frequency);
-		} else {
-			prev_cost = table[i].cost;
-		}
-	}
+	em_compute_costs(dev, table, nr_states);
 
 	pd->table = table;
 	pd->nr_perf_states = nr_states;
@@ -339,6 +387,71 @@ int em_dev_register_perf_domain(struct device *dev, unsigned int nr_states,
 }
 EXPORT_SYMBOL_GPL(em_dev_register_perf_domain);
 
+/**
+ * em_dev_update_perf_domain() - Replace the power values of a perf. domain
+ * @dev		: Device for which the EM is registered
+ * @power	: New power of each performance state, in ascending frequency
+ *		order, em_pd_nr_perf_states() entries
+ *
+ * Build a new table with the frequencies of the current one and the given
+ * power values, recompute the costs and publish it. This lets a thermal
+ * driver fold temperature dependent leakage into the EM once per temperature
+ * band change, instead of every EAS consumer correcting the power values on
+ * each energy computation. Readers under rcu_read_lock() see either the old
+ * or the new table; the old one is freed after a grace period, so this
+ * function may sleep.
+ *
+ * Callers that correct the registered values repeatedly should keep their own
+ * copy of the base power values to avoid compounding corrections.
+ *
+ * Return 0 on success
+ */
+int em_dev_update_perf_domain(struct device *dev, const unsigned long *power)
+{
+	struct em_perf_state *table, *old;
+	struct em_perf_domain *pd;
+	int i, nr_states;
+
+	if (IS_ERR_OR_NULL(dev) || !power)
+		return -EINVAL;
+
+	mutex_lock(&em_pd_mutex);
+
+	pd = dev->em_pd;
+	if (!pd) {
+		mutex_unlock(&em_pd_mutex);
+		return -EINVAL;
+	}
+
+	nr_states = pd->nr_perf_states;
+	table = kmemdup(pd->table, nr_states * sizeof(*table), GFP_KERNEL);
+	if (!table) {
+		mutex_unlock(&em_pd_mutex);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nr_states; i++) {
+		if (!power[i] || power[i] > EM_MAX_POWER) {
+			dev_err(dev, "EM: invalid power: %lu\n", power[i]);
+			mutex_unlock(&em_pd_mutex);
+			kfree(table);
+			return -EINVAL;
+		}
+		table[i].power = power[i];
+	}
+	em_compute_costs(dev, table, nr_states);
+
+	old = pd->table;
+	smp_store_release(&pd->table, table);
+	mutex_unlock(&em_pd_mutex);
+
+	synchronize_rcu();
+	kfree(old);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(em_dev_update_perf_domain);
+
 /**
  * em_dev_unregister_perf_domain() - Unregister Energy Model (EM) for a device
  * @dev		: Device for which the EM is registered
@@ -120,6 +120,34 @@ static ssize_t pm_async_store(struct kobject *kobj, struct kobj_attribute *attr,
 
 power_attr(pm_async);
 
+/*
+ * If nonzero, devices whose suspend plus resume callbacks took at least this
+ * many microseconds in the last transition, and that nothing but their parent
+ * depends on, are switched to asynchronous suspend/resume.
+ */
+unsigned int pm_async_promote_us;
+
+static ssize_t pm_async_promote_us_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", pm_async_promote_us);
+}
+
+static ssize_t pm_async_promote_us_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t n)
+{
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(pm_async_promote_us, val);
+	return n;
+}
+
+power_attr(pm_async_promote_us);
+
 #ifdef CONFIG_SUSPEND
 static ssize_t mem_sleep_show(struct kobject *kobj, struct kobj_attribute *attr,
 			      char *buf)
@@ -894,6 +922,7 @@ static struct attribute * g[] = {
 #endif
 #ifdef CONFIG_PM_SLEEP
 	&pm_async_attr.attr,
+	&pm_async_promote_us_attr.attr,
 	&wakeup_count_attr.attr,
 #ifdef CONFIG_SUSPEND
 	&mem_sleep_attr.attr,
@@ -34,6 +34,7 @@
 #include <linux/kernel.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/hash.h>
 
 #include <linux/uaccess.h>
 #include <linux/export.h>
@@ -43,11 +44,22 @@
 
 
 /*
- * locking rule: all changes to constraints or notifiers lists
- * or pm_qos_object list and pm_qos_objects need to happen with pm_qos_lock
- * held, taken with _irqsave.  One lock to rule them all
+ * locking rule: all changes to a constraints list or a flags set need to
+ * happen with its pm_qos_lock_for() lock held, taken with _irqsave.  The locks
+ * are hashed by list address, so that updates of unrelated lists (e.g. the
+ * frequency QoS of different cpufreq policies, or the CPU latency QoS) do not
+ * contend with each other.  Readers of the effective values never take them.
  */
-static DEFINE_SPINLOCK(pm_qos_lock);
+#define PM_QOS_LOCK_BITS	4
+
+static spinlock_t pm_qos_locks[1 << PM_QOS_LOCK_BITS] = {
+	[0 ... (1 << PM_QOS_LOCK_BITS) - 1] = __SPIN_LOCK_UNLOCKED(pm_qos_locks),
+};
+
+static spinlock_t *pm_qos_lock_for(void *list)
+{
+	return &pm_qos_locks[hash_ptr(list, PM_QOS_LOCK_BITS)];
+}
 
 /**
  * pm_qos_read_value - Return the current effective constraint value.
@@ -101,10 +113,11 @@ static void pm_qos_set_value(struct pm_qos_constraints *c, s32 value)
 int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
 			 enum pm_qos_req_action action, int value)
 {
+	spinlock_t *lock = pm_qos_lock_for(c);
 	int prev_value, curr_value, new_value;
 	unsigned long flags;
 
-	spin_lock_irqsave(&pm_qos_lock, flags);
+	spin_lock_irqsave(lock, flags);
 
 	prev_value = pm_qos_get_value(c);
 	if (value == PM_QOS_DEFAULT_VALUE)
@@ -135,7 +148,7 @@ int pm_qos_update_target(struct pm_qos_constraints *c, struct plist_node *node,
 	curr_value = pm_qos_get_value(c);
 	pm_qos_set_value(c, curr_value);
 
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 
 	trace_pm_qos_update_target(action, prev_value, curr_value);
 
@@ -178,10 +191,11 @@ bool pm_qos_update_flags(struct pm_qos_flags *pqf,
 			 struct pm_qos_flags_request *req,
 			 enum pm_qos_req_action action, s32 val)
 {
+	spinlock_t *lock = pm_qos_lock_for(pqf);
 	unsigned long irqflags;
 	s32 prev_value, curr_value;
 
-	spin_lock_irqsave(&pm_qos_lock, irqflags);
+	spin_lock_irqsave(lock, irqflags);
 
 	prev_value = list_empty(&pqf->list) ? 0 : pqf->effective_flags;
 
@@ -205,7 +219,7 @@ bool pm_qos_update_flags(struct pm_qos_flags *pqf,
 
 	curr_value = list_empty(&pqf->list) ? 0 : pqf->effective_flags;
 
-	spin_unlock_irqrestore(&pm_qos_lock, irqflags);
+	spin_unlock_irqrestore(lock, irqflags);
 
 	trace_pm_qos_update_flags(action, prev_value, curr_value);
 
@@ -365,15 +379,12 @@ static ssize_t cpu_latency_qos_read(struct file *filp, char __user *buf,
 				    size_t count, loff_t *f_pos)
 {
 	struct pm_qos_request *req = filp->private_data;
-	unsigned long flags;
 	s32 value;
 
 	if (!req || !cpu_latency_qos_request_active(req))
 		return -EINVAL;
 
-	spin_lock_irqsave(&pm_qos_lock, flags);
-	value = pm_qos_get_value(&cpu_latency_constraints);
-	spin_unlock_irqrestore(&pm_qos_lock, flags);
+	value = pm_qos_read_value(&cpu_latency_constraints);
 
 	return simple_read_from_buffer(buf, count, f_pos, &value, sizeof(s32));
 }
@@ -582,6 +593,86 @@ int freq_qos_update_request(struct freq_qos_request *req, s32 new_value)
 }
 EXPORT_SYMBOL_GPL(freq_qos_update_request);
 
+/**
+ * freq_qos_update_requests - Modify several frequency QoS requests at once.
+ * @reqs: Requests to modify, all of the same type and list.
+ * @values: New value of each request.
+ * @nr: Number of requests.
+ *
+ * Like calling freq_qos_update_request() for each request, but the list is
+ * locked, the effective value recomputed and the notifiers called only once.
+ * Meant for clients such as a perf HAL that move many requests together.
+ *
+ * Return 1 if the effective constraint value has changed, 0 if the effective
+ * constraint value has not changed, or a negative error code on failures.
+ */
+int freq_qos_update_requests(struct freq_qos_request **reqs,
+			     const s32 *values, unsigned int nr)
+{
+	struct pm_qos_constraints *c;
+	int prev_value, curr_value;
+	unsigned long flags;
+	spinlock_t *lock;
+	unsigned int i;
+
+	if (!reqs || !values || !nr)
+		return -EINVAL;
+
+	for (i = 0; i < nr; i++) {
+		if (WARN(!reqs[i] || !freq_qos_request_active(reqs[i]),
+			 "%s() called for unknown object\n", __func__))
+			return -EINVAL;
+		if (reqs[i]->qos != reqs[0]->qos ||
+		    reqs[i]->type != reqs[0]->type)
+			return -EINVAL;
+		trace_android_vh_freq_qos_update_request(reqs[i], values[i]);
+	}
+
+	switch (reqs[0]->type) {
+	case FREQ_QOS_MIN:
+		c = &reqs[0]->qos->min_freq;
+		break;
+	case FREQ_QOS_MAX:
+		c = &reqs[0]->qos->max_freq;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	lock = pm_qos_lock_for(c);
+	spin_lock_irqsave(lock, flags);
+
+	prev_value = pm_qos_get_value(c);
+	for (i = 0; i < nr; i++) {
+		struct plist_node *node = &reqs[i]->pnode;
+		s32 value = values[i];
+
+		if (value == PM_QOS_DEFAULT_VALUE)
+			value = c->default_value;
+		if (node->prio == value)
+			continue;
+
+		plist_del(node, &c->list);
+		plist_node_init(node, value);
+		plist_add(node, &c->list);
+	}
+	curr_value = pm_qos_get_value(c);
+	pm_qos_set_value(c, curr_value);
+
+	spin_unlock_irqrestore(lock, flags);
+
+	trace_pm_qos_update_target(PM_QOS_UPDATE_REQ, prev_value, curr_value);
+
+	if (prev_value == curr_value)
+		return 0;
+
+	if (c->notifiers)
+		blocking_notifier_call_chain(c->notifiers, curr_value, NULL);
+
+	return 1;
+}
+EXPORT_SYMBOL_GPL(freq_qos_update_requests);
+
 /**
  * freq_qos_remove_request - Remove frequency QoS request from its list.
  * @req: Request to remove.
@@ -25,6 +25,8 @@
 #include <linux/pm.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
 #include <linux/vmalloc.h>
 #include <linux/cpumask.h>
 #include <linux/atomic.h>
@@ -524,12 +526,79 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
 /* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+#define LZO_THREADS	8
 
 /* Minimum/maximum number of pages for read buffering. */
 #define LZO_MIN_RD_PAGES	1024
 #define LZO_MAX_RD_PAGES	8192
 
+/*
+ * The compressed stream framing (a size_t length followed by the data, padded
+ * to whole pages) and the worst case buffer sizes above are shared by all
+ * algorithms, the LZO bound being the largest of them.  The algorithm used is
+ * recorded in the image header flags, so the boot kernel needs no option to
+ * pick the right decompressor.
+ */
+enum hib_comp_alg {
+	HIB_COMP_LZO,
+	HIB_COMP_LZ4,
+	HIB_COMP_ZSTD,
+};
+
+static const char * const hib_comp_names[] = {
+	[HIB_COMP_LZO]	= "lzo",
+	[HIB_COMP_LZ4]	= "lz4",
+	[HIB_COMP_ZSTD]	= "zstd",
+};
+
+#define HIB_ZSTD_LEVEL	1
+
+static enum hib_comp_alg hib_comp_alg;
+
+static int __init hib_compression_setup(char *str)
+{
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) && !strcmp(str, "lz4"))
+		hib_comp_alg = HIB_COMP_LZ4;
+	else if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+		 !strcmp(str, "zstd"))
+		hib_comp_alg = HIB_COMP_ZSTD;
+	else if (!strcmp(str, "lzo"))
+		hib_comp_alg = HIB_COMP_LZO;
+	else
+		pr_warn("Unsupported compression '%s', using %s\n", str,
+			hib_comp_names[hib_comp_alg]);
+	return 1;
+}
+__setup("hib_compression=", hib_compression_setup);
+
+static unsigned int hib_comp_flags(enum hib_comp_alg alg)
+{
+	switch (alg) {
+	case HIB_COMP_LZ4:
+		return SF_COMP_LZ4;
+	case HIB_COMP_ZSTD:
+		return SF_COMP_ZSTD;
+	default:
+		return 0;
+	}
+}
+
+static int hib_comp_from_flags(unsigned int flags, enum hib_comp_alg *alg)
+{
+	if (flags & SF_COMP_LZ4) {
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4))
+			return -EINVAL;
+		*alg = HIB_COMP_LZ4;
+	} else if (flags & SF_COMP_ZSTD) {
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD))
+			return -EINVAL;
+		*alg = HIB_COMP_ZSTD;
+	} else {
+		*alg = HIB_COMP_LZO;
+	}
+	return 0;
+}
+
 
 /**
  *	save_image - save the suspend image data
@@ -622,7 +691,7 @@ static int crc32_threadfn(void *data)
 	return 0;
 }
 /**
- * Structure used for LZO data compression.
+ * Structure used for image data compression.
  */
 struct cmp_data {
 	struct task_struct *thr;                  /* thread */
@@ -635,13 +704,75 @@ struct cmp_data {
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
-	unsigned char wrk[LZO1X_1_MEM_COMPRESS];  /* compression workspace */
+	enum hib_comp_alg alg;                    /* compression algorithm */
+	void *wrk;                                /* compression workspace */
+	void *ctx;                                /* zstd compression context */
 };
 
+static int cmp_data_init(struct cmp_data *d, enum hib_comp_alg alg)
+{
+	size_t size = LZO1X_1_MEM_COMPRESS;
+	ZSTD_parameters params;
+
+	d->alg = alg;
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) && alg == HIB_COMP_LZ4) {
+		size = LZ4_MEM_COMPRESS;
+	} else if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) &&
+		   alg == HIB_COMP_ZSTD) {
+		params = ZSTD_getParams(HIB_ZSTD_LEVEL, LZO_UNC_SIZE, 0);
+		size = ZSTD_CCtxWorkspaceBound(params.cParams);
+	}
+
+	d->wrk = vmalloc(size);
+	if (!d->wrk)
+		return -ENOMEM;
+
+	if (IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) && alg == HIB_COMP_ZSTD) {
+		d->ctx = ZSTD_initCCtx(d->wrk, size);
+		if (!d->ctx)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static int hib_compress(struct cmp_data *d)
+{
+	unsigned char *dst = d->cmp + LZO_HEADER;
+	size_t len;
+	int ret;
+
+	/* IS_ENABLED() lets the compiler drop calls into libraries not built */
+	switch (d->alg) {
+	case HIB_COMP_LZ4:
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4))
+			return -EINVAL;
+		ret = LZ4_compress_default(d->unc, dst, d->unc_len,
+					   LZO_CMP_SIZE - LZO_HEADER, d->wrk);
+		if (ret <= 0)
+			return -1;
+		d->cmp_len = ret;
+		return 0;
+	case HIB_COMP_ZSTD:
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD))
+			return -EINVAL;
+		len = ZSTD_compressCCtx(d->ctx, dst, LZO_CMP_SIZE - LZO_HEADER,
+					d->unc, d->unc_len,
+					ZSTD_getParams(HIB_ZSTD_LEVEL,
+						       LZO_UNC_SIZE, 0));
+		if (ZSTD_isError(len))
+			return -1;
+		d->cmp_len = len;
+		return 0;
+	default:
+		return lzo1x_1_compress(d->unc, d->unc_len, dst, &d->cmp_len,
+					d->wrk);
+	}
+}
+
 /**
  * Compression function that runs in its own thread.
  */
-static int lzo_compress_threadfn(void *data)
+static int compress_threadfn(void *data)
 {
 	struct cmp_data *d = data;
 
@@ -657,9 +788,7 @@ static int lzo_compress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
-		                          d->cmp + LZO_HEADER, &d->cmp_len,
-		                          d->wrk);
+		d->ret = hib_compress(d);
 		atomic_set(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -667,14 +796,16 @@ static int lzo_compress_threadfn(void *data)
 }
 
 /**
- * save_image_lzo - Save the suspend image data compressed with LZO.
+ * save_compressed_image - Save the suspend image data compressed.
  * @handle: Swap map handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ * @alg: Compression algorithm to use.
  */
-static int save_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_write)
+static int save_compressed_image(struct swap_map_handle *handle,
+				 struct snapshot_handle *snapshot,
+				 unsigned int nr_to_write,
+				 enum hib_comp_alg alg)
 {
 	unsigned int m;
 	int ret = 0;
@@ -711,8 +842,18 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		ret = -ENOMEM;
 		goto out_clean;
 	}
-	for (thr = 0; thr < nr_threads; thr++)
+	for (thr = 0; thr < nr_threads; thr++) {
 		memset(&data[thr], 0, offsetof(struct cmp_data, go));
+		data[thr].wrk = NULL;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		ret = cmp_data_init(&data[thr], alg);
+		if (ret) {
+			pr_err("Failed to set up %s compression\n",
+			       hib_comp_names[alg]);
+			goto out_clean;
+		}
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -729,7 +870,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_compress_threadfn,
+		data[thr].thr = kthread_run(compress_threadfn,
 		                            &data[thr],
 		                            "image_compress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -767,7 +908,8 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	 */
 	handle->reqd_free_pages = reqd_free_pages();
 
-	pr_info("Using %u thread(s) for compression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s compression\n", nr_threads,
+		hib_comp_names[alg]);
 	pr_info("Compressing and saving image data (%u pages)...\n",
 		nr_to_write);
 	m = nr_to_write / 10;
@@ -817,14 +959,16 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO compression failed\n");
+				pr_err("%s compression failed\n",
+				       hib_comp_names[alg]);
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
 			             lzo1x_worst_compress(data[thr].unc_len))) {
-				pr_err("Invalid LZO compressed length\n");
+				pr_err("Invalid %s compressed length\n",
+				       hib_comp_names[alg]);
 				ret = -1;
 				goto out_finish;
 			}
@@ -870,9 +1014,11 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			vfree(data[thr].wrk);
+		}
 		vfree(data);
 	}
 	if (page) free_page((unsigned long)page);
@@ -922,6 +1068,8 @@ int swsusp_write(unsigned int flags)
 		pr_err("Cannot get swap writer\n");
 		return error;
 	}
+	if (!(flags & SF_NOCOMPRESS_MODE))
+		flags |= hib_comp_flags(hib_comp_alg);
 	if (flags & SF_NOCOMPRESS_MODE) {
 		if (!enough_swap(pages)) {
 			pr_err("Not enough free swap\n");
@@ -942,7 +1090,8 @@ int swsusp_write(unsigned int flags)
 	if (!error) {
 		error = (flags & SF_NOCOMPRESS_MODE) ?
 			save_image(&handle, &snapshot, pages - 1) :
-			save_image_lzo(&handle, &snapshot, pages - 1);
+			save_compressed_image(&handle, &snapshot, pages - 1,
+					      hib_comp_alg);
 	}
 out_finish:
 	error = swap_writer_finish(&handle, flags, error);
@@ -1109,7 +1258,7 @@ static int load_image(struct swap_map_handle *handle,
 }
 
 /**
- * Structure used for LZO data decompression.
+ * Structure used for image data decompression.
  */
 struct dec_data {
 	struct task_struct *thr;                  /* thread */
@@ -1122,12 +1271,63 @@ struct dec_data {
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
+	enum hib_comp_alg alg;                    /* compression algorithm */
+	void *wrk;                                /* zstd workspace */
+	void *ctx;                                /* zstd decompression context */
 };
 
+static int dec_data_init(struct dec_data *d, enum hib_comp_alg alg)
+{
+	size_t size;
+
+	d->alg = alg;
+	if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD) || alg != HIB_COMP_ZSTD)
+		return 0;
+
+	size = ZSTD_DCtxWorkspaceBound();
+	d->wrk = vmalloc(size);
+	if (!d->wrk)
+		return -ENOMEM;
+	d->ctx = ZSTD_initDCtx(d->wrk, size);
+	return d->ctx ? 0 : -EINVAL;
+}
+
+static int hib_decompress(struct dec_data *d)
+{
+	const unsigned char *src = d->cmp + LZO_HEADER;
+	size_t len;
+	int ret;
+
+	switch (d->alg) {
+	case HIB_COMP_LZ4:
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4))
+			return -EINVAL;
+		ret = LZ4_decompress_safe(src, d->unc, d->cmp_len,
+					  LZO_UNC_SIZE);
+		if (ret < 0)
+			return -1;
+		d->unc_len = ret;
+		return 0;
+	case HIB_COMP_ZSTD:
+		if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_ZSTD))
+			return -EINVAL;
+		len = ZSTD_decompressDCtx(d->ctx, d->unc, LZO_UNC_SIZE, src,
+					  d->cmp_len);
+		if (ZSTD_isError(len))
+			return -1;
+		d->unc_len = len;
+		return 0;
+	default:
+		d->unc_len = LZO_UNC_SIZE;
+		return lzo1x_decompress_safe(src, d->cmp_len, d->unc,
+					     &d->unc_len);
+	}
+}
+
 /**
  * Deompression function that runs in its own thread.
  */
-static int lzo_decompress_threadfn(void *data)
+static int decompress_threadfn(void *data)
 {
 	struct dec_data *d = data;
 
@@ -1143,9 +1343,7 @@ static int lzo_decompress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->unc_len = LZO_UNC_SIZE;
-		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
-		                               d->unc, &d->unc_len);
+		d->ret = hib_decompress(d);
 		if (clean_pages_on_decompress)
 			flush_icache_range((unsigned long)d->unc,
 					   (unsigned long)d->unc + d->unc_len);
@@ -1157,14 +1355,16 @@ static int lzo_decompress_threadfn(void *data)
 }
 
 /**
- * load_image_lzo - Load compressed image data and decompress them with LZO.
+ * load_compressed_image - Load compressed image data and decompress them.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ * @alg: Compression algorithm the image was written with.
  */
-static int load_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_read)
+static int load_compressed_image(struct swap_map_handle *handle,
+				 struct snapshot_handle *snapshot,
+				 unsigned int nr_to_read,
+				 enum hib_comp_alg alg)
 {
 	unsigned int m;
 	int ret = 0;
@@ -1204,8 +1404,18 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		ret = -ENOMEM;
 		goto out_clean;
 	}
-	for (thr = 0; thr < nr_threads; thr++)
+	for (thr = 0; thr < nr_threads; thr++) {
 		memset(&data[thr], 0, offsetof(struct dec_data, go));
+		data[thr].wrk = NULL;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		ret = dec_data_init(&data[thr], alg);
+		if (ret) {
+			pr_err("Failed to set up %s decompression\n",
+			       hib_comp_names[alg]);
+			goto out_clean;
+		}
+	}
 
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
@@ -1224,7 +1434,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_decompress_threadfn,
+		data[thr].thr = kthread_run(decompress_threadfn,
 		                            &data[thr],
 		                            "image_decompress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -1286,7 +1496,8 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	}
 	want = ring_size = i;
 
-	pr_info("Using %u thread(s) for decompression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s decompression\n", nr_threads,
+		hib_comp_names[alg]);
 	pr_info("Loading and decompressing image data (%u pages)...\n",
 		nr_to_read);
 	m = nr_to_read / 10;
@@ -1399,7 +1610,8 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO decompression failed\n");
+				pr_err("%s decompression failed\n",
+				       hib_comp_names[alg]);
 				goto out_finish;
 			}
 
@@ -1467,9 +1679,11 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			vfree(data[thr].wrk);
+		}
 		vfree(data);
 	}
 	vfree(page);
@@ -1489,6 +1703,7 @@ int swsusp_read(unsigned int *flags_p)
 	struct swap_map_handle handle;
 	struct snapshot_handle snapshot;
 	struct swsusp_info *header;
+	enum hib_comp_alg alg = HIB_COMP_LZO;
 
 	memset(&snapshot, 0, sizeof(struct snapshot_handle));
 	error = snapshot_write_next(&snapshot);
@@ -1500,10 +1715,16 @@ int swsusp_read(unsigned int *flags_p)
 		goto end;
 	if (!error)
 		error = swap_read_page(&handle, header, NULL);
+	if (!error && !(*flags_p & SF_NOCOMPRESS_MODE)) {
+		error = hib_comp_from_flags(*flags_p, &alg);
+		if (error)
+			pr_err("Image compressed with an unsupported algorithm\n");
+	}
 	if (!error) {
 		error = (*flags_p & SF_NOCOMPRESS_MODE) ?
 			load_image(&handle, &snapshot, header->pages - 1) :
-			load_image_lzo(&handle, &snapshot, header->pages - 1);
+			load_compressed_image(&handle, &snapshot,
+					      header->pages - 1, alg);
 	}
 	swap_reader_finish(&handle);
 end:
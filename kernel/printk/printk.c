@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -395,6 +396,31 @@ DEFINE_RAW_SPINLOCK(logbuf_lock);
 		printk_safe_exit_irqrestore(flags);	\
 	} while (0)
 
+/*
+ * Console kthreads. Once they run, every console is written by its own
+ * thread from its own position (console->printk_seq) in the ringbuffer, so
+ * a slow console no longer stalls printk() callers. Consoles without a
+ * thread are still written by console_unlock().
+ */
+static bool printk_console_kthreads = true;
+module_param_named(console_kthreads, printk_console_kthreads, bool, S_IRUGO);
+MODULE_PARM_DESC(console_kthreads, "write consoles from per-console threads");
+
+static bool printk_kthreads_running;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+
+/*
+ * Whether all consoles must be written synchronously by console_unlock():
+ * before the console threads run, and whenever their scheduling can not be
+ * relied on (oops, panic, reboot and power off).
+ */
+static bool printk_console_sync(void)
+{
+	return !READ_ONCE(printk_kthreads_running) || oops_in_progress ||
+	       atomic_read(&panic_cpu) != PANIC_CPU_INVALID ||
+	       system_state > SYSTEM_RUNNING;
+}
+
 #ifdef CONFIG_PRINTK
 DECLARE_WAIT_QUEUE_HEAD(log_wait);
 /* the next printk record to read by syslog(READ) or /proc/kmsg */
@@ -1911,12 +1937,13 @@ static int console_trylock_spinning(void)
  * log_buf[start] to log_buf[end - 1].
  * The console_lock must be held.
  */
-static void call_console_drivers(const char *ext_text, size_t ext_len,
+static void call_console_drivers(u64 seq, const char *ext_text, size_t ext_len,
 				 const char *text, size_t len)
 {
 	static char dropped_text[64];
 	size_t dropped_len = 0;
 	struct console *con;
+	bool sync = printk_console_sync();
 
 #ifdef CONFIG_MTK_PRINTK_DEBUG
 	unsigned long interval_con_write = 0;
@@ -1943,6 +1970,10 @@ static void call_console_drivers(const char *ext_text, size_t ext_len,
 		if (!cpu_online(smp_processor_id()) &&
 		    !(con->flags & CON_ANYTIME))
 			continue;
+		/* Left to the console thread, or already written by it */
+		if ((con->thread && !sync) || seq < con->printk_seq)
+			continue;
+		con->printk_seq = seq + 1;
 		if (con->flags & CON_EXTENDED)
 			con->write(con, ext_text, ext_len);
 		else {
@@ -2213,6 +2244,7 @@ EXPORT_SYMBOL(printk);
 
 #define prb_read_valid(rb, seq, r)	false
 #define prb_first_valid_seq(rb)		0
+#define prb_next_seq(rb)		0
 
 static u64 syslog_seq;
 static u64 console_seq;
@@ -2234,7 +2266,7 @@ static ssize_t msg_print_ext_body(char *buf, size_t size,
 				  struct dev_printk_info *dev_info) { return 0; }
 static void console_lock_spinning_enable(void) { }
 static int console_lock_spinning_disable_and_check(void) { return 0; }
-static void call_console_drivers(const char *ext_text, size_t ext_len,
+static void call_console_drivers(u64 seq, const char *ext_text, size_t ext_len,
 				 const char *text, size_t len) {}
 static bool suppress_message_printing(int level) { return false; }
 
@@ -2412,6 +2444,7 @@ void resume_console(void)
 	down_console_sem();
 	console_suspended = 0;
 	console_unlock();
+	wake_up_interruptible(&printk_kthread_wait);
 }
 
 /**
@@ -2515,6 +2548,40 @@ static inline int can_use_console(void)
 	return cpu_online(raw_smp_processor_id()) || have_callable_console();
 }
 
+/*
+ * Whether some enabled console has no thread and has to be written by
+ * console_unlock(). The console_lock must be held.
+ */
+static bool printk_unthreaded_consoles(void)
+{
+	struct console *con;
+
+	for_each_console(con) {
+		if ((con->flags & CON_ENABLED) && con->write && !con->thread)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * The oldest record some console thread still has to write, which is where
+ * console_unlock() has to start from once it writes synchronously again.
+ * The console_lock must be held.
+ */
+static u64 printk_kthreads_seq(void)
+{
+	struct console *con;
+	u64 seq = U64_MAX;
+
+	for_each_console(con) {
+		if (con->thread)
+			seq = min(seq, con->printk_seq);
+	}
+
+	return seq;
+}
+
 /**
  * console_unlock - unlock the console system
  *
@@ -2537,6 +2604,7 @@ void console_unlock(void)
 	bool do_cond_resched, retry;
 	struct printk_info info;
 	struct printk_record r;
+	u64 seq;
 
 #ifdef CONFIG_MTK_PRINTK_DEBUG
 	u64 con_dura_time = local_clock();
@@ -2583,6 +2651,25 @@ void console_unlock(void)
 		return;
 	}
 
+	if (printk_console_sync()) {
+		/*
+		 * Pick up whatever the console threads did not get to yet.
+		 * Records a console already wrote are skipped by
+		 * call_console_drivers().
+		 */
+		logbuf_lock_irqsave(flags);
+		console_seq = min(console_seq, printk_kthreads_seq());
+		logbuf_unlock_irqrestore(flags);
+	} else if (!printk_unthreaded_consoles()) {
+		/* Nothing to do here while the console threads write everything. */
+		logbuf_lock_irqsave(flags);
+		console_seq = max(console_seq, printk_kthreads_seq());
+		logbuf_unlock_irqrestore(flags);
+		console_locked = 0;
+		up_console_sem();
+		return;
+	}
+
 	for (;;) {
 		size_t ext_len = 0;
 		size_t len;
@@ -2668,7 +2755,7 @@ void console_unlock(void)
 		len = record_print_text(&r,
 				console_msg_format & MSG_FORMAT_SYSLOG,
 				printk_time);
-		console_seq++;
+		seq = console_seq++;
 		raw_spin_unlock(&logbuf_lock);
 
 		/*
@@ -2680,7 +2767,7 @@ void console_unlock(void)
 		console_lock_spinning_enable();
 
 		stop_critical_timings();	/* don't trace print latency */
-		call_console_drivers(ext_text, ext_len, text, len);
+		call_console_drivers(seq, ext_text, ext_len, text, len);
 		start_critical_timings();
 
 		if (console_lock_spinning_disable_and_check()) {
@@ -2716,6 +2803,155 @@ void console_unlock(void)
 }
 EXPORT_SYMBOL(console_unlock);
 
+static bool printk_kthread_should_wake(struct console *con)
+{
+	bool ret;
+
+	if (kthread_should_stop())
+		return true;
+	if (console_suspended || printk_console_sync() ||
+	    !(con->flags & CON_ENABLED))
+		return false;
+
+	raw_spin_lock_irq(&logbuf_lock);
+	ret = prb_read_valid(prb, READ_ONCE(con->printk_seq), NULL);
+	raw_spin_unlock_irq(&logbuf_lock);
+
+	return ret;
+}
+
+/*
+ * Console thread: writes the records of one console, one at a time and
+ * under console_lock, so console drivers still see the usual serialization
+ * against each other and against console_lock() users. Falls back to
+ * waiting whenever printing has to be done synchronously again.
+ */
+static int printk_kthread_func(void *data)
+{
+	struct console *con = data;
+	unsigned long dropped = 0;
+	char *dropped_text = NULL;
+	char *ext_text = NULL;
+	char *text = NULL;
+	struct printk_info info;
+	struct printk_record r;
+	unsigned long flags;
+	size_t dropped_len;
+	size_t ext_len;
+	size_t len;
+
+	text = kmalloc(LOG_LINE_MAX + PREFIX_MAX, GFP_KERNEL);
+	dropped_text = kmalloc(64, GFP_KERNEL);
+	if (con->flags & CON_EXTENDED)
+		ext_text = kmalloc(CONSOLE_EXT_LOG_MAX, GFP_KERNEL);
+	if (!text || !dropped_text ||
+	    ((con->flags & CON_EXTENDED) && !ext_text))
+		goto out;
+
+	prb_rec_init_rd(&r, &info, text, LOG_LINE_MAX + PREFIX_MAX);
+
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 printk_kthread_should_wake(con));
+		if (kthread_should_stop())
+			break;
+
+		console_lock();
+		if (console_suspended) {
+			up_console_sem();
+			continue;
+		}
+		if (!(con->flags & CON_ENABLED) || exclusive_console ||
+		    printk_console_sync()) {
+			console_unlock();
+			continue;
+		}
+
+		ext_len = 0;
+		dropped_len = 0;
+
+		printk_safe_enter_irqsave(flags);
+		raw_spin_lock(&logbuf_lock);
+		if (!prb_read_valid(prb, con->printk_seq, &r)) {
+			raw_spin_unlock(&logbuf_lock);
+			printk_safe_exit_irqrestore(flags);
+			goto unlock;
+		}
+		if (con->printk_seq != r.info->seq)
+			dropped += r.info->seq - con->printk_seq;
+		WRITE_ONCE(con->printk_seq, r.info->seq + 1);
+
+		if (suppress_message_printing(r.info->level)) {
+			raw_spin_unlock(&logbuf_lock);
+			printk_safe_exit_irqrestore(flags);
+			goto unlock;
+		}
+
+		if (ext_text) {
+			ext_len = info_print_ext_header(ext_text,
+						CONSOLE_EXT_LOG_MAX, r.info);
+			ext_len += msg_print_ext_body(ext_text + ext_len,
+						CONSOLE_EXT_LOG_MAX - ext_len,
+						&r.text_buf[0],
+						r.info->text_len,
+						&r.info->dev_info);
+		}
+		len = record_print_text(&r,
+				console_msg_format & MSG_FORMAT_SYSLOG,
+				printk_time);
+		raw_spin_unlock(&logbuf_lock);
+
+		if (dropped && !ext_text) {
+			dropped_len = snprintf(dropped_text, 64,
+					       "** %lu printk messages dropped **\n",
+					       dropped);
+			dropped = 0;
+		}
+
+		stop_critical_timings();	/* don't trace print latency */
+		if (ext_text) {
+			con->write(con, ext_text, ext_len);
+		} else {
+			if (dropped_len)
+				con->write(con, dropped_text, dropped_len);
+			con->write(con, text, len);
+		}
+		start_critical_timings();
+		printk_safe_exit_irqrestore(flags);
+unlock:
+		/*
+		 * Plain release: console_unlock() would go on and flush the
+		 * unthreaded consoles from this thread.
+		 */
+		console_locked = 0;
+		up_console_sem();
+		cond_resched();
+	}
+out:
+	kfree(ext_text);
+	kfree(dropped_text);
+	kfree(text);
+	return 0;
+}
+
+/* The console_lock must be held. */
+static void printk_start_kthread(struct console *con)
+{
+	struct task_struct *thread;
+
+	if (con->thread || !con->write)
+		return;
+
+	thread = kthread_run(printk_kthread_func, con, "pr/%s%d",
+			     con->name, con->index);
+	if (IS_ERR(thread)) {
+		pr_err("%s%d: failed to start printing thread\n",
+		       con->name, con->index);
+		return;
+	}
+	con->thread = thread;
+}
+
 /**
  * console_conditional_schedule - yield the CPU if required
  *
@@ -2773,10 +3009,13 @@ void console_flush_on_panic(enum con_flush_mode mode)
 	console_may_schedule = 0;
 
 	if (mode == CONSOLE_REPLAY_ALL) {
+		struct console *c;
 		unsigned long flags;
 
 		logbuf_lock_irqsave(flags);
 		console_seq = prb_first_valid_seq(prb);
+		for_each_console(c)
+			c->printk_seq = console_seq;
 		logbuf_unlock_irqrestore(flags);
 	}
 	console_unlock();
@@ -3007,6 +3246,7 @@ void register_console(struct console *newcon)
 		 * for us.
 		 */
 		logbuf_lock_irqsave(flags);
+		newcon->printk_seq = syslog_seq;
 		/*
 		 * We're about to replay the log buffer.  Only do this to the
 		 * just-registered console to avoid excessive message spam to
@@ -3015,12 +3255,22 @@ void register_console(struct console *newcon)
 		 * Set exclusive_console with disabled interrupts to reduce
 		 * race window with eventual console_flush_on_panic() that
 		 * ignores console_lock.
+		 *
+		 * With console threads, the thread of the new console does
+		 * the replay on its own.
 		 */
-		exclusive_console = newcon;
-		exclusive_console_stop_seq = console_seq;
-		console_seq = syslog_seq;
+		if (!printk_kthreads_running) {
+			exclusive_console = newcon;
+			exclusive_console_stop_seq = console_seq;
+			console_seq = syslog_seq;
+		}
 		logbuf_unlock_irqrestore(flags);
+	} else {
+		newcon->printk_seq = printk_kthreads_running ?
+				     prb_next_seq(prb) : console_seq;
 	}
+	if (printk_kthreads_running)
+		printk_start_kthread(newcon);
 	console_unlock();
 	console_sysfs_notify();
 
@@ -3102,6 +3352,11 @@ int unregister_console(struct console *console)
 	console_unlock();
 	console_sysfs_notify();
 
+	if (console->thread) {
+		kthread_stop(console->thread);
+		console->thread = NULL;
+	}
+
 	if (console->exit)
 		res = console->exit(console);
 
@@ -3190,6 +3445,18 @@ static int __init printk_late_init(void)
 	ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "printk:online",
 					console_cpu_notify, NULL);
 	WARN_ON(ret < 0);
+
+	if (printk_console_kthreads) {
+		console_lock();
+		for_each_console(con) {
+			/* console_unlock() has written everything up to here */
+			con->printk_seq = max(con->printk_seq, console_seq);
+			printk_start_kthread(con);
+		}
+		WRITE_ONCE(printk_kthreads_running, true);
+		console_unlock();
+		wake_up_interruptible(&printk_kthread_wait);
+	}
 	return 0;
 }
 late_initcall(printk_late_init);
@@ -3240,8 +3507,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	t1 = local_clock();
 #endif
 
-	if (pending & PRINTK_PENDING_WAKEUP)
+	if (pending & PRINTK_PENDING_WAKEUP) {
 		wake_up_interruptible(&log_wait);
+		wake_up_interruptible(&printk_kthread_wait);
+	}
 #ifdef CONFIG_MTK_PRINTK_DEBUG
 	t2 = local_clock();
 	if (t2 - t0 > 1000000) {
@@ -3263,7 +3532,9 @@ void wake_up_klogd(void)
 		return;
 
 	preempt_disable();
-	if (waitqueue_active(&log_wait)) {
+	if (waitqueue_active(&log_wait) ||
+	    (READ_ONCE(printk_kthreads_running) &&
+	     wq_has_sleeper(&printk_kthread_wait))) {
 		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 		irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
 	}
@@ -3677,7 +3677,7 @@ void synchronize_rcu(void)
 	if (rcu_blocking_is_gp())
 		return;
 	if (rcu_gp_is_expedited())
-		synchronize_rcu_expedited();
+		rcu_exp_sync(_RET_IP_);
 	else
 		wait_rcu_gp(call_rcu);
 }
@@ -7,6 +7,7 @@
  * Authors: Paul E. McKenney <paulmck@linux.ibm.com>
  */
 
+#include <linux/hash.h>
 #include <linux/lockdep.h>
 
 static void rcu_exp_handler(void *unused);
@@ -791,6 +792,116 @@ static int rcu_print_task_exp_stall(struct rcu_node *rnp)
 
 #endif /* #else #ifdef CONFIG_PREEMPT_RCU */
 
+/*
+ * Per-caller accounting of expedited grace-period requests.  Each
+ * distinct return address gets a slot in a small open-addressed table;
+ * once the table is full, further callers go uncounted.  Writing
+ * anything to rcutree.exp_callers clears the table.
+ */
+#define RCU_EXP_CALLERS	64
+
+struct rcu_exp_caller {
+	unsigned long ip;
+	unsigned long count;
+	unsigned long coalesced;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+static struct rcu_exp_caller rcu_exp_callers[RCU_EXP_CALLERS];
+static DEFINE_RAW_SPINLOCK(rcu_exp_callers_lock);
+
+static void rcu_exp_account(unsigned long ip, u64 start, bool coalesced)
+{
+	u64 delta = ktime_get_mono_fast_ns() - start;
+	struct rcu_exp_caller *ec;
+	unsigned long flags;
+	int i, n;
+
+	raw_spin_lock_irqsave(&rcu_exp_callers_lock, flags);
+	i = hash_long(ip, ilog2(RCU_EXP_CALLERS));
+	for (n = 0; n < RCU_EXP_CALLERS; n++, i = (i + 1) % RCU_EXP_CALLERS) {
+		ec = &rcu_exp_callers[i];
+		if (!ec->ip)
+			ec->ip = ip;
+		if (ec->ip != ip)
+			continue;
+		ec->count++;
+		if (coalesced)
+			ec->coalesced++;
+		ec->total_ns += delta;
+		if (delta > ec->max_ns)
+			ec->max_ns = delta;
+		break;
+	}
+	raw_spin_unlock_irqrestore(&rcu_exp_callers_lock, flags);
+}
+
+static int param_get_exp_callers(char *buf, const struct kernel_param *kp)
+{
+	struct rcu_exp_caller ec;
+	unsigned long flags;
+	int i, len = 0;
+
+	for (i = 0; i < RCU_EXP_CALLERS; i++) {
+		raw_spin_lock_irqsave(&rcu_exp_callers_lock, flags);
+		ec = rcu_exp_callers[i];
+		raw_spin_unlock_irqrestore(&rcu_exp_callers_lock, flags);
+		if (!ec.ip || !ec.count)
+			continue;
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%pS count=%lu coalesced=%lu avg_us=%llu max_us=%llu\n",
+				 (void *)ec.ip, ec.count, ec.coalesced,
+				 div64_u64(ec.total_ns, ec.count * NSEC_PER_USEC),
+				 div64_u64(ec.max_ns, NSEC_PER_USEC));
+	}
+	return len;
+}
+
+static int param_set_exp_callers(const char *val, const struct kernel_param *kp)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&rcu_exp_callers_lock, flags);
+	memset(rcu_exp_callers, 0, sizeof(rcu_exp_callers));
+	raw_spin_unlock_irqrestore(&rcu_exp_callers_lock, flags);
+	return 0;
+}
+
+static const struct kernel_param_ops exp_callers_ops = {
+	.set = param_set_exp_callers,
+	.get = param_get_exp_callers,
+};
+
+module_param_cb(exp_callers, &exp_callers_ops, NULL, 0644);
+
+/*
+ * If non-zero, hold off the start of a new expedited grace period until
+ * at least this many microseconds have passed since the previous one
+ * ended.  Requests that arrive in the meantime snapshot the same sequence
+ * number and are satisfied by the delayed grace period, so a burst of
+ * synchronize_rcu_expedited() callers costs one round of IPIs instead of
+ * one per caller.
+ */
+static int rcu_exp_coalesce_us;
+module_param(rcu_exp_coalesce_us, int, 0644);
+
+static u64 rcu_exp_last_end;
+
+static void rcu_exp_coalesce(void)
+{
+	int us = READ_ONCE(rcu_exp_coalesce_us);
+	u64 since;
+
+	if (us <= 0)
+		return;
+	since = ktime_get_mono_fast_ns() - READ_ONCE(rcu_exp_last_end);
+	if (since >= (u64)us * NSEC_PER_USEC)
+		return;
+	us -= div64_u64(since, NSEC_PER_USEC);
+	usleep_range(us, us + us / 4 + 1);
+}
+
 /**
  * synchronize_rcu_expedited - Brute-force RCU grace period
  *
@@ -812,11 +923,22 @@ static int rcu_print_task_exp_stall(struct rcu_node *rnp)
  * This has the same semantics as (but is more brutal than) synchronize_rcu().
  */
 void synchronize_rcu_expedited(void)
+{
+	rcu_exp_sync(_RET_IP_);
+}
+EXPORT_SYMBOL_GPL(synchronize_rcu_expedited);
+
+/*
+ * Body of synchronize_rcu_expedited(), also used directly by
+ * synchronize_rcu() so that the original caller is the one accounted.
+ */
+static void rcu_exp_sync(unsigned long caller)
 {
 	bool no_wq;
 	struct rcu_exp_work rew;
 	struct rcu_node *rnp;
 	unsigned long s;
+	u64 start;
 
 	RCU_LOCKDEP_WARN(lock_is_held(&rcu_bh_lock_map) ||
 			 lock_is_held(&rcu_lock_map) ||
@@ -834,9 +956,12 @@ void synchronize_rcu_expedited(void)
 	}
 
 	/* Take a snapshot of the sequence number.  */
+	start = ktime_get_mono_fast_ns();
 	s = rcu_exp_gp_seq_snap();
-	if (exp_funnel_lock(s))
+	if (exp_funnel_lock(s)) {
+		rcu_exp_account(caller, start, true);
 		return;  /* Someone else did our work for us. */
+	}
 
 	/* Don't use workqueue during boot or from an incoming CPU. */
 	preempt_disable();
@@ -844,6 +969,10 @@ void synchronize_rcu_expedited(void)
 		!cpumask_test_cpu(smp_processor_id(), cpu_active_mask);
 	preempt_enable();
 
+	/* Give other requesters a chance to pile onto this grace period. */
+	if (likely(!no_wq))
+		rcu_exp_coalesce();
+
 	/* Ensure that load happens before action based on it. */
 	if (unlikely(no_wq)) {
 		/* Direct call for scheduler init, early_initcall()s, and incoming CPUs. */
@@ -860,11 +989,12 @@ void synchronize_rcu_expedited(void)
 	wait_event(rnp->exp_wq[rcu_seq_ctr(s) & 0x3],
 		   sync_exp_work_done(s));
 	smp_mb(); /* Workqueue actions happen before return. */
+	WRITE_ONCE(rcu_exp_last_end, ktime_get_mono_fast_ns());
 
 	/* Let the next expedited grace period start. */
 	mutex_unlock(&rcu_state.exp_mutex);
 
 	if (likely(!no_wq))
 		destroy_work_on_stack(&rew.rew_work);
+	rcu_exp_account(caller, start, false);
 }
-EXPORT_SYMBOL_GPL(synchronize_rcu_expedited);
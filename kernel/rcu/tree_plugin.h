@@ -11,11 +11,13 @@
  *	   Paul E. McKenney <paulmck@linux.ibm.com>
  */
 
+#include <linux/sched/topology.h>
 #include "../locking/rtmutex_common.h"
 
 #ifdef CONFIG_RCU_NOCB_CPU
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
+static bool __read_mostly rcu_nocb_asym;    /* Offload to low-capacity CPUs. */
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 /*
@@ -1489,6 +1491,44 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+/*
+ * On asymmetric (big.LITTLE) systems, offload the callbacks of all CPUs
+ * and keep the rcuo kthreads on the CPUs below the highest capacity, so
+ * that callback floods do not take time from the big CPUs.
+ */
+static int __init parse_rcu_nocb_asym(char *arg)
+{
+	rcu_nocb_asym = true;
+	return 0;
+}
+early_param("rcu_nocb_asym", parse_rcu_nocb_asym);
+
+/*
+ * Confine an rcuo kthread to the CPUs below the highest capacity.  CPU
+ * capacities are not known when rcu_init_nohz() runs, but they are by
+ * the time the kthreads are spawned.  Symmetric systems leave the
+ * kthread unbound.
+ */
+static void rcu_nocb_asym_bind(struct task_struct *t)
+{
+	unsigned long cap, max_cap = 0;
+	cpumask_var_t cm;
+	int cpu;
+
+	if (!rcu_nocb_asym || !zalloc_cpumask_var(&cm, GFP_KERNEL))
+		return;
+	for_each_possible_cpu(cpu)
+		max_cap = max(max_cap, arch_scale_cpu_capacity(cpu));
+	for_each_possible_cpu(cpu) {
+		cap = arch_scale_cpu_capacity(cpu);
+		if (cap < max_cap)
+			cpumask_set_cpu(cpu, cm);
+	}
+	if (!cpumask_empty(cm))
+		WARN_ON_ONCE(set_cpus_allowed_ptr(t, cm));
+	free_cpumask_var(cm);
+}
+
 /*
  * Don't bother bypassing ->cblist if the call_rcu() rate is low.
  * After all, the main point of bypassing is to avoid lock contention
@@ -2206,6 +2246,8 @@ void __init rcu_init_nohz(void)
 	if (tick_nohz_full_running && cpumask_weight(tick_nohz_full_mask))
 		need_rcu_nocb_mask = true;
 #endif /* #if defined(CONFIG_NO_HZ_FULL) */
+	if (rcu_nocb_asym)
+		need_rcu_nocb_mask = true;
 
 	if (!cpumask_available(rcu_nocb_mask) && need_rcu_nocb_mask) {
 		if (!zalloc_cpumask_var(&rcu_nocb_mask, GFP_KERNEL)) {
@@ -2220,6 +2262,8 @@ void __init rcu_init_nohz(void)
 	if (tick_nohz_full_running)
 		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, tick_nohz_full_mask);
 #endif /* #if defined(CONFIG_NO_HZ_FULL) */
+	if (rcu_nocb_asym)
+		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, cpu_possible_mask);
 
 	if (!cpumask_subset(rcu_nocb_mask, cpu_possible_mask)) {
 		pr_info("\tNote: kernel parameter 'rcu_nocbs=', 'nohz_full', or 'isolcpus=' contains nonexistent CPUs.\n");
@@ -2233,6 +2277,8 @@ void __init rcu_init_nohz(void)
 			cpumask_pr_args(rcu_nocb_mask));
 	if (rcu_nocb_poll)
 		pr_info("\tPoll for callbacks from no-CBs CPUs.\n");
+	if (rcu_nocb_asym)
+		pr_info("\tOffload kthreads run on lower-capacity CPUs.\n");
 
 	for_each_cpu(cpu, rcu_nocb_mask) {
 		rdp = per_cpu_ptr(&rcu_data, cpu);
@@ -2281,6 +2327,7 @@ static void rcu_spawn_one_nocb_kthread(int cpu)
 				"rcuog/%d", rdp_gp->cpu);
 		if (WARN_ONCE(IS_ERR(t), "%s: Could not start rcuo GP kthread, OOM is now expected behavior\n", __func__))
 			return;
+		rcu_nocb_asym_bind(t);
 		WRITE_ONCE(rdp_gp->nocb_gp_kthread, t);
 	}
 
@@ -2289,6 +2336,7 @@ static void rcu_spawn_one_nocb_kthread(int cpu)
 			"rcuo%c/%d", rcu_state.abbr, cpu);
 	if (WARN_ONCE(IS_ERR(t), "%s: Could not start rcuo CB kthread, OOM is now expected behavior\n", __func__))
 		return;
+	rcu_nocb_asym_bind(t);
 	WRITE_ONCE(rdp->nocb_cb_kthread, t);
 	WRITE_ONCE(rdp->nocb_gp_kthread, rdp_gp->nocb_gp_kthread);
 }
@@ -41,6 +41,7 @@
 #include <linux/timer.h>
 #include <linux/freezer.h>
 #include <linux/compat.h>
+#include <linux/log2.h>
 
 #include <linux/uaccess.h>
 
@@ -1107,6 +1108,31 @@ hrtimer_update_softirq_timer(struct hrtimer_cpu_base *cpu_base, bool reprogram)
 	hrtimer_reprogram(cpu_base->softirq_next_timer, reprogram);
 }
 
+/*
+ * Timers started with at least HRTIMER_ALIGN_MIN_SLACK of slack get
+ * their hard expiry pulled back onto a grid of the largest power of two
+ * that fits in the slack (capped at HRTIMER_ALIGN_MAX_GRAIN). Timers in
+ * tasks with a similar slack then share hard expiry points and are
+ * handled in one wakeup, instead of each arming the clock event device
+ * at its own time. The hard expiry never moves below the soft expiry.
+ */
+#define HRTIMER_ALIGN_MIN_SLACK		NSEC_PER_MSEC
+#define HRTIMER_ALIGN_MAX_GRAIN		(1ULL << 26)	/* ~67ms */
+
+static u64 hrtimer_align_slack(ktime_t tim, u64 delta_ns)
+{
+	u64 grain, hard;
+
+	if (tim < 0 || tim > KTIME_MAX - (s64)delta_ns)
+		return delta_ns;
+
+	grain = rounddown_pow_of_two(min_t(u64, delta_ns,
+					   HRTIMER_ALIGN_MAX_GRAIN));
+	hard = (u64)tim + delta_ns;
+
+	return (hard & ~(grain - 1)) - (u64)tim;
+}
+
 static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 				    u64 delta_ns, const enum hrtimer_mode mode,
 				    struct hrtimer_clock_base *base)
@@ -1143,6 +1169,9 @@ static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 
 	tim = hrtimer_update_lowres(timer, tim, mode);
 
+	if (delta_ns >= HRTIMER_ALIGN_MIN_SLACK)
+		delta_ns = hrtimer_align_slack(tim, delta_ns);
+
 	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
 
 	/* Switch the timer base, if necessary: */
@@ -216,6 +216,11 @@ static bool check_tick_dependency(atomic_t *dep)
 		return true;
 	}
 
+	if (val & TICK_DEP_MASK_PAUSED) {
+		trace_tick_stop(0, TICK_DEP_MASK_PAUSED);
+		return true;
+	}
+
 	return false;
 }
 
@@ -430,6 +435,99 @@ void __init tick_nohz_full_setup(cpumask_var_t cpumask)
 }
 EXPORT_SYMBOL_GPL(tick_nohz_full_setup);
 
+/*
+ * Full dynticks CPUs whose tick has been switched back on at runtime
+ * through the nohz_full_active parameter. They keep TICK_DEP_BIT_PAUSED
+ * set, so they tick like housekeeping CPUs until they are handed back,
+ * e.g. while an audio or render thread is pinned there alone. They stay
+ * isolated in every other way (RCU offload, context tracking), so
+ * switching back and forth costs nothing.
+ *
+ * The tick_sched state, including tick_dep_mask, is wiped when a CPU
+ * goes offline, so the bit is set again when the CPU comes back.
+ */
+static struct cpumask tick_nohz_full_paused;
+static DEFINE_MUTEX(tick_nohz_full_paused_mutex);
+
+static int param_set_nohz_full_active(const char *val,
+				      const struct kernel_param *kp)
+{
+	cpumask_var_t active;
+	int cpu, ret;
+
+	if (!tick_nohz_full_running)
+		return -ENODEV;
+
+	if (!alloc_cpumask_var(&active, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpulist_parse(val, active);
+	if (ret)
+		goto out;
+	if (!cpumask_subset(active, tick_nohz_full_mask)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	cpus_read_lock();
+	mutex_lock(&tick_nohz_full_paused_mutex);
+	for_each_cpu(cpu, tick_nohz_full_mask) {
+		bool pause = !cpumask_test_cpu(cpu, active);
+
+		if (pause == cpumask_test_cpu(cpu, &tick_nohz_full_paused))
+			continue;
+
+		if (pause) {
+			cpumask_set_cpu(cpu, &tick_nohz_full_paused);
+			if (cpu_online(cpu))
+				tick_nohz_dep_set_cpu(cpu, TICK_DEP_BIT_PAUSED);
+		} else {
+			cpumask_clear_cpu(cpu, &tick_nohz_full_paused);
+			tick_nohz_dep_clear_cpu(cpu, TICK_DEP_BIT_PAUSED);
+		}
+	}
+	mutex_unlock(&tick_nohz_full_paused_mutex);
+	cpus_read_unlock();
+out:
+	free_cpumask_var(active);
+	return ret;
+}
+
+static int param_get_nohz_full_active(char *buf, const struct kernel_param *kp)
+{
+	cpumask_var_t active;
+	int len;
+
+	if (!tick_nohz_full_running)
+		return sprintf(buf, "\n");
+
+	if (!alloc_cpumask_var(&active, GFP_KERNEL))
+		return -ENOMEM;
+
+	mutex_lock(&tick_nohz_full_paused_mutex);
+	cpumask_andnot(active, tick_nohz_full_mask, &tick_nohz_full_paused);
+	mutex_unlock(&tick_nohz_full_paused_mutex);
+	len = sprintf(buf, "%*pbl\n", cpumask_pr_args(active));
+	free_cpumask_var(active);
+
+	return len;
+}
+
+static const struct kernel_param_ops nohz_full_active_ops = {
+	.set = param_set_nohz_full_active,
+	.get = param_get_nohz_full_active,
+};
+module_param_cb(nohz_full_active, &nohz_full_active_ops, NULL, 0644);
+MODULE_PARM_DESC(nohz_full_active,
+		 "Subset of nohz_full CPUs currently allowed to stop their busy tick");
+
+static int tick_nohz_cpu_up(unsigned int cpu)
+{
+	if (cpumask_test_cpu(cpu, &tick_nohz_full_paused))
+		tick_nohz_dep_set_cpu(cpu, TICK_DEP_BIT_PAUSED);
+	return 0;
+}
+
 static int tick_nohz_cpu_down(unsigned int cpu)
 {
 	/*
@@ -476,7 +574,7 @@ void __init tick_nohz_init(void)
 		context_tracking_cpu_set(cpu);
 
 	ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN,
-					"kernel/nohz:predown", NULL,
+					"kernel/nohz:predown", tick_nohz_cpu_up,
 					tick_nohz_cpu_down);
 	WARN_ON(ret < 0);
 	pr_info("NO_HZ: Full dynticks CPUs: %*pbl.\n",
@@ -41,9 +41,12 @@
 #include <linux/sched/sysctl.h>
 #include <linux/sched/nohz.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/rt.h>
+#include <linux/sched/deadline.h>
 #include <linux/slab.h>
 #include <linux/compat.h>
 #include <linux/random.h>
+#include <linux/log2.h>
 
 #include <linux/uaccess.h>
 #include <asm/unistd.h>
@@ -1867,6 +1870,27 @@ static void process_timeout(struct timer_list *t)
  * jiffies will be returned. In all cases the return value is guaranteed
  * to be non-negative.
  */
+/*
+ * Tasks that were given a timer slack of two ticks or more (e.g. by
+ * their cpuset) have schedule_timeout() expiries rounded up onto a
+ * power-of-two jiffies grid that fits in the slack, capped at HZ jiffies,
+ * so that sleeping background tasks wake up together.
+ */
+static unsigned long timer_slack_align(unsigned long expire)
+{
+	unsigned long slack;
+
+	if (rt_task(current) || dl_task(current) ||
+	    current->timer_slack_ns < 2 * TICK_NSEC)
+		return expire;
+
+	slack = min_t(unsigned long, nsecs_to_jiffies(current->timer_slack_ns),
+		      HZ);
+	slack = rounddown_pow_of_two(slack);
+
+	return (expire + slack - 1) & ~(slack - 1);
+}
+
 signed long __sched schedule_timeout(signed long timeout)
 {
 	struct process_timer timer;
@@ -1905,7 +1929,8 @@ signed long __sched schedule_timeout(signed long timeout)
 
 	timer.task = current;
 	timer_setup_on_stack(&timer.timer, process_timeout, 0);
-	__mod_timer(&timer.timer, expire, MOD_TIMER_NOTPENDING);
+	__mod_timer(&timer.timer, timer_slack_align(expire),
+		    MOD_TIMER_NOTPENDING);
 	schedule();
 	del_singleshot_timer_sync(&timer.timer);
 
@@ -181,6 +181,45 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+static FORCE_INLINE void LZ4_copy16(void *dst, const void *src)
+{
+#if LZ4_ARCH64
+	U64 a = get_unaligned((const U64 *)src);
+	U64 b = get_unaligned((const U64 *)src + 1);
+
+	put_unaligned(a, (U64 *)dst);
+	put_unaligned(b, (U64 *)dst + 1);
+#else
+	LZ4_copy8(dst, src);
+	LZ4_copy8((BYTE *)dst + 8, (const BYTE *)src + 8);
+#endif
+}
+
+/*
+ * same contract as LZ4_wildCopy() (may overwrite up to 7 bytes beyond
+ * dstEnd), but moves 16 bytes per step while far enough from dstEnd.
+ * srcPtr must be at least 16 bytes away from dstPtr when they overlap.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (e - d > 16) {
+		LZ4_copy16(d, s);
+		d += 16;
+		s += 16;
+	}
+
+	do {
+		LZ4_copy8(d, s);
+		d += 8;
+		s += 8;
+	} while (d < e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
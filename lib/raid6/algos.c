@@ -28,6 +28,18 @@ EXPORT_SYMBOL(raid6_empty_zero_page);
 struct raid6_calls raid6_call;
 EXPORT_SYMBOL_GPL(raid6_call);
 
+#ifdef __KERNEL__
+/*
+ * Benchmarking every candidate takes a good fraction of a second at boot.
+ * Once userspace knows the winner for a machine it can pass it back in as
+ * raid6_pq.algo= and have the benchmark skipped, so the parameter also
+ * reports whichever algorithm ended up being used.
+ */
+static char raid6_algo[16];
+module_param_string(algo, raid6_algo, sizeof(raid6_algo), 0444);
+MODULE_PARM_DESC(algo, "syndrome algorithm to use without benchmarking");
+#endif
+
 const struct raid6_calls * const raid6_algos[] = {
 #if defined(__i386__) && !defined(__arch_um__)
 #ifdef CONFIG_AS_AVX512
@@ -150,6 +162,24 @@ static inline const struct raid6_calls *raid6_choose_gen(
 	const struct raid6_calls *const *algo;
 	const struct raid6_calls *best;
 
+#ifdef __KERNEL__
+	if (raid6_algo[0]) {
+		for (algo = raid6_algos; *algo; algo++) {
+			if (strcmp((*algo)->name, raid6_algo))
+				continue;
+			if ((*algo)->valid && !(*algo)->valid())
+				break;
+
+			pr_info("raid6: using requested algorithm %s\n",
+				(*algo)->name);
+			raid6_call = **algo;
+			return *algo;
+		}
+		pr_warn("raid6: requested algorithm %s not available\n",
+			raid6_algo);
+	}
+#endif
+
 	for (bestgenperf = 0, bestxorperf = 0, best = NULL, algo = raid6_algos; *algo; algo++) {
 		if (!best || (*algo)->prefer >= best->prefer) {
 			if ((*algo)->valid && !(*algo)->valid())
@@ -221,6 +251,9 @@ static inline const struct raid6_calls *raid6_choose_gen(
 			pr_info("raid6: skip pq benchmark and using algorithm %s\n",
 				best->name);
 		raid6_call = *best;
+#ifdef __KERNEL__
+		strscpy(raid6_algo, best->name, sizeof(raid6_algo));
+#endif
 	} else
 		pr_err("raid6: Yikes!  No algorithm found!\n");
 
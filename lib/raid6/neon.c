@@ -53,7 +53,7 @@
 		raid6_neon ## _n ## _xor_syndrome,			\
 		raid6_have_neon,					\
 		"neonx" #_n,						\
-		0							\
+		1	/* always beats the integer code */		\
 	}
 
 static int raid6_have_neon(void)
@@ -1025,8 +1025,8 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 	/* copy Literals */
 	ZSTD_copy8(op, *litPtr);
 	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+		ZSTD_wildcopy_apart(op + 8, (*litPtr) + 8,
+				    sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1084,6 +1084,8 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 		}
 		while (op < oMatchEnd)
 			*op++ = *match++;
+	} else if (sequence.offset >= 16) {
+		ZSTD_wildcopy_apart(op, match, (ptrdiff_t)sequence.matchLength - 8);
 	} else {
 		ZSTD_wildcopy(op, match, (ptrdiff_t)sequence.matchLength - 8); /* works even if matchLength < 8 */
 	}
@@ -1281,8 +1283,8 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 	/* copy Literals */
 	ZSTD_copy8(op, *litPtr);
 	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+		ZSTD_wildcopy_apart(op + 8, (*litPtr) + 8,
+				    sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1339,6 +1341,8 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 		}
 		while (op < oMatchEnd)
 			*op++ = *match++;
+	} else if (sequence.offset >= 16) {
+		ZSTD_wildcopy_apart(op, match, (ptrdiff_t)sequence.matchLength - 8);
 	} else {
 		ZSTD_wildcopy(op, match, (ptrdiff_t)sequence.matchLength - 8); /* works even if matchLength < 8 */
 	}
@@ -161,6 +161,31 @@ ZSTD_STATIC void ZSTD_wildcopy(void *dst, const void *src, ptrdiff_t length)
 	} while (op < oend);
 }
 
+ZSTD_STATIC void ZSTD_copy16(void *dst, const void *src) { __builtin_memcpy(dst, src, 16); }
+
+/*! ZSTD_wildcopy_apart() :
+*   same contract as ZSTD_wildcopy(), for buffers at least 16 bytes apart. Bulk
+*   of the copy moves 16 bytes per step (a load/store pair on 64-bit targets
+*   such as arm64), the tail falls back to 8-byte steps so that the overwrite
+*   past dst + length stays within WILDCOPY_OVERLENGTH. */
+ZSTD_STATIC void ZSTD_wildcopy_apart(void *dst, const void *src, ptrdiff_t length)
+{
+	const BYTE* ip = (const BYTE*)src;
+	BYTE* op = (BYTE*)dst;
+	BYTE* const oend = op + length;
+
+	while (oend - op >= 16) {
+		ZSTD_copy16(op, ip);
+		op += 16;
+		ip += 16;
+	}
+	while (op < oend) {
+		ZSTD_copy8(op, ip);
+		op += 8;
+		ip += 8;
+	}
+}
+
 /*-*******************************************
 *  Private interfaces
 *********************************************/
@@ -0,0 +1,573 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DAMON-based proactive reclamation of cached application memory
+ *
+ * DAMON_RECLAIM works on the physical address space of the whole system.
+ * This instead monitors the virtual address spaces of the processes that the
+ * userspace (e.g., the activity manager) reports as cached background apps,
+ * and pages out their cold anonymous memory to swap (zram) under a per
+ * memory cgroup quota, so that one big app cannot use up the whole budget.
+ */
+
+#define pr_fmt(fmt) "damon-app-reclaim: " fmt
+
+#include <linux/damon.h>
+#include <linux/memcontrol.h>
+#include <linux/module.h>
+#include <linux/pid.h>
+#include <linux/sched.h>
+#include <linux/sched/mm.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "damon_app_reclaim."
+
+#define DAMON_APP_RECLAIM_MAX_TARGETS	32
+
+/*
+ * Enable or disable DAMON_APP_RECLAIM.
+ *
+ * You can enable DAMON_APP_RECLAIM by setting the value of this parameter as
+ * ``Y``.  Setting it as ``N`` disables DAMON_APP_RECLAIM.  Note that DAMON
+ * allows only one group of monitoring threads at once, so this cannot be
+ * enabled together with DAMON_RECLAIM or the debugfs interface.
+ */
+static bool enabled __read_mostly;
+
+/*
+ * PIDs of the processes to monitor, separated by commas.
+ *
+ * The userspace is expected to update this whenever an app enters or leaves
+ * the cached state.  DAMON_APP_RECLAIM restarts the monitoring with the new
+ * targets within a second.  Up to 32 processes.
+ */
+static char target_pids[DAMON_APP_RECLAIM_MAX_TARGETS * 12] __read_mostly;
+static bool target_pids_changed;
+
+/*
+ * Time threshold for cold memory regions identification in microseconds.
+ *
+ * If a memory region is not accessed for this or longer time,
+ * DAMON_APP_RECLAIM identifies the region as cold, and pages it out.  Cached
+ * apps are not in the foreground, so this is shorter than the DAMON_RECLAIM
+ * default.  30 seconds by default.
+ */
+static unsigned long min_age __read_mostly = 30000000;
+module_param(min_age, ulong, 0600);
+
+/*
+ * Limit of time for trying the reclamation in milliseconds.
+ *
+ * Same to the DAMON_RECLAIM parameter of the same name.  10 ms by default.
+ */
+static unsigned long quota_ms __read_mostly = 10;
+module_param(quota_ms, ulong, 0600);
+
+/*
+ * Limit of size of memory for the reclamation in bytes, for all targets.
+ *
+ * Same to the DAMON_RECLAIM parameter of the same name.  64 MiB by default.
+ */
+static unsigned long quota_sz __read_mostly = 64 * 1024 * 1024;
+module_param(quota_sz, ulong, 0600);
+
+/*
+ * Limit of size of memory for the reclamation in bytes, per memory cgroup.
+ *
+ * DAMON_APP_RECLAIM charges the memory it tried to page out to the memory
+ * cgroup of the target process, and makes no more than this limit is tried
+ * for each cgroup within quota_reset_interval_ms.  Zero disables the limit.
+ * 16 MiB by default.
+ */
+static unsigned long memcg_quota_sz __read_mostly = 16 * 1024 * 1024;
+module_param(memcg_quota_sz, ulong, 0600);
+
+/*
+ * The time/size quota charge reset interval in milliseconds.
+ *
+ * Applied to both the global (quota_ms, quota_sz) and the per memory cgroup
+ * (memcg_quota_sz) quotas.  1 second by default.
+ */
+static unsigned long quota_reset_interval_ms __read_mostly = 1000;
+module_param(quota_reset_interval_ms, ulong, 0600);
+
+/*
+ * The watermarks check time interval in microseconds.
+ *
+ * 5 seconds by default.
+ */
+static unsigned long wmarks_interval __read_mostly = 5000000;
+module_param(wmarks_interval, ulong, 0600);
+
+/*
+ * Free memory rate (per thousand) for the high watermark.
+ *
+ * Above this, DAMON_APP_RECLAIM is inactive.  Cached apps are worth keeping
+ * in RAM as long as there is room, so this is lower than that of
+ * DAMON_RECLAIM.  300 (30%) by default.
+ */
+static unsigned long wmarks_high __read_mostly = 300;
+module_param(wmarks_high, ulong, 0600);
+
+/*
+ * Free memory rate (per thousand) for the middle watermark.
+ *
+ * Between this and the low watermark, DAMON_APP_RECLAIM is active.  200 (20%)
+ * by default.
+ */
+static unsigned long wmarks_mid __read_mostly = 200;
+module_param(wmarks_mid, ulong, 0600);
+
+/*
+ * Free memory rate (per thousand) for the low watermark.
+ *
+ * Below this, DAMON_APP_RECLAIM becomes inactive and leaves the work to the
+ * LRU-based reclamation and the low memory killer.  50 (5%) by default.
+ */
+static unsigned long wmarks_low __read_mostly = 50;
+module_param(wmarks_low, ulong, 0600);
+
+/*
+ * Sampling interval for the monitoring in microseconds.
+ *
+ * 5 ms by default.
+ */
+static unsigned long sample_interval __read_mostly = 5000;
+module_param(sample_interval, ulong, 0600);
+
+/*
+ * Aggregation interval for the monitoring in microseconds.
+ *
+ * 100 ms by default.
+ */
+static unsigned long aggr_interval __read_mostly = 100000;
+module_param(aggr_interval, ulong, 0600);
+
+/*
+ * Minimum number of monitoring regions.
+ *
+ * 10 by default.
+ */
+static unsigned long min_nr_regions __read_mostly = 10;
+module_param(min_nr_regions, ulong, 0600);
+
+/*
+ * Maximum number of monitoring regions.
+ *
+ * 1000 by default.
+ */
+static unsigned long max_nr_regions __read_mostly = 1000;
+module_param(max_nr_regions, ulong, 0600);
+
+/*
+ * Number of threads sampling the targets in parallel.
+ *
+ * The targets are split into this many sets, and each set is sampled by its
+ * own worker, so that watching many cached apps does not make the sampling
+ * interval slip.  4 by default.
+ */
+static unsigned int nr_shards __read_mostly = 4;
+module_param(nr_shards, uint, 0600);
+
+/*
+ * PID of the DAMON thread
+ *
+ * If DAMON_APP_RECLAIM is running, this becomes the PID of the worker thread.
+ * Else, -1.
+ */
+static int kdamond_pid __read_mostly = -1;
+module_param(kdamond_pid, int, 0400);
+
+/*
+ * Number of memory regions that tried to be paged out.
+ */
+static unsigned long nr_reclaim_tried_regions __read_mostly;
+module_param(nr_reclaim_tried_regions, ulong, 0400);
+
+/*
+ * Total bytes of memory regions that tried to be paged out.
+ */
+static unsigned long bytes_reclaim_tried_regions __read_mostly;
+module_param(bytes_reclaim_tried_regions, ulong, 0400);
+
+/*
+ * Number of memory regions that successfully be paged out.
+ */
+static unsigned long nr_reclaimed_regions __read_mostly;
+module_param(nr_reclaimed_regions, ulong, 0400);
+
+/*
+ * Total bytes of memory regions that successfully be paged out.
+ *
+ * The userspace can use this to size the zram writeback of the coldest pages
+ * (``cold_size=`` of the zram ``writeback`` file).
+ */
+static unsigned long bytes_reclaimed_regions __read_mostly;
+module_param(bytes_reclaimed_regions, ulong, 0400);
+
+/*
+ * Number of times that the global time/space quota limits have exceeded
+ */
+static unsigned long nr_quota_exceeds __read_mostly;
+module_param(nr_quota_exceeds, ulong, 0400);
+
+/*
+ * Number of regions skipped because their memory cgroup quota was exceeded
+ */
+static unsigned long nr_memcg_quota_exceeds __read_mostly;
+module_param(nr_memcg_quota_exceeds, ulong, 0400);
+
+static struct damon_ctx *ctx;
+
+/* The original apply_scheme primitive of the vaddr primitives */
+static unsigned long (*va_apply_scheme)(struct damon_ctx *context,
+		struct damon_target *t, struct damon_region *r,
+		struct damos *scheme);
+
+/*
+ * Per memory cgroup charge of the current quota window.  Only the kdamond
+ * touches these, so no locking is needed.
+ */
+struct damon_app_reclaim_memcg {
+	unsigned short id;
+	unsigned long charged_sz;
+	unsigned long charged_from;
+};
+
+static struct damon_app_reclaim_memcg memcgs[DAMON_APP_RECLAIM_MAX_TARGETS];
+
+static struct damon_app_reclaim_memcg *damon_app_reclaim_memcg_of(
+		struct damon_target *t)
+{
+	struct damon_app_reclaim_memcg *m, *free = NULL;
+	struct mem_cgroup *memcg;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	unsigned short id;
+	int i;
+
+	task = get_pid_task((struct pid *)t->id, PIDTYPE_PID);
+	if (!task)
+		return NULL;
+	mm = get_task_mm(task);
+	put_task_struct(task);
+	if (!mm)
+		return NULL;
+
+	memcg = get_mem_cgroup_from_mm(mm);
+	mmput(mm);
+	if (!memcg)
+		return NULL;
+	id = mem_cgroup_id(memcg);
+	css_put(&memcg->css);
+
+	/* id 0 is never used by a live memcg, so it marks free slots */
+	for (i = 0; i < ARRAY_SIZE(memcgs); i++) {
+		m = &memcgs[i];
+		if (m->id == id)
+			return m;
+		if (!m->id && !free)
+			free = m;
+	}
+
+	if (free) {
+		free->id = id;
+		free->charged_sz = 0;
+		free->charged_from = jiffies;
+	}
+	return free;
+}
+
+static unsigned long damon_app_reclaim_apply_scheme(struct damon_ctx *c,
+		struct damon_target *t, struct damon_region *r,
+		struct damos *s)
+{
+	struct damon_app_reclaim_memcg *m = NULL;
+	unsigned long sz = r->ar.end - r->ar.start;
+
+	if (memcg_quota_sz) {
+		m = damon_app_reclaim_memcg_of(t);
+		if (m && time_after_eq(jiffies, m->charged_from +
+				msecs_to_jiffies(quota_reset_interval_ms))) {
+			m->charged_sz = 0;
+			m->charged_from = jiffies;
+		}
+		if (m && m->charged_sz >= memcg_quota_sz) {
+			nr_memcg_quota_exceeds++;
+			return 0;
+		}
+	}
+
+	if (m)
+		m->charged_sz += sz;
+
+	return va_apply_scheme(c, t, r, s);
+}
+
+static struct damos *damon_app_reclaim_new_scheme(void)
+{
+	struct damos_watermarks wmarks = {
+		.metric = DAMOS_WMARK_FREE_MEM_RATE,
+		.interval = wmarks_interval,
+		.high = wmarks_high,
+		.mid = wmarks_mid,
+		.low = wmarks_low,
+	};
+	struct damos_quota quota = {
+		/*
+		 * Do not try reclamation for more than quota_ms milliseconds
+		 * or quota_sz bytes within quota_reset_interval_ms.
+		 */
+		.ms = quota_ms,
+		.sz = quota_sz,
+		.reset_interval = quota_reset_interval_ms,
+		/* Within the quota, page out older regions first. */
+		.weight_sz = 0,
+		.weight_nr_accesses = 0,
+		.weight_age = 1
+	};
+	struct damos *scheme = damon_new_scheme(
+			/* Find regions having PAGE_SIZE or larger size */
+			PAGE_SIZE, ULONG_MAX,
+			/* and not accessed at all */
+			0, 0,
+			/* for min_age or more micro-seconds, and */
+			min_age / aggr_interval, UINT_MAX,
+			/* page out those, as soon as found */
+			DAMOS_PAGEOUT,
+			/* under the quota. */
+			&quota,
+			/* (De)activate this according to the watermarks. */
+			&wmarks);
+
+	return scheme;
+}
+
+static void damon_app_reclaim_put_pids(unsigned long *ids, int nr_ids)
+{
+	int i;
+
+	for (i = 0; i < nr_ids; i++)
+		put_pid((struct pid *)ids[i]);
+}
+
+/*
+ * Parse target_pids into references of the 'struct pid's.  Processes that
+ * already exited are silently skipped.  Returns the number of the targets.
+ */
+static int damon_app_reclaim_get_pids(unsigned long *ids)
+{
+	char *buf, *cur, *tok;
+	struct pid *pid;
+	int nr_ids = 0;
+	int nr;
+
+	buf = kstrdup(target_pids, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	cur = buf;
+	while ((tok = strsep(&cur, ",")) &&
+			nr_ids < DAMON_APP_RECLAIM_MAX_TARGETS) {
+		if (kstrtoint(strim(tok), 10, &nr) || nr <= 0)
+			continue;
+		pid = find_get_pid(nr);
+		if (pid)
+			ids[nr_ids++] = (unsigned long)pid;
+	}
+	kfree(buf);
+
+	return nr_ids;
+}
+
+static int damon_app_reclaim_turn(bool on)
+{
+	unsigned long ids[DAMON_APP_RECLAIM_MAX_TARGETS];
+	struct damos *scheme;
+	int nr_ids;
+	int err;
+
+	if (!on) {
+		err = damon_stop(&ctx, 1);
+		if (!err)
+			kdamond_pid = -1;
+		return err;
+	}
+
+	err = damon_set_attrs(ctx, sample_interval, aggr_interval, 0,
+			min_nr_regions, max_nr_regions);
+	if (err)
+		return err;
+	ctx->nr_shards = nr_shards;
+
+	nr_ids = damon_app_reclaim_get_pids(ids);
+	if (nr_ids < 0)
+		return nr_ids;
+	/* Nothing to monitor is not an error; wait for the next targets. */
+	if (!nr_ids)
+		return 0;
+
+	err = damon_set_targets(ctx, ids, nr_ids);
+	if (err)
+		goto put_pids_out;
+
+	/* Will be freed by 'damon_set_schemes()' below */
+	scheme = damon_app_reclaim_new_scheme();
+	if (!scheme) {
+		err = -ENOMEM;
+		goto destroy_targets_out;
+	}
+	err = damon_set_schemes(ctx, &scheme, 1);
+	if (err)
+		goto free_scheme_out;
+
+	memset(memcgs, 0, sizeof(memcgs));
+	err = damon_start(&ctx, 1);
+	if (!err) {
+		kdamond_pid = ctx->kdamond->pid;
+		return 0;
+	}
+
+free_scheme_out:
+	damon_destroy_scheme(scheme);
+destroy_targets_out:
+	damon_set_targets(ctx, NULL, 0);
+put_pids_out:
+	damon_app_reclaim_put_pids(ids, nr_ids);
+	return err;
+}
+
+static bool damon_app_reclaim_running(void)
+{
+	bool running;
+
+	mutex_lock(&ctx->kdamond_lock);
+	running = ctx->kdamond != NULL;
+	mutex_unlock(&ctx->kdamond_lock);
+
+	return running;
+}
+
+#define ENABLE_CHECK_INTERVAL_MS	1000
+static struct delayed_work damon_app_reclaim_timer;
+static void damon_app_reclaim_timer_fn(struct work_struct *work)
+{
+	bool running = damon_app_reclaim_running();
+
+	/*
+	 * The kdamond also finishes on its own once all targets exited, so
+	 * compare with the real state rather than the last request.
+	 */
+	if (running && (!enabled || READ_ONCE(target_pids_changed))) {
+		damon_app_reclaim_turn(false);
+		running = false;
+	}
+	if (!running && enabled) {
+		WRITE_ONCE(target_pids_changed, false);
+		damon_app_reclaim_turn(true);
+	}
+	if (!damon_app_reclaim_running())
+		kdamond_pid = -1;
+
+	if (enabled)
+		schedule_delayed_work(&damon_app_reclaim_timer,
+			msecs_to_jiffies(ENABLE_CHECK_INTERVAL_MS));
+}
+static DECLARE_DELAYED_WORK(damon_app_reclaim_timer,
+		damon_app_reclaim_timer_fn);
+
+static int enabled_store(const char *val,
+		const struct kernel_param *kp)
+{
+	int rc = param_set_bool(val, kp);
+
+	if (rc < 0)
+		return rc;
+
+	schedule_delayed_work(&damon_app_reclaim_timer, 0);
+
+	return 0;
+}
+
+static const struct kernel_param_ops enabled_param_ops = {
+	.set = enabled_store,
+	.get = param_get_bool,
+};
+
+module_param_cb(enabled, &enabled_param_ops, &enabled, 0600);
+MODULE_PARM_DESC(enabled,
+	"Enable or disable DAMON_APP_RECLAIM (default: disabled)");
+
+static int target_pids_store(const char *val,
+		const struct kernel_param *kp)
+{
+	int rc = param_set_copystring(val, kp);
+
+	if (rc < 0)
+		return rc;
+
+	WRITE_ONCE(target_pids_changed, true);
+	if (enabled)
+		mod_delayed_work(system_wq, &damon_app_reclaim_timer, 0);
+
+	return 0;
+}
+
+static const struct kernel_param_ops target_pids_param_ops = {
+	.set = target_pids_store,
+	.get = param_get_string,
+};
+
+static struct kparam_string target_pids_kps = {
+	.maxlen = sizeof(target_pids),
+	.string = target_pids,
+};
+
+module_param_cb(target_pids, &target_pids_param_ops, &target_pids_kps, 0600);
+MODULE_PARM_DESC(target_pids,
+	"Comma separated PIDs of the cached apps to reclaim");
+
+static int damon_app_reclaim_after_aggregation(struct damon_ctx *c)
+{
+	struct damos *s;
+
+	/* update the stats parameter */
+	damon_for_each_scheme(s, c) {
+		nr_reclaim_tried_regions = s->stat.nr_tried;
+		bytes_reclaim_tried_regions = s->stat.sz_tried;
+		nr_reclaimed_regions = s->stat.nr_applied;
+		bytes_reclaimed_regions = s->stat.sz_applied;
+		nr_quota_exceeds = s->stat.qt_exceeds;
+	}
+	return 0;
+}
+
+static void damon_app_reclaim_before_terminate(struct damon_ctx *c)
+{
+	struct damon_target *t, *next;
+
+	damon_for_each_target_safe(t, next, c) {
+		put_pid((struct pid *)t->id);
+		damon_destroy_target(t);
+	}
+}
+
+static int __init damon_app_reclaim_init(void)
+{
+	ctx = damon_new_ctx();
+	if (!ctx)
+		return -ENOMEM;
+
+	damon_va_set_primitives(ctx);
+	va_apply_scheme = ctx->primitive.apply_scheme;
+	ctx->primitive.apply_scheme = damon_app_reclaim_apply_scheme;
+	ctx->callback.after_aggregation = damon_app_reclaim_after_aggregation;
+	ctx->callback.before_terminate = damon_app_reclaim_before_terminate;
+
+	return 0;
+}
+
+module_init(damon_app_reclaim_init);
@@ -213,6 +213,7 @@ struct damon_ctx *damon_new_ctx(void)
 
 	ctx->min_nr_regions = 10;
 	ctx->max_nr_regions = 1000;
+	ctx->nr_shards = 1;
 
 	INIT_LIST_HEAD(&ctx->adaptive_targets);
 	INIT_LIST_HEAD(&ctx->schemes);
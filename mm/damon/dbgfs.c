@@ -10,9 +10,12 @@
 #include <linux/damon.h>
 #include <linux/debugfs.h>
 #include <linux/file.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/page_idle.h>
+#include <linux/poll.h>
 #include <linux/slab.h>
 
 static struct damon_ctx **dbgfs_ctxs;
@@ -608,6 +611,323 @@ static ssize_t dbgfs_kdamond_pid_read(struct file *file,
 	return len;
 }
 
+/*
+ * Access heatmap
+ *
+ * For each aggregation, the monitoring results of each target are
+ * downsampled into 'nr_bins' equal sized address bins spanning its monitored
+ * range.  Results of 'aggrs_per_frame' aggregations are averaged into one
+ * frame per target, and the frames are queued in a ring that the 'heatmap'
+ * file reads, in binary.  Each frame is a &struct dbgfs_heatmap_frame
+ * followed by 'nr_bins' bytes of heat, from the lowest address bin.  Heat is
+ * the access frequency of the bin scaled to [0, 255], 255 meaning every
+ * sampling found it accessed.  Frames that do not fit in the ring are
+ * dropped and counted in the next frame's 'nr_dropped'.
+ */
+
+#define DBGFS_HEATMAP_RING_SZ	(256 * 1024)
+#define DBGFS_HEATMAP_MAX_BINS	4096
+
+struct dbgfs_heatmap_frame {
+	u64 ts_ns;
+	u64 start;
+	u64 end;
+	u32 target_idx;
+	u32 nr_bins;
+	u32 nr_dropped;
+	u32 reserved;
+};
+
+struct dbgfs_heatmap {
+	struct mutex lock;
+	wait_queue_head_t wait;
+	struct kfifo ring;
+	unsigned int nr_bins;
+	unsigned int aggrs_per_frame;
+
+	/* below are accessed by the kdamond only */
+	unsigned int nr_aggrs;
+	unsigned int nr_targets;
+	unsigned int nr_dropped;
+	u64 *acc;
+	u8 *frame;
+};
+
+static size_t dbgfs_heatmap_frame_sz(struct dbgfs_heatmap *hm)
+{
+	return sizeof(struct dbgfs_heatmap_frame) + hm->nr_bins;
+}
+
+static void dbgfs_heatmap_acc_target(struct dbgfs_heatmap *hm,
+		struct damon_target *t, u64 *acc)
+{
+	struct damon_region *r;
+	unsigned long start, end, bin_sz, bin, lo, hi;
+
+	if (!damon_nr_regions(t))
+		return;
+	start = list_first_entry(&t->regions_list, struct damon_region,
+			list)->ar.start;
+	end = damon_last_region(t)->ar.end;
+	bin_sz = DIV_ROUND_UP(end - start, hm->nr_bins);
+
+	damon_for_each_region(r, t) {
+		if (!r->nr_accesses)
+			continue;
+		for (bin = (r->ar.start - start) / bin_sz;
+				bin < hm->nr_bins; bin++) {
+			lo = max(r->ar.start, start + bin * bin_sz);
+			hi = min(r->ar.end, start + (bin + 1) * bin_sz);
+			if (lo >= hi)
+				break;
+			acc[bin] += (u64)r->nr_accesses *
+				((hi - lo) >> PAGE_SHIFT);
+		}
+	}
+}
+
+static void dbgfs_heatmap_emit(struct dbgfs_heatmap *hm, struct damon_ctx *c,
+		struct damon_target *t, unsigned int idx, u64 *acc)
+{
+	struct dbgfs_heatmap_frame *f = (struct dbgfs_heatmap_frame *)hm->frame;
+	u8 *heat = hm->frame + sizeof(*f);
+	unsigned long bin_pages, max_nr_accesses;
+	u64 full;
+	unsigned int bin;
+
+	f->ts_ns = ktime_get_ns();
+	f->target_idx = idx;
+	f->nr_bins = hm->nr_bins;
+	f->reserved = 0;
+	if (damon_nr_regions(t)) {
+		f->start = list_first_entry(&t->regions_list,
+				struct damon_region, list)->ar.start;
+		f->end = damon_last_region(t)->ar.end;
+	} else {
+		f->start = f->end = 0;
+	}
+
+	bin_pages = max(DIV_ROUND_UP(f->end - f->start, hm->nr_bins) >>
+			PAGE_SHIFT, 1UL);
+	max_nr_accesses = max(c->aggr_interval / c->sample_interval, 1UL);
+	full = (u64)bin_pages * max_nr_accesses * hm->nr_aggrs;
+	for (bin = 0; bin < hm->nr_bins; bin++)
+		heat[bin] = min_t(u64, div64_u64(acc[bin] * 255, full), 255);
+
+	if (kfifo_avail(&hm->ring) < dbgfs_heatmap_frame_sz(hm)) {
+		hm->nr_dropped++;
+		return;
+	}
+	f->nr_dropped = hm->nr_dropped;
+	hm->nr_dropped = 0;
+	kfifo_in(&hm->ring, hm->frame, dbgfs_heatmap_frame_sz(hm));
+}
+
+static int dbgfs_heatmap_after_aggregation(struct damon_ctx *c)
+{
+	struct dbgfs_heatmap *hm = c->callback.private;
+	struct damon_target *t;
+	unsigned int nr_targets = 0, idx = 0;
+
+	if (!hm || !hm->nr_bins)
+		return 0;
+
+	damon_for_each_target(t, c)
+		nr_targets++;
+	if (nr_targets != hm->nr_targets) {
+		kfree(hm->acc);
+		hm->acc = kcalloc(nr_targets * hm->nr_bins, sizeof(*hm->acc),
+				GFP_KERNEL);
+		hm->nr_targets = hm->acc ? nr_targets : 0;
+		hm->nr_aggrs = 0;
+		if (!hm->acc)
+			return 0;
+	}
+
+	damon_for_each_target(t, c)
+		dbgfs_heatmap_acc_target(hm, t, hm->acc + idx++ * hm->nr_bins);
+
+	if (++hm->nr_aggrs < hm->aggrs_per_frame)
+		return 0;
+
+	idx = 0;
+	damon_for_each_target(t, c) {
+		dbgfs_heatmap_emit(hm, c, t, idx, hm->acc + idx * hm->nr_bins);
+		idx++;
+	}
+	memset(hm->acc, 0, nr_targets * hm->nr_bins * sizeof(*hm->acc));
+	hm->nr_aggrs = 0;
+	wake_up_interruptible(&hm->wait);
+
+	return 0;
+}
+
+static ssize_t dbgfs_heatmap_attrs_read(struct file *file,
+		char __user *buf, size_t count, loff_t *ppos)
+{
+	struct damon_ctx *ctx = file->private_data;
+	struct dbgfs_heatmap *hm = ctx->callback.private;
+	char kbuf[32];
+	int ret;
+
+	mutex_lock(&hm->lock);
+	ret = scnprintf(kbuf, ARRAY_SIZE(kbuf), "%u %u\n", hm->nr_bins,
+			hm->aggrs_per_frame);
+	mutex_unlock(&hm->lock);
+
+	return simple_read_from_buffer(buf, count, ppos, kbuf, ret);
+}
+
+static ssize_t dbgfs_heatmap_attrs_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct damon_ctx *ctx = file->private_data;
+	struct dbgfs_heatmap *hm = ctx->callback.private;
+	unsigned int nr_bins, aggrs_per_frame;
+	u8 *frame = NULL;
+	char *kbuf;
+	ssize_t ret;
+
+	kbuf = user_input_str(buf, count, ppos);
+	if (IS_ERR(kbuf))
+		return PTR_ERR(kbuf);
+
+	if (sscanf(kbuf, "%u %u", &nr_bins, &aggrs_per_frame) != 2 ||
+			nr_bins > DBGFS_HEATMAP_MAX_BINS ||
+			(nr_bins && !aggrs_per_frame)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&ctx->kdamond_lock);
+	if (ctx->kdamond) {
+		ret = -EBUSY;
+		goto unlock_out;
+	}
+
+	if (nr_bins) {
+		frame = kmalloc(sizeof(struct dbgfs_heatmap_frame) + nr_bins,
+				GFP_KERNEL);
+		if (!frame) {
+			ret = -ENOMEM;
+			goto unlock_out;
+		}
+	}
+
+	mutex_lock(&hm->lock);
+	if (nr_bins && !kfifo_initialized(&hm->ring) &&
+			kfifo_alloc(&hm->ring, DBGFS_HEATMAP_RING_SZ,
+				GFP_KERNEL)) {
+		mutex_unlock(&hm->lock);
+		kfree(frame);
+		ret = -ENOMEM;
+		goto unlock_out;
+	}
+	if (kfifo_initialized(&hm->ring))
+		kfifo_reset(&hm->ring);
+	kfree(hm->frame);
+	kfree(hm->acc);
+	hm->frame = frame;
+	hm->acc = NULL;
+	hm->nr_targets = 0;
+	hm->nr_aggrs = 0;
+	hm->nr_dropped = 0;
+	hm->nr_bins = nr_bins;
+	hm->aggrs_per_frame = aggrs_per_frame;
+	mutex_unlock(&hm->lock);
+	ret = count;
+
+unlock_out:
+	mutex_unlock(&ctx->kdamond_lock);
+out:
+	kfree(kbuf);
+	return ret;
+}
+
+static ssize_t dbgfs_heatmap_read(struct file *file,
+		char __user *buf, size_t count, loff_t *ppos)
+{
+	struct damon_ctx *ctx = file->private_data;
+	struct dbgfs_heatmap *hm = ctx->callback.private;
+	unsigned int copied;
+	size_t frame_sz;
+	ssize_t ret;
+
+	mutex_lock(&hm->lock);
+	if (!hm->nr_bins) {
+		ret = -ENODATA;
+		goto out;
+	}
+	frame_sz = dbgfs_heatmap_frame_sz(hm);
+	if (count < frame_sz) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	while (kfifo_is_empty(&hm->ring)) {
+		mutex_unlock(&hm->lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(hm->wait,
+				!kfifo_is_empty(&hm->ring));
+		if (ret)
+			return ret;
+		mutex_lock(&hm->lock);
+		if (!hm->nr_bins) {
+			ret = -ENODATA;
+			goto out;
+		}
+		frame_sz = dbgfs_heatmap_frame_sz(hm);
+	}
+
+	/* Only whole frames */
+	count = min_t(size_t, count, kfifo_len(&hm->ring));
+	count -= count % frame_sz;
+	ret = kfifo_to_user(&hm->ring, buf, count, &copied);
+	if (!ret)
+		ret = copied;
+out:
+	mutex_unlock(&hm->lock);
+	return ret;
+}
+
+static __poll_t dbgfs_heatmap_poll(struct file *file, poll_table *wait)
+{
+	struct damon_ctx *ctx = file->private_data;
+	struct dbgfs_heatmap *hm = ctx->callback.private;
+
+	poll_wait(file, &hm->wait, wait);
+	if (kfifo_initialized(&hm->ring) && !kfifo_is_empty(&hm->ring))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static struct dbgfs_heatmap *dbgfs_heatmap_new(void)
+{
+	struct dbgfs_heatmap *hm;
+
+	hm = kzalloc(sizeof(*hm), GFP_KERNEL);
+	if (!hm)
+		return NULL;
+
+	mutex_init(&hm->lock);
+	init_waitqueue_head(&hm->wait);
+	return hm;
+}
+
+static void dbgfs_heatmap_destroy(struct dbgfs_heatmap *hm)
+{
+	if (!hm)
+		return;
+
+	if (kfifo_initialized(&hm->ring))
+		kfifo_free(&hm->ring);
+	kfree(hm->acc);
+	kfree(hm->frame);
+	kfree(hm);
+}
+
 static int damon_dbgfs_open(struct inode *inode, struct file *file)
 {
 	file->private_data = inode->i_private;
@@ -644,12 +964,25 @@ static const struct file_operations kdamond_pid_fops = {
 	.read = dbgfs_kdamond_pid_read,
 };
 
+static const struct file_operations heatmap_attrs_fops = {
+	.open = damon_dbgfs_open,
+	.read = dbgfs_heatmap_attrs_read,
+	.write = dbgfs_heatmap_attrs_write,
+};
+
+static const struct file_operations heatmap_fops = {
+	.open = damon_dbgfs_open,
+	.read = dbgfs_heatmap_read,
+	.poll = dbgfs_heatmap_poll,
+};
+
 static void dbgfs_fill_ctx_dir(struct dentry *dir, struct damon_ctx *ctx)
 {
 	const char * const file_names[] = {"attrs", "schemes", "target_ids",
-		"init_regions", "kdamond_pid"};
+		"init_regions", "kdamond_pid", "heatmap_attrs", "heatmap"};
 	const struct file_operations *fops[] = {&attrs_fops, &schemes_fops,
-		&target_ids_fops, &init_regions_fops, &kdamond_pid_fops};
+		&target_ids_fops, &init_regions_fops, &kdamond_pid_fops,
+		&heatmap_attrs_fops, &heatmap_fops};
 	int i;
 
 	for (i = 0; i < ARRAY_SIZE(file_names); i++)
@@ -679,13 +1012,21 @@ static struct damon_ctx *dbgfs_new_ctx(void)
 	if (!ctx)
 		return NULL;
 
+	ctx->callback.private = dbgfs_heatmap_new();
+	if (!ctx->callback.private) {
+		damon_destroy_ctx(ctx);
+		return NULL;
+	}
+
 	damon_va_set_primitives(ctx);
 	ctx->callback.before_terminate = dbgfs_before_terminate;
+	ctx->callback.after_aggregation = dbgfs_heatmap_after_aggregation;
 	return ctx;
 }
 
 static void dbgfs_destroy_ctx(struct damon_ctx *ctx)
 {
+	dbgfs_heatmap_destroy(ctx->callback.private);
 	damon_destroy_ctx(ctx);
 }
 
@@ -975,7 +1316,7 @@ static int __init damon_dbgfs_init(void)
 
 	rc = __damon_dbgfs_init();
 	if (rc) {
-		kfree(dbgfs_ctxs[0]);
+		dbgfs_destroy_ctx(dbgfs_ctxs[0]);
 		kfree(dbgfs_ctxs);
 		pr_err("%s: dbgfs init failed\n", __func__);
 	}
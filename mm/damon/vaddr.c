@@ -14,6 +14,7 @@
 #include <linux/page_idle.h>
 #include <linux/pagewalk.h>
 #include <linux/sched/mm.h>
+#include <linux/workqueue.h>
 
 #include "prmtv-common.h"
 
@@ -455,11 +456,27 @@ static const struct mm_walk_ops damon_mkold_ops = {
 	.hugetlb_entry = damon_mkold_hugetlb_entry,
 };
 
+/* Caller should hold the mmap read lock of @mm */
 static void damon_va_mkold(struct mm_struct *mm, unsigned long addr)
 {
-	mmap_read_lock(mm);
+	mmap_assert_locked(mm);
 	walk_page_range(mm, addr, addr + 1, &damon_mkold_ops, NULL);
+}
+
+/*
+ * The sampling of a target holds its mmap read lock across all of its regions
+ * instead of taking it per sampled address.  Page faults of the target share
+ * the read lock, but mmap()/munmap() need it exclusively, so let a waiting
+ * writer in between the regions.
+ */
+static void damon_va_relax_mmap_lock(struct mm_struct *mm)
+{
+	if (!mmap_lock_is_contended(mm) && !need_resched())
+		return;
+
 	mmap_read_unlock(mm);
+	cond_resched();
+	mmap_read_lock(mm);
 }
 
 /*
@@ -474,22 +491,125 @@ static void __damon_va_prepare_access_check(struct damon_ctx *ctx,
 	damon_va_mkold(mm, r->sampling_addr);
 }
 
-static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+/*
+ * Result of the last page table walk of the access check.  Regions sharing
+ * the checked page reuse it instead of walking again.
+ */
+struct damon_va_access_cache {
+	struct mm_struct *mm;
+	unsigned long addr;
+	unsigned long page_sz;
+	bool accessed;
+};
+
+/*
+ * Sampling work of one set of the targets.  The set is every target whose
+ * index in the targets list modulo @nr equals @idx.
+ */
+struct damon_va_shard {
+	struct work_struct work;
+	struct damon_ctx *ctx;
+	unsigned int idx;
+	unsigned int nr;
+	bool check;
+	unsigned int max_nr_accesses;
+	struct damon_va_access_cache cache;
+};
+
+#define DAMON_VA_MAX_SHARDS	8
+
+static struct workqueue_struct *damon_va_wq;
+
+static void damon_va_prepare_access_checks_shard(struct damon_va_shard *s)
 {
 	struct damon_target *t;
 	struct mm_struct *mm;
 	struct damon_region *r;
+	unsigned int i = 0;
 
-	damon_for_each_target(t, ctx) {
+	damon_for_each_target(t, s->ctx) {
+		if (i++ % s->nr != s->idx)
+			continue;
 		mm = damon_get_mm(t);
 		if (!mm)
 			continue;
-		damon_for_each_region(r, t)
-			__damon_va_prepare_access_check(ctx, mm, r);
+		mmap_read_lock(mm);
+		damon_for_each_region(r, t) {
+			__damon_va_prepare_access_check(s->ctx, mm, r);
+			damon_va_relax_mmap_lock(mm);
+		}
+		mmap_read_unlock(mm);
 		mmput(mm);
 	}
 }
 
+static void damon_va_check_accesses_shard(struct damon_va_shard *s);
+
+static void damon_va_shard_fn(struct work_struct *work)
+{
+	struct damon_va_shard *s = container_of(work, struct damon_va_shard,
+			work);
+
+	if (s->check)
+		damon_va_check_accesses_shard(s);
+	else
+		damon_va_prepare_access_checks_shard(s);
+}
+
+/*
+ * Run the prepare (@check is false) or the check (@check is true) of the
+ * access sampling for all targets, sharded as &damon_ctx->nr_shards asks.
+ * The calling kdamond does the first shard by itself and waits for the
+ * others.  Returns the maximum nr_accesses of the checked regions.
+ */
+static unsigned int damon_va_sample(struct damon_ctx *ctx, bool check)
+{
+	struct damon_va_shard shards[DAMON_VA_MAX_SHARDS];
+	struct damon_target *t;
+	unsigned int nr_targets = 0;
+	unsigned int nr, i;
+	unsigned int max_nr_accesses = 0;
+
+	damon_for_each_target(t, ctx)
+		nr_targets++;
+
+	nr = min3(max(ctx->nr_shards, 1U), nr_targets,
+			(unsigned int)DAMON_VA_MAX_SHARDS);
+	if (!damon_va_wq || !nr)
+		nr = 1;
+
+	for (i = 0; i < nr; i++) {
+		shards[i] = (struct damon_va_shard){
+			.ctx = ctx,
+			.idx = i,
+			.nr = nr,
+			.check = check,
+			.cache = { .page_sz = PAGE_SIZE },
+		};
+		if (!i)
+			continue;
+		INIT_WORK_ONSTACK(&shards[i].work, damon_va_shard_fn);
+		queue_work(damon_va_wq, &shards[i].work);
+	}
+
+	damon_va_shard_fn(&shards[0].work);
+	max_nr_accesses = shards[0].max_nr_accesses;
+
+	for (i = 1; i < nr; i++) {
+		flush_work(&shards[i].work);
+		destroy_work_on_stack(&shards[i].work);
+		max_nr_accesses = max(shards[i].max_nr_accesses,
+				max_nr_accesses);
+	}
+
+	return max_nr_accesses;
+}
+
+static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+{
+	damon_va_sample(ctx, false);
+}
+
 struct damon_young_walk_private {
 	unsigned long *page_sz;
 	bool young;
@@ -590,6 +710,7 @@ static const struct mm_walk_ops damon_young_ops = {
 	.hugetlb_entry = damon_young_hugetlb_entry,
 };
 
+/* Caller should hold the mmap read lock of @mm */
 static bool damon_va_young(struct mm_struct *mm, unsigned long addr,
 		unsigned long *page_sz)
 {
@@ -598,9 +719,8 @@ static bool damon_va_young(struct mm_struct *mm, unsigned long addr,
 		.young = false,
 	};
 
-	mmap_read_lock(mm);
+	mmap_assert_locked(mm);
 	walk_page_range(mm, addr, addr + 1, &damon_young_ops, &arg);
-	mmap_read_unlock(mm);
 	return arg.young;
 }
 
@@ -611,48 +731,53 @@ static bool damon_va_young(struct mm_struct *mm, unsigned long addr,
  * r	the region to be checked
  */
 static void __damon_va_check_access(struct damon_ctx *ctx,
-			       struct mm_struct *mm, struct damon_region *r)
+			       struct mm_struct *mm, struct damon_region *r,
+			       struct damon_va_access_cache *last)
 {
-	static struct mm_struct *last_mm;
-	static unsigned long last_addr;
-	static unsigned long last_page_sz = PAGE_SIZE;
-	static bool last_accessed;
-
 	/* If the region is in the last checked page, reuse the result */
-	if (mm == last_mm && (ALIGN_DOWN(last_addr, last_page_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_page_sz))) {
-		if (last_accessed)
+	if (mm == last->mm && (ALIGN_DOWN(last->addr, last->page_sz) ==
+				ALIGN_DOWN(r->sampling_addr, last->page_sz))) {
+		if (last->accessed)
 			r->nr_accesses++;
 		return;
 	}
 
-	last_accessed = damon_va_young(mm, r->sampling_addr, &last_page_sz);
-	if (last_accessed)
+	last->accessed = damon_va_young(mm, r->sampling_addr, &last->page_sz);
+	if (last->accessed)
 		r->nr_accesses++;
 
-	last_mm = mm;
-	last_addr = r->sampling_addr;
+	last->mm = mm;
+	last->addr = r->sampling_addr;
 }
 
-static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+static void damon_va_check_accesses_shard(struct damon_va_shard *s)
 {
 	struct damon_target *t;
 	struct mm_struct *mm;
 	struct damon_region *r;
-	unsigned int max_nr_accesses = 0;
+	unsigned int i = 0;
 
-	damon_for_each_target(t, ctx) {
+	damon_for_each_target(t, s->ctx) {
+		if (i++ % s->nr != s->idx)
+			continue;
 		mm = damon_get_mm(t);
 		if (!mm)
 			continue;
+		mmap_read_lock(mm);
 		damon_for_each_region(r, t) {
-			__damon_va_check_access(ctx, mm, r);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+			__damon_va_check_access(s->ctx, mm, r, &s->cache);
+			s->max_nr_accesses = max(r->nr_accesses,
+					s->max_nr_accesses);
+			damon_va_relax_mmap_lock(mm);
 		}
+		mmap_read_unlock(mm);
 		mmput(mm);
 	}
+}
 
-	return max_nr_accesses;
+static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+{
+	return damon_va_sample(ctx, true);
 }
 
 /*
@@ -745,6 +870,20 @@ static int damon_va_scheme_score(struct damon_ctx *context,
 	return DAMOS_MAX_SCORE;
 }
 
+static int __init damon_va_initcall(void)
+{
+	/*
+	 * Sampling is time critical, and the kdamond waits for the shards, so
+	 * do not let them queue behind other works.
+	 */
+	damon_va_wq = alloc_workqueue("damon_va", WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!damon_va_wq)
+		pr_warn("no sampling workqueue, sharding disabled\n");
+
+	return 0;
+}
+subsys_initcall(damon_va_initcall);
+
 void damon_va_set_primitives(struct damon_ctx *ctx)
 {
 	ctx->primitive.init = damon_va_init;
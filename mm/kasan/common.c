@@ -149,6 +149,8 @@ void __kasan_cache_create(struct kmem_cache *cache, unsigned int *size,
 	 */
 	*flags |= SLAB_KASAN;
 
+	cache->kasan_info.is_untagged = kasan_hw_tags_cache_untagged(cache->name);
+
 	if (!kasan_stack_collection_enabled())
 		return;
 
@@ -250,17 +252,23 @@ void __kasan_poison_slab(struct page *page)
 
 	for (i = 0; i < compound_nr(page); i++)
 		page_kasan_tag_reset(page + i);
+	if (kasan_cache_untagged(page->slab_cache))
+		return;
 	kasan_poison(page_address(page), page_size(page),
 		     KASAN_KMALLOC_REDZONE, false);
 }
 
 void __kasan_unpoison_object_data(struct kmem_cache *cache, void *object)
 {
+	if (kasan_cache_untagged(cache))
+		return;
 	kasan_unpoison(object, cache->object_size, false);
 }
 
 void __kasan_poison_object_data(struct kmem_cache *cache, void *object)
 {
+	if (kasan_cache_untagged(cache))
+		return;
 	kasan_poison(object, round_up(cache->object_size, KASAN_GRANULE_SIZE),
 			KASAN_KMALLOC_REDZONE, false);
 }
@@ -316,6 +324,10 @@ void * __must_check __kasan_init_slab_obj(struct kmem_cache *cache,
 			__memset(alloc_meta, 0, sizeof(*alloc_meta));
 	}
 
+	/* Untagged caches keep the match-all tag of the slab page. */
+	if (kasan_cache_untagged(cache))
+		return (void *)object;
+
 	/* Tag is ignored in set_tag() without CONFIG_KASAN_SW/HW_TAGS */
 	object = set_tag(object, assign_tag(cache, object, true));
 
@@ -345,6 +357,16 @@ static inline bool ____kasan_slab_free(struct kmem_cache *cache, void *object,
 	if (unlikely(cache->flags & SLAB_TYPESAFE_BY_RCU))
 		return false;
 
+	/*
+	 * Untagged caches only keep the initialization that the tag setting
+	 * would have done.
+	 */
+	if (kasan_cache_untagged(cache)) {
+		if (init)
+			memset(object, 0, cache->object_size);
+		return false;
+	}
+
 	if (!kasan_byte_accessible(tagged_object)) {
 		kasan_report_invalid_free(tagged_object, ip);
 		return true;
@@ -443,6 +465,12 @@ void * __must_check __kasan_slab_alloc(struct kmem_cache *cache,
 	if (is_kfence_address(object))
 		return (void *)object;
 
+	if (kasan_cache_untagged(cache)) {
+		if (init)
+			memset(object, 0, cache->object_size);
+		return (void *)object;
+	}
+
 	/*
 	 * Generate and assign random tag for tag-based modes.
 	 * Tag is ignored in set_tag() for the generic mode.
@@ -478,6 +506,9 @@ static inline void *____kasan_kmalloc(struct kmem_cache *cache,
 	if (is_kfence_address(kasan_reset_tag(object)))
 		return (void *)object;
 
+	if (kasan_cache_untagged(cache))
+		return (void *)object;
+
 	/*
 	 * The object has already been unpoisoned by kasan_slab_alloc() for
 	 * kmalloc() or by kasan_krealloc() for krealloc().
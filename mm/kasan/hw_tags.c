@@ -62,6 +62,12 @@ DEFINE_STATIC_KEY_FALSE(kasan_flag_stacktrace);
 /* Whether to panic or print a report and disable tag checking on fault. */
 bool kasan_flag_panic __ro_after_init;
 
+/* Comma-separated names of the slab caches whose objects are not tagged. */
+static char kasan_skip_caches[256] __ro_after_init;
+
+/* Page allocations of this order or higher are not tagged. */
+static unsigned int kasan_skip_order __ro_after_init = MAX_ORDER;
+
 /* kasan=off/on */
 static int __init early_kasan_flag(char *arg)
 {
@@ -130,6 +136,28 @@ static int __init early_kasan_fault(char *arg)
 }
 early_param("kasan.fault", early_kasan_fault);
 
+/* kasan.skip_caches=<cache>[,<cache>...] */
+static int __init early_kasan_skip_caches(char *arg)
+{
+	if (!arg)
+		return -EINVAL;
+
+	strscpy(kasan_skip_caches, arg, sizeof(kasan_skip_caches));
+
+	return 0;
+}
+early_param("kasan.skip_caches", early_kasan_skip_caches);
+
+/* kasan.skip_order=<order> */
+static int __init early_kasan_skip_order(char *arg)
+{
+	if (!arg)
+		return -EINVAL;
+
+	return kstrtouint(arg, 0, &kasan_skip_order);
+}
+early_param("kasan.skip_order", early_kasan_skip_order);
+
 /* kasan_init_hw_tags_cpu() is called for each CPU. */
 void kasan_init_hw_tags_cpu(void)
 {
@@ -214,6 +242,28 @@ void __init kasan_init_hw_tags(void)
 	pr_info("KernelAddressSanitizer initialized\n");
 }
 
+bool kasan_hw_tags_cache_untagged(const char *name)
+{
+	const char *p = kasan_skip_caches;
+	size_t len;
+
+	if (!name || !*p)
+		return false;
+
+	len = strlen(name);
+	while (*p) {
+		const char *tok = p;
+
+		p = strchrnul(p, ',');
+		if (p - tok == len && !strncmp(tok, name, len))
+			return true;
+		if (*p)
+			p++;
+	}
+
+	return false;
+}
+
 void kasan_set_free_info(struct kmem_cache *cache,
 				void *object, u8 tag)
 {
@@ -252,6 +302,15 @@ void kasan_alloc_pages(struct page *page, unsigned int order, gfp_t flags)
 
 		for (i = 0; i != 1 << order; ++i)
 			tag_clear_highpage(page + i);
+	} else if (order >= kasan_skip_order) {
+		int i;
+
+		/* Match-all page tag, and only the initialization. */
+		for (i = 0; i != 1 << order; ++i) {
+			page_kasan_tag_reset(page + i);
+			if (init)
+				clear_highpage(page + i);
+		}
 	} else {
 		kasan_unpoison_pages(page, order, init);
 	}
@@ -265,6 +324,16 @@ void kasan_free_pages(struct page *page, unsigned int order)
 	 */
 	bool init = want_init_on_free();
 
+	if (order >= kasan_skip_order) {
+		int i;
+
+		if (init) {
+			for (i = 0; i != 1 << order; ++i)
+				clear_highpage(page + i);
+		}
+		return;
+	}
+
 	kasan_poison_pages(page, order, init);
 }
 
@@ -24,6 +24,14 @@ static inline bool kasan_async_mode_enabled(void)
 {
 	return kasan_flag_async;
 }
+
+bool kasan_hw_tags_cache_untagged(const char *name);
+
+/* Whether objects of @cache are left untagged (kasan.skip_caches). */
+static inline bool kasan_cache_untagged(struct kmem_cache *cache)
+{
+	return cache->kasan_info.is_untagged;
+}
 #else
 
 static inline bool kasan_stack_collection_enabled(void)
@@ -36,6 +44,16 @@ static inline bool kasan_async_mode_enabled(void)
 	return false;
 }
 
+static inline bool kasan_hw_tags_cache_untagged(const char *name)
+{
+	return false;
+}
+
+static inline bool kasan_cache_untagged(struct kmem_cache *cache)
+{
+	return false;
+}
+
 #endif
 
 extern bool kasan_flag_panic __ro_after_init;
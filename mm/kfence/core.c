@@ -81,6 +81,30 @@ static const struct kernel_param_ops sample_interval_param_ops = {
 };
 module_param_cb(sample_interval, &sample_interval_param_ops, &kfence_sample_interval, 0600);
 
+/*
+ * Upper bound of the adaptive sample interval in milliseconds; 0 keeps the interval fixed at
+ * kfence_sample_interval. While allocations are frequent enough that every opened gate is taken
+ * right away, or the pool is mostly used up, the interval backs off (doubles) towards this; it
+ * returns towards kfence_sample_interval once the gate has to wait for an allocation again.
+ */
+static unsigned long kfence_sample_interval_max __read_mostly;
+module_param_named(sample_interval_max, kfence_sample_interval_max, ulong, 0600);
+
+/* The interval currently used by the allocation gate timer. */
+static unsigned long kfence_cur_interval;
+
+/*
+ * Comma-separated names of the slab caches to sample; empty samples all caches. This is read
+ * locklessly by __kfence_alloc(), which only bounds how far it looks into the buffer: a sample
+ * racing with an update may just be taken from the wrong cache.
+ */
+static char kfence_caches[256];
+static struct kparam_string kfence_caches_kps = {
+	.maxlen = sizeof(kfence_caches),
+	.string = kfence_caches,
+};
+module_param_cb(caches, &param_ops_string, &kfence_caches_kps, 0600);
+
 /* The pool of pages used for guard pages and objects. */
 char *__kfence_pool __ro_after_init;
 EXPORT_SYMBOL(__kfence_pool); /* Export for test modules. */
@@ -514,6 +538,7 @@ static int stats_show(struct seq_file *seq, void *v)
 	int i;
 
 	seq_printf(seq, "enabled: %i\n", READ_ONCE(kfence_enabled));
+	seq_printf(seq, "sample interval: %lu\n", READ_ONCE(kfence_cur_interval));
 	for (i = 0; i < KFENCE_COUNTER_COUNT; i++)
 		seq_printf(seq, "%s: %ld\n", counter_names[i], atomic_long_read(&counters[i]));
 
@@ -612,9 +637,35 @@ static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
  * avoids IPIs, at the cost of not immediately capturing allocations if the
  * instructions remain cached.
  */
+/*
+ * Pick the next sample interval. @busy tells that the last gate was taken without the timer
+ * having to wait, i.e. that allocations are frequent enough for the toggling itself to be the
+ * main cost.
+ */
+static unsigned long next_sample_interval(bool busy)
+{
+	unsigned long base = READ_ONCE(kfence_sample_interval);
+	unsigned long limit = READ_ONCE(kfence_sample_interval_max);
+	unsigned long cur = kfence_cur_interval;
+
+	if (limit <= base) {
+		cur = base;
+	} else if (busy || atomic_long_read(&counters[KFENCE_COUNTER_ALLOCATED]) >
+			  CONFIG_KFENCE_NUM_OBJECTS * 3 / 4) {
+		cur = min(max(cur, base) * 2, limit);
+	} else {
+		cur = max(cur / 2, base);
+	}
+
+	WRITE_ONCE(kfence_cur_interval, cur);
+	return cur;
+}
+
 static struct delayed_work kfence_timer;
 static void toggle_allocation_gate(struct work_struct *work)
 {
+	bool busy = false;
+
 	if (!READ_ONCE(kfence_enabled))
 		return;
 
@@ -623,6 +674,9 @@ static void toggle_allocation_gate(struct work_struct *work)
 	/* Enable static key, and await allocation to happen. */
 	static_branch_enable(&kfence_allocation_key);
 
+	/* Taken already while the key was being enabled. */
+	busy = atomic_read(&kfence_allocation_gate);
+
 	if (sysctl_hung_task_timeout_secs) {
 		/*
 		 * During low activity with no allocations we might wait a
@@ -638,7 +692,7 @@ static void toggle_allocation_gate(struct work_struct *work)
 	static_branch_disable(&kfence_allocation_key);
 #endif
 	queue_delayed_work(system_unbound_wq, &kfence_timer,
-			   msecs_to_jiffies(kfence_sample_interval));
+			   msecs_to_jiffies(next_sample_interval(busy)));
 }
 static DECLARE_DELAYED_WORK(kfence_timer, toggle_allocation_gate);
 
@@ -667,6 +721,7 @@ void __init kfence_init(void)
 	}
 
 	WRITE_ONCE(kfence_enabled, true);
+	kfence_cur_interval = kfence_sample_interval;
 	queue_delayed_work(system_unbound_wq, &kfence_timer, 0);
 	pr_info("initialized - using %lu bytes for %d objects at 0x%p-0x%p\n", KFENCE_POOL_SIZE,
 		CONFIG_KFENCE_NUM_OBJECTS, (void *)__kfence_pool,
@@ -732,6 +787,30 @@ void kfence_shutdown_cache(struct kmem_cache *s)
 	}
 }
 
+/* Whether @s is one of the caches in kfence_caches, if any are given. */
+static bool kfence_cache_targeted(struct kmem_cache *s)
+{
+	const char *p = kfence_caches, *end = kfence_caches + sizeof(kfence_caches);
+	size_t len;
+
+	if (!READ_ONCE(kfence_caches[0]))
+		return true;
+
+	len = strlen(s->name);
+	while (p < end && *p) {
+		const char *tok = p;
+
+		while (p < end && *p && *p != ',' && *p != '\n')
+			p++;
+		if (p - tok == len && !memcmp(tok, s->name, len))
+			return true;
+		if (p < end && *p)
+			p++;
+	}
+
+	return false;
+}
+
 void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 {
 	/*
@@ -750,6 +829,10 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	    (s->flags & (SLAB_CACHE_DMA | SLAB_CACHE_DMA32)))
 		return NULL;
 
+	/* Leave the gate open for the chosen caches, if any. */
+	if (!kfence_cache_targeted(s))
+		return NULL;
+
 	/*
 	 * allocation_gate only needs to become non-zero, so it doesn't make
 	 * sense to continue writing to it and pay the associated contention
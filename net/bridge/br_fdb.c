@@ -15,6 +15,7 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/jhash.h>
+#include <linux/hash.h>
 #include <linux/random.h>
 #include <linux/slab.h>
 #include <linux/atomic.h>
@@ -56,12 +57,24 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
-	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	int err;
+
+	br->fdb_pcpu_cache = __alloc_percpu(sizeof(struct br_fdb_pcpu_entry) *
+					    BR_FDB_PCPU_SIZE,
+					    __alignof__(struct br_fdb_pcpu_entry));
+	if (!br->fdb_pcpu_cache)
+		return -ENOMEM;
+
+	err = rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	if (err)
+		free_percpu(br->fdb_pcpu_cache);
+	return err;
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_pcpu_cache);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -148,6 +161,38 @@ struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 	return fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
 }
 
+/* Forwarding lookup through a small per-CPU cache in front of the hash
+ * table. A cached entry is only used while fdb_gen is what it was when it
+ * was filled in: fdb_delete() bumps it (a release, paired with the acquire
+ * here) before the deleted entry's grace period starts, so the cache
+ * never hands out an entry that was deleted since. Must be called with
+ * BH disabled.
+ */
+struct net_bridge_fdb_entry *br_fdb_find_fwd(struct net_bridge *br,
+					     const unsigned char *addr,
+					     __u16 vid)
+{
+	u32 gen = smp_load_acquire(&br->fdb_gen);
+	struct net_bridge_fdb_entry *fdb;
+	struct br_fdb_pcpu_entry *e;
+	u32 hash;
+
+	hash = hash_32(get_unaligned((const u32 *)(addr + 2)) ^ vid,
+		       BR_FDB_PCPU_BITS);
+	e = this_cpu_ptr(br->fdb_pcpu_cache) + hash;
+	if (e->fdb && e->gen == gen && e->key.vlan_id == vid &&
+	    ether_addr_equal(e->key.addr.addr, addr))
+		return e->fdb;
+
+	fdb = fdb_find_rcu(&br->fdb_hash_tbl, addr, vid);
+	if (fdb) {
+		e->key = fdb->key;
+		e->gen = gen;
+		e->fdb = fdb;
+	}
+	return fdb;
+}
+
 /* When a static FDB entry is added, the mac address from the entry is
  * added to the bridge private HW address list and all required ports
  * are then updated with the new information.
@@ -204,6 +249,7 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f,
 	hlist_del_init_rcu(&f->fdb_node);
 	rhashtable_remove_fast(&br->fdb_hash_tbl, &f->rhnode,
 			       br_fdb_rht_params);
+	smp_store_release(&br->fdb_gen, br->fdb_gen + 1);
 	fdb_notify(br, f, RTM_DELNEIGH, swdev_notify);
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
@@ -594,7 +640,7 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			if (br_fdb_stamp_due(fdb->updated, now)) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
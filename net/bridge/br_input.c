@@ -147,7 +147,7 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		}
 		break;
 	case BR_PKT_UNICAST:
-		dst = br_fdb_find_rcu(br, eth_hdr(skb)->h_dest, vid);
+		dst = br_fdb_find_fwd(br, eth_hdr(skb)->h_dest, vid);
 	default:
 		break;
 	}
@@ -158,7 +158,7 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb);
 
-		if (now != dst->used)
+		if (br_fdb_stamp_due(dst->used, now))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
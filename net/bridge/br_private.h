@@ -210,6 +210,26 @@ struct net_bridge_fdb_entry {
 	struct rcu_head			rcu;
 };
 
+/* Per-CPU cache of recent forwarding lookups, see br_fdb_find_fwd() */
+#define BR_FDB_PCPU_BITS	6
+#define BR_FDB_PCPU_SIZE	(1 << BR_FDB_PCPU_BITS)
+
+struct br_fdb_pcpu_entry {
+	struct net_bridge_fdb_key	key;
+	u32				gen;
+	struct net_bridge_fdb_entry	*fdb;
+};
+
+/* Stamp fdb->updated and fdb->used at most this often, so the entries of
+ * busy stations don't bounce between the CPUs their frames arrive on.
+ */
+#define BR_FDB_STAMP_INTERVAL	(HZ / 10)
+
+static inline bool br_fdb_stamp_due(unsigned long stamp, unsigned long now)
+{
+	return time_after(now, stamp + BR_FDB_STAMP_INTERVAL);
+}
+
 #define MDB_PG_FLAGS_PERMANENT	BIT(0)
 #define MDB_PG_FLAGS_OFFLOAD	BIT(1)
 #define MDB_PG_FLAGS_FAST_LEAVE	BIT(2)
@@ -395,6 +415,8 @@ struct net_bridge {
 #endif
 
 	struct rhashtable		fdb_hash_tbl;
+	struct br_fdb_pcpu_entry	__percpu *fdb_pcpu_cache;
+	u32				fdb_gen;	/* bumped on delete */
 #if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
 	union {
 		struct rtable		fake_rtable;
@@ -687,6 +709,9 @@ void br_fdb_delete_by_port(struct net_bridge *br,
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
 					     const unsigned char *addr,
 					     __u16 vid);
+struct net_bridge_fdb_entry *br_fdb_find_fwd(struct net_bridge *br,
+					     const unsigned char *addr,
+					     __u16 vid);
 int br_fdb_test_addr(struct net_device *dev, unsigned char *addr);
 int br_fdb_fillbuf(struct net_bridge *br, void *buf, unsigned long count,
 		   unsigned long off);
@@ -457,6 +457,100 @@ static void mptcp_check_data_fin(struct sock *sk)
 	}
 }
 
+/* Fast path for the common single-path bulk transfer: move a run of whole,
+ * in-sequence skbs covered by the current mapping with one memory charge
+ * and one ack_seq/copied_seq update, and no coalescing past the first one.
+ * Returns the number of bytes moved, 0 if the run is too short to bother.
+ */
+static unsigned int __mptcp_move_skbs_bulk(struct mptcp_sock *msk,
+					   struct sock *ssk,
+					   u32 map_remaining)
+{
+	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
+	struct sock *sk = (struct sock *)msk;
+	struct tcp_sock *tp = tcp_sk(ssk);
+	unsigned int len = 0, truesize = 0;
+	struct sk_buff *skb, *first, *tail;
+	struct sk_buff_head batch;
+	u32 seq = tp->copied_seq;
+	int rmem, nr = 0;
+	u64 map_seq;
+
+	if (tp->urg_data || __mptcp_check_fallback(msk))
+		return 0;
+
+	map_seq = mptcp_subflow_get_mapped_dsn(subflow);
+	if (map_seq != msk->ack_seq)
+		return 0;
+
+	rmem = atomic_read(&sk->sk_rmem_alloc);
+	skb_queue_walk(&ssk->sk_receive_queue, skb) {
+		if (TCP_SKB_CB(skb)->seq != seq ||
+		    (TCP_SKB_CB(skb)->tcp_flags & TCPHDR_FIN) ||
+		    len + skb->len > map_remaining ||
+		    rmem + truesize + skb->truesize > READ_ONCE(sk->sk_rcvbuf))
+			break;
+
+		len += skb->len;
+		truesize += skb->truesize;
+		seq += skb->len;
+		nr++;
+	}
+	if (nr < 2)
+		return 0;
+
+	first = skb_peek(&ssk->sk_receive_queue);
+	if (!sk_rmem_schedule(sk, first, truesize)) {
+		int amount = sk_mem_pages(truesize) << SK_MEM_QUANTUM_SHIFT;
+
+		if (ssk->sk_forward_alloc < amount)
+			return 0;
+
+		ssk->sk_forward_alloc -= amount;
+		sk->sk_forward_alloc += amount;
+	}
+
+	__skb_queue_head_init(&batch);
+	while (nr--) {
+		skb = __skb_dequeue(&ssk->sk_receive_queue);
+		skb_ext_reset(skb);
+		skb_orphan(skb);
+
+		MPTCP_SKB_CB(skb)->map_seq = map_seq;
+		MPTCP_SKB_CB(skb)->end_seq = map_seq + skb->len;
+		MPTCP_SKB_CB(skb)->offset = 0;
+		map_seq += skb->len;
+		__skb_queue_tail(&batch, skb);
+	}
+
+	/* a successful coalesce charges its own delta */
+	tail = skb_peek_tail(&sk->sk_receive_queue);
+	if (tail) {
+		unsigned int first_truesize;
+
+		first = __skb_dequeue(&batch);
+		first_truesize = first->truesize;
+		if (mptcp_try_coalesce(sk, tail, first))
+			truesize -= first_truesize;
+		else
+			__skb_queue_head(&batch, first);
+	}
+
+	/* open-coded skb_set_owner_r(), charged once below */
+	skb_queue_walk(&batch, skb) {
+		skb->sk = sk;
+		skb->destructor = sock_rfree;
+	}
+	atomic_add(truesize, &sk->sk_rmem_alloc);
+	sk_mem_charge(sk, truesize);
+
+	skb_queue_splice_tail_init(&batch, &sk->sk_receive_queue);
+
+	WRITE_ONCE(msk->ack_seq, msk->ack_seq + len);
+	WRITE_ONCE(tp->copied_seq, seq);
+	return len;
+}
+
 static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 					   struct sock *ssk,
 					   unsigned int *bytes)
@@ -500,6 +594,20 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 			 */
 			map_remaining = skb->len;
 			subflow->map_data_len = skb->len;
+		} else if (map_remaining > skb->len) {
+			unsigned int bulk;
+
+			bulk = __mptcp_move_skbs_bulk(msk, ssk, map_remaining);
+			if (bulk) {
+				moved += bulk;
+				more_data_avail = mptcp_subflow_data_available(ssk);
+				if (atomic_read(&sk->sk_rmem_alloc) >
+				    READ_ONCE(sk->sk_rcvbuf)) {
+					done = true;
+					break;
+				}
+				continue;
+			}
 		}
 
 		offset = seq - TCP_SKB_CB(skb)->seq;
@@ -1061,7 +1169,7 @@ static void mptcp_nospace(struct mptcp_sock *msk)
 	}
 }
 
-static bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
+bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 {
 	struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
 
@@ -1079,20 +1187,11 @@ static bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 					 sizeof(struct ipv6hdr) - \
 					 sizeof(struct frag_hdr))
 
-struct subflow_send_info {
-	struct sock *ssk;
-	u64 ratio;
-};
-
 static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk,
 					   u32 *sndbuf)
 {
-	struct subflow_send_info send_info[2];
 	struct mptcp_subflow_context *subflow;
-	int i, nr_active = 0;
 	struct sock *ssk;
-	u64 ratio;
-	u32 pace;
 
 	sock_owned_by_me((struct sock *)msk);
 
@@ -1118,48 +1217,99 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk,
 		return msk->last_snd;
 	}
 
-	/* pick the subflow with the lower wmem/wspace ratio */
-	for (i = 0; i < 2; ++i) {
-		send_info[i].ssk = NULL;
-		send_info[i].ratio = -1;
-	}
 	mptcp_for_each_subflow(msk, subflow) {
 		ssk =  mptcp_subflow_tcp_sock(subflow);
-		if (!mptcp_subflow_active(subflow))
-			continue;
+		if (mptcp_subflow_active(subflow))
+			*sndbuf = max(tcp_sk(ssk)->snd_wnd, *sndbuf);
+	}
 
-		nr_active += !subflow->backup;
-		*sndbuf = max(tcp_sk(ssk)->snd_wnd, *sndbuf);
-		if (!sk_stream_memory_free(subflow->tcp_sock))
-			continue;
+	ssk = msk->sched->get_send(msk);
+	if (ssk) {
+		msk->last_snd = ssk;
+		msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
+				       sk_stream_wspace(msk->last_snd));
+		return msk->last_snd;
+	}
+	return NULL;
+}
 
-		pace = READ_ONCE(ssk->sk_pacing_rate);
-		if (!pace)
-			continue;
+/* Duplicate the @len bytes written from data sequence @seq onwards on the
+ * subflow the scheduler picks, if any, in addition to @ssk. The peer drops
+ * whichever copy arrives second at the MPTCP level.
+ */
+static void mptcp_send_redundant(struct sock *sk, struct sock *ssk,
+				 u64 seq, size_t len)
+{
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	int mss_now = 0, size_goal = 0, ret = 0;
+	struct mptcp_data_frag *dfrag, *first;
+	struct msghdr msg = {
+		.msg_flags = MSG_DONTWAIT,
+	};
+	struct sock *rssk;
+	size_t copied = 0;
+	long timeo = 0;
 
-		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
-				pace);
-		if (ratio < send_info[subflow->backup].ratio) {
-			send_info[subflow->backup].ssk = ssk;
-			send_info[subflow->backup].ratio = ratio;
-		}
+	if (!msk->sched->get_redundant || __mptcp_check_fallback(msk))
+		return;
+
+	rssk = msk->sched->get_redundant(msk, ssk, len);
+	if (!rssk || !mptcp_ext_cache_refill(msk))
+		return;
+
+	/* the data just written sits at the tail of the rtx queue */
+	first = NULL;
+	list_for_each_entry_reverse(dfrag, &msk->rtx_queue, list) {
+		first = dfrag;
+		if (!before64(seq, dfrag->data_seq))
+			break;
 	}
+	if (!first)
+		return;
 
-	pr_debug("msk=%p nr_active=%d ssk=%p:%lld backup=%p:%lld",
-		 msk, nr_active, send_info[0].ssk, send_info[0].ratio,
-		 send_info[1].ssk, send_info[1].ratio);
+	lock_sock(rssk);
+	dfrag = first;
+	list_for_each_entry_from(dfrag, &msk->rtx_queue, list) {
+		u64 orig_write_seq = dfrag->data_seq;
+		int orig_offset = dfrag->offset;
+		int orig_len = dfrag->data_len;
+		int skip = 0;
+
+		if (before64(dfrag->data_seq, seq))
+			skip = min_t(u64, seq - dfrag->data_seq, dfrag->data_len);
+		dfrag->data_seq += skip;
+		dfrag->offset += skip;
+		dfrag->data_len -= skip;
+
+		while (dfrag->data_len > 0) {
+			ret = mptcp_sendmsg_frag(sk, rssk, &msg, dfrag, &timeo,
+						 &mss_now, &size_goal);
+			if (ret < 0)
+				break;
 
-	/* pick the best backup if no other subflow is active */
-	if (!nr_active)
-		send_info[0].ssk = send_info[1].ssk;
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_REDUNDANTSEGS);
+			copied += ret;
+			dfrag->data_len -= ret;
+			dfrag->offset += ret;
 
-	if (send_info[0].ssk) {
-		msk->last_snd = send_info[0].ssk;
-		msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
-				       sk_stream_wspace(msk->last_snd));
-		return msk->last_snd;
+			if (!mptcp_ext_cache_refill(msk)) {
+				ret = -ENOMEM;
+				break;
+			}
+		}
+
+		dfrag->data_seq = orig_write_seq;
+		dfrag->offset = orig_offset;
+		dfrag->data_len = orig_len;
+		if (ret < 0)
+			break;
 	}
-	return NULL;
+	if (copied)
+		tcp_push(rssk, msg.msg_flags, mss_now, tcp_sk(rssk)->nonagle,
+			 size_goal);
+
+	mptcp_set_timeout(sk, rssk);
+	release_sock(rssk);
 }
 
 static void ssk_check_wmem(struct mptcp_sock *msk)
@@ -1175,6 +1325,7 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 	struct page_frag *pfrag;
 	size_t copied = 0;
 	struct sock *ssk;
+	u64 start_seq;
 	u32 sndbuf;
 	bool tx_ok;
 	long timeo;
@@ -1183,6 +1334,7 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 		return -EOPNOTSUPP;
 
 	lock_sock(sk);
+	start_seq = msk->write_seq;
 
 	timeo = sock_sndtimeo(sk, msg->msg_flags & MSG_DONTWAIT);
 
@@ -1315,6 +1467,10 @@ static int mptcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 	}
 
 	release_sock(ssk);
+
+	/* the scheduler decides which writes are small enough */
+	if (copied && !(msg->msg_flags & MSG_MORE))
+		mptcp_send_redundant(sk, ssk, start_seq, copied);
 out:
 	ssk_check_wmem(msk);
 	release_sock(sk);
@@ -1845,6 +2001,7 @@ static int __mptcp_init_sock(struct sock *sk)
 	inet_csk(sk)->icsk_sync_mss = mptcp_sync_mss;
 
 	mptcp_pm_data_init(msk);
+	mptcp_init_sched(msk);
 
 	/* re-use the csk retrans timer for MPTCP-level retrans */
 	timer_setup(&msk->sk.icsk_retransmit_timer, mptcp_retransmit_timer, 0);
@@ -2184,6 +2341,7 @@ void mptcp_destroy_common(struct mptcp_sock *msk)
 	skb_rbtree_purge(&msk->out_of_order_queue);
 	mptcp_token_destroy(msk);
 	mptcp_pm_free_anno_list(msk);
+	mptcp_release_sched(msk);
 }
 
 static void mptcp_destroy(struct sock *sk)
@@ -2825,6 +2983,7 @@ void __init mptcp_proto_init(void)
 
 	mptcp_subflow_init();
 	mptcp_pm_init();
+	mptcp_sched_init();
 	mptcp_token_init();
 
 	if (proto_register(&mptcp_prot, 1) != 0)
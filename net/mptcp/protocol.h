@@ -193,6 +193,29 @@ struct mptcp_data_frag {
 	struct page *page;
 };
 
+struct mptcp_sock;
+
+#define MPTCP_SCHED_NAME_MAX	16
+
+/* Data-level subflow scheduler, picked per connection from
+ * net.mptcp.scheduler when the msk is created.
+ */
+struct mptcp_sched_ops {
+	/* subflow for new data among the active ones, NULL if none */
+	struct sock *(*get_send)(struct mptcp_sock *msk);
+	/* optional: second subflow to duplicate @len bytes just sent on
+	 * @ssk, for small latency-critical writes
+	 */
+	struct sock *(*get_redundant)(struct mptcp_sock *msk,
+				      struct sock *ssk, size_t len);
+	void (*init)(struct mptcp_sock *msk);
+	void (*release)(struct mptcp_sock *msk);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+};
+
 /* MPTCP connection sock */
 struct mptcp_sock {
 	/* inet_connection_sock must be the first member */
@@ -224,6 +247,7 @@ struct mptcp_sock {
 	struct socket	*subflow; /* outgoing connect/listener/!mp_capable */
 	struct sock	*first;
 	struct mptcp_pm_data	pm;
+	const struct mptcp_sched_ops *sched;
 	struct {
 		u32	space;	/* bytes copied in last measurement window */
 		u32	copied; /* bytes copied in this measurement window */
@@ -362,6 +386,9 @@ mptcp_subflow_get_mapped_dsn(const struct mptcp_subflow_context *subflow)
 }
 
 int mptcp_is_enabled(struct net *net);
+const char *mptcp_get_scheduler(struct net *net);
+int mptcp_sched_energy_cost(struct net *net);
+int mptcp_sched_redundant_max(struct net *net);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     struct mptcp_options_received *mp_opt);
 bool mptcp_subflow_data_available(struct sock *sk);
@@ -399,6 +426,7 @@ void mptcp_get_options(const struct sk_buff *skb,
 		       struct mptcp_options_received *mp_opt);
 
 void mptcp_finish_connect(struct sock *sk);
+bool mptcp_subflow_active(struct mptcp_subflow_context *subflow);
 static inline bool mptcp_is_fully_established(struct sock *sk)
 {
 	return inet_sk_state_load(sk) == TCP_ESTABLISHED &&
@@ -433,6 +461,14 @@ void mptcp_crypto_key_sha(u64 key, u32 *token, u64 *idsn);
 
 void mptcp_crypto_hmac_sha(u64 key1, u64 key2, u8 *msg, int len, void *hmac);
 
+void __init mptcp_sched_init(void);
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_init_sched(struct mptcp_sock *msk);
+void mptcp_release_sched(struct mptcp_sock *msk);
+bool mptcp_sched_exists(const char *name);
+void __init mptcp_sched_energy_init(void);
+
 void __init mptcp_pm_init(void);
 void mptcp_pm_data_init(struct mptcp_sock *msk);
 void mptcp_pm_new_connection(struct mptcp_sock *msk, int server_side);
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * "energy" scheduler: send on the subflow with the lowest expected
+ * delivery delay weighted by the energy cost of its interface, so bulk
+ * data stays on Wi-Fi while it keeps up and moves to the cellular radio
+ * only when Wi-Fi stalls or degrades. Small writes are duplicated on the
+ * fastest other subflow, so a handover does not delay them.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/netdevice.h>
+#include <net/dst.h>
+
+#include "protocol.h"
+
+/* Wi-Fi costs 1; any other radio net.mptcp.sched_energy_cost */
+static u32 mptcp_energy_cost(const struct sock *ssk)
+{
+	struct dst_entry *dst;
+	u32 cost = 1;
+
+	rcu_read_lock();
+	dst = __sk_dst_get((struct sock *)ssk);
+	if (dst && dst->dev && !dst->dev->ieee80211_ptr &&
+	    !(dst->dev->flags & IFF_LOOPBACK))
+		cost = mptcp_sched_energy_cost(sock_net(ssk));
+	rcu_read_unlock();
+
+	return cost;
+}
+
+/* srtt plus the time to drain what is already queued, in usec */
+static u64 mptcp_energy_delay(const struct sock *ssk)
+{
+	const struct tcp_sock *tp = tcp_sk(ssk);
+	u32 pace = READ_ONCE(ssk->sk_pacing_rate);
+	u64 delay = tp->srtt_us >> 3;
+
+	if (pace)
+		delay += div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) *
+				 USEC_PER_SEC, pace);
+	return delay;
+}
+
+static bool mptcp_energy_has_room(const struct sock *ssk)
+{
+	const struct tcp_sock *tp = tcp_sk(ssk);
+
+	return sk_stream_memory_free(ssk) &&
+	       tcp_packets_in_flight(tp) < tp->snd_cwnd;
+}
+
+/* Pick the lowest cost * delay subflow with cwnd headroom. Without any
+ * headroom anywhere, fall back to the lowest delay one that can still
+ * queue data. Backup subflows are used only if nothing else is active.
+ */
+static struct sock *mptcp_energy_get_send(struct mptcp_sock *msk)
+{
+	struct sock *best = NULL, *queue = NULL, *backup = NULL;
+	u64 best_score = U64_MAX, queue_delay = U64_MAX;
+	struct mptcp_subflow_context *subflow;
+	int nr_active = 0;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+		u64 delay, score;
+
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		if (subflow->backup) {
+			if (!backup && sk_stream_memory_free(ssk))
+				backup = ssk;
+			continue;
+		}
+
+		nr_active++;
+		if (!sk_stream_memory_free(ssk))
+			continue;
+
+		delay = mptcp_energy_delay(ssk);
+		if (delay < queue_delay) {
+			queue = ssk;
+			queue_delay = delay;
+		}
+
+		if (!mptcp_energy_has_room(ssk))
+			continue;
+
+		score = delay * mptcp_energy_cost(ssk);
+		if (score < best_score) {
+			best = ssk;
+			best_score = score;
+		}
+	}
+
+	pr_debug("msk=%p best=%p:%llu queue=%p backup=%p", msk, best,
+		 best_score, queue, backup);
+
+	if (!nr_active)
+		return backup;
+	return best ? : queue;
+}
+
+static struct sock *mptcp_energy_get_redundant(struct mptcp_sock *msk,
+					       struct sock *ssk, size_t len)
+{
+	struct mptcp_subflow_context *subflow;
+	u64 best_delay = U64_MAX;
+	struct sock *best = NULL;
+
+	if (len > mptcp_sched_redundant_max(sock_net((struct sock *)msk)))
+		return NULL;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *other = mptcp_subflow_tcp_sock(subflow);
+		u64 delay;
+
+		if (other == ssk || subflow->backup ||
+		    !mptcp_subflow_active(subflow) ||
+		    !mptcp_energy_has_room(other))
+			continue;
+
+		delay = mptcp_energy_delay(other);
+		if (delay < best_delay) {
+			best = other;
+			best_delay = delay;
+		}
+	}
+
+	return best;
+}
+
+static struct mptcp_sched_ops mptcp_sched_energy = {
+	.get_send	= mptcp_energy_get_send,
+	.get_redundant	= mptcp_energy_get_redundant,
+	.name		= "energy",
+	.owner		= THIS_MODULE,
+};
+
+void __init mptcp_sched_energy_init(void)
+{
+	if (mptcp_register_scheduler(&mptcp_sched_energy))
+		pr_warn("failed to register the energy scheduler");
+}
@@ -1410,6 +1410,12 @@ static int ip_set_swap(struct net *net, struct sock *ctnl, struct sk_buff *skb,
 	ip_set(inst, to_id) = from;
 	write_unlock_bh(&ip_set_ref_lock);
 
+	/* Both sets are now in use under the other name */
+	if (from->variant->swapped)
+		from->variant->swapped(from);
+	if (to->variant->swapped)
+		to->variant->swapped(to);
+
 	return 0;
 }
 
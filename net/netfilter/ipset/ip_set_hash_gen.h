@@ -184,6 +184,153 @@ htable_size(u8 hbits)
 	(SET_WITH_TIMEOUT(set) &&	\
 	 ip_set_timeout_expired(ext_timeout(d, set)))
 
+#ifdef IP_SET_HASH_WITH_LPM
+/* Compiled longest prefix match view of the prefixes in a hash:net set.
+ *
+ * Testing an address normally hashes it once per prefix length present in
+ * the set. When a set is swapped in, its prefixes are compiled into a
+ * leaf-pushed multibit trie instead: a 2^16 root indexed by the first two
+ * address bytes, then 256-way nodes per further byte. A leaf holds the
+ * longest prefix length covering that address range, so a single hash
+ * probe with that cidr finds the element, extensions and all. The trie
+ * stores no element pointers and survives resizes. Adding or deleting
+ * elements drops it (the set falls back to the per-cidr walk) until the
+ * next swap rebuilds it.
+ */
+#include <linux/sort.h>
+
+#define IPSET_LPM_ROOT_BITS	16
+#define IPSET_LPM_CHILD		0x80000000U
+#define IPSET_LPM_MAX_NODES	4096
+
+struct ip_set_lpm_node {
+	u32 e[256];
+};
+
+struct ip_set_lpm {
+	struct rcu_head rcu;
+	u32 root[1 << IPSET_LPM_ROOT_BITS];
+	struct ip_set_lpm_node nodes[];
+};
+
+struct ip_set_lpm_prefix {
+	u8 addr[16];
+	u8 cidr;
+};
+
+struct ip_set_lpm_builder {
+	u32 *root;
+	struct ip_set_lpm_node *nodes;
+	u32 nr_nodes, max_nodes;
+};
+
+static u8
+ip_set_lpm_lookup(const struct ip_set_lpm *lpm, const u8 *addr)
+{
+	u32 v = lpm->root[(addr[0] << 8) | addr[1]];
+	int i = 2;
+
+	while (v & IPSET_LPM_CHILD)
+		v = lpm->nodes[v & ~IPSET_LPM_CHILD].e[addr[i++]];
+	return v;
+}
+
+static int
+ip_set_lpm_cmp(const void *a, const void *b)
+{
+	return (int)((const struct ip_set_lpm_prefix *)a)->cidr -
+	       (int)((const struct ip_set_lpm_prefix *)b)->cidr;
+}
+
+/* Returns the index of a new node filled with @leaf */
+static int
+ip_set_lpm_new_node(struct ip_set_lpm_builder *b, u32 leaf)
+{
+	struct ip_set_lpm_node *nodes;
+	int i;
+
+	if (b->nr_nodes == b->max_nodes) {
+		u32 max = b->max_nodes ? 2 * b->max_nodes : 16;
+
+		if (max > IPSET_LPM_MAX_NODES)
+			return -E2BIG;
+		nodes = kvmalloc_array(max, sizeof(*nodes), GFP_KERNEL);
+		if (!nodes)
+			return -ENOMEM;
+		if (b->nodes)
+			memcpy(nodes, b->nodes, b->nr_nodes * sizeof(*nodes));
+		kvfree(b->nodes);
+		b->nodes = nodes;
+		b->max_nodes = max;
+	}
+	for (i = 0; i < 256; i++)
+		b->nodes[b->nr_nodes].e[i] = leaf;
+	return b->nr_nodes++;
+}
+
+/* Prefixes must come in increasing cidr order: a range being filled then
+ * never has children yet, those only come from longer prefixes.
+ */
+static int
+ip_set_lpm_insert(struct ip_set_lpm_builder *b,
+		  const struct ip_set_lpm_prefix *p)
+{
+	u32 idx = (p->addr[0] << 8) | p->addr[1], span, *tbl;
+	int node = -1, bits = IPSET_LPM_ROOT_BITS, i = 2, ret;
+
+	for (;;) {
+		tbl = node < 0 ? b->root : b->nodes[node].e;
+		if (p->cidr <= bits)
+			break;
+		if (!(tbl[idx] & IPSET_LPM_CHILD)) {
+			ret = ip_set_lpm_new_node(b, tbl[idx]);
+			if (ret < 0)
+				return ret;
+			/* the node array may have moved */
+			tbl = node < 0 ? b->root : b->nodes[node].e;
+			tbl[idx] = IPSET_LPM_CHILD | ret;
+		}
+		node = tbl[idx] & ~IPSET_LPM_CHILD;
+		idx = p->addr[i++];
+		bits += 8;
+	}
+
+	span = 1U << (bits - p->cidr);
+	for (idx &= ~(span - 1); span; span--, idx++)
+		tbl[idx] = p->cidr;
+	return 0;
+}
+
+static struct ip_set_lpm *
+ip_set_lpm_compile(struct ip_set_lpm_prefix *p, u32 count)
+{
+	struct ip_set_lpm_builder b = {};
+	struct ip_set_lpm *lpm = NULL;
+	u32 i;
+
+	b.root = kvzalloc(sizeof(lpm->root), GFP_KERNEL);
+	if (!b.root)
+		return NULL;
+
+	sort(p, count, sizeof(*p), ip_set_lpm_cmp, NULL);
+	for (i = 0; i < count; i++)
+		if (ip_set_lpm_insert(&b, &p[i]))
+			goto out;
+
+	lpm = kvmalloc(struct_size(lpm, nodes, b.nr_nodes), GFP_KERNEL);
+	if (lpm) {
+		memcpy(lpm->root, b.root, sizeof(lpm->root));
+		if (b.nr_nodes)
+			memcpy(lpm->nodes, b.nodes,
+			       b.nr_nodes * sizeof(*b.nodes));
+	}
+out:
+	kvfree(b.nodes);
+	kvfree(b.root);
+	return lpm;
+}
+#endif /* IP_SET_HASH_WITH_LPM */
+
 #endif /* _IP_SET_HASH_GEN_H */
 
 #ifndef MTYPE
@@ -237,6 +384,10 @@ htable_size(u8 hbits)
 #undef mtype_gc_init
 #undef mtype_variant
 #undef mtype_data_match
+#undef mtype_data_addr
+#undef mtype_lpm_drop
+#undef mtype_lpm_build
+#undef mtype_test_lpm
 
 #undef htype
 #undef HKEY
@@ -281,6 +432,10 @@ htable_size(u8 hbits)
 #define mtype_gc_init		IPSET_TOKEN(MTYPE, _gc_init)
 #define mtype_variant		IPSET_TOKEN(MTYPE, _variant)
 #define mtype_data_match	IPSET_TOKEN(MTYPE, _data_match)
+#define mtype_data_addr		IPSET_TOKEN(MTYPE, _data_addr)
+#define mtype_lpm_drop		IPSET_TOKEN(MTYPE, _lpm_drop)
+#define mtype_lpm_build		IPSET_TOKEN(MTYPE, _lpm_build)
+#define mtype_test_lpm		IPSET_TOKEN(MTYPE, _test_lpm)
 
 #ifndef HKEY_DATALEN
 #define HKEY_DATALEN		sizeof(struct mtype_elem)
@@ -318,6 +473,10 @@ struct htype {
 #ifdef IP_SET_HASH_WITH_NETS
 	struct net_prefixes nets[NLEN]; /* book-keeping of prefixes */
 #endif
+#ifdef IP_SET_HASH_WITH_LPM
+	struct ip_set_lpm __rcu *lpm; /* compiled prefixes, if up to date */
+	atomic_t lpm_gen;	/* bumped whenever the prefixes change */
+#endif
 };
 
 /* ADD|DEL entries saved during resize */
@@ -404,6 +563,22 @@ mtype_ext_cleanup(struct ip_set *set, struct hbucket *n)
 			ip_set_ext_destroy(set, ahash_data(n, i, set->dsize));
 }
 
+#ifdef IP_SET_HASH_WITH_LPM
+/* The prefixes are about to change: stop using the compiled view */
+static void
+mtype_lpm_drop(struct htype *h)
+{
+	struct ip_set_lpm *lpm;
+
+	atomic_inc(&h->lpm_gen);
+	smp_mb__after_atomic();
+	lpm = (struct ip_set_lpm __force *)
+		xchg((struct ip_set_lpm __force **)&h->lpm, NULL);
+	if (lpm)
+		kvfree_rcu(lpm, rcu);
+}
+#endif
+
 /* Flush a hash type of set: destroy all elements */
 static void
 mtype_flush(struct ip_set *set)
@@ -434,6 +609,9 @@ mtype_flush(struct ip_set *set)
 #ifdef IP_SET_HASH_WITH_NETS
 	memset(h->nets, 0, sizeof(h->nets));
 #endif
+#ifdef IP_SET_HASH_WITH_LPM
+	mtype_lpm_drop(h);
+#endif
 }
 
 /* Destroy the hashtable part of the set */
@@ -472,6 +650,9 @@ mtype_destroy(struct ip_set *set)
 		list_del(l);
 		kfree(l);
 	}
+#ifdef IP_SET_HASH_WITH_LPM
+	kvfree(rcu_dereference_protected(h->lpm, 1));
+#endif
 	kfree(h);
 
 	set->data = NULL;
@@ -855,6 +1036,9 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	bool deleted = false, forceadd = false, reuse = false;
 	u32 r, key, multi = 0, elements, maxelem;
 
+#ifdef IP_SET_HASH_WITH_LPM
+	mtype_lpm_drop(h);
+#endif
 	rcu_read_lock_bh();
 	t = rcu_dereference_bh(h->table);
 	key = HKEY(value, h->initval, t->htable_bits);
@@ -1045,6 +1229,9 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	u32 key, multi = 0;
 	size_t dsize = set->dsize;
 
+#ifdef IP_SET_HASH_WITH_LPM
+	mtype_lpm_drop(h);
+#endif
 	/* Userspace add and resize is excluded by the mutex.
 	 * Kernespace add does not trigger resize.
 	 */
@@ -1211,6 +1398,116 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 }
 #endif
 
+#ifdef IP_SET_HASH_WITH_LPM
+/* Single probe with the longest prefix the compiled view knows about.
+ * Returns -EAGAIN when there is no compiled view, or when its element
+ * has expired or gone since: then the caller walks the cidrs as usual.
+ */
+static int
+mtype_test_lpm(struct ip_set *set, struct mtype_elem *d,
+	       const struct ip_set_ext *ext,
+	       struct ip_set_ext *mext, u32 flags)
+{
+	struct htype *h = set->data;
+	struct ip_set_lpm *lpm = rcu_dereference_bh(h->lpm);
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct mtype_elem orig = *d;
+	struct mtype_elem *data;
+	struct hbucket *n;
+	u32 key, multi = 0;
+	int i, ret;
+	u8 cidr;
+
+	if (!lpm)
+		return -EAGAIN;
+
+	cidr = ip_set_lpm_lookup(lpm, mtype_data_addr(d));
+	if (!cidr)
+		return 0;
+
+	mtype_data_netmask(d, cidr);
+	key = HKEY(d, h->initval, t->htable_bits);
+	n = rcu_dereference_bh(hbucket(t, key));
+	for (i = 0; n && i < n->pos; i++) {
+		if (!test_bit(i, n->used))
+			continue;
+		data = ahash_data(n, i, set->dsize);
+		if (!mtype_data_equal(data, d, &multi))
+			continue;
+		if (SET_ELEM_EXPIRED(set, data))
+			break;
+		ret = mtype_data_match(data, ext, mext, set, flags);
+		if (ret != 0)
+			return ret;
+	}
+	*d = orig;
+	return -EAGAIN;
+}
+
+/* Compile the prefixes of the set, called when it was swapped in */
+static void
+mtype_lpm_build(struct ip_set *set)
+{
+	struct htype *h = set->data;
+	struct ip_set_lpm_prefix *p;
+	struct ip_set_lpm *lpm, *old;
+	struct mtype_elem *data;
+	struct htable *t;
+	struct hbucket *n;
+	u32 i, j, count = 0, max;
+	int gen;
+
+	gen = atomic_read(&h->lpm_gen);
+	smp_rmb();
+
+	/* Room for some kernel side adds racing with us */
+	max = set->elements + 64;
+	p = kvmalloc_array(max, sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return;
+
+	rcu_read_lock_bh();
+	t = rcu_dereference_bh(h->table);
+	for (i = 0; i < jhash_size(t->htable_bits); i++) {
+		n = rcu_dereference_bh(hbucket(t, i));
+		for (j = 0; n && j < n->pos; j++) {
+			if (!test_bit(j, n->used))
+				continue;
+			data = ahash_data(n, j, set->dsize);
+			if (SET_ELEM_EXPIRED(set, data))
+				continue;
+			if (count == max) {
+				rcu_read_unlock_bh();
+				goto out;
+			}
+			memset(&p[count], 0, sizeof(p[count]));
+			memcpy(p[count].addr, mtype_data_addr(data),
+			       HOST_MASK / 8);
+			p[count].cidr = data->cidr;
+			count++;
+		}
+	}
+	rcu_read_unlock_bh();
+
+	lpm = ip_set_lpm_compile(p, count);
+	if (!lpm)
+		goto out;
+
+	old = (struct ip_set_lpm __force *)
+		xchg((struct ip_set_lpm __force **)&h->lpm,
+		     (struct ip_set_lpm __force *)RCU_INITIALIZER(lpm));
+	if (old)
+		kvfree_rcu(old, rcu);
+
+	/* An add or del that started meanwhile may be missing from it */
+	smp_mb();
+	if (atomic_read(&h->lpm_gen) != gen)
+		mtype_lpm_drop(h);
+out:
+	kvfree(p);
+}
+#endif
+
 /* Test whether the element is added to the set */
 static int
 mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
@@ -1234,6 +1531,11 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 		if (DCIDR_GET(d->cidr, i) != HOST_MASK)
 			break;
 	if (i == IPSET_NET_COUNT) {
+#ifdef IP_SET_HASH_WITH_LPM
+		ret = mtype_test_lpm(set, d, ext, mext, flags);
+		if (ret != -EAGAIN)
+			goto out;
+#endif
 		ret = mtype_test_cidrs(set, d, ext, mext, flags);
 		goto out;
 	}
@@ -1434,6 +1736,9 @@ static const struct ip_set_type_variant mtype_variant = {
 	.resize	= mtype_resize,
 	.same_set = mtype_same_set,
 	.region_lock = true,
+#ifdef IP_SET_HASH_WITH_LPM
+	.swapped = mtype_lpm_build,
+#endif
 };
 
 #ifdef IP_SET_EMIT_CREATE
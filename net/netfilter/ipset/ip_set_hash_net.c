@@ -34,6 +34,7 @@ MODULE_ALIAS("ip_set_hash:net");
 /* Type specific function prefix */
 #define HTYPE		hash_net
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_LPM
 
 /* IPv4 variant */
 
@@ -104,6 +105,12 @@ hash_net4_data_next(struct hash_net4_elem *next,
 	next->ip = d->ip;
 }
 
+static inline const u8 *
+hash_net4_data_addr(const struct hash_net4_elem *e)
+{
+	return (const u8 *)&e->ip;
+}
+
 #define MTYPE		hash_net4
 #define HOST_MASK	32
 #include "ip_set_hash_gen.h"
@@ -268,6 +275,12 @@ hash_net6_data_next(struct hash_net6_elem *next,
 {
 }
 
+static inline const u8 *
+hash_net6_data_addr(const struct hash_net6_elem *e)
+{
+	return e->ip.in6.s6_addr;
+}
+
 #undef MTYPE
 #undef HOST_MASK
 
@@ -42,6 +42,8 @@
 #define MC_HASH_SHIFT		8
 #define MC_HASH_SEGS		((sizeof(uint32_t) * 8) / MC_HASH_SHIFT)
 
+#define MF_CACHE_ENTRIES	64
+
 static struct kmem_cache *flow_cache;
 struct kmem_cache *flow_stats_cache __read_mostly;
 
@@ -420,9 +422,14 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	if (!mc)
 		return -ENOMEM;
 
+	table->mf_cache = kvcalloc(array_size(nr_cpu_ids, MF_CACHE_ENTRIES),
+				   sizeof(struct microflow_entry), GFP_KERNEL);
+	if (!table->mf_cache)
+		goto free_mask_cache;
+
 	ma = tbl_mask_array_alloc(MASK_ARRAY_SIZE_MIN);
 	if (!ma)
-		goto free_mask_cache;
+		goto free_mf_cache;
 
 	ti = table_instance_alloc(TBL_MIN_BUCKETS);
 	if (!ti)
@@ -436,6 +443,7 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	rcu_assign_pointer(table->ufid_ti, ufid_ti);
 	rcu_assign_pointer(table->mask_array, ma);
 	rcu_assign_pointer(table->mask_cache, mc);
+	table->mf_gen = 0;
 	table->last_rehash = jiffies;
 	table->count = 0;
 	table->ufid_count = 0;
@@ -445,6 +453,8 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	__table_instance_destroy(ti);
 free_mask_array:
 	__mask_array_destroy(ma);
+free_mf_cache:
+	kvfree(table->mf_cache);
 free_mask_cache:
 	__mask_cache_destroy(mc);
 	return -ENOMEM;
@@ -465,6 +475,7 @@ static void table_instance_flow_free(struct flow_table *table,
 {
 	hlist_del_rcu(&flow->flow_table.node[ti->node_ver]);
 	table->count--;
+	smp_store_release(&table->mf_gen, table->mf_gen + 1);
 
 	if (ovs_identifier_is_ufid(&flow->id)) {
 		hlist_del_rcu(&flow->ufid_table.node[ufid_ti->node_ver]);
@@ -522,6 +533,7 @@ void ovs_flow_tbl_destroy(struct flow_table *table)
 	call_rcu(&mc->rcu, mask_cache_rcu_cb);
 	call_rcu(&ma->rcu, mask_array_rcu_cb);
 	table_instance_destroy(ti, ufid_ti);
+	kvfree(table->mf_cache);
 }
 
 struct sw_flow *ovs_flow_tbl_dump_next(struct table_instance *ti,
@@ -775,6 +787,49 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 	return NULL;
 }
 
+/* Entries are only trusted while mf_gen is what it was when they were
+ * filled in, so they never point at a flow that was removed since: its
+ * removal bumped mf_gen before the RCU grace period that frees it. The
+ * bump is a release, paired with the acquire in the lookup, so a lookup
+ * that sees the new generation can't still find the removed flow.
+ * Matching the raw key bytes the flow's mask covers implies the masked
+ * match. Must be called with BH disabled.
+ */
+static struct microflow_entry *microflow_entry(struct flow_table *tbl,
+					       u32 skb_hash)
+{
+	return &tbl->mf_cache[smp_processor_id() * MF_CACHE_ENTRIES +
+			      (skb_hash & (MF_CACHE_ENTRIES - 1))];
+}
+
+static struct sw_flow *microflow_lookup(struct microflow_entry *e,
+					const struct sw_flow_key *key,
+					u32 skb_hash, u32 gen)
+{
+	const struct sw_flow_key_range *range;
+
+	if (e->skb_hash != skb_hash || e->gen != gen)
+		return NULL;
+
+	range = &e->flow->mask->range;
+	if (!cmp_key(&e->key, key, range->start, range->end))
+		return NULL;
+	return e->flow;
+}
+
+static void microflow_update(struct microflow_entry *e,
+			     const struct sw_flow_key *key,
+			     struct sw_flow *flow, u32 skb_hash, u32 gen)
+{
+	const struct sw_flow_key_range *range = &flow->mask->range;
+
+	memcpy((u8 *)&e->key + range->start, (const u8 *)key + range->start,
+	       range_n_bytes(range));
+	e->flow = flow;
+	e->gen = gen;
+	e->skb_hash = skb_hash;
+}
+
 /*
  * mask_cache maps flow to probable mask. This cache is not tightly
  * coupled cache, It means updates to  mask list can result in inconsistent
@@ -792,8 +847,9 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	struct mask_array *ma = rcu_dereference(tbl->mask_array);
 	struct table_instance *ti = rcu_dereference(tbl->ti);
 	struct mask_cache_entry *entries, *ce;
+	struct microflow_entry *mf;
 	struct sw_flow *flow;
-	u32 hash;
+	u32 hash, gen;
 	int seg;
 
 	*n_mask_hit = 0;
@@ -812,6 +868,15 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	if (key->recirc_id)
 		skb_hash = jhash_1word(skb_hash, key->recirc_id);
 
+	/* Read before any lookup, see microflow_entry(). */
+	gen = smp_load_acquire(&tbl->mf_gen);
+	mf = microflow_entry(tbl, skb_hash);
+	flow = microflow_lookup(mf, key, skb_hash, gen);
+	if (flow) {
+		(*n_cache_hit)++;
+		return flow;
+	}
+
 	ce = NULL;
 	hash = skb_hash;
 	entries = this_cpu_ptr(mc->mask_cache);
@@ -825,7 +890,9 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 		if (e->skb_hash == skb_hash) {
 			flow = flow_lookup(tbl, ti, ma, key, n_mask_hit,
 					   n_cache_hit, &e->mask_index);
-			if (!flow)
+			if (flow)
+				microflow_update(mf, key, flow, skb_hash, gen);
+			else
 				e->skb_hash = 0;
 			return flow;
 		}
@@ -839,8 +906,10 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	/* Cache miss, do full lookup. */
 	flow = flow_lookup(tbl, ti, ma, key, n_mask_hit, n_cache_hit,
 			   &ce->mask_index);
-	if (flow)
+	if (flow) {
 		ce->skb_hash = skb_hash;
+		microflow_update(mf, key, flow, skb_hash, gen);
+	}
 
 	*n_cache_hit = 0;
 	return flow;
@@ -1089,6 +1158,7 @@ int ovs_flow_tbl_insert(struct flow_table *table, struct sw_flow *flow,
 	if (err)
 		return err;
 	flow_key_insert(table, flow);
+	smp_store_release(&table->mf_gen, table->mf_gen + 1);
 	if (ovs_identifier_is_ufid(&flow->id))
 		flow_ufid_insert(table, flow);
 
@@ -33,6 +33,16 @@ struct mask_cache {
 	struct mask_cache_entry __percpu *mask_cache;
 };
 
+/* Exact-match cache in front of the mask cache: the last flow each CPU
+ * found for a skb_hash, valid while the table generation hasn't moved.
+ */
+struct microflow_entry {
+	u32 skb_hash;
+	u32 gen;
+	struct sw_flow *flow;
+	struct sw_flow_key key;	/* only flow->mask->range is filled in */
+};
+
 struct mask_count {
 	int index;
 	u64 counter;
@@ -64,6 +74,8 @@ struct flow_table {
 	struct table_instance __rcu *ufid_ti;
 	struct mask_cache __rcu *mask_cache;
 	struct mask_array __rcu *mask_array;
+	struct microflow_entry *mf_cache;	/* MF_CACHE_ENTRIES per CPU */
+	u32 mf_gen;		/* bumped on every flow insert and removal */
 	unsigned long last_rehash;
 	unsigned int count;
 	unsigned int ufid_count;
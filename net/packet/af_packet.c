@@ -503,25 +503,72 @@ static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 	del_timer_sync(&pkc->retire_blk_timer);
 }
 
+/* Move the per-CPU sub-ring counters into @st, clear on read */
+static void prb_fold_cpu_stats(struct packet_sock *po,
+			       struct tpacket_stats_v3 *st)
+{
+	struct tpacket_kbdq_core *cores = po->rx_ring.prb_cpu_bdqc;
+	unsigned int cpu;
+
+	if (!cores)
+		return;
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		struct tpacket_kbdq_core *pkc = &cores[cpu];
+
+		spin_lock_bh(pkc->lock);
+		st->tp_packets += pkc->tp_packets;
+		st->tp_freeze_q_cnt += pkc->tp_freeze_q_cnt;
+		pkc->tp_packets = 0;
+		pkc->tp_freeze_q_cnt = 0;
+		spin_unlock_bh(pkc->lock);
+	}
+}
+
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 		struct sk_buff_head *rb_queue)
 {
+	struct packet_ring_buffer *rb = &po->rx_ring;
+	struct tpacket_stats_v3 st = { 0 };
 	struct tpacket_kbdq_core *pkc;
+	unsigned int cpu;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	pkc = GET_PBDQC_FROM_RB(rb);
 
 	spin_lock_bh(&rb_queue->lock);
 	pkc->delete_blk_timer = 1;
 	spin_unlock_bh(&rb_queue->lock);
 
 	prb_del_retire_blk_timer(pkc);
+
+	if (!rb->prb_cpu_bdqc)
+		return;
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		pkc = &rb->prb_cpu_bdqc[cpu];
+
+		spin_lock_bh(pkc->lock);
+		pkc->delete_blk_timer = 1;
+		spin_unlock_bh(pkc->lock);
+
+		prb_del_retire_blk_timer(pkc);
+	}
+
+	/* PACKET_STATISTICS reads the sub-rings under pg_vec_lock */
+	mutex_lock(&po->pg_vec_lock);
+	prb_fold_cpu_stats(po, &st);
+	kfree(rb->prb_cpu_bdqc);
+	rb->prb_cpu_bdqc = NULL;
+	mutex_unlock(&po->pg_vec_lock);
+
+	spin_lock_bh(&rb_queue->lock);
+	po->stats.stats3.tp_packets += st.tp_packets;
+	po->stats.stats3.tp_freeze_q_cnt += st.tp_freeze_q_cnt;
+	spin_unlock_bh(&rb_queue->lock);
 }
 
-static void prb_setup_retire_blk_timer(struct packet_sock *po)
+static void prb_setup_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	struct tpacket_kbdq_core *pkc;
-
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
 		    0);
 	pkc->retire_blk_timer.expires = jiffies;
@@ -570,39 +617,87 @@ static void prb_init_ft_ops(struct tpacket_kbdq_core *p1,
 	p1->feature_req_word = req_u->req3.tp_feature_req_word;
 }
 
-static void init_prb_bdqc(struct packet_sock *po,
-			struct packet_ring_buffer *rb,
-			struct pgv *pg_vec,
+static void prb_init_core(struct packet_sock *po,
+			struct tpacket_kbdq_core *p1,
+			struct pgv *pg_vec, unsigned int nr_blocks,
+			unsigned short retire_blk_tov,
 			union tpacket_req_u *req_u)
 {
-	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
-	struct tpacket_block_desc *pbd;
-
 	memset(p1, 0x0, sizeof(*p1));
 
+	p1->po = po;
+	p1->lock = &po->sk.sk_receive_queue.lock;
 	p1->knxt_seq_num = 1;
 	p1->pkbdq = pg_vec;
-	pbd = (struct tpacket_block_desc *)pg_vec[0].buffer;
 	p1->pkblk_start	= pg_vec[0].buffer;
 	p1->kblk_size = req_u->req3.tp_block_size;
-	p1->knum_blocks	= req_u->req3.tp_block_nr;
+	p1->knum_blocks	= nr_blocks;
 	p1->hdrlen = po->tp_hdrlen;
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
-	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
-		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
-		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
-						req_u->req3.tp_block_size);
+	p1->retire_blk_tov = retire_blk_tov;
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
 	prb_init_ft_ops(p1, req_u);
-	prb_setup_retire_blk_timer(po);
-	prb_open_block(p1, pbd);
+	prb_setup_retire_blk_timer(p1);
+}
+
+/*
+ * With TP_FT_REQ_PERCPU_RINGS, rb->prb_bdqc only describes the whole ring
+ * (diag, frame length checks) and is never opened; packets go to the
+ * sub-ring of the receiving CPU instead.
+ */
+static int init_prb_bdqc(struct packet_sock *po,
+			struct packet_ring_buffer *rb,
+			struct pgv *pg_vec,
+			union tpacket_req_u *req_u)
+{
+	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
+	struct tpacket_kbdq_core *cores;
+	unsigned int cpu, per_cpu;
+	unsigned short tov;
+
+	po->stats.stats3.tp_freeze_q_cnt = 0;
+	if (req_u->req3.tp_retire_blk_tov)
+		tov = req_u->req3.tp_retire_blk_tov;
+	else
+		tov = prb_calc_retire_blk_tmo(po, req_u->req3.tp_block_size);
+
+	prb_init_core(po, p1, pg_vec, req_u->req3.tp_block_nr, tov, req_u);
+	if (!(p1->feature_req_word & TP_FT_REQ_PERCPU_RINGS)) {
+		prb_open_block(p1, GET_PBLOCK_DESC(p1, 0));
+		return 0;
+	}
+
+	cores = kcalloc(nr_cpu_ids, sizeof(*cores), GFP_KERNEL);
+	if (!cores)
+		return -ENOMEM;
+
+	per_cpu = req_u->req3.tp_block_nr / nr_cpu_ids;
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		struct tpacket_kbdq_core *pkc = &cores[cpu];
+
+		prb_init_core(po, pkc, &pg_vec[cpu * per_cpu], per_cpu, tov,
+			      req_u);
+		spin_lock_init(&pkc->cpu_lock);
+		pkc->lock = &pkc->cpu_lock;
+		prb_open_block(pkc, GET_PBLOCK_DESC(pkc, 0));
+	}
+	rb->prb_cpu_bdqc = cores;
+	return 0;
+}
+
+/* The sub-ring tpacket_rcv() fills on this CPU. The room checks may also
+ * come from poll(), where a migrated CPU only makes the answer stale.
+ */
+static struct tpacket_kbdq_core *prb_rx_core(const struct packet_ring_buffer *rb)
+{
+	if (rb->prb_cpu_bdqc)
+		return &rb->prb_cpu_bdqc[raw_smp_processor_id()];
+	return GET_PBDQC_FROM_RB(rb);
 }
 
 /*  Do NOT update the last_blk_num first.
@@ -640,13 +735,12 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  */
 static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_kbdq_core *pkc = from_timer(pkc, t, retire_blk_timer);
+	struct packet_sock *po = pkc->po;
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
 
-	spin_lock(&po->sk.sk_receive_queue.lock);
+	spin_lock(pkc->lock);
 
 	frozen = prb_queue_frozen(pkc);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
@@ -708,7 +802,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 	_prb_refresh_rx_retire_blk_timer(pkc);
 
 out:
-	spin_unlock(&po->sk.sk_receive_queue.lock);
+	spin_unlock(pkc->lock);
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -872,7 +966,10 @@ static void prb_freeze_queue(struct tpacket_kbdq_core *pkc,
 				  struct packet_sock *po)
 {
 	pkc->reset_pending_on_curr_blk = 1;
-	po->stats.stats3.tp_freeze_q_cnt++;
+	if (po->rx_ring.prb_cpu_bdqc)
+		pkc->tp_freeze_q_cnt++;
+	else
+		po->stats.stats3.tp_freeze_q_cnt++;
 }
 
 #define TOTAL_PKT_LEN_INCL_ALIGN(length) (ALIGN((length), V3_ALIGNMENT))
@@ -944,11 +1041,9 @@ static int prb_queue_frozen(struct tpacket_kbdq_core *pkc)
 	return pkc->reset_pending_on_curr_blk;
 }
 
-static void prb_clear_blk_fill_status(struct packet_ring_buffer *rb)
+static void prb_clear_blk_fill_status(struct tpacket_kbdq_core *pkc)
 	__releases(&pkc->blk_fill_in_prog_lock)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
-
 	read_unlock(&pkc->blk_fill_in_prog_lock);
 }
 
@@ -1008,17 +1103,16 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
-/* Assumes caller has the sk->rx_queue.lock */
+/* Assumes caller has pkc->lock */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    unsigned int len
 					    )
 {
-	struct tpacket_kbdq_core *pkc;
 	struct tpacket_block_desc *pbd;
 	char *curr, *end;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
 	/* Queue is frozen when user space is lagging behind */
@@ -1071,6 +1165,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 }
 
 static void *packet_current_rx_frame(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    int status, unsigned int len)
 {
@@ -1082,7 +1177,7 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 					po->rx_ring.head, status);
 		return curr;
 	case TPACKET_V3:
-		return __packet_lookup_frame_in_block(po, skb, len);
+		return __packet_lookup_frame_in_block(po, pkc, skb, len);
 	default:
 		WARN(1, "TPACKET version not supported\n");
 		BUG();
@@ -1090,12 +1185,10 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 	}
 }
 
-static void *prb_lookup_block(const struct packet_sock *po,
-			      const struct packet_ring_buffer *rb,
+static void *prb_lookup_block(const struct tpacket_kbdq_core *pkc,
 			      unsigned int idx,
 			      int status)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd = GET_PBLOCK_DESC(pkc, idx);
 
 	if (status != BLOCK_STATUS(pbd))
@@ -1103,23 +1196,40 @@ static void *prb_lookup_block(const struct packet_sock *po,
 	return pbd;
 }
 
-static int prb_previous_blk_num(struct packet_ring_buffer *rb)
+static int prb_previous_blk_num(const struct tpacket_kbdq_core *pkc)
 {
 	unsigned int prev;
-	if (rb->prb_bdqc.kactive_blk_num)
-		prev = rb->prb_bdqc.kactive_blk_num-1;
+	unsigned int active = READ_ONCE(pkc->kactive_blk_num);
+
+	if (active)
+		prev = active - 1;
 	else
-		prev = rb->prb_bdqc.knum_blocks-1;
+		prev = pkc->knum_blocks-1;
 	return prev;
 }
 
-/* Assumes caller has held the rx_queue.lock */
+/* Assumes caller has held the rx_queue.lock; sub-rings are read locklessly,
+ * only poll() asks and it tolerates a stale answer.
+ */
 static void *__prb_previous_block(struct packet_sock *po,
 					 struct packet_ring_buffer *rb,
 					 int status)
 {
-	unsigned int previous = prb_previous_blk_num(rb);
-	return prb_lookup_block(po, rb, previous, status);
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(rb);
+	unsigned int cpu;
+	void *pbd = NULL;
+
+	if (!rb->prb_cpu_bdqc)
+		return prb_lookup_block(pkc, prb_previous_blk_num(pkc),
+					status);
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		pkc = &rb->prb_cpu_bdqc[cpu];
+		pbd = prb_lookup_block(pkc, prb_previous_blk_num(pkc), status);
+		if (!pbd)
+			return NULL;
+	}
+	return pbd;
 }
 
 static void *packet_previous_rx_frame(struct packet_sock *po,
@@ -1221,15 +1331,16 @@ static bool __tpacket_has_room(const struct packet_sock *po, int pow_off)
 
 static bool __tpacket_v3_has_room(const struct packet_sock *po, int pow_off)
 {
+	const struct tpacket_kbdq_core *pkc = prb_rx_core(&po->rx_ring);
 	int idx, len;
 
-	len = READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks);
-	idx = READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	len = READ_ONCE(pkc->knum_blocks);
+	idx = READ_ONCE(pkc->kactive_blk_num);
 	if (pow_off)
 		idx += len >> pow_off;
 	if (idx >= len)
 		idx -= len;
-	return prb_lookup_block(po, &po->rx_ring, idx, TP_STATUS_KERNEL);
+	return prb_lookup_block(pkc, idx, TP_STATUS_KERNEL);
 }
 
 static int __packet_rcv_has_room(const struct packet_sock *po,
@@ -2197,6 +2308,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	unsigned short macoff, hdrlen;
 	unsigned int netoff;
 	struct sk_buff *copy_skb = NULL;
+	struct tpacket_kbdq_core *pkc = NULL;
+	spinlock_t *rx_lock;
 	struct timespec64 ts;
 	__u32 ts_status;
 	bool is_drop_n_account = false;
@@ -2304,8 +2417,13 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			do_vnet = false;
 		}
 	}
-	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
+	rx_lock = &sk->sk_receive_queue.lock;
+	if (po->tp_version == TPACKET_V3) {
+		pkc = prb_rx_core(&po->rx_ring);
+		rx_lock = pkc->lock;
+	}
+	spin_lock(rx_lock);
+	h.raw = packet_current_rx_frame(po, pkc, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
 	if (!h.raw)
 		goto drop_n_account;
@@ -2322,7 +2440,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				    sizeof(struct virtio_net_hdr),
 				    vio_le(), true, 0)) {
 		if (po->tp_version == TPACKET_V3)
-			prb_clear_blk_fill_status(&po->rx_ring);
+			prb_clear_blk_fill_status(pkc);
 		goto drop_n_account;
 	}
 
@@ -2338,12 +2456,15 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			status |= TP_STATUS_LOSING;
 	}
 
-	po->stats.stats1.tp_packets++;
+	if (po->rx_ring.prb_cpu_bdqc)
+		pkc->tp_packets++;
+	else
+		po->stats.stats1.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
 		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
 	}
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
@@ -2436,7 +2557,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		spin_unlock(&sk->sk_receive_queue.lock);
 		sk->sk_data_ready(sk);
 	} else if (po->tp_version == TPACKET_V3) {
-		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_clear_blk_fill_status(pkc);
 	}
 
 drop_n_restore:
@@ -2452,7 +2573,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	return 0;
 
 drop_n_account:
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 	atomic_inc(&po->tp_drops);
 	is_drop_n_account = true;
 
@@ -4009,6 +4130,10 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		drops = atomic_xchg(&po->tp_drops, 0);
 
 		if (po->tp_version == TPACKET_V3) {
+			mutex_lock(&po->pg_vec_lock);
+			prb_fold_cpu_stats(po, &st.stats3);
+			mutex_unlock(&po->pg_vec_lock);
+
 			lv = sizeof(struct tpacket_stats_v3);
 			st.stats3.tp_drops = drops;
 			st.stats3.tp_packets += drops;
@@ -4400,7 +4525,17 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		case TPACKET_V3:
 			/* Block transmit is not supported yet */
 			if (!tx_ring) {
-				init_prb_bdqc(po, rb, pg_vec, req_u);
+				struct tpacket_req3 *req3 = &req_u->req3;
+
+				if ((req3->tp_feature_req_word &
+				     TP_FT_REQ_PERCPU_RINGS) &&
+				    req3->tp_block_nr % nr_cpu_ids) {
+					err = -EINVAL;
+					goto out_free_pg_vec;
+				}
+				err = init_prb_bdqc(po, rb, pg_vec, req_u);
+				if (err)
+					goto out_free_pg_vec;
 			} else {
 				struct tpacket_req3 *req3 = &req_u->req3;
 
@@ -50,8 +50,25 @@ struct tpacket_kbdq_core {
 
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
+
+	struct packet_sock	*po;
+	/* sk_receive_queue.lock, or cpu_lock for a per-CPU sub-ring */
+	spinlock_t		*lock;
+	spinlock_t		cpu_lock;
+
+	/* per-CPU sub-ring stats, folded into po->stats on read */
+	unsigned int		tp_packets;
+	unsigned int		tp_freeze_q_cnt;
 };
 
+/* Split the V3 rx ring into one sub-ring of tp_block_nr / nr_cpu_ids
+ * blocks per CPU: CPU n fills blocks [n * per_cpu, (n + 1) * per_cpu)
+ * of the same mapping, under its own lock.
+ */
+#ifndef TP_FT_REQ_PERCPU_RINGS
+#define TP_FT_REQ_PERCPU_RINGS	0x2
+#endif
+
 struct pgv {
 	char *buffer;
 };
@@ -74,6 +91,9 @@ struct packet_ring_buffer {
 		unsigned long			*rx_owner_map;
 		struct tpacket_kbdq_core	prb_bdqc;
 	};
+
+	/* nr_cpu_ids sub-rings with TP_FT_REQ_PERCPU_RINGS, else NULL */
+	struct tpacket_kbdq_core	*prb_cpu_bdqc;
 };
 
 extern struct mutex fanout_mutex;
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Shared Memory Communications Direct over loopback (SMC-D loopback)
+ *
+ * A software ISM device: DMBs are plain kernel memory and move_data is a
+ * memcpy into the peer's DMB, so two SMC sockets of the same kernel talk
+ * through shared buffers without going through the TCP/IP stack. The
+ * device has no pnetid and is found by the SMC-Dv2 device selection, for
+ * any TCP connection whose both ends are on this host.
+ */
+
+#define KMSG_COMPONENT "smc"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <net/smc.h>
+
+#include "smc_ism.h"
+#include "smc_loopback.h"
+
+/* system EID positions 24 and 28 mark it as SMC-Dv2 capable */
+static u8 smc_lo_seid[SMC_MAX_EID_LEN] = "LINUX-SMC-LOOPBACK-SEID-10001000";
+
+static struct smc_lo_dev *smc_lo;
+
+/* Both ends use the one local GID, any other one is not reachable */
+static int smc_lo_query_rgid(struct smcd_dev *smcd, u64 rgid, u32 vid_valid,
+			     u32 vid)
+{
+	return rgid == smcd->local_gid ? 0 : -ENETUNREACH;
+}
+
+static int smc_lo_register_dmb(struct smcd_dev *smcd, struct smcd_dmb *dmb)
+{
+	struct smc_lo_dev *ldev = smcd->priv;
+	struct smc_lo_dmb_node *node, *tmp;
+	int sba_idx;
+
+	/* index 0 is never handed out, it asks for a free one */
+	sba_idx = dmb->sba_idx;
+	if (!sba_idx) {
+		do {
+			sba_idx = find_next_zero_bit(ldev->sba_idx_mask,
+						     SMC_LO_MAX_DMBS, 1);
+			if (sba_idx >= SMC_LO_MAX_DMBS)
+				return -ENOSPC;
+		} while (test_and_set_bit(sba_idx, ldev->sba_idx_mask));
+	} else if (sba_idx >= SMC_LO_MAX_DMBS ||
+		   test_and_set_bit(sba_idx, ldev->sba_idx_mask)) {
+		return -EINVAL;
+	}
+
+	node = kzalloc(sizeof(*node), GFP_KERNEL);
+	if (!node)
+		goto out_bit;
+	/* must be linear memory, the core takes virt_to_page() of it */
+	node->cpu_addr = kzalloc(dmb->dmb_len, GFP_KERNEL | __GFP_NOWARN |
+				 __GFP_NORETRY | __GFP_NOMEMALLOC);
+	if (!node->cpu_addr)
+		goto out_node;
+	node->len = dmb->dmb_len;
+	node->sba_idx = sba_idx;
+
+	write_lock_bh(&ldev->dmb_ht_lock);
+again:
+	get_random_bytes(&node->token, sizeof(node->token));
+	hash_for_each_possible(ldev->dmb_ht, tmp, list, node->token)
+		if (tmp->token == node->token)
+			goto again;
+	hash_add(ldev->dmb_ht, &node->list, node->token);
+	write_unlock_bh(&ldev->dmb_ht_lock);
+
+	dmb->sba_idx = node->sba_idx;
+	dmb->dmb_tok = node->token;
+	dmb->cpu_addr = node->cpu_addr;
+	/* never used for DMA, the core only needs it to be non-zero */
+	dmb->dma_addr = (dma_addr_t)virt_to_phys(node->cpu_addr);
+	return 0;
+
+out_node:
+	kfree(node);
+out_bit:
+	clear_bit(sba_idx, ldev->sba_idx_mask);
+	return -ENOMEM;
+}
+
+static int smc_lo_unregister_dmb(struct smcd_dev *smcd, struct smcd_dmb *dmb)
+{
+	struct smc_lo_dev *ldev = smcd->priv;
+	struct smc_lo_dmb_node *node;
+
+	write_lock_bh(&ldev->dmb_ht_lock);
+	hash_for_each_possible(ldev->dmb_ht, node, list, dmb->dmb_tok) {
+		if (node->token == dmb->dmb_tok) {
+			hash_del(&node->list);
+			write_unlock_bh(&ldev->dmb_ht_lock);
+			clear_bit(node->sba_idx, ldev->sba_idx_mask);
+			kfree(node->cpu_addr);
+			kfree(node);
+			return 0;
+		}
+	}
+	write_unlock_bh(&ldev->dmb_ht_lock);
+	return -EINVAL;
+}
+
+static int smc_lo_add_vlan_id(struct smcd_dev *smcd, u64 vlan_id)
+{
+	return 0;
+}
+
+static int smc_lo_del_vlan_id(struct smcd_dev *smcd, u64 vlan_id)
+{
+	return 0;
+}
+
+static int smc_lo_set_vlan_required(struct smcd_dev *smcd)
+{
+	return 0;
+}
+
+static int smc_lo_reset_vlan_required(struct smcd_dev *smcd)
+{
+	return 0;
+}
+
+/* Both link groups of a connection live in this kernel and are torn down
+ * locally; a shutdown event keyed by the shared GID would hit all of them.
+ */
+static int smc_lo_signal_event(struct smcd_dev *smcd, u64 rgid,
+			       u32 trigger_irq, u32 event_code, u64 info)
+{
+	return 0;
+}
+
+static int smc_lo_move_data(struct smcd_dev *smcd, u64 dmb_tok,
+			    unsigned int idx, bool sf, unsigned int offset,
+			    void *data, unsigned int size)
+{
+	struct smc_lo_dev *ldev = smcd->priv;
+	struct smc_lo_dmb_node *node;
+	u32 sba_idx = 0;
+	int rc = -EINVAL;
+
+	read_lock_bh(&ldev->dmb_ht_lock);
+	hash_for_each_possible(ldev->dmb_ht, node, list, dmb_tok) {
+		if (node->token != dmb_tok)
+			continue;
+		if (offset + size <= node->len) {
+			memcpy(node->cpu_addr + offset, data, size);
+			sba_idx = node->sba_idx;
+			rc = 0;
+		}
+		break;
+	}
+	read_unlock_bh(&ldev->dmb_ht_lock);
+
+	if (!rc && sf)
+		smcd_handle_irq(smcd, sba_idx);
+	return rc;
+}
+
+static void smc_lo_get_system_eid(struct smcd_dev *smcd, u8 **eid)
+{
+	*eid = smc_lo_seid;
+}
+
+static u16 smc_lo_get_chid(struct smcd_dev *smcd)
+{
+	return SMC_LO_CHID;
+}
+
+static const struct smcd_ops smc_lo_ops = {
+	.query_remote_gid = smc_lo_query_rgid,
+	.register_dmb = smc_lo_register_dmb,
+	.unregister_dmb = smc_lo_unregister_dmb,
+	.add_vlan_id = smc_lo_add_vlan_id,
+	.del_vlan_id = smc_lo_del_vlan_id,
+	.set_vlan_required = smc_lo_set_vlan_required,
+	.reset_vlan_required = smc_lo_reset_vlan_required,
+	.signal_event = smc_lo_signal_event,
+	.move_data = smc_lo_move_data,
+	.get_system_eid = smc_lo_get_system_eid,
+	.get_chid = smc_lo_get_chid,
+};
+
+int __init smc_loopback_init(void)
+{
+	struct smc_lo_dev *ldev;
+	struct smcd_dev *smcd;
+	int rc;
+
+	ldev = kzalloc(sizeof(*ldev), GFP_KERNEL);
+	if (!ldev)
+		return -ENOMEM;
+	hash_init(ldev->dmb_ht);
+	rwlock_init(&ldev->dmb_ht_lock);
+
+	smcd = smcd_alloc_dev(NULL, "smc_lo", &smc_lo_ops, SMC_LO_MAX_DMBS);
+	if (!smcd) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+	smcd->priv = ldev;
+	do {
+		get_random_bytes(&smcd->local_gid, sizeof(smcd->local_gid));
+	} while (!smcd->local_gid);
+	ldev->smcd = smcd;
+
+	rc = smcd_register_dev(smcd);
+	if (rc)
+		goto out_smcd;
+	smc_lo = ldev;
+	return 0;
+
+out_smcd:
+	smcd_free_dev(smcd);
+out_free:
+	kfree(ldev);
+	return rc;
+}
+
+void smc_loopback_exit(void)
+{
+	struct smc_lo_dev *ldev = smc_lo;
+
+	if (!ldev)
+		return;
+	smc_lo = NULL;
+	/* terminates all link groups, they unregister their DMBs */
+	smcd_unregister_dev(ldev->smcd);
+	smcd_free_dev(ldev->smcd);
+	WARN_ON(!hash_empty(ldev->dmb_ht));
+	kfree(ldev);
+}
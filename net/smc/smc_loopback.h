@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Shared Memory Communications Direct over loopback (SMC-D loopback)
+ *
+ * A software ISM device for connections between two sockets of the
+ * same kernel.
+ */
+
+#ifndef SMC_LOOPBACK_H
+#define SMC_LOOPBACK_H
+
+#include <linux/hashtable.h>
+#include <linux/spinlock.h>
+#include <net/smc.h>
+
+#define SMC_LO_MAX_DMBS		5000
+#define SMC_LO_DMBS_HASH_BITS	12
+#define SMC_LO_CHID		0xFFFF
+
+struct smc_lo_dmb_node {
+	struct hlist_node list;
+	u64 token;
+	u32 len;
+	u32 sba_idx;
+	void *cpu_addr;
+};
+
+struct smc_lo_dev {
+	struct smcd_dev *smcd;
+	DECLARE_HASHTABLE(dmb_ht, SMC_LO_DMBS_HASH_BITS);
+	rwlock_t dmb_ht_lock;	/* protects dmb_ht */
+	DECLARE_BITMAP(sba_idx_mask, SMC_LO_MAX_DMBS);
+};
+
+#if IS_ENABLED(CONFIG_SMC_LO)
+int smc_loopback_init(void);
+void smc_loopback_exit(void);
+#else
+static inline int smc_loopback_init(void)
+{
+	return 0;
+}
+
+static inline void smc_loopback_exit(void)
+{
+}
+#endif
+
+#endif /* SMC_LOOPBACK_H */
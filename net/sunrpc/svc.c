@@ -417,6 +417,16 @@ __svc_init_bc(struct svc_serv *serv)
 }
 #endif
 
+static void
+svc_free_pools(struct svc_serv *serv)
+{
+	unsigned int i;
+
+	for (i = 0; i < serv->sv_nrpools; i++)
+		free_percpu(serv->sv_pools[i].sp_queues);
+	kfree(serv->sv_pools);
+}
+
 /*
  * Create an RPC service
  */
@@ -472,12 +482,25 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 
 	for (i = 0; i < serv->sv_nrpools; i++) {
 		struct svc_pool *pool = &serv->sv_pools[i];
+		int cpu;
 
 		dprintk("svc: initialising pool %u for %s\n",
 				i, serv->sv_name);
 
 		pool->sp_id = i;
-		INIT_LIST_HEAD(&pool->sp_sockets);
+		pool->sp_queues = alloc_percpu(struct svc_xprt_queue);
+		if (!pool->sp_queues) {
+			svc_free_pools(serv);
+			kfree(serv);
+			return NULL;
+		}
+		for_each_possible_cpu(cpu) {
+			struct svc_xprt_queue *q = per_cpu_ptr(pool->sp_queues,
+							       cpu);
+
+			spin_lock_init(&q->xq_lock);
+			INIT_LIST_HEAD(&q->xq_xprts);
+		}
 		INIT_LIST_HEAD(&pool->sp_all_threads);
 		spin_lock_init(&pool->sp_lock);
 	}
@@ -552,7 +575,7 @@ svc_destroy(struct svc_serv *serv)
 	if (svc_serv_is_pooled(serv))
 		svc_pool_map_put();
 
-	kfree(serv->sv_pools);
+	svc_free_pools(serv);
 	kfree(serv);
 }
 EXPORT_SYMBOL_GPL(svc_destroy);
@@ -611,6 +634,7 @@ svc_rqst_alloc(struct svc_serv *serv, struct svc_pool *pool, int node)
 
 	__set_bit(RQ_BUSY, &rqstp->rq_flags);
 	spin_lock_init(&rqstp->rq_lock);
+	INIT_LIST_HEAD(&rqstp->rq_batch);
 	rqstp->rq_server = serv;
 	rqstp->rq_pool = pool;
 
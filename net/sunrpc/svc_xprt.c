@@ -46,6 +46,8 @@ static LIST_HEAD(svc_xprt_class_list);
 /* SMP locking strategy:
  *
  *	svc_pool->sp_lock protects most of the fields of that pool.
+ *	svc_xprt_queue->xq_lock protects one CPU's list of pending
+ *	transports; svc_pool->sp_nr_queued counts them over all CPUs.
  *	svc_serv->sv_lock protects sv_tempsocks, sv_permsocks, sv_tmpcnt.
  *	when both need to be taken (rare), svc_serv->sv_lock is first.
  *	The "service mutex" protects svc_serv->sv_nrthread.
@@ -407,6 +409,7 @@ static bool svc_xprt_ready(struct svc_xprt *xprt)
 
 void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 {
+	struct svc_xprt_queue *q;
 	struct svc_pool *pool;
 	struct svc_rqst	*rqstp = NULL;
 	int cpu;
@@ -424,13 +427,23 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 
 	cpu = get_cpu();
 	pool = svc_pool_for_cpu(xprt->xpt_server, cpu);
+	q = per_cpu_ptr(pool->sp_queues, cpu);
 
 	atomic_long_inc(&pool->sp_stats.packets);
 
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
-	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
+	spin_lock_bh(&q->xq_lock);
+	list_add_tail(&xprt->xpt_ready, &q->xq_xprts);
+	spin_unlock_bh(&q->xq_lock);
+	atomic_inc(&pool->sp_nr_queued);
+	atomic_long_inc(&pool->sp_stats.sockets_queued);
+
+	/* If no thread was idle last time we looked, don't walk them all
+	 * again: a thread clears SP_CONGESTED before it checks sp_nr_queued
+	 * and goes to sleep, pairs with svc_get_next_xprt().
+	 */
+	smp_mb__after_atomic();
+	if (test_bit(SP_CONGESTED, &pool->sp_flags))
+		goto out;
 
 	/* find a thread for this xprt */
 	rcu_read_lock();
@@ -446,6 +459,7 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 	rqstp = NULL;
 out_unlock:
 	rcu_read_unlock();
+out:
 	put_cpu();
 	trace_svc_xprt_do_enqueue(xprt, rqstp);
 }
@@ -465,27 +479,85 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
 /*
- * Dequeue the first transport, if there is one.
+ * Take the first transport off @cpu's queue. While the pool has no idle
+ * thread to hand them to anyway, take up to SVC_XPRT_BATCH - 1 more onto
+ * rqstp->rq_batch under the same lock.
  */
-static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
+#define SVC_XPRT_BATCH		4
+
+static struct svc_xprt *svc_xprt_queue_pop(struct svc_rqst *rqstp, int cpu)
 {
-	struct svc_xprt	*xprt = NULL;
+	struct svc_pool *pool = rqstp->rq_pool;
+	struct svc_xprt_queue *q = per_cpu_ptr(pool->sp_queues, cpu);
+	struct svc_xprt	*xprt, *next;
+	int n = 0;
 
-	if (list_empty(&pool->sp_sockets))
-		goto out;
+	if (list_empty(&q->xq_xprts))
+		return NULL;
 
-	spin_lock_bh(&pool->sp_lock);
-	if (likely(!list_empty(&pool->sp_sockets))) {
-		xprt = list_first_entry(&pool->sp_sockets,
-					struct svc_xprt, xpt_ready);
+	spin_lock_bh(&q->xq_lock);
+	xprt = list_first_entry_or_null(&q->xq_xprts, struct svc_xprt,
+					xpt_ready);
+	if (xprt) {
 		list_del_init(&xprt->xpt_ready);
 		svc_xprt_get(xprt);
+		n++;
+		while (n < SVC_XPRT_BATCH &&
+		       test_bit(SP_CONGESTED, &pool->sp_flags) &&
+		       (next = list_first_entry_or_null(&q->xq_xprts,
+							struct svc_xprt,
+							xpt_ready))) {
+			list_move_tail(&next->xpt_ready, &rqstp->rq_batch);
+			svc_xprt_get(next);
+			n++;
+		}
 	}
-	spin_unlock_bh(&pool->sp_lock);
-out:
+	spin_unlock_bh(&q->xq_lock);
+
+	atomic_sub(n, &pool->sp_nr_queued);
 	return xprt;
 }
 
+/*
+ * Dequeue the next transport, if there is one: what is left of our batch,
+ * then our own CPU's queue, then steal from the other CPUs of the pool.
+ */
+static struct svc_xprt *svc_xprt_dequeue(struct svc_rqst *rqstp)
+{
+	struct svc_xprt	*xprt;
+	int cpu;
+
+	xprt = list_first_entry_or_null(&rqstp->rq_batch, struct svc_xprt,
+					xpt_ready);
+	if (xprt) {
+		list_del_init(&xprt->xpt_ready);
+		return xprt;
+	}
+
+	if (!atomic_read(&rqstp->rq_pool->sp_nr_queued))
+		return NULL;
+
+	for_each_cpu_wrap(cpu, cpu_possible_mask, raw_smp_processor_id()) {
+		xprt = svc_xprt_queue_pop(rqstp, cpu);
+		if (xprt)
+			return xprt;
+	}
+	return NULL;
+}
+
+/* A thread that stops serving hands its unprocessed batch back */
+static void svc_xprt_release_batch(struct svc_rqst *rqstp)
+{
+	struct svc_xprt	*xprt;
+
+	while ((xprt = list_first_entry_or_null(&rqstp->rq_batch,
+						struct svc_xprt, xpt_ready))) {
+		list_del_init(&xprt->xpt_ready);
+		svc_xprt_received(xprt);
+		svc_xprt_put(xprt);
+	}
+}
+
 /**
  * svc_reserve - change the space reserved for the reply to a request.
  * @rqstp:  The request in question
@@ -693,7 +765,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (atomic_read(&pool->sp_nr_queued))
 		return false;
 
 	/* are we shutting down? */
@@ -715,7 +787,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	/* rq_xprt should be clear on entry */
 	WARN_ON_ONCE(rqstp->rq_xprt);
 
-	rqstp->rq_xprt = svc_xprt_dequeue(pool);
+	rqstp->rq_xprt = svc_xprt_dequeue(rqstp);
 	if (rqstp->rq_xprt)
 		goto out_found;
 
@@ -738,7 +810,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 
 	set_bit(RQ_BUSY, &rqstp->rq_flags);
 	smp_mb__after_atomic();
-	rqstp->rq_xprt = svc_xprt_dequeue(pool);
+	rqstp->rq_xprt = svc_xprt_dequeue(rqstp);
 	if (rqstp->rq_xprt)
 		goto out_found;
 
@@ -839,13 +911,13 @@ int svc_recv(struct svc_rqst *rqstp, long timeout)
 
 	err = svc_alloc_arg(rqstp);
 	if (err)
-		goto out;
+		goto out_batch;
 
 	try_to_freeze();
 	cond_resched();
 	err = -EINTR;
 	if (signalled() || kthread_should_stop())
-		goto out;
+		goto out_batch;
 
 	xprt = svc_get_next_xprt(rqstp, timeout);
 	if (IS_ERR(xprt)) {
@@ -875,6 +947,9 @@ int svc_recv(struct svc_rqst *rqstp, long timeout)
 	svc_xprt_release(rqstp);
 out:
 	return err;
+out_batch:
+	svc_xprt_release_batch(rqstp);
+	return err;
 }
 EXPORT_SYMBOL_GPL(svc_recv);
 
@@ -1076,23 +1151,30 @@ static int svc_close_list(struct svc_serv *serv, struct list_head *xprt_list, st
 
 static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 {
+	struct svc_xprt_queue *q;
 	struct svc_pool *pool;
 	struct svc_xprt *xprt;
 	struct svc_xprt *tmp;
-	int i;
+	int i, cpu;
 
 	for (i = 0; i < serv->sv_nrpools; i++) {
 		pool = &serv->sv_pools[i];
 
-		spin_lock_bh(&pool->sp_lock);
-		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
-			if (xprt->xpt_net != net)
-				continue;
-			list_del_init(&xprt->xpt_ready);
-			spin_unlock_bh(&pool->sp_lock);
-			return xprt;
+		for_each_possible_cpu(cpu) {
+			q = per_cpu_ptr(pool->sp_queues, cpu);
+
+			spin_lock_bh(&q->xq_lock);
+			list_for_each_entry_safe(xprt, tmp, &q->xq_xprts,
+						 xpt_ready) {
+				if (xprt->xpt_net != net)
+					continue;
+				list_del_init(&xprt->xpt_ready);
+				spin_unlock_bh(&q->xq_lock);
+				atomic_dec(&pool->sp_nr_queued);
+				return xprt;
+			}
+			spin_unlock_bh(&q->xq_lock);
 		}
-		spin_unlock_bh(&pool->sp_lock);
 	}
 	return NULL;
 }
@@ -1407,7 +1489,7 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	seq_printf(m, "%u %lu %lu %lu %lu\n",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
-		pool->sp_stats.sockets_queued,
+		(unsigned long)atomic_long_read(&pool->sp_stats.sockets_queued),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
 
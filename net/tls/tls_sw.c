@@ -1405,6 +1405,10 @@ static int tls_setup_from_iter(struct sock *sk, struct iov_iter *from,
  * out_iov or out_sg must be non-NULL. In case both out_iov and out_sg are
  * NULL, then the decryption happens inside skb buffers itself, i.e.
  * zero-copy gets disabled and 'zc' is updated.
+ *
+ * For TLS 1.3 into out_iov, the last plaintext byte is decrypted into a
+ * kernel tail byte and stored in ctx->control, assuming the record has no
+ * padding. The caller must check it, see decrypt_skb_update().
  */
 
 static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
@@ -1425,11 +1429,17 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	const int data_len = rxm->full_len - prot->overhead_size +
 			     prot->tail_size;
 	int iv_offset = 0;
+	int tail_size = 0;
+	u8 *tail;
 
 	if (*zc && (out_iov || out_sg)) {
-		if (out_iov)
-			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1;
-		else
+		if (out_iov) {
+			/* only the synchronous path reads the tail back */
+			if (prot->version == TLS_1_3_VERSION && !async)
+				tail_size = prot->tail_size;
+			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1 +
+				  tail_size;
+		} else
 			n_sgout = sg_nents(out_sg);
 		n_sgin = skb_nsg(skb, rxm->offset + prot->prepend_size,
 				 rxm->full_len - prot->prepend_size);
@@ -1451,9 +1461,10 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	mem_size = aead_size + (nsg * sizeof(struct scatterlist));
 	mem_size = mem_size + prot->aad_size;
 	mem_size = mem_size + crypto_aead_ivsize(ctx->aead_recv);
+	mem_size = mem_size + tail_size;
 
 	/* Allocate a single block of memory which contains
-	 * aead_req || sgin[] || sgout[] || aad || iv.
+	 * aead_req || sgin[] || sgout[] || aad || iv || tail.
 	 * This order achieves correct alignment for aead_req, sgin, sgout.
 	 */
 	mem = kmalloc(mem_size, sk->sk_allocation);
@@ -1466,6 +1477,7 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	sgout = sgin + n_sgin;
 	aad = (u8 *)(sgout + n_sgout);
 	iv = aad + prot->aad_size;
+	tail = iv + crypto_aead_ivsize(ctx->aead_recv);
 
 	/* For CCM based ciphers, first byte of nonce+iv is always '2' */
 	if (prot->cipher_type == TLS_CIPHER_AES_CCM_128) {
@@ -1512,11 +1524,17 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			sg_set_buf(&sgout[0], aad, prot->aad_size);
 
 			*chunk = 0;
-			err = tls_setup_from_iter(sk, out_iov, data_len,
+			err = tls_setup_from_iter(sk, out_iov,
+						  data_len - tail_size,
 						  &pages, chunk, &sgout[1],
-						  (n_sgout - 1));
+						  (n_sgout - 1 - tail_size));
 			if (err < 0)
 				goto fallback_to_reg_recv;
+			if (tail_size) {
+				sg_unmark_end(&sgout[pages]);
+				sg_set_buf(&sgout[pages + 1], tail, tail_size);
+				sg_mark_end(&sgout[pages + 1]);
+			}
 		} else if (out_sg) {
 			memcpy(sgout, out_sg, n_sgout * sizeof(*sgout));
 		} else {
@@ -1528,6 +1546,7 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 		pages = 0;
 		*chunk = data_len;
 		*zc = false;
+		tail_size = 0;
 	}
 
 	/* Prepare and submit AEAD request */
@@ -1536,6 +1555,9 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	if (err == -EINPROGRESS)
 		return err;
 
+	if (!err && tail_size)
+		ctx->control = *tail;
+
 	/* Release the pages in case iov was mapped to pages */
 	for (; pages > 0; pages--)
 		put_page(sg_page(&sgout[pages]));
@@ -1565,6 +1587,16 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 		if (!ctx->decrypted) {
 			err = decrypt_internal(sk, skb, dest, NULL, chunk, zc,
 					       async);
+			/* A TLS 1.3 record decrypted straight into the user
+			 * buffer must be unpadded data; anything else leaves
+			 * the ciphertext intact, so redo it in place.
+			 */
+			if (!err && *zc && prot->version == TLS_1_3_VERSION &&
+			    ctx->control != TLS_RECORD_TYPE_DATA) {
+				iov_iter_revert(dest, *chunk);
+				err = decrypt_internal(sk, skb, NULL, NULL,
+						       chunk, zc, false);
+			}
 			if (err < 0) {
 				if (err == -EINPROGRESS)
 					tls_advance_record_sn(sk, prot,
@@ -1578,7 +1610,8 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 			*zc = false;
 		}
 
-		pad = padding_length(ctx, prot, skb);
+		/* ctx->control is already known for TLS 1.3 zero-copy */
+		pad = *zc ? 0 : padding_length(ctx, prot, skb);
 		if (pad < 0)
 			return pad;
 
@@ -1824,7 +1857,6 @@ int tls_sw_recvmsg(struct sock *sk,
 
 		if (to_decrypt <= len && !is_kvec && !is_peek &&
 		    ctx->control == TLS_RECORD_TYPE_DATA &&
-		    prot->version != TLS_1_3_VERSION &&
 		    !bpf_strp_enabled)
 			zc = true;
 
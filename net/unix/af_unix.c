@@ -494,6 +494,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	WARN_ON(refcount_read(&sk->sk_wmem_alloc));
 	WARN_ON(!sk_unhashed(sk));
@@ -1677,6 +1678,47 @@ static void scm_stat_del(struct sock *sk, struct sk_buff *skb)
 		atomic_sub(fp->count, &u->scm_stat.nr_fds);
 }
 
+/* MSG_ZEROCOPY: large sends attach the sender's pages to the skbs instead
+ * of copying them. The receiver copies straight out of them, and the
+ * sender gets the usual completion on its error queue once every skb of
+ * the send has been consumed. Below UNIX_ZEROCOPY_MIN pinning costs more
+ * than the copy, those sends are copied and reported as such.
+ */
+#define UNIX_ZEROCOPY_MIN	(16 * 1024)
+
+static int unix_zerocopy_alloc(struct sock *sk, struct msghdr *msg,
+			       size_t len, struct ubuf_info **uarg)
+{
+	if (!(msg->msg_flags & MSG_ZEROCOPY) || !len ||
+	    !sock_flag(sk, SOCK_ZEROCOPY))
+		return 0;
+
+	*uarg = sock_zerocopy_alloc(sk, len);
+	if (!*uarg)
+		return -ENOBUFS;
+
+	if (len < UNIX_ZEROCOPY_MIN)
+		(*uarg)->zerocopy = 0;
+	return 0;
+}
+
+/* Pin up to @len bytes of the sender's pages into @skb frags. Returns
+ * -EMSGSIZE if the frags ran out first, with whatever fit still attached.
+ */
+static int unix_zerocopy_fill(struct sk_buff *skb, struct msghdr *msg,
+			      int len, struct ubuf_info *uarg)
+{
+	int err;
+
+	/* no sk: charge the pages to sk_wmem_alloc like our other skbs,
+	 * not to the TCP style sk_wmem_queued of SOCK_STREAM
+	 */
+	err = __zerocopy_sg_from_iter(NULL, skb, &msg->msg_iter, len);
+	if (skb->len)
+		skb_zcopy_set(skb, uarg, NULL);
+	return err;
+}
+
 /*
  *	Send AF_UNIX data.
  */
@@ -1695,6 +1737,7 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	struct sk_buff *skb;
 	long timeo;
 	struct scm_cookie scm;
+	struct ubuf_info *uarg = NULL;
 	int data_len = 0;
 	int sk_locked;
 
@@ -1728,18 +1771,35 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (len > sk->sk_sndbuf - 32)
 		goto out;
 
-	if (len > SKB_MAX_ALLOC) {
-		data_len = min_t(size_t,
-				 len - SKB_MAX_ALLOC,
-				 MAX_SKB_FRAGS * PAGE_SIZE);
-		data_len = PAGE_ALIGN(data_len);
+	if (sk->sk_type == SOCK_SEQPACKET) {
+		err = unix_zerocopy_alloc(sk, msg, len, &uarg);
+		if (err)
+			goto out;
 
-		BUILD_BUG_ON(SKB_MAX_ALLOC < PAGE_SIZE);
+		/* a record can't be split, copy what doesn't fit in frags */
+		if (uarg && iov_iter_npages(&msg->msg_iter, MAX_SKB_FRAGS + 1) >
+			    MAX_SKB_FRAGS)
+			uarg->zerocopy = 0;
 	}
 
-	skb = sock_alloc_send_pskb(sk, len - data_len, data_len,
-				   msg->msg_flags & MSG_DONTWAIT, &err,
-				   PAGE_ALLOC_COSTLY_ORDER);
+	if (uarg && uarg->zerocopy) {
+		skb = sock_alloc_send_pskb(sk, 0, 0,
+					   msg->msg_flags & MSG_DONTWAIT,
+					   &err, 0);
+	} else {
+		if (len > SKB_MAX_ALLOC) {
+			data_len = min_t(size_t,
+					 len - SKB_MAX_ALLOC,
+					 MAX_SKB_FRAGS * PAGE_SIZE);
+			data_len = PAGE_ALIGN(data_len);
+
+			BUILD_BUG_ON(SKB_MAX_ALLOC < PAGE_SIZE);
+		}
+
+		skb = sock_alloc_send_pskb(sk, len - data_len, data_len,
+					   msg->msg_flags & MSG_DONTWAIT, &err,
+					   PAGE_ALLOC_COSTLY_ORDER);
+	}
 	if (skb == NULL)
 		goto out;
 
@@ -1747,10 +1807,16 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (err < 0)
 		goto out_free;
 
-	skb_put(skb, len - data_len);
-	skb->data_len = data_len;
-	skb->len = len;
-	err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, len);
+	if (uarg && uarg->zerocopy) {
+		err = unix_zerocopy_fill(skb, msg, len, uarg);
+		if (!err && skb->len != len)
+			err = -EFAULT;
+	} else {
+		skb_put(skb, len - data_len);
+		skb->data_len = data_len;
+		skb->len = len;
+		err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, len);
+	}
 	if (err)
 		goto out_free;
 
@@ -1868,6 +1934,7 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	unix_state_unlock(other);
 	other->sk_data_ready(other);
 	sock_put(other);
+	sock_zerocopy_put(uarg);
 	scm_destroy(&scm);
 	return len;
 
@@ -1880,6 +1947,11 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 out:
 	if (other)
 		sock_put(other);
+	/* a filtered record still counts as sent */
+	if (err > 0)
+		sock_zerocopy_put(uarg);
+	else
+		sock_zerocopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return err;
 }
@@ -1898,6 +1970,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	struct sk_buff *skb;
 	int sent = 0;
 	struct scm_cookie scm;
+	struct ubuf_info *uarg = NULL;
 	bool fds_sent = false;
 	int data_len;
 
@@ -1923,22 +1996,35 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	err = unix_zerocopy_alloc(sk, msg, len, &uarg);
+	if (err)
+		goto out_err;
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
-		/* allow fallback to order-0 allocations */
-		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
+		if (uarg && uarg->zerocopy) {
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+		} else {
+			/* allow fallback to order-0 allocations */
+			size = min_t(int, size,
+				     SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
-		data_len = max_t(int, 0, size - SKB_MAX_HEAD(0));
+			data_len = max_t(int, 0, size - SKB_MAX_HEAD(0));
 
-		data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
+			data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
 
-		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
-					   msg->msg_flags & MSG_DONTWAIT, &err,
-					   get_order(UNIX_SKB_FRAGS_SZ));
+			skb = sock_alloc_send_pskb(sk, size - data_len,
+						   data_len,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err,
+						   get_order(UNIX_SKB_FRAGS_SZ));
+		}
 		if (!skb)
 			goto out_err;
 
@@ -1950,10 +2036,21 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		}
 		fds_sent = true;
 
-		skb_put(skb, size - data_len);
-		skb->data_len = data_len;
-		skb->len = size;
-		err = skb_copy_datagram_from_iter(skb, 0, &msg->msg_iter, size);
+		if (uarg && uarg->zerocopy) {
+			/* running out of frags just ends this skb early */
+			err = unix_zerocopy_fill(skb, msg, size, uarg);
+			if (err == -EMSGSIZE && skb->len) {
+				size = skb->len;
+				err = 0;
+			}
+		} else {
+			skb_put(skb, size - data_len);
+			skb->data_len = data_len;
+			skb->len = size;
+			err = skb_copy_datagram_from_iter(skb, 0,
+							  &msg->msg_iter,
+							  size);
+		}
 		if (err) {
 			kfree_skb(skb);
 			goto out_err;
@@ -1973,6 +2070,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		sent += size;
 	}
 
+	sock_zerocopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -1985,6 +2083,10 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (sent)
+		sock_zerocopy_put(uarg);
+	else
+		sock_zerocopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2156,6 +2258,10 @@ static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 	int skip;
 	int err;
 
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
 	err = -EOPNOTSUPP;
 	if (flags&MSG_OOB)
 		goto out;
@@ -2532,6 +2638,10 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.flags = flags
 	};
 
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
 	return unix_stream_read_generic(&state, true);
 }
 
@@ -2539,6 +2649,13 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	int err;
+
+	/* the pipe would keep the sender's pages past the completion */
+	err = skb_orphan_frags_rx(skb, GFP_KERNEL);
+	if (err)
+		return err;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -2722,7 +2839,7 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	mask = 0;
 
 	/* exceptional events? */
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (sk->sk_shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -21,6 +21,9 @@
 #include <linux/mutex.h>
 #include <net/af_vsock.h>
 
+/* Packets handed to the TX virtqueue per virtqueue_add_batch() call */
+#define VIRTIO_VSOCK_TX_BATCH	8
+
 static struct workqueue_struct *virtio_vsock_workqueue;
 static struct virtio_vsock __rcu *the_virtio_vsock;
 static DEFINE_MUTEX(the_virtio_vsock_mutex); /* protects the_virtio_vsock */
@@ -99,48 +102,56 @@ virtio_transport_send_pkt_work(struct work_struct *work)
 	vq = vsock->vqs[VSOCK_VQ_TX];
 
 	for (;;) {
-		struct virtio_vsock_pkt *pkt;
-		struct scatterlist hdr, buf, *sgs[2];
-		int ret, in_sg = 0, out_sg = 0;
-		bool reply;
+		struct virtio_vsock_pkt *pkts[VIRTIO_VSOCK_TX_BATCH];
+		struct virtqueue_buf bufs[VIRTIO_VSOCK_TX_BATCH];
+		struct scatterlist sg[VIRTIO_VSOCK_TX_BATCH][2];
+		struct scatterlist *sgs[VIRTIO_VSOCK_TX_BATCH][2];
+		int i, n = 0, ret;
 
 		spin_lock_bh(&vsock->send_pkt_list_lock);
-		if (list_empty(&vsock->send_pkt_list)) {
-			spin_unlock_bh(&vsock->send_pkt_list_lock);
-			break;
+		while (n < VIRTIO_VSOCK_TX_BATCH &&
+		       !list_empty(&vsock->send_pkt_list)) {
+			pkts[n] = list_first_entry(&vsock->send_pkt_list,
+						   struct virtio_vsock_pkt,
+						   list);
+			list_del_init(&pkts[n]->list);
+			n++;
 		}
-
-		pkt = list_first_entry(&vsock->send_pkt_list,
-				       struct virtio_vsock_pkt, list);
-		list_del_init(&pkt->list);
 		spin_unlock_bh(&vsock->send_pkt_list_lock);
 
-		virtio_transport_deliver_tap_pkt(pkt);
+		if (!n)
+			break;
 
-		reply = pkt->reply;
+		for (i = 0; i < n; i++) {
+			struct virtio_vsock_pkt *pkt = pkts[i];
+			int out_sg = 0;
 
-		sg_init_one(&hdr, &pkt->hdr, sizeof(pkt->hdr));
-		sgs[out_sg++] = &hdr;
-		if (pkt->buf) {
-			sg_init_one(&buf, pkt->buf, pkt->len);
-			sgs[out_sg++] = &buf;
-		}
+			virtio_transport_deliver_tap_pkt(pkt);
 
-		ret = virtqueue_add_sgs(vq, sgs, out_sg, in_sg, pkt, GFP_KERNEL);
-		/* Usually this means that there is no more space available in
-		 * the vq
-		 */
-		if (ret < 0) {
-			spin_lock_bh(&vsock->send_pkt_list_lock);
-			list_add(&pkt->list, &vsock->send_pkt_list);
-			spin_unlock_bh(&vsock->send_pkt_list_lock);
-			break;
+			sg_init_one(&sg[i][0], &pkt->hdr, sizeof(pkt->hdr));
+			sgs[i][out_sg++] = &sg[i][0];
+			if (pkt->buf) {
+				sg_init_one(&sg[i][1], pkt->buf, pkt->len);
+				sgs[i][out_sg++] = &sg[i][1];
+			}
+
+			bufs[i].sgs = sgs[i];
+			bufs[i].out_sgs = out_sg;
+			bufs[i].in_sgs = 0;
+			bufs[i].data = pkt;
 		}
 
-		if (reply) {
+		ret = virtqueue_add_batch(vq, bufs, n, GFP_KERNEL);
+		if (ret < 0)
+			ret = 0;
+
+		for (i = 0; i < ret; i++) {
 			struct virtqueue *rx_vq = vsock->vqs[VSOCK_VQ_RX];
 			int val;
 
+			if (!pkts[i]->reply)
+				continue;
+
 			val = atomic_dec_return(&vsock->queued_replies);
 
 			/* Do we now have resources to resume rx processing? */
@@ -148,7 +159,20 @@ virtio_transport_send_pkt_work(struct work_struct *work)
 				restart_rx = true;
 		}
 
-		added = true;
+		if (ret)
+			added = true;
+
+		/* Usually this means that there is no more space available in
+		 * the vq
+		 */
+		if (ret < n) {
+			spin_lock_bh(&vsock->send_pkt_list_lock);
+			for (i = n - 1; i >= ret; i--)
+				list_add(&pkts[i]->list,
+					 &vsock->send_pkt_list);
+			spin_unlock_bh(&vsock->send_pkt_list_lock);
+			break;
+		}
 	}
 
 	if (added)
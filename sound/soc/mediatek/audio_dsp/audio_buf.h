@@ -78,6 +78,33 @@ struct audio_hw_buffer {
 	int ignore_irq;
 };
 
+/*
+ * shared ring control block, placed at AUDIO_RING_CTRL_OFFSET of the
+ * task's AP->DSP message memory. The AP publishes its ring index in
+ * appl_pos and the DSP publishes its own in hw_pos. A DSP that polls
+ * appl_pos on every processing tick sets AUDIO_RING_CAP_POLL, after
+ * which the AP only sends a copy IPI while dsp_waiting is set.
+ *
+ * To avoid a lost doorbell, the DSP sets dsp_waiting, issues a full
+ * barrier and re-reads appl_pos before it sleeps; the AP writes
+ * appl_pos, issues a full barrier and then reads dsp_waiting.
+ */
+#define AUDIO_RING_CTRL_MAGIC (0x52474e43) /* "CNGR" */
+#define AUDIO_RING_CTRL_OFFSET (0x200)
+#define AUDIO_RING_CAP_POLL (1 << 0)
+
+struct audio_ring_ctrl {
+	unsigned int magic;            /* AP: AUDIO_RING_CTRL_MAGIC */
+	unsigned int dsp_caps;         /* DSP: AUDIO_RING_CAP_* */
+	unsigned long long appl_pos;   /* AP: bridge index owned by AP */
+	unsigned long long hw_pos;     /* DSP: bridge index owned by DSP */
+	unsigned long long consumed;   /* DSP: total bytes consumed */
+	unsigned int avail_min;        /* AP: avail bytes to raise an IPI */
+	unsigned int dsp_waiting;      /* DSP: blocked on appl_pos */
+	unsigned int delay_ms;         /* DSP: pcm delay after consumed */
+	unsigned int reserved;
+};
+
 struct audiohw_buffer_ops {
 	unsigned int (*hwbuf_getcur)(struct audio_hw_buffer *audio_hw_buffer);
 	unsigned int (*hwbuf_getlen)(struct audio_hw_buffer *audio_hw_buffer);
@@ -46,6 +46,7 @@ struct mtk_base_dsp_mem {
 	struct audio_dsp_dram msg_atod_share_buf;
 	struct audio_dsp_dram msg_dtoa_share_buf;
 	struct audio_dsp_dram dsp_ring_share_buf;
+	struct audio_ring_ctrl *ring_ctrl; /* inside msg_atod_share_buf */
 	unsigned char ipi_payload_buf[MAX_PAYLOAD_SIZE];
 	unsigned int dsp_feature_counter;
 	int underflowed;
@@ -362,6 +362,75 @@ int mtk_init_adsp_msg_sharemem(struct audio_dsp_dram *share_buf,
 	return 0;
 }
 
+/*
+ * shared ring control, see struct audio_ring_ctrl.
+ * init is called before AUDIO_DSP_TASK_HWPARAM so that the DSP can
+ * advertise AUDIO_RING_CAP_POLL while handling it, reset is called
+ * whenever the ring indexes are reset.
+ */
+void mtk_adsp_ring_ctrl_init(struct mtk_base_dsp_mem *dsp_mem)
+{
+	struct audio_ring_ctrl *ctrl = dsp_mem->ring_ctrl;
+
+	BUILD_BUG_ON(sizeof(struct audio_hw_buffer) > AUDIO_RING_CTRL_OFFSET);
+
+	if (!ctrl)
+		return;
+
+	memset(ctrl, 0, sizeof(*ctrl));
+	wmb();
+	WRITE_ONCE(ctrl->magic, AUDIO_RING_CTRL_MAGIC);
+}
+EXPORT_SYMBOL_GPL(mtk_adsp_ring_ctrl_init);
+
+void mtk_adsp_ring_ctrl_reset(struct mtk_base_dsp_mem *dsp_mem,
+			      unsigned int avail_min)
+{
+	struct audio_ring_ctrl *ctrl = dsp_mem->ring_ctrl;
+
+	if (!ctrl)
+		return;
+
+	WRITE_ONCE(ctrl->appl_pos, 0);
+	WRITE_ONCE(ctrl->hw_pos, 0);
+	WRITE_ONCE(ctrl->consumed, 0);
+	WRITE_ONCE(ctrl->delay_ms, 0);
+	WRITE_ONCE(ctrl->avail_min, avail_min);
+	wmb();
+}
+EXPORT_SYMBOL_GPL(mtk_adsp_ring_ctrl_reset);
+
+bool mtk_adsp_ring_ctrl_polling(struct mtk_base_dsp_mem *dsp_mem)
+{
+	struct audio_ring_ctrl *ctrl = dsp_mem->ring_ctrl;
+
+	return ctrl && READ_ONCE(ctrl->magic) == AUDIO_RING_CTRL_MAGIC &&
+	       (READ_ONCE(ctrl->dsp_caps) & AUDIO_RING_CAP_POLL);
+}
+EXPORT_SYMBOL_GPL(mtk_adsp_ring_ctrl_polling);
+
+/*
+ * publish the AP side ring index, return true when the DSP does not
+ * poll it or is blocked waiting for it and needs the copy IPI.
+ */
+bool mtk_adsp_ring_ctrl_publish(struct mtk_base_dsp_mem *dsp_mem,
+				unsigned long long appl_pos)
+{
+	struct audio_ring_ctrl *ctrl = dsp_mem->ring_ctrl;
+
+	if (!mtk_adsp_ring_ctrl_polling(dsp_mem))
+		return true;
+
+	/* ring data must be visible before the index that covers it */
+	wmb();
+	WRITE_ONCE(ctrl->appl_pos, appl_pos);
+	/* pairs with the DSP setting dsp_waiting before re-reading appl_pos */
+	mb();
+
+	return READ_ONCE(ctrl->dsp_waiting);
+}
+EXPORT_SYMBOL_GPL(mtk_adsp_ring_ctrl_publish);
+
 bool is_adsp_genpool_addr_valid(struct snd_pcm_substream *substream)
 {
 	struct gen_pool *gen_pool_dsp =
@@ -554,6 +623,10 @@ int aud_genppol_allocate_sharemem_msg(struct mtk_base_dsp_mem *dsp_mem,
 		ret = mtk_init_adsp_msg_sharemem
 			(&dsp_mem->msg_atod_share_buf, vaddr,
 			 paddr, (int)size);
+		if (ret == 0 && size >= AUDIO_RING_CTRL_OFFSET +
+				       sizeof(struct audio_ring_ctrl))
+			dsp_mem->ring_ctrl = (struct audio_ring_ctrl *)
+					     (vaddr + AUDIO_RING_CTRL_OFFSET);
 		break;
 	}
 	case ADSP_TASK_DTOA_MSG_MEM: {
@@ -74,6 +74,14 @@ int mtk_init_adsp_msg_sharemem(struct audio_dsp_dram *msg_atod_share_buf,
 				unsigned long vaddr, unsigned long long paddr,
 				int size);
 
+/* shared ring control with dsp */
+void mtk_adsp_ring_ctrl_init(struct mtk_base_dsp_mem *dsp_mem);
+void mtk_adsp_ring_ctrl_reset(struct mtk_base_dsp_mem *dsp_mem,
+			      unsigned int avail_min);
+bool mtk_adsp_ring_ctrl_polling(struct mtk_base_dsp_mem *dsp_mem);
+bool mtk_adsp_ring_ctrl_publish(struct mtk_base_dsp_mem *dsp_mem,
+				unsigned long long appl_pos);
+
 /* get struct of sharemem_block */
 unsigned int mtk_get_adsp_sharemem_size(int audio_task_id,
 					int task_sharemem_id);
@@ -290,6 +290,41 @@ static const struct snd_kcontrol_new dsp_platform_kcontrols[] = {
 		       dsp_wakelock_get, dsp_wakelock_set),
 };
 
+/*
+ * pull the ring index the DSP publishes in the shared ring control,
+ * so the pointer stays current without a per-period IPI.
+ */
+static void mtk_dsp_sync_ring_ctrl(struct snd_pcm_substream *substream,
+				   struct mtk_base_dsp_mem *dsp_mem)
+{
+	struct ringbuf_bridge *buf_bridge =
+		&dsp_mem->adsp_buf.aud_buffer.buf_bridge;
+	unsigned long long hw_pos;
+	unsigned long flags = 0;
+
+	if (!mtk_adsp_ring_ctrl_polling(dsp_mem) ||
+	    !snd_pcm_running(substream))
+		return;
+
+	hw_pos = READ_ONCE(dsp_mem->ring_ctrl->hw_pos);
+	/* ring data written by the DSP is read after the index */
+	rmb();
+	if (hw_pos < buf_bridge->pBufBase || hw_pos >= buf_bridge->pBufEnd)
+		return;
+
+	spin_lock_irqsave(&dsp_mem->ringbuf_lock, flags);
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+		if (hw_pos != buf_bridge->pRead) {
+			buf_bridge->pRead = hw_pos;
+			sync_ringbuf_readidx(&dsp_mem->ring_buf, buf_bridge);
+		}
+	} else if (hw_pos != buf_bridge->pWrite) {
+		buf_bridge->pWrite = hw_pos;
+		sync_ringbuf_writeidx(&dsp_mem->ring_buf, buf_bridge);
+	}
+	spin_unlock_irqrestore(&dsp_mem->ringbuf_lock, flags);
+}
+
 static snd_pcm_uframes_t mtk_dsphw_pcm_pointer_ul
 			 (struct snd_pcm_substream *substream)
 {
@@ -307,6 +342,7 @@ static snd_pcm_uframes_t mtk_dsphw_pcm_pointer_ul
 	dump_rbuf_s(__func__, &dsp_mem->ring_buf);
 #endif
 
+	mtk_dsp_sync_ring_ctrl(substream, dsp_mem);
 	ptr_bytes = dsp_mem->ring_buf.pWrite - dsp_mem->ring_buf.pBufBase;
 
 	return bytes_to_frames(substream->runtime, ptr_bytes);
@@ -451,6 +487,7 @@ static snd_pcm_uframes_t mtk_dsphw_pcm_pointer_dl
 	return bytes_to_frames(substream->runtime, pcm_remap_ptr_bytes);
 
 SYNC_READINDEX:
+	mtk_dsp_sync_ring_ctrl(substream, dsp_mem);
 
 #ifdef DEBUG_VERBOSE
 	dump_rbuf_s("-mtk_dsphw_pcm_pointer_dl", &dsp_mem->ring_buf);
@@ -893,6 +930,7 @@ static int mtk_dsp_pcm_hw_params(struct snd_soc_component *component,
 
 	memcpy(&dsp->dsp_mem[id].adsp_work_buf, &dsp->dsp_mem[id].adsp_buf,
 	       sizeof(struct audio_hw_buffer));
+	mtk_adsp_ring_ctrl_init(&dsp->dsp_mem[id]);
 	/* send audio_hw_buffer to SCP side */
 	ipi_audio_buf = (void *)dsp->dsp_mem[id].msg_atod_share_buf.va_addr;
 	memcpy((void *)ipi_audio_buf, (void *)&dsp->dsp_mem[id].adsp_buf,
@@ -986,6 +1024,10 @@ static int mtk_dsp_pcm_hw_prepare(struct snd_soc_component *component,
 	if (ret < 0)
 		pr_warn("%s set_audiobuffer_attribute err\n", __func__);
 
+	mtk_adsp_ring_ctrl_reset(&dsp->dsp_mem[id],
+				 frames_to_bytes(substream->runtime,
+				 substream->runtime->control->avail_min));
+
 	pr_info("%s(), %s start_threshold: %u stop_threshold: %u period_size: %d period_count: %d\n",
 		__func__, task_name,
 		adsp_buf->aud_buffer.start_threshold,
@@ -1071,6 +1113,7 @@ static int mtk_dsp_pcm_copy_dl(struct snd_pcm_substream *substream,
 {
 	int ret = 0, availsize = 0;
 	int ack_type;
+	bool need_ipi;
 	void *ipi_audio_buf; /* dsp <-> audio data struct */
 	struct snd_soc_pcm_runtime *rtd = substream->private_data;
 	struct snd_soc_dai *cpu_dai = asoc_rtd_to_cpu(rtd, 0);
@@ -1127,8 +1170,12 @@ static int mtk_dsp_pcm_copy_dl(struct snd_pcm_substream *substream,
 	memcpy((void *)ipi_audio_buf, (void *)&dsp_mem->adsp_buf,
 	       sizeof(struct audio_hw_buffer));
 
+	/* a polling DSP picks up the new write index by itself */
+	need_ipi = mtk_adsp_ring_ctrl_publish(dsp_mem, buf_bridge->pWrite);
 	if (substream->runtime->status->state != SNDRV_PCM_STATE_RUNNING)
 		ack_type = AUDIO_IPI_MSG_NEED_ACK;
+	else if (!need_ipi)
+		return 0;
 	else
 		ack_type = AUDIO_IPI_MSG_BYPASS_ACK;
 	ret = mtk_scp_ipi_send(
@@ -1185,6 +1232,10 @@ static int mtk_dsp_pcm_copy_ul(struct snd_pcm_substream *substream,
 				    &dsp_mem->ring_buf);
 	spin_unlock_irqrestore(ringbuf_lock, flags);
 
+	if (!mtk_adsp_ring_ctrl_publish(dsp_mem,
+			dsp_mem->adsp_buf.aud_buffer.buf_bridge.pRead))
+		return 0;
+
 	ipi_audio_buf = (void *)dsp_mem->msg_atod_share_buf.va_addr;
 	memcpy((void *)ipi_audio_buf, (void *)&dsp_mem->adsp_buf,
 		sizeof(struct audio_hw_buffer));
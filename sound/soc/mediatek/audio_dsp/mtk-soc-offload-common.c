@@ -419,6 +419,7 @@ static int mtk_compr_offload_set_params(struct snd_soc_component *component,
 
 	dump_audio_hwbuffer(ipi_audio_buf);
 	dump_rbuf_s(__func__, &dsp->dsp_mem[ID].ring_buf);
+	mtk_adsp_ring_ctrl_init(&dsp->dsp_mem[ID]);
 
 	/* send to task with hw_param information , buffer and pcm attribute */
 	mtk_scp_ipi_send(get_dspscene_by_dspdaiid(ID),
@@ -615,6 +616,7 @@ static int offloadservice_copydatatoram(void __user *buf, size_t count)
 {
 	void *ipi_audio_buf; /* dsp <-> audio data struct */
 	int copy_size, availsize, ret = 0;
+	bool need_ipi = true;
 	static unsigned int u4round = 1;
 	int transferred = 0;
 	struct RingBuf *ringbuf = &(dsp->dsp_mem[ID].ring_buf);
@@ -640,6 +642,8 @@ static int offloadservice_copydatatoram(void __user *buf, size_t count)
 		afe_offload_block.transferred += count;
 		ringbuf_writebk = (unsigned long)ringbuf->pWrite;
 		ringbufbridge_writebk = buf_bridge->pWrite;
+		need_ipi = mtk_adsp_ring_ctrl_publish(&dsp->dsp_mem[ID],
+						      buf_bridge->pWrite);
 	} else {
 		//Liang: checked below, should not happened
 		pr_debug("%s fail copy_size = %d availsize = %d\n", __func__,
@@ -675,7 +679,8 @@ static int offloadservice_copydatatoram(void __user *buf, size_t count)
 		&dsp->dsp_mem[ID].adsp_buf.aud_buffer.buf_bridge);
 #endif
 
-	if (afe_offload_service.needdata) {
+	/* a polling DSP follows the write index without OFFLOAD_WRITEIDX */
+	if (afe_offload_service.needdata && need_ipi) {
 		transferred = RingBuf_getDataCount(ringbuf);
 		if (transferred >=
 		    (32 * USE_PERIODS_MAX) * u4round) {
@@ -725,6 +730,20 @@ static int offloadservice_copydatatoram(void __user *buf, size_t count)
 
 static int mtk_compr_send_query_tstamp(void)
 {
+	struct mtk_base_dsp_mem *dsp_mem = &dsp->dsp_mem[ID];
+
+	/* a polling DSP keeps the consumed count in the ring control */
+	if (mtk_adsp_ring_ctrl_polling(dsp_mem)) {
+		if (!offload_playback_pause) {
+			afe_offload_block.copied_total =
+				READ_ONCE(dsp_mem->ring_ctrl->consumed);
+			afe_offload_block.time_pcm_delay_ms =
+				READ_ONCE(dsp_mem->ring_ctrl->delay_ms);
+			afe_offload_block.time_pcm = ktime_get();
+		}
+		return 0;
+	}
+
 	mutex_lock(&afe_offload_service.ts_lock);
 	if (!afe_offload_service.tswait && !offload_playback_pause) {
 		mtk_scp_ipi_send(get_dspscene_by_dspdaiid(ID),
@@ -212,12 +212,15 @@ int mtk_afe_fe_hw_params(struct snd_pcm_substream *substream,
 	substream->runtime->dma_bytes = params_buffer_bytes(params);
 
 	if (memif->use_dram_only == 0 &&
-	    mtk_audio_sram_allocate(afe->sram,
-				    &substream->runtime->dma_addr,
-				    &substream->runtime->dma_area,
-				    substream->runtime->dma_bytes,
-				    substream,
-				    params_format(params), false) == 0) {
+	    mtk_audio_sram_allocate_class(afe->sram,
+				&substream->runtime->dma_addr,
+				&substream->runtime->dma_area,
+				substream->runtime->dma_bytes,
+				substream,
+				params_format(params), false,
+				memif->data->name,
+				div_u64((u64)params_period_size(params) *
+					USEC_PER_SEC, rate)) == 0) {
 		memif->using_sram = 1;
 	} else
 #endif
@@ -365,7 +368,9 @@ int mtk_afe_fe_hw_free(struct snd_pcm_substream *substream,
 	if (memif->using_sram) {
 		memif->using_sram = 0;
 		return mtk_audio_sram_free(afe->sram, substream);
-	} else
+	}
+	/* streams placed in dram still hold a placement record */
+	mtk_audio_sram_free(afe->sram, substream);
 #endif
 	{
 #if IS_ENABLED(CONFIG_SND_SOC_MTK_AUDIO_DSP)
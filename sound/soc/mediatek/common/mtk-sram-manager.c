@@ -5,12 +5,76 @@
  */
 
 #include <linux/module.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 
 #include "mtk-sram-manager.h"
 
+static const char *const mtk_audio_sram_class_name[] = {
+	[MTK_AUDIO_SRAM_CLASS_LOW_LATENCY] = "low_latency",
+	[MTK_AUDIO_SRAM_CLASS_NORMAL] = "normal",
+	[MTK_AUDIO_SRAM_CLASS_DEEP_BUFFER] = "deep_buffer",
+};
+
+static int mtk_audio_sram_show(struct seq_file *m, void *v)
+{
+	struct mtk_audio_sram *sram = m->private;
+	struct mtk_audio_sram_stream *st;
+	int i;
+
+	seq_printf(m, "sram %u bytes, mode %d, low_latency_reserve %u\n",
+		   sram->mode_size[sram->sram_mode], sram->sram_mode,
+		   sram->ll_reserve);
+	seq_puts(m, "stream\tclass\tperiod_us\tsize\tplacement\taddr\n");
+
+	spin_lock(&sram->lock);
+	for (i = 0; i < MTK_AUDIO_SRAM_MAX_STREAMS; i++) {
+		st = &sram->streams[i];
+		if (!st->user)
+			continue;
+
+		seq_printf(m, "%s\t%s\t%u\t%u\t%s\t%pad\n",
+			   st->name ? st->name : "-",
+			   mtk_audio_sram_class_name[st->class],
+			   st->period_us, st->size,
+			   st->in_sram ? "sram" : "dram", &st->phys_addr);
+	}
+	spin_unlock(&sram->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mtk_audio_sram);
+
+static struct mtk_audio_sram_stream *
+mtk_audio_sram_get_stream(struct mtk_audio_sram *sram, void *user)
+{
+	struct mtk_audio_sram_stream *free_st = NULL;
+	int i;
+
+	for (i = 0; i < MTK_AUDIO_SRAM_MAX_STREAMS; i++) {
+		if (sram->streams[i].user == user)
+			return &sram->streams[i];
+		if (!free_st && !sram->streams[i].user)
+			free_st = &sram->streams[i];
+	}
+
+	return free_st;
+}
+
+static unsigned int mtk_audio_sram_free_size(struct mtk_audio_sram *sram)
+{
+	unsigned int free_size = 0;
+	int i;
+
+	for (i = 0; i < sram->block_num; i++)
+		if (sram->blocks[i].valid && !sram->blocks[i].user)
+			free_size += sram->block_size;
+
+	return free_size;
+}
+
 static void mtk_audio_sram_update_block_valid(struct mtk_audio_sram *sram,
 					      enum mtk_audio_sram_mode mode)
 {
@@ -148,6 +212,16 @@ int mtk_audio_sram_init(struct device *dev,
 
 	sram->block_num = (sram->size / sram->block_size);
 
+	/* optional placement policy, reserve 0 keeps first come first served */
+	sram->ll_period_us = MTK_AUDIO_SRAM_LL_PERIOD_US;
+	sram->deep_period_us = MTK_AUDIO_SRAM_DEEP_PERIOD_US;
+	of_property_read_u32(sram_node, "low_latency_period_us",
+			     &sram->ll_period_us);
+	of_property_read_u32(sram_node, "deep_buffer_period_us",
+			     &sram->deep_period_us);
+	of_property_read_u32(sram_node, "low_latency_reserve",
+			     &sram->ll_reserve);
+
 	of_node_put(sram_node);
 
 	dev_info(sram->dev, "%s(), size %d, block_size %d, block_num %d, virt_addr %p, phys_addr %pad\n",
@@ -179,6 +253,9 @@ int mtk_audio_sram_init(struct device *dev,
 	sram->sram_mode = sram->prefer_mode;
 	mtk_audio_sram_update_block_valid(sram, sram->sram_mode);
 
+	debugfs_create_file("mtk_audio_sram", 0444, NULL, sram,
+			    &mtk_audio_sram_fops);
+
 	return 0;
 of_error:
 	of_node_put(sram_node);
@@ -186,10 +263,24 @@ int mtk_audio_sram_init(struct device *dev,
 }
 EXPORT_SYMBOL_GPL(mtk_audio_sram_init);
 
-int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
-			    dma_addr_t *phys_addr, unsigned char **virt_addr,
-			    unsigned int size, void *user,
-			    snd_pcm_format_t format, bool force_normal)
+enum mtk_audio_sram_class mtk_audio_sram_get_class(struct mtk_audio_sram *sram,
+						   unsigned int period_us)
+{
+	if (period_us && period_us <= sram->ll_period_us)
+		return MTK_AUDIO_SRAM_CLASS_LOW_LATENCY;
+	if (sram->deep_period_us && period_us >= sram->deep_period_us)
+		return MTK_AUDIO_SRAM_CLASS_DEEP_BUFFER;
+	return MTK_AUDIO_SRAM_CLASS_NORMAL;
+}
+EXPORT_SYMBOL_GPL(mtk_audio_sram_get_class);
+
+static int __mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
+				     dma_addr_t *phys_addr,
+				     unsigned char **virt_addr,
+				     unsigned int size, void *user,
+				     snd_pcm_format_t format,
+				     bool force_normal,
+				     enum mtk_audio_sram_class class)
 {
 	unsigned int block_num = 0;
 	unsigned int block_idx = 0;
@@ -199,10 +290,11 @@ int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
 	int ret = 0;
 	int i;
 
-	dev_info(sram->dev, "%s(), size %d, user %p, format %d, force_normal %d\n",
-		 __func__, size, user, format, force_normal);
+	dev_info(sram->dev, "%s(), size %d, user %p, format %d, force_normal %d, class %d\n",
+		 __func__, size, user, format, force_normal, class);
 
-	spin_lock(&sram->lock);
+	if (class == MTK_AUDIO_SRAM_CLASS_DEEP_BUFFER)
+		return -ENOMEM;
 
 	/* check if sram has user */
 	for (i = 0; i < sram->block_num; i++) {
@@ -233,7 +325,6 @@ int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
 			dev_info(sram->dev, "%s(), cannot change mode to %d\n",
 				 __func__,
 				 request_sram_mode);
-			spin_unlock(&sram->lock);
 			return -ENOMEM;
 		}
 
@@ -241,6 +332,14 @@ int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
 		mtk_audio_sram_update_block_valid(sram, sram->sram_mode);
 	}
 
+	/* keep room for low latency streams opened later */
+	if (class == MTK_AUDIO_SRAM_CLASS_NORMAL && sram->ll_reserve &&
+	    mtk_audio_sram_free_size(sram) < size + sram->ll_reserve) {
+		dev_info(sram->dev, "%s(), keep %u bytes for low latency\n",
+			 __func__, sram->ll_reserve);
+		return -ENOMEM;
+	}
+
 	if (sram->ops.set_sram_mode)
 		sram->ops.set_sram_mode(sram->dev, sram->sram_mode);
 	else
@@ -261,11 +360,64 @@ int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
 		ret = -ENOMEM;
 	}
 
+	return ret;
+}
+
+int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
+			    dma_addr_t *phys_addr, unsigned char **virt_addr,
+			    unsigned int size, void *user,
+			    snd_pcm_format_t format, bool force_normal)
+{
+	int ret;
+
+	spin_lock(&sram->lock);
+	ret = __mtk_audio_sram_allocate(sram, phys_addr, virt_addr, size, user,
+					format, force_normal,
+					MTK_AUDIO_SRAM_CLASS_NORMAL);
 	spin_unlock(&sram->lock);
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(mtk_audio_sram_allocate);
 
+/*
+ * Like mtk_audio_sram_allocate(), with the placement decided by the
+ * stream's period time.  The placement is recorded, also when the
+ * stream ends up in DRAM, and listed in debugfs until the user frees.
+ */
+int mtk_audio_sram_allocate_class(struct mtk_audio_sram *sram,
+				  dma_addr_t *phys_addr,
+				  unsigned char **virt_addr,
+				  unsigned int size, void *user,
+				  snd_pcm_format_t format, bool force_normal,
+				  const char *name, unsigned int period_us)
+{
+	enum mtk_audio_sram_class class;
+	struct mtk_audio_sram_stream *st;
+	int ret;
+
+	class = mtk_audio_sram_get_class(sram, period_us);
+
+	spin_lock(&sram->lock);
+	ret = __mtk_audio_sram_allocate(sram, phys_addr, virt_addr, size, user,
+					format, force_normal, class);
+
+	st = mtk_audio_sram_get_stream(sram, user);
+	if (st) {
+		st->user = user;
+		st->name = name;
+		st->class = class;
+		st->period_us = period_us;
+		st->size = size;
+		st->in_sram = !ret;
+		st->phys_addr = ret ? 0 : *phys_addr;
+	}
+	spin_unlock(&sram->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mtk_audio_sram_allocate_class);
+
 int mtk_audio_sram_free(struct mtk_audio_sram *sram, void *user)
 {
 	unsigned int i = 0;
@@ -279,6 +431,9 @@ int mtk_audio_sram_free(struct mtk_audio_sram *sram, void *user)
 		if (sram_blk->user == user)
 			sram_blk->user = NULL;
 	}
+	for (i = 0; i < MTK_AUDIO_SRAM_MAX_STREAMS; i++)
+		if (sram->streams[i].user == user)
+			sram->streams[i].user = NULL;
 	spin_unlock(&sram->lock);
 	return 0;
 }
@@ -15,6 +15,32 @@ enum mtk_audio_sram_mode {
 	MTK_AUDIO_SRAM_MODE_NUM,
 };
 
+/*
+ * Placement class of a stream, from its period time.  Low latency streams
+ * (FastMixer, AAudio) may use all of SRAM, normal streams must leave
+ * low_latency_reserve bytes free, deep buffer streams always go to DRAM.
+ */
+enum mtk_audio_sram_class {
+	MTK_AUDIO_SRAM_CLASS_LOW_LATENCY = 0,
+	MTK_AUDIO_SRAM_CLASS_NORMAL,
+	MTK_AUDIO_SRAM_CLASS_DEEP_BUFFER,
+	MTK_AUDIO_SRAM_CLASS_NUM,
+};
+
+#define MTK_AUDIO_SRAM_LL_PERIOD_US	5000
+#define MTK_AUDIO_SRAM_DEEP_PERIOD_US	20000
+#define MTK_AUDIO_SRAM_MAX_STREAMS	16
+
+struct mtk_audio_sram_stream {
+	void *user;
+	const char *name;
+	enum mtk_audio_sram_class class;
+	unsigned int period_us;
+	unsigned int size;
+	bool in_sram;
+	dma_addr_t phys_addr;
+};
+
 struct mtk_audio_sram_block {
 	bool valid;
 	void *user;
@@ -43,6 +69,11 @@ struct mtk_audio_sram {
 	enum mtk_audio_sram_mode sram_mode;
 	unsigned int mode_size[MTK_AUDIO_SRAM_MODE_NUM];
 
+	unsigned int ll_period_us;
+	unsigned int deep_period_us;
+	unsigned int ll_reserve;
+	struct mtk_audio_sram_stream streams[MTK_AUDIO_SRAM_MAX_STREAMS];
+
 	struct mtk_audio_sram_ops ops;
 };
 
@@ -53,8 +84,17 @@ int mtk_audio_sram_allocate(struct mtk_audio_sram *sram,
 			    dma_addr_t *phys_addr, unsigned char **virt_addr,
 			    unsigned int size, void *user,
 			    snd_pcm_format_t format, bool force_normal);
+int mtk_audio_sram_allocate_class(struct mtk_audio_sram *sram,
+				  dma_addr_t *phys_addr,
+				  unsigned char **virt_addr,
+				  unsigned int size, void *user,
+				  snd_pcm_format_t format, bool force_normal,
+				  const char *name, unsigned int period_us);
 int mtk_audio_sram_free(struct mtk_audio_sram *sram, void *user);
 
+enum mtk_audio_sram_class mtk_audio_sram_get_class(struct mtk_audio_sram *sram,
+						   unsigned int period_us);
+
 unsigned int mtk_audio_sram_get_size(struct mtk_audio_sram *sram, int mode);
 
 #endif